@@ -0,0 +1,98 @@
+#ifndef BENCHMARKS_HPP
+#define BENCHMARKS_HPP
+
+//  CPU-    .    
+// (. winMain.cpp),    Output (OutputDebugString).
+namespace Benchmarks {
+	// Profiler:      ,     
+	// (,    ,     ).
+	void RunProfiler();
+
+	// FrameStats:      ,    float,
+	//     ,  AddSample  Summarize.
+	void RunFrameStats();
+
+	// FramePacer    (,   , 
+	//   )   :    60  144 FPS.
+	void RunFramePacing();
+
+	// BatchTransform  DirectXMath:     .
+	void RunBatchTransform();
+
+	// SceneGraph  1k/100k/1M :    , serial  parallel,
+	//         DirectXMath.
+	void RunSceneGraph();
+
+	// RenderWorld  1M : bounds, ,    
+	//        "   ".
+	void RunRenderWorld();
+
+	// SceneBvh  1M :   refit  , 
+	//    ,     .
+	void RunSpatialIndex();
+
+	// MeshSimplifier  ,    GeometryGenerator:  LOD,
+	//   ,     .
+	void RunSimplifier();
+
+	// Meshlets    :  ,     
+	//  frustum,    -    .
+	void RunMeshlets();
+
+	// GeometryGenerator: MeshData  span-    ParallelFor
+	//   4096x4096   8- .
+	void RunGeometry();
+
+	//   :     (   )
+	//      MeshData    span-.
+	void RunGeosphere();
+
+	// Terrain  heightfield 16385 x 16385      (
+	//   ):         
+	//   .
+	void RunTerrain();
+
+	//  DDS (BC7 16384 x 16384,    ):   
+	//          staging-.
+	void RunDds();
+
+	//  DdsFile:        
+	//   (BC, packed, planar, , 1D/3D);    footprint'
+	//      staging-.
+	void RunDdsFuzz();
+
+	// TextureStreamer: 2048  BC7  50k ,     
+	// (   )    .
+	void RunTextureStreaming();
+
+	//   72 PNG (    Sponza,  
+	//  )  job system:        staging,
+	//  PngFile  WIC   .
+	void RunTextureDecode();
+
+	//  - 8K x 8K  CPU (RGBA8, sRGB, RGBA16F, R32F; box  Kaiser):
+	//    AVX2  AVX2  job system,    TextureDecodeQueue.
+	void RunMipGeneration();
+
+	//   BC1/BC3/BC5/BC7  : MPix/s  PSNR    , 
+	//   AVX2   ,  ImportPng   .dds.
+	void RunBlockCompression();
+
+	// DescriptorAllocator:     (   fence) 
+	//     ,       1M .
+	void RunDescriptorAllocator();
+
+	// VirtualTexture:      feedback,   
+	//  64K x 64K: , , ,    .
+	void RunVirtualTexture();
+
+	// ShaderCache   :      include,
+	//    ,      .
+	void RunShaderCache();
+
+	// PipelineCache  PsoCache::HashDesc  :     
+	//  ,     ,   job system.
+	void RunPipelineCache();
+}
+
+#endif // BENCHMARKS_HPP
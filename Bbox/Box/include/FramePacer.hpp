@@ -0,0 +1,68 @@
+#ifndef FRAME_PACER_HPP
+#define FRAME_PACER_HPP
+
+#include <cstdint>
+
+//    FramePacer.  - SystemPacingClock,
+//    .
+struct IPacingClock {
+	virtual ~IPacingClock() = default;
+
+	virtual int64_t Now() = 0;
+	virtual int64_t Frequency() = 0;
+	virtual void SleepFor(double seconds) = 0;
+};
+
+class SystemPacingClock : public IPacingClock {
+public:
+	SystemPacingClock();
+	~SystemPacingClock() override;
+
+	SystemPacingClock(const SystemPacingClock&) = delete;
+	SystemPacingClock& operator=(const SystemPacingClock&) = delete;
+
+	int64_t Now() override;
+	int64_t Frequency() override;
+	void SleepFor(double seconds) override;
+
+private:
+	void* m_timer = nullptr;
+};
+
+//   :    ,  
+//  .      
+//  (sleep overshoot),     .
+class FramePacer {
+public:
+	explicit FramePacer(IPacingClock& clock);
+
+	// 0 -  .
+	void SetTargetFps(double fps);
+	double TargetFps() const { return m_targetFps; }
+
+	void Reset();
+
+	//     .     .
+	double WaitForNextFrame();
+
+	double SleepOvershoot() const { return m_sleepOvershoot; }
+	uint32_t MissedDeadlines() const { return m_missedDeadlines; }
+
+	//   ,    .
+	double MinSpinSeconds = 0.0002;
+
+	//      -  .
+	double MinSleepSeconds = 0.0005;
+
+private:
+	IPacingClock& m_clock;
+
+	double m_targetFps = 0.0;
+	int64_t m_period = 0;
+	int64_t m_nextDeadline = 0;
+
+	double m_sleepOvershoot = 0.001;
+	uint32_t m_missedDeadlines = 0;
+};
+
+#endif // FRAME_PACER_HPP
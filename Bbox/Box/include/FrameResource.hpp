@@ -0,0 +1,49 @@
+#ifndef FRAME_RESOURCE_HPP
+#define FRAME_RESOURCE_HPP
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include "Dx12Common.hpp"
+#include "UploadBuffer.hpp"
+#include "RenderStructs.hpp"
+
+// ,  CPU   ,  GPU   .
+//      GPU    Fence.
+struct FrameResource {
+	FrameResource(ID3D12Device* device, UINT objectCount, UINT instanceCount, UINT clusterDrawCount) {
+		ThrowIfFailed(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(CmdListAlloc.GetAddressOf())));
+
+		ObjectCB = std::make_unique<UploadBuffer<ObjectConstants>>(device, objectCount, true);
+		PassCB = std::make_unique<UploadBuffer<PassConstants>>(device, 1, true);
+
+		ObjectGenerations.assign(objectCount, 0);
+
+		//    ,    
+		InstanceBuffer = std::make_unique<UploadBuffer<InstanceData>>(device, (std::max)(instanceCount, 1u), false);
+		InstanceGenerations.assign(instanceCount, 0);
+
+		//  ExecuteIndirect    upload heap (GENERIC_READ  INDIRECT_ARGUMENT)
+		ClusterArgs = std::make_unique<UploadBuffer<D3D12_DRAW_INDEXED_ARGUMENTS>>(device, (std::max)(clusterDrawCount, 1u), false);
+	}
+
+	FrameResource(const FrameResource&) = delete;
+	FrameResource& operator=(const FrameResource&) = delete;
+
+	ComPtr<ID3D12CommandAllocator> CmdListAlloc;
+
+	std::unique_ptr<UploadBuffer<ObjectConstants>> ObjectCB;
+	std::unique_ptr<UploadBuffer<PassConstants>>   PassCB;
+	std::unique_ptr<UploadBuffer<InstanceData>>    InstanceBuffer;
+	std::unique_ptr<UploadBuffer<D3D12_DRAW_INDEXED_ARGUMENTS>> ClusterArgs;
+
+	//  (RenderWorld::Generations()   / pass),      .
+	// 0 -    .
+	std::vector<uint64_t> ObjectGenerations;
+	uint64_t PassGeneration = 0;
+	std::vector<uint64_t> InstanceGenerations;
+
+	UINT64 Fence = 0;
+};
+
+#endif // !FRAME_RESOURCE_HPP
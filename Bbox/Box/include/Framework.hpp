@@ -4,6 +4,7 @@
 #include <array>
 #include <string>
 #include <memory>
+#include <vector>
 #include <Windows.h>
 #include <windowsx.h>
 #include "Window.hpp"
@@ -11,12 +12,39 @@
 #include "Dx12Common.hpp"
 #include "UploadBuffer.hpp"
 #include "RenderStructs.hpp"
+#include "FrameResource.hpp"
+#include "RenderWorld.h"
+#include "MeshCache.hpp"
+#include "SceneGraph.h"
+#include "SceneBvh.h"
+#include "OcclusionBuffer.h"
+#include "FramePacer.hpp"
+#include "FrameStats.h"
+#include "DescriptorAllocator.h"
+#include "ShaderCache.h"
+#include "PsoCache.hpp"
+
+enum class PresentMode {
+	VSync,        // Present(1, 0)
+	Unthrottled,  // Present(0, ALLOW_TEARING),  
+	Capped,       // Present(0, ...) +  FPS  FramePacer
+	Count
+};
 
 class Framework : public IWindowMessageHandler {
 public:
 	explicit Framework(int width, int height, const wchar_t* title);
 	virtual ~Framework();
 
+	//   Init.
+	void SetStaticObjectCount(UINT count) { m_staticObjectCount = count; }
+	void SetConstantBenchmark(bool enabled) { m_benchmarkConstants = enabled; }
+	void SetInstancingBenchmark(bool enabled) { m_benchmarkInstancing = enabled; }
+	void SetDrawInstanced(bool enabled) { m_drawInstanced = enabled; }
+	void SetBindlessBenchmark(bool enabled) { m_benchmarkBindless = enabled; }
+	void SetShaderCacheBenchmark(bool enabled) { m_benchmarkShaderCache = enabled; }
+	void SetPsoCacheBenchmark(bool enabled) { m_benchmarkPsoCache = enabled; }
+
 	bool Init();
 	int Run();
 
@@ -27,6 +55,86 @@ protected:
 	virtual void OnResize();
 	virtual void Update(const double& dt);
 	virtual void Draw();
+	void UpdateFrameStatsHud();
+
+	void BeginFrame();
+	void SetPresentMode(PresentMode mode);
+	void ReportPacingStats() const;
+
+	void MarkInput() {
+		if (m_pendingInputTime == 0)
+			m_pendingInputTime = Clock::Now();
+
+		RequestRedraw();
+	}
+
+	//  idle-     RequestRedraw (, resize,  )
+	//      .
+	void RequestRedraw() { m_redrawPending = true; }
+	bool NeedsRedraw() const;
+
+	void WaitForWork();
+	void ReportIdleStats() const;
+
+	//    m_scene   World   .
+	void UpdateSceneGraph();
+
+	//  bounds,   frustum ( m_bvh    
+	// m_world)   ,     .
+	void CullAndBuildDrawList();
+
+	//  bounds    m_bvh: refit,   
+	//     - .
+	void UpdateBvh();
+	void ReportCullingStats() const;
+
+	//         (F8 -  /  LOD 0)
+	void SelectLods();
+	void ReportLodStats() const;
+
+	//    LOD 0:   frustum,    m_occlusion,
+	//      ExecuteIndirect (F9 -  / )
+	void CullClusters(const BatchTransform::Float4x4& viewProj);
+	void ReportClusterStats() const;
+
+	DirectX::XMMATRIX ViewProj() const;
+
+	//      /  
+	//   frame resource. forceAll -  ,  .
+	void UpdateObjectCBs(bool forceAll);
+	void UpdatePassCB(bool forceAll);
+	void MarkPassDirty() { ++m_passGeneration; }
+
+	void BenchmarkConstantUpdates(int iterations);
+	void ReportConstantStats() const;
+
+	// :     DrawIndexedInstanced,
+	//    StructuredBuffer  (JobSystem).
+	void UpdateInstanceBuffer(bool forceAll, bool parallel);
+	void BenchmarkInstancePacking(int iterations);
+	void ReportInstancingStats() const;
+
+	// :  MaterialData (t1)  bindless-    .
+	//   -    ,     MaterialData::DiffuseTexture.
+	UINT RegisterTexture(ID3D12Resource* texture);
+
+	//   :     
+	//    root-   
+	void BenchmarkMaterialBinding(int iterations);
+
+	//     ,     .
+	//   ( )   (  )
+	void BenchmarkShaderCache(int iterations);
+
+	// PSO  PsoCache:     ,  JobSystem,
+	//   PSO       
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC PhongPsoDesc(bool instanced) const;
+	// CreateGraphicsPipelineState        
+	void BenchmarkPsoCache(int iterations);
+
+	//       (Enabled)   :
+	//    instanced draw.
+	void ApplyDrawMode();
 
 	virtual void OnMouseDown(HWND hwnd, WPARAM btnState, int x, int y);
 	virtual void OnMouseUp(HWND hwnd, WPARAM btnState, int x, int y);
@@ -39,6 +147,8 @@ protected:
 	Timer m_timer;
 
 private:
+	double m_hudElapsed = 0.0;
+
 	int m_initWidth = 0;
 	int m_initHeight = 0;
 	const wchar_t* m_title = nullptr;
@@ -70,11 +180,141 @@ private:
 	UINT64 m_currentFence = 0;
 	HANDLE m_fenceEvent = nullptr;
 
-	static const int SwapChainBufferCount = 2;
+	static const int SwapChainBufferCount = 3;
+	static const int NumFrameResources = 3;
+	static const UINT MaxBindlessTextures = 4096;
 
 	ComPtr<IDXGISwapChain4> m_swapChain;
 	int m_currBackBuffer = 0;
 
+	bool m_tearingSupported = false;
+	UINT m_swapChainFlags = 0;
+	HANDLE m_frameLatencyWaitable = nullptr;
+	UINT m_maxFrameLatency = 2;
+
+	PresentMode m_presentMode = PresentMode::VSync;
+	double m_frameCapFps = 60.0;
+
+	SystemPacingClock m_pacingClock;
+	FramePacer m_pacer{ m_pacingClock };
+
+	//     (Clock::Now), 0 -   
+	int64_t m_pendingInputTime = 0;
+
+	struct PacingStats {
+		FrameStats Frame;
+		FrameStats InputToPresent;
+	};
+	std::array<PacingStats, static_cast<size_t>(PresentMode::Count)> m_pacingStats;
+
+	// --- Idle ---
+	bool m_idleRendering = true;
+	bool m_redrawPending = true;
+	bool m_idleTimerStopped = false;
+
+	//  :     ,   
+	//     BeginFrame/FlushCommandQueue
+	HANDLE m_idleFenceEvent = nullptr;
+
+	int64_t m_idleStartTime = 0;    //    (Clock::Now), 0 -  
+	double m_idleStartCpu = 0.0;
+	double m_idleWallSeconds = 0.0;
+	double m_idleCpuSeconds = 0.0;
+	uint32_t m_idleWaits = 0;
+
+	int64_t m_wakeTime = 0;         //   ,     Present
+	FrameStats m_resumeLatency;
+
+	// --- Scene / constants ---
+	//  : , , , bounds,  (. RenderWorld.h).
+	//   -     ObjectCB.
+	RenderWorld m_world;
+	MeshCache m_meshes;
+	std::vector<RenderWorld::DrawEntry> m_drawList;
+	uint32_t m_visibleCount = 0;
+	UINT m_objectSlots = 0; //  ObjectCB  ,   BuildFrameResources
+
+	//  ; World    
+	SceneGraph m_scene;
+	std::vector<RenderWorld::Entity> m_nodeEntities; // NodeId ->   InvalidEntity
+
+	//  bounds      (F7 - BVH /  )
+	SceneBvh m_bvh;
+	std::vector<RenderWorld::Entity> m_movedEntities; // SetWorld   UpdateBvh
+	std::vector<SceneBvh::ProxyId> m_bvhVisible;
+	bool m_cullWithBvh = true;
+	std::array<FrameStats, 2> m_cullTime; // [0] -  , [1] - BVH
+
+	// LOD:     ,   
+	std::vector<uint8_t> m_lodBySlot;
+	bool m_lodEnabled = true;
+	float m_lodPixelError = 1.0f;   //     , 
+	float m_lodHysteresis = 0.25f;
+	uint64_t m_lodTriangles = 0;    //     
+
+	//  :      -  
+	//   ClusterArgs  frame resource,    ,  m_drawList
+	struct ClusterDraw {
+		uint32_t Slot = 0;
+		UINT FirstArgument = 0;
+		UINT ArgumentCount = 0; // 0 -   
+	};
+	std::vector<ClusterDraw> m_clusterDraws;
+	std::vector<D3D12_DRAW_INDEXED_ARGUMENTS> m_clusterArgs;
+	UINT m_clusterArgCapacity = 0; //   ,   BuildFrameResources
+	bool m_clusterCulling = true;
+
+	//  LOD     
+	OcclusionBuffer m_occlusion;
+
+	struct ClusterStats {
+		uint64_t Frames = 0;
+		uint64_t Tested = 0;
+		uint64_t OutsideFrustum = 0;
+		uint64_t Backfacing = 0;
+		uint64_t Occluded = 0;
+		uint64_t Arguments = 0;
+		uint64_t Triangles = 0;       // 
+		uint64_t TestedTriangles = 0; //    
+		uint64_t OccluderTriangles = 0;
+		FrameStats Time;
+	};
+	ClusterStats m_clusterStats;
+	UINT m_staticObjectCount = 0;
+	bool m_benchmarkConstants = false;
+
+	uint64_t m_passGeneration = 1;
+
+	FrameStats m_constantUpdateTime;
+	uint64_t m_objectCBWrites = 0;
+	uint64_t m_passCBWrites = 0;
+	uint64_t m_constantUpdateFrames = 0;
+
+	// --- Instancing ---
+	struct InstanceBatch {
+		MeshCache::Handle Mesh = RenderWorld::InvalidMesh;
+
+		UINT FirstSlot = 0; //   [FirstSlot, FirstSlot + Count)
+		UINT Count = 0;
+	};
+	InstanceBatch m_instanceBatch;
+
+	static const uint32_t InstancePackGrain = 2048;
+
+	bool m_drawInstanced = false;
+	bool m_benchmarkInstancing = false;
+
+	struct DrawModeStats {
+		FrameStats Update;  //  /  
+		FrameStats Record;  //    command list
+		FrameStats Frame;
+	};
+	std::array<DrawModeStats, 2> m_drawModeStats; // [0] -  draw, [1] - 
+
+	std::array<std::unique_ptr<FrameResource>, NumFrameResources> m_frameResources;
+	FrameResource* m_currFrameResource = nullptr;
+	int m_currFrameResourceIndex = 0;
+
 	DXGI_FORMAT m_backBufferFormat = DXGI_FORMAT_R8G8B8A8_UNORM;
 
 	ComPtr<ID3D12DescriptorHeap> m_rtvHeap;
@@ -92,15 +332,38 @@ private:
 	D3D12_RECT m_scissorRect = {};
 
 	ComPtr<ID3DBlob> m_vsByteCode;
+	ComPtr<ID3DBlob> m_vsInstancedByteCode;
 	ComPtr<ID3DBlob> m_psByteCode;
+	bool m_benchmarkShaderCache = false;
+
+	//  shader-visible    CBV/SRV: [ ][CBV   ][CBV   ].
+	//   m_descriptors,     - m_textureSlots.
+	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_descriptorHeap;
+	DescriptorAllocator m_descriptors;
+	DescriptorAllocator m_textureSlots;
+	UINT m_textureTableOffset = 0;
+	UINT m_textureTableSize = 0; //   resource binding tier
+	UINT m_objectCbvOffset = 0;  // objectCount * NumFrameResources CBV 
+	UINT m_passCbvOffset = 0;    // NumFrameResources CBV 
 
-	std::unique_ptr<UploadBuffer<ObjectConstants>> m_objectCB;
-	std::unique_ptr<UploadBuffer<PassConstants>>   m_passCB;
+	//  0 -   ,    .mtl 
+	std::vector<MaterialData> m_materials;
+	std::unique_ptr<UploadBuffer<MaterialData>> m_materialBuffer;
 
-	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_cbvHeap;
+	//   1x1:       
+	ComPtr<ID3D12Resource> m_defaultTexture;
+	ComPtr<ID3D12Resource> m_defaultTextureUpload;
+	UINT m_defaultTextureIndex = 0;
+
+	bool m_benchmarkBindless = false;
 
 	ComPtr<ID3D12RootSignature> m_rootSignature;
 	ComPtr<ID3D12PipelineState> m_pso;
+	ComPtr<ID3D12PipelineState> m_instancedPso;
+	PsoCache m_psoCache;
+	uint64_t m_rootSignatureHash = 0; //  root signature,   PSO
+	bool m_benchmarkPsoCache = false;
+	ComPtr<ID3D12CommandSignature> m_drawIndexedSignature; // ExecuteIndirect  ClusterArgs
 
 	void InitDxgi();
 	void PickAdapter();
@@ -110,34 +373,30 @@ private:
 	void CreateCommandObjects();
 	void CreateFence();
 	void FlushCommandQueue();
+	void CheckTearingSupport();
 	void CreateSwapChain();
 	void BuildShaders();
-	void BuildConstantBuffers();
-	void BuildCbvHeap();
+	void BuildFrameResources();
+	void BuildDescriptorHeap();
 	void BuildCbvViews();
+	void BuildDefaultTexture();
+	void BuildMaterialBuffer();
 	void BuildRootSignature();
 	void BuildPSO();
+	void BuildCommandSignature();
+	void BuildMeshes();
 	void BuildObjVB_Upload();
+	void BuildRenderItems();
+	RenderWorld::Entity AddRenderable(SceneGraph::NodeId node, MeshCache::Handle mesh, uint32_t material);
 
 	void BuildBoxGeometry();
 
-	ComPtr<ID3D12Resource> m_boxVB;
-	ComPtr<ID3D12Resource> m_boxIB;
-
-	ComPtr<ID3D12Resource> m_boxVBUpload;
-	ComPtr<ID3D12Resource> m_boxIBUpload;
-
-	D3D12_VERTEX_BUFFER_VIEW m_boxVBView = {};
-	D3D12_INDEX_BUFFER_VIEW  m_boxIBView = {};
+	MeshCache::Handle m_boxMesh = RenderWorld::InvalidMesh;
+	MeshCache::Handle m_modelMesh = RenderWorld::InvalidMesh;
 
-	UINT m_boxIndexCount = 0;
-	
-	Microsoft::WRL::ComPtr<ID3D12Resource> m_modelVB;
-	D3D12_VERTEX_BUFFER_VIEW m_modelVBV{};
-	UINT m_modelVertexCount = 0;
+	//    m_scene:          ~2
+	SceneGraph::NodeId m_modelNode = SceneGraph::InvalidNode;
 
-	DirectX::XMFLOAT3 m_modelCenter = { 0.0f, 0.0f, 0.0f };
-	float m_modelScale = 1.0f;
 	std::array<bool, 256> m_keyDown{}; //  VK_*
 
 	float m_cameraMoveSpeed = 3.0f;   // units/sec,   
@@ -0,0 +1,83 @@
+#ifndef MESH_CACHE_HPP
+#define MESH_CACHE_HPP
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Dx12Common.hpp"
+#include "RenderStructs.hpp"
+#include "RenderWorld.h"
+#include "MeshSimplifier.h"
+#include "Meshlets.h"
+
+//   default heap.     MeshHandle ( RenderWorld),
+//     -   Add,    ComPtr- Framework.
+struct Mesh {
+	std::string Name;
+
+	ComPtr<ID3D12Resource> VertexBuffer;
+	ComPtr<ID3D12Resource> IndexBuffer; // nullptr -  
+
+	D3D12_VERTEX_BUFFER_VIEW VertexBufferView = {};
+	D3D12_INDEX_BUFFER_VIEW IndexBufferView = {};
+
+	UINT VertexCount = 0;
+	UINT IndexCount = 0;
+
+	RenderWorld::Aabb Bounds; //   
+
+	//  :   index buffer   vertex buffer.
+	// [0] -   (IndexCount );    .
+	std::vector<MeshSimplifier::LodLevel> Lods;
+
+	//  LOD 0 (Meshlets::Build)    .  LOD 0   
+	// :  i - TriangleCount * 3   Lods[0].FirstIndex + TriangleOffset * 3.
+	std::vector<Meshlets::Meshlet> Clusters;
+	std::vector<Meshlets::Bounds> ClusterBounds;
+
+	//  LOD  CPU -    OcclusionBuffer
+	std::vector<DirectX::XMFLOAT3> OccluderPositions;
+	std::vector<std::uint32_t> OccluderIndices;
+
+	bool Indexed() const { return IndexBuffer != nullptr; }
+};
+
+class MeshCache {
+public:
+	using Handle = RenderWorld::MeshHandle;
+
+	//    upload-  cmdList. Upload-  
+	// ReleaseUploads,      ,  GPU  .
+	Handle Add(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::string& name,
+		const std::vector<Vertex>& vertices, const std::vector<std::uint16_t>& indices);
+	Handle Add(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::string& name,
+		const std::vector<Vertex>& vertices, const std::vector<std::uint32_t>& indices);
+
+	//     LOD (MeshSimplifier::BuildLodChain),  LOD 0  
+	// ,     .
+	Handle AddWithLods(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::string& name,
+		const std::vector<Vertex>& vertices, const std::vector<std::uint32_t>& indices,
+		const MeshSimplifier::LodOptions& options);
+
+	void ReleaseUploads() { m_uploads.clear(); }
+
+	// RenderWorld::InvalidMesh,   .
+	Handle Find(const std::string& name) const;
+
+	const Mesh& Get(Handle handle) const { return m_meshes[handle]; }
+	size_t Count() const { return m_meshes.size(); }
+
+private:
+	Handle AddImpl(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::string& name,
+		const std::vector<Vertex>& vertices, const void* indices, UINT indexCount, DXGI_FORMAT indexFormat);
+
+	ComPtr<ID3D12Resource> CreateBuffer(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList,
+		const void* data, UINT64 byteSize, D3D12_RESOURCE_STATES finalState);
+
+	std::vector<Mesh> m_meshes;
+	std::unordered_map<std::string, Handle> m_byName;
+	std::vector<ComPtr<ID3D12Resource>> m_uploads;
+};
+
+#endif // !MESH_CACHE_HPP
@@ -0,0 +1,75 @@
+#ifndef PSO_CACHE_HPP
+#define PSO_CACHE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Dx12Common.hpp"
+#include "PipelineCache.h"
+
+//  PSO  PipelineCache:  -   D3D12_GRAPHICS_PIPELINE_STATE_DESC,
+//     handle,    JobSystem.  
+// PSO   ID3D12PipelineLibrary      ,   
+//   LoadGraphicsPipeline     .
+class PsoCache {
+public:
+	using Handle = PipelineCache::Handle;
+
+	struct Stats {
+		PipelineCache::Stats Builds;
+		bool LibraryLoaded = false;   //    
+		uint32_t LibraryHits = 0;     //   
+		uint32_t LibraryStores = 0;   //     
+		uint64_t LibraryBytes = 0;    //   
+	};
+
+	PsoCache() = default;
+	~PsoCache();
+
+	PsoCache(const PsoCache&) = delete;
+	PsoCache& operator=(const PsoCache&) = delete;
+
+	//   -  .       
+	//  :   .  ID3D12Device1 PSO  .
+	void Init(ID3D12Device* device, const std::string& libraryPath);
+
+	//  ,    : ,   layout, .
+	// Root signature      -    .
+	static uint64_t HashDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash);
+
+	//    (, layout, stream output),  
+	//  . CachedPSO  :    .
+	Handle Request(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash, bool async = true);
+
+	//   (  ,     ); ,  PSO  .
+	ID3D12PipelineState* Get(Handle handle);
+	// nullptr,  PSO  -       .
+	ID3D12PipelineState* TryGet(Handle handle) const;
+
+	//      ,      PSO.
+	void Save();
+
+	Stats GetStats() const;
+
+private:
+	struct Pipeline;
+
+	void Build(Pipeline& pipeline);
+
+	ComPtr<ID3D12Device> m_device;
+	ComPtr<ID3D12PipelineLibrary> m_library;
+	std::vector<uint8_t> m_libraryData; //        
+	std::string m_libraryPath;
+	bool m_libraryLoaded = false;
+
+	std::vector<std::shared_ptr<Pipeline>> m_pipelines; //  handle
+	std::atomic<uint32_t> m_libraryHits{ 0 };
+	std::atomic<uint32_t> m_libraryStores{ 0 };
+	uint32_t m_savedStores = 0;
+
+	PipelineCache m_cache; // :  ,  
+};
+
+#endif // PSO_CACHE_HPP
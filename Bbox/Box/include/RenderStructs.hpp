@@ -40,6 +40,24 @@ struct alignas(16) PassConstants {
 	DirectX::XMFLOAT3 _pad2 = { 0.0f, 0.0f, 0.0f };
 };
 
+//  StructuredBuffer   (t0):    ObjectConstants,
+//   -   draw   root-.
+struct InstanceData {
+	DirectX::XMFLOAT4X4 World = dx::Identity4x4();
+	DirectX::XMFLOAT4X4 WorldInvTranspose = dx::Identity4x4();
+	uint32_t Material = 0;
+	uint32_t _pad[3] = { 0, 0, 0 };
+};
+
+//    (StructuredBuffer t1),  -    RenderWorld.
+struct MaterialData {
+	DirectX::XMFLOAT4 DiffuseAlbedo = { 1.0f, 1.0f, 1.0f, 1.0f };
+	uint32_t DiffuseTexture = 0; //   bindless-  (space1)
+	uint32_t _pad[3] = { 0, 0, 0 };
+};
+
 static_assert(sizeof(ObjectConstants) % 16 == 0, "ObjectConstants must be 16-byte aligned sized.");
 static_assert(sizeof(PassConstants) % 16 == 0, "PassConstants must be 16-byte aligned sized.");
+static_assert(sizeof(InstanceData) % 16 == 0, "InstanceData stride must stay a multiple of 16 bytes.");
+static_assert(sizeof(MaterialData) % 16 == 0, "MaterialData stride must stay a multiple of 16 bytes.");
 #endif // !RENDER_STRUCTS_HPP
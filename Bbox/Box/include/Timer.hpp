@@ -2,7 +2,8 @@
 #define TIMER_HPP
 
 #include <cstdint>
-#include <Windows.h>
+#include "Clock.h"
+#include "FrameStats.h"
 
 class Timer {
 public:
@@ -10,6 +11,9 @@ public:
 
 	double TotalTime() const;
 	double DeltaTime() const;
+	double SmoothedDeltaTime() const;
+
+	const FrameStats& Stats() const { return m_stats; }
 
 	void Reset();
 	void Start();
@@ -27,6 +31,8 @@ private:
 	int64_t m_currTime = 0;
 
 	bool m_stopped = false;
+
+	FrameStats m_stats;
 };
 
 #endif // TIMER_HPP
@@ -15,6 +15,10 @@ public:
 
 	bool ProcessMessages();
 
+	//          handles.
+	// WAIT_OBJECT_0 + i -  handles[i], WAIT_OBJECT_0 + count -  .
+	DWORD WaitForMessages(const HANDLE* handles, DWORD count, DWORD timeoutMs) const;
+
 	HWND GetHWND() const;
 
 
@@ -4,6 +4,35 @@ cbuffer ObjectCB : register(b0)
     float4x4 gWorldInvTranspose;
 };
 
+// :    SV_InstanceID,    ObjectCB
+struct InstanceData
+{
+    float4x4 World;
+    float4x4 WorldInvTranspose;
+    uint Material;
+    uint3 _pad;
+};
+
+StructuredBuffer<InstanceData> gInstanceData : register(t0);
+
+//   draw - root-:     
+cbuffer DrawCB : register(b2)
+{
+    uint gMaterialIndex;
+};
+
+struct MaterialData
+{
+    float4 DiffuseAlbedo;
+    uint DiffuseTexture;
+    uint3 _pad;
+};
+
+StructuredBuffer<MaterialData> gMaterials : register(t1);
+
+// Bindless-:      ,    
+Texture2D gTextures[] : register(t0, space1);
+
 cbuffer PassCB : register(b1)
 {
     float4x4 gViewProj;
@@ -35,31 +64,53 @@ struct VertexOut
     float3 PosW : TEXCOORD0;
     float3 NormalW : NORMAL;
     float4 Color : COLOR;
+    nointerpolation uint Material : MATERIAL;
 };
 
-VertexOut VS(VertexIn vin)
+VertexOut TransformVertex(VertexIn vin, float4x4 world, float4x4 worldInvTranspose, uint material)
 {
     VertexOut vout;
     
-    float4 posW = mul(float4(vin.PosL, 1.0f), gWorld);
+    float4 posW = mul(float4(vin.PosL, 1.0f), world);
     vout.PosW = posW.xyz;
     
-    vout.NormalW = mul(vin.NormalL, (float3x3) gWorldInvTranspose);
+    vout.NormalW = mul(vin.NormalL, (float3x3) worldInvTranspose);
     
     vout.PosH = mul(posW, gViewProj);
 
     vout.Color = vin.Color;
+    vout.Material = material;
     
     return vout;
 }
 
+VertexOut VS(VertexIn vin)
+{
+    return TransformVertex(vin, gWorld, gWorldInvTranspose, gMaterialIndex);
+}
+
+VertexOut VSInstanced(VertexIn vin, uint instanceID : SV_InstanceID)
+{
+    InstanceData inst = gInstanceData[instanceID];
+    return TransformVertex(vin, inst.World, inst.WorldInvTranspose, inst.Material);
+}
+
 float4 PS(VertexOut pin) : SV_Target
 {
     float3 N = normalize(pin.NormalW);
     float3 L = normalize(-gLightDirW);
     float3 V = normalize(gEyePosW - pin.PosW);
 
-    float3 base = pin.Color.rgb;
+    //      draw,  NonUniformResourceIndex.
+    //     UV,       -  .
+    MaterialData mat = gMaterials[pin.Material];
+    Texture2D diffuseMap = gTextures[NonUniformResourceIndex(mat.DiffuseTexture)];
+
+    uint width, height, mipCount;
+    diffuseMap.GetDimensions(0, width, height, mipCount);
+    float4 texel = diffuseMap.Load(int3(0, 0, mipCount - 1));
+
+    float3 base = pin.Color.rgb * mat.DiffuseAlbedo.rgb * texel.rgb;
 
     float ndotl = saturate(dot(N, L));
 
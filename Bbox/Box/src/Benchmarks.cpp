@@ -0,0 +1,3406 @@
+#include "Benchmarks.hpp"
+#include "FramePacer.hpp"
+#include "BatchTransform.h"
+#include "JobSystem.h"
+#include "SceneGraph.h"
+#include "RenderWorld.h"
+#include "SceneBvh.h"
+#include "MeshSimplifier.h"
+#include "Meshlets.h"
+#include "OcclusionBuffer.h"
+#include "GeometryGenerator.h"
+#include "Terrain.h"
+#include "DdsFile.h"
+#include "TextureStreamer.h"
+#include "PngFile.h"
+#include "TextureDecodeQueue.h"
+#include "MipGenerator.h"
+#include "BcEncoder.h"
+#include "DescriptorAllocator.h"
+#include "VirtualTexture.h"
+#include "ShaderCache.h"
+#include "PipelineCache.h"
+#include "PsoCache.hpp"
+#include "Clock.h"
+#include "FrameStats.h"
+#include "Profiler.h"
+
+#include <Windows.h>
+#include <DirectXMath.h>
+#include <DirectXPackedVector.h>
+#include <dxgiformat.h>
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace DirectX;
+
+namespace {
+	void Report(const char* text) {
+		OutputDebugStringA(text);
+	}
+
+	//   :     FAILED   
+	void Expect(bool condition, const char* what, uint32_t& failures) {
+		if (condition)
+			return;
+
+		char report[256];
+		snprintf(report, sizeof(report), "  FAILED: %s\n", what);
+		Report(report);
+		++failures;
+	}
+
+	//       size x size, 
+	//   (   1).      3x3:
+	//    4-       4x4.
+	double MaxError(const std::vector<BatchTransform::Float4x4>& a, const std::vector<XMFLOAT4X4>& reference, int size) {
+		double maxError = 0.0;
+
+		for (size_t i = 0; i < a.size(); ++i) {
+			for (int r = 0; r < size; ++r) {
+				for (int c = 0; c < size; ++c) {
+					const double ref = reference[i].m[r][c];
+					const double err = std::fabs(a[i].m[r][c] - ref) / (std::max)(1.0, std::fabs(ref));
+					maxError = (std::max)(maxError, err);
+				}
+			}
+		}
+
+		return maxError;
+	}
+
+	template<typename Fn>
+	double Milliseconds(int iterations, Fn&& fn) {
+		const int64_t start = Clock::Now();
+		for (int i = 0; i < iterations; ++i)
+			fn();
+		return Clock::ToSeconds(Clock::Now() - start) * 1000.0 / iterations;
+	}
+
+	template<typename Fn>
+	double MatricesPerSecond(uint32_t count, int iterations, Fn&& fn) {
+		const int64_t start = Clock::Now();
+		for (int i = 0; i < iterations; ++i)
+			fn();
+		const double seconds = Clock::ToSeconds(Clock::Now() - start);
+
+		return seconds > 0.0 ? static_cast<double>(count) * iterations / seconds : 0.0;
+	}
+}
+
+void Benchmarks::RunProfiler() {
+	char report[256];
+	uint32_t failures = 0;
+
+	const bool wasEnabled = Profiler::IsEnabled();
+
+	// 1)   :   TSC    ,    
+	const int zones = 1 << 22;
+	volatile uint32_t sink = 0;
+	auto loop = [&](bool zone) {
+		for (int i = 0; i < zones; ++i) {
+			if (zone) {
+				PROFILE_ZONE("Benchmarks::EmptyZone");
+				sink = sink + 1;
+			}
+			else {
+				sink = sink + 1;
+			}
+		}
+	};
+
+	const double baseMs = Milliseconds(3, [&]() { loop(false); });
+	Profiler::SetEnabled(true);
+	const double enabledMs = Milliseconds(3, [&]() { loop(true); });
+	Profiler::SetEnabled(false);
+	const double disabledMs = Milliseconds(3, [&]() { loop(true); });
+	Profiler::SetEnabled(wasEnabled);
+
+	//  TSC :       ,   
+	uint64_t ticks = 0;
+	const double timestampMs = Milliseconds(3, [&]() {
+		for (int i = 0; i < zones; ++i)
+			ticks += Profiler::Now();
+	});
+	sink = static_cast<uint32_t>(ticks);
+
+	const double zoneNs = (enabledMs - baseMs) * 1e6 / zones;
+	const double disabledNs = (disabledMs - baseMs) * 1e6 / zones;
+	const double timestampNs = timestampMs * 1e6 / zones;
+	Expect(zoneNs < 50.0, "empty zone under 50 ns", failures);
+
+	// 2)  ,        :  
+	//    . ,      ( -  = 
+	// ),   ,    ,  
+	static const char* const names[8] = {
+		"Benchmarks::Zone0", "Benchmarks::Zone1", "Benchmarks::Zone2", "Benchmarks::Zone3",
+		"Benchmarks::Zone4", "Benchmarks::Zone5", "Benchmarks::Zone6", "Benchmarks::Zone7"
+	};
+	static const char* const writerNames[2] = { "Profiler writer 0", "Profiler writer 1" };
+
+	std::atomic<bool> stop{ false };
+	std::vector<std::thread> writers;
+	for (int w = 0; w < 2; ++w) {
+		writers.emplace_back([&, w]() {
+			Profiler::SetThreadName(writerNames[w]);
+			for (uint64_t n = 1; !stop.load(std::memory_order_relaxed); ++n)
+				Profiler::Record(names[n & 7], n * 8, n * 8 + (n & 7));
+		});
+	}
+
+	std::vector<Profiler::ThreadEvents> threads;
+	uint64_t checked = 0, torn = 0, unordered = 0;
+	uint32_t snapshots = 0;
+	double snapshotMs = 0.0;
+	const int64_t start = Clock::Now();
+
+	while (Clock::ToSeconds(Clock::Now() - start) < 0.5) {
+		snapshotMs += Milliseconds(1, [&]() { Profiler::Snapshot(threads); });
+		++snapshots;
+
+		for (const Profiler::ThreadEvents& thread : threads) {
+			if (thread.Name != writerNames[0] && thread.Name != writerNames[1])
+				continue;
+
+			uint64_t last = 0;
+			for (const Profiler::ZoneEvent& e : thread.Events) {
+				const uint64_t n = e.Begin / 8;
+				torn += e.Begin % 8 != 0 || e.Name != names[n & 7] || e.End != e.Begin + (n & 7);
+				unordered += e.Begin <= last;
+				last = e.Begin;
+				++checked;
+			}
+		}
+	}
+
+	stop = true;
+	for (std::thread& writer : writers)
+		writer.join();
+
+	Expect(checked > 0, "snapshots hold the writers' events", failures);
+	Expect(torn == 0, "no torn events in snapshots", failures);
+	Expect(unordered == 0, "snapshot events in recording order", failures);
+
+	snprintf(report, sizeof(report),
+		"[Profiler] empty zone %.1f ns (disabled %.1f ns, one timestamp %.1f ns), %u snapshots under 2 writers (%.2f ms each), %llu events checked, %u failures\n",
+		zoneNs, disabledNs, timestampNs, snapshots, snapshotMs / (std::max)(snapshots, 1u),
+		static_cast<unsigned long long>(checked), failures);
+	Report(report);
+}
+
+void Benchmarks::RunFrameStats() {
+	char report[256];
+	uint32_t failures = 0;
+
+	// 1)   ,     float:   , 
+	//     
+	FrameStats stats;
+	for (uint32_t i = 0; i < 2 * FrameStats::WindowSize; ++i)
+		stats.AddSample(0.0167);
+
+	const FrameStats::Summary steady = stats.Summarize();
+	Expect(stats.Validate(), "constant 16.7 ms: histogram and sum match the window", failures);
+	Expect(steady.SampleCount == FrameStats::WindowSize, "constant 16.7 ms: window full", failures);
+	Expect(steady.P50Ms == steady.P99Ms && steady.P50Ms >= 16.7 && steady.P50Ms <= 16.7 + FrameStats::BucketWidthMs + 1e-9,
+		"constant 16.7 ms: percentiles in its bucket", failures);
+	Expect(std::fabs(steady.AverageMs - 16.7) < 1e-3, "constant 16.7 ms: average", failures);
+
+	// 2)           .
+	//    -       
+	std::mt19937 rng(27);
+	std::uniform_int_distribution<int> micro(1000, 40000);
+	stats.Reset();
+
+	bool valid = true, percentiles = true;
+	std::vector<float> window;
+	const uint32_t samples = 20 * FrameStats::WindowSize;
+	for (uint32_t i = 0; i < samples; ++i) {
+		const double ms = rng() % 200 == 0 ? 150.0 + micro(rng) * 1e-3 : micro(rng) * 1e-3;
+		stats.AddSample(ms * 1e-3);
+		valid = valid && stats.Validate();
+
+		window.push_back(static_cast<float>(ms));
+		if (window.size() > FrameStats::WindowSize)
+			window.erase(window.begin());
+
+		if (i % 97 == 0) {
+			std::vector<float> sorted = window;
+			std::sort(sorted.begin(), sorted.end());
+			for (double fraction : { 0.5, 0.95 }) {
+				const size_t rank = (std::max)(size_t(1), (std::min)(sorted.size(), size_t(fraction * sorted.size() + 0.5)));
+				const double exact = sorted[rank - 1];
+				const double p = stats.Percentile(fraction);
+				percentiles = percentiles && exact <= p + 1e-9 && p <= exact + FrameStats::BucketWidthMs + 1e-9;
+			}
+		}
+	}
+	Expect(valid, "random times: histogram and sum match the window after every sample", failures);
+	Expect(percentiles, "random times: p50 and p95 within one bucket of the exact value", failures);
+
+	// 3)  AddSample  Summarize
+	const uint32_t adds = 1u << 20;
+	const double addMs = Milliseconds(1, [&]() {
+		for (uint32_t i = 0; i < adds; ++i)
+			stats.AddSample(0.0167 + (i & 63) * 1e-5);
+	});
+	FrameStats::Summary summary;
+	const double summarizeMs = Milliseconds(1000, [&]() { summary = stats.Summarize(); });
+
+	snprintf(report, sizeof(report),
+		"[FrameStats] AddSample %.1f ns, Summarize %.2f us (window %u, p50 %.1f ms); check: %u samples, %u failures\n",
+		addMs * 1e6 / adds, summarizeMs * 1000.0, FrameStats::WindowSize, summary.P50Ms, samples, failures);
+	Report(report);
+}
+
+namespace {
+	//    FramePacer:  Now()  CallTicks ( 
+	// ), SleepFor     Overshoot
+	class FakePacingClock : public IPacingClock {
+	public:
+		static constexpr int64_t TicksPerSecond = 10000000;
+
+		int64_t Now() override {
+			m_time += CallTicks;
+			m_spinTicks += CallTicks;
+			return m_time;
+		}
+
+		int64_t Frequency() override { return TicksPerSecond; }
+
+		void SleepFor(double seconds) override {
+			m_time += static_cast<int64_t>((seconds + Overshoot) * TicksPerSecond);
+		}
+
+		//    
+		void Work(double seconds) { m_time += static_cast<int64_t>(seconds * TicksPerSecond); }
+
+		int64_t Time() const { return m_time; }
+		int64_t SpinTicks() const { return m_spinTicks; }
+
+		int64_t CallTicks = 20;
+		double Overshoot = 0.0;
+
+	private:
+		int64_t m_time = 0;
+		int64_t m_spinTicks = 0;
+	};
+}
+
+void Benchmarks::RunFramePacing() {
+	char report[256];
+	uint32_t failures = 0;
+
+	// 1)  , 100 FPS:  2  (  ), 
+	// 3 .   60 -  35  (  ),  90 - 13  (
+	//  ),  120    (0.5 )
+	{
+		FakePacingClock clock;
+		clock.Overshoot = 0.002;
+
+		FramePacer pacer(clock);
+		Expect(pacer.WaitForNextFrame() == 0.0 && clock.Time() == 0, "no target: no wait", failures);
+
+		pacer.SetTargetFps(100.0);
+		const int64_t period = FakePacingClock::TicksPerSecond / 100;
+		const int64_t tolerance = 4 * clock.CallTicks;
+		const int frames = 180, warmup = 10, hitch = 60, late = 90, sharper = 120;
+
+		std::vector<int64_t> start(frames), spin(frames);
+		for (int frame = 0; frame < frames; ++frame) {
+			if (frame == sharper)
+				clock.Overshoot = 0.0005;
+
+			const int64_t spinBefore = clock.SpinTicks();
+			pacer.WaitForNextFrame();
+			spin[frame] = clock.SpinTicks() - spinBefore;
+			start[frame] = clock.Time();
+
+			clock.Work(frame == hitch ? 0.035 : frame == late ? 0.013 : 0.003);
+
+			if (frame == hitch)
+				Expect(pacer.MissedDeadlines() == 0, "no missed deadlines before the long frame", failures);
+		}
+
+		auto onTime = [&](int frame) { return std::llabs(start[frame] - start[frame - 1] - period) <= tolerance; };
+
+		bool steady = true;
+		int64_t worstSpin = 0;
+		for (int frame = warmup; frame < frames; ++frame) {
+			if (frame == hitch + 1 || frame == late + 1 || frame == late + 2)
+				continue;
+			steady &= onTime(frame);
+			if (frame < sharper)
+				worstSpin = (std::max)(worstSpin, spin[frame]);
+		}
+		Expect(steady, "frames start one interval apart once the overshoot is learned", failures);
+		Expect(worstSpin <= static_cast<int64_t>((pacer.MinSpinSeconds + 0.0001) * FakePacingClock::TicksPerSecond),
+			"the wait is slept, only the margin is spun", failures);
+
+		//  :   ,     ,
+		//     ""
+		Expect(start[hitch + 1] - start[hitch] - static_cast<int64_t>(0.035 * FakePacingClock::TicksPerSecond) <= tolerance,
+			"long frame: next frame starts without waiting", failures);
+		Expect(onTime(hitch + 2), "long frame: interval restored on the next frame", failures);
+		Expect(pacer.MissedDeadlines() == 1, "long frame: one missed deadline, nothing else", failures);
+
+		//   :  ,   
+		Expect(std::llabs(start[late + 2] - start[late] - 2 * period) <= tolerance, "late frame: phase kept", failures);
+
+		Expect(pacer.SleepOvershoot() < 0.002, "overshoot estimate follows a sharper sleep down", failures);
+
+		snprintf(report, sizeof(report),
+			"[FramePacer] check: simulated 100 FPS, %d frames, worst spin %.3f ms, missed %u, overshoot estimate %.3f ms, %u failures\n",
+			frames, worstSpin * 1000.0 / FakePacingClock::TicksPerSecond, pacer.MissedDeadlines(), pacer.SleepOvershoot() * 1000.0, failures);
+		Report(report);
+	}
+
+	// 2)  :     2  (  )
+	for (double fps : { 60.0, 144.0 }) {
+		SystemPacingClock clock;
+		FramePacer pacer(clock);
+		pacer.SetTargetFps(fps);
+
+		const int frames = static_cast<int>(fps);
+		std::vector<double> errorsMs;
+		double waited = 0.0;
+		int64_t last = 0;
+
+		for (int frame = 0; frame <= frames; ++frame) {
+			waited += pacer.WaitForNextFrame();
+			const int64_t now = Clock::Now();
+			if (frame > 0)
+				errorsMs.push_back(std::fabs(Clock::ToSeconds(now - last) - 1.0 / fps) * 1000.0);
+			last = now;
+
+			while (Clock::ToSeconds(Clock::Now() - now) < 0.002) {
+			}
+		}
+
+		std::sort(errorsMs.begin(), errorsMs.end());
+		snprintf(report, sizeof(report),
+			"  real clock %3.0f FPS: interval error p50 %.3f ms p99 %.3f ms max %.3f ms; waited %.1f%%, overshoot estimate %.3f ms, missed %u\n",
+			fps, errorsMs[errorsMs.size() / 2], errorsMs[errorsMs.size() * 99 / 100], errorsMs.back(),
+			100.0 * waited / (frames / fps), pacer.SleepOvershoot() * 1000.0, pacer.MissedDeadlines());
+		Report(report);
+	}
+}
+
+void Benchmarks::RunBatchTransform() {
+	const uint32_t count = 1u << 18;
+	const int iterations = 10;
+
+	//  TRS,     
+	std::mt19937 rng(42);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> scale(0.1f, 4.0f);
+
+	std::vector<float> tx(count), ty(count), tz(count);
+	std::vector<float> qx(count), qy(count), qz(count), qw(count);
+	std::vector<float> sx(count), sy(count), sz(count);
+
+	for (uint32_t i = 0; i < count; ++i) {
+		tx[i] = 100.0f * unit(rng);
+		ty[i] = 100.0f * unit(rng);
+		tz[i] = 100.0f * unit(rng);
+
+		XMFLOAT4 q;
+		XMStoreFloat4(&q, XMQuaternionNormalize(XMVectorSet(unit(rng), unit(rng), unit(rng), unit(rng))));
+		qx[i] = q.x; qy[i] = q.y; qz[i] = q.z; qw[i] = q.w;
+
+		sx[i] = scale(rng);
+		const bool uniform = i % 3 == 0;
+		sy[i] = uniform ? sx[i] : scale(rng);
+		sz[i] = uniform ? sx[i] : scale(rng);
+	}
+
+	const BatchTransform::TRSArrays trs = {
+		tx.data(), ty.data(), tz.data(),
+		qx.data(), qy.data(), qz.data(), qw.data(),
+		sx.data(), sy.data(), sz.data()
+	};
+
+	// : ,    Framework::Update -  4x4 XMMatrixInverse
+	std::vector<XMFLOAT4X4> refWorld(count), refNormal(count);
+
+	auto directXMath = [&]() {
+		for (uint32_t i = 0; i < count; ++i) {
+			XMMATRIX world =
+				XMMatrixScaling(sx[i], sy[i], sz[i]) *
+				XMMatrixRotationQuaternion(XMVectorSet(qx[i], qy[i], qz[i], qw[i])) *
+				XMMatrixTranslation(tx[i], ty[i], tz[i]);
+
+			XMStoreFloat4x4(&refWorld[i], world);
+			XMStoreFloat4x4(&refNormal[i], XMMatrixTranspose(XMMatrixInverse(nullptr, world)));
+		}
+	};
+
+	std::vector<BatchTransform::Float4x4> world(count), normal(count), affineNormal(count);
+
+	auto batch = [&]() {
+		BatchTransform::ComposeTRS(trs, 0, count, world.data(), normal.data());
+	};
+
+	auto batchParallel = [&]() {
+		JobSystem::ParallelFor(count, 16384, [&](uint32_t begin, uint32_t end) {
+			BatchTransform::ComposeTRS(trs, begin, end, world.data(), normal.data());
+		});
+	};
+
+	const double xmRate = MatricesPerSecond(count, iterations, directXMath);
+
+	BatchTransform::SetAvx2Enabled(false);
+	const double scalarRate = MatricesPerSecond(count, iterations, batch);
+	const double scalarWorldError = MaxError(world, refWorld, 4);
+	const double scalarNormalError = MaxError(normal, refNormal, 3);
+
+	BatchTransform::SetAvx2Enabled(true);
+	const bool avx2 = BatchTransform::UsesAvx2();
+	const double simdRate = MatricesPerSecond(count, iterations, batch);
+	const double simdWorldError = MaxError(world, refWorld, 4);
+	const double simdNormalError = MaxError(normal, refNormal, 3);
+
+	const double parallelRate = MatricesPerSecond(count, iterations, batchParallel);
+
+	//  3x3    ( RenderWorld::Worlds)
+	const double affineRate = MatricesPerSecond(count, iterations, [&]() {
+		BatchTransform::AffineInverseTranspose(
+			reinterpret_cast<const BatchTransform::Float4x4*>(refWorld.data()), count, affineNormal.data());
+	});
+	const double affineError = MaxError(affineNormal, refNormal, 3);
+
+	char report[512];
+	snprintf(report, sizeof(report),
+		"[BatchTransform] %u TRS -> world + normal, %s\n"
+		"  DirectXMath (4x4 inverse)  %7.1f M/s\n"
+		"  scalar                     %7.1f M/s  max err world %.2e normal %.2e\n"
+		"  SIMD                       %7.1f M/s  max err world %.2e normal %.2e\n"
+		"  SIMD + %2u workers          %7.1f M/s\n"
+		"  affine 3x3 inverse only    %7.1f M/s  max err normal %.2e\n",
+		count, avx2 ? "AVX2" : "no AVX2, SIMD = scalar",
+		xmRate * 1e-6,
+		scalarRate * 1e-6, scalarWorldError, scalarNormalError,
+		simdRate * 1e-6, simdWorldError, simdNormalError,
+		JobSystem::WorkerCount(), parallelRate * 1e-6,
+		affineRate * 1e-6, affineError);
+	Report(report);
+
+	//      float (~1e-6  world, ~1e-5    
+	// 0.1);      
+	const double tolerance = 1e-4;
+	uint32_t failures = 0;
+
+	Expect(scalarWorldError <= tolerance, "scalar world within tolerance", failures);
+	Expect(scalarNormalError <= tolerance, "scalar normal within tolerance", failures);
+	Expect(simdWorldError <= tolerance, "SIMD world within tolerance", failures);
+	Expect(simdNormalError <= tolerance, "SIMD normal within tolerance", failures);
+	Expect(affineError <= tolerance, "affine inverse within tolerance", failures);
+
+	snprintf(report, sizeof(report), "[BatchTransform] check: max error %.0e, %u failures\n", tolerance, failures);
+	Report(report);
+}
+
+void Benchmarks::RunSceneGraph() {
+	const uint32_t sizes[] = { 1000u, 100000u, 1000000u };
+
+	for (uint32_t count : sizes) {
+		const int iterations = count >= 1000000u ? 5 : 20;
+
+		//  :  -     ,  
+		// 1000- ( ).     depth-first,  
+		//  Update   .
+		std::mt19937 rng(count);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		std::uniform_real_distribution<float> scale(0.5f, 1.5f);
+
+		std::vector<uint32_t> parents(count);
+		std::vector<SceneGraph::Transform> locals(count);
+
+		for (uint32_t i = 0; i < count; ++i) {
+			parents[i] = (i % 1000 == 0) ? SceneGraph::InvalidNode : static_cast<uint32_t>(rng() % i);
+
+			SceneGraph::Transform& t = locals[i];
+			t.Translation[0] = unit(rng);
+			t.Translation[1] = unit(rng);
+			t.Translation[2] = unit(rng);
+
+			XMFLOAT4 q;
+			XMStoreFloat4(&q, XMQuaternionNormalize(XMVectorSet(unit(rng), unit(rng), unit(rng), unit(rng))));
+			t.Rotation[0] = q.x; t.Rotation[1] = q.y; t.Rotation[2] = q.z; t.Rotation[3] = q.w;
+
+			t.Scale[0] = t.Scale[1] = t.Scale[2] = scale(rng);
+		}
+
+		// : -   ,   , DirectXMath
+		std::vector<std::vector<uint32_t>> children(count);
+		std::vector<uint32_t> roots;
+		for (uint32_t i = 0; i < count; ++i) {
+			if (parents[i] == SceneGraph::InvalidNode)
+				roots.push_back(i);
+			else
+				children[parents[i]].push_back(i);
+		}
+
+		std::vector<XMFLOAT4X4> refWorld(count);
+		std::vector<uint32_t> stack;
+
+		auto pointerTree = [&]() {
+			for (uint32_t root : roots) {
+				stack.push_back(root);
+
+				while (!stack.empty()) {
+					const uint32_t i = stack.back();
+					stack.pop_back();
+
+					const SceneGraph::Transform& t = locals[i];
+					XMMATRIX world =
+						XMMatrixScaling(t.Scale[0], t.Scale[1], t.Scale[2]) *
+						XMMatrixRotationQuaternion(XMVectorSet(t.Rotation[0], t.Rotation[1], t.Rotation[2], t.Rotation[3])) *
+						XMMatrixTranslation(t.Translation[0], t.Translation[1], t.Translation[2]);
+
+					if (parents[i] != SceneGraph::InvalidNode)
+						world = world * XMLoadFloat4x4(&refWorld[parents[i]]);
+
+					XMStoreFloat4x4(&refWorld[i], world);
+
+					for (uint32_t c : children[i])
+						stack.push_back(c);
+				}
+			}
+		};
+
+		SceneGraph scene;
+		const double buildMs = Milliseconds(1, [&]() {
+			scene.Reserve(count);
+			for (uint32_t i = 0; i < count; ++i)
+				scene.CreateNode(parents[i], locals[i]);
+			scene.Update(false);
+		});
+
+		const double pointerMs = Milliseconds(iterations, pointerTree);
+
+		const double serialMs = Milliseconds(iterations, [&]() {
+			scene.MarkAllDirty();
+			scene.Update(false);
+		});
+
+		const double parallelMs = Milliseconds(iterations, [&]() {
+			scene.MarkAllDirty();
+			scene.Update(true);
+		});
+
+		//  : 1%     
+		uint32_t partialNodes = 0;
+		const double partialMs = Milliseconds(iterations, [&]() {
+			for (uint32_t k = 0; k < count / 100; ++k) {
+				const SceneGraph::NodeId id = rng() % count;
+				scene.SetLocal(id, locals[id]);
+			}
+			partialNodes = scene.Update(true);
+		});
+
+		std::vector<BatchTransform::Float4x4> world(count);
+		for (uint32_t i = 0; i < count; ++i)
+			world[i] = scene.World(i);
+		const double error = MaxError(world, refWorld, 4);
+
+		char report[512];
+		snprintf(report, sizeof(report),
+			"[SceneGraph] %u nodes, %u roots\n"
+			"  build + reorder            %8.2f ms\n"
+			"  pointer tree, DirectXMath  %8.2f ms\n"
+			"  flat, serial               %8.2f ms\n"
+			"  flat, %2u workers           %8.2f ms\n"
+			"  1%% dirty, %7u recomputed %6.2f ms\n"
+			"  max err %.2e\n",
+			count, static_cast<uint32_t>(roots.size()),
+			buildMs, pointerMs, serialMs,
+			JobSystem::WorkerCount(), parallelMs,
+			partialNodes, partialMs,
+			error);
+		Report(report);
+	}
+}
+
+void Benchmarks::RunRenderWorld() {
+	const uint32_t count = 1000000u;
+	const int iterations = 10;
+
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+
+	RenderWorld::Aabb unitBox;
+	unitBox.Extents[0] = unitBox.Extents[1] = unitBox.Extents[2] = 1.0f;
+
+	// 16 , 64 ,  .  8-  ,
+	//        .
+	RenderWorld world;
+	world.Reserve(count);
+
+	std::vector<RenderWorld::Entity> entities(count);
+	for (uint32_t i = 0; i < count; ++i)
+		entities[i] = world.Create(rng() % 16, rng() % 64, unitBox);
+
+	const int64_t churnStart = Clock::Now();
+	for (uint32_t i = 0; i < count; i += 8) {
+		world.Destroy(entities[i]);
+		entities[i] = world.Create(rng() % 16, rng() % 64, unitBox);
+	}
+	const double churnMs = Clock::ToSeconds(Clock::Now() - churnStart) * 1000.0;
+
+	std::vector<BatchTransform::Float4x4> worlds(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		XMStoreFloat4x4(reinterpret_cast<XMFLOAT4X4*>(&worlds[i]),
+			XMMatrixTranslation(position(rng), position(rng), position(rng)));
+		world.SetWorld(entities[i], worlds[i]);
+	}
+
+	//       +z
+	XMFLOAT4X4 viewProj;
+	XMStoreFloat4x4(&viewProj, XMMatrixPerspectiveFovLH(0.25f * XM_PI, 16.0f / 9.0f, 0.1f, 1000.0f));
+	const RenderWorld::Frustum frustum =
+		RenderWorld::Frustum::FromViewProj(reinterpret_cast<const BatchTransform::Float4x4&>(viewProj));
+
+	//   bounds:    
+	auto touchAll = [&]() {
+		for (uint32_t i = 0; i < count; ++i)
+			world.SetWorld(entities[i], worlds[i]);
+	};
+
+	const double boundsSerialMs = Milliseconds(iterations, [&]() { touchAll(); world.UpdateWorldBounds(false); });
+	const double boundsParallelMs = Milliseconds(iterations, [&]() { touchAll(); world.UpdateWorldBounds(true); });
+	const double touchMs = Milliseconds(iterations, touchAll);
+	world.UpdateWorldBounds();
+
+	uint32_t visible = 0;
+	const double cullSerialMs = Milliseconds(iterations, [&]() { visible = world.Cull(frustum, false); });
+	const double cullParallelMs = Milliseconds(iterations, [&]() { visible = world.Cull(frustum, true); });
+
+	std::vector<RenderWorld::DrawEntry> drawList;
+	const double drawListMs = Milliseconds(iterations, [&]() { world.BuildDrawList(drawList); });
+
+	//         ( UpdateObjectCBs):
+	//    ,   -  
+	std::vector<XMFLOAT4X4> objectCB(world.SlotCapacity());
+	std::vector<uint64_t> written(world.SlotCapacity(), 0);
+
+	auto pack = [&]() {
+		const RenderWorld::Entity* dense = world.Entities();
+		const BatchTransform::Float4x4* denseWorlds = world.Worlds();
+		const uint64_t* generations = world.Generations();
+		const uint8_t* visibility = world.Visibility();
+
+		for (uint32_t i = 0; i < world.Count(); ++i) {
+			if (!RenderWorld::IsVisible(visibility[i]))
+				continue;
+
+			const uint32_t slot = RenderWorld::SlotOf(dense[i]);
+			if (written[slot] == generations[i])
+				continue;
+
+			XMStoreFloat4x4(&objectCB[slot],
+				XMMatrixTranspose(XMLoadFloat4x4(reinterpret_cast<const XMFLOAT4X4*>(&denseWorlds[i]))));
+			written[slot] = generations[i];
+		}
+	};
+
+	const double packColdMs = Milliseconds(1, pack);
+	const double packWarmMs = Milliseconds(iterations, pack);
+
+	// :  "" ,  RenderItem  ECS  bounds  .
+	//      24  bounds,      ~200.
+	struct FatObject {
+		XMFLOAT4X4 World;
+		XMFLOAT4X4 WorldInvTranspose;
+		uint64_t Generation;
+		const void* VertexBufferView;
+		const void* IndexBufferView;
+		UINT Count;
+		UINT StartIndexLocation;
+		INT BaseVertexLocation;
+		uint32_t Mesh;
+		uint32_t Material;
+		RenderWorld::Aabb Bounds;
+		bool Visible;
+	};
+
+	std::vector<FatObject> fat(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		fat[i] = {};
+		fat[i].Bounds = world.WorldBounds()[i];
+	}
+
+	uint32_t fatVisible = 0;
+	const double fatCullMs = Milliseconds(iterations, [&]() {
+		fatVisible = 0;
+		for (FatObject& object : fat) {
+			bool inside = true;
+			for (const auto& p : frustum.Planes) {
+				const RenderWorld::Aabb& b = object.Bounds;
+				const float distance = p[0] * b.Center[0] + p[1] * b.Center[1] + p[2] * b.Center[2] + p[3];
+				const float radius = std::fabs(p[0]) * b.Extents[0] + std::fabs(p[1]) * b.Extents[1] +
+					std::fabs(p[2]) * b.Extents[2];
+				inside = inside && distance + radius >= 0.0f;
+			}
+			object.Visible = inside;
+			fatVisible += inside ? 1 : 0;
+		}
+	});
+
+	auto rate = [count](double ms) { return ms > 0.0 ? count / (ms * 1000.0) : 0.0; };
+
+	char report[1024];
+	snprintf(report, sizeof(report),
+		"[RenderWorld] %u entities, %u visible (array of structs: %u), %zu draws\n"
+		"  destroy + create 1/8         %8.2f ms\n"
+		"  SetWorld all                 %8.2f ms  %7.1f M/s\n"
+		"  world bounds, serial         %8.2f ms  %7.1f M/s\n"
+		"  world bounds, %2u workers     %8.2f ms  %7.1f M/s\n"
+		"  cull, serial                 %8.2f ms  %7.1f M/s\n"
+		"  cull, %2u workers             %8.2f ms  %7.1f M/s\n"
+		"  cull, array of structs       %8.2f ms  %7.1f M/s\n"
+		"  draw list (sorted)           %8.2f ms\n"
+		"  pack constants cold / warm   %8.2f / %.2f ms\n",
+		count, visible, fatVisible, drawList.size(),
+		churnMs,
+		touchMs, rate(touchMs),
+		boundsSerialMs - touchMs, rate(boundsSerialMs - touchMs),
+		JobSystem::WorkerCount(), boundsParallelMs - touchMs, rate(boundsParallelMs - touchMs),
+		cullSerialMs, rate(cullSerialMs),
+		JobSystem::WorkerCount(), cullParallelMs, rate(cullParallelMs),
+		fatCullMs, rate(fatCullMs),
+		drawListMs,
+		packColdMs, packWarmMs);
+	Report(report);
+
+	//  handle:     256  (  8 ).
+	//     handle     
+	uint32_t failures = 0;
+
+	RenderWorld churn;
+	std::vector<RenderWorld::Entity> dead;
+	RenderWorld::Entity alive = churn.Create(0, 0, unitBox);
+	for (int life = 0; life < 1000; ++life) {
+		churn.Destroy(alive);
+		dead.push_back(alive);
+		alive = churn.Create(0, 0, unitBox);
+	}
+
+	bool stale = true;
+	for (RenderWorld::Entity entity : dead)
+		stale = stale && !churn.IsAlive(entity) && entity != alive;
+	Expect(stale, "destroyed handles stay stale after the version wraps", failures);
+	Expect(churn.IsAlive(alive) && churn.Count() == 1, "the live handle still works", failures);
+	Expect(churn.SlotCapacity() == 4, "a slot is retired after 256 lives", failures);
+
+	snprintf(report, sizeof(report), "[RenderWorld] check: %zu reuses of one slot, %u slots used, %u failures\n",
+		dead.size(), churn.SlotCapacity(), failures);
+	Report(report);
+}
+
+void Benchmarks::RunSpatialIndex() {
+	const uint32_t count = 1000000u;
+	const int iterations = 10;
+
+	std::mt19937 rng(11);
+	std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+	std::uniform_real_distribution<float> jitter(-0.05f, 0.05f);
+
+	RenderWorld::Aabb unitBox;
+	unitBox.Extents[0] = unitBox.Extents[1] = unitBox.Extents[2] = 1.0f;
+
+	//   ,   RunRenderWorld:  BVH -  
+	RenderWorld world;
+	world.Reserve(count);
+
+	std::vector<RenderWorld::Entity> entities(count);
+	std::vector<BatchTransform::Float4x4> worlds(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		entities[i] = world.Create(rng() % 16, rng() % 64, unitBox);
+		XMStoreFloat4x4(reinterpret_cast<XMFLOAT4X4*>(&worlds[i]),
+			XMMatrixTranslation(position(rng), position(rng), position(rng)));
+		world.SetWorld(entities[i], worlds[i]);
+	}
+	world.UpdateWorldBounds();
+
+	auto boundsOf = [&](uint32_t i) -> const RenderWorld::Aabb& {
+		return world.WorldBounds()[world.IndexOf(entities[i])];
+	};
+
+	SceneBvh bvh;
+	for (uint32_t i = 0; i < count; ++i)
+		bvh.Insert(RenderWorld::SlotOf(entities[i]), boundsOf(i));
+
+	const double buildMs = Milliseconds(1, [&]() { bvh.Build(); });
+	const SceneBvh::Stats built = bvh.GetStats();
+
+	//   : SetWorld,  bounds, Move  Refit
+	auto move = [&](uint32_t step) {
+		for (uint32_t i = 0; i < count; i += step) {
+			worlds[i].m[3][0] += jitter(rng);
+			worlds[i].m[3][2] += jitter(rng);
+			world.SetWorld(entities[i], worlds[i]);
+		}
+		world.UpdateWorldBounds();
+		for (uint32_t i = 0; i < count; i += step)
+			bvh.Move(RenderWorld::SlotOf(entities[i]), boundsOf(i));
+	};
+
+	double refitFewMs = 0.0;
+	for (int n = 0; n < iterations; ++n) {
+		move(100);
+		refitFewMs += Milliseconds(1, [&]() { bvh.Refit(); });
+	}
+	refitFewMs /= iterations;
+
+	double refitAllMs = 0.0;
+	for (int n = 0; n < iterations; ++n) {
+		move(1);
+		refitAllMs += Milliseconds(1, [&]() { bvh.Refit(); });
+	}
+	refitAllMs /= iterations;
+
+	const SceneBvh::Stats refitted = bvh.GetStats();
+	const double rebuildMs = Milliseconds(1, [&]() { bvh.Build(); });
+
+	// :      RenderWorld::Cull
+	XMFLOAT4X4 viewProj;
+	XMStoreFloat4x4(&viewProj, XMMatrixPerspectiveFovLH(0.25f * XM_PI, 16.0f / 9.0f, 0.1f, 1000.0f));
+	const RenderWorld::Frustum frustum =
+		RenderWorld::Frustum::FromViewProj(reinterpret_cast<const BatchTransform::Float4x4&>(viewProj));
+
+	std::vector<SceneBvh::ProxyId> result;
+	result.reserve(count);
+
+	uint32_t visibleLinear = 0;
+	const double cullLinearMs = Milliseconds(iterations, [&]() { visibleLinear = world.Cull(frustum, false); });
+	const double cullBvhMs = Milliseconds(iterations, [&]() { result.clear(); bvh.QueryFrustum(frustum, result); });
+	const size_t visibleBvh = result.size();
+
+	//        
+	const int queryCount = 1000;
+	size_t boxHits = 0;
+	const double boxMs = Milliseconds(1, [&]() {
+		for (int q = 0; q < queryCount; ++q) {
+			RenderWorld::Aabb box;
+			box.Center[0] = position(rng);
+			box.Center[1] = position(rng);
+			box.Center[2] = position(rng);
+			box.Extents[0] = box.Extents[1] = box.Extents[2] = 10.0f;
+			result.clear();
+			bvh.QueryBox(box, result);
+			boxHits += result.size();
+		}
+	});
+
+	size_t sphereHits = 0;
+	const double sphereMs = Milliseconds(1, [&]() {
+		for (int q = 0; q < queryCount; ++q) {
+			const float center[3] = { position(rng), position(rng), position(rng) };
+			result.clear();
+			bvh.QuerySphere(center, 10.0f, result);
+			sphereHits += result.size();
+		}
+	});
+
+	const int rayCount = 100000;
+	int rayHits = 0;
+	const double rayMs = Milliseconds(1, [&]() {
+		for (int r = 0; r < rayCount; ++r) {
+			const float origin[3] = { position(rng), position(rng), position(rng) };
+			XMFLOAT3 direction;
+			XMStoreFloat3(&direction, XMVector3Normalize(XMVectorSet(position(rng), position(rng), position(rng), 0.0f)));
+			SceneBvh::RayHit hit;
+			rayHits += bvh.Raycast(origin, &direction.x, 1000.0f, hit) ? 1 : 0;
+		}
+	});
+
+	char report[1024];
+	snprintf(report, sizeof(report),
+		"[SceneBvh] %u objects: %u nodes, depth %u, SAH %.1f (after refits %.1f)\n"
+		"  build (binned SAH)           %8.2f ms\n"
+		"  move 1%% + refit              %8.2f ms\n"
+		"  move 100%% + refit            %8.2f ms\n"
+		"  rebuild after moves          %8.2f ms\n"
+		"  cull, linear                 %8.2f ms  (%u visible)\n"
+		"  cull, BVH                    %8.2f ms  (%zu visible)\n"
+		"  box query 20^3               %8.2f us  (%.1f hits)\n"
+		"  sphere query r=10            %8.2f us  (%.1f hits)\n"
+		"  ray query                    %8.2f M/s (%d%% hit)\n",
+		count, built.Nodes, built.MaxDepth, built.SahCost, refitted.SahCost,
+		buildMs,
+		refitFewMs,
+		refitAllMs,
+		rebuildMs,
+		cullLinearMs, visibleLinear,
+		cullBvhMs, visibleBvh,
+		boxMs * 1000.0 / queryCount, static_cast<double>(boxHits) / queryCount,
+		sphereMs * 1000.0 / queryCount, static_cast<double>(sphereHits) / queryCount,
+		rayMs > 0.0 ? rayCount / (rayMs * 1000.0) : 0.0, rayHits * 100 / rayCount);
+	Report(report);
+}
+
+namespace {
+	//       (Ericson, Real-Time Collision Detection 5.1.5)
+	float PointTriangleDistanceSq(FXMVECTOR p, FXMVECTOR a, FXMVECTOR b, GXMVECTOR c) {
+		const XMVECTOR ab = b - a;
+		const XMVECTOR ac = c - a;
+		const XMVECTOR ap = p - a;
+
+		const float d1 = XMVectorGetX(XMVector3Dot(ab, ap));
+		const float d2 = XMVectorGetX(XMVector3Dot(ac, ap));
+		if (d1 <= 0.0f && d2 <= 0.0f)
+			return XMVectorGetX(XMVector3LengthSq(ap));
+
+		const XMVECTOR bp = p - b;
+		const float d3 = XMVectorGetX(XMVector3Dot(ab, bp));
+		const float d4 = XMVectorGetX(XMVector3Dot(ac, bp));
+		if (d3 >= 0.0f && d4 <= d3)
+			return XMVectorGetX(XMVector3LengthSq(bp));
+
+		const float vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+			return XMVectorGetX(XMVector3LengthSq(ap - ab * (d1 / (d1 - d3))));
+
+		const XMVECTOR cp = p - c;
+		const float d5 = XMVectorGetX(XMVector3Dot(ab, cp));
+		const float d6 = XMVectorGetX(XMVector3Dot(ac, cp));
+		if (d6 >= 0.0f && d5 <= d6)
+			return XMVectorGetX(XMVector3LengthSq(cp));
+
+		const float vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+			return XMVectorGetX(XMVector3LengthSq(ap - ac * (d2 / (d2 - d6))));
+
+		const float va = d3 * d6 - d5 * d4;
+		if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+			return XMVectorGetX(XMVector3LengthSq(cp - (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)))));
+
+		const float denom = 1.0f / (va + vb + vc);
+		const XMVECTOR closest = a + ab * (vb * denom) + ac * (vc * denom);
+		return XMVectorGetX(XMVector3LengthSq(p - closest));
+	}
+
+	//  :        LOD
+	float MeasuredError(const std::vector<GeometryGenerator::Vertex>& vertices, const std::vector<uint32_t>& indices,
+		const MeshSimplifier::LodLevel& lod, uint32_t samples) {
+		float maxDistanceSq = 0.0f;
+		const uint32_t step = (std::max)(1u, static_cast<uint32_t>(vertices.size()) / samples);
+
+		for (size_t v = 0; v < vertices.size(); v += step) {
+			const XMVECTOR p = XMLoadFloat3(&vertices[v].Position);
+			float best = FLT_MAX;
+
+			for (uint32_t i = lod.FirstIndex; i < lod.FirstIndex + lod.IndexCount; i += 3) {
+				best = (std::min)(best, PointTriangleDistanceSq(p,
+					XMLoadFloat3(&vertices[indices[i]].Position),
+					XMLoadFloat3(&vertices[indices[i + 1]].Position),
+					XMLoadFloat3(&vertices[indices[i + 2]].Position)));
+			}
+
+			maxDistanceSq = (std::max)(maxDistanceSq, best);
+		}
+
+		return std::sqrt(maxDistanceSq);
+	}
+}
+
+void Benchmarks::RunSimplifier() {
+	GeometryGenerator generator;
+
+	struct Source {
+		const char* Name;
+		GeometryGenerator::MeshData Mesh;
+		float Size; //  ,    
+	};
+
+	Source sources[] = {
+		{ "sphere 512x256", generator.CreateSphere(1.0f, 512, 256), 2.0f },
+		{ "geosphere 6", generator.CreateGeosphere(1.0f, 6), 2.0f },
+		{ "cylinder 256x128", generator.CreateCylinder(1.0f, 0.5f, 3.0f, 256, 128), 3.0f },
+		{ "grid 1024x1024", generator.CreateGrid(10.0f, 10.0f, 1024, 1024), 10.0f },
+	};
+
+	//   texcoord   ,  - 
+	static const float attributeWeights[8] = { 0.05f, 0.05f, 0.05f, 0.0f, 0.0f, 0.0f, 0.05f, 0.05f };
+
+	for (Source& source : sources) {
+		const GeometryGenerator::MeshData& mesh = source.Mesh;
+
+		MeshSimplifier::VertexData data;
+		data.Vertices = mesh.Vertices.data();
+		data.Stride = sizeof(GeometryGenerator::Vertex);
+		data.VertexCount = static_cast<uint32_t>(mesh.Vertices.size());
+		data.PositionOffset = offsetof(GeometryGenerator::Vertex, Position);
+		data.AttributeOffset = offsetof(GeometryGenerator::Vertex, Normal);
+		data.AttributeCount = 8;
+		data.AttributeWeights = attributeWeights;
+
+		std::vector<uint32_t> lodIndices;
+		std::vector<MeshSimplifier::LodLevel> lods;
+		const double ms = Milliseconds(1, [&]() {
+			lodIndices.clear();
+			lods = MeshSimplifier::BuildLodChain(data, mesh.Indices32.data(), mesh.Indices32.size(),
+				MeshSimplifier::LodOptions(), lodIndices);
+		});
+
+		//    ,  
+		size_t processed = 0;
+		for (size_t i = 0; i + 1 < lods.size(); ++i)
+			processed += lods[i].IndexCount / 3;
+
+		char report[256];
+		snprintf(report, sizeof(report), "[Simplifier] %s: %zu vertices, %zu levels in %.1f ms (%.2f Mtri/s)\n",
+			source.Name, mesh.Vertices.size(), lods.size(), ms, ms > 0.0 ? processed / (ms * 1000.0) : 0.0);
+		Report(report);
+
+		for (const MeshSimplifier::LodLevel& lod : lods) {
+			const float measured = MeasuredError(mesh.Vertices, lodIndices, lod, 64);
+			snprintf(report, sizeof(report), "  %8u triangles  error bound %.3f%%  measured %.3f%%\n",
+				lod.IndexCount / 3, 100.0f * lod.Error / source.Size, 100.0f * measured / source.Size);
+			Report(report);
+		}
+	}
+}
+
+void Benchmarks::RunMeshlets() {
+	GeometryGenerator generator;
+
+	struct Source {
+		const char* Name;
+		GeometryGenerator::MeshData Mesh;
+		float Size;
+	};
+
+	Source sources[] = {
+		{ "sphere 512x256", generator.CreateSphere(1.0f, 512, 256), 2.0f },
+		{ "geosphere 6", generator.CreateGeosphere(1.0f, 6), 2.0f },
+		{ "cylinder 256x128", generator.CreateCylinder(1.0f, 0.5f, 3.0f, 256, 128), 3.0f },
+		{ "grid 1024x1024", generator.CreateGrid(10.0f, 10.0f, 1024, 1024), 10.0f },
+	};
+
+	const int viewpoints = 64;
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> distance(0.6f, 3.0f);
+
+	OcclusionBuffer occlusion;
+	occlusion.Resize(256, 144);
+
+	for (Source& source : sources) {
+		const GeometryGenerator::MeshData& mesh = source.Mesh;
+
+		Meshlets::MeshletData meshlets;
+		const double buildMs = Milliseconds(1, [&]() {
+			Meshlets::Build(&mesh.Vertices[0].Position, sizeof(GeometryGenerator::Vertex),
+				static_cast<uint32_t>(mesh.Vertices.size()), mesh.Indices32.data(), mesh.Indices32.size(), meshlets);
+		});
+
+		const size_t count = meshlets.Meshlets.size();
+		size_t vertices = 0;
+		size_t coneCullable = 0;
+		for (size_t i = 0; i < count; ++i) {
+			vertices += meshlets.Meshlets[i].VertexCount;
+			coneCullable += meshlets.Bounds[i].ConeCutoff < 1.0f ? 1 : 0;
+		}
+
+		const size_t triangles = mesh.Indices32.size() / 3;
+
+		char report[256];
+		snprintf(report, sizeof(report),
+			"[Meshlets] %s: %zu triangles -> %zu clusters in %.1f ms (%.2f Mtri/s), avg %.1f vertices %.1f triangles (%.0f%% of %u), cone %.0f%%\n",
+			source.Name, triangles, count, buildMs, buildMs > 0.0 ? triangles / (buildMs * 1000.0) : 0.0,
+			static_cast<double>(vertices) / count, static_cast<double>(triangles) / count,
+			100.0 * triangles / count / Meshlets::MaxTriangles, Meshlets::MaxTriangles, 100.0 * coneCullable / count);
+		Report(report);
+
+		//       ;    
+		//     
+		uint64_t outside = 0, backfacing = 0, occluded = 0;
+		double cullMs = 0.0;
+
+		for (int v = 0; v < viewpoints; ++v) {
+			XMVECTOR direction = XMVector3Normalize(XMVectorSet(unit(rng), unit(rng), unit(rng), 0.0f));
+			if (XMVectorGetX(XMVector3LengthSq(direction)) < 0.5f)
+				direction = XMVectorSet(0.0f, 0.0f, -1.0f, 0.0f);
+
+			const float d = distance(rng) * source.Size;
+			const XMVECTOR eyePos = direction * d;
+			const XMVECTOR up = std::fabs(XMVectorGetY(direction)) > 0.99f ? XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f) : XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+
+			BatchTransform::Float4x4 viewProj;
+			XMStoreFloat4x4(reinterpret_cast<XMFLOAT4X4*>(&viewProj),
+				XMMatrixLookAtLH(eyePos, XMVectorZero(), up) * XMMatrixPerspectiveFovLH(0.25f * XM_PI, 16.0f / 9.0f, 0.1f, 1000.0f));
+
+			const XMVECTOR right = XMVector3Normalize(XMVector3Cross(up, -direction));
+			const XMVECTOR wallUp = XMVector3Cross(-direction, right);
+			const XMVECTOR wallCenter = eyePos * 0.5f;
+
+			XMFLOAT3 wall[4];
+			XMStoreFloat3(&wall[0], wallCenter - wallUp * d);
+			XMStoreFloat3(&wall[1], wallCenter + wallUp * d);
+			XMStoreFloat3(&wall[2], wallCenter + wallUp * d + right * d);
+			XMStoreFloat3(&wall[3], wallCenter - wallUp * d + right * d);
+			const uint32_t wallIndices[6] = { 0, 1, 2, 0, 2, 3 };
+
+			XMFLOAT3 eye;
+			XMStoreFloat3(&eye, eyePos);
+
+			const int64_t start = Clock::Now();
+
+			occlusion.Begin(viewProj, 0.1f);
+			occlusion.RasterizeTriangles(wall, sizeof(XMFLOAT3), wallIndices, 6, viewProj);
+			occlusion.Finish();
+
+			const RenderWorld::Frustum frustum = RenderWorld::Frustum::FromViewProj(viewProj);
+			for (const Meshlets::Bounds& bounds : meshlets.Bounds) {
+				const Meshlets::CullResult result = Meshlets::Cull(bounds, frustum, &eye.x);
+				if (result == Meshlets::CullResult::OutsideFrustum)
+					++outside;
+				else if (result == Meshlets::CullResult::Backfacing)
+					++backfacing;
+				else if (occlusion.IsSphereOccluded(bounds.Center, bounds.Radius))
+					++occluded;
+			}
+
+			cullMs += Clock::ToSeconds(Clock::Now() - start) * 1000.0;
+		}
+
+		const double tested = static_cast<double>(count) * viewpoints;
+		snprintf(report, sizeof(report),
+			"  cull %.3f ms/view (%.1f ns/cluster)  frustum %.1f%%  backface %.1f%%  occluded %.1f%%  drawn %.1f%%\n",
+			cullMs / viewpoints, cullMs * 1.0e6 / tested,
+			100.0 * outside / tested, 100.0 * backfacing / tested, 100.0 * occluded / tested,
+			100.0 * (tested - outside - backfacing - occluded) / tested);
+		Report(report);
+	}
+}
+
+void Benchmarks::RunGeometry() {
+	GeometryGenerator generator;
+	GeometryGenerator::MeshArena arena;
+
+	char report[256];
+	snprintf(report, sizeof(report), "[Geometry] %u worker threads\n", JobSystem::WorkerCount());
+	Report(report);
+
+	auto megabytes = [](size_t vertexCount, size_t indexCount, size_t indexSize) {
+		return (vertexCount * sizeof(GeometryGenerator::Vertex) + indexCount * indexSize) / (1024.0 * 1024.0);
+	};
+
+	auto reportSpan = [&](const char* name, const GeometryGenerator::MeshSpan& mesh, double firstMs, double reusedMs) {
+		snprintf(report, sizeof(report),
+			"  %-22s %10u vertices %11u indices (%s) %7.1f MB  span %8.1f ms, arena reused %8.1f ms\n",
+			name, mesh.VertexCount, mesh.IndexCount, mesh.Indices16 ? "16-bit" : "32-bit",
+			megabytes(mesh.VertexCount, mesh.IndexCount, mesh.Indices16 ? 2 : 4), firstMs, reusedMs);
+		Report(report);
+	};
+
+	auto reportMeshData = [&](const char* name, size_t vertexCount, size_t indexCount, double ms) {
+		snprintf(report, sizeof(report), "  %-22s %10zu vertices %11zu indices (32-bit) %7.1f MB  MeshData %8.1f ms\n",
+			name, vertexCount, indexCount, megabytes(vertexCount, indexCount, 4), ms);
+		Report(report);
+	};
+
+	//   span-   (   page faults),  - 
+	auto runSpan = [&](const char* name, auto&& create) {
+		GeometryGenerator::MeshSpan mesh;
+		arena.Reset();
+		const double firstMs = Milliseconds(1, [&]() { mesh = create(); });
+		arena.Reset();
+		const double reusedMs = Milliseconds(1, [&]() { mesh = create(); });
+		reportSpan(name, mesh, firstMs, reusedMs);
+	};
+
+	// --- 4096 x 4096 grid ---
+	{
+		size_t vertexCount = 0, indexCount = 0;
+		const double ms = Milliseconds(1, [&]() {
+			GeometryGenerator::MeshData grid = generator.CreateGrid(100.0f, 100.0f, 4096, 4096);
+			vertexCount = grid.Vertices.size();
+			indexCount = grid.Indices32.size();
+		});
+		reportMeshData("grid 4096x4096", vertexCount, indexCount, ms);
+	}
+	runSpan("grid 4096x4096", [&]() { return generator.CreateGrid(100.0f, 100.0f, 4096, 4096, arena); });
+
+	// --- 16-bit indices: MeshData + GetIndices16 against direct 16-bit output ---
+	{
+		const int iterations = 20;
+		size_t vertexCount = 0, indexCount = 0;
+		const double ms = Milliseconds(iterations, [&]() {
+			GeometryGenerator::MeshData grid = generator.CreateGrid(10.0f, 10.0f, 256, 256);
+			vertexCount = grid.Vertices.size();
+			indexCount = grid.GetIndices16().size();
+		});
+		reportMeshData("grid 256x256 +Indices16", vertexCount, indexCount, ms);
+
+		GeometryGenerator::MeshSpan mesh;
+		const double spanMs = Milliseconds(iterations, [&]() {
+			arena.Reset();
+			mesh = generator.CreateGrid(10.0f, 10.0f, 256, 256, arena);
+		});
+		reportSpan("grid 256x256", mesh, spanMs, spanMs);
+	}
+
+	// --- Geosphere: MeshData stops at 6 subdivisions ---
+	{
+		size_t vertexCount = 0, indexCount = 0;
+		const double ms = Milliseconds(1, [&]() {
+			GeometryGenerator::MeshData geosphere = generator.CreateGeosphere(1.0f, 6);
+			vertexCount = geosphere.Vertices.size();
+			indexCount = geosphere.Indices32.size();
+		});
+		reportMeshData("geosphere 6", vertexCount, indexCount, ms);
+	}
+	runSpan("geosphere 6", [&]() { return generator.CreateGeosphere(1.0f, 6, arena); });
+	runSpan("geosphere 8", [&]() { return generator.CreateGeosphere(1.0f, 8, arena); });
+
+	snprintf(report, sizeof(report), "  arena capacity %.1f MB\n", arena.Capacity() / (1024.0 * 1024.0));
+	Report(report);
+}
+
+namespace {
+	// GeometryGenerator::Subdivide    :   
+	//   ,    .
+	void SubdividePerTriangle(GeometryGenerator::MeshData& mesh) {
+		const GeometryGenerator::MeshData input = mesh;
+		mesh.Vertices.clear();
+		mesh.Indices32.clear();
+
+		auto midPoint = [](const GeometryGenerator::Vertex& a, const GeometryGenerator::Vertex& b) {
+			GeometryGenerator::Vertex m;
+			XMStoreFloat3(&m.Position, 0.5f * (XMLoadFloat3(&a.Position) + XMLoadFloat3(&b.Position)));
+			XMStoreFloat3(&m.Normal, XMVector3Normalize(0.5f * (XMLoadFloat3(&a.Normal) + XMLoadFloat3(&b.Normal))));
+			XMStoreFloat3(&m.TangentU, XMVector3Normalize(0.5f * (XMLoadFloat3(&a.TangentU) + XMLoadFloat3(&b.TangentU))));
+			XMStoreFloat2(&m.TexC, 0.5f * (XMLoadFloat2(&a.TexC) + XMLoadFloat2(&b.TexC)));
+			return m;
+		};
+
+		const uint32_t triangleCount = static_cast<uint32_t>(input.Indices32.size() / 3);
+		for (uint32_t t = 0; t < triangleCount; ++t) {
+			const GeometryGenerator::Vertex& v0 = input.Vertices[input.Indices32[t * 3 + 0]];
+			const GeometryGenerator::Vertex& v1 = input.Vertices[input.Indices32[t * 3 + 1]];
+			const GeometryGenerator::Vertex& v2 = input.Vertices[input.Indices32[t * 3 + 2]];
+
+			mesh.Vertices.push_back(v0);
+			mesh.Vertices.push_back(v1);
+			mesh.Vertices.push_back(v2);
+			mesh.Vertices.push_back(midPoint(v0, v1));
+			mesh.Vertices.push_back(midPoint(v1, v2));
+			mesh.Vertices.push_back(midPoint(v0, v2));
+
+			const uint32_t b = t * 6;
+			const uint32_t indices[12] = { b + 0, b + 3, b + 5,  b + 3, b + 4, b + 5,  b + 5, b + 4, b + 2,  b + 3, b + 1, b + 4 };
+			mesh.Indices32.insert(mesh.Indices32.end(), indices, indices + 12);
+		}
+	}
+
+	//   :       .
+	GeometryGenerator::MeshData GeospherePerTriangle(float radius, uint32_t levels) {
+		GeometryGenerator::MeshData mesh = GeometryGenerator().CreateGeosphere(radius, 0);
+
+		for (uint32_t i = 0; i < levels; ++i)
+			SubdividePerTriangle(mesh);
+
+		for (GeometryGenerator::Vertex& v : mesh.Vertices) {
+			const XMVECTOR n = XMVector3Normalize(XMLoadFloat3(&v.Position));
+			XMStoreFloat3(&v.Position, radius * n);
+			XMStoreFloat3(&v.Normal, n);
+
+			float theta = atan2f(v.Position.z, v.Position.x);
+			if (theta < 0.0f)
+				theta += XM_2PI;
+			const float phi = acosf(v.Position.y / radius);
+
+			v.TexC = XMFLOAT2(theta / XM_2PI, phi / XM_PI);
+			XMStoreFloat3(&v.TangentU, XMVector3Normalize(XMVectorSet(-sinf(phi) * sinf(theta), 0.0f, sinf(phi) * cosf(theta), 0.0f)));
+		}
+
+		return mesh;
+	}
+
+	//      ,    .
+	size_t WeldPositions(GeometryGenerator::MeshData& mesh) {
+		struct PositionHash {
+			size_t operator()(const XMFLOAT3& p) const {
+				uint32_t bits[3];
+				memcpy(bits, &p, sizeof(bits));
+				return (size_t(bits[0]) * 73856093u) ^ (size_t(bits[1]) * 19349663u) ^ (size_t(bits[2]) * 83492791u);
+			}
+		};
+		struct PositionEqual {
+			bool operator()(const XMFLOAT3& a, const XMFLOAT3& b) const {
+				return memcmp(&a, &b, sizeof(XMFLOAT3)) == 0;
+			}
+		};
+
+		std::unordered_map<XMFLOAT3, uint32_t, PositionHash, PositionEqual> unique;
+		unique.reserve(mesh.Vertices.size() / 4);
+
+		std::vector<uint32_t> remap(mesh.Vertices.size());
+		std::vector<GeometryGenerator::Vertex> welded;
+		welded.reserve(mesh.Vertices.size() / 4);
+
+		for (size_t i = 0; i < mesh.Vertices.size(); ++i) {
+			auto inserted = unique.emplace(mesh.Vertices[i].Position, static_cast<uint32_t>(welded.size()));
+			if (inserted.second)
+				welded.push_back(mesh.Vertices[i]);
+			remap[i] = inserted.first->second;
+		}
+
+		for (uint32_t& index : mesh.Indices32)
+			index = remap[index];
+		mesh.Vertices.swap(welded);
+
+		return mesh.Vertices.size();
+	}
+}
+
+void Benchmarks::RunGeosphere() {
+	GeometryGenerator generator;
+	GeometryGenerator::MeshArena arena;
+
+	char report[256];
+	snprintf(report, sizeof(report),
+		"[Geosphere] vertices and ms per level: per-triangle Subdivide (+ weld) / MeshData with shared midpoints / span (%u workers)\n",
+		JobSystem::WorkerCount());
+	Report(report);
+
+	// MeshData-  6 ; span-  
+	const uint32_t meshDataLevels = 6;
+	const uint32_t spanLevels = 8;
+
+	for (uint32_t level = 0; level <= spanLevels; ++level) {
+		const int iterations = level <= 4 ? 20 : (level <= 6 ? 3 : 1);
+		int length = snprintf(report, sizeof(report), "  level %u:", level);
+
+		if (level <= meshDataLevels) {
+			size_t perTriangleVertices = 0, weldedVertices = 0, sharedVertices = 0;
+			double weldMs = 0.0;
+
+			const double perTriangleMs = Milliseconds(iterations, [&]() {
+				GeometryGenerator::MeshData mesh = GeospherePerTriangle(1.0f, level);
+				perTriangleVertices = mesh.Vertices.size();
+
+				const int64_t start = Clock::Now();
+				weldedVertices = WeldPositions(mesh);
+				weldMs += Clock::ToSeconds(Clock::Now() - start) * 1000.0;
+			});
+			weldMs /= iterations;
+
+			const double sharedMs = Milliseconds(iterations, [&]() {
+				sharedVertices = generator.CreateGeosphere(1.0f, level).Vertices.size();
+			});
+
+			length += snprintf(report + length, sizeof(report) - length,
+				" %8zu in %7.2f ms (+ weld %6.2f ms -> %7zu) | %7zu in %7.2f ms |",
+				perTriangleVertices, perTriangleMs - weldMs, weldMs, weldedVertices, sharedVertices, sharedMs);
+		}
+		else {
+			length += snprintf(report + length, sizeof(report) - length, " %*s |", 76, "");
+		}
+
+		//    ,  
+		arena.Reset();
+		GeometryGenerator::MeshSpan mesh = generator.CreateGeosphere(1.0f, level, arena);
+
+		const double spanMs = Milliseconds(iterations, [&]() {
+			arena.Reset();
+			mesh = generator.CreateGeosphere(1.0f, level, arena);
+		});
+
+		snprintf(report + length, sizeof(report) - length, " %8u in %7.2f ms (%s)\n",
+			mesh.VertexCount, spanMs, mesh.Indices16 ? "16-bit" : "32-bit");
+		Report(report);
+	}
+}
+
+namespace {
+	//  16- heightfield side x side   ;   .
+	std::string TerrainFile(uint32_t side) {
+		char directory[MAX_PATH];
+		if (GetTempPathA(MAX_PATH, directory) == 0)
+			directory[0] = '\0';
+
+		const std::string path = std::string(directory) + "Lab4_terrain_" + std::to_string(side) + ".r16";
+		const uint64_t bytes = uint64_t(side) * side * sizeof(uint16_t);
+
+		std::error_code error;
+		if (std::filesystem::file_size(path, error) == bytes && !error)
+			return path;
+
+		char report[512];
+		snprintf(report, sizeof(report), "  writing %s (%.0f MB)...\n", path.c_str(), bytes / (1024.0 * 1024.0));
+		Report(report);
+
+		std::ofstream out(path, std::ios::binary | std::ios::trunc);
+		const uint32_t blockRows = 256;
+		std::vector<uint16_t> block(size_t(side) * blockRows);
+
+		for (uint32_t z0 = 0; z0 < side && out; z0 += blockRows) {
+			const uint32_t rows = (std::min)(blockRows, side - z0);
+
+			//   :      LOD
+			JobSystem::ParallelFor(rows, 1, [&](uint32_t begin, uint32_t end) {
+				for (uint32_t r = begin; r < end; ++r) {
+					const float z = float(z0 + r);
+					uint16_t* row = &block[size_t(r) * side];
+					for (uint32_t x = 0; x < side; ++x) {
+						const float h = 12000.0f * sinf(x * 0.0031f) * cosf(z * 0.0027f) +
+							4000.0f * sinf(x * 0.021f + z * 0.017f) +
+							800.0f * sinf(x * 0.13f) * sinf(z * 0.11f);
+						row[x] = static_cast<uint16_t>(32768.0f + h);
+					}
+				}
+			});
+
+			out.write(reinterpret_cast<const char*>(block.data()), std::streamsize(size_t(rows) * side * sizeof(uint16_t)));
+		}
+
+		if (!out)
+			throw std::runtime_error("cannot write " + path);
+		return path;
+	}
+}
+
+void Benchmarks::RunTerrain() {
+	const uint32_t side = 16385;
+
+	char report[256];
+	snprintf(report, sizeof(report), "[Terrain] %u x %u samples, %u worker threads\n", side, side, JobSystem::WorkerCount());
+	Report(report);
+
+	const std::string path = TerrainFile(side);
+
+	Terrain::Desc desc;
+	desc.Width = side;
+	desc.Height = side;
+	desc.PatchSize = 64;
+	desc.SampleSpacing = 1.0f;
+	desc.HeightScale = 1.0f / 64.0f;
+	desc.SlotBudget = 2048;
+
+	Terrain terrain;
+	const double openMs = Milliseconds(1, [&]() { terrain.Open(path.c_str(), desc); });
+
+	snprintf(report, sizeof(report), "  open (map + min/max pyramid over %u levels): %.1f ms, index buffer %zu indices\n",
+		terrain.Levels(), openMs, terrain.Indices().size());
+	Report(report);
+
+	auto run = [&](const char* name, int frames, auto&& camera) {
+		std::vector<Terrain::PatchDraw> draws;
+		double selectMs = 0.0, worstMs = 0.0, streamMs = 0.0;
+		uint64_t visited = 0, balanced = 0, culled = 0, selected = 0, stitched = 0, loaded = 0, evicted = 0, triangles = 0;
+
+		for (int frame = 0; frame < frames; ++frame) {
+			XMFLOAT3 eye;
+			XMFLOAT3 direction;
+			camera(frame, eye, direction);
+
+			BatchTransform::Float4x4 viewProj;
+			XMStoreFloat4x4(reinterpret_cast<XMFLOAT4X4*>(&viewProj),
+				XMMatrixLookToLH(XMLoadFloat3(&eye), XMLoadFloat3(&direction), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)) *
+				XMMatrixPerspectiveFovLH(0.25f * XM_PI, 16.0f / 9.0f, 0.5f, 20000.0f));
+			const RenderWorld::Frustum frustum = RenderWorld::Frustum::FromViewProj(viewProj);
+
+			const double ms = Milliseconds(1, [&]() { terrain.Select(frustum, &eye.x, draws); });
+
+			const Terrain::Stats& stats = terrain.LastStats();
+			selectMs += ms - stats.LoadMs;
+			worstMs = (std::max)(worstMs, ms);
+			streamMs += stats.LoadMs;
+			visited += stats.Visited;
+			balanced += stats.Balanced;
+			culled += stats.Culled;
+			selected += stats.Selected;
+			stitched += stats.Stitched;
+			loaded += stats.Loaded;
+			evicted += stats.Evicted;
+
+			for (const Terrain::PatchDraw& draw : draws)
+				triangles += terrain.StitchIndices(draw.Stitch).Count / 3;
+		}
+
+		const double n = frames;
+		snprintf(report, sizeof(report),
+			"  %-9s select %.3f ms, stream %.3f ms (worst frame %.2f ms); nodes visited %.0f, balanced %.1f, culled %.0f\n",
+			name, selectMs / n, streamMs / n, worstMs, visited / n, balanced / n, culled / n);
+		Report(report);
+		snprintf(report, sizeof(report),
+			"            drawn %.0f (stitched %.0f), %.0fk triangles; loaded %.1f, evicted %.1f per frame; %u slots (%.1f MB)\n",
+			selected / n, stitched / n, triangles / n / 1000.0, loaded / n, evicted / n,
+			terrain.SlotCount(), terrain.SlotCount() * terrain.PatchVertexCount() * sizeof(uint16_t) / (1024.0 * 1024.0));
+		Report(report);
+	};
+
+	//   :    ,   
+	run("flight", 600, [&](int frame, XMFLOAT3& eye, XMFLOAT3& direction) {
+		eye = XMFLOAT3(1000.0f + frame * 20.0f, 1000.0f, 1000.0f + frame * 18.0f);
+		direction = XMFLOAT3(1.0f, -0.25f, 0.9f);
+	});
+
+	// :     ,    
+	std::mt19937 rng(40);
+	std::uniform_real_distribution<float> position(0.0f, float(side - 1));
+	std::uniform_real_distribution<float> angle(0.0f, XM_2PI);
+	run("teleports", 200, [&](int, XMFLOAT3& eye, XMFLOAT3& direction) {
+		const float a = angle(rng);
+		eye = XMFLOAT3(position(rng), 1000.0f, position(rng));
+		direction = XMFLOAT3(cosf(a), -0.3f, sinf(a));
+	});
+
+	//          : ,  
+	//      .  :      ,  
+	//     ,       ( )
+	const uint32_t checkSide = 2049;
+	std::vector<uint16_t> samples(size_t(checkSide) * checkSide);
+	for (uint32_t z = 0; z < checkSide; ++z)
+		for (uint32_t x = 0; x < checkSide; ++x)
+			samples[size_t(z) * checkSide + x] = static_cast<uint16_t>(32768.0f +
+				12000.0f * sinf(x * 0.0123f) * cosf(z * 0.0107f) + 3000.0f * sinf(x * 0.13f + z * 0.11f));
+
+	uint32_t failures = 0;
+
+	//  ,      :  
+	//        
+	const uint32_t P = 16;
+	std::vector<uint32_t> edgeVertices[16][4];
+	{
+		Terrain::Desc checkDesc;
+		checkDesc.Width = checkSide;
+		checkDesc.Height = checkSide;
+		checkDesc.PatchSize = P;
+		Terrain layout;
+		layout.Open(samples.data(), checkDesc);
+
+		for (uint32_t stitch = 0; stitch < 16; ++stitch) {
+			std::vector<uint8_t> used((P + 1) * (P + 1), 0);
+			const Terrain::IndexRange range = layout.StitchIndices(stitch);
+			for (uint32_t i = 0; i < range.Count; ++i)
+				used[layout.Indices()[range.Start + i]] = 1;
+
+			for (uint32_t i = 0; i <= P; ++i) {
+				if (used[i * (P + 1)]) edgeVertices[stitch][0].push_back(i);           // min x:  0
+				if (used[i * (P + 1) + P]) edgeVertices[stitch][1].push_back(i);       // max x:  P
+				if (used[i]) edgeVertices[stitch][2].push_back(i);                     // min z:  0
+				if (used[P * (P + 1) + i]) edgeVertices[stitch][3].push_back(i);       // max z:  P
+			}
+		}
+	}
+
+	//     : (  , )
+	auto edgePoints = [&](const Terrain& terrain, const Terrain::PatchDraw& draw, int edge) {
+		std::vector<std::pair<uint32_t, uint16_t>> points;
+		const uint32_t step = 1u << draw.Level;
+		const uint32_t along = (edge < 2 ? draw.Z : draw.X) * (P << draw.Level);
+		const uint16_t* slot = terrain.SlotSamples(draw.Slot);
+		for (uint32_t i : edgeVertices[draw.Stitch][edge]) {
+			const uint32_t c = edge == 0 ? 0 : edge == 1 ? P : i;
+			const uint32_t r = edge == 2 ? 0 : edge == 3 ? P : i;
+			points.emplace_back(along + i * step, slot[r * (P + 1) + c]);
+		}
+		return points;
+	};
+
+	uint32_t checkedFrames = 0, checkedEdges = 0, maxSlots = 0;
+	uint64_t checkedEvictions = 0;
+	for (uint32_t budget : { 8u, 48u, 160u }) {
+		Terrain::Desc checkDesc;
+		checkDesc.Width = checkSide;
+		checkDesc.Height = checkSide;
+		checkDesc.PatchSize = P;
+		checkDesc.HeightScale = 1.0f / 64.0f;
+		checkDesc.SlotBudget = budget;
+
+		Terrain terrain;
+		terrain.Open(samples.data(), checkDesc);
+
+		std::mt19937 checkRng(budget);
+		std::uniform_real_distribution<float> checkPosition(0.0f, float(checkSide - 1));
+		std::vector<Terrain::PatchDraw> draws;
+
+		XMFLOAT3 eye, direction;
+		for (int frame = 0; frame < 60; ++frame) {
+			//     10 
+			if (frame % 10 == 0)
+				eye = XMFLOAT3(checkPosition(checkRng), 900.0f, checkPosition(checkRng));
+			else
+				eye = XMFLOAT3(eye.x + 12.0f, 900.0f, eye.z + 9.0f);
+			const float a = frame * 0.4f;
+			direction = XMFLOAT3(cosf(a), -0.35f, sinf(a));
+
+			BatchTransform::Float4x4 viewProj;
+			XMStoreFloat4x4(reinterpret_cast<XMFLOAT4X4*>(&viewProj),
+				XMMatrixLookToLH(XMLoadFloat3(&eye), XMLoadFloat3(&direction), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)) *
+				XMMatrixPerspectiveFovLH(0.25f * XM_PI, 16.0f / 9.0f, 0.5f, 5000.0f));
+			const RenderWorld::Frustum frustum = RenderWorld::Frustum::FromViewProj(viewProj);
+
+			terrain.Select(frustum, &eye.x, draws);
+			++checkedFrames;
+			checkedEvictions += terrain.LastStats().Evicted;
+			maxSlots = (std::max)(maxSlots, terrain.SlotCount());
+
+			Expect(terrain.Validate(), "slots and resident nodes one to one", failures);
+
+			//   ,     
+			std::vector<uint8_t> taken(terrain.SlotCount(), 0);
+			bool distinct = true, heights = true;
+			for (const Terrain::PatchDraw& draw : draws) {
+				if (draw.Slot >= taken.size() || taken[draw.Slot]++) {
+					distinct = false;
+					continue;
+				}
+
+				const uint32_t step = 1u << draw.Level;
+				const uint16_t* slot = terrain.SlotSamples(draw.Slot);
+				for (uint32_t r = 0; r <= P && heights; ++r)
+					for (uint32_t c = 0; c <= P; ++c) {
+						const uint32_t x = (std::min)(draw.X * (P << draw.Level) + c * step, checkSide - 1);
+						const uint32_t z = (std::min)(draw.Z * (P << draw.Level) + r * step, checkSide - 1);
+						heights &= slot[r * (P + 1) + c] == samples[size_t(z) * checkSide + x];
+					}
+			}
+			Expect(distinct, "every drawn node has its own slot", failures);
+			Expect(heights, "every slot holds its node's heights", failures);
+			if (!distinct)
+				continue;
+
+			//        :     
+			//       .   
+			//    
+			std::unordered_map<uint64_t, uint32_t> byNode;
+			for (uint32_t i = 0; i < draws.size(); ++i)
+				byNode.emplace((uint64_t(draws[i].Level) << 48) | (uint64_t(draws[i].X) << 24) | draws[i].Z, i);
+
+			static const int offsets[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+			bool sealed = true;
+			for (const Terrain::PatchDraw& draw : draws) {
+				for (int edge = 0; edge < 4; ++edge) {
+					const int64_t nx = int64_t(draw.X) + offsets[edge][0];
+					const int64_t nz = int64_t(draw.Z) + offsets[edge][1];
+					if (nx < 0 || nz < 0)
+						continue;
+
+					auto same = byNode.find((uint64_t(draw.Level) << 48) | (uint64_t(nx) << 24) | uint64_t(nz));
+					auto coarse = byNode.find((uint64_t(draw.Level + 1) << 48) | (uint64_t(nx >> 1) << 24) | uint64_t(nz >> 1));
+					const Terrain::PatchDraw* neighbour = same != byNode.end() ? &draws[same->second] :
+						coarse != byNode.end() ? &draws[coarse->second] : nullptr;
+					if (neighbour == nullptr)
+						continue;
+
+					const auto mine = edgePoints(terrain, draw, edge);
+					const auto theirs = edgePoints(terrain, *neighbour, edge ^ 1);
+					std::vector<std::pair<uint32_t, uint16_t>> shared;
+					for (const auto& point : theirs)
+						if (point.first >= mine.front().first && point.first <= mine.back().first)
+							shared.push_back(point);
+
+					sealed &= shared == mine;
+					++checkedEdges;
+				}
+			}
+			Expect(sealed, "no cracks between neighbouring nodes", failures);
+		}
+	}
+
+	snprintf(report, sizeof(report),
+		"[Terrain] check: %u frames with budgets 8/48/160 (up to %u slots, %llu evictions), %u shared edges, %u failures\n",
+		checkedFrames, maxSlots, static_cast<unsigned long long>(checkedEvictions), checkedEdges, failures);
+	Report(report);
+}
+
+namespace {
+	// BC7 16384 x 16384        (  )
+	std::string DdsFilePath(uint32_t side) {
+		char directory[MAX_PATH];
+		if (GetTempPathA(MAX_PATH, directory) == 0)
+			directory[0] = '\0';
+
+		const std::string path = std::string(directory) + "Lab4_bc7_" + std::to_string(side) + ".dds";
+
+		DdsFile::Desc desc;
+		desc.Format = DXGI_FORMAT_BC7_UNORM;
+		desc.Width = side;
+		desc.Height = side;
+		desc.Depth = 1;
+		desc.ArraySize = 1;
+		desc.MipCount = 1;
+		while ((side >> (desc.MipCount - 1)) > 1)
+			++desc.MipCount;
+
+		std::vector<uint8_t> header;
+		DdsFile::WriteHeader(desc, header);
+
+		uint64_t bytes = header.size();
+		for (uint32_t mip = 0; mip < desc.MipCount; ++mip) {
+			uint64_t mipBytes = 0;
+			DdsFile::SurfaceInfo((std::max)(side >> mip, 1u), (std::max)(side >> mip, 1u), desc.Format, &mipBytes, nullptr, nullptr);
+			bytes += mipBytes;
+		}
+
+		std::error_code error;
+		if (std::filesystem::file_size(path, error) == bytes && !error)
+			return path;
+
+		char report[512];
+		snprintf(report, sizeof(report), "  writing %s (%.0f MB)...\n", path.c_str(), bytes / (1024.0 * 1024.0));
+		Report(report);
+
+		std::ofstream out(path, std::ios::binary | std::ios::trunc);
+		out.write(reinterpret_cast<const char*>(header.data()), std::streamsize(header.size()));
+
+		std::mt19937 rng(41);
+		std::vector<uint32_t> block(1 << 20);
+		for (uint64_t left = bytes - header.size(); left > 0 && out; ) {
+			for (uint32_t& word : block)
+				word = rng();
+			const uint64_t chunk = (std::min)(left, uint64_t(block.size() * sizeof(uint32_t)));
+			out.write(reinterpret_cast<const char*>(block.data()), std::streamsize(chunk));
+			left -= chunk;
+		}
+
+		if (!out)
+			throw std::runtime_error("cannot write " + path);
+		return path;
+	}
+}
+
+void Benchmarks::RunDds() {
+	const uint32_t side = 16384;
+
+	char report[256];
+	snprintf(report, sizeof(report), "[DDS] BC7 %u x %u with mips: whole-file read vs memory-mapped upload\n", side, side);
+	Report(report);
+
+	const std::string path = DdsFilePath(side);
+
+	std::vector<uint8_t> staging;
+	std::vector<DdsFile::Footprint> footprints;
+
+	// Staging-    GetCopyableFootprints
+	auto upload = [&](const DdsFile& dds, size_t maxSize, uint64_t& copied) {
+		DdsFile::Layout layout;
+		dds.ComputeLayout(maxSize, layout);
+
+		const uint64_t stagingSize = DdsFile::PlanUpload(layout, footprints);
+		if (staging.size() < stagingSize)
+			staging.resize(size_t(stagingSize));
+
+		copied = 0;
+		for (size_t i = 0; i < layout.Subresources.size(); ++i) {
+			const DdsFile::Subresource& sub = layout.Subresources[i];
+			dds.CopySubresource(sub, &staging[size_t(footprints[i].Offset)], footprints[i].RowPitch, footprints[i].SlicePitch);
+			copied += sub.SliceBytes * sub.Depth;
+		}
+	};
+
+	auto run = [&](const char* name, size_t maxSize) {
+		uint64_t copied = 0;
+		uint64_t fileBytes = 0;
+
+		//  :     ( LoadTextureDataFromFile),    staging
+		const double readMs = Milliseconds(3, [&]() {
+			std::ifstream in(path, std::ios::binary | std::ios::ate);
+			fileBytes = uint64_t(in.tellg());
+			in.seekg(0);
+			std::unique_ptr<uint8_t[]> data(new uint8_t[size_t(fileBytes)]);
+			in.read(reinterpret_cast<char*>(data.get()), std::streamsize(fileBytes));
+
+			DdsFile dds;
+			dds.Open(data.get(), fileBytes);
+			upload(dds, maxSize, copied);
+		});
+
+		// :   ,  staging    
+		const double mappedMs = Milliseconds(3, [&]() {
+			DdsFile dds;
+			dds.Open(path.c_str());
+			upload(dds, maxSize, copied);
+		});
+
+		snprintf(report, sizeof(report), "  %-10s %.0f MB of %.0f MB uploaded: read + copy %.1f ms, mapped %.1f ms (%.2fx)\n",
+			name, copied / (1024.0 * 1024.0), fileBytes / (1024.0 * 1024.0), readMs, mappedMs, readMs / mappedMs);
+		Report(report);
+	};
+
+	//  :      
+	DdsFile::Layout layout;
+	const double headerMs = Milliseconds(100, [&]() {
+		DdsFile dds;
+		dds.Open(path.c_str());
+		dds.ComputeLayout(0, layout);
+	});
+	snprintf(report, sizeof(report), "  open + parse + layout (%zu subresources): %.3f ms\n", layout.Subresources.size(), headerMs);
+	Report(report);
+
+	run("full chain", 0);
+	run("max 4096", 4096);
+	Report("  (the file is in the OS cache after the first pass; a cold read favours the mapping more)\n");
+}
+
+namespace {
+	//  DDS   ;    
+	std::vector<uint8_t> DdsSeed(const DdsFile::Desc& desc) {
+		std::vector<uint8_t> file;
+		DdsFile::WriteHeader(desc, file);
+
+		uint64_t bytes = 0;
+		for (uint32_t slice = 0; slice < desc.ArraySize; ++slice) {
+			for (uint32_t mip = 0; mip < desc.MipCount; ++mip) {
+				uint64_t surfaceBytes = 0;
+				DdsFile::SurfaceInfo((std::max)(desc.Width >> mip, 1u), (std::max)(desc.Height >> mip, 1u), desc.Format,
+					&surfaceBytes, nullptr, nullptr);
+				bytes += surfaceBytes * (std::max)(desc.Depth >> mip, 1u);
+			}
+		}
+
+		file.resize(file.size() + size_t(bytes), 0x5A);
+		return file;
+	}
+}
+
+void Benchmarks::RunDdsFuzz() {
+	const int iterations = 2000000;
+
+	char report[256];
+	snprintf(report, sizeof(report), "[DDS fuzz] %d mutated headers through DdsFile (parse, layout, upload plan, copy)\n", iterations);
+	Report(report);
+
+	// :      
+	std::vector<std::vector<uint8_t>> seeds;
+	auto seed = [&](DdsFile::Dimension type, uint32_t format, uint32_t width, uint32_t height, uint32_t depth,
+		uint32_t arraySize, uint32_t mips, bool cube) {
+		DdsFile::Desc desc;
+		desc.Type = type;
+		desc.Format = format;
+		desc.Width = width;
+		desc.Height = height;
+		desc.Depth = depth;
+		desc.ArraySize = arraySize;
+		desc.MipCount = mips;
+		desc.CubeMap = cube;
+		seeds.push_back(DdsSeed(desc));
+	};
+	seed(DdsFile::Texture2D, DXGI_FORMAT_R8G8B8A8_UNORM, 100, 60, 1, 2, 7, false);
+	seed(DdsFile::Texture2D, DXGI_FORMAT_BC1_UNORM, 32, 32, 1, 6, 6, true);
+	seed(DdsFile::Texture2D, DXGI_FORMAT_BC7_UNORM, 70, 18, 1, 1, 7, false);
+	seed(DdsFile::Texture1D, DXGI_FORMAT_R16_FLOAT, 300, 1, 1, 3, 9, false);
+	seed(DdsFile::Texture3D, DXGI_FORMAT_R16G16B16A16_FLOAT, 8, 8, 8, 1, 4, false);
+	seed(DdsFile::Texture2D, DXGI_FORMAT_YUY2, 33, 9, 1, 1, 3, false);
+	seed(DdsFile::Texture2D, DXGI_FORMAT_NV12, 64, 48, 1, 2, 1, false);
+	seed(DdsFile::Texture2D, DXGI_FORMAT_NV11, 64, 48, 1, 1, 1, false);
+	seed(DdsFile::Texture2D, DXGI_FORMAT_V208, 64, 48, 1, 1, 1, false);
+
+	//    : ,  D3D12,   
+	const uint32_t interesting[] = { 0, 1, 2, 3, 4, 6, 15, 16, 2048, 2049, 16384, 16385,
+		DXGI_FORMAT_NV12, DXGI_FORMAT_NV11, DXGI_FORMAT_V408, 0x7FFFFFFF, 0x80000000, 0xFFFFFFFF };
+	const size_t headerBytes = 4 + 124 + 20;
+
+	std::mt19937 rng(42);
+	std::vector<uint8_t> file;
+	std::vector<uint8_t> staging;
+	std::vector<DdsFile::Footprint> footprints;
+	DdsFile::Layout layout;
+	uint64_t accepted = 0, rejected = 0, violations = 0, subresources = 0;
+
+	const double ms = Milliseconds(1, [&]() {
+		for (int it = 0; it < iterations; ++it) {
+			file = seeds[rng() % seeds.size()];
+
+			const int mutations = 1 + int(rng() % 4);
+			for (int m = 0; m < mutations; ++m) {
+				const size_t position = rng() % (std::min)(file.size(), headerBytes);
+				if (rng() % 2) {
+					file[position] = uint8_t(rng());
+				}
+				else if ((position & ~size_t(3)) + 4 <= file.size()) {
+					const uint32_t value = interesting[rng() % (sizeof(interesting) / sizeof(interesting[0]))];
+					std::memcpy(&file[position & ~size_t(3)], &value, sizeof(value));
+				}
+			}
+			if (rng() % 4 == 0)
+				file.resize(rng() % file.size());
+
+			try {
+				DdsFile dds;
+				dds.Open(file.data(), file.size());
+				dds.ComputeLayout(rng() % 3 ? 0 : rng() % 64, layout);
+
+				const uint64_t stagingSize = DdsFile::PlanUpload(layout, footprints);
+				if (stagingSize > (uint64_t(1) << 30)) {
+					++violations;
+					continue;
+				}
+				staging.resize(size_t(stagingSize));
+
+				//    ,    , footprint'  
+				uint64_t end = 0;
+				for (size_t i = 0; i < layout.Subresources.size(); ++i) {
+					const DdsFile::Subresource& sub = layout.Subresources[i];
+					const DdsFile::Footprint& footprint = footprints[i];
+
+					if (sub.Offset + sub.SliceBytes * sub.Depth > file.size() || sub.RowBytes > sub.RowPitch ||
+						sub.RowBytes > footprint.RowPitch || footprint.Offset < end)
+						++violations;
+					else
+						dds.CopySubresource(sub, &staging[size_t(footprint.Offset)], footprint.RowPitch, footprint.SlicePitch);
+
+					end = footprint.Offset + footprint.SlicePitch * sub.Depth;
+				}
+
+				subresources += layout.Subresources.size();
+				++accepted;
+			}
+			catch (const std::runtime_error&) {
+				++rejected;
+			}
+		}
+	});
+
+	snprintf(report, sizeof(report),
+		"  %.0f ms (%.0f files/s): accepted %llu (%llu subresources), rejected %llu, violations %llu\n",
+		ms, iterations / (ms / 1000.0), (unsigned long long)accepted, (unsigned long long)subresources,
+		(unsigned long long)rejected, (unsigned long long)violations);
+	Report(report);
+}
+
+void Benchmarks::RunTextureStreaming() {
+	const uint32_t textureCount = 2048;
+	const uint32_t objectCount = 50000;
+	const int frames = 1200;
+	const float worldSize = 1500.0f;
+
+	char report[256];
+	snprintf(report, sizeof(report), "[Streaming] %u BC7 textures 512..4096, %u objects, %d frames of flight\n",
+		textureCount, objectCount, frames);
+	Report(report);
+
+	//    BC7,     CreateDDSTextureFromFile12
+	std::mt19937 rng(43);
+	std::vector<uint32_t> textureSizes(textureCount);
+	std::vector<std::vector<uint64_t>> mipBytes(textureCount);
+	uint64_t fullBytes = 0;
+	for (uint32_t t = 0; t < textureCount; ++t) {
+		const uint32_t size = 512u << (rng() % 4);
+		textureSizes[t] = size;
+		for (uint32_t mip = 0; (size >> mip) > 0; ++mip) {
+			uint64_t bytes = 0;
+			DdsFile::SurfaceInfo(size >> mip, size >> mip, DXGI_FORMAT_BC7_UNORM, &bytes, nullptr, nullptr);
+			mipBytes[t].push_back(bytes);
+			fullBytes += bytes;
+		}
+	}
+
+	struct Object {
+		float X, Z, Radius;
+		uint32_t Texture;
+	};
+	std::vector<Object> objects(objectCount);
+	std::uniform_real_distribution<float> position(0.0f, worldSize);
+	std::uniform_real_distribution<float> radius(1.0f, 20.0f);
+	for (Object& object : objects)
+		object = { position(rng), position(rng), radius(rng), uint32_t(rng() % textureCount) };
+
+	// 1920x1080,   60 :       1
+	const float pixelsPerUnit = 1080.0f / (2.0f * tanf(XM_PI / 6.0f));
+	const float halfWidthSlope = tanf(XM_PI / 6.0f) * 16.0f / 9.0f;
+
+	auto run = [&](const char* name, uint64_t budget) {
+		TextureStreamer::Desc desc;
+		desc.BudgetBytes = budget;
+		desc.MaxLoadsInFlight = 32;
+		desc.MaxBytesInFlight = 64ull << 20;
+		TextureStreamer streamer(desc);
+
+		for (uint32_t t = 0; t < textureCount; ++t)
+			streamer.Register(textureSizes[t], textureSizes[t], mipBytes[t]);
+		const uint64_t tailBytes = streamer.ResidentBytes();
+
+		//  :  3 , 64 MB   (~4 GB/s  60 )
+		struct Pending {
+			TextureStreamer::Load Load;
+			int Ready;
+		};
+		std::vector<Pending> pending;
+		const uint64_t bandwidth = 64ull << 20;
+		const int latency = 3;
+
+		std::vector<TextureStreamer::Load> loads;
+		std::vector<TextureStreamer::Eviction> evictions;
+		std::vector<uint32_t> visible;
+		std::vector<uint8_t> seen(textureCount);
+
+		double updateMs = 0.0;
+		uint64_t issued = 0, evicted = 0, starved = 0, loadedBytes = 0, peakResident = 0;
+		uint64_t visibleTextures = 0, atWanted = 0, missingMips = 0, wantedBytes = 0;
+
+		for (int frame = 0; frame < frames; ++frame) {
+			//      
+			const float t = float(frame) / float(frames);
+			const float eyeX = 100.0f + t * (worldSize - 200.0f);
+			const float eyeZ = 100.0f + t * (worldSize - 200.0f);
+			const float angle = 0.25f * XM_PI + 0.8f * sinf(t * XM_2PI);
+			const float dirX = cosf(angle), dirZ = sinf(angle);
+
+			visible.clear();
+			for (const Object& object : objects) {
+				const float dx = object.X - eyeX, dz = object.Z - eyeZ;
+				const float depth = dx * dirX + dz * dirZ;
+				if (depth < 1.0f)
+					continue;
+				const float side = dz * dirX - dx * dirZ;
+				if (fabsf(side) > depth * halfWidthSlope + object.Radius)
+					continue;
+
+				streamer.RequestSize(object.Texture, 2.0f * object.Radius * pixelsPerUnit / depth);
+				if (!seen[object.Texture]) {
+					seen[object.Texture] = 1;
+					visible.push_back(object.Texture);
+				}
+			}
+
+			updateMs += Milliseconds(1, [&]() { streamer.Update(loads, evictions); });
+
+			const TextureStreamer::Stats& stats = streamer.LastStats();
+			issued += stats.Issued;
+			evicted += stats.Evicted;
+			starved += stats.Starved;
+			for (const TextureStreamer::Load& load : loads)
+				pending.push_back({ load, frame + latency });
+
+			uint64_t budgetLeft = bandwidth;
+			size_t done = 0;
+			while (done < pending.size() && pending[done].Ready <= frame && pending[done].Load.Bytes <= budgetLeft) {
+				budgetLeft -= pending[done].Load.Bytes;
+				loadedBytes += pending[done].Load.Bytes;
+				streamer.Complete(pending[done].Load.Texture, pending[done].Load.Mip);
+				++done;
+			}
+			pending.erase(pending.begin(), pending.begin() + done);
+
+			peakResident = (std::max)(peakResident, streamer.ResidentBytes() + streamer.InFlightBytes());
+
+			// :    ,   ( )
+			for (uint32_t texture : visible) {
+				seen[texture] = 0;
+				const uint32_t resident = streamer.ResidentMip(texture);
+				const uint32_t wanted = streamer.WantedMip(texture);
+				++visibleTextures;
+				for (uint32_t mip = wanted; mip < streamer.TailMip(texture); ++mip)
+					wantedBytes += streamer.MipBytes(texture, mip);
+				if (resident <= wanted)
+					++atWanted;
+				else
+					missingMips += resident - wanted;
+			}
+		}
+
+		const double n = frames;
+		const double mb = 1024.0 * 1024.0;
+		snprintf(report, sizeof(report),
+			"  %-9s update %.3f ms; resident %.0f MB (peak %.0f MB, tails %.0f MB); loads %.1f, evictions %.1f, starved %.1f per frame\n",
+			name, updateMs / n, streamer.ResidentBytes() / mb, peakResident / mb, tailBytes / mb,
+			issued / n, evicted / n, starved / n);
+		Report(report);
+		snprintf(report, sizeof(report),
+			"            %.0f visible textures (%.0f MB above the tails) per frame, %.1f%% at the wanted mip, %.2f mips missing on the rest; %.0f MB read\n",
+			visibleTextures / n, wantedBytes / n / mb, 100.0 * atWanted / (std::max)(visibleTextures, uint64_t(1)),
+			missingMips / (std::max)(double(visibleTextures - atWanted), 1.0), loadedBytes / mb);
+		Report(report);
+	};
+
+	snprintf(report, sizeof(report), "  every mip up front: %.0f MB\n", fullBytes / (1024.0 * 1024.0));
+	Report(report);
+
+	run("256 MB", 256ull << 20);
+	run("1 GB", 1ull << 30);
+	run("unlimited", ~0ull >> 1);
+}
+
+namespace {
+	//  PNG    Sponza    (  ):
+	// 56  1024 x 1024  16  2048 x 2048,     
+	std::vector<std::string> DecodeSetPaths() {
+		char directory[MAX_PATH];
+		if (GetTempPathA(MAX_PATH, directory) == 0)
+			directory[0] = '\0';
+
+		const uint32_t count = 72;
+		std::vector<std::string> paths;
+		std::vector<uint8_t> pixels;
+		std::vector<uint8_t> png;
+		bool announced = false;
+
+		for (uint32_t i = 0; i < count; ++i) {
+			char name[64];
+			snprintf(name, sizeof(name), "Lab4_decode_%02u.png", i);
+			paths.push_back(std::string(directory) + name);
+
+			std::error_code error;
+			if (std::filesystem::exists(paths.back(), error))
+				continue;
+
+			if (!announced) {
+				Report("  writing the PNG set to the temp folder...\n");
+				announced = true;
+			}
+
+			const uint32_t side = i % 9 == 0 || i % 9 == 4 ? 2048 : 1024;
+			pixels.resize(size_t(side) * side * 4);
+
+			std::mt19937 rng(i);
+			std::uniform_int_distribution<int> noise(-6, 6);
+			const float fx = 0.004f + 0.002f * (i % 5);
+			const float fy = 0.003f + 0.002f * (i % 7);
+			for (uint32_t y = 0; y < side; ++y) {
+				uint8_t* row = &pixels[size_t(y) * side * 4];
+				for (uint32_t x = 0; x < side; ++x) {
+					const float base = 0.5f + 0.25f * sinf(x * fx + 1.3f * i) + 0.2f * cosf(y * fy + 0.7f * x * fy);
+					for (uint32_t c = 0; c < 3; ++c) {
+						const int v = int(255.0f * base * (0.7f + 0.15f * c)) + noise(rng);
+						row[x * 4 + c] = uint8_t((std::min)((std::max)(v, 0), 255));
+					}
+					row[x * 4 + 3] = i % 4 == 0 ? uint8_t(x ^ y) : 255;
+				}
+			}
+
+			png.clear();
+			PngFile::Encode(side, side, pixels.data(), size_t(side) * 4, png);
+
+			std::ofstream out(paths.back(), std::ios::binary | std::ios::trunc);
+			out.write(reinterpret_cast<const char*>(png.data()), std::streamsize(png.size()));
+			if (!out)
+				throw std::runtime_error("cannot write " + paths.back());
+		}
+
+		return paths;
+	}
+}
+
+void Benchmarks::RunTextureDecode() {
+	const std::vector<std::string> paths = DecodeSetPaths();
+	const uint32_t count = static_cast<uint32_t>(paths.size());
+
+	std::vector<std::wstring> widePaths;
+	uint64_t fileBytes = 0;
+	for (const std::string& path : paths) {
+		widePaths.push_back(std::filesystem::path(path).wstring());
+		fileBytes += std::filesystem::file_size(path);
+	}
+
+	char report[256];
+	snprintf(report, sizeof(report), "[Decode] %u PNG textures (%.0f MB of files), %u job workers\n",
+		count, fileBytes / (1024.0 * 1024.0), JobSystem::WorkerCount());
+	Report(report);
+
+	//  :    staging   D3D12_TEXTURE_DATA_PITCH_ALIGNMENT,
+	//   footprint' GetCopyableFootprints
+	std::vector<uint8_t> staging;
+	auto upload = [&](const TextureDecodeQueue::Image& image) {
+		const uint64_t rowPitch = (image.RowPitch + 255) & ~uint64_t(255);
+		if (staging.size() < rowPitch * image.Height)
+			staging.resize(size_t(rowPitch * image.Height));
+		for (uint32_t y = 0; y < image.Height; ++y)
+			memcpy(&staging[size_t(y * rowPitch)], &image.Pixels[size_t(y * image.RowPitch)], size_t(image.RowPitch));
+	};
+
+	//  :        
+	auto serial = [&](const TextureDecodeQueue::Decoder& decode) {
+		const int64_t start = Clock::Now();
+		for (uint32_t i = 0; i < count; ++i) {
+			TextureDecodeQueue::Image image;
+			image.Index = i;
+			decode(i, [&](uint64_t bytes) {
+				image.Pixels.reset(new uint8_t[size_t(bytes)]);
+				image.Bytes = bytes;
+				return image.Pixels.get();
+			}, image);
+			upload(image);
+		}
+		return Clock::ToSeconds(Clock::Now() - start) * 1000.0;
+	};
+
+	auto run = [&](const char* backend, const TextureDecodeQueue::Decoder& decode) {
+		const double serialMs = serial(decode);
+		snprintf(report, sizeof(report), "  %s, serial decode + upload: %.0f ms\n", backend, serialMs);
+		Report(report);
+
+		auto pass = [&](uint32_t threads, uint64_t budget) {
+			TextureDecodeQueue::Desc desc;
+			desc.Threads = threads;
+			desc.StagingBytes = budget;
+			TextureDecodeQueue queue(desc);
+			const TextureDecodeQueue::Stats stats = queue.Run(count, decode, upload);
+
+			char budgetText[32];
+			if (budget == ~0ull)
+				snprintf(budgetText, sizeof(budgetText), "unlimited");
+			else
+				snprintf(budgetText, sizeof(budgetText), "%llu MB", static_cast<unsigned long long>(budget >> 20));
+
+			snprintf(report, sizeof(report),
+				"    %2u threads, staging %-9s: %6.0f ms (%.2fx), peak staging %4.0f MB, decoders waited %5.0f ms, upload %4.0f ms\n",
+				(std::min)(threads ? threads : JobSystem::WorkerCount(), JobSystem::WorkerCount()), budgetText,
+				stats.WallMs, serialMs / stats.WallMs, stats.PeakStagingBytes / (1024.0 * 1024.0),
+				stats.StagingWaitMs, stats.UploadMs);
+			Report(report);
+		};
+
+		for (uint32_t threads = 1; threads < JobSystem::WorkerCount(); threads *= 2)
+			pass(threads, 128ull << 20);
+		pass(0, 128ull << 20);
+
+		pass(0, 32ull << 20);
+		pass(0, ~0ull);
+	};
+
+	run("PngFile", TextureDecodeQueue::PngFiles(paths));
+	run("WIC", TextureDecodeQueue::WicFiles(widePaths));
+	Report("  (the files are in the OS cache after the first pass)\n");
+}
+
+namespace {
+	const char* MipFormatName(MipGenerator::Format format) {
+		switch (format) {
+		case MipGenerator::Format::RGBA8: return "RGBA8";
+		case MipGenerator::Format::RGBA8Srgb: return "RGBA8 sRGB";
+		case MipGenerator::Format::RGBA16F: return "RGBA16F";
+		default: return "R32F";
+		}
+	}
+
+	//   8K:    ,    
+	void FillMipSource(MipGenerator::Format format, const MipGenerator::Level& level) {
+		const uint32_t channels = format == MipGenerator::Format::R32F ? 1 : 4;
+		JobSystem::ParallelFor(level.Height, 64, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t y = begin; y < end; ++y) {
+				uint8_t* row = level.Data + size_t(y) * level.RowPitch;
+				uint32_t hash = y * 2654435761u;
+				for (uint32_t x = 0; x < level.Width; ++x) {
+					for (uint32_t c = 0; c < channels; ++c) {
+						hash = hash * 1664525u + 1013904223u;
+						const float noise = float(hash >> 24) / 255.0f - 0.5f;
+						const float v = 0.5f + 0.3f * sinf(x * 0.002f + c) * cosf(y * 0.003f) + 0.15f * noise;
+						switch (format) {
+						case MipGenerator::Format::RGBA8:
+						case MipGenerator::Format::RGBA8Srgb:
+							row[x * 4 + c] = uint8_t((std::min)((std::max)(v, 0.0f), 1.0f) * 255.0f + 0.5f);
+							break;
+						case MipGenerator::Format::RGBA16F: {
+							const uint16_t half = PackedVector::XMConvertFloatToHalf(v * 4.0f); // HDR
+							memcpy(row + x * 8 + c * 2, &half, 2);
+							break;
+						}
+						default:
+							memcpy(row + x * 4, &v, 4);
+							break;
+						}
+					}
+				}
+			}
+		});
+	}
+}
+
+void Benchmarks::RunMipGeneration() {
+	const uint32_t side = 8192;
+	const uint32_t mipCount = MipGenerator::MipCount(side, side);
+	const bool avx2 = MipGenerator::UsesAvx2();
+
+	char report[256];
+	snprintf(report, sizeof(report), "[Mips] %u x %u, %u levels, %u job workers, AVX2 %s\n",
+		side, side, mipCount, JobSystem::WorkerCount(), avx2 ? "on" : "not supported");
+	Report(report);
+
+	//  :        188,   128
+	{
+		uint8_t checker[4 * 4 + 4] = { 0, 0, 0, 255, 255, 255, 255, 255, 255, 255, 255, 255, 0, 0, 0, 255 };
+		std::vector<MipGenerator::Level> levels;
+		MipGenerator::PackedChain(MipGenerator::Format::RGBA8Srgb, 2, 2, 2, checker, levels);
+		MipGenerator::Generate(MipGenerator::Format::RGBA8Srgb, levels.data(), 2);
+		snprintf(report, sizeof(report), "  sRGB black/white 2x2 -> %u (a plain average gives 128)\n", unsigned(checker[16]));
+		Report(report);
+	}
+
+	const MipGenerator::Format formats[] = {
+		MipGenerator::Format::RGBA8, MipGenerator::Format::RGBA8Srgb, MipGenerator::Format::RGBA16F, MipGenerator::Format::R32F
+	};
+
+	for (MipGenerator::Format format : formats) {
+		const uint64_t chainBytes = MipGenerator::ChainBytes(format, side, side, mipCount);
+		const uint64_t topBytes = uint64_t(side) * side * MipGenerator::BytesPerPixel(format);
+
+		std::unique_ptr<uint8_t[]> reference(new uint8_t[size_t(chainBytes)]);
+		std::unique_ptr<uint8_t[]> chain(new uint8_t[size_t(chainBytes)]);
+		std::vector<MipGenerator::Level> referenceLevels;
+		std::vector<MipGenerator::Level> levels;
+		MipGenerator::PackedChain(format, side, side, mipCount, reference.get(), referenceLevels);
+		MipGenerator::PackedChain(format, side, side, mipCount, chain.get(), levels);
+
+		//     ,       page faults
+		FillMipSource(format, referenceLevels[0]);
+		memset(reference.get() + topBytes, 0, size_t(chainBytes - topBytes));
+		memcpy(chain.get(), reference.get(), size_t(chainBytes));
+
+		snprintf(report, sizeof(report), "  %s (%.0f MB of mips):\n", MipFormatName(format), (chainBytes - topBytes) / (1024.0 * 1024.0));
+		Report(report);
+
+		for (MipGenerator::Filter filter : { MipGenerator::Filter::Box, MipGenerator::Filter::Kaiser }) {
+			MipGenerator::Options options;
+			options.Kernel = filter;
+
+			auto time = [&](bool simd, bool parallel, std::vector<MipGenerator::Level>& target) {
+				MipGenerator::SetAvx2Enabled(simd);
+				options.Parallel = parallel;
+				const int64_t start = Clock::Now();
+				MipGenerator::Generate(format, target.data(), mipCount, options);
+				return Clock::ToSeconds(Clock::Now() - start) * 1000.0;
+			};
+
+			const double scalarMs = time(false, false, referenceLevels);
+			const double simdMs = time(true, false, levels);
+			const double parallelMs = time(true, true, levels);
+			MipGenerator::SetAvx2Enabled(true);
+
+			const bool identical = memcmp(reference.get() + topBytes, chain.get() + topBytes, size_t(chainBytes - topBytes)) == 0;
+			snprintf(report, sizeof(report),
+				"    %-6s scalar %7.0f ms, AVX2 %7.0f ms (%.1fx), AVX2 + jobs %6.0f ms (%.1fx), %s\n",
+				filter == MipGenerator::Filter::Box ? "box" : "kaiser", scalarMs, simdMs, scalarMs / simdMs,
+				parallelMs, scalarMs / parallelMs, identical ? "same bytes" : "OUTPUT DIFFERS");
+			Report(report);
+		}
+	}
+
+	//   :   72 PNG  TextureDecodeQueue,     
+	const std::vector<std::string> paths = DecodeSetPaths();
+	const TextureDecodeQueue::Decoder decode = TextureDecodeQueue::PngFiles(paths);
+	for (bool mips : { false, true }) {
+		TextureDecodeQueue::Desc desc;
+		desc.GenerateMips = mips;
+		TextureDecodeQueue queue(desc);
+		const TextureDecodeQueue::Stats stats = queue.Run(static_cast<uint32_t>(paths.size()), decode,
+			[](const TextureDecodeQueue::Image&) {});
+
+		snprintf(report, sizeof(report), "  decode queue, %u PNG %s: %.0f ms, %.0f MB staged
+",
+			stats.Images, mips ? "+ box mips" : "         ", stats.WallMs, stats.DecodedBytes / (1024.0 * 1024.0));
+		Report(report);
+	}
+}
+
+namespace {
+	// PSNR  : BC1  RGB  texel' (  ),
+	// BC5  R  G,   RGB; alpha   BC3  BC7
+	void BlockPsnr(BcEncoder::Format format, const std::vector<uint8_t>& source, const std::vector<uint8_t>& decoded,
+		double& colorError, uint64_t& colorCount, double& alphaError, uint64_t& alphaCount) {
+		const uint32_t channels = format == BcEncoder::Format::BC5 ? 2 : 3;
+		for (size_t i = 0; i < source.size(); i += 4) {
+			if (format == BcEncoder::Format::BC1 && source[i + 3] < 128)
+				continue;
+			for (uint32_t c = 0; c < channels; ++c) {
+				const double d = double(source[i + c]) - decoded[i + c];
+				colorError += d * d;
+			}
+			colorCount += channels;
+			if (format == BcEncoder::Format::BC3 || format == BcEncoder::Format::BC7) {
+				const double d = double(source[i + 3]) - decoded[i + 3];
+				alphaError += d * d;
+				++alphaCount;
+			}
+		}
+	}
+
+	double Psnr(double error, uint64_t count) {
+		return error == 0.0 ? 99.0 : 10.0 * log10(255.0 * 255.0 * double(count) / error);
+	}
+}
+
+void Benchmarks::RunBlockCompression() {
+	//  PNG   -bench-decode:  2048 x 2048   1024 x 1024
+	const std::vector<std::string> paths = DecodeSetPaths();
+	const uint32_t count = 4;
+
+	struct Image {
+		uint32_t Width;
+		uint32_t Height;
+		std::vector<uint8_t> Pixels;
+	};
+	std::vector<Image> images(count);
+	double megapixels = 0.0;
+	for (uint32_t i = 0; i < count; ++i) {
+		std::ifstream in(paths[i], std::ios::binary);
+		const std::vector<uint8_t> png((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+		const PngFile::Info info = PngFile::ReadInfo(png.data(), png.size());
+		images[i].Width = info.Width;
+		images[i].Height = info.Height;
+		images[i].Pixels.resize(size_t(info.Width) * info.Height * 4);
+		PngFile::Decode(png.data(), png.size(), images[i].Pixels.data(), size_t(info.Width) * 4);
+		megapixels += info.Width * double(info.Height) / 1e6;
+	}
+
+	char report[256];
+	snprintf(report, sizeof(report), "[BC] %u textures (%.1f MPix), %u job workers, AVX2 %s\n",
+		count, megapixels, JobSystem::WorkerCount(), BcEncoder::UsesAvx2() ? "on" : "not supported");
+	Report(report);
+
+	const BcEncoder::Format formats[] = { BcEncoder::Format::BC1, BcEncoder::Format::BC3, BcEncoder::Format::BC5, BcEncoder::Format::BC7 };
+	const char* formatNames[] = { "BC1", "BC3", "BC5", "BC7" };
+	const char* presetNames[] = { "fast", "normal", "best" };
+
+	for (uint32_t f = 0; f < 4; ++f) {
+		for (uint32_t preset = 0; preset < 3; ++preset) {
+			BcEncoder::Options options;
+			options.Preset = BcEncoder::Quality(preset);
+
+			double colorError = 0.0, alphaError = 0.0;
+			uint64_t colorCount = 0, alphaCount = 0;
+			double seconds = 0.0;
+			std::vector<uint8_t> blocks, decoded;
+
+			for (const Image& image : images) {
+				blocks.resize(size_t(BcEncoder::SurfaceBytes(formats[f], image.Width, image.Height)));
+				const int64_t start = Clock::Now();
+				BcEncoder::Compress(formats[f], image.Pixels.data(), uint64_t(image.Width) * 4, image.Width, image.Height, blocks.data(), options);
+				seconds += Clock::ToSeconds(Clock::Now() - start);
+
+				decoded.resize(image.Pixels.size());
+				BcEncoder::Decompress(formats[f], blocks.data(), image.Width, image.Height, decoded.data(), uint64_t(image.Width) * 4);
+				BlockPsnr(formats[f], image.Pixels, decoded, colorError, colorCount, alphaError, alphaCount);
+			}
+
+			//    1024 x 1024:    AVX2
+			const Image& single = images[1];
+			blocks.resize(size_t(BcEncoder::SurfaceBytes(formats[f], single.Width, single.Height)));
+			options.Parallel = false;
+			double singleMs[2];
+			for (uint32_t simd = 0; simd < 2; ++simd) {
+				BcEncoder::SetAvx2Enabled(simd != 0);
+				singleMs[simd] = Milliseconds(1, [&]() {
+					BcEncoder::Compress(formats[f], single.Pixels.data(), uint64_t(single.Width) * 4, single.Width, single.Height, blocks.data(), options);
+				});
+			}
+			BcEncoder::SetAvx2Enabled(true);
+
+			const double singleMegapixels = single.Width * double(single.Height) / 1e6;
+			char alpha[32] = "";
+			if (alphaCount)
+				snprintf(alpha, sizeof(alpha), ", alpha %.2f dB", Psnr(alphaError, alphaCount));
+			snprintf(report, sizeof(report),
+				"  %s %-6s: %7.2f MPix/s on jobs (1 thread: scalar %6.2f, AVX2 %6.2f), PSNR %s %.2f dB%s\n",
+				formatNames[f], presetNames[preset], megapixels / seconds,
+				singleMegapixels / (singleMs[0] / 1000.0), singleMegapixels / (singleMs[1] / 1000.0),
+				formats[f] == BcEncoder::Format::BC5 ? "RG" : "RGB", Psnr(colorError, colorCount), alpha);
+			Report(report);
+		}
+	}
+
+	//  :    PNG    .dds,    
+	char directory[MAX_PATH];
+	if (GetTempPathA(MAX_PATH, directory) == 0)
+		directory[0] = '\0';
+	const std::string cache = std::string(directory) + "Lab4_bc_cache";
+
+	std::error_code error;
+	std::filesystem::remove_all(cache, error);
+	for (const char* pass : { "compress", "cached" }) {
+		std::string path;
+		const double ms = Milliseconds(1, [&]() { path = BcEncoder::ImportPng(paths[1], cache, BcEncoder::Format::BC7); });
+		snprintf(report, sizeof(report), "  ImportPng BC7 normal with mips, %-8s: %8.1f ms -> %s\n", pass, ms, path.c_str());
+		Report(report);
+	}
+}
+
+void Benchmarks::RunDescriptorAllocator() {
+	char report[256];
+
+	// 1) :  ,     fence   
+	//    (  ),    
+	{
+		const uint32_t capacity = 4096;
+		const int operations = 500000;
+
+		snprintf(report, sizeof(report), "[Descriptors] check: %d random operations on a %u-descriptor heap\n", operations, capacity);
+		Report(report);
+
+		enum : uint8_t { Free, Live, Pending };
+		std::vector<uint8_t> model(capacity, Free);
+		uint32_t freeCount = capacity, pendingCount = 0;
+
+		struct PendingRange {
+			uint64_t Fence;
+			DescriptorAllocator::Range Descriptors;
+		};
+		std::vector<DescriptorAllocator::Range> live;
+		std::vector<PendingRange> pending;
+
+		auto mark = [&](const DescriptorAllocator::Range& range, uint8_t state) {
+			for (uint32_t i = range.First; i < range.First + range.Count; ++i) {
+				freeCount -= model[i] == Free;
+				pendingCount -= model[i] == Pending;
+				model[i] = state;
+				freeCount += state == Free;
+				pendingCount += state == Pending;
+			}
+		};
+
+		auto hasFreeRun = [&](uint32_t count) {
+			uint32_t run = 0;
+			for (uint32_t i = 0; i < capacity; ++i) {
+				run = model[i] == Free ? run + 1 : 0;
+				if (run >= count)
+					return true;
+			}
+			return false;
+		};
+
+		DescriptorAllocator allocator(capacity);
+		std::mt19937 rng(47);
+
+		uint64_t fence = 0;
+		uint64_t allocations = 0, failures = 0, frees = 0, deferred = 0, rejected = 0, violations = 0;
+
+		for (int op = 0; op < operations; ++op) {
+			const uint32_t action = rng() % 100;
+
+			if (action < 50) {
+				//   SRV,    
+				const uint32_t count = rng() % 4 == 0 ? 1 + rng() % 16 : 1;
+				const uint32_t first = allocator.Allocate(count);
+
+				if (first == DescriptorAllocator::InvalidIndex) {
+					++failures;
+					violations += hasFreeRun(count);
+				}
+				else if (first + count > capacity || std::any_of(model.begin() + first, model.begin() + first + count,
+					[](uint8_t state) { return state != Free; })) {
+					++violations;
+				}
+				else {
+					++allocations;
+					mark({ first, count }, Live);
+					live.push_back({ first, count });
+				}
+			}
+			else if (action < 90) {
+				if (live.empty())
+					continue;
+
+				const size_t pick = rng() % live.size();
+				const DescriptorAllocator::Range range = live[pick];
+				live[pick] = live.back();
+				live.pop_back();
+
+				if (action < 70) {
+					allocator.Free(range.First, range.Count);
+					mark(range, Free);
+					++frees;
+				}
+				else {
+					// ,  ,  fence + 1
+					allocator.FreeDeferred(range.First, range.Count, fence + 1);
+					mark(range, Pending);
+					pending.push_back({ fence + 1, range });
+					++deferred;
+				}
+			}
+			else if (action < 97) {
+				//  ; GPU     0-2 
+				++fence;
+				const uint64_t lag = rng() % 3;
+				const uint64_t completed = fence > lag ? fence - lag : 0;
+
+				const uint32_t expected = [&]() {
+					uint32_t count = 0;
+					for (const PendingRange& range : pending)
+						count += range.Fence <= completed ? range.Descriptors.Count : 0;
+					return count;
+				}();
+				violations += allocator.Reclaim(completed) != expected;
+
+				size_t kept = 0;
+				for (const PendingRange& range : pending) {
+					if (range.Fence <= completed)
+						mark(range.Descriptors, Free);
+					else
+						pending[kept++] = range;
+				}
+				pending.resize(kept);
+			}
+			else {
+				//         
+				const uint32_t first = rng() % (capacity + 16);
+				if (first < capacity && model[first] != Free)
+					continue;
+
+				try {
+					allocator.Free(first, 1);
+					++violations;
+					break; //    
+				}
+				catch (const std::invalid_argument&) {
+					++rejected;
+				}
+			}
+
+			if (!allocator.Validate() || allocator.FreeCount() != freeCount || allocator.PendingCount() != pendingCount)
+				++violations;
+		}
+
+		snprintf(report, sizeof(report),
+			"  allocations %llu (%llu failed), frees %llu + %llu deferred, bad frees rejected %llu, violations %llu\n",
+			(unsigned long long)allocations, (unsigned long long)failures, (unsigned long long)frees,
+			(unsigned long long)deferred, (unsigned long long)rejected, (unsigned long long)violations);
+		Report(report);
+	}
+
+	// 2) :   ,   ,  
+	//         fence      
+	{
+		const uint32_t capacity = 1u << 20; //  shader-visible  CBV/SRV/UAV  tier 1-2
+		const uint32_t liveTextures = 16384;
+		const uint32_t churnPerFrame = 256;
+		const int frames = 2000;
+		const uint64_t framesInFlight = 3;
+
+		DescriptorAllocator allocator(capacity);
+		std::mt19937 rng(48);
+
+		//   (CBV   )   ,   Framework
+		allocator.Allocate(3 * 100000);
+		allocator.Allocate(3);
+
+		std::vector<uint32_t> textures(liveTextures);
+		for (uint32_t& index : textures)
+			index = allocator.Allocate();
+
+		size_t maxRanges = 0;
+		const double ms = Milliseconds(1, [&]() {
+			for (int frame = 1; frame <= frames; ++frame) {
+				allocator.Reclaim(frame > static_cast<int>(framesInFlight) ? frame - framesInFlight : 0);
+				maxRanges = (std::max)(maxRanges, allocator.FreeRanges().size());
+
+				for (uint32_t i = 0; i < churnPerFrame; ++i) {
+					uint32_t& index = textures[rng() % liveTextures];
+					allocator.FreeDeferred(index, 1, frame);
+					index = allocator.Allocate();
+				}
+			}
+		});
+
+		const double operations = 2.0 * frames * churnPerFrame;
+		snprintf(report, sizeof(report),
+			"[Descriptors] churn: %u live of %u, %u replaced per frame, %d frames: %.2f ms, %.1f ns per allocate/free, up to %zu free ranges, valid %d\n",
+			liveTextures, capacity, churnPerFrame, frames, ms, ms * 1000000.0 / operations, maxRanges, allocator.Validate() ? 1 : 0);
+		Report(report);
+	}
+}
+
+void Benchmarks::RunVirtualTexture() {
+	char report[320];
+
+	// 1) :    ( ),    
+	//    ,          
+	{
+		VirtualTexture::Desc desc;
+		desc.Width = 128 * 40; //   :  40, 20, 10, 5, 3, 2, 1 
+		desc.Height = 128 * 24;
+		desc.CacheSlots = 160;
+		desc.MaxLoadsInFlight = 16;
+		VirtualTexture texture(desc);
+
+		const int frames = 400;
+		snprintf(report, sizeof(report), "[VirtualTexture] check: %u x %u pages, %u mips, %u slots, %d frames of random feedback\n",
+			texture.PagesX(0), texture.PagesY(0), texture.MipCount(), desc.CacheSlots, frames);
+		Report(report);
+
+		std::mt19937 rng(49);
+		std::vector<uint32_t> feedback(4096);
+		std::vector<VirtualTexture::Load> loads, pending;
+		std::vector<VirtualTexture::Eviction> evictions;
+		uint64_t issued = 0, evicted = 0, completed = 0, rejected = 0, violations = 0;
+
+		for (int frame = 0; frame < frames; ++frame) {
+			//     ;     
+			const float cx = 0.5f + 0.4f * sinf(frame * 0.05f), cy = 0.5f + 0.4f * cosf(frame * 0.037f);
+			for (uint32_t& id : feedback) {
+				const uint32_t kind = rng() % 64;
+				if (kind == 0)
+					id = rng(); // :      
+				else if (kind < 8)
+					id = VirtualTexture::NoPage;
+				else {
+					const uint32_t mip = (std::min)(texture.MipCount() - 1, uint32_t(rng() % 4));
+					const float u = (std::min)((std::max)(cx + (rng() % 1000 - 500) * 0.0004f, 0.0f), 0.999f);
+					const float v = (std::min)((std::max)(cy + (rng() % 1000 - 500) * 0.0004f, 0.0f), 0.999f);
+					id = VirtualTexture::MakePage(mip, uint32_t(u * texture.PagesX(mip)), uint32_t(v * texture.PagesY(mip)));
+				}
+			}
+
+			texture.Update(feedback.data(), feedback.size(), loads, evictions, frame % 2 == 0);
+			issued += loads.size();
+			evicted += evictions.size();
+			rejected += texture.LastStats().Rejected;
+			pending.insert(pending.end(), loads.begin(), loads.end());
+
+			//       ,   
+			std::shuffle(pending.begin(), pending.end(), rng);
+			const size_t arrive = (pending.size() + 1) / 2;
+			for (size_t i = 0; i < arrive; ++i)
+				texture.Complete(pending[i].Page);
+			pending.erase(pending.begin(), pending.begin() + arrive);
+			completed += arrive;
+
+			violations += !texture.Validate();
+		}
+
+		//  .vtex:   ,    
+		VirtualTexture::Desc parsed;
+		uint32_t format = 0;
+		const VirtualTexture::FileHeader header = texture.MakeHeader(98); // DXGI_FORMAT_BC7_UNORM
+		violations += !VirtualTexture::ReadHeader(&header, texture.FileBytes(), parsed, format) ||
+			parsed.Width != desc.Width || parsed.Height != desc.Height || format != 98;
+		violations += VirtualTexture::ReadHeader(&header, texture.FileBytes() - 1, parsed, format);
+
+		snprintf(report, sizeof(report),
+			"  loads %llu (%llu completed), evictions %llu, garbage ids rejected %llu, violations %llu\n",
+			(unsigned long long)issued, (unsigned long long)completed, (unsigned long long)evicted,
+			(unsigned long long)rejected, (unsigned long long)violations);
+		Report(report);
+	}
+
+	// 2)       64K x 64K (16   ,
+	//    ),    1/8  1920x1080     8x8
+	{
+		VirtualTexture::Desc desc; // 64K x 64K,  128 + 4   , BC7
+		const int frames = 1200;
+		const uint32_t screenWidth = 1920, screenHeight = 1080, feedbackScale = 8;
+		const uint32_t feedbackWidth = screenWidth / feedbackScale, feedbackHeight = screenHeight / feedbackScale;
+		const float texelsPerUnit = 16.0f;
+		const float tanHalfFov = tanf(XM_PI / 6.0f);
+		const float pixelAngle = 2.0f * tanHalfFov / screenHeight;
+
+		// ,   :        
+		//   x16,     
+		auto generate = [&](int frame, uint32_t width, uint32_t height, uint32_t scale, std::vector<uint32_t>& feedback, std::mt19937& rng,
+			const VirtualTexture& texture) {
+			const float t = float(frame);
+			const float yaw = 0.6f * sinf(t * 0.004f);
+			const float pitch = -0.3f;
+			const float eyeX = 200.0f + 1.5f * t * sinf(yaw), eyeY = 12.0f, eyeZ = 200.0f + 1.5f * t * cosf(yaw);
+
+			const XMVECTOR forward = XMVectorSet(sinf(yaw) * cosf(pitch), sinf(pitch), cosf(yaw) * cosf(pitch), 0.0f);
+			const XMVECTOR right = XMVector3Normalize(XMVector3Cross(XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f), forward));
+			const XMVECTOR up = XMVector3Cross(forward, right);
+			const float aspect = float(screenWidth) / screenHeight;
+
+			const uint32_t maxMip = texture.MipCount() - 1;
+			feedback.resize(size_t(width) * height);
+
+			for (uint32_t fy = 0; fy < height; ++fy) {
+				for (uint32_t fx = 0; fx < width; ++fx) {
+					const float sx = (fx * scale + rng() % scale + 0.5f) / screenWidth * 2.0f - 1.0f;
+					const float sy = 1.0f - (fy * scale + rng() % scale + 0.5f) / screenHeight * 2.0f;
+
+					XMFLOAT3 dir;
+					XMStoreFloat3(&dir, XMVector3Normalize(forward + right * (sx * tanHalfFov * aspect) + up * (sy * tanHalfFov)));
+
+					uint32_t& id = feedback[size_t(fy) * width + fx];
+					if (dir.y > -0.001f) {
+						id = VirtualTexture::NoPage; // 
+						continue;
+					}
+
+					const float distance = eyeY / -dir.y;
+					const float minor = distance * pixelAngle * texelsPerUnit;
+					const float major = minor / -dir.y;
+					const float lod = log2f((std::max)(minor, major / 16.0f));
+					const uint32_t mip = lod <= 0.0f ? 0 : (std::min)(uint32_t(lod), maxMip);
+
+					const float u = (eyeX + dir.x * distance) * texelsPerUnit;
+					const float v = (eyeZ + dir.z * distance) * texelsPerUnit;
+					const uint32_t tx = uint32_t(int64_t(floorf(u)) & (desc.Width - 1));
+					const uint32_t ty = uint32_t(int64_t(floorf(v)) & (desc.Height - 1));
+					id = VirtualTexture::MakePage(mip, (tx >> mip) / desc.PageSize, (ty >> mip) / desc.PageSize);
+				}
+			}
+		};
+
+		auto run = [&](const char* name, uint32_t cacheSlots, uint64_t bandwidth) {
+			VirtualTexture::Desc runDesc = desc;
+			runDesc.CacheSlots = cacheSlots;
+			VirtualTexture texture(runDesc);
+
+			//  :  2 ,    bandwidth  
+			struct Pending {
+				VirtualTexture::Load Load;
+				int Ready;
+			};
+			std::vector<Pending> pending;
+			const int latency = 2;
+
+			std::mt19937 rng(50);
+			std::vector<uint32_t> feedback;
+			std::vector<VirtualTexture::Load> loads;
+			std::vector<VirtualTexture::Eviction> evictions;
+			std::vector<VirtualTexture::Region> regions;
+
+			double updateMs = 0.0;
+			uint64_t hit = 0, miss = 0, issued = 0, evicted = 0, starved = 0, unique = 0, readBytes = 0, dirtyEntries = 0;
+
+			for (int frame = 0; frame < frames; ++frame) {
+				generate(frame, feedbackWidth, feedbackHeight, feedbackScale, feedback, rng, texture);
+
+				updateMs += Milliseconds(1, [&]() { texture.Update(feedback.data(), feedback.size(), loads, evictions); });
+
+				const VirtualTexture::Stats& stats = texture.LastStats();
+				hit += stats.HitPixels;
+				miss += stats.MissPixels;
+				unique += stats.Unique;
+				issued += stats.Issued;
+				evicted += stats.Evicted;
+				starved += stats.Starved;
+
+				//       ,     
+				std::sort(loads.begin(), loads.end(),
+					[](const VirtualTexture::Load& a, const VirtualTexture::Load& b) { return a.FileOffset < b.FileOffset; });
+				for (const VirtualTexture::Load& load : loads)
+					pending.push_back({ load, frame + latency });
+
+				uint64_t budgetLeft = bandwidth;
+				size_t done = 0;
+				while (done < pending.size() && pending[done].Ready <= frame && runDesc.PageBytes <= budgetLeft) {
+					budgetLeft -= runDesc.PageBytes;
+					readBytes += runDesc.PageBytes;
+					texture.Complete(pending[done].Load.Page);
+					++done;
+				}
+				pending.erase(pending.begin(), pending.begin() + done);
+
+				texture.TakeDirtyRegions(regions);
+				for (const VirtualTexture::Region& region : regions)
+					dirtyEntries += uint64_t(region.X1 - region.X0) * (region.Y1 - region.Y0);
+			}
+
+			const double n = frames;
+			const double mb = 1024.0 * 1024.0;
+			snprintf(report, sizeof(report),
+				"  %-22s update %.3f ms; %.0f unique pages per frame, %.1f%% of pixels at the wanted mip; loads %.1f, evictions %.1f, starved %.1f per frame\n",
+				name, updateMs / n, unique / n, 100.0 * hit / (std::max)(hit + miss, uint64_t(1)), issued / n, evicted / n, starved / n);
+			Report(report);
+			snprintf(report, sizeof(report),
+				"  %-22s cache %.0f MB, %.1f MB read, page table: %.0f entries uploaded per frame of %u\n",
+				"", double(cacheSlots) * runDesc.PageBytes / mb, readBytes / mb, dirtyEntries / n, texture.PageCount());
+			Report(report);
+		};
+
+		{
+			VirtualTexture probe(desc);
+			snprintf(report, sizeof(report),
+				"[VirtualTexture] flight: %u x %u texels, %u mips, %u pages (%.0f MB on disk), feedback %u x %u, %d frames\n",
+				desc.Width, desc.Height, probe.MipCount(), probe.PageCount(), probe.FileBytes() / (1024.0 * 1024.0),
+				feedbackWidth, feedbackHeight, frames);
+			Report(report);
+
+			//      :    job system
+			std::mt19937 rng(51);
+			std::vector<uint32_t> feedback;
+			std::vector<VirtualTexture::Load> loads;
+			std::vector<VirtualTexture::Eviction> evictions;
+			generate(300, screenWidth / 2, screenHeight / 2, 2, feedback, rng, probe);
+
+			const double serialMs = Milliseconds(20, [&]() { probe.Update(feedback.data(), feedback.size(), loads, evictions, false); });
+			const double parallelMs = Milliseconds(20, [&]() { probe.Update(feedback.data(), feedback.size(), loads, evictions, true); });
+			snprintf(report, sizeof(report),
+				"  feedback %u x %u: %u unique pages, serial %.3f ms, parallel %.3f ms (%u workers + caller)\n",
+				screenWidth / 2, screenHeight / 2, probe.LastStats().Unique, serialMs, parallelMs, JobSystem::WorkerCount());
+			Report(report);
+		}
+
+		run("4096 slots, 8 MB/frame", 4096, 8ull << 20);
+		run("1024 slots, 8 MB/frame", 1024, 8ull << 20);
+		run("4096 slots, 2 MB/frame", 4096, 2ull << 20);
+	}
+}
+
+void Benchmarks::RunShaderCache() {
+	char report[256];
+
+	//    : main.hlsl -> include/common.hlsli -> lighting/brdf.hlsli,
+	//  include     other.hlsl
+	char directory[MAX_PATH];
+	if (GetTempPathA(MAX_PATH, directory) == 0)
+		directory[0] = '\0';
+	const std::string root = std::string(directory) + "Lab4_shader_cache";
+
+	std::error_code error;
+	std::filesystem::remove_all(root, error);
+	std::filesystem::create_directories(root + "/include/lighting", error);
+
+	auto writeFile = [](const std::string& path, const std::string& text) {
+		std::ofstream out(path, std::ios::binary | std::ios::trunc);
+		out << text;
+	};
+
+	const std::string mainFile = root + "/main.hlsl";
+	const std::string otherFile = root + "/other.hlsl";
+	const std::string brdfFile = root + "/include/lighting/brdf.hlsli";
+	const std::string missingFile = root + "/include/missing.hlsli";
+	const std::string packPath = root + "/cache/shaders.bin";
+
+	writeFile(mainFile, "#include \"include/common.hlsli\"\nfloat4 PS() : SV_Target { return Shade(); }\n");
+	writeFile(root + "/include/common.hlsli", "  #  include \"lighting/brdf.hlsli\"\n#ifdef EXTRA\n#include <missing.hlsli>\n#endif\n");
+	writeFile(brdfFile, "float4 Shade() { return 1; }\n");
+	writeFile(otherFile, "float4 VS() : SV_Position { return 0; }\n");
+
+	//  :      , define FAIL -  
+	std::atomic<uint32_t> compiles{ 0 };
+	auto compile = [&](const ShaderCache::Key& key) {
+		++compiles;
+		for (const ShaderCache::Define& define : key.Defines) {
+			if (define.Name == "FAIL")
+				throw std::runtime_error("fake compile error");
+		}
+
+		std::mt19937_64 rng(ShaderCache::HashKey(key) ^ ShaderCache::HashSource(key.File));
+		std::vector<uint8_t> bytecode(2048 + rng() % 4096);
+		for (uint8_t& byte : bytecode)
+			byte = static_cast<uint8_t>(rng());
+		return bytecode;
+	};
+
+	// : main PS   ,   , other VS   
+	std::vector<ShaderCache::Key> keys;
+	for (int lights = 1; lights <= 8; ++lights) {
+		for (int shadows = 0; shadows < 2; ++shadows) {
+			for (int fog = 0; fog < 2; ++fog) {
+				keys.push_back({ mainFile, "PS", "ps_5_1",
+					{ { "LIGHTS", std::to_string(lights) }, { "SHADOWS", std::to_string(shadows) }, { "FOG", std::to_string(fog) } }, 0 });
+			}
+		}
+		keys.push_back({ otherFile, "VS", "vs_5_1", { { "LIGHTS", std::to_string(lights) } }, 0 });
+	}
+	const uint32_t mainCount = 32, otherCount = 8;
+	const std::string salt = "fake_compiler_1";
+
+	uint32_t failures = 0;
+
+	std::vector<const std::vector<uint8_t>*> bytecode;
+	std::vector<std::vector<uint8_t>> reference;
+
+	// 1)  :  ,  ,   -  
+	{
+		ShaderCache cache(packPath, salt);
+		Expect(!cache.Load(), "cold: no pack to load", failures);
+
+		std::vector<ShaderCache::Key> withDuplicate = keys;
+		withDuplicate.push_back(keys[0]);
+		cache.Get(withDuplicate.data(), withDuplicate.size(), compile, bytecode);
+		Expect(compiles == keys.size(), "cold: every key compiled once", failures);
+		Expect(cache.GetStats().Misses == keys.size() && cache.GetStats().Hits == 0, "cold: all misses", failures);
+		Expect(bytecode.back() == bytecode[0], "cold: duplicate key shares the entry", failures);
+
+		for (size_t i = 0; i < keys.size(); ++i)
+			reference.push_back(*bytecode[i]);
+		cache.Save();
+		Expect(cache.GetStats().BytesWritten > 0, "cold: pack written", failures);
+	}
+
+	// 2) Ҹ:   ,   ,   
+	{
+		compiles = 0;
+		ShaderCache cache(packPath, salt);
+		Expect(cache.Load() && cache.EntryCount() == keys.size(), "warm: pack loaded", failures);
+		cache.Get(keys.data(), keys.size(), compile, bytecode);
+		Expect(compiles == 0 && cache.GetStats().Hits == keys.size(), "warm: all hits", failures);
+
+		bool same = true;
+		for (size_t i = 0; i < keys.size(); ++i)
+			same = same && *bytecode[i] == reference[i];
+		Expect(same, "warm: bytecode matches what was compiled", failures);
+
+		cache.Save();
+		Expect(cache.GetStats().BytesWritten == 0, "warm: unchanged pack not rewritten", failures);
+	}
+
+	// 3)      include:   main
+	{
+		writeFile(brdfFile, "float4 Shade() { return 0.5; }\n");
+		compiles = 0;
+		ShaderCache cache(packPath, salt);
+		cache.Load();
+		cache.Get(keys.data(), keys.size(), compile, bytecode);
+		Expect(cache.GetStats().Stale == mainCount && cache.GetStats().Hits == otherCount, "include edit: main stale, other hit", failures);
+		Expect(*bytecode[0] != reference[0], "include edit: new bytecode", failures);
+		cache.Save();
+	}
+
+	// 4)  ,    (include  #ifdef  )
+	{
+		writeFile(missingFile, "#define EXTRA_VALUE 1\n");
+		ShaderCache cache(packPath, salt);
+		cache.Load();
+		cache.Get(keys.data(), keys.size(), compile, bytecode);
+		Expect(cache.GetStats().Stale == mainCount, "created include: main stale", failures);
+		cache.Save();
+	}
+
+	// 5)  : ,  ,  define - ,    
+	{
+		ShaderCache cache(packPath, salt);
+		cache.Load();
+		ShaderCache::Key key = keys[0];
+		key.Flags = 1;
+		cache.Get(key, compile);
+		key = keys[0];
+		key.EntryPoint = "PS2";
+		cache.Get(key, compile);
+		key = keys[0];
+		key.Defines[0].Value = "9";
+		cache.Get(key, compile);
+		key = keys[0];
+		key.Defines.push_back({ "EXTRA", "" });
+		cache.Get(key, compile);
+		Expect(cache.GetStats().Misses == 4, "changed key fields: misses", failures);
+	}
+
+	// 6)    : ,  
+	{
+		std::vector<ShaderCache::Key> batch = { keys[0], keys[1] };
+		batch[0].Defines.push_back({ "NEW", "1" });
+		batch[1].Defines.push_back({ "FAIL", "1" });
+
+		ShaderCache cache(packPath, salt);
+		cache.Load();
+		bool threw = false;
+		try {
+			cache.Get(batch.data(), batch.size(), compile, bytecode);
+		}
+		catch (const std::runtime_error&) {
+			threw = true;
+		}
+		Expect(threw, "compile error: rethrown", failures);
+		cache.Save();
+
+		ShaderCache reloaded(packPath, salt);
+		reloaded.Load();
+		reloaded.Get(batch[0], compile);
+		Expect(reloaded.GetStats().Hits == 1, "compile error: the other shader kept", failures);
+	}
+
+	// 7)  ,    :  ,  
+	{
+		ShaderCache foreign(packPath, "fake_compiler_2");
+		Expect(!foreign.Load() && foreign.EntryCount() == 0, "other salt: rejected", failures);
+
+		std::vector<char> pack;
+		{
+			std::ifstream in(packPath, std::ios::binary);
+			pack.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+		}
+
+		std::mt19937 rng(49);
+		int rejected = 0;
+		const int trials = 200;
+		for (int t = 0; t < trials; ++t) {
+			std::vector<char> damaged = pack;
+			if (t % 2 == 0)
+				damaged[rng() % damaged.size()] ^= static_cast<char>(1 + rng() % 255);
+			else
+				damaged.resize(rng() % damaged.size());
+			{
+				std::ofstream out(packPath, std::ios::binary | std::ios::trunc);
+				out.write(damaged.data(), std::streamsize(damaged.size()));
+			}
+
+			ShaderCache cache(packPath, salt);
+			rejected += !cache.Load() && cache.EntryCount() == 0;
+		}
+		Expect(rejected == trials, "damaged pack: rejected", failures);
+
+		ShaderCache cache(packPath, salt);
+		cache.Load();
+		cache.Get(keys.data(), keys.size(), compile, bytecode);
+		Expect(cache.GetStats().Misses == keys.size(), "damaged pack: everything recompiled", failures);
+		cache.Save();
+	}
+
+	snprintf(report, sizeof(report), "[ShaderCache] check: %u permutations of 2 sources, 3-level includes, %u failures\n",
+		mainCount + otherCount, failures);
+	Report(report);
+
+	// 8)      : , ,  
+	for (uint32_t count : { 64u, 512u, 4096u }) {
+		std::vector<ShaderCache::Key> many;
+		for (uint32_t i = 0; i < count; ++i)
+			many.push_back({ mainFile, "PS", "ps_5_1", { { "MATERIAL", std::to_string(i) } }, 0 });
+
+		std::filesystem::remove(packPath, error);
+		{
+			ShaderCache cache(packPath, salt);
+			cache.Get(many.data(), many.size(), compile, bytecode);
+			cache.Save();
+		}
+
+		uint64_t packBytes = 0;
+		const double loadMs = Milliseconds(20, [&]() {
+			ShaderCache cache(packPath, salt);
+			cache.Load();
+			packBytes = cache.GetStats().BytesRead;
+		});
+
+		ShaderCache cache(packPath, salt);
+		cache.Load();
+		const double getMs = Milliseconds(20, [&]() { cache.Get(many.data(), many.size(), compile, bytecode); });
+
+		snprintf(report, sizeof(report), "  %4u shaders, pack %7.1f KB: load %.3f ms (%.0f MB/s), lookup %.3f ms\n",
+			count, packBytes / 1024.0, loadMs, packBytes / (loadMs / 1000.0) / (1024.0 * 1024.0), getMs);
+		Report(report);
+	}
+
+	std::filesystem::remove_all(root, error);
+}
+
+void Benchmarks::RunPipelineCache() {
+	char report[256];
+
+	uint32_t failures = 0;
+
+	// 1)  PsoCache::HashDesc:       -   , 
+	//       - ,       
+	std::mt19937 rng(50);
+	std::vector<uint8_t> vs(3000), ps(5000);
+	for (uint8_t& byte : vs)
+		byte = static_cast<uint8_t>(rng());
+	for (uint8_t& byte : ps)
+		byte = static_cast<uint8_t>(rng());
+
+	struct Layout {
+		std::string Names[2] = { "POSITION", "NORMAL" };
+		D3D12_INPUT_ELEMENT_DESC Elements[2] = {};
+	};
+
+	//        
+	auto makeDesc = [](const std::vector<uint8_t>& vsCode, const std::vector<uint8_t>& psCode, Layout& layout) {
+		for (int i = 0; i < 2; ++i)
+			layout.Elements[i] = { layout.Names[i].c_str(), 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, UINT(12 * i), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 };
+
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = {};
+		desc.VS = { vsCode.data(), vsCode.size() };
+		desc.PS = { psCode.data(), psCode.size() };
+		desc.InputLayout = { layout.Elements, 2 };
+		desc.RasterizerState.FillMode = D3D12_FILL_MODE_SOLID;
+		desc.RasterizerState.CullMode = D3D12_CULL_MODE_BACK;
+		desc.RasterizerState.DepthClipEnable = TRUE;
+		desc.BlendState.RenderTarget[0].SrcBlend = D3D12_BLEND_ONE;
+		desc.BlendState.RenderTarget[0].DestBlend = D3D12_BLEND_ZERO;
+		desc.BlendState.RenderTarget[0].BlendOp = D3D12_BLEND_OP_ADD;
+		desc.BlendState.RenderTarget[0].RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
+		desc.DepthStencilState.DepthEnable = TRUE;
+		desc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
+		desc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS;
+		desc.SampleMask = D3D12_DEFAULT_SAMPLE_MASK;
+		desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+		desc.NumRenderTargets = 1;
+		desc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+		desc.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
+		desc.SampleDesc.Count = 1;
+		return desc;
+	};
+
+	const uint64_t rootSignature = 0x1234;
+	Layout layout, otherLayout;
+	const D3D12_GRAPHICS_PIPELINE_STATE_DESC base = makeDesc(vs, ps, layout);
+	const uint64_t baseKey = PsoCache::HashDesc(base, rootSignature);
+
+	{
+		const std::vector<uint8_t> vsCopy = vs, psCopy = ps;
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC same = makeDesc(vsCopy, psCopy, otherLayout);
+		Expect(PsoCache::HashDesc(same, rootSignature) == baseKey, "hash: same contents elsewhere in memory", failures);
+
+		same.pRootSignature = reinterpret_cast<ID3D12RootSignature*>(uintptr_t(0x1000));
+		same.RTVFormats[5] = DXGI_FORMAT_R32_FLOAT;
+		same.BlendState.RenderTarget[3].BlendEnable = TRUE;
+		same.CachedPSO = { vs.data(), 16 };
+		Expect(PsoCache::HashDesc(same, rootSignature) == baseKey, "hash: fields the driver does not read", failures);
+	}
+
+	{
+		std::vector<uint8_t> vsFlipped = vs;
+		vsFlipped[vsFlipped.size() / 2] ^= 1;
+		std::vector<uint8_t> psShort(ps.begin(), ps.end() - 4);
+
+		std::vector<std::function<void(D3D12_GRAPHICS_PIPELINE_STATE_DESC&)>> mutations = {
+			[&](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.VS = { vsFlipped.data(), vsFlipped.size() }; },
+			[&](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.PS = { psShort.data(), psShort.size() }; },
+			[&](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.GS = d.VS; },
+			[](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.RasterizerState.CullMode = D3D12_CULL_MODE_NONE; },
+			[](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.RasterizerState.FillMode = D3D12_FILL_MODE_WIREFRAME; },
+			[](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.RasterizerState.DepthBias = 1; },
+			[](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.BlendState.RenderTarget[0].BlendEnable = TRUE; },
+			[](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.BlendState.RenderTarget[0].RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_RED; },
+			[](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.BlendState.IndependentBlendEnable = TRUE; },
+			[](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.BlendState.AlphaToCoverageEnable = TRUE; },
+			[](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS_EQUAL; },
+			[](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.DepthStencilState.StencilReadMask = 0x0F; },
+			[](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.DepthStencilState.BackFace.StencilFunc = D3D12_COMPARISON_FUNC_EQUAL; },
+			[](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.SampleMask = 1; },
+			[](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_LINE; },
+			[](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.IBStripCutValue = D3D12_INDEX_BUFFER_STRIP_CUT_VALUE_0xFFFF; },
+			[](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.NumRenderTargets = 2; d.RTVFormats[1] = DXGI_FORMAT_R16G16_FLOAT; },
+			[](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB; },
+			[](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.DSVFormat = DXGI_FORMAT_D32_FLOAT; },
+			[](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.SampleDesc.Count = 4; },
+			[](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { d.InputLayout.NumElements = 1; },
+			[&](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { otherLayout.Names[1] = "TEXCOORD"; d.InputLayout = { otherLayout.Elements, 2 }; },
+			[&](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { otherLayout.Elements[1].SemanticIndex = 1; d.InputLayout = { otherLayout.Elements, 2 }; },
+			[&](D3D12_GRAPHICS_PIPELINE_STATE_DESC& d) { otherLayout.Elements[1].Format = DXGI_FORMAT_R16G16B16A16_FLOAT; d.InputLayout = { otherLayout.Elements, 2 }; },
+		};
+
+		std::vector<uint64_t> keys = { baseKey, PsoCache::HashDesc(base, rootSignature + 1) };
+		for (const auto& mutate : mutations) {
+			otherLayout = Layout(); // :      
+			makeDesc(vs, ps, otherLayout);
+			D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = base;
+			mutate(desc);
+			keys.push_back(PsoCache::HashDesc(desc, rootSignature));
+		}
+		std::sort(keys.begin(), keys.end());
+		Expect(std::unique(keys.begin(), keys.end()) == keys.end(), "hash: every field that matters changes the key", failures);
+
+		snprintf(report, sizeof(report), "[PipelineCache] hash: %zu field changes, %u failures so far\n", mutations.size() + 1, failures);
+		Report(report);
+	}
+
+	const int hashes = 20000;
+	uint64_t sink = 0;
+	const double hashMs = Milliseconds(hashes, [&]() { sink += PsoCache::HashDesc(base, rootSignature); });
+	snprintf(report, sizeof(report), "  HashDesc with %zu bytes of bytecode: %.2f us (%.1f GB/s)%s\n",
+		vs.size() + ps.size(), hashMs * 1000.0, (vs.size() + ps.size()) / (hashMs / 1000.0) / 1e9, sink == 1 ? " " : "");
+	Report(report);
+
+	// 2)   :  x  x ,    
+	//    ,  .   -    ,   
+	const uint32_t materials = 16, passes = 4, variants = 3, states = 6;
+	const double buildMs = 2.0;
+
+	auto spin = [](double ms) {
+		const int64_t start = Clock::Now();
+		while (Clock::ToSeconds(Clock::Now() - start) * 1000.0 < ms) {
+		}
+	};
+
+	std::vector<uint64_t> requests;
+	for (uint32_t m = 0; m < materials; ++m) {
+		for (uint32_t p = 0; p < passes; ++p) {
+			for (uint32_t v = 0; v < variants; ++v) {
+				PipelineCache::Hasher hasher;
+				hasher.Value(p);
+				hasher.Value(m % states);
+				hasher.Value(v);
+				requests.push_back(hasher.Get());
+			}
+		}
+	}
+	const uint32_t unique = passes * states * variants;
+
+	for (bool async : { false, true }) {
+		std::unordered_map<uint64_t, std::atomic<uint32_t>> builds;
+		for (uint64_t key : requests)
+			builds[key] = 0;
+
+		const int64_t start = Clock::Now();
+		PipelineCache cache;
+		std::vector<PipelineCache::Handle> handles;
+		for (uint64_t key : requests) {
+			std::atomic<uint32_t>* counter = &builds[key];
+			handles.push_back(cache.Request(key, [counter, &spin, buildMs](PipelineCache::Handle) { ++*counter; spin(buildMs); }, async));
+		}
+
+		//     : Wait    
+		const double firstUseMs = Milliseconds(1, [&]() { cache.Wait(handles.back()); });
+		cache.WaitAll();
+		const double totalMs = Clock::ToSeconds(Clock::Now() - start) * 1000.0;
+
+		bool once = true;
+		for (const auto& build : builds)
+			once = once && build.second == 1;
+		bool sameHandles = true;
+		for (size_t i = 0; i < requests.size(); ++i)
+			sameHandles = sameHandles && cache.Key(handles[i]) == requests[i] && cache.Find(requests[i]) == handles[i];
+
+		const PipelineCache::Stats stats = cache.GetStats();
+		Expect(once && cache.Count() == unique, "dedup: every state built exactly once", failures);
+		Expect(sameHandles, "dedup: equal keys share a handle", failures);
+		Expect(stats.Built == unique && stats.Deduplicated == requests.size() - unique, "dedup: stats", failures);
+
+		snprintf(report, sizeof(report),
+			"  %s: %zu requests, %u built (%.1f ms each), %u deduplicated: %.1f ms total, last one ready after %.1f ms, %u built by the waiter\n",
+			async ? "async" : "sync ", requests.size(), stats.Built, buildMs, stats.Deduplicated, totalMs,
+			async ? firstUseMs : totalMs, stats.BuiltInline);
+		Report(report);
+	}
+
+	// 3)  :   Wait ( ),   
+	{
+		PipelineCache cache;
+		const PipelineCache::Handle bad = cache.Request(1, [](PipelineCache::Handle) { throw std::runtime_error("driver said no"); });
+		const PipelineCache::Handle good = cache.Request(2, [](PipelineCache::Handle) {});
+		int thrown = 0;
+		for (int i = 0; i < 2; ++i) {
+			try {
+				cache.Wait(bad);
+			}
+			catch (const std::runtime_error&) {
+				++thrown;
+			}
+		}
+		cache.Wait(good);
+		cache.WaitAll();
+		Expect(thrown == 2 && cache.GetState(bad) == PipelineCache::State::Failed && cache.IsReady(good), "failure: reported on every Wait", failures);
+		Expect(cache.Request(1, nullptr) == bad && cache.GetStats().Failed == 1, "failure: not rebuilt", failures);
+	}
+
+	// 4)  ,      
+	{
+		std::atomic<uint32_t> done{ 0 };
+		{
+			PipelineCache cache;
+			for (uint64_t key = 0; key < 64; ++key)
+				cache.Request(key, [&done, &spin](PipelineCache::Handle) { spin(0.05); ++done; });
+		}
+		Expect(done == 64, "destruction: waits for every build", failures);
+	}
+
+	//     
+	PipelineCache lookup;
+	for (uint64_t key : requests)
+		lookup.Request(key, [](PipelineCache::Handle) {}, false);
+	const int lookups = 1000000;
+	size_t next = 0;
+	const double lookupMs = Milliseconds(1, [&]() {
+		for (int i = 0; i < lookups; ++i) {
+			lookup.Request(requests[next], nullptr);
+			next = next + 1 == requests.size() ? 0 : next + 1;
+		}
+	});
+
+	snprintf(report, sizeof(report), "[PipelineCache] repeat request %.1f ns; %u failures\n", lookupMs * 1e6 / lookups, failures);
+	Report(report);
+}
@@ -0,0 +1,119 @@
+#include "FramePacer.hpp"
+#include "Clock.h"
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <chrono>
+#include <thread>
+#endif
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+SystemPacingClock::SystemPacingClock() {
+#if defined(_WIN32)
+	//      Windows 10 1803,    Sleep
+	m_timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+#endif
+}
+
+SystemPacingClock::~SystemPacingClock() {
+#if defined(_WIN32)
+	if (m_timer)
+		CloseHandle(m_timer);
+#endif
+}
+
+int64_t SystemPacingClock::Now() {
+	return Clock::Now();
+}
+
+int64_t SystemPacingClock::Frequency() {
+	return Clock::Frequency();
+}
+
+void SystemPacingClock::SleepFor(double seconds) {
+	if (seconds <= 0.0)
+		return;
+
+#if defined(_WIN32)
+	if (m_timer) {
+		LARGE_INTEGER due;
+		due.QuadPart = -static_cast<LONGLONG>(seconds * 1e7); //  ,  100 
+
+		if (SetWaitableTimerEx(m_timer, &due, 0, nullptr, nullptr, nullptr, 0)) {
+			WaitForSingleObject(m_timer, INFINITE);
+			return;
+		}
+	}
+
+	Sleep(static_cast<DWORD>(seconds * 1000.0));
+#else
+	std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+#endif
+}
+
+FramePacer::FramePacer(IPacingClock& clock)
+	: m_clock(clock)
+{
+}
+
+void FramePacer::SetTargetFps(double fps) {
+	m_targetFps = fps > 0.0 ? fps : 0.0;
+	m_period = m_targetFps > 0.0 ? static_cast<int64_t>(static_cast<double>(m_clock.Frequency()) / m_targetFps) : 0;
+
+	Reset();
+}
+
+void FramePacer::Reset() {
+	m_nextDeadline = 0;
+	m_missedDeadlines = 0;
+}
+
+double FramePacer::WaitForNextFrame() {
+	if (m_period <= 0)
+		return 0.0;
+
+	const double secondsPerTick = 1.0 / static_cast<double>(m_clock.Frequency());
+
+	const int64_t start = m_clock.Now();
+	int64_t now = start;
+
+	if (m_nextDeadline == 0) {
+		m_nextDeadline = now + m_period;
+		return 0.0;
+	}
+
+	while (now < m_nextDeadline) {
+		const double remaining = static_cast<double>(m_nextDeadline - now) * secondsPerTick;
+		const double sleepBudget = remaining - m_sleepOvershoot - MinSpinSeconds;
+
+		if (sleepBudget >= MinSleepSeconds) {
+			const int64_t before = now;
+			m_clock.SleepFor(sleepBudget);
+			now = m_clock.Now();
+
+			//      :     
+			const double overshoot = static_cast<double>(now - before) * secondsPerTick - sleepBudget;
+			const double k = overshoot > m_sleepOvershoot ? 0.5 : 0.05;
+			m_sleepOvershoot += k * (overshoot - m_sleepOvershoot);
+
+			if (m_sleepOvershoot < 0.0)
+				m_sleepOvershoot = 0.0;
+		}
+		else {
+			now = m_clock.Now();
+		}
+	}
+
+	//    ,        - 
+	m_nextDeadline += m_period;
+	if (now - m_nextDeadline > 0) {
+		++m_missedDeadlines;
+		m_nextDeadline = now + m_period;
+	}
+
+	return static_cast<double>(now - start) * secondsPerTick;
+}
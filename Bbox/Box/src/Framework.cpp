@@ -1,4 +1,8 @@
 #include "Framework.hpp"
+#include "Profiler.h"
+#include "JobSystem.h"
+#include "BatchTransform.h"
+#include "Meshlets.h"
 #include <DirectXColors.h>
 #include <DirectXMath.h>
 #include <array>
@@ -14,6 +18,8 @@
 #include <vector>
 #include <algorithm>
 #include <cfloat>
+#include <cstdio>
+#include <cstring>
 
 #if defined(_DEBUG)
 #include <d3d12sdklayers.h>
@@ -21,6 +27,16 @@
 
 using namespace DirectX;
 
+static_assert(sizeof(XMFLOAT4X4) == sizeof(BatchTransform::Float4x4), "BatchTransform::Float4x4 must match XMFLOAT4X4");
+
+//      HLSL:   3x3   World
+static void StoreNormalMatrix(const XMFLOAT4X4& world, XMFLOAT4X4& normal)
+{
+	BatchTransform::AffineInverseTranspose(
+		reinterpret_cast<const BatchTransform::Float4x4*>(&world), 1,
+		reinterpret_cast<BatchTransform::Float4x4*>(&normal), BatchTransform::Layout::Transposed);
+}
+
 Framework::Framework(int width, int height, const wchar_t* title)
 	: m_initWidth(width)
 	, m_initHeight(height)
@@ -38,12 +54,23 @@ Framework::~Framework() {
 		CloseHandle(m_fenceEvent);
 		m_fenceEvent = nullptr;
 	}
+
+	if (m_frameLatencyWaitable) {
+		CloseHandle(m_frameLatencyWaitable);
+		m_frameLatencyWaitable = nullptr;
+	}
+
+	if (m_idleFenceEvent) {
+		CloseHandle(m_idleFenceEvent);
+		m_idleFenceEvent = nullptr;
+	}
 }
 
 bool Framework::Init() {
 	m_window = std::make_unique<Window>(m_initWidth, m_initHeight, m_title, this);
 
 	InitDxgi();
+	CheckTearingSupport();
 	InitD3D12Device();
 	m_cbvSrvUavDescriptorSize = m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 	CreateCommandObjects();
@@ -51,38 +78,254 @@ bool Framework::Init() {
 	CreateSwapChain();
 	CreateRtvAndDsvDescriptorHeaps();
 	BuildShaders();
-	BuildConstantBuffers();
-	BuildCbvHeap();
+	BuildMeshes();
+	BuildRenderItems();
+	BuildFrameResources();
+	BuildDescriptorHeap();
 	BuildCbvViews();
+	BuildMaterialBuffer();
 	BuildRootSignature();
 	BuildPSO();
-	BuildBoxGeometry();
-	BuildObjVB_Upload();
+	BuildCommandSignature();
 
 	OnResize();
 
+	if (m_benchmarkConstants)
+		BenchmarkConstantUpdates(600);
+
+	if (m_benchmarkInstancing)
+		BenchmarkInstancePacking(100);
+
+	if (m_benchmarkBindless)
+		BenchmarkMaterialBinding(200);
+
+	if (m_benchmarkShaderCache)
+		BenchmarkShaderCache(50);
+
+	if (m_benchmarkPsoCache)
+		BenchmarkPsoCache(5);
+
 	return MainWnd() != nullptr;
 }
 
 int Framework::Run() {
+	PROFILE_THREAD_NAME("Main");
 	m_timer.Reset();
 
-	while (m_window->ProcessMessages()) {
-		m_timer.Tick();
+	while (true) {
+		PROFILE_ZONE("Frame");
 
-		if (!m_appPaused) {
-			const double dt = m_timer.DeltaTime();
-			Update(dt);
-			Draw();
+		{
+			PROFILE_ZONE("ProcessMessages");
+			if (!m_window->ProcessMessages())
+				break;
 		}
-		else {
-			Sleep(100);
+
+		//   -     fence   
+		if (m_appPaused || (m_idleRendering && !NeedsRedraw())) {
+			WaitForWork();
+			continue;
+		}
+
+		if (m_idleTimerStopped) {
+			m_timer.Start();
+			m_idleTimerStopped = false;
 		}
+
+		//   Update/Draw: ,    ,    
+		m_redrawPending = false;
+
+		m_timer.Tick();
+
+		BeginFrame();
+
+		const double dt = m_timer.SmoothedDeltaTime();
+		UpdateFrameStatsHud();
+		Update(dt);
+		Draw();
 	}
 
+#if PROFILER_ENABLED
+	Profiler::ExportChromeTrace(L"trace.json");
+#endif
+
+	const FrameStats::Summary s = m_timer.Stats().Summarize();
+	char report[256];
+	snprintf(report, sizeof(report),
+		"[FrameStats] frames %u  avg %.2f ms  p50 %.2f  p95 %.2f  p99 %.2f  max %.2f  stutters %u\n",
+		s.SampleCount, s.AverageMs, s.P50Ms, s.P95Ms, s.P99Ms, s.MaxMs, s.StutterCount);
+	OutputDebugStringA(report);
+
+	ReportPacingStats();
+	ReportIdleStats();
+	ReportConstantStats();
+	ReportInstancingStats();
+	ReportCullingStats();
+	ReportClusterStats();
+
 	return 0;
 }
 
+static double ProcessCpuSeconds()
+{
+	FILETIME creation, exit, kernel, user;
+	if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+		return 0.0;
+
+	const auto toSeconds = [](const FILETIME& ft) {
+		const uint64_t t = (static_cast<uint64_t>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime;
+		return static_cast<double>(t) * 1e-7; //  100 
+	};
+
+	return toSeconds(kernel) + toSeconds(user);
+}
+
+bool Framework::NeedsRedraw() const
+{
+	if (m_redrawPending)
+		return true;
+
+	//  ,   ,     WM_KEYDOWN
+	return m_keyDown['W'] || m_keyDown['A'] || m_keyDown['S'] || m_keyDown['D'] ||
+		m_keyDown[VK_SPACE] || m_keyDown[VK_CONTROL];
+}
+
+void Framework::WaitForWork()
+{
+	PROFILE_ZONE("Framework::WaitForWork");
+
+	//      (,    RMB) -   resume
+	m_wakeTime = 0;
+
+	if (!m_appPaused && !m_idleTimerStopped) {
+		m_timer.Stop();
+		m_idleTimerStopped = true;
+	}
+
+	//  GPU    ,    fence.  
+	//   ,   idle CPU       
+	HANDLE handles[1] = {};
+	DWORD count = 0;
+
+	if (m_fence->GetCompletedValue() < m_currentFence) {
+		ThrowIfFailed(m_fence->SetEventOnCompletion(m_currentFence, m_idleFenceEvent));
+		handles[count++] = m_idleFenceEvent;
+	}
+	else if (m_idleStartTime == 0) {
+		m_idleStartTime = Clock::Now();
+		m_idleStartCpu = ProcessCpuSeconds();
+	}
+
+	++m_idleWaits;
+	const DWORD result = m_window->WaitForMessages(handles, count, INFINITE);
+
+	if (result != WAIT_OBJECT_0 + count)
+		return;
+
+	if (m_idleStartTime != 0) {
+		m_idleWallSeconds += Clock::ToSeconds(Clock::Now() - m_idleStartTime);
+		m_idleCpuSeconds += ProcessCpuSeconds() - m_idleStartCpu;
+		m_idleStartTime = 0;
+	}
+
+	m_wakeTime = Clock::Now();
+}
+
+void Framework::ReportIdleStats() const
+{
+	const double cpuPercent = m_idleWallSeconds > 0.0 ? 100.0 * m_idleCpuSeconds / m_idleWallSeconds : 0.0;
+	const FrameStats::Summary resume = m_resumeLatency.Summarize();
+
+	char report[256];
+	snprintf(report, sizeof(report),
+		"[Idle] idle %.1f s  cpu %.3f%% of a core  waits %u  |  wake->present p50 %.2f p95 %.2f max %.2f ms (%u samples)\n",
+		m_idleWallSeconds, cpuPercent, m_idleWaits,
+		resume.P50Ms, resume.P95Ms, resume.MaxMs, resume.SampleCount);
+	OutputDebugStringA(report);
+}
+
+void Framework::BeginFrame()
+{
+	PROFILE_ZONE("Framework::BeginFrame");
+
+	m_pacingStats[static_cast<size_t>(m_presentMode)].Frame.AddSample(m_timer.DeltaTime());
+
+	// Waitable swap chain: ,  DXGI      ,
+	//      (  )  m_maxFrameLatency
+	if (m_frameLatencyWaitable) {
+		PROFILE_ZONE("WaitFrameLatency");
+		WaitForSingleObjectEx(m_frameLatencyWaitable, 1000, TRUE);
+	}
+
+	if (m_presentMode == PresentMode::Capped) {
+		PROFILE_ZONE("FramePacer::Wait");
+		m_pacer.WaitForNextFrame();
+	}
+
+	//    frame resource   GPU,      
+	m_currFrameResourceIndex = (m_currFrameResourceIndex + 1) % NumFrameResources;
+	m_currFrameResource = m_frameResources[m_currFrameResourceIndex].get();
+
+	if (m_currFrameResource->Fence != 0 && m_fence->GetCompletedValue() < m_currFrameResource->Fence) {
+		PROFILE_ZONE("WaitFrameResource");
+		ThrowIfFailed(m_fence->SetEventOnCompletion(m_currFrameResource->Fence, m_fenceEvent));
+		WaitForSingleObject(m_fenceEvent, INFINITE);
+	}
+}
+
+void Framework::SetPresentMode(PresentMode mode)
+{
+	if (mode == PresentMode::Unthrottled && !m_tearingSupported)
+		OutputDebugStringW(L"[Pacing] Tearing is not supported, Unthrottled mode stays vsync-limited by DWM\n");
+
+	ReportPacingStats();
+
+	m_presentMode = mode;
+	m_pacer.SetTargetFps(mode == PresentMode::Capped ? m_frameCapFps : 0.0);
+
+	for (auto& stats : m_pacingStats)
+		stats = PacingStats{};
+}
+
+void Framework::ReportPacingStats() const
+{
+	static const char* modeNames[] = { "VSync", "Unthrottled", "Capped" };
+
+	for (size_t i = 0; i < m_pacingStats.size(); ++i) {
+		const FrameStats::Summary frame = m_pacingStats[i].Frame.Summarize();
+		const FrameStats::Summary latency = m_pacingStats[i].InputToPresent.Summarize();
+
+		if (frame.SampleCount == 0)
+			continue;
+
+		char report[320];
+		snprintf(report, sizeof(report),
+			"[Pacing] %-11s frame p50 %.2f p99 %.2f ms  |  input->present p50 %.2f p95 %.2f p99 %.2f ms (%u samples)  maxLatency %u  missed %u\n",
+			modeNames[i], frame.P50Ms, frame.P99Ms,
+			latency.P50Ms, latency.P95Ms, latency.P99Ms, latency.SampleCount,
+			m_maxFrameLatency, m_pacer.MissedDeadlines());
+		OutputDebugStringA(report);
+	}
+}
+
+void Framework::UpdateFrameStatsHud()
+{
+	//      ,    SetWindowText  
+	m_hudElapsed += m_timer.DeltaTime();
+	if (m_hudElapsed < 0.5)
+		return;
+
+	m_hudElapsed = 0.0;
+
+	const FrameStats::Summary s = m_timer.Stats().Summarize();
+
+	wchar_t title[256];
+	swprintf_s(title, L"%s    fps: %.1f   p50: %.2f ms   p95: %.2f ms   p99: %.2f ms   stutters: %u",
+		m_title, s.Fps, s.P50Ms, s.P95Ms, s.P99Ms, s.StutterCount);
+
+	SetWindowTextW(MainWnd(), title);
+}
+
 LRESULT Framework::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
 	switch (msg) {
 	case WM_CLOSE:
@@ -143,6 +386,7 @@ LRESULT Framework::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
 		{
 			m_appPaused = false;
 			m_timer.Start();
+			RequestRedraw();
 		}
 		return 0;
 
@@ -162,6 +406,7 @@ LRESULT Framework::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
 	case WM_LBUTTONDOWN:
 	case WM_MBUTTONDOWN:
 	case WM_RBUTTONDOWN:
+		MarkInput();
 		OnMouseDown(hwnd, wParam, GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam));
 		return 0;
 
@@ -172,6 +417,8 @@ LRESULT Framework::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
 		return 0;
 
 	case WM_MOUSEMOVE:
+		if (m_rmbDown)
+			MarkInput();
 		OnMouseMove(hwnd, wParam, GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam));
 		return 0;
 
@@ -180,6 +427,56 @@ LRESULT Framework::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
 	{
 		const uint8_t vk = static_cast<uint8_t>(wParam);
 		m_keyDown[vk] = true;
+		MarkInput();
+
+		const bool firstPress = !(lParam & (1 << 30));
+
+		// F2 -   present, F3 -    (1..3)
+		if (vk == VK_F2 && firstPress) {
+			const int next = (static_cast<int>(m_presentMode) + 1) % static_cast<int>(PresentMode::Count);
+			SetPresentMode(static_cast<PresentMode>(next));
+		}
+
+		// F4 - idle- (   ) /  
+		if (vk == VK_F4 && firstPress)
+			m_idleRendering = !m_idleRendering;
+
+		// F6 -  :  draw call / 
+		if (vk == VK_F6 && firstPress) {
+			ReportInstancingStats();
+			m_drawInstanced = !m_drawInstanced;
+			ApplyDrawMode();
+		}
+
+		// F7 - : BVH /     
+		if (vk == VK_F7 && firstPress) {
+			ReportCullingStats();
+			m_cullWithBvh = !m_cullWithBvh;
+		}
+
+		// F8 - LOD     /   
+		if (vk == VK_F8 && firstPress) {
+			ReportLodStats();
+			m_lodEnabled = !m_lodEnabled;
+		}
+
+		// F9 -   /  
+		if (vk == VK_F9 && firstPress) {
+			ReportClusterStats();
+			m_clusterCulling = !m_clusterCulling;
+		}
+
+		if (vk == VK_F3 && firstPress && m_swapChain) {
+			m_maxFrameLatency = m_maxFrameLatency % 3 + 1;
+			if (m_frameLatencyWaitable)
+				ThrowIfFailed(m_swapChain->SetMaximumFrameLatency(m_maxFrameLatency));
+		}
+
+#if PROFILER_ENABLED
+		// F12 -     trace.json (chrome://tracing / Perfetto)
+		if (vk == VK_F12 && firstPress)
+			Profiler::ExportChromeTrace(L"trace.json");
+#endif
 		return 0;
 	}
 
@@ -191,6 +488,11 @@ LRESULT Framework::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
 		return 0;
 	}
 
+	case WM_PAINT:
+		//  / - ,   DefWindowProc
+		RequestRedraw();
+		break;
+
 	//       "" 
 	case WM_KILLFOCUS:
 	{
@@ -228,6 +530,9 @@ void Framework::OnResize()
 	if (!m_device || !m_swapChain || !m_commandQueue || !m_directCmdListAlloc || !m_commandList)
 		return;
 
+	RequestRedraw();
+	MarkPassDirty();
+
 	FlushCommandQueue();
 
 	ThrowIfFailed(m_directCmdListAlloc->Reset());
@@ -239,7 +544,7 @@ void Framework::OnResize()
 
 	m_depthStencilBuffer.Reset();
 
-	ThrowIfFailed(m_swapChain->ResizeBuffers(SwapChainBufferCount, m_clientWidth, m_clientHeight, m_backBufferFormat, 0));
+	ThrowIfFailed(m_swapChain->ResizeBuffers(SwapChainBufferCount, m_clientWidth, m_clientHeight, m_backBufferFormat, m_swapChainFlags));
 
 	m_currBackBuffer = static_cast<int>(m_swapChain->GetCurrentBackBufferIndex());
 
@@ -308,20 +613,14 @@ void Framework::OnResize()
 	m_screenViewport.MaxDepth = 1.0f;
 
 	m_scissorRect = { 0, 0, m_clientWidth, m_clientHeight };
+
+	//   - 256      
+	m_occlusion.Resize(256, (std::max)(1, 256 * m_clientHeight / (std::max)(m_clientWidth, 1)));
 }
 
 void Framework::Update(const double& dt)
 {
-	ObjectConstants obj = {};
-	XMMATRIX world =
-		XMMatrixTranslation(-m_modelCenter.x, -m_modelCenter.y, -m_modelCenter.z) *
-		XMMatrixScaling(m_modelScale, m_modelScale, m_modelScale);
-	XMMATRIX worldInvTranspose = XMMatrixTranspose(XMMatrixInverse(nullptr, world));
-
-	XMStoreFloat4x4(&obj.World, XMMatrixTranspose(world));
-	XMStoreFloat4x4(&obj.WorldInvTranspose, worldInvTranspose);
-
-	m_objectCB->CopyData(0, obj);
+	PROFILE_ZONE("Framework::Update");
 
 	XMVECTOR pos = XMLoadFloat3(&m_camPos);
 	XMVECTOR target = XMLoadFloat3(&m_camTarget);
@@ -344,21 +643,76 @@ void Framework::Update(const double& dt)
 	if (m_keyDown[VK_SPACE])   move += up;
 	if (m_keyDown[VK_CONTROL]) move -= up;
 
-	if (!XMVector3Equal(move, XMVectorZero()))
+	if (!XMVector3Equal(move, XMVectorZero()) && step > 0.0f) {
 		move = XMVector3Normalize(move) * step;
 
-	pos += move;
-	target += move;
+		pos += move;
+		target += move;
 
-	XMStoreFloat3(&m_camPos, pos);
-	XMStoreFloat3(&m_camTarget, target);
+		XMStoreFloat3(&m_camPos, pos);
+		XMStoreFloat3(&m_camTarget, target);
 
-	XMMATRIX view = XMMatrixLookAtLH(pos, target, up);
+		MarkPassDirty();
+	}
 
-	float aspect = (float)m_clientWidth / (float)m_clientHeight;
-	XMMATRIX proj = XMMatrixPerspectiveFovLH(0.25f * XM_PI, aspect, 0.1f, 1000.0f);
+	const int64_t start = Clock::Now();
+
+	UpdateSceneGraph();
+	CullAndBuildDrawList();
+	UpdateObjectCBs(false);
+	UpdatePassCB(false);
+
+	if (m_drawInstanced)
+		UpdateInstanceBuffer(false, true);
+
+	const double updateSeconds = Clock::ToSeconds(Clock::Now() - start);
+	m_constantUpdateTime.AddSample(updateSeconds);
+	m_drawModeStats[m_drawInstanced ? 1 : 0].Update.AddSample(updateSeconds);
+	++m_constantUpdateFrames;
+}
+
+void Framework::UpdateObjectCBs(bool forceAll)
+{
+	PROFILE_ZONE("Framework::UpdateObjectCBs");
+
+	std::vector<uint64_t>& written = m_currFrameResource->ObjectGenerations;
 
-	XMMATRIX viewProj = view * proj;
+	const uint32_t count = m_world.Count();
+	const RenderWorld::Entity* entities = m_world.Entities();
+	const BatchTransform::Float4x4* worlds = m_world.Worlds();
+	const uint64_t* generations = m_world.Generations();
+	const uint8_t* visibility = m_world.Visibility();
+
+	for (uint32_t i = 0; i < count; ++i) {
+		//    ,      
+		if (!forceAll && !RenderWorld::IsVisible(visibility[i]))
+			continue;
+
+		const uint32_t slot = RenderWorld::SlotOf(entities[i]);
+
+		if (!forceAll && written[slot] == generations[i])
+			continue;
+
+		const XMFLOAT4X4& world = reinterpret_cast<const XMFLOAT4X4&>(worlds[i]);
+
+		ObjectConstants obj = {};
+		XMStoreFloat4x4(&obj.World, XMMatrixTranspose(XMLoadFloat4x4(&world)));
+		StoreNormalMatrix(world, obj.WorldInvTranspose);
+
+		m_currFrameResource->ObjectCB->CopyData(slot, obj);
+
+		written[slot] = generations[i];
+		++m_objectCBWrites;
+	}
+}
+
+void Framework::UpdatePassCB(bool forceAll)
+{
+	if (!forceAll && m_currFrameResource->PassGeneration == m_passGeneration)
+		return;
+
+	XMVECTOR pos = XMLoadFloat3(&m_camPos);
+	XMMATRIX viewProj = ViewProj();
 
 	PassConstants pass{};
 	XMStoreFloat4x4(&pass.ViewProj, XMMatrixTranspose(viewProj));
@@ -371,13 +725,355 @@ void Framework::Update(const double& dt)
 	pass.Specular = { 1.0f, 1.0f, 1.0f, 1.0f };
 	pass.SpecPower = 32.0f;
 
-	m_passCB->CopyData(0, pass);
+	m_currFrameResource->PassCB->CopyData(0, pass);
+
+	m_currFrameResource->PassGeneration = m_passGeneration;
+	++m_passCBWrites;
+}
+
+void Framework::BenchmarkConstantUpdates(int iterations)
+{
+	PROFILE_ZONE("Framework::BenchmarkConstantUpdates");
+
+	//  CPU:  frame resource       command list,
+	//      fence   
+	auto resetWritten = [this]() {
+		for (auto& frame : m_frameResources) {
+			std::fill(frame->ObjectGenerations.begin(), frame->ObjectGenerations.end(), 0);
+			frame->PassGeneration = 0;
+		}
+	};
+
+	struct Result {
+		double MsPerFrame;
+		uint64_t Writes;
+	};
+
+	auto run = [&](bool forceAll) {
+		resetWritten();
+
+		const uint64_t writesBefore = m_objectCBWrites;
+		const int64_t start = Clock::Now();
+
+		for (int i = 0; i < iterations; ++i) {
+			m_currFrameResource = m_frameResources[i % NumFrameResources].get();
+			UpdateObjectCBs(forceAll);
+			UpdatePassCB(forceAll);
+		}
+
+		const double ms = Clock::ToSeconds(Clock::Now() - start) * 1000.0;
+		return Result{ ms / iterations, m_objectCBWrites - writesBefore };
+	};
+
+	//   ,        
+	const bool drawInstanced = m_drawInstanced;
+	m_drawInstanced = false;
+	ApplyDrawMode();
+	CullAndBuildDrawList();
+
+	const Result full = run(true);
+	const Result tracked = run(false);
+
+	m_drawInstanced = drawInstanced;
+	ApplyDrawMode();
+
+	//    :     
+	resetWritten();
+	m_currFrameResource = m_frameResources[m_currFrameResourceIndex].get();
+	m_objectCBWrites = 0;
+	m_passCBWrites = 0;
+
+	char report[320];
+	snprintf(report, sizeof(report),
+		"[Constants] benchmark %u objects (%u visible) x %d frames: full %.4f ms/frame (%llu writes)  tracked %.4f ms/frame (%llu writes)  x%.1f\n",
+		m_world.Count(), m_visibleCount, iterations,
+		full.MsPerFrame, static_cast<unsigned long long>(full.Writes),
+		tracked.MsPerFrame, static_cast<unsigned long long>(tracked.Writes),
+		tracked.MsPerFrame > 0.0 ? full.MsPerFrame / tracked.MsPerFrame : 0.0);
+	OutputDebugStringA(report);
+}
+
+void Framework::UpdateInstanceBuffer(bool forceAll, bool parallel)
+{
+	PROFILE_ZONE("Framework::UpdateInstanceBuffer");
+
+	if (m_instanceBatch.Count == 0)
+		return;
+
+	FrameResource* frame = m_currFrameResource;
+
+	const BatchTransform::Float4x4* worlds = m_world.Worlds();
+	const uint32_t* materials = m_world.Materials();
+	const uint64_t* generations = m_world.Generations();
+
+	//         InstanceGenerations -   
+	auto pack = [this, frame, forceAll, worlds, materials, generations](uint32_t begin, uint32_t end) {
+		PROFILE_ZONE("PackInstances");
+
+		//    ,   
+		//  BatchTransform  8  
+		constexpr uint32_t BatchSize = 64;
+		BatchTransform::Float4x4 batch[BatchSize];
+		BatchTransform::Float4x4 normals[BatchSize];
+		uint32_t slots[BatchSize];
+		uint32_t batchMaterials[BatchSize];
+		uint32_t pending = 0;
+
+		auto flush = [&]() {
+			BatchTransform::AffineInverseTranspose(batch, pending, normals, BatchTransform::Layout::Transposed);
+
+			for (uint32_t k = 0; k < pending; ++k) {
+				InstanceData data;
+				XMStoreFloat4x4(&data.World, XMMatrixTranspose(XMLoadFloat4x4(reinterpret_cast<const XMFLOAT4X4*>(&batch[k]))));
+				std::memcpy(&data.WorldInvTranspose, &normals[k], sizeof(data.WorldInvTranspose));
+				data.Material = batchMaterials[k];
+
+				frame->InstanceBuffer->CopyData(static_cast<int>(slots[k]), data);
+			}
+
+			pending = 0;
+		};
+
+		for (uint32_t i = begin; i < end; ++i) {
+			const uint32_t index = m_world.IndexOfSlot(m_instanceBatch.FirstSlot + i);
+
+			if (!forceAll && frame->InstanceGenerations[i] == generations[index])
+				continue;
+
+			batch[pending] = worlds[index];
+			batchMaterials[pending] = materials[index];
+			slots[pending++] = i;
+			frame->InstanceGenerations[i] = generations[index];
+
+			if (pending == BatchSize)
+				flush();
+		}
+
+		if (pending > 0)
+			flush();
+	};
+
+	if (parallel)
+		JobSystem::ParallelFor(m_instanceBatch.Count, InstancePackGrain, pack);
+	else
+		pack(0, m_instanceBatch.Count);
+}
+
+void Framework::BenchmarkInstancePacking(int iterations)
+{
+	PROFILE_ZONE("Framework::BenchmarkInstancePacking");
+
+	if (m_instanceBatch.Count == 0)
+		return;
+
+	//    BenchmarkConstantUpdates:     GPU,   CPU
+	auto run = [&](bool parallel) {
+		const int64_t start = Clock::Now();
+
+		for (int i = 0; i < iterations; ++i) {
+			m_currFrameResource = m_frameResources[i % NumFrameResources].get();
+			UpdateInstanceBuffer(true, parallel);
+		}
+
+		return Clock::ToSeconds(Clock::Now() - start) * 1000.0 / iterations;
+	};
+
+	const double serialMs = run(false);
+	const double parallelMs = run(true);
+
+	for (auto& frame : m_frameResources)
+		std::fill(frame->InstanceGenerations.begin(), frame->InstanceGenerations.end(), 0);
+	m_currFrameResource = m_frameResources[m_currFrameResourceIndex].get();
+
+	char report[256];
+	snprintf(report, sizeof(report),
+		"[Instancing] pack %u instances: serial %.3f ms  parallel %.3f ms (%u workers + caller)  x%.1f\n",
+		m_instanceBatch.Count, serialMs, parallelMs, JobSystem::WorkerCount(),
+		parallelMs > 0.0 ? serialMs / parallelMs : 0.0);
+	OutputDebugStringA(report);
+}
+
+void Framework::ReportInstancingStats() const
+{
+	static const char* modeNames[] = { "individual", "instanced" };
+
+	for (size_t i = 0; i < m_drawModeStats.size(); ++i) {
+		const FrameStats::Summary update = m_drawModeStats[i].Update.Summarize();
+		const FrameStats::Summary record = m_drawModeStats[i].Record.Summarize();
+		const FrameStats::Summary frame = m_drawModeStats[i].Frame.Summarize();
+
+		if (record.SampleCount == 0)
+			continue;
+
+		char report[320];
+		snprintf(report, sizeof(report),
+			"[Instancing] %-10s %u objects  update avg %.3f ms  record avg %.3f ms  frame p50 %.2f p99 %.2f ms\n",
+			modeNames[i], m_instanceBatch.Count,
+			update.AverageMs, record.AverageMs, frame.P50Ms, frame.P99Ms);
+		OutputDebugStringA(report);
+	}
+}
+
+void Framework::BenchmarkMaterialBinding(int iterations)
+{
+	PROFILE_ZONE("Framework::BenchmarkMaterialBinding");
+
+	const uint32_t count = m_world.Count();
+	if (count == 0)
+		return;
+
+	//  ,   :     
+	//    draw,   -     
+	std::vector<RenderWorld::DrawEntry> interleaved(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		interleaved[i].Key = (static_cast<uint64_t>(m_world.Meshes()[i]) << 32) | m_world.Materials()[i];
+		interleaved[i].Slot = RenderWorld::SlotOf(m_world.Entities()[i]);
+		interleaved[i].Index = i;
+	}
+
+	std::vector<RenderWorld::DrawEntry> sorted = interleaved;
+	std::sort(sorted.begin(), sorted.end(),
+		[](const RenderWorld::DrawEntry& a, const RenderWorld::DrawEntry& b) { return a.Key < b.Key; });
+
+	ID3D12DescriptorHeap* heaps[] = { m_descriptorHeap.Get() };
+	const D3D12_GPU_DESCRIPTOR_HANDLE heapStart = m_descriptorHeap->GetGPUDescriptorHandleForHeapStart();
+	const UINT64 objectCbvBase = heapStart.ptr + static_cast<UINT64>(m_objectCbvOffset) * m_cbvSrvUavDescriptorSize;
+	const D3D12_GPU_VIRTUAL_ADDRESS materialBase = m_materialBuffer->Resource()->GetGPUVirtualAddress();
+
+	D3D12_GPU_DESCRIPTOR_HANDLE textureTable = heapStart;
+	textureTable.ptr += static_cast<UINT64>(m_textureTableOffset) * m_cbvSrvUavDescriptorSize;
+
+	//  ,   :   CPU-,   
+	// BenchmarkConstantUpdates.   OnResize ,  .
+	auto record = [&](const std::vector<RenderWorld::DrawEntry>& list, bool rootConstant, uint32_t& switches) {
+		int64_t elapsed = 0;
+
+		for (int i = 0; i < iterations; ++i) {
+			ThrowIfFailed(m_directCmdListAlloc->Reset());
+			ThrowIfFailed(m_commandList->Reset(m_directCmdListAlloc.Get(), m_pso.Get()));
+
+			m_commandList->SetGraphicsRootSignature(m_rootSignature.Get());
+			m_commandList->SetDescriptorHeaps(_countof(heaps), heaps);
+			m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+			const int64_t start = Clock::Now();
+
+			if (rootConstant) {
+				m_commandList->SetGraphicsRootShaderResourceView(4, materialBase);
+				m_commandList->SetGraphicsRootDescriptorTable(5, textureTable);
+			}
+
+			MeshCache::Handle boundMesh = RenderWorld::InvalidMesh;
+			const Mesh* mesh = nullptr;
+			uint32_t boundMaterial = UINT32_MAX;
+			switches = 0;
+
+			for (const RenderWorld::DrawEntry& entry : list) {
+				const MeshCache::Handle handle = static_cast<MeshCache::Handle>(entry.Key >> 32);
+				if (handle != boundMesh) {
+					mesh = &m_meshes.Get(handle);
+					m_commandList->IASetVertexBuffers(0, 1, &mesh->VertexBufferView);
+					if (mesh->Indexed())
+						m_commandList->IASetIndexBuffer(&mesh->IndexBufferView);
+					boundMesh = handle;
+				}
+
+				const uint32_t material = static_cast<uint32_t>(entry.Key);
+				if (material != boundMaterial) {
+					if (rootConstant)
+						m_commandList->SetGraphicsRoot32BitConstant(3, material, 0);
+					else {
+						//  :        SRV,
+						//     
+						D3D12_GPU_DESCRIPTOR_HANDLE materialTable = textureTable;
+						materialTable.ptr += static_cast<UINT64>(m_materials[material].DiffuseTexture) * m_cbvSrvUavDescriptorSize;
+
+						m_commandList->SetGraphicsRootShaderResourceView(4, materialBase + static_cast<UINT64>(material) * sizeof(MaterialData));
+						m_commandList->SetGraphicsRootDescriptorTable(5, materialTable);
+					}
+					boundMaterial = material;
+					++switches;
+				}
+
+				D3D12_GPU_DESCRIPTOR_HANDLE objectCbv;
+				objectCbv.ptr = objectCbvBase + static_cast<UINT64>(entry.Slot) * m_cbvSrvUavDescriptorSize;
+				m_commandList->SetGraphicsRootDescriptorTable(0, objectCbv);
+
+				if (mesh->Indexed())
+					m_commandList->DrawIndexedInstanced(mesh->Lods[0].IndexCount, 1, mesh->Lods[0].FirstIndex, 0, 0);
+				else
+					m_commandList->DrawInstanced(mesh->VertexCount, 1, 0, 0);
+			}
+
+			elapsed += Clock::Now() - start;
+			ThrowIfFailed(m_commandList->Close());
+		}
+
+		return Clock::ToSeconds(elapsed) * 1000000.0 / iterations;
+	};
+
+	static const char* orderNames[] = { "slot order", "sorted" };
+	const std::vector<RenderWorld::DrawEntry>* lists[] = { &interleaved, &sorted };
+
+	for (size_t i = 0; i < _countof(lists); ++i) {
+		uint32_t switches = 0;
+		const double tableUs = record(*lists[i], false, switches);
+		const double constantUs = record(*lists[i], true, switches);
+
+		char report[256];
+		snprintf(report, sizeof(report),
+			"[Bindless] %-10s %u draws, %u material switches: tables %.1f us  root constant %.1f us (%.1f / %.1f ns per draw)\n",
+			orderNames[i], count, switches, tableUs, constantUs,
+			tableUs * 1000.0 / count, constantUs * 1000.0 / count);
+		OutputDebugStringA(report);
+	}
+}
+
+void Framework::ReportCullingStats() const
+{
+	static const char* modeNames[] = { "linear", "bvh" };
+
+	const SceneBvh::Stats bvh = m_bvh.GetStats();
+
+	for (size_t i = 0; i < m_cullTime.size(); ++i) {
+		const FrameStats::Summary s = m_cullTime[i].Summarize();
+		if (s.SampleCount == 0)
+			continue;
+
+		char report[256];
+		snprintf(report, sizeof(report),
+			"[Culling] %-6s %u objects, %u visible  avg %.3f ms  p99 %.3f ms  (bvh: %u nodes, depth %u)\n",
+			modeNames[i], m_world.Count(), m_visibleCount, s.AverageMs, s.P99Ms, bvh.Nodes, bvh.MaxDepth);
+		OutputDebugStringA(report);
+	}
+}
+
+void Framework::ReportConstantStats() const
+{
+	if (m_constantUpdateFrames == 0)
+		return;
+
+	const FrameStats::Summary s = m_constantUpdateTime.Summarize();
+	const double frames = static_cast<double>(m_constantUpdateFrames);
+
+	char report[256];
+	snprintf(report, sizeof(report),
+		"[Constants] %u objects  update avg %.4f ms p99 %.4f ms  object writes/frame %.1f  pass writes/frame %.2f\n",
+		m_world.Count(), s.AverageMs, s.P99Ms,
+		static_cast<double>(m_objectCBWrites) / frames, static_cast<double>(m_passCBWrites) / frames);
+	OutputDebugStringA(report);
 }
 
 void Framework::Draw()
 {
-	ThrowIfFailed(m_directCmdListAlloc->Reset());
-	ThrowIfFailed(m_commandList->Reset(m_directCmdListAlloc.Get(), m_pso.Get()));
+	PROFILE_ZONE("Framework::Draw");
+
+	const int64_t recordStart = Clock::Now();
+
+	auto cmdListAlloc = m_currFrameResource->CmdListAlloc;
+
+	ThrowIfFailed(cmdListAlloc->Reset());
+	ThrowIfFailed(m_commandList->Reset(cmdListAlloc.Get(), m_pso.Get()));
 
 	D3D12_RESOURCE_BARRIER toRT{};
 	toRT.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
@@ -392,13 +1088,22 @@ void Framework::Draw()
 
 	m_commandList->SetGraphicsRootSignature(m_rootSignature.Get());
 
-	ID3D12DescriptorHeap* heaps[] = { m_cbvHeap.Get() };
+	ID3D12DescriptorHeap* heaps[] = { m_descriptorHeap.Get() };
 	m_commandList->SetDescriptorHeaps(_countof(heaps), heaps);
 
-	m_commandList->SetGraphicsRootDescriptorTable(
-		0,
-		m_cbvHeap->GetGPUDescriptorHandleForHeapStart()
-	);
+	const D3D12_GPU_DESCRIPTOR_HANDLE heapStart = m_descriptorHeap->GetGPUDescriptorHandleForHeapStart();
+
+	D3D12_GPU_DESCRIPTOR_HANDLE passCbv = heapStart;
+	passCbv.ptr += static_cast<UINT64>(m_passCbvOffset + m_currFrameResourceIndex) * m_cbvSrvUavDescriptorSize;
+
+	m_commandList->SetGraphicsRootDescriptorTable(1, passCbv);
+
+	//       , draw    
+	D3D12_GPU_DESCRIPTOR_HANDLE textureTable = heapStart;
+	textureTable.ptr += static_cast<UINT64>(m_textureTableOffset) * m_cbvSrvUavDescriptorSize;
+
+	m_commandList->SetGraphicsRootShaderResourceView(4, m_materialBuffer->Resource()->GetGPUVirtualAddress());
+	m_commandList->SetGraphicsRootDescriptorTable(5, textureTable);
 
 	D3D12_CPU_DESCRIPTOR_HANDLE rtv = CurrentBackBufferView();
 	D3D12_CPU_DESCRIPTOR_HANDLE dsv = DepthStencilView();
@@ -416,17 +1121,66 @@ void Framework::Draw()
 
 	m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-	if (m_modelVB && m_modelVertexCount > 0)
+	// CBV   frame resource    
+	const UINT64 objectCbvBase = heapStart.ptr +
+		(static_cast<UINT64>(m_objectCbvOffset) + static_cast<UINT64>(m_currFrameResourceIndex) * m_objectSlots) * m_cbvSrvUavDescriptorSize;
+
+	//    ,  :    
+	//    
+	MeshCache::Handle boundMesh = RenderWorld::InvalidMesh;
+	const Mesh* mesh = nullptr;
+	uint32_t boundMaterial = UINT32_MAX;
+
+	// m_clusterDraws    m_drawList
+	ID3D12Resource* clusterArgs = m_currFrameResource->ClusterArgs->Resource();
+	size_t clusterDraw = 0;
+
+	for (const RenderWorld::DrawEntry& entry : m_drawList)
 	{
-		m_commandList->IASetVertexBuffers(0, 1, &m_modelVBV);
-		m_commandList->DrawInstanced(m_modelVertexCount, 1, 0, 0);
+		const MeshCache::Handle handle = static_cast<MeshCache::Handle>(entry.Key >> 32);
+
+		if (handle != boundMesh) {
+			mesh = &m_meshes.Get(handle);
+			m_commandList->IASetVertexBuffers(0, 1, &mesh->VertexBufferView);
+			if (mesh->Indexed())
+				m_commandList->IASetIndexBuffer(&mesh->IndexBufferView);
+			boundMesh = handle;
+		}
+
+		const uint32_t material = static_cast<uint32_t>(entry.Key);
+		if (material != boundMaterial) {
+			m_commandList->SetGraphicsRoot32BitConstant(3, material, 0);
+			boundMaterial = material;
+		}
+
+		D3D12_GPU_DESCRIPTOR_HANDLE objectCbv;
+		objectCbv.ptr = objectCbvBase + static_cast<UINT64>(entry.Slot) * m_cbvSrvUavDescriptorSize;
+		m_commandList->SetGraphicsRootDescriptorTable(0, objectCbv);
+
+		if (clusterDraw < m_clusterDraws.size() && m_clusterDraws[clusterDraw].Slot == entry.Slot) {
+			const ClusterDraw& draw = m_clusterDraws[clusterDraw++];
+			if (draw.ArgumentCount > 0)
+				m_commandList->ExecuteIndirect(m_drawIndexedSignature.Get(), draw.ArgumentCount, clusterArgs,
+					static_cast<UINT64>(draw.FirstArgument) * sizeof(D3D12_DRAW_INDEXED_ARGUMENTS), nullptr, 0);
+		}
+		else if (mesh->Indexed()) {
+			const MeshSimplifier::LodLevel& lod = mesh->Lods[m_lodBySlot[entry.Slot]];
+			m_commandList->DrawIndexedInstanced(lod.IndexCount, 1, lod.FirstIndex, 0, 0);
+		}
+		else
+			m_commandList->DrawInstanced(mesh->VertexCount, 1, 0, 0);
 	}
-	else
+
+	if (m_drawInstanced && m_instanceBatch.Count > 0)
 	{
-		// fallback:  ( OBJ  )
-		m_commandList->IASetVertexBuffers(0, 1, &m_boxVBView);
-		m_commandList->IASetIndexBuffer(&m_boxIBView);
-		m_commandList->DrawIndexedInstanced(m_boxIndexCount, 1, 0, 0, 0);
+		const Mesh& batchMesh = m_meshes.Get(m_instanceBatch.Mesh);
+
+		m_commandList->SetPipelineState(m_instancedPso.Get());
+		m_commandList->SetGraphicsRootShaderResourceView(2, m_currFrameResource->InstanceBuffer->Resource()->GetGPUVirtualAddress());
+
+		m_commandList->IASetVertexBuffers(0, 1, &batchMesh.VertexBufferView);
+		m_commandList->IASetIndexBuffer(&batchMesh.IndexBufferView);
+		m_commandList->DrawIndexedInstanced(batchMesh.IndexCount, m_instanceBatch.Count, 0, 0, 0);
 	}
 
 	D3D12_RESOURCE_BARRIER toPresent{};
@@ -442,10 +1196,35 @@ void Framework::Draw()
 	ID3D12CommandList* cmdsLists[] = { m_commandList.Get() };
 	m_commandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
 
-	ThrowIfFailed(m_swapChain->Present(0, 0));
-	m_currBackBuffer = (m_currBackBuffer + 1) % SwapChainBufferCount;
+	DrawModeStats& modeStats = m_drawModeStats[m_drawInstanced ? 1 : 0];
+	modeStats.Record.AddSample(Clock::ToSeconds(Clock::Now() - recordStart));
+	modeStats.Frame.AddSample(m_timer.DeltaTime());
 
-	FlushCommandQueue();
+	{
+		PROFILE_ZONE("Present");
+
+		const UINT syncInterval = m_presentMode == PresentMode::VSync ? 1 : 0;
+		const UINT presentFlags = (syncInterval == 0 && m_tearingSupported) ? DXGI_PRESENT_ALLOW_TEARING : 0;
+
+		ThrowIfFailed(m_swapChain->Present(syncInterval, presentFlags));
+	}
+	m_currBackBuffer = static_cast<int>(m_swapChain->GetCurrentBackBufferIndex());
+
+	if (m_pendingInputTime != 0) {
+		const double latency = Clock::ToSeconds(Clock::Now() - m_pendingInputTime);
+		m_pacingStats[static_cast<size_t>(m_presentMode)].InputToPresent.AddSample(latency);
+		m_pendingInputTime = 0;
+	}
+
+	if (m_wakeTime != 0) {
+		m_resumeLatency.AddSample(Clock::ToSeconds(Clock::Now() - m_wakeTime));
+		m_wakeTime = 0;
+	}
+
+	//   FlushCommandQueue    -    BeginFrame,
+	//   frame resource  
+	m_currFrameResource->Fence = ++m_currentFence;
+	ThrowIfFailed(m_commandQueue->Signal(m_fence.Get(), m_currentFence));
 }
 
 
@@ -634,109 +1413,476 @@ void Framework::CreateFence() {
 
 	if (m_fenceEvent == nullptr)
 		throw std::runtime_error("CreateEvent failed for fence event.");
+
+	m_idleFenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+
+	if (m_idleFenceEvent == nullptr)
+		throw std::runtime_error("CreateEvent failed for idle fence event.");
 }
 
 void Framework::FlushCommandQueue() {
 	if (!m_commandQueue || !m_fence || !m_fenceEvent)
 		return;
 
-	++m_currentFence;
-	ThrowIfFailed(m_commandQueue->Signal(m_fence.Get(), m_currentFence));
+	PROFILE_ZONE("Framework::FlushCommandQueue");
+
+	++m_currentFence;
+	ThrowIfFailed(m_commandQueue->Signal(m_fence.Get(), m_currentFence));
+
+	if (m_fence->GetCompletedValue() < m_currentFence) {
+		ThrowIfFailed(m_fence->SetEventOnCompletion(m_currentFence, m_fenceEvent));
+		WaitForSingleObject(m_fenceEvent, INFINITE);
+	}
+}
+
+void Framework::CheckTearingSupport() {
+	BOOL allowTearing = FALSE;
+
+	ComPtr<IDXGIFactory5> factory5;
+	if (SUCCEEDED(m_dxgiFactory.As(&factory5))) {
+		if (FAILED(factory5->CheckFeatureSupport(DXGI_FEATURE_PRESENT_ALLOW_TEARING, &allowTearing, sizeof(allowTearing))))
+			allowTearing = FALSE;
+	}
+
+	m_tearingSupported = allowTearing == TRUE;
+
+#if defined(_DEBUG)
+	OutputDebugStringW(m_tearingSupported ? L"[DXGI] Tearing supported\n" : L"[DXGI] Tearing NOT supported\n");
+#endif
+}
+
+void Framework::CreateSwapChain() {
+	m_swapChain.Reset();
+
+	if (m_frameLatencyWaitable) {
+		CloseHandle(m_frameLatencyWaitable);
+		m_frameLatencyWaitable = nullptr;
+	}
+
+	m_swapChainFlags = DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+	if (m_tearingSupported)
+		m_swapChainFlags |= DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING;
+
+	DXGI_SWAP_CHAIN_DESC1 sd = {};
+	sd.Width = m_clientWidth;
+	sd.Height = m_clientHeight;
+	sd.Format = m_backBufferFormat;
+	sd.SampleDesc.Count = 1;
+	sd.SampleDesc.Quality = 0;
+	sd.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+	sd.BufferCount = SwapChainBufferCount;
+	sd.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
+	sd.Scaling = DXGI_SCALING_STRETCH;
+	sd.AlphaMode = DXGI_ALPHA_MODE_UNSPECIFIED;
+	sd.Flags = m_swapChainFlags;
+
+	ComPtr<IDXGISwapChain1> swapChain1;
+	ThrowIfFailed(m_dxgiFactory->CreateSwapChainForHwnd(m_commandQueue.Get(), MainWnd(), &sd, nullptr, nullptr, &swapChain1));
+	ThrowIfFailed(m_dxgiFactory->MakeWindowAssociation(MainWnd(), DXGI_MWA_NO_ALT_ENTER));
+
+	ThrowIfFailed(swapChain1.As(&m_swapChain));
+	m_currBackBuffer = static_cast<int>(m_swapChain->GetCurrentBackBufferIndex());
+
+	ThrowIfFailed(m_swapChain->SetMaximumFrameLatency(m_maxFrameLatency));
+	m_frameLatencyWaitable = m_swapChain->GetFrameLatencyWaitableObject();
+}
+
+//     ;    ,    
+static const char* ShaderPackPath = "shader\\cache\\shaders.bin";
+static const std::string ShaderCacheSalt = "d3dcompiler_" + std::to_string(D3D_COMPILER_VERSION);
+
+//  -   m_vsByteCode, m_vsInstancedByteCode, m_psByteCode
+static std::vector<ShaderCache::Key> PhongShaderKeys()
+{
+	UINT flags = 0;
+#if defined(_DEBUG)
+	flags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#endif
+
+	return {
+		{ "shader\\Phong.hlsl", "VS", "vs_5_1", {}, flags },
+		{ "shader\\Phong.hlsl", "VSInstanced", "vs_5_1", {}, flags },
+		{ "shader\\Phong.hlsl", "PS", "ps_5_1", {}, flags },
+	};
+}
+
+//   ShaderCache:    JobSystem,  
+//   ,     BuildShaders
+static std::vector<uint8_t> CompileShaderBytecode(const ShaderCache::Key& key)
+{
+	std::vector<D3D_SHADER_MACRO> macros;
+	for (const ShaderCache::Define& define : key.Defines)
+		macros.push_back({ define.Name.c_str(), define.Value.c_str() });
+	macros.push_back({ nullptr, nullptr });
+
+	const std::wstring file(key.File.begin(), key.File.end());
+
+	ComPtr<ID3DBlob> byteCode;
+	ComPtr<ID3DBlob> errors;
+	const HRESULT hr = D3DCompileFromFile(file.c_str(), macros.data(), D3D_COMPILE_STANDARD_FILE_INCLUDE,
+		key.EntryPoint.c_str(), key.Target.c_str(), key.Flags, 0, &byteCode, &errors);
+
+	std::string message = errors ? std::string(static_cast<const char*>(errors->GetBufferPointer()), errors->GetBufferSize()) : std::string();
+	if (FAILED(hr)) {
+		if (message.empty()) {
+			_com_error err(hr);
+			const std::wstring text = err.ErrorMessage();
+			message = key.File + ": " + std::string(text.begin(), text.end());
+		}
+		throw std::runtime_error(message);
+	}
+
+	// 
+	if (!message.empty())
+		OutputDebugStringA(message.c_str());
+
+	const uint8_t* data = static_cast<const uint8_t*>(byteCode->GetBufferPointer());
+	return std::vector<uint8_t>(data, data + byteCode->GetBufferSize());
+}
+
+static ComPtr<ID3DBlob> MakeShaderBlob(const std::vector<uint8_t>& bytecode)
+{
+	ComPtr<ID3DBlob> blob;
+	ThrowIfFailed(D3DCreateBlob(bytecode.size(), &blob));
+	memcpy(blob->GetBufferPointer(), bytecode.data(), bytecode.size());
+	return blob;
+}
+
+void Framework::BuildShaders()
+{
+	PROFILE_ZONE("Framework::BuildShaders");
+
+	const std::vector<ShaderCache::Key> keys = PhongShaderKeys();
+
+	ShaderCache cache(ShaderPackPath, ShaderCacheSalt);
+	cache.Load();
+
+	std::vector<const std::vector<uint8_t>*> bytecode;
+	try {
+		cache.Get(keys.data(), keys.size(), CompileShaderBytecode, bytecode);
+	}
+	catch (const std::exception& e) {
+		OutputDebugStringA(e.what());
+		MessageBoxA(nullptr, e.what(), "HLSL Compile Error", MB_OK | MB_ICONERROR);
+		throw;
+	}
+
+	m_vsByteCode = MakeShaderBlob(*bytecode[0]);
+	m_vsInstancedByteCode = MakeShaderBlob(*bytecode[1]);
+	m_psByteCode = MakeShaderBlob(*bytecode[2]);
+
+	//    (   )  ,    
+	try {
+		cache.Save();
+	}
+	catch (const std::exception& e) {
+		OutputDebugStringA(e.what());
+		OutputDebugStringA("\n");
+	}
+
+	const ShaderCache::Stats& stats = cache.GetStats();
+
+	char report[192];
+	snprintf(report, sizeof(report), "[ShaderCache] %s: %u hits, %u compiled (%u new, %u changed)\n",
+		stats.Loaded ? "pack loaded" : "no pack", stats.Hits, stats.Misses + stats.Stale, stats.Misses, stats.Stale);
+	OutputDebugStringA(report);
+}
+
+void Framework::BenchmarkShaderCache(int iterations)
+{
+	PROFILE_ZONE("Framework::BenchmarkShaderCache");
+
+	const std::vector<ShaderCache::Key> keys = PhongShaderKeys();
+	std::vector<const std::vector<uint8_t>*> bytecode;
+	std::vector<ComPtr<ID3DBlob>> blobs(keys.size());
+
+	//  :  ,    (  JobSystem)
+	const int coldIterations = (std::max)(1, iterations / 10);
+	int64_t start = Clock::Now();
+	for (int i = 0; i < coldIterations; ++i) {
+		ShaderCache cold(std::string(), ShaderCacheSalt);
+		cold.Get(keys.data(), keys.size(), CompileShaderBytecode, bytecode);
+		for (size_t k = 0; k < keys.size(); ++k)
+			blobs[k] = MakeShaderBlob(*bytecode[k]);
+	}
+	const double coldMs = Clock::ToSeconds(Clock::Now() - start) * 1000.0 / coldIterations;
+
+	// Ҹ:  ,    include    ID3DBlob
+	uint64_t packBytes = 0;
+	uint32_t hits = 0;
+	start = Clock::Now();
+	for (int i = 0; i < iterations; ++i) {
+		ShaderCache warm(ShaderPackPath, ShaderCacheSalt);
+		warm.Load();
+		warm.Get(keys.data(), keys.size(), CompileShaderBytecode, bytecode);
+		for (size_t k = 0; k < keys.size(); ++k)
+			blobs[k] = MakeShaderBlob(*bytecode[k]);
+		packBytes = warm.GetStats().BytesRead;
+		hits = warm.GetStats().Hits;
+	}
+	const double warmMs = Clock::ToSeconds(Clock::Now() - start) * 1000.0 / iterations;
+
+	char report[256];
+	snprintf(report, sizeof(report),
+		"[ShaderCache] %zu shaders: cold %.2f ms (compile, %u workers + caller)  warm %.3f ms (%u hits, pack %.1f KB)  x%.0f\n",
+		keys.size(), coldMs, JobSystem::WorkerCount(), warmMs, hits, packBytes / 1024.0,
+		warmMs > 0.0 ? coldMs / warmMs : 0.0);
+	OutputDebugStringA(report);
+}
+
+void Framework::BuildFrameResources()
+{
+	// ,   ,       ObjectCB
+	m_objectSlots = m_world.SlotCapacity();
+	const UINT objectCount = m_objectSlots;
+
+	//   -        (    )
+	m_clusterArgCapacity = 0;
+	for (uint32_t i = 0; i < m_world.Count(); ++i)
+		m_clusterArgCapacity += static_cast<UINT>((m_meshes.Get(m_world.Meshes()[i]).Clusters.size() + 1) / 2);
+
+	for (int i = 0; i < NumFrameResources; ++i)
+		m_frameResources[i] = std::make_unique<FrameResource>(m_device.Get(), objectCount, m_instanceBatch.Count, m_clusterArgCapacity);
+
+	m_currFrameResourceIndex = 0;
+	m_currFrameResource = m_frameResources[0].get();
+
+	m_pacer.SetTargetFps(m_presentMode == PresentMode::Capped ? m_frameCapFps : 0.0);
+}
+
+void Framework::BuildDescriptorHeap()
+{
+	// Tier 1   128 SRV,  tier- -   
+	D3D12_FEATURE_DATA_D3D12_OPTIONS options = {};
+	ThrowIfFailed(m_device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &options, sizeof(options)));
+	m_textureTableSize = options.ResourceBindingTier == D3D12_RESOURCE_BINDING_TIER_1 ? 64 : MaxBindlessTextures;
+
+	// [ ][  0][  1]...[  0][  1]...
+	const UINT objectCount = m_objectSlots;
+	const UINT heapSize = m_textureTableSize + (objectCount + 1) * NumFrameResources;
+
+	D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
+	heapDesc.NumDescriptors = heapSize;
+	heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+	heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+
+	ThrowIfFailed(m_device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(m_descriptorHeap.GetAddressOf())));
+
+	m_descriptors.Reset(heapSize);
+	m_textureTableOffset = m_descriptors.Allocate(m_textureTableSize);
+	m_objectCbvOffset = m_descriptors.Allocate(objectCount * NumFrameResources);
+	m_passCbvOffset = m_descriptors.Allocate(NumFrameResources);
+
+	m_textureSlots.Reset(m_textureTableSize);
+
+	//    - null SRV:  tier 1      
+	D3D12_SHADER_RESOURCE_VIEW_DESC nullSrv = {};
+	nullSrv.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	nullSrv.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+	nullSrv.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	nullSrv.Texture2D.MipLevels = 1;
+
+	D3D12_CPU_DESCRIPTOR_HANDLE h = m_descriptorHeap->GetCPUDescriptorHandleForHeapStart();
+	h.ptr += static_cast<SIZE_T>(m_textureTableOffset) * m_cbvSrvUavDescriptorSize;
+	for (UINT i = 0; i < m_textureTableSize; ++i) {
+		m_device->CreateShaderResourceView(nullptr, &nullSrv, h);
+		h.ptr += m_cbvSrvUavDescriptorSize;
+	}
+}
+
+void Framework::BuildCbvViews()
+{
+	const UINT objectCount = m_objectSlots;
+	const UINT objCBByteSize = CalcConstantBufferByteSize(sizeof(ObjectConstants));
+
+	for (int frameIndex = 0; frameIndex < NumFrameResources; ++frameIndex)
+	{
+		FrameResource* frame = m_frameResources[frameIndex].get();
+
+		D3D12_GPU_VIRTUAL_ADDRESS objectCBAddress = frame->ObjectCB->Resource()->GetGPUVirtualAddress();
+
+		for (UINT i = 0; i < objectCount; ++i)
+		{
+			D3D12_CPU_DESCRIPTOR_HANDLE h = m_descriptorHeap->GetCPUDescriptorHandleForHeapStart();
+			h.ptr += (SIZE_T)(m_objectCbvOffset + frameIndex * objectCount + i) * m_cbvSrvUavDescriptorSize;
+
+			D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc = {};
+			cbvDesc.BufferLocation = objectCBAddress + (UINT64)i * objCBByteSize;
+			cbvDesc.SizeInBytes = objCBByteSize;
+
+			m_device->CreateConstantBufferView(&cbvDesc, h);
+		}
+
+		{
+			D3D12_CPU_DESCRIPTOR_HANDLE h = m_descriptorHeap->GetCPUDescriptorHandleForHeapStart();
+			h.ptr += (SIZE_T)(m_passCbvOffset + frameIndex) * m_cbvSrvUavDescriptorSize;
 
-	if (m_fence->GetCompletedValue() < m_currentFence) {
-		ThrowIfFailed(m_fence->SetEventOnCompletion(m_currentFence, m_fenceEvent));
-		WaitForSingleObject(m_fenceEvent, INFINITE);
+			D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc = {};
+			cbvDesc.BufferLocation = frame->PassCB->Resource()->GetGPUVirtualAddress();
+			cbvDesc.SizeInBytes = CalcConstantBufferByteSize(sizeof(PassConstants));
+
+			m_device->CreateConstantBufferView(&cbvDesc, h);
+		}
 	}
 }
 
-void Framework::CreateSwapChain() {
-	m_swapChain.Reset();
+void Framework::BuildDefaultTexture()
+{
+	//  1x1:        
+	D3D12_RESOURCE_DESC texDesc = {};
+	texDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+	texDesc.Width = 1;
+	texDesc.Height = 1;
+	texDesc.DepthOrArraySize = 1;
+	texDesc.MipLevels = 1;
+	texDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	texDesc.SampleDesc.Count = 1;
+	texDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
 
-	DXGI_SWAP_CHAIN_DESC1 sd = {};
-	sd.Width = m_clientWidth;
-	sd.Height = m_clientHeight;
-	sd.Format = m_backBufferFormat;
-	sd.SampleDesc.Count = 1;
-	sd.SampleDesc.Quality = 0;
-	sd.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
-	sd.BufferCount = SwapChainBufferCount;
-	sd.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
-	sd.Scaling = DXGI_SCALING_STRETCH;
-	sd.AlphaMode = DXGI_ALPHA_MODE_UNSPECIFIED;
-	sd.Flags = 0;
+	D3D12_HEAP_PROPERTIES defaultHeap = {};
+	defaultHeap.Type = D3D12_HEAP_TYPE_DEFAULT;
 
-	ComPtr<IDXGISwapChain1> swapChain1;
-	ThrowIfFailed(m_dxgiFactory->CreateSwapChainForHwnd(m_commandQueue.Get(), MainWnd(), &sd, nullptr, nullptr, &swapChain1));
-	ThrowIfFailed(m_dxgiFactory->MakeWindowAssociation(MainWnd(), DXGI_MWA_NO_ALT_ENTER));
+	ThrowIfFailed(m_device->CreateCommittedResource(&defaultHeap, D3D12_HEAP_FLAG_NONE, &texDesc,
+		D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(m_defaultTexture.GetAddressOf())));
 
-	ThrowIfFailed(swapChain1.As(&m_swapChain));
-	m_currBackBuffer = static_cast<int>(m_swapChain->GetCurrentBackBufferIndex());
-}
+	D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint = {};
+	UINT64 uploadBytes = 0;
+	m_device->GetCopyableFootprints(&texDesc, 0, 1, 0, &footprint, nullptr, nullptr, &uploadBytes);
 
-void Framework::BuildShaders()
-{
-	const std::wstring shaderFile = L"shader\\Phong.hlsl";
+	D3D12_RESOURCE_DESC bufferDesc = {};
+	bufferDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	bufferDesc.Width = uploadBytes;
+	bufferDesc.Height = 1;
+	bufferDesc.DepthOrArraySize = 1;
+	bufferDesc.MipLevels = 1;
+	bufferDesc.Format = DXGI_FORMAT_UNKNOWN;
+	bufferDesc.SampleDesc.Count = 1;
+	bufferDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
 
-	m_vsByteCode = CompileShader(shaderFile, nullptr, "VS", "vs_5_1");
-	m_psByteCode = CompileShader(shaderFile, nullptr, "PS", "ps_5_1");
-}
+	D3D12_HEAP_PROPERTIES uploadHeap = {};
+	uploadHeap.Type = D3D12_HEAP_TYPE_UPLOAD;
 
-void Framework::BuildConstantBuffers()
-{
-	m_objectCB = std::make_unique<UploadBuffer<ObjectConstants>>(m_device.Get(), 1, true);
-	m_passCB = std::make_unique<UploadBuffer<PassConstants>>(m_device.Get(), 1, true);
+	ThrowIfFailed(m_device->CreateCommittedResource(&uploadHeap, D3D12_HEAP_FLAG_NONE, &bufferDesc,
+		D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(m_defaultTextureUpload.GetAddressOf())));
+
+	uint8_t* mapped = nullptr;
+	ThrowIfFailed(m_defaultTextureUpload->Map(0, nullptr, reinterpret_cast<void**>(&mapped)));
+	const uint32_t white = 0xFFFFFFFFu;
+	std::memcpy(mapped + footprint.Offset, &white, sizeof(white));
+	m_defaultTextureUpload->Unmap(0, nullptr);
+
+	D3D12_TEXTURE_COPY_LOCATION dst = {};
+	dst.pResource = m_defaultTexture.Get();
+	dst.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+	dst.SubresourceIndex = 0;
+
+	D3D12_TEXTURE_COPY_LOCATION src = {};
+	src.pResource = m_defaultTextureUpload.Get();
+	src.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+	src.PlacedFootprint = footprint;
+
+	m_commandList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+
+	D3D12_RESOURCE_BARRIER toSrv{};
+	toSrv.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+	toSrv.Transition.pResource = m_defaultTexture.Get();
+	toSrv.Transition.StateBefore = D3D12_RESOURCE_STATE_COPY_DEST;
+	toSrv.Transition.StateAfter = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+	toSrv.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+	m_commandList->ResourceBarrier(1, &toSrv);
 }
 
-void Framework::BuildCbvHeap()
+void Framework::BuildMaterialBuffer()
 {
-	D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
-	heapDesc.NumDescriptors = 2;
-	heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-	heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+	m_defaultTextureIndex = RegisterTexture(m_defaultTexture.Get());
 
-	ThrowIfFailed(m_device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(m_cbvHeap.GetAddressOf())));
+	//   .mtl   :    UV
+	for (MaterialData& material : m_materials)
+		material.DiffuseTexture = m_defaultTextureIndex;
+
+	//     ,     frame resource
+	m_materialBuffer = std::make_unique<UploadBuffer<MaterialData>>(m_device.Get(), static_cast<UINT>(m_materials.size()), false);
+	for (size_t i = 0; i < m_materials.size(); ++i)
+		m_materialBuffer->CopyData(static_cast<int>(i), m_materials[i]);
 }
 
-void Framework::BuildCbvViews()
+UINT Framework::RegisterTexture(ID3D12Resource* texture)
 {
-	{
-		D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc = {};
-		cbvDesc.BufferLocation = m_objectCB->Resource()->GetGPUVirtualAddress();
-		cbvDesc.SizeInBytes = CalcConstantBufferByteSize(sizeof(ObjectConstants));
+	const UINT index = m_textureSlots.Allocate();
+	if (index == DescriptorAllocator::InvalidIndex)
+		throw std::runtime_error("Framework: bindless texture table is full");
 
-		D3D12_CPU_DESCRIPTOR_HANDLE h = m_cbvHeap->GetCPUDescriptorHandleForHeapStart();
-		m_device->CreateConstantBufferView(&cbvDesc, h);
-	}
+	const D3D12_RESOURCE_DESC desc = texture->GetDesc();
 
-	{
-		D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc = {};
-		cbvDesc.BufferLocation = m_passCB->Resource()->GetGPUVirtualAddress();
-		cbvDesc.SizeInBytes = CalcConstantBufferByteSize(sizeof(PassConstants));
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = desc.Format;
+	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	srvDesc.Texture2D.MipLevels = desc.MipLevels;
 
-		D3D12_CPU_DESCRIPTOR_HANDLE h = m_cbvHeap->GetCPUDescriptorHandleForHeapStart();
-		h.ptr += (SIZE_T)m_cbvSrvUavDescriptorSize;
-		m_device->CreateConstantBufferView(&cbvDesc, h);
-	}
+	//         ,       
+	D3D12_CPU_DESCRIPTOR_HANDLE h = m_descriptorHeap->GetCPUDescriptorHandleForHeapStart();
+	h.ptr += static_cast<SIZE_T>(m_textureTableOffset + index) * m_cbvSrvUavDescriptorSize;
+	m_device->CreateShaderResourceView(texture, &srvDesc, h);
+
+	return index;
 }
 
 void Framework::BuildRootSignature()
 {
-	D3D12_DESCRIPTOR_RANGE cbvRange = {};
-	cbvRange.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_CBV;
-	cbvRange.NumDescriptors = 2;
-	cbvRange.BaseShaderRegister = 0;
-	cbvRange.RegisterSpace = 0;
-	cbvRange.OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
-
-	D3D12_ROOT_PARAMETER rootParam = {};
-	rootParam.ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
-	rootParam.DescriptorTable.NumDescriptorRanges = 1;
-	rootParam.DescriptorTable.pDescriptorRanges = &cbvRange;
-	rootParam.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+	// b0 - ObjectCB (   draw), b1 - PassCB (  )
+	D3D12_DESCRIPTOR_RANGE cbvRanges[2] = {};
+	D3D12_ROOT_PARAMETER rootParams[6] = {};
+
+	for (UINT i = 0; i < 2; ++i)
+	{
+		cbvRanges[i].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_CBV;
+		cbvRanges[i].NumDescriptors = 1;
+		cbvRanges[i].BaseShaderRegister = i;
+		cbvRanges[i].RegisterSpace = 0;
+		cbvRanges[i].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
+
+		rootParams[i].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+		rootParams[i].DescriptorTable.NumDescriptorRanges = 1;
+		rootParams[i].DescriptorTable.pDescriptorRanges = &cbvRanges[i];
+		rootParams[i].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+	}
+
+	// t0 - StructuredBuffer , root SRV   upload- 
+	rootParams[2].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+	rootParams[2].Descriptor.ShaderRegister = 0;
+	rootParams[2].Descriptor.RegisterSpace = 0;
+	rootParams[2].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+
+	// b2 -    draw,  root-
+	rootParams[3].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+	rootParams[3].Constants.ShaderRegister = 2;
+	rootParams[3].Constants.RegisterSpace = 0;
+	rootParams[3].Constants.Num32BitValues = 1;
+	rootParams[3].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+
+	// t1 -  MaterialData
+	rootParams[4].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+	rootParams[4].Descriptor.ShaderRegister = 1;
+	rootParams[4].Descriptor.RegisterSpace = 0;
+	rootParams[4].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+
+	// t0, space1 - bindless- ,    
+	D3D12_DESCRIPTOR_RANGE textureRange = {};
+	textureRange.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+	textureRange.NumDescriptors = m_textureTableSize;
+	textureRange.BaseShaderRegister = 0;
+	textureRange.RegisterSpace = 1;
+	textureRange.OffsetInDescriptorsFromTableStart = 0;
+
+	rootParams[5].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+	rootParams[5].DescriptorTable.NumDescriptorRanges = 1;
+	rootParams[5].DescriptorTable.pDescriptorRanges = &textureRange;
+	rootParams[5].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
 
 	D3D12_ROOT_SIGNATURE_DESC rootSigDesc = {};
-	rootSigDesc.NumParameters = 1;
-	rootSigDesc.pParameters = &rootParam;
+	rootSigDesc.NumParameters = _countof(rootParams);
+	rootSigDesc.pParameters = rootParams;
 	rootSigDesc.NumStaticSamplers = 0;
 	rootSigDesc.pStaticSamplers = nullptr;
 	rootSigDesc.Flags =
@@ -759,6 +1905,10 @@ void Framework::BuildRootSignature()
 
 	ThrowIfFailed(hr);
 
+	PipelineCache::Hasher hasher;
+	hasher.Bytes(serializedRootSig->GetBufferPointer(), serializedRootSig->GetBufferSize());
+	m_rootSignatureHash = hasher.Get();
+
 	ThrowIfFailed(m_device->CreateRootSignature(
 		0,
 		serializedRootSig->GetBufferPointer(),
@@ -766,20 +1916,23 @@ void Framework::BuildRootSignature()
 		IID_PPV_ARGS(m_rootSignature.GetAddressOf())));
 }
 
-void Framework::BuildPSO()
+//  PSO    ;      
+static const char* PsoLibraryPath = "shader\\cache\\pipelines.bin";
+
+static const D3D12_INPUT_ELEMENT_DESC PhongInputLayout[] =
 {
-	D3D12_INPUT_ELEMENT_DESC inputLayout[] =
-	{
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0,
-		  D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+	{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0,
+	  D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
 
-		{ "NORMAL",   0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12,
-		  D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+	{ "NORMAL",   0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12,
+	  D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
 
-		{ "COLOR",    0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 24,
-		  D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-	};
+	{ "COLOR",    0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 24,
+	  D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+};
 
+D3D12_GRAPHICS_PIPELINE_STATE_DESC Framework::PhongPsoDesc(bool instanced) const
+{
 	D3D12_RASTERIZER_DESC rasterDesc = {};
 	rasterDesc.FillMode = D3D12_FILL_MODE_SOLID;
 	rasterDesc.CullMode = D3D12_CULL_MODE_BACK;
@@ -825,7 +1978,7 @@ void Framework::BuildPSO()
 	dsDesc.BackFace = dsDesc.FrontFace;
 
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
-	psoDesc.InputLayout = { inputLayout, _countof(inputLayout) };
+	psoDesc.InputLayout = { PhongInputLayout, _countof(PhongInputLayout) };
 	psoDesc.pRootSignature = m_rootSignature.Get();
 	psoDesc.VS = { m_vsByteCode->GetBufferPointer(), m_vsByteCode->GetBufferSize() };
 	psoDesc.PS = { m_psByteCode->GetBufferPointer(), m_psByteCode->GetBufferSize() };
@@ -840,7 +1993,144 @@ void Framework::BuildPSO()
 	psoDesc.SampleDesc.Count = 1;
 	psoDesc.SampleDesc.Quality = 0;
 
-	ThrowIfFailed(m_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(m_pso.GetAddressOf())));
+	if (instanced)
+		psoDesc.VS = { m_vsInstancedByteCode->GetBufferPointer(), m_vsInstancedByteCode->GetBufferSize() };
+
+	return psoDesc;
+}
+
+
+void Framework::BuildPSO()
+{
+	PROFILE_ZONE("Framework::BuildPSO");
+
+	m_psoCache.Init(m_device.Get(), PsoLibraryPath);
+
+	//  PSO  :   ,  -  Get   
+	const PsoCache::Handle pso = m_psoCache.Request(PhongPsoDesc(false), m_rootSignatureHash);
+	const PsoCache::Handle instancedPso = m_psoCache.Request(PhongPsoDesc(true), m_rootSignatureHash);
+	m_pso = m_psoCache.Get(pso);
+	m_instancedPso = m_psoCache.Get(instancedPso);
+
+	//     ,   PSO  
+	try {
+		m_psoCache.Save();
+	}
+	catch (const std::exception& e) {
+		OutputDebugStringA(e.what());
+		OutputDebugStringA("\n");
+	}
+
+	const PsoCache::Stats stats = m_psoCache.GetStats();
+	char report[192];
+	snprintf(report, sizeof(report), "[PsoCache] %s: %u PSO, %u from library, %u created and stored, %.2f ms of builds\n",
+		stats.LibraryLoaded ? "library loaded" : "no library", stats.Builds.Built, stats.LibraryHits, stats.LibraryStores,
+		stats.Builds.BuildSeconds * 1000.0);
+	OutputDebugStringA(report);
+}
+
+void Framework::BenchmarkPsoCache(int iterations)
+{
+	PROFILE_ZONE("Framework::BenchmarkPsoCache");
+
+	//  ,      : , ,
+	//  .      
+	std::vector<D3D12_GRAPHICS_PIPELINE_STATE_DESC> descs;
+	for (int instanced = 0; instanced < 2; ++instanced) {
+		for (D3D12_CULL_MODE cull : { D3D12_CULL_MODE_BACK, D3D12_CULL_MODE_NONE, D3D12_CULL_MODE_FRONT }) {
+			for (D3D12_FILL_MODE fill : { D3D12_FILL_MODE_SOLID, D3D12_FILL_MODE_WIREFRAME }) {
+				for (INT depthBias : { 0, 1000 }) {
+					D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = PhongPsoDesc(instanced != 0);
+					desc.RasterizerState.CullMode = cull;
+					desc.RasterizerState.FillMode = fill;
+					desc.RasterizerState.DepthBias = depthBias;
+					descs.push_back(desc);
+				}
+			}
+		}
+	}
+	const size_t unique = descs.size();
+	for (size_t i = 0; i < unique; ++i)
+		descs.push_back(descs[i]);
+
+	char directory[MAX_PATH];
+	if (GetTempPathA(MAX_PATH, directory) == 0)
+		directory[0] = '\0';
+	const std::string libraryPath = std::string(directory) + "Lab4_pso_library.bin";
+	std::error_code error;
+	std::filesystem::remove(libraryPath, error);
+
+	// 1)  : CreateGraphicsPipelineState   , 
+	std::vector<ComPtr<ID3D12PipelineState>> states(descs.size());
+	const int64_t directStart = Clock::Now();
+	for (int i = 0; i < iterations; ++i) {
+		for (size_t d = 0; d < descs.size(); ++d)
+			ThrowIfFailed(m_device->CreateGraphicsPipelineState(&descs[d], IID_PPV_ARGS(states[d].ReleaseAndGetAddressOf())));
+	}
+	const double directMs = Clock::ToSeconds(Clock::Now() - directStart) * 1000.0 / iterations;
+
+	// 2)  :     JobSystem,    .
+	// 3) Ҹ:   , PSO   
+	auto run = [&](bool keepLibrary, PsoCache::Stats& stats) {
+		if (!keepLibrary)
+			std::filesystem::remove(libraryPath, error);
+
+		const int64_t start = Clock::Now();
+		PsoCache cache;
+		cache.Init(m_device.Get(), libraryPath);
+		std::vector<PsoCache::Handle> handles;
+		for (const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc : descs)
+			handles.push_back(cache.Request(desc, m_rootSignatureHash));
+		for (size_t d = 0; d < descs.size(); ++d)
+			states[d] = cache.Get(handles[d]);
+		cache.Save();
+		stats = cache.GetStats();
+		return Clock::ToSeconds(Clock::Now() - start) * 1000.0;
+	};
+
+	PsoCache::Stats coldStats, warmStats;
+	double coldMs = 0.0, warmMs = 0.0;
+	for (int i = 0; i < iterations; ++i) {
+		coldMs += run(false, coldStats);
+		warmMs += run(true, warmStats);
+	}
+	coldMs /= iterations;
+	warmMs /= iterations;
+
+	//   :    
+	PsoCache lookup;
+	lookup.Init(m_device.Get(), std::string());
+	const PsoCache::Handle first = lookup.Request(descs[0], m_rootSignatureHash);
+	lookup.Get(first);
+	const int lookups = 10000;
+	const int64_t lookupStart = Clock::Now();
+	for (int i = 0; i < lookups; ++i)
+		lookup.Request(descs[unique], m_rootSignatureHash); //  descs[0]
+	const double lookupUs = Clock::ToSeconds(Clock::Now() - lookupStart) * 1e6 / lookups;
+
+	char report[320];
+	snprintf(report, sizeof(report),
+		"[PsoCache] %zu requests, %zu unique: direct %.2f ms, cold cache %.2f ms (%u built, %u deduplicated, %u workers + caller), "
+		"warm %.2f ms (%u from a %.1f KB library), repeat request %.2f us\n",
+		descs.size(), unique, directMs, coldMs, coldStats.Builds.Built, coldStats.Builds.Deduplicated, JobSystem::WorkerCount(),
+		warmMs, warmStats.LibraryHits, warmStats.LibraryBytes / 1024.0, lookupUs);
+	OutputDebugStringA(report);
+
+	std::filesystem::remove(libraryPath, error);
+}
+
+void Framework::BuildCommandSignature()
+{
+	//  DrawIndexed:    , root signature  
+	D3D12_INDIRECT_ARGUMENT_DESC argument = {};
+	argument.Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+
+	D3D12_COMMAND_SIGNATURE_DESC desc = {};
+	desc.ByteStride = sizeof(D3D12_DRAW_INDEXED_ARGUMENTS);
+	desc.NumArgumentDescs = 1;
+	desc.pArgumentDescs = &argument;
+
+	ThrowIfFailed(m_device->CreateCommandSignature(&desc, nullptr, IID_PPV_ARGS(m_drawIndexedSignature.GetAddressOf())));
 }
 
 void Framework::BuildBoxGeometry()
@@ -855,7 +2145,7 @@ void Framework::BuildBoxGeometry()
 			);
 		};
 
-	std::array<Vertex, 24> vertices =
+	std::vector<Vertex> vertices =
 	{
 		Vertex{ { -1.0f, -1.0f, -1.0f }, { 0.0f,  0.0f, -1.0f }, ColorFromPos(-1.0f, -1.0f, -1.0f) },
 		Vertex{ { -1.0f,  1.0f, -1.0f }, { 0.0f,  0.0f, -1.0f }, ColorFromPos(-1.0f,  1.0f, -1.0f) },
@@ -888,7 +2178,7 @@ void Framework::BuildBoxGeometry()
 		Vertex{ { -1.0f, -1.0f, -1.0f }, { 0.0f, -1.0f, 0.0f }, ColorFromPos(-1.0f, -1.0f, -1.0f) },
 	};
 
-	std::array<std::uint16_t, 36> indices =
+	std::vector<std::uint16_t> indices =
 	{
 		0, 1, 2,  0, 2, 3,
 		4, 5, 6,  4, 6, 7,
@@ -898,103 +2188,22 @@ void Framework::BuildBoxGeometry()
 		20,21,22, 20,22,23
 	};
 
-	m_boxIndexCount = (UINT)indices.size();
-
-	const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
-	const UINT ibByteSize = (UINT)indices.size() * sizeof(std::uint16_t);
-
-	auto MakeBufferDesc = [](UINT64 byteSize)
-		{
-			D3D12_RESOURCE_DESC d = {};
-			d.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-			d.Alignment = 0;
-			d.Width = byteSize;
-			d.Height = 1;
-			d.DepthOrArraySize = 1;
-			d.MipLevels = 1;
-			d.Format = DXGI_FORMAT_UNKNOWN;
-			d.SampleDesc.Count = 1;
-			d.SampleDesc.Quality = 0;
-			d.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-			d.Flags = D3D12_RESOURCE_FLAG_NONE;
-			return d;
-		};
-
-	D3D12_HEAP_PROPERTIES defaultHeap = {};
-	defaultHeap.Type = D3D12_HEAP_TYPE_DEFAULT;
-
-	D3D12_HEAP_PROPERTIES uploadHeap = {};
-	uploadHeap.Type = D3D12_HEAP_TYPE_UPLOAD;
-
-	auto vbDesc = MakeBufferDesc(vbByteSize);
-	auto ibDesc = MakeBufferDesc(ibByteSize);
-
-	ThrowIfFailed(m_device->CreateCommittedResource(
-		&defaultHeap,
-		D3D12_HEAP_FLAG_NONE,
-		&vbDesc,
-		D3D12_RESOURCE_STATE_COPY_DEST,
-		nullptr,
-		IID_PPV_ARGS(m_boxVB.GetAddressOf())));
-
-	ThrowIfFailed(m_device->CreateCommittedResource(
-		&defaultHeap,
-		D3D12_HEAP_FLAG_NONE,
-		&ibDesc,
-		D3D12_RESOURCE_STATE_COPY_DEST,
-		nullptr,
-		IID_PPV_ARGS(m_boxIB.GetAddressOf())));
-
-	ThrowIfFailed(m_device->CreateCommittedResource(
-		&uploadHeap,
-		D3D12_HEAP_FLAG_NONE,
-		&vbDesc,
-		D3D12_RESOURCE_STATE_GENERIC_READ,
-		nullptr,
-		IID_PPV_ARGS(m_boxVBUpload.GetAddressOf())));
-
-	ThrowIfFailed(m_device->CreateCommittedResource(
-		&uploadHeap,
-		D3D12_HEAP_FLAG_NONE,
-		&ibDesc,
-		D3D12_RESOURCE_STATE_GENERIC_READ,
-		nullptr,
-		IID_PPV_ARGS(m_boxIBUpload.GetAddressOf())));
+	m_boxMesh = m_meshes.Add(m_device.Get(), m_commandList.Get(), "box", vertices, indices);
+}
 
-	{
-		void* mapped = nullptr;
-		ThrowIfFailed(m_boxVBUpload->Map(0, nullptr, &mapped));
-		memcpy(mapped, vertices.data(), vbByteSize);
-		m_boxVBUpload->Unmap(0, nullptr);
-	}
-	{
-		void* mapped = nullptr;
-		ThrowIfFailed(m_boxIBUpload->Map(0, nullptr, &mapped));
-		memcpy(mapped, indices.data(), ibByteSize);
-		m_boxIBUpload->Unmap(0, nullptr);
-	}
+void Framework::BuildMeshes()
+{
+	PROFILE_ZONE("Framework::BuildMeshes");
 
+	//     default heap  command list
 	ThrowIfFailed(m_directCmdListAlloc->Reset());
 	ThrowIfFailed(m_commandList->Reset(m_directCmdListAlloc.Get(), nullptr));
 
-	m_commandList->CopyBufferRegion(m_boxVB.Get(), 0, m_boxVBUpload.Get(), 0, vbByteSize);
-	m_commandList->CopyBufferRegion(m_boxIB.Get(), 0, m_boxIBUpload.Get(), 0, ibByteSize);
-
-	D3D12_RESOURCE_BARRIER barriers[2] = {};
-
-	barriers[0].Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-	barriers[0].Transition.pResource = m_boxVB.Get();
-	barriers[0].Transition.StateBefore = D3D12_RESOURCE_STATE_COPY_DEST;
-	barriers[0].Transition.StateAfter = D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER;
-	barriers[0].Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+	m_materials.assign(1, MaterialData());
 
-	barriers[1].Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-	barriers[1].Transition.pResource = m_boxIB.Get();
-	barriers[1].Transition.StateBefore = D3D12_RESOURCE_STATE_COPY_DEST;
-	barriers[1].Transition.StateAfter = D3D12_RESOURCE_STATE_INDEX_BUFFER;
-	barriers[1].Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-
-	m_commandList->ResourceBarrier(2, barriers);
+	BuildDefaultTexture();
+	BuildBoxGeometry();
+	BuildObjVB_Upload();
 
 	ThrowIfFailed(m_commandList->Close());
 	ID3D12CommandList* cmds[] = { m_commandList.Get() };
@@ -1002,16 +2211,8 @@ void Framework::BuildBoxGeometry()
 
 	FlushCommandQueue();
 
-	m_boxVBView.BufferLocation = m_boxVB->GetGPUVirtualAddress();
-	m_boxVBView.StrideInBytes = sizeof(Vertex);
-	m_boxVBView.SizeInBytes = vbByteSize;
-
-	m_boxIBView.BufferLocation = m_boxIB->GetGPUVirtualAddress();
-	m_boxIBView.Format = DXGI_FORMAT_R16_UINT;
-	m_boxIBView.SizeInBytes = ibByteSize;
-
-	m_boxVBUpload.Reset();
-	m_boxIBUpload.Reset();
+	m_meshes.ReleaseUploads();
+	m_defaultTextureUpload.Reset();
 }
 
 static void LoadObjAsTriangleList(
@@ -1109,6 +2310,8 @@ static void LoadObjAsTriangleList(
 
 void Framework::BuildObjVB_Upload()
 {
+	PROFILE_ZONE("Framework::BuildObjVB_Upload");
+
 	using namespace DirectX;
 
 	// ---------- 0)   OBJ ----------
@@ -1161,6 +2364,14 @@ void Framework::BuildObjVB_Upload()
 	if (!ok)
 		throw std::runtime_error("tinyobj::LoadObj failed (see Output window).");
 
+	//  .mtl       .  -  
+	//    0,      .
+	for (const tinyobj::material_t& material : materials) {
+		MaterialData data;
+		data.DiffuseAlbedo = XMFLOAT4(material.diffuse[0], material.diffuse[1], material.diffuse[2], material.dissolve);
+		m_materials.push_back(data);
+	}
+
 	// ---------- 2)   triangle list Vertex[] ----------
 	std::vector<Vertex> vertices;
 	vertices.reserve(500000);
@@ -1261,7 +2472,7 @@ void Framework::BuildObjVB_Upload()
 		throw std::runtime_error("OBJ loaded but produced 0 vertices.");
 
 	// ---------- 3)  +  ( Sponza    ) ----------
-	m_modelCenter =
+	const XMFLOAT3 center =
 	{
 		0.5f * (minP.x + maxP.x),
 		0.5f * (minP.y + maxP.y),
@@ -1277,42 +2488,414 @@ void Framework::BuildObjVB_Upload()
 	if (dz > maxDim) maxDim = dz;
 
 	// ,     " 2" (  /near/far)
-	m_modelScale = (maxDim > 1e-6f) ? (2.0f / maxDim) : 1.0f;
-
-	// ---------- 4)  VertexBuffer  UPLOAD heap (  ) ----------
-	m_modelVertexCount = (UINT)vertices.size();
-	const UINT vbByteSize = (UINT)(vertices.size() * sizeof(Vertex));
-
-	D3D12_RESOURCE_DESC vbDesc{};
-	vbDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-	vbDesc.Width = vbByteSize;
-	vbDesc.Height = 1;
-	vbDesc.DepthOrArraySize = 1;
-	vbDesc.MipLevels = 1;
-	vbDesc.Format = DXGI_FORMAT_UNKNOWN;
-	vbDesc.SampleDesc.Count = 1;
-	vbDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-
-	D3D12_HEAP_PROPERTIES heapProps{};
-	heapProps.Type = D3D12_HEAP_TYPE_UPLOAD;
-
-	ThrowIfFailed(m_device->CreateCommittedResource(
-		&heapProps,
-		D3D12_HEAP_FLAG_NONE,
-		&vbDesc,
-		D3D12_RESOURCE_STATE_GENERIC_READ,
-		nullptr,
-		IID_PPV_ARGS(m_modelVB.GetAddressOf())
-	));
-
-	void* mapped = nullptr;
-	ThrowIfFailed(m_modelVB->Map(0, nullptr, &mapped));
-	memcpy(mapped, vertices.data(), vbByteSize);
-	m_modelVB->Unmap(0, nullptr);
-
-	m_modelVBV.BufferLocation = m_modelVB->GetGPUVirtualAddress();
-	m_modelVBV.StrideInBytes = sizeof(Vertex);
-	m_modelVBV.SizeInBytes = vbByteSize;
+	const float scale = (maxDim > 1e-6f) ? (2.0f / maxDim) : 1.0f;
+
+	// World = S * T(-center * s):  ,  T(-center) * S
+	SceneGraph::Transform fit;
+	fit.Translation[0] = -center.x * scale;
+	fit.Translation[1] = -center.y * scale;
+	fit.Translation[2] = -center.z * scale;
+	fit.Scale[0] = fit.Scale[1] = fit.Scale[2] = scale;
+
+	m_modelNode = m_scene.CreateNode(SceneGraph::InvalidNode, fit);
+
+	// ---------- 4)      LOD ----------
+	// Triangle list  OBJ   ;   ,
+	//         .
+	const int64_t lodStart = Clock::Now();
+
+	std::vector<uint32_t> remap;
+	MeshSimplifier::WeldVertices(vertices.data(), static_cast<uint32_t>(vertices.size()), sizeof(Vertex), remap);
+
+	std::vector<Vertex> welded;
+	std::vector<uint32_t> weldedIndex(vertices.size());
+	std::vector<uint32_t> indices(vertices.size());
+	for (size_t i = 0; i < vertices.size(); ++i) {
+		if (remap[i] == i) {
+			weldedIndex[i] = static_cast<uint32_t>(welded.size());
+			welded.push_back(vertices[i]);
+		}
+		indices[i] = weldedIndex[remap[i]];
+	}
+
+	// ---------- 5)   default heap (  BuildMeshes) ----------
+	m_modelMesh = m_meshes.AddWithLods(m_device.Get(), m_commandList.Get(), "sponza", welded, indices,
+		MeshSimplifier::LodOptions());
+
+	const double lodMs = Clock::ToSeconds(Clock::Now() - lodStart) * 1000.0;
+	const Mesh& model = m_meshes.Get(m_modelMesh);
+
+	char report[160];
+	snprintf(report, sizeof(report), "[LOD] sponza: %zu -> %zu vertices, %zu levels in %.1f ms (%.2f Mtri/s)\n",
+		vertices.size(), welded.size(), model.Lods.size(), lodMs, lodMs > 0.0 ? indices.size() / 3 / (lodMs * 1000.0) : 0.0);
+	OutputDebugStringA(report);
+
+	for (const MeshSimplifier::LodLevel& lod : model.Lods) {
+		snprintf(report, sizeof(report), "[LOD]   %8u triangles  error %.4f (%.3f%% of model size)\n",
+			lod.IndexCount / 3, lod.Error, maxDim > 0.0f ? 100.0f * lod.Error / maxDim : 0.0f);
+		OutputDebugStringA(report);
+	}
+
+	if (!model.Clusters.empty()) {
+		size_t clusterVertices = 0;
+		for (const Meshlets::Meshlet& cluster : model.Clusters)
+			clusterVertices += cluster.VertexCount;
+
+		snprintf(report, sizeof(report), "[Clusters] sponza: %zu clusters, avg %.1f vertices %.1f triangles, occluder %zu triangles\n",
+			model.Clusters.size(), static_cast<double>(clusterVertices) / model.Clusters.size(),
+			model.Lods[0].IndexCount / 3.0 / model.Clusters.size(), model.OccluderIndices.size() / 3);
+		OutputDebugStringA(report);
+	}
+}
+
+void Framework::BuildRenderItems()
+{
+	m_world.Clear();
+	m_world.Reserve(1 + m_staticObjectCount);
+	m_nodeEntities.assign(m_scene.NodeCount(), RenderWorld::InvalidEntity);
+	m_bvh.Clear();
+	m_movedEntities.clear();
+
+	// fallback:  ( OBJ  )
+	const bool hasModel = m_modelMesh != RenderWorld::InvalidMesh;
+	if (!hasModel && m_modelNode == SceneGraph::InvalidNode)
+		m_modelNode = m_scene.CreateNode(SceneGraph::InvalidNode);
+
+	AddRenderable(m_modelNode, hasModel ? m_modelMesh : m_boxMesh, 0);
+
+	//   (-objects N):      .
+	//  -  ,  -     .
+	const UINT side = static_cast<UINT>(std::ceil(std::sqrt(static_cast<double>(m_staticObjectCount))));
+	const float spacing = 0.3f;
+
+	SceneGraph::Transform gridRoot;
+	gridRoot.Translation[1] = -1.2f;
+	const SceneGraph::NodeId gridNode = m_scene.CreateNode(SceneGraph::InvalidNode, gridRoot);
+
+	m_scene.Reserve(m_scene.NodeCount() + m_staticObjectCount);
+
+	//      ,      
+	const uint32_t modelMaterials = static_cast<uint32_t>(m_materials.size()) - 1;
+
+	//    -     ,     instanced draw.
+	//    ,      .
+	m_instanceBatch.Mesh = m_boxMesh;
+	m_instanceBatch.FirstSlot = m_world.SlotCapacity();
+	m_instanceBatch.Count = m_staticObjectCount;
+
+	for (UINT i = 0; i < m_staticObjectCount; ++i)
+	{
+		SceneGraph::Transform cell;
+		cell.Translation[0] = (static_cast<float>(i % side) - 0.5f * static_cast<float>(side - 1)) * spacing;
+		cell.Translation[2] = (static_cast<float>(i / side) - 0.5f * static_cast<float>(side - 1)) * spacing;
+		cell.Scale[0] = cell.Scale[1] = cell.Scale[2] = 0.1f;
+
+		AddRenderable(m_scene.CreateNode(gridNode, cell), m_boxMesh, modelMaterials > 0 ? 1 + i % modelMaterials : 0);
+	}
+
+	UpdateSceneGraph();
+	ApplyDrawMode();
+}
+
+RenderWorld::Entity Framework::AddRenderable(SceneGraph::NodeId node, MeshCache::Handle mesh, uint32_t material)
+{
+	const RenderWorld::Entity entity = m_world.Create(mesh, material, m_meshes.Get(mesh).Bounds);
+
+	if (m_nodeEntities.size() <= node)
+		m_nodeEntities.resize(static_cast<size_t>(node) + 1, RenderWorld::InvalidEntity);
+	m_nodeEntities[node] = entity;
+
+	return entity;
+}
+
+void Framework::ApplyDrawMode()
+{
+	for (UINT i = 0; i < m_instanceBatch.Count; ++i) {
+		const uint32_t index = m_world.IndexOfSlot(m_instanceBatch.FirstSlot + i);
+		m_world.SetEnabled(m_world.Entities()[index], !m_drawInstanced);
+	}
+}
+
+void Framework::UpdateSceneGraph()
+{
+	PROFILE_ZONE("Framework::UpdateSceneGraph");
+
+	if (m_scene.Update(true) == 0)
+		return;
+
+	//       ,  
+	// UpdateObjectCBs/UpdateInstanceBuffer -   .
+	for (const SceneGraph::Range& range : m_scene.ChangedRanges())
+	{
+		for (uint32_t i = range.Begin; i < range.End; ++i)
+		{
+			const SceneGraph::NodeId node = m_scene.IdAt(i);
+			if (node < m_nodeEntities.size() && m_nodeEntities[node] != RenderWorld::InvalidEntity) {
+				m_world.SetWorld(m_nodeEntities[node], m_scene.World(node));
+				m_movedEntities.push_back(m_nodeEntities[node]);
+			}
+		}
+	}
+}
+
+XMMATRIX Framework::ViewProj() const
+{
+	XMVECTOR pos = XMLoadFloat3(&m_camPos);
+	XMVECTOR target = XMLoadFloat3(&m_camTarget);
+	XMVECTOR up = XMVector3Normalize(XMLoadFloat3(&m_camUp));
+
+	XMMATRIX view = XMMatrixLookAtLH(pos, target, up);
+
+	float aspect = (float)m_clientWidth / (float)m_clientHeight;
+	XMMATRIX proj = XMMatrixPerspectiveFovLH(0.25f * XM_PI, aspect, 0.1f, 1000.0f);
+
+	return view * proj;
+}
+
+void Framework::CullAndBuildDrawList()
+{
+	PROFILE_ZONE("Framework::CullAndBuildDrawList");
+
+	BatchTransform::Float4x4 viewProj;
+	XMStoreFloat4x4(reinterpret_cast<XMFLOAT4X4*>(&viewProj), ViewProj());
+
+	m_world.UpdateWorldBounds();
+	UpdateBvh();
+
+	const RenderWorld::Frustum frustum = RenderWorld::Frustum::FromViewProj(viewProj);
+	const int64_t start = Clock::Now();
+
+	if (m_cullWithBvh) {
+		m_bvhVisible.clear();
+		m_bvh.QueryFrustum(frustum, m_bvhVisible);
+		m_visibleCount = m_world.SetInFrustum(m_bvhVisible.data(), static_cast<uint32_t>(m_bvhVisible.size()));
+	}
+	else {
+		m_visibleCount = m_world.Cull(frustum);
+	}
+
+	m_cullTime[m_cullWithBvh ? 1 : 0].AddSample(Clock::ToSeconds(Clock::Now() - start));
+
+	m_world.BuildDrawList(m_drawList);
+	SelectLods();
+	CullClusters(viewProj);
+}
+
+void Framework::SelectLods()
+{
+	PROFILE_ZONE("Framework::SelectLods");
+
+	if (m_lodBySlot.size() < m_world.SlotCapacity())
+		m_lodBySlot.resize(m_world.SlotCapacity(), 0);
+
+	//       1 -   ,   ViewProj
+	const float pixelsAtUnitDistance = static_cast<float>(m_clientHeight) / (2.0f * std::tan(0.125f * XM_PI));
+	const XMVECTOR eye = XMLoadFloat3(&m_camPos);
+
+	const RenderWorld::Aabb* bounds = m_world.WorldBounds();
+	const BatchTransform::Float4x4* worlds = m_world.Worlds();
+
+	uint64_t triangles = 0;
+
+	for (const RenderWorld::DrawEntry& entry : m_drawList) {
+		const Mesh& mesh = m_meshes.Get(static_cast<MeshCache::Handle>(entry.Key >> 32));
+		uint8_t& lod = m_lodBySlot[entry.Slot];
+
+		if (!m_lodEnabled || mesh.Lods.size() <= 1) {
+			lod = 0;
+		}
+		else {
+			//       bounds
+			const RenderWorld::Aabb& b = bounds[entry.Index];
+			const XMVECTOR center = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(b.Center));
+			const float radius = XMVectorGetX(XMVector3Length(XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(b.Extents))));
+			const float distance = (std::max)(XMVectorGetX(XMVector3Length(center - eye)) - radius, 0.1f);
+
+			//  LOD -   ;   World    
+			const BatchTransform::Float4x4& w = worlds[entry.Index];
+			float scaleSq = 0.0f;
+			for (int r = 0; r < 3; ++r)
+				scaleSq = (std::max)(scaleSq, w.m[r][0] * w.m[r][0] + w.m[r][1] * w.m[r][1] + w.m[r][2] * w.m[r][2]);
+
+			const float pixelsPerUnit = pixelsAtUnitDistance / distance * std::sqrt(scaleSq);
+			lod = static_cast<uint8_t>(MeshSimplifier::SelectLod(mesh.Lods.data(), static_cast<uint32_t>(mesh.Lods.size()),
+				lod, pixelsPerUnit, m_lodPixelError, m_lodHysteresis));
+		}
+
+		triangles += (mesh.Indexed() ? mesh.Lods[lod].IndexCount : mesh.VertexCount) / 3;
+	}
+
+	m_lodTriangles = triangles;
+}
+
+void Framework::ReportLodStats() const
+{
+	char report[160];
+	snprintf(report, sizeof(report), "[LOD] %-4s %zu draws, %llu triangles\n",
+		m_lodEnabled ? "auto" : "off", m_drawList.size(), static_cast<unsigned long long>(m_lodTriangles));
+	OutputDebugStringA(report);
+}
+
+void Framework::CullClusters(const BatchTransform::Float4x4& viewProj)
+{
+	PROFILE_ZONE("Framework::CullClusters");
+
+	m_clusterDraws.clear();
+	m_clusterArgs.clear();
+
+	if (!m_clusterCulling)
+		return;
+
+	const int64_t start = Clock::Now();
+
+	const BatchTransform::Float4x4* worlds = m_world.Worlds();
+	const XMMATRIX vp = XMLoadFloat4x4(reinterpret_cast<const XMFLOAT4X4*>(&viewProj));
+
+	auto worldViewProj = [&](const BatchTransform::Float4x4& world) {
+		BatchTransform::Float4x4 result;
+		XMStoreFloat4x4(reinterpret_cast<XMFLOAT4X4*>(&result),
+			XMLoadFloat4x4(reinterpret_cast<const XMFLOAT4X4*>(&world)) * vp);
+		return result;
+	};
+
+	// 1) :  LOD   (   ,   ViewProj)
+	m_occlusion.Begin(viewProj, 0.1f);
+	for (const RenderWorld::DrawEntry& entry : m_drawList) {
+		const Mesh& mesh = m_meshes.Get(static_cast<MeshCache::Handle>(entry.Key >> 32));
+		if (mesh.OccluderIndices.empty())
+			continue;
+
+		m_occlusion.RasterizeTriangles(mesh.OccluderPositions.data(), sizeof(XMFLOAT3),
+			mesh.OccluderIndices.data(), mesh.OccluderIndices.size(), worldViewProj(worlds[entry.Index]));
+	}
+	m_occlusion.Finish();
+
+	// 2)  ,    LOD 0
+	const XMVECTOR eye = XMLoadFloat3(&m_camPos);
+
+	for (const RenderWorld::DrawEntry& entry : m_drawList) {
+		const Mesh& mesh = m_meshes.Get(static_cast<MeshCache::Handle>(entry.Key >> 32));
+		if (mesh.Clusters.empty() || m_lodBySlot[entry.Slot] != 0)
+			continue;
+
+		if (m_clusterArgs.size() + (mesh.Clusters.size() + 1) / 2 > m_clusterArgCapacity)
+			break;
+
+		// Frustum   -   ,    bounds 
+		const BatchTransform::Float4x4& w = worlds[entry.Index];
+		const XMMATRIX world = XMLoadFloat4x4(reinterpret_cast<const XMFLOAT4X4*>(&w));
+		const RenderWorld::Frustum frustum = RenderWorld::Frustum::FromViewProj(worldViewProj(w));
+
+		XMFLOAT3 localEye;
+		XMStoreFloat3(&localEye, XMVector3TransformCoord(eye, XMMatrixInverse(nullptr, world)));
+
+		float scaleSq = 0.0f;
+		for (int r = 0; r < 3; ++r)
+			scaleSq = (std::max)(scaleSq, w.m[r][0] * w.m[r][0] + w.m[r][1] * w.m[r][1] + w.m[r][2] * w.m[r][2]);
+		const float scale = std::sqrt(scaleSq);
+
+		//  LOD        -    
+		const float occlusionMargin = mesh.Lods.back().Error * scale;
+
+		ClusterDraw draw;
+		draw.Slot = entry.Slot;
+		draw.FirstArgument = static_cast<UINT>(m_clusterArgs.size());
+
+		for (size_t i = 0; i < mesh.Clusters.size(); ++i) {
+			const Meshlets::Meshlet& cluster = mesh.Clusters[i];
+			const Meshlets::Bounds& bounds = mesh.ClusterBounds[i];
+
+			++m_clusterStats.Tested;
+			m_clusterStats.TestedTriangles += cluster.TriangleCount;
+
+			const Meshlets::CullResult result = Meshlets::Cull(bounds, frustum, &localEye.x);
+			if (result == Meshlets::CullResult::OutsideFrustum) {
+				++m_clusterStats.OutsideFrustum;
+				continue;
+			}
+			if (result == Meshlets::CullResult::Backfacing) {
+				++m_clusterStats.Backfacing;
+				continue;
+			}
+
+			XMFLOAT3 center;
+			XMStoreFloat3(&center, XMVector3TransformCoord(XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(bounds.Center)), world));
+			if (m_occlusion.IsSphereOccluded(&center.x, bounds.Radius * scale, occlusionMargin)) {
+				++m_clusterStats.Occluded;
+				continue;
+			}
+
+			m_clusterStats.Triangles += cluster.TriangleCount;
+
+			//    :   -  
+			const UINT firstIndex = mesh.Lods[0].FirstIndex + cluster.TriangleOffset * 3;
+			const UINT indexCount = cluster.TriangleCount * 3;
+
+			if (draw.ArgumentCount > 0) {
+				D3D12_DRAW_INDEXED_ARGUMENTS& last = m_clusterArgs.back();
+				if (last.StartIndexLocation + last.IndexCountPerInstance == firstIndex) {
+					last.IndexCountPerInstance += indexCount;
+					continue;
+				}
+			}
+
+			m_clusterArgs.push_back({ indexCount, 1, firstIndex, 0, 0 });
+			++draw.ArgumentCount;
+		}
+
+		m_clusterDraws.push_back(draw);
+	}
+
+	UploadBuffer<D3D12_DRAW_INDEXED_ARGUMENTS>& args = *m_currFrameResource->ClusterArgs;
+	for (size_t i = 0; i < m_clusterArgs.size(); ++i)
+		args.CopyData(static_cast<int>(i), m_clusterArgs[i]);
+
+	++m_clusterStats.Frames;
+	m_clusterStats.Arguments += m_clusterArgs.size();
+	m_clusterStats.OccluderTriangles += m_occlusion.RasterizedTriangles();
+	m_clusterStats.Time.AddSample(Clock::ToSeconds(Clock::Now() - start));
+}
+
+void Framework::ReportClusterStats() const
+{
+	const ClusterStats& s = m_clusterStats;
+	if (s.Frames == 0 || s.Tested == 0)
+		return;
+
+	const double frames = static_cast<double>(s.Frames);
+	const double tested = static_cast<double>(s.Tested);
+	const FrameStats::Summary time = s.Time.Summarize();
+
+	char report[384];
+	snprintf(report, sizeof(report),
+		"[Clusters] %.0f clusters/frame  culled: frustum %.1f%% backface %.1f%% occluded %.1f%%  "
+		"drawn %.1f%% of triangles in %.1f indirect draws  (occluders %.0f tris)  avg %.3f ms p99 %.3f ms\n",
+		tested / frames,
+		100.0 * s.OutsideFrustum / tested, 100.0 * s.Backfacing / tested, 100.0 * s.Occluded / tested,
+		s.TestedTriangles > 0 ? 100.0 * s.Triangles / s.TestedTriangles : 0.0,
+		s.Arguments / frames, s.OccluderTriangles / frames, time.AverageMs, time.P99Ms);
+	OutputDebugStringA(report);
+}
+
+void Framework::UpdateBvh()
+{
+	PROFILE_ZONE("Framework::UpdateBvh");
+
+	if (m_movedEntities.empty())
+		return;
+
+	//  -  ;  Move     
+	const RenderWorld::Aabb* bounds = m_world.WorldBounds();
+	for (RenderWorld::Entity entity : m_movedEntities) {
+		if (m_world.IsAlive(entity))
+			m_bvh.Move(RenderWorld::SlotOf(entity), bounds[m_world.IndexOf(entity)]);
+	}
+	m_movedEntities.clear();
+
+	if (m_bvh.NeedsRebuild())
+		m_bvh.Build();
+	else
+		m_bvh.Refit();
 }
 
 void Framework::OnMouseDown(HWND hwnd, WPARAM btnState, int x, int y)
@@ -1389,4 +2972,5 @@ void Framework::OnMouseMove(HWND hwnd,	WPARAM btnState, int x, int y)
 	XMVECTOR tgt = pos + forward;
 
 	XMStoreFloat3(&m_camTarget, tgt);
+	MarkPassDirty();
 }
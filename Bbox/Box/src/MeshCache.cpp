@@ -0,0 +1,208 @@
+#include "MeshCache.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <cstddef>
+#include <cstring>
+
+namespace {
+	RenderWorld::Aabb ComputeBounds(const std::vector<Vertex>& vertices) {
+		float minP[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+		float maxP[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+		for (const Vertex& v : vertices) {
+			const float p[3] = { v.Pos.x, v.Pos.y, v.Pos.z };
+			for (int c = 0; c < 3; ++c) {
+				minP[c] = (std::min)(minP[c], p[c]);
+				maxP[c] = (std::max)(maxP[c], p[c]);
+			}
+		}
+
+		RenderWorld::Aabb bounds;
+		if (vertices.empty())
+			return bounds;
+
+		for (int c = 0; c < 3; ++c) {
+			bounds.Center[c] = 0.5f * (minP[c] + maxP[c]);
+			bounds.Extents[c] = 0.5f * (maxP[c] - minP[c]);
+		}
+		return bounds;
+	}
+}
+
+MeshCache::Handle MeshCache::Add(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::string& name,
+	const std::vector<Vertex>& vertices, const std::vector<std::uint16_t>& indices) {
+	return AddImpl(device, cmdList, name, vertices, indices.data(), static_cast<UINT>(indices.size()), DXGI_FORMAT_R16_UINT);
+}
+
+MeshCache::Handle MeshCache::Add(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::string& name,
+	const std::vector<Vertex>& vertices, const std::vector<std::uint32_t>& indices) {
+	return AddImpl(device, cmdList, name, vertices, indices.data(), static_cast<UINT>(indices.size()), DXGI_FORMAT_R32_UINT);
+}
+
+MeshCache::Handle MeshCache::AddWithLods(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::string& name,
+	const std::vector<Vertex>& vertices, const std::vector<std::uint32_t>& indices,
+	const MeshSimplifier::LodOptions& options) {
+	if (indices.empty())
+		return Add(device, cmdList, name, vertices, indices);
+
+	//       :    1 
+	//     5%  
+	static const float attributeWeights[7] = { 0.05f, 0.05f, 0.05f, 0.05f, 0.05f, 0.05f, 0.05f };
+
+	MeshSimplifier::VertexData data;
+	data.Vertices = vertices.data();
+	data.Stride = sizeof(Vertex);
+	data.VertexCount = static_cast<uint32_t>(vertices.size());
+	data.PositionOffset = offsetof(Vertex, Pos);
+	data.AttributeOffset = offsetof(Vertex, Normal);
+	data.AttributeCount = 7;
+	data.AttributeWeights = attributeWeights;
+
+	std::vector<std::uint32_t> lodIndices;
+	std::vector<MeshSimplifier::LodLevel> lods =
+		MeshSimplifier::BuildLodChain(data, indices.data(), indices.size(), options, lodIndices);
+
+	// LOD 0   :   ,    - 
+	//  ,      
+	Meshlets::MeshletData clusters;
+	Meshlets::Build(&vertices[0].Pos, sizeof(Vertex), static_cast<uint32_t>(vertices.size()),
+		lodIndices.data() + lods[0].FirstIndex, lods[0].IndexCount, clusters);
+
+	std::vector<std::uint32_t> clustered;
+	clusters.ExpandIndices(clustered);
+	std::copy(clustered.begin(), clustered.end(), lodIndices.begin() + lods[0].FirstIndex);
+
+	//   -      
+	const MeshSimplifier::LodLevel& coarsest = lods.back();
+	std::vector<std::uint32_t> occluderIndex(vertices.size(), UINT32_MAX);
+	std::vector<DirectX::XMFLOAT3> occluderPositions;
+	std::vector<std::uint32_t> occluderIndices(coarsest.IndexCount);
+
+	for (UINT i = 0; i < coarsest.IndexCount; ++i) {
+		const std::uint32_t v = lodIndices[coarsest.FirstIndex + i];
+		if (occluderIndex[v] == UINT32_MAX) {
+			occluderIndex[v] = static_cast<std::uint32_t>(occluderPositions.size());
+			occluderPositions.push_back(vertices[v].Pos);
+		}
+		occluderIndices[i] = occluderIndex[v];
+	}
+
+	Handle handle;
+	if (vertices.size() <= 0x10000) {
+		const std::vector<std::uint16_t> indices16(lodIndices.begin(), lodIndices.end());
+		handle = Add(device, cmdList, name, vertices, indices16);
+	}
+	else {
+		handle = Add(device, cmdList, name, vertices, lodIndices);
+	}
+
+	Mesh& mesh = m_meshes[handle];
+	mesh.IndexCount = lods[0].IndexCount;
+	mesh.Lods = std::move(lods);
+	mesh.Clusters = std::move(clusters.Meshlets);
+	mesh.ClusterBounds = std::move(clusters.Bounds);
+	mesh.OccluderPositions = std::move(occluderPositions);
+	mesh.OccluderIndices = std::move(occluderIndices);
+	return handle;
+}
+
+MeshCache::Handle MeshCache::Find(const std::string& name) const {
+	auto it = m_byName.find(name);
+	return it != m_byName.end() ? it->second : RenderWorld::InvalidMesh;
+}
+
+MeshCache::Handle MeshCache::AddImpl(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::string& name,
+	const std::vector<Vertex>& vertices, const void* indices, UINT indexCount, DXGI_FORMAT indexFormat) {
+	if (vertices.empty())
+		throw std::runtime_error("MeshCache: mesh '" + name + "' has no vertices");
+
+	if (m_byName.count(name))
+		throw std::runtime_error("MeshCache: mesh '" + name + "' already exists");
+
+	Mesh mesh;
+	mesh.Name = name;
+	mesh.VertexCount = static_cast<UINT>(vertices.size());
+	mesh.IndexCount = indexCount;
+	mesh.Bounds = ComputeBounds(vertices);
+
+	const UINT vbByteSize = static_cast<UINT>(vertices.size() * sizeof(Vertex));
+	mesh.VertexBuffer = CreateBuffer(device, cmdList, vertices.data(), vbByteSize,
+		D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+
+	mesh.VertexBufferView.BufferLocation = mesh.VertexBuffer->GetGPUVirtualAddress();
+	mesh.VertexBufferView.StrideInBytes = sizeof(Vertex);
+	mesh.VertexBufferView.SizeInBytes = vbByteSize;
+
+	if (indexCount > 0) {
+		const UINT indexSize = indexFormat == DXGI_FORMAT_R16_UINT ? 2 : 4;
+		const UINT ibByteSize = indexCount * indexSize;
+
+		mesh.IndexBuffer = CreateBuffer(device, cmdList, indices, ibByteSize, D3D12_RESOURCE_STATE_INDEX_BUFFER);
+
+		mesh.IndexBufferView.BufferLocation = mesh.IndexBuffer->GetGPUVirtualAddress();
+		mesh.IndexBufferView.Format = indexFormat;
+		mesh.IndexBufferView.SizeInBytes = ibByteSize;
+
+		mesh.Lods.push_back({ 0, indexCount, 0.0f });
+	}
+
+	const Handle handle = static_cast<Handle>(m_meshes.size());
+	m_meshes.push_back(std::move(mesh));
+	m_byName.emplace(name, handle);
+	return handle;
+}
+
+ComPtr<ID3D12Resource> MeshCache::CreateBuffer(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList,
+	const void* data, UINT64 byteSize, D3D12_RESOURCE_STATES finalState) {
+	D3D12_RESOURCE_DESC desc = {};
+	desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	desc.Width = byteSize;
+	desc.Height = 1;
+	desc.DepthOrArraySize = 1;
+	desc.MipLevels = 1;
+	desc.Format = DXGI_FORMAT_UNKNOWN;
+	desc.SampleDesc.Count = 1;
+	desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+
+	D3D12_HEAP_PROPERTIES defaultHeap = {};
+	defaultHeap.Type = D3D12_HEAP_TYPE_DEFAULT;
+
+	D3D12_HEAP_PROPERTIES uploadHeap = {};
+	uploadHeap.Type = D3D12_HEAP_TYPE_UPLOAD;
+
+	ComPtr<ID3D12Resource> buffer;
+	ThrowIfFailed(device->CreateCommittedResource(
+		&defaultHeap,
+		D3D12_HEAP_FLAG_NONE,
+		&desc,
+		D3D12_RESOURCE_STATE_COPY_DEST,
+		nullptr,
+		IID_PPV_ARGS(buffer.GetAddressOf())));
+
+	ComPtr<ID3D12Resource> upload;
+	ThrowIfFailed(device->CreateCommittedResource(
+		&uploadHeap,
+		D3D12_HEAP_FLAG_NONE,
+		&desc,
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(upload.GetAddressOf())));
+
+	void* mapped = nullptr;
+	ThrowIfFailed(upload->Map(0, nullptr, &mapped));
+	memcpy(mapped, data, static_cast<size_t>(byteSize));
+	upload->Unmap(0, nullptr);
+
+	cmdList->CopyBufferRegion(buffer.Get(), 0, upload.Get(), 0, byteSize);
+
+	D3D12_RESOURCE_BARRIER barrier = {};
+	barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+	barrier.Transition.pResource = buffer.Get();
+	barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_COPY_DEST;
+	barrier.Transition.StateAfter = finalState;
+	barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+	cmdList->ResourceBarrier(1, &barrier);
+
+	m_uploads.push_back(upload);
+	return buffer;
+}
@@ -0,0 +1,292 @@
+#include "PsoCache.hpp"
+#include <algorithm>
+#include <cwchar>
+#include <filesystem>
+#include <fstream>
+
+//    ,    :       
+struct PsoCache::Pipeline {
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC Desc = {};
+	std::vector<uint8_t> Shaders[5]; // VS, PS, DS, HS, GS
+	std::vector<D3D12_INPUT_ELEMENT_DESC> InputElements;
+	std::vector<D3D12_SO_DECLARATION_ENTRY> StreamOutput;
+	std::vector<UINT> StreamOutputStrides;
+	std::vector<std::string> SemanticNames;
+	ComPtr<ID3D12RootSignature> RootSignature;
+
+	std::wstring Name; //  
+	ComPtr<ID3D12PipelineState> State;
+};
+
+namespace {
+	void HashShader(PipelineCache::Hasher& hasher, const D3D12_SHADER_BYTECODE& shader) {
+		const uint64_t size = shader.pShaderBytecode ? shader.BytecodeLength : 0;
+		hasher.Value(size);
+		hasher.Bytes(shader.pShaderBytecode, static_cast<size_t>(size));
+	}
+
+	void HashStencilOp(PipelineCache::Hasher& hasher, const D3D12_DEPTH_STENCILOP_DESC& op) {
+		hasher.Value(op.StencilFailOp);
+		hasher.Value(op.StencilDepthFailOp);
+		hasher.Value(op.StencilPassOp);
+		hasher.Value(op.StencilFunc);
+	}
+
+	D3D12_SHADER_BYTECODE CopyShader(const D3D12_SHADER_BYTECODE& shader, std::vector<uint8_t>& storage) {
+		if (!shader.pShaderBytecode || shader.BytecodeLength == 0)
+			return {};
+
+		const uint8_t* bytes = static_cast<const uint8_t*>(shader.pShaderBytecode);
+		storage.assign(bytes, bytes + shader.BytecodeLength);
+		return { storage.data(), storage.size() };
+	}
+}
+
+PsoCache::~PsoCache() {
+	m_cache.WaitAll();
+}
+
+void PsoCache::Init(ID3D12Device* device, const std::string& libraryPath) {
+	m_device = device;
+	m_libraryPath = libraryPath;
+
+	ComPtr<ID3D12Device1> device1;
+	if (libraryPath.empty() || FAILED(device->QueryInterface(IID_PPV_ARGS(&device1))))
+		return;
+
+	std::ifstream in(libraryPath, std::ios::binary | std::ios::ate);
+	if (in) {
+		m_libraryData.resize(static_cast<size_t>(in.tellg()));
+		in.seekg(0);
+		in.read(reinterpret_cast<char*>(m_libraryData.data()), std::streamsize(m_libraryData.size()));
+		if (!in)
+			m_libraryData.clear();
+	}
+
+	//     (D3D12_ERROR_DRIVER_VERSION_MISMATCH, D3D12_ERROR_ADAPTER_NOT_FOUND)
+	//    (E_INVALIDARG) -    
+	if (!m_libraryData.empty() &&
+		SUCCEEDED(device1->CreatePipelineLibrary(m_libraryData.data(), m_libraryData.size(), IID_PPV_ARGS(&m_library)))) {
+		m_libraryLoaded = true;
+		return;
+	}
+
+	m_libraryData.clear();
+	m_library.Reset();
+	if (FAILED(device1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&m_library))))
+		m_library.Reset(); // DXGI_ERROR_UNSUPPORTED    -  
+}
+
+uint64_t PsoCache::HashDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash) {
+	PipelineCache::Hasher hasher;
+	hasher.Value(rootSignatureHash);
+
+	HashShader(hasher, desc.VS);
+	HashShader(hasher, desc.PS);
+	HashShader(hasher, desc.DS);
+	HashShader(hasher, desc.HS);
+	HashShader(hasher, desc.GS);
+
+	const D3D12_STREAM_OUTPUT_DESC& so = desc.StreamOutput;
+	const UINT soEntries = so.pSODeclaration ? so.NumEntries : 0;
+	hasher.Value(soEntries);
+	for (UINT i = 0; i < soEntries; ++i) {
+		const D3D12_SO_DECLARATION_ENTRY& entry = so.pSODeclaration[i];
+		hasher.Value(entry.Stream);
+		hasher.String(entry.SemanticName);
+		hasher.Value(entry.SemanticIndex);
+		hasher.Value(entry.StartComponent);
+		hasher.Value(entry.ComponentCount);
+		hasher.Value(entry.OutputSlot);
+	}
+	const UINT soStrides = so.pBufferStrides ? so.NumStrides : 0;
+	hasher.Value(soStrides);
+	hasher.Bytes(so.pBufferStrides, soStrides * sizeof(UINT));
+	hasher.Value(so.RasterizedStream);
+
+	//  IndependentBlendEnable    RenderTarget[0]
+	const D3D12_BLEND_DESC& blend = desc.BlendState;
+	hasher.Value(blend.AlphaToCoverageEnable);
+	hasher.Value(blend.IndependentBlendEnable);
+	const UINT blendTargets = blend.IndependentBlendEnable ? D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT : 1;
+	for (UINT i = 0; i < blendTargets; ++i) {
+		const D3D12_RENDER_TARGET_BLEND_DESC& rt = blend.RenderTarget[i];
+		hasher.Value(rt.BlendEnable);
+		hasher.Value(rt.LogicOpEnable);
+		hasher.Value(rt.SrcBlend);
+		hasher.Value(rt.DestBlend);
+		hasher.Value(rt.BlendOp);
+		hasher.Value(rt.SrcBlendAlpha);
+		hasher.Value(rt.DestBlendAlpha);
+		hasher.Value(rt.BlendOpAlpha);
+		hasher.Value(rt.LogicOp);
+		hasher.Value(rt.RenderTargetWriteMask);
+	}
+
+	hasher.Value(desc.SampleMask);
+
+	//    4  -  
+	hasher.Value(desc.RasterizerState);
+
+	const D3D12_DEPTH_STENCIL_DESC& ds = desc.DepthStencilState;
+	hasher.Value(ds.DepthEnable);
+	hasher.Value(ds.DepthWriteMask);
+	hasher.Value(ds.DepthFunc);
+	hasher.Value(ds.StencilEnable);
+	hasher.Value(ds.StencilReadMask);
+	hasher.Value(ds.StencilWriteMask);
+	HashStencilOp(hasher, ds.FrontFace);
+	HashStencilOp(hasher, ds.BackFace);
+
+	const UINT elements = desc.InputLayout.pInputElementDescs ? desc.InputLayout.NumElements : 0;
+	hasher.Value(elements);
+	for (UINT i = 0; i < elements; ++i) {
+		const D3D12_INPUT_ELEMENT_DESC& element = desc.InputLayout.pInputElementDescs[i];
+		hasher.String(element.SemanticName);
+		hasher.Value(element.SemanticIndex);
+		hasher.Value(element.Format);
+		hasher.Value(element.InputSlot);
+		hasher.Value(element.AlignedByteOffset);
+		hasher.Value(element.InputSlotClass);
+		hasher.Value(element.InstanceDataStepRate);
+	}
+
+	hasher.Value(desc.IBStripCutValue);
+	hasher.Value(desc.PrimitiveTopologyType);
+
+	//   NumRenderTargets   
+	const UINT targets = (std::min)(desc.NumRenderTargets, static_cast<UINT>(D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT));
+	hasher.Value(desc.NumRenderTargets);
+	hasher.Bytes(desc.RTVFormats, targets * sizeof(DXGI_FORMAT));
+	hasher.Value(desc.DSVFormat);
+	hasher.Value(desc.SampleDesc.Count);
+	hasher.Value(desc.SampleDesc.Quality);
+	hasher.Value(desc.NodeMask);
+	hasher.Value(desc.Flags);
+
+	return hasher.Get();
+}
+
+PsoCache::Handle PsoCache::Request(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash, bool async) {
+	const uint64_t key = HashDesc(desc, rootSignatureHash);
+
+	//   -   
+	const Handle existing = m_cache.Find(key);
+	if (existing != PipelineCache::InvalidHandle)
+		return m_cache.Request(key, nullptr, async);
+
+	auto pipeline = std::make_shared<Pipeline>();
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC& copy = pipeline->Desc;
+	copy = desc;
+	copy.CachedPSO = {};
+
+	pipeline->RootSignature = desc.pRootSignature;
+	copy.VS = CopyShader(desc.VS, pipeline->Shaders[0]);
+	copy.PS = CopyShader(desc.PS, pipeline->Shaders[1]);
+	copy.DS = CopyShader(desc.DS, pipeline->Shaders[2]);
+	copy.HS = CopyShader(desc.HS, pipeline->Shaders[3]);
+	copy.GS = CopyShader(desc.GS, pipeline->Shaders[4]);
+
+	//     :    ,    
+	const UINT elements = desc.InputLayout.pInputElementDescs ? desc.InputLayout.NumElements : 0;
+	const UINT soEntries = desc.StreamOutput.pSODeclaration ? desc.StreamOutput.NumEntries : 0;
+	pipeline->SemanticNames.reserve(elements + soEntries);
+
+	pipeline->InputElements.assign(desc.InputLayout.pInputElementDescs, desc.InputLayout.pInputElementDescs + elements);
+	for (D3D12_INPUT_ELEMENT_DESC& element : pipeline->InputElements) {
+		pipeline->SemanticNames.push_back(element.SemanticName ? element.SemanticName : "");
+		element.SemanticName = pipeline->SemanticNames.back().c_str();
+	}
+	copy.InputLayout = { pipeline->InputElements.data(), elements };
+
+	pipeline->StreamOutput.assign(desc.StreamOutput.pSODeclaration, desc.StreamOutput.pSODeclaration + soEntries);
+	for (D3D12_SO_DECLARATION_ENTRY& entry : pipeline->StreamOutput) {
+		if (!entry.SemanticName)
+			continue; //   :  nullptr
+		pipeline->SemanticNames.push_back(entry.SemanticName);
+		entry.SemanticName = pipeline->SemanticNames.back().c_str();
+	}
+	const UINT soStrides = desc.StreamOutput.pBufferStrides ? desc.StreamOutput.NumStrides : 0;
+	pipeline->StreamOutputStrides.assign(desc.StreamOutput.pBufferStrides, desc.StreamOutput.pBufferStrides + soStrides);
+	copy.StreamOutput.pSODeclaration = soEntries ? pipeline->StreamOutput.data() : nullptr;
+	copy.StreamOutput.NumEntries = soEntries;
+	copy.StreamOutput.pBufferStrides = soStrides ? pipeline->StreamOutputStrides.data() : nullptr;
+	copy.StreamOutput.NumStrides = soStrides;
+
+	wchar_t name[32];
+	swprintf_s(name, L"pso_%016llx", static_cast<unsigned long long>(key));
+	pipeline->Name = name;
+
+	// Handle   :     
+	m_pipelines.push_back(pipeline);
+	return m_cache.Request(key, [this, pipeline](Handle) { Build(*pipeline); }, async);
+}
+
+void PsoCache::Build(Pipeline& pipeline) {
+	//  ,    PSO    - 
+	//  :     
+	if (m_library) {
+		if (SUCCEEDED(m_library->LoadGraphicsPipeline(pipeline.Name.c_str(), &pipeline.Desc, IID_PPV_ARGS(&pipeline.State)))) {
+			++m_libraryHits;
+			return;
+		}
+		// E_INVALIDARG:  PSO   
+	}
+
+	ThrowIfFailed(m_device->CreateGraphicsPipelineState(&pipeline.Desc, IID_PPV_ARGS(&pipeline.State)));
+
+	if (m_library && SUCCEEDED(m_library->StorePipeline(pipeline.Name.c_str(), pipeline.State.Get())))
+		++m_libraryStores;
+}
+
+ID3D12PipelineState* PsoCache::Get(Handle handle) {
+	m_cache.Wait(handle);
+	return m_pipelines[handle]->State.Get();
+}
+
+ID3D12PipelineState* PsoCache::TryGet(Handle handle) const {
+	return m_cache.IsReady(handle) ? m_pipelines[handle]->State.Get() : nullptr;
+}
+
+void PsoCache::Save() {
+	m_cache.WaitAll();
+
+	const uint32_t stores = m_libraryStores;
+	if (!m_library || stores == m_savedStores)
+		return;
+
+	std::vector<uint8_t> data(m_library->GetSerializedSize());
+	ThrowIfFailed(m_library->Serialize(data.data(), data.size()));
+
+	//   :     
+	namespace fs = std::filesystem;
+	const fs::path target(m_libraryPath);
+	std::error_code error;
+	if (target.has_parent_path())
+		fs::create_directories(target.parent_path(), error);
+
+	fs::path temporary = target;
+	temporary += ".tmp";
+	{
+		std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+		out.write(reinterpret_cast<const char*>(data.data()), std::streamsize(data.size()));
+		if (!out)
+			throw std::runtime_error("PsoCache: cannot write " + temporary.string());
+	}
+
+	fs::rename(temporary, target, error);
+	if (error)
+		throw std::runtime_error("PsoCache: cannot write " + target.string());
+
+	m_savedStores = stores;
+}
+
+PsoCache::Stats PsoCache::GetStats() const {
+	Stats stats;
+	stats.Builds = m_cache.GetStats();
+	stats.LibraryLoaded = m_libraryLoaded;
+	stats.LibraryHits = m_libraryHits;
+	stats.LibraryStores = m_libraryStores;
+	stats.LibraryBytes = m_libraryData.size();
+	return stats;
+}
@@ -1,9 +1,7 @@
 #include "Timer.hpp"
 
 Timer::Timer() {
-	LARGE_INTEGER freq;
-	QueryPerformanceFrequency(&freq);
-	m_secondsPerCount = 1.0 / static_cast<double>(freq.QuadPart);
+	m_secondsPerCount = Clock::SecondsPerTick();
 
 	Reset();
 }
@@ -18,30 +16,34 @@ double Timer::DeltaTime() const {
 	return m_deltaTime;
 }
 
+double Timer::SmoothedDeltaTime() const {
+	return m_stopped ? 0.0 : m_stats.SmoothedDelta();
+}
+
 void Timer::Reset() {
-	LARGE_INTEGER t;
-	QueryPerformanceCounter(&t);
+	const int64_t t = Clock::Now();
 
-	m_baseTime = t.QuadPart;
-	m_prevTime = t.QuadPart;
+	m_baseTime = t;
+	m_prevTime = t;
 	m_stopTime = 0;
 	m_pausedTime = 0;
 	m_stopped = false;
 
-	m_currTime = t.QuadPart;
+	m_currTime = t;
 	m_deltaTime = 0.0;
+
+	m_stats.Reset();
 }
 
 void Timer::Start() {
 	if (!m_stopped)
 		return;
 
-	LARGE_INTEGER start;
-	QueryPerformanceCounter(&start);
+	const int64_t start = Clock::Now();
 
-	m_pausedTime += (start.QuadPart - m_stopTime);
+	m_pausedTime += (start - m_stopTime);
 
-	m_prevTime = start.QuadPart;
+	m_prevTime = start;
 	m_stopTime = 0;
 	m_stopped = false;
 }
@@ -50,10 +52,7 @@ void Timer::Stop() {
 	if (m_stopped)
 		return;
 
-	LARGE_INTEGER t;
-	QueryPerformanceCounter(&t);
-
-	m_stopTime = t.QuadPart;
+	m_stopTime = Clock::Now();
 	m_stopped = true;
 }
 
@@ -63,13 +62,13 @@ void Timer::Tick() {
 		return;
 	}
 
-	LARGE_INTEGER t;
-	QueryPerformanceCounter(&t);
-	m_currTime = t.QuadPart;
+	m_currTime = Clock::Now();
 
 	m_deltaTime = static_cast<double>(m_currTime - m_prevTime) * m_secondsPerCount;
 	m_prevTime = m_currTime;
 
 	if (m_deltaTime < 0.0)
 		m_deltaTime = 0.0;
+
+	m_stats.AddSample(m_deltaTime);
 }
\ No newline at end of file
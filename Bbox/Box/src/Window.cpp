@@ -47,6 +47,10 @@ bool Window::ProcessMessages() {
 	return m_running;
 }
 
+DWORD Window::WaitForMessages(const HANDLE* handles, DWORD count, DWORD timeoutMs) const {
+	return MsgWaitForMultipleObjectsEx(count, handles, timeoutMs, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+}
+
 HWND Window::GetHWND() const {
 	return m_hwnd;
 }
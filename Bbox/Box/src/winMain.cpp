@@ -1,12 +1,110 @@
 #include <Windows.h>
+#include <shellapi.h>
+#include <cwchar>
 #include <exception>
 #include "Framework.hpp"
+#include "Benchmarks.hpp"
 
 int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE, PWSTR, int)
 {
     try
     {
         Framework app(1280, 720, L"CG Window");
+
+        // -objects N        :  N   ( )
+        // -bench-profiler   :    ,       
+        // -bench-framestats :  FrameStats (  , , )
+        // -bench-pacing     : FramePacer      (,  )
+        // -bench-constants  :      (full vs dirty-tracked)
+        // -bench-instancing :      (serial vs parallel)
+        // -instanced        :     (F6 )
+        // -bench-transform  : BatchTransform  DirectXMath (, /)
+        // -bench-scene      : SceneGraph  1k/100k/1M  (/ )
+        // -bench-ecs        : RenderWorld  1M  (bounds, ,  )
+        // -bench-bvh        : SceneBvh  1M  (build/refit, , )
+        // -bench-lod        :     LOD (, )
+        // -bench-meshlets   :   (,   frustum//)
+        // -bench-geometry   :   4096x4096   8 (MeshData / span + )
+        // -bench-geosphere  :    (  ,     )
+        // -bench-terrain    :  16k x 16k ( LOD  ,  )
+        // -bench-dds        :  DDS 16k BC7 (     )
+        // -fuzz-dds         : 2M  DDS-  DdsFile (    )
+        // -bench-streaming  :    2048  ( 256 MB / 1 GB /  )
+        // -bench-decode     :  72 PNG  job system (   ,  staging)
+        // -bench-mips       : - 8k x 8k  CPU ( , AVX2, AVX2 + job system)
+        // -bench-bc         :  BC1/BC3/BC5/BC7 (MPix/s  PSNR  ,  .dds)
+        // -bench-descriptors: free-list  (  ,  )
+        // -bench-vt         :   ( , ,  )
+        // -bench-shadercache:    (  include,  ,  )
+        // -bench-pipelines  :    PSO  CPU ( ,   job system)
+        // -bench-bindless   :     draw (    root-)
+        // -bench-shaders    :      (  )
+        // -bench-pso        :     PSO (,      )
+        int argc = 0;
+        LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+        for (int i = 1; argv && i < argc; ++i)
+        {
+            if (wcscmp(argv[i], L"-objects") == 0 && i + 1 < argc)
+                app.SetStaticObjectCount(static_cast<UINT>(wcstoul(argv[++i], nullptr, 10)));
+            else if (wcscmp(argv[i], L"-bench-profiler") == 0)
+                Benchmarks::RunProfiler();
+            else if (wcscmp(argv[i], L"-bench-framestats") == 0)
+                Benchmarks::RunFrameStats();
+            else if (wcscmp(argv[i], L"-bench-pacing") == 0)
+                Benchmarks::RunFramePacing();
+            else if (wcscmp(argv[i], L"-bench-constants") == 0)
+                app.SetConstantBenchmark(true);
+            else if (wcscmp(argv[i], L"-bench-instancing") == 0)
+                app.SetInstancingBenchmark(true);
+            else if (wcscmp(argv[i], L"-instanced") == 0)
+                app.SetDrawInstanced(true);
+            else if (wcscmp(argv[i], L"-bench-transform") == 0)
+                Benchmarks::RunBatchTransform();
+            else if (wcscmp(argv[i], L"-bench-scene") == 0)
+                Benchmarks::RunSceneGraph();
+            else if (wcscmp(argv[i], L"-bench-ecs") == 0)
+                Benchmarks::RunRenderWorld();
+            else if (wcscmp(argv[i], L"-bench-bvh") == 0)
+                Benchmarks::RunSpatialIndex();
+            else if (wcscmp(argv[i], L"-bench-lod") == 0)
+                Benchmarks::RunSimplifier();
+            else if (wcscmp(argv[i], L"-bench-meshlets") == 0)
+                Benchmarks::RunMeshlets();
+            else if (wcscmp(argv[i], L"-bench-geometry") == 0)
+                Benchmarks::RunGeometry();
+            else if (wcscmp(argv[i], L"-bench-geosphere") == 0)
+                Benchmarks::RunGeosphere();
+            else if (wcscmp(argv[i], L"-bench-terrain") == 0)
+                Benchmarks::RunTerrain();
+            else if (wcscmp(argv[i], L"-bench-dds") == 0)
+                Benchmarks::RunDds();
+            else if (wcscmp(argv[i], L"-fuzz-dds") == 0)
+                Benchmarks::RunDdsFuzz();
+            else if (wcscmp(argv[i], L"-bench-streaming") == 0)
+                Benchmarks::RunTextureStreaming();
+            else if (wcscmp(argv[i], L"-bench-decode") == 0)
+                Benchmarks::RunTextureDecode();
+            else if (wcscmp(argv[i], L"-bench-mips") == 0)
+                Benchmarks::RunMipGeneration();
+            else if (wcscmp(argv[i], L"-bench-bc") == 0)
+                Benchmarks::RunBlockCompression();
+            else if (wcscmp(argv[i], L"-bench-descriptors") == 0)
+                Benchmarks::RunDescriptorAllocator();
+            else if (wcscmp(argv[i], L"-bench-vt") == 0)
+                Benchmarks::RunVirtualTexture();
+            else if (wcscmp(argv[i], L"-bench-shadercache") == 0)
+                Benchmarks::RunShaderCache();
+            else if (wcscmp(argv[i], L"-bench-pipelines") == 0)
+                Benchmarks::RunPipelineCache();
+            else if (wcscmp(argv[i], L"-bench-bindless") == 0)
+                app.SetBindlessBenchmark(true);
+            else if (wcscmp(argv[i], L"-bench-shaders") == 0)
+                app.SetShaderCacheBenchmark(true);
+            else if (wcscmp(argv[i], L"-bench-pso") == 0)
+                app.SetPsoCacheBenchmark(true);
+        }
+        LocalFree(argv);
+
         if (!app.Init()) return 0;
         return app.Run();
     }
@@ -0,0 +1,402 @@
+//***************************************************************************************
+// BatchTransform.cpp
+//***************************************************************************************
+
+#include "BatchTransform.h"
+
+#include <atomic>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define BATCH_TRANSFORM_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define BATCH_TRANSFORM_AVX2_TARGET
+#else
+#include <cpuid.h>
+#define BATCH_TRANSFORM_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#else
+#define BATCH_TRANSFORM_X86 0
+#endif
+
+using namespace BatchTransform;
+
+namespace
+{
+	std::atomic<bool> gAvx2Enabled{ true };
+
+	bool DetectAvx2()
+	{
+#if BATCH_TRANSFORM_X86
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		if(info[0] < 7)
+			return false;
+
+		__cpuid(info, 1);
+		const bool osxsave = (info[2] & (1 << 27)) != 0;
+		const bool avx = (info[2] & (1 << 28)) != 0;
+		if(!osxsave || !avx)
+			return false;
+
+		// The OS must save the YMM registers on context switch.
+		if((_xgetbv(0) & 0x6) != 0x6)
+			return false;
+
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#else
+		return __builtin_cpu_supports("avx2");
+#endif
+#else
+		return false;
+#endif
+	}
+
+	bool CpuHasAvx2()
+	{
+		static const bool hasAvx2 = DetectAvx2();
+		return hasAvx2;
+	}
+
+	// Element (row, col) of the output for the requested layout.
+	inline int OutIndex(int row, int col, Layout layout)
+	{
+		return layout == Layout::RowMajor ? row * 4 + col : col * 4 + row;
+	}
+
+	//-----------------------------------------------------------------------------------
+	// Scalar path
+	//-----------------------------------------------------------------------------------
+
+	void StoreMatrix(float* out, const float (&e)[16], Layout layout)
+	{
+		for(int row = 0; row < 4; ++row)
+		{
+			for(int col = 0; col < 4; ++col)
+				out[OutIndex(row, col, layout)] = e[row * 4 + col];
+		}
+	}
+
+	void ComposeTRSScalar(const TRSArrays& trs, uint32_t begin, uint32_t end,
+		Float4x4* world, Float4x4* normal, Layout layout)
+	{
+		for(uint32_t i = begin; i < end; ++i)
+		{
+			const float x = trs.Qx[i], y = trs.Qy[i], z = trs.Qz[i], w = trs.Qw[i];
+
+			// Same expansion as XMMatrixRotationQuaternion.
+			const float r[3][3] =
+			{
+				{ 1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + z * w),        2.0f * (x * z - y * w) },
+				{ 2.0f * (x * y - z * w),        1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + x * w) },
+				{ 2.0f * (x * z + y * w),        2.0f * (y * z - x * w),        1.0f - 2.0f * (x * x + y * y) }
+			};
+
+			const float s[3] = { trs.Sx[i], trs.Sy[i], trs.Sz[i] };
+
+			if(world)
+			{
+				const float e[16] =
+				{
+					s[0] * r[0][0], s[0] * r[0][1], s[0] * r[0][2], 0.0f,
+					s[1] * r[1][0], s[1] * r[1][1], s[1] * r[1][2], 0.0f,
+					s[2] * r[2][0], s[2] * r[2][1], s[2] * r[2][2], 0.0f,
+					trs.Tx[i],      trs.Ty[i],      trs.Tz[i],      1.0f
+				};
+				StoreMatrix(&world[i].m[0][0], e, layout);
+			}
+
+			if(normal)
+			{
+				// (S * R)^-T = S^-1 * R; uniform scale needs a single reciprocal.
+				float inv[3];
+				if(s[0] == s[1] && s[1] == s[2])
+					inv[0] = inv[1] = inv[2] = 1.0f / s[0];
+				else
+				{
+					inv[0] = 1.0f / s[0];
+					inv[1] = 1.0f / s[1];
+					inv[2] = 1.0f / s[2];
+				}
+
+				const float e[16] =
+				{
+					inv[0] * r[0][0], inv[0] * r[0][1], inv[0] * r[0][2], 0.0f,
+					inv[1] * r[1][0], inv[1] * r[1][1], inv[1] * r[1][2], 0.0f,
+					inv[2] * r[2][0], inv[2] * r[2][1], inv[2] * r[2][2], 0.0f,
+					0.0f,             0.0f,             0.0f,             1.0f
+				};
+				StoreMatrix(&normal[i].m[0][0], e, layout);
+			}
+		}
+	}
+
+	void AffineInverseTransposeScalar(const Float4x4* world, uint32_t count, Float4x4* normal, Layout layout)
+	{
+		for(uint32_t i = 0; i < count; ++i)
+		{
+			const float (&a)[4][4] = world[i].m;
+
+			const float r0[3] = { a[0][0], a[0][1], a[0][2] };
+			const float r1[3] = { a[1][0], a[1][1], a[1][2] };
+			const float r2[3] = { a[2][0], a[2][1], a[2][2] };
+
+			// Rows of the cofactor matrix: c0 = r1 x r2, c1 = r2 x r0, c2 = r0 x r1.
+			// inverse-transpose = cofactor / det.
+			const float c0[3] = { r1[1] * r2[2] - r1[2] * r2[1], r1[2] * r2[0] - r1[0] * r2[2], r1[0] * r2[1] - r1[1] * r2[0] };
+			const float c1[3] = { r2[1] * r0[2] - r2[2] * r0[1], r2[2] * r0[0] - r2[0] * r0[2], r2[0] * r0[1] - r2[1] * r0[0] };
+			const float c2[3] = { r0[1] * r1[2] - r0[2] * r1[1], r0[2] * r1[0] - r0[0] * r1[2], r0[0] * r1[1] - r0[1] * r1[0] };
+
+			const float det = r0[0] * c0[0] + r0[1] * c0[1] + r0[2] * c0[2];
+			const float invDet = det != 0.0f ? 1.0f / det : 0.0f;
+
+			const float e[16] =
+			{
+				c0[0] * invDet, c0[1] * invDet, c0[2] * invDet, 0.0f,
+				c1[0] * invDet, c1[1] * invDet, c1[2] * invDet, 0.0f,
+				c2[0] * invDet, c2[1] * invDet, c2[2] * invDet, 0.0f,
+				0.0f,           0.0f,           0.0f,           1.0f
+			};
+			StoreMatrix(&normal[i].m[0][0], e, layout);
+		}
+	}
+
+	//-----------------------------------------------------------------------------------
+	// AVX2 path: lane j of every register belongs to object j of the current block of 8
+	//-----------------------------------------------------------------------------------
+
+#if BATCH_TRANSFORM_X86
+	// In-place 8x8 transpose: afterwards r[j] holds lane j of every input register.
+	BATCH_TRANSFORM_AVX2_TARGET inline void Transpose8x8(__m256 r[8])
+	{
+		const __m256 t0 = _mm256_unpacklo_ps(r[0], r[1]);
+		const __m256 t1 = _mm256_unpackhi_ps(r[0], r[1]);
+		const __m256 t2 = _mm256_unpacklo_ps(r[2], r[3]);
+		const __m256 t3 = _mm256_unpackhi_ps(r[2], r[3]);
+		const __m256 t4 = _mm256_unpacklo_ps(r[4], r[5]);
+		const __m256 t5 = _mm256_unpackhi_ps(r[4], r[5]);
+		const __m256 t6 = _mm256_unpacklo_ps(r[6], r[7]);
+		const __m256 t7 = _mm256_unpackhi_ps(r[6], r[7]);
+
+		const __m256 u0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+		const __m256 u1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+		const __m256 u2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+		const __m256 u3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+		const __m256 u4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+		const __m256 u5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+		const __m256 u6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+		const __m256 u7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+
+		r[0] = _mm256_permute2f128_ps(u0, u4, 0x20);
+		r[1] = _mm256_permute2f128_ps(u1, u5, 0x20);
+		r[2] = _mm256_permute2f128_ps(u2, u6, 0x20);
+		r[3] = _mm256_permute2f128_ps(u3, u7, 0x20);
+		r[4] = _mm256_permute2f128_ps(u0, u4, 0x31);
+		r[5] = _mm256_permute2f128_ps(u1, u5, 0x31);
+		r[6] = _mm256_permute2f128_ps(u2, u6, 0x31);
+		r[7] = _mm256_permute2f128_ps(u3, u7, 0x31);
+	}
+
+	// e[row * 4 + col] holds element (row, col) of 8 matrices; writes them to out[0..7].
+	BATCH_TRANSFORM_AVX2_TARGET inline void StoreMatrices8(Float4x4* out, const __m256 (&e)[16], Layout layout)
+	{
+		__m256 lo[8];
+		__m256 hi[8];
+
+		for(int k = 0; k < 8; ++k)
+		{
+			// Output element k (and k + 8) in memory order comes from (row, col) of the layout.
+			const int kl = k, kh = k + 8;
+			lo[k] = layout == Layout::RowMajor ? e[kl] : e[(kl % 4) * 4 + kl / 4];
+			hi[k] = layout == Layout::RowMajor ? e[kh] : e[(kh % 4) * 4 + kh / 4];
+		}
+
+		Transpose8x8(lo);
+		Transpose8x8(hi);
+
+		for(int j = 0; j < 8; ++j)
+		{
+			float* dst = &out[j].m[0][0];
+			_mm256_storeu_ps(dst, lo[j]);
+			_mm256_storeu_ps(dst + 8, hi[j]);
+		}
+	}
+
+	BATCH_TRANSFORM_AVX2_TARGET void ComposeTRSAvx2(const TRSArrays& trs, uint32_t begin, uint32_t end,
+		Float4x4* world, Float4x4* normal, Layout layout)
+	{
+		const __m256 one = _mm256_set1_ps(1.0f);
+		const __m256 two = _mm256_set1_ps(2.0f);
+		const __m256 zero = _mm256_setzero_ps();
+
+		uint32_t i = begin;
+		for(; i + 8 <= end; i += 8)
+		{
+			const __m256 x = _mm256_loadu_ps(trs.Qx + i);
+			const __m256 y = _mm256_loadu_ps(trs.Qy + i);
+			const __m256 z = _mm256_loadu_ps(trs.Qz + i);
+			const __m256 w = _mm256_loadu_ps(trs.Qw + i);
+
+			const __m256 xx = _mm256_mul_ps(x, x), yy = _mm256_mul_ps(y, y), zz = _mm256_mul_ps(z, z);
+			const __m256 xy = _mm256_mul_ps(x, y), xz = _mm256_mul_ps(x, z), yz = _mm256_mul_ps(y, z);
+			const __m256 xw = _mm256_mul_ps(x, w), yw = _mm256_mul_ps(y, w), zw = _mm256_mul_ps(z, w);
+
+			const __m256 r00 = _mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(yy, zz)));
+			const __m256 r01 = _mm256_mul_ps(two, _mm256_add_ps(xy, zw));
+			const __m256 r02 = _mm256_mul_ps(two, _mm256_sub_ps(xz, yw));
+			const __m256 r10 = _mm256_mul_ps(two, _mm256_sub_ps(xy, zw));
+			const __m256 r11 = _mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, zz)));
+			const __m256 r12 = _mm256_mul_ps(two, _mm256_add_ps(yz, xw));
+			const __m256 r20 = _mm256_mul_ps(two, _mm256_add_ps(xz, yw));
+			const __m256 r21 = _mm256_mul_ps(two, _mm256_sub_ps(yz, xw));
+			const __m256 r22 = _mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, yy)));
+
+			const __m256 sx = _mm256_loadu_ps(trs.Sx + i);
+			const __m256 sy = _mm256_loadu_ps(trs.Sy + i);
+			const __m256 sz = _mm256_loadu_ps(trs.Sz + i);
+
+			if(world)
+			{
+				const __m256 e[16] =
+				{
+					_mm256_mul_ps(sx, r00), _mm256_mul_ps(sx, r01), _mm256_mul_ps(sx, r02), zero,
+					_mm256_mul_ps(sy, r10), _mm256_mul_ps(sy, r11), _mm256_mul_ps(sy, r12), zero,
+					_mm256_mul_ps(sz, r20), _mm256_mul_ps(sz, r21), _mm256_mul_ps(sz, r22), zero,
+					_mm256_loadu_ps(trs.Tx + i), _mm256_loadu_ps(trs.Ty + i), _mm256_loadu_ps(trs.Tz + i), one
+				};
+				StoreMatrices8(world + i, e, layout);
+			}
+
+			if(normal)
+			{
+				// Uniform scale in all 8 lanes - one division instead of three.
+				const __m256 uniform = _mm256_and_ps(_mm256_cmp_ps(sx, sy, _CMP_EQ_OQ), _mm256_cmp_ps(sy, sz, _CMP_EQ_OQ));
+
+				__m256 ix, iy, iz;
+				if(_mm256_movemask_ps(uniform) == 0xFF)
+				{
+					ix = iy = iz = _mm256_div_ps(one, sx);
+				}
+				else
+				{
+					ix = _mm256_div_ps(one, sx);
+					iy = _mm256_div_ps(one, sy);
+					iz = _mm256_div_ps(one, sz);
+				}
+
+				const __m256 e[16] =
+				{
+					_mm256_mul_ps(ix, r00), _mm256_mul_ps(ix, r01), _mm256_mul_ps(ix, r02), zero,
+					_mm256_mul_ps(iy, r10), _mm256_mul_ps(iy, r11), _mm256_mul_ps(iy, r12), zero,
+					_mm256_mul_ps(iz, r20), _mm256_mul_ps(iz, r21), _mm256_mul_ps(iz, r22), zero,
+					zero, zero, zero, one
+				};
+				StoreMatrices8(normal + i, e, layout);
+			}
+		}
+
+		if(i < end)
+			ComposeTRSScalar(trs, i, end, world, normal, layout);
+	}
+
+	BATCH_TRANSFORM_AVX2_TARGET inline void Cross3(const __m256 (&u)[3], const __m256 (&v)[3], __m256 (&out)[3])
+	{
+		out[0] = _mm256_sub_ps(_mm256_mul_ps(u[1], v[2]), _mm256_mul_ps(u[2], v[1]));
+		out[1] = _mm256_sub_ps(_mm256_mul_ps(u[2], v[0]), _mm256_mul_ps(u[0], v[2]));
+		out[2] = _mm256_sub_ps(_mm256_mul_ps(u[0], v[1]), _mm256_mul_ps(u[1], v[0]));
+	}
+
+	BATCH_TRANSFORM_AVX2_TARGET void AffineInverseTransposeAvx2(const Float4x4* world, uint32_t count,
+		Float4x4* normal, Layout layout)
+	{
+		const __m256 one = _mm256_set1_ps(1.0f);
+		const __m256 zero = _mm256_setzero_ps();
+
+		// Matrix j of the block starts 16 floats after matrix j - 1.
+		const __m256i stride = _mm256_setr_epi32(0, 16, 32, 48, 64, 80, 96, 112);
+
+		uint32_t i = 0;
+		for(; i + 8 <= count; i += 8)
+		{
+			const float* base = &world[i].m[0][0];
+
+			__m256 a[3][3];
+			for(int row = 0; row < 3; ++row)
+			{
+				for(int col = 0; col < 3; ++col)
+					a[row][col] = _mm256_i32gather_ps(base + row * 4 + col, stride, 4);
+			}
+
+			__m256 c0[3], c1[3], c2[3];
+			Cross3(a[1], a[2], c0);
+			Cross3(a[2], a[0], c1);
+			Cross3(a[0], a[1], c2);
+
+			const __m256 det = _mm256_add_ps(_mm256_add_ps(
+				_mm256_mul_ps(a[0][0], c0[0]), _mm256_mul_ps(a[0][1], c0[1])), _mm256_mul_ps(a[0][2], c0[2]));
+
+			// Singular matrices give a zero normal matrix, as in the scalar path.
+			const __m256 invDet = _mm256_and_ps(_mm256_div_ps(one, det), _mm256_cmp_ps(det, zero, _CMP_NEQ_OQ));
+
+			const __m256 e[16] =
+			{
+				_mm256_mul_ps(c0[0], invDet), _mm256_mul_ps(c0[1], invDet), _mm256_mul_ps(c0[2], invDet), zero,
+				_mm256_mul_ps(c1[0], invDet), _mm256_mul_ps(c1[1], invDet), _mm256_mul_ps(c1[2], invDet), zero,
+				_mm256_mul_ps(c2[0], invDet), _mm256_mul_ps(c2[1], invDet), _mm256_mul_ps(c2[2], invDet), zero,
+				zero, zero, zero, one
+			};
+			StoreMatrices8(normal + i, e, layout);
+		}
+
+		if(i < count)
+			AffineInverseTransposeScalar(world + i, count - i, normal + i, layout);
+	}
+#endif
+}
+
+bool BatchTransform::UsesAvx2()
+{
+	return CpuHasAvx2() && gAvx2Enabled.load(std::memory_order_relaxed);
+}
+
+void BatchTransform::SetAvx2Enabled(bool enabled)
+{
+	gAvx2Enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void BatchTransform::ComposeTRS(const TRSArrays& trs, uint32_t begin, uint32_t end,
+	Float4x4* world, Float4x4* normal, Layout layout)
+{
+	if(begin >= end)
+		return;
+
+#if BATCH_TRANSFORM_X86
+	if(UsesAvx2())
+	{
+		ComposeTRSAvx2(trs, begin, end, world, normal, layout);
+		return;
+	}
+#endif
+
+	ComposeTRSScalar(trs, begin, end, world, normal, layout);
+}
+
+void BatchTransform::AffineInverseTranspose(const Float4x4* world, uint32_t count,
+	Float4x4* normal, Layout layout)
+{
+	if(count == 0)
+		return;
+
+#if BATCH_TRANSFORM_X86
+	if(UsesAvx2())
+	{
+		AffineInverseTransposeAvx2(world, count, normal, layout);
+		return;
+	}
+#endif
+
+	AffineInverseTransposeScalar(world, count, normal, layout);
+}
@@ -0,0 +1,63 @@
+//***************************************************************************************
+// BatchTransform.h
+//
+// Batch computation of world and normal matrices for many objects at once.  Inputs are
+// structure-of-arrays so eight objects map onto the eight lanes of an AVX2 register;
+// a scalar path with identical math is used when AVX2 is unavailable.
+//
+// Matrices follow the DirectXMath conventions: row vectors (v' = v * M), row-major
+// storage, World = S * R * T.  The normal matrix is the inverse-transpose of the upper
+// 3x3 block of World with no translation.  Since World is affine only that block is
+// ever inverted; for TRS input it is not inverted at all (N = S^-1 * R).
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+
+namespace BatchTransform
+{
+	// Same memory layout as DirectX::XMFLOAT4X4.
+	struct Float4x4
+	{
+		float m[4][4];
+	};
+
+	enum class Layout
+	{
+		RowMajor,   // as XMFLOAT4X4
+		Transposed  // ready for a column_major HLSL constant / structured buffer
+	};
+
+	// Translation, rotation (unit quaternion x, y, z, w) and scale, one array per component.
+	struct TRSArrays
+	{
+		const float* Tx;
+		const float* Ty;
+		const float* Tz;
+
+		const float* Qx;
+		const float* Qy;
+		const float* Qz;
+		const float* Qw;
+
+		const float* Sx;
+		const float* Sy;
+		const float* Sz;
+	};
+
+	// True if the CPU and OS support AVX2 and the AVX2 path is not disabled.
+	bool UsesAvx2();
+
+	// Forces the scalar path, e.g. to compare both in a benchmark.
+	void SetAvx2Enabled(bool enabled);
+
+	// Writes world[i] and normal[i] for objects [begin, end).  Either output may be null.
+	void ComposeTRS(const TRSArrays& trs, uint32_t begin, uint32_t end,
+		Float4x4* world, Float4x4* normal, Layout layout = Layout::RowMajor);
+
+	// Normal matrices of arbitrary affine matrices (row-major, row vectors).  Only the
+	// 3x3 block is inverted, via cofactors.  normal may alias world.
+	void AffineInverseTranspose(const Float4x4* world, uint32_t count,
+		Float4x4* normal, Layout layout = Layout::RowMajor);
+}
@@ -0,0 +1,1512 @@
+//***************************************************************************************
+// BcEncoder.cpp
+//***************************************************************************************
+
+#include "BcEncoder.h"
+#include "DdsFile.h"
+#include "JobSystem.h"
+#include "MappedFile.h"
+#include "MipGenerator.h"
+#include "PngFile.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define BC_ENCODER_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define BC_ENCODER_AVX2_TARGET
+#else
+#include <cpuid.h>
+#define BC_ENCODER_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#else
+#define BC_ENCODER_X86 0
+#endif
+
+using namespace BcEncoder;
+
+namespace
+{
+	std::atomic<bool> gAvx2Enabled{ true };
+
+	bool DetectAvx2()
+	{
+#if BC_ENCODER_X86
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		if(info[0] < 7)
+			return false;
+
+		__cpuid(info, 1);
+		const bool osxsave = (info[2] & (1 << 27)) != 0;
+		const bool avx = (info[2] & (1 << 28)) != 0;
+		if(!osxsave || !avx)
+			return false;
+
+		// The OS must save the YMM registers on context switch.
+		if((_xgetbv(0) & 0x6) != 0x6)
+			return false;
+
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#else
+		return __builtin_cpu_supports("avx2");
+#endif
+#else
+		return false;
+#endif
+	}
+
+	bool CpuHasAvx2()
+	{
+		static const bool hasAvx2 = DetectAvx2();
+		return hasAvx2;
+	}
+
+	// DXGI_FORMAT values
+	const uint32_t FormatBC1 = 71;
+	const uint32_t FormatBC1Srgb = 72;
+	const uint32_t FormatBC3 = 77;
+	const uint32_t FormatBC3Srgb = 78;
+	const uint32_t FormatBC5 = 83;
+	const uint32_t FormatBC7 = 98;
+	const uint32_t FormatBC7Srgb = 99;
+
+	const uint16_t AllTexels = 0xFFFF;
+
+	// 4 x 4 texels, channel-major so eight texels of a channel load at once.
+	struct Block
+	{
+		int32_t Px[4][16];
+	};
+
+	struct Palette
+	{
+		int32_t Entry[16][4];
+		uint32_t Count;
+	};
+
+	struct Context
+	{
+		Quality Preset;
+		bool Avx2;
+	};
+
+	// Refinement passes per preset
+	uint32_t Iterations(const Context& ctx, uint32_t normal, uint32_t best)
+	{
+		return ctx.Preset == Quality::Fast ? 0 : ctx.Preset == Quality::Normal ? normal : best;
+	}
+
+	uint32_t TexelCount(uint16_t mask)
+	{
+		uint32_t count = 0;
+		for(; mask; mask &= mask - 1)
+			++count;
+		return count;
+	}
+
+	//-----------------------------------------------------------------------------------
+	// Nearest palette entry per texel: squared distance over channels
+	// [first, first + channels), the first entry wins ties.  Indices are written for all
+	// 16 texels; the returned error counts the texels in mask.
+	//-----------------------------------------------------------------------------------
+
+	uint32_t FitScalar(const Block& block, uint32_t first, uint32_t channels, const Palette& palette, uint16_t mask, uint8_t* indices)
+	{
+		uint32_t total = 0;
+		for(uint32_t i = 0; i < 16; ++i)
+		{
+			int32_t best = INT_MAX;
+			uint32_t bestIndex = 0;
+			for(uint32_t e = 0; e < palette.Count; ++e)
+			{
+				int32_t d = 0;
+				for(uint32_t c = first; c < first + channels; ++c)
+				{
+					const int32_t diff = block.Px[c][i] - palette.Entry[e][c];
+					d += diff * diff;
+				}
+				if(d < best)
+				{
+					best = d;
+					bestIndex = e;
+				}
+			}
+
+			indices[i] = uint8_t(bestIndex);
+			if(mask & (1u << i))
+				total += uint32_t(best);
+		}
+		return total;
+	}
+
+#if BC_ENCODER_X86
+	BC_ENCODER_AVX2_TARGET uint32_t FitAvx2(const Block& block, uint32_t first, uint32_t channels, const Palette& palette, uint16_t mask, uint8_t* indices)
+	{
+		uint32_t total = 0;
+		for(uint32_t half = 0; half < 2; ++half)
+		{
+			__m256i px[4];
+			for(uint32_t c = 0; c < channels; ++c)
+				px[c] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&block.Px[first + c][half * 8]));
+
+			__m256i best = _mm256_set1_epi32(INT_MAX);
+			__m256i bestIndex = _mm256_setzero_si256();
+			for(uint32_t e = 0; e < palette.Count; ++e)
+			{
+				__m256i d = _mm256_setzero_si256();
+				for(uint32_t c = 0; c < channels; ++c)
+				{
+					const __m256i diff = _mm256_sub_epi32(px[c], _mm256_set1_epi32(palette.Entry[e][first + c]));
+					d = _mm256_add_epi32(d, _mm256_mullo_epi32(diff, diff));
+				}
+
+				const __m256i closer = _mm256_cmpgt_epi32(best, d);
+				best = _mm256_min_epi32(best, d);
+				bestIndex = _mm256_blendv_epi8(bestIndex, _mm256_set1_epi32(int32_t(e)), closer);
+			}
+
+			alignas(32) int32_t distance[8];
+			alignas(32) int32_t index[8];
+			_mm256_store_si256(reinterpret_cast<__m256i*>(distance), best);
+			_mm256_store_si256(reinterpret_cast<__m256i*>(index), bestIndex);
+			for(uint32_t i = 0; i < 8; ++i)
+			{
+				const uint32_t texel = half * 8 + i;
+				indices[texel] = uint8_t(index[i]);
+				if(mask & (1u << texel))
+					total += uint32_t(distance[i]);
+			}
+		}
+		return total;
+	}
+#endif
+
+	uint32_t Fit(const Context& ctx, const Block& block, uint32_t first, uint32_t channels, const Palette& palette, uint16_t mask, uint8_t* indices)
+	{
+#if BC_ENCODER_X86
+		if(ctx.Avx2)
+			return FitAvx2(block, first, channels, palette, mask, indices);
+#endif
+		return FitScalar(block, first, channels, palette, mask, indices);
+	}
+
+	//-----------------------------------------------------------------------------------
+	// Endpoint lines
+	//-----------------------------------------------------------------------------------
+
+	struct Line
+	{
+		float E0[4];
+		float E1[4];
+	};
+
+	// Mean and scatter matrix (sums, not averages) of the texels in mask
+	void Scatter(const Block& block, uint32_t first, uint32_t channels, uint16_t mask, float mean[4], float scatter[4][4])
+	{
+		const float count = float((std::max)(TexelCount(mask), 1u));
+		for(uint32_t c = 0; c < channels; ++c)
+		{
+			int32_t sum = 0;
+			for(uint32_t i = 0; i < 16; ++i)
+				if(mask & (1u << i))
+					sum += block.Px[first + c][i];
+			mean[c] = float(sum) / count;
+		}
+
+		for(uint32_t a = 0; a < channels; ++a)
+		{
+			for(uint32_t b = a; b < channels; ++b)
+			{
+				float sum = 0.0f;
+				for(uint32_t i = 0; i < 16; ++i)
+					if(mask & (1u << i))
+						sum += (block.Px[first + a][i] - mean[a]) * (block.Px[first + b][i] - mean[b]);
+				scatter[a][b] = scatter[b][a] = sum;
+			}
+		}
+	}
+
+	// Unit principal axis by power iteration; returns its eigenvalue, 0 for a flat block.
+	float PrincipalAxis(const float scatter[4][4], uint32_t channels, float axis[4])
+	{
+		// Start from the row of the widest channel, which is never orthogonal to the axis
+		// unless the block is flat.
+		uint32_t widest = 0;
+		for(uint32_t c = 1; c < channels; ++c)
+			if(scatter[c][c] > scatter[widest][widest])
+				widest = c;
+		for(uint32_t c = 0; c < channels; ++c)
+			axis[c] = scatter[widest][c];
+
+		float length = 0.0f;
+		for(int iteration = 0; iteration < 8; ++iteration)
+		{
+			float next[4];
+			for(uint32_t a = 0; a < channels; ++a)
+			{
+				next[a] = 0.0f;
+				for(uint32_t b = 0; b < channels; ++b)
+					next[a] += scatter[a][b] * axis[b];
+			}
+
+			length = 0.0f;
+			for(uint32_t c = 0; c < channels; ++c)
+				length += next[c] * next[c];
+			length = std::sqrt(length);
+			if(length < 1e-6f)
+			{
+				for(uint32_t c = 0; c < channels; ++c)
+					axis[c] = 0.0f;
+				return 0.0f;
+			}
+
+			for(uint32_t c = 0; c < channels; ++c)
+				axis[c] = next[c] / length;
+		}
+
+		// Rayleigh quotient of the unit axis
+		float lambda = 0.0f;
+		for(uint32_t a = 0; a < channels; ++a)
+			for(uint32_t b = 0; b < channels; ++b)
+				lambda += axis[a] * scatter[a][b] * axis[b];
+		return lambda;
+	}
+
+	// Endpoints at the extremes of the texels projected on their principal axis
+	void PrincipalLine(const Block& block, uint32_t first, uint32_t channels, uint16_t mask, Line& line)
+	{
+		float mean[4];
+		float scatter[4][4];
+		float axis[4];
+		Scatter(block, first, channels, mask, mean, scatter);
+		PrincipalAxis(scatter, channels, axis);
+
+		float lo = 0.0f;
+		float hi = 0.0f;
+		for(uint32_t i = 0; i < 16; ++i)
+		{
+			if(!(mask & (1u << i)))
+				continue;
+
+			float t = 0.0f;
+			for(uint32_t c = 0; c < channels; ++c)
+				t += (block.Px[first + c][i] - mean[c]) * axis[c];
+			lo = (std::min)(lo, t);
+			hi = (std::max)(hi, t);
+		}
+
+		for(uint32_t c = 0; c < channels; ++c)
+		{
+			line.E0[c] = (std::min)((std::max)(mean[c] + axis[c] * lo, 0.0f), 255.0f);
+			line.E1[c] = (std::min)((std::max)(mean[c] + axis[c] * hi, 0.0f), 255.0f);
+		}
+	}
+
+	// Endpoints that minimize the error for fixed indices; weights[i] is how far palette
+	// entry i lies from E0 towards E1.  False if the indices do not pin down a line.
+	bool LeastSquares(const Block& block, uint32_t first, uint32_t channels, uint16_t mask, const uint8_t* indices,
+		const float* weights, Line& line)
+	{
+		float a = 0.0f;
+		float b = 0.0f;
+		float c = 0.0f;
+		float x0[4] = {};
+		float x1[4] = {};
+		for(uint32_t i = 0; i < 16; ++i)
+		{
+			if(!(mask & (1u << i)))
+				continue;
+
+			const float t = weights[indices[i]];
+			const float s = 1.0f - t;
+			a += s * s;
+			b += s * t;
+			c += t * t;
+			for(uint32_t ch = 0; ch < channels; ++ch)
+			{
+				x0[ch] += s * block.Px[first + ch][i];
+				x1[ch] += t * block.Px[first + ch][i];
+			}
+		}
+
+		const float det = a * c - b * b;
+		if(std::fabs(det) < 1e-6f)
+			return false;
+
+		for(uint32_t ch = 0; ch < channels; ++ch)
+		{
+			line.E0[ch] = (std::min)((std::max)((c * x0[ch] - b * x1[ch]) / det, 0.0f), 255.0f);
+			line.E1[ch] = (std::min)((std::max)((a * x1[ch] - b * x0[ch]) / det, 0.0f), 255.0f);
+		}
+		return true;
+	}
+
+	//-----------------------------------------------------------------------------------
+	// Bit streams, least significant bit first
+	//-----------------------------------------------------------------------------------
+
+	struct BitWriter
+	{
+		uint8_t* Out; // zeroed by the caller
+		uint32_t Pos;
+
+		void Put(uint32_t value, uint32_t bits)
+		{
+			for(uint32_t i = 0; i < bits; ++i, ++Pos)
+				if(value & (1u << i))
+					Out[Pos >> 3] |= uint8_t(1u << (Pos & 7));
+		}
+	};
+
+	struct BitReader
+	{
+		const uint8_t* In;
+		uint32_t Pos;
+
+		uint32_t Get(uint32_t bits)
+		{
+			uint32_t value = 0;
+			for(uint32_t i = 0; i < bits; ++i, ++Pos)
+				value |= uint32_t((In[Pos >> 3] >> (Pos & 7)) & 1) << i;
+			return value;
+		}
+	};
+
+	//-----------------------------------------------------------------------------------
+	// BC1
+	//-----------------------------------------------------------------------------------
+
+	void Expand565(uint16_t color, int32_t rgb[3])
+	{
+		const int32_t r = color >> 11;
+		const int32_t g = (color >> 5) & 63;
+		const int32_t b = color & 31;
+		rgb[0] = (r << 3) | (r >> 2);
+		rgb[1] = (g << 2) | (g >> 4);
+		rgb[2] = (b << 3) | (b >> 2);
+	}
+
+	uint16_t Quantize565(const float rgb[3])
+	{
+		const int32_t r = (std::min)(int32_t(rgb[0] * (31.0f / 255.0f) + 0.5f), 31);
+		const int32_t g = (std::min)(int32_t(rgb[1] * (63.0f / 255.0f) + 0.5f), 63);
+		const int32_t b = (std::min)(int32_t(rgb[2] * (31.0f / 255.0f) + 0.5f), 31);
+		return uint16_t((r << 11) | (g << 5) | b);
+	}
+
+	// Entries in index order.  The 3-color palette's fourth index is transparent black.
+	void Bc1Palette(uint16_t a, uint16_t b, bool threeColor, Palette& palette)
+	{
+		int32_t c0[3];
+		int32_t c1[3];
+		Expand565(a, c0);
+		Expand565(b, c1);
+
+		for(uint32_t c = 0; c < 3; ++c)
+		{
+			palette.Entry[0][c] = c0[c];
+			palette.Entry[1][c] = c1[c];
+			if(threeColor)
+				palette.Entry[2][c] = (c0[c] + c1[c] + 1) / 2;
+			else
+			{
+				palette.Entry[2][c] = (2 * c0[c] + c1[c] + 1) / 3;
+				palette.Entry[3][c] = (c0[c] + 2 * c1[c] + 1) / 3;
+			}
+		}
+		for(uint32_t e = 0; e < 4; ++e)
+			palette.Entry[e][3] = 255;
+		palette.Count = threeColor ? 3 : 4;
+	}
+
+	struct Bc1Candidate
+	{
+		uint16_t A;
+		uint16_t B;
+		uint8_t Indices[16];
+		uint32_t Error = UINT_MAX;
+	};
+
+	bool Bc1Evaluate(const Context& ctx, const Block& block, uint16_t mask, bool threeColor, const Line& line, Bc1Candidate& best)
+	{
+		Bc1Candidate candidate;
+		candidate.A = Quantize565(line.E0);
+		candidate.B = Quantize565(line.E1);
+
+		Palette palette;
+		Bc1Palette(candidate.A, candidate.B, threeColor, palette);
+		candidate.Error = Fit(ctx, block, 0, 3, palette, mask, candidate.Indices);
+
+		if(candidate.Error >= best.Error)
+			return false;
+		best = candidate;
+		return true;
+	}
+
+	void Bc1Search(const Context& ctx, const Block& block, uint16_t mask, bool threeColor, Bc1Candidate& best)
+	{
+		static const float fourWeights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+		static const float threeWeights[3] = { 0.0f, 1.0f, 0.5f };
+
+		Line line;
+		PrincipalLine(block, 0, 3, mask, line);
+
+		Bc1Candidate current;
+		Bc1Evaluate(ctx, block, mask, threeColor, line, current);
+
+		for(uint32_t i = Iterations(ctx, 1, 3); i > 0; --i)
+		{
+			if(!LeastSquares(block, 0, 3, mask, current.Indices, threeColor ? threeWeights : fourWeights, line) ||
+				!Bc1Evaluate(ctx, block, mask, threeColor, line, current))
+				break;
+		}
+
+		if(current.Error < best.Error)
+			best = current;
+	}
+
+	// transparency: BC1 proper, where texels with alpha below 128 use the transparent
+	// index.  The BC3 color block is always read in 4-color mode.
+	void EncodeBc1(const Context& ctx, const Block& block, bool transparency, uint8_t* out)
+	{
+		uint16_t opaque = AllTexels;
+		if(transparency)
+		{
+			for(uint32_t i = 0; i < 16; ++i)
+				if(block.Px[3][i] < 128)
+					opaque &= uint16_t(~(1u << i));
+		}
+
+		uint16_t a = 0;
+		uint16_t b = 0;
+		uint8_t indices[16];
+		bool threeColor = opaque != AllTexels;
+
+		if(opaque == 0)
+			std::memset(indices, 3, sizeof(indices));
+		else
+		{
+			Bc1Candidate best;
+			Bc1Search(ctx, block, opaque, threeColor, best);
+
+			// The 3-color palette has a midpoint that sometimes fits opaque blocks better.
+			if(transparency && !threeColor && ctx.Preset == Quality::Best)
+			{
+				const uint32_t fourError = best.Error;
+				Bc1Search(ctx, block, opaque, true, best);
+				threeColor = best.Error < fourError;
+			}
+
+			a = best.A;
+			b = best.B;
+			std::memcpy(indices, best.Indices, sizeof(indices));
+			for(uint32_t i = 0; i < 16; ++i)
+				if(!(opaque & (1u << i)))
+					indices[i] = 3;
+		}
+
+		// The decoder picks the mode from the endpoint order: a > b is 4-color.
+		if(threeColor ? a > b : a < b)
+		{
+			std::swap(a, b);
+			for(uint8_t& index : indices)
+				index = threeColor ? (index < 2 ? uint8_t(index ^ 1) : index) : uint8_t(index ^ 1);
+		}
+		else if(!threeColor && a == b)
+			std::memset(indices, 0, sizeof(indices)); // would read as 3-color; every entry is a anyway
+
+		out[0] = uint8_t(a);
+		out[1] = uint8_t(a >> 8);
+		out[2] = uint8_t(b);
+		out[3] = uint8_t(b >> 8);
+
+		uint32_t bits = 0;
+		for(uint32_t i = 0; i < 16; ++i)
+			bits |= uint32_t(indices[i]) << (2 * i);
+		std::memcpy(out + 4, &bits, 4);
+	}
+
+	void DecodeBc1(const uint8_t* in, bool alwaysFourColor, uint8_t texels[16][4])
+	{
+		const uint16_t a = uint16_t(in[0] | (in[1] << 8));
+		const uint16_t b = uint16_t(in[2] | (in[3] << 8));
+		const bool threeColor = !alwaysFourColor && a <= b;
+
+		Palette palette;
+		Bc1Palette(a, b, threeColor, palette);
+
+		uint32_t bits;
+		std::memcpy(&bits, in + 4, 4);
+		for(uint32_t i = 0; i < 16; ++i)
+		{
+			const uint32_t index = (bits >> (2 * i)) & 3;
+			for(uint32_t c = 0; c < 4; ++c)
+				texels[i][c] = threeColor && index == 3 ? 0 : uint8_t(palette.Entry[index][c]);
+		}
+	}
+
+	//-----------------------------------------------------------------------------------
+	// BC4, for BC3 alpha and both BC5 channels
+	//-----------------------------------------------------------------------------------
+
+	// a0 > a1 interpolates 8 values; otherwise 6, plus 0 and 255.
+	void Bc4Palette(int32_t a0, int32_t a1, uint32_t channel, Palette& palette)
+	{
+		palette.Entry[0][channel] = a0;
+		palette.Entry[1][channel] = a1;
+		if(a0 > a1)
+		{
+			for(int32_t i = 2; i < 8; ++i)
+				palette.Entry[i][channel] = ((8 - i) * a0 + (i - 1) * a1 + 3) / 7;
+		}
+		else
+		{
+			for(int32_t i = 2; i < 6; ++i)
+				palette.Entry[i][channel] = ((6 - i) * a0 + (i - 1) * a1 + 2) / 5;
+			palette.Entry[6][channel] = 0;
+			palette.Entry[7][channel] = 255;
+		}
+		palette.Count = 8;
+	}
+
+	struct Bc4Candidate
+	{
+		int32_t A0;
+		int32_t A1;
+		uint8_t Indices[16];
+		uint32_t Error = UINT_MAX;
+	};
+
+	bool Bc4Evaluate(const Context& ctx, const Block& block, uint32_t channel, int32_t a0, int32_t a1, Bc4Candidate& best)
+	{
+		Bc4Candidate candidate;
+		candidate.A0 = a0;
+		candidate.A1 = a1;
+
+		Palette palette;
+		Bc4Palette(a0, a1, channel, palette);
+		candidate.Error = Fit(ctx, block, channel, 1, palette, AllTexels, candidate.Indices);
+
+		if(candidate.Error >= best.Error)
+			return false;
+		best = candidate;
+		return true;
+	}
+
+	void EncodeBc4(const Context& ctx, const Block& block, uint32_t channel, uint8_t* out)
+	{
+		static const float weights[8] = { 0.0f, 1.0f, 1 / 7.0f, 2 / 7.0f, 3 / 7.0f, 4 / 7.0f, 5 / 7.0f, 6 / 7.0f };
+
+		int32_t lo = 255;
+		int32_t hi = 0;
+		int32_t innerLo = 255; // without 0 and 255
+		int32_t innerHi = 0;
+		for(uint32_t i = 0; i < 16; ++i)
+		{
+			const int32_t v = block.Px[channel][i];
+			lo = (std::min)(lo, v);
+			hi = (std::max)(hi, v);
+			if(v != 0 && v != 255)
+			{
+				innerLo = (std::min)(innerLo, v);
+				innerHi = (std::max)(innerHi, v);
+			}
+		}
+
+		Bc4Candidate best;
+		Bc4Evaluate(ctx, block, channel, hi, lo, best);
+
+		for(uint32_t i = Iterations(ctx, 1, 3); i > 0 && hi > lo; --i)
+		{
+			Line line;
+			if(!LeastSquares(block, channel, 1, AllTexels, best.Indices, weights, line))
+				break;
+
+			const int32_t a0 = int32_t(line.E0[0] + 0.5f);
+			const int32_t a1 = int32_t(line.E1[0] + 0.5f);
+			if(a0 <= a1 || !Bc4Evaluate(ctx, block, channel, a0, a1, best))
+				break;
+		}
+
+		// Blocks that touch 0 or 255 keep those exact in the 6-value mode.
+		if(ctx.Preset == Quality::Best && (lo == 0 || hi == 255) && innerLo <= innerHi)
+			Bc4Evaluate(ctx, block, channel, innerLo, innerHi, best);
+
+		out[0] = uint8_t(best.A0);
+		out[1] = uint8_t(best.A1);
+		uint64_t bits = 0;
+		for(uint32_t i = 0; i < 16; ++i)
+			bits |= uint64_t(best.Indices[i]) << (3 * i);
+		for(uint32_t i = 0; i < 6; ++i)
+			out[2 + i] = uint8_t(bits >> (8 * i));
+	}
+
+	void DecodeBc4(const uint8_t* in, uint32_t channel, uint8_t texels[16][4])
+	{
+		Palette palette;
+		Bc4Palette(in[0], in[1], channel, palette);
+
+		uint64_t bits = 0;
+		for(uint32_t i = 0; i < 6; ++i)
+			bits |= uint64_t(in[2 + i]) << (8 * i);
+		for(uint32_t i = 0; i < 16; ++i)
+			texels[i][channel] = uint8_t(palette.Entry[(bits >> (3 * i)) & 7][channel]);
+	}
+
+	//-----------------------------------------------------------------------------------
+	// BC7
+	//-----------------------------------------------------------------------------------
+
+	const int32_t Weights2[4] = { 0, 21, 43, 64 };
+	const int32_t Weights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+	const int32_t Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	// Two-subset partitions: bit i set if texel i is in subset 1.
+	const uint16_t Partitions2[64] =
+	{
+		0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80,
+		0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+		0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE,
+		0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+		0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A,
+		0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+		0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C,
+		0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22
+	};
+
+	// Anchor texel of subset 1; subset 0 always anchors at texel 0.
+	const uint8_t Anchors2[64] =
+	{
+		15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+		15, 2, 8, 2, 2, 8, 8, 15, 2, 8, 2, 2, 8, 8, 2, 2,
+		15, 15, 6, 8, 2, 8, 15, 15, 2, 8, 2, 2, 2, 15, 15, 6,
+		6, 2, 6, 8, 15, 15, 2, 2, 15, 15, 15, 15, 15, 2, 2, 15
+	};
+
+	int32_t Interpolate(int32_t e0, int32_t e1, int32_t weight)
+	{
+		return ((64 - weight) * e0 + weight * e1 + 32) >> 6;
+	}
+
+	// An endpoint of bits bits, with its p-bit as the lowest bit when there is one.
+	int32_t ExpandEndpoint(uint32_t value, uint32_t bits)
+	{
+		return bits >= 8 ? int32_t(value) : int32_t((value << (8 - bits)) | (value >> (2 * bits - 8)));
+	}
+
+	// Stored endpoint whose expansion is closest to each 8-bit value, for the layouts the
+	// encoder writes: 7 bits with p-bit 0 or 1 (mode 6), 6 bits with p-bit 0 or 1 (mode
+	// 1), 7 bits without one (mode 5 color).
+	struct EndpointTables
+	{
+		uint8_t Q[5][256];
+
+		EndpointTables()
+		{
+			for(uint32_t layout = 0; layout < 5; ++layout)
+			{
+				const uint32_t bits = layout < 2 || layout == 4 ? 7 : 6;
+				const int32_t p = layout == 4 ? -1 : int32_t(layout & 1);
+				const uint32_t total = bits + (p >= 0 ? 1 : 0);
+
+				for(int32_t v = 0; v < 256; ++v)
+				{
+					int32_t bestError = INT_MAX;
+					for(uint32_t q = 0; q < (1u << bits); ++q)
+					{
+						const uint32_t stored = p >= 0 ? (q << 1) | uint32_t(p) : q;
+						const int32_t error = std::abs(ExpandEndpoint(stored, total) - v);
+						if(error < bestError)
+						{
+							bestError = error;
+							Q[layout][v] = uint8_t(q);
+						}
+					}
+				}
+			}
+		}
+	};
+
+	// Stored value of bits bits closest to v for p-bit p (-1: none).
+	uint32_t QuantizeEndpoint(float v, uint32_t bits, int32_t p)
+	{
+		static const EndpointTables tables;
+		const uint32_t layout = p < 0 ? 4 : (bits == 7 ? 0 : 2) + uint32_t(p);
+		return tables.Q[layout][(std::min)(uint32_t(v + 0.5f), 255u)];
+	}
+
+	// Mode 6: one RGBA line, 7-bit endpoints with a p-bit each, 4-bit indices.
+	struct Mode6
+	{
+		uint8_t Q[2][4];
+		uint8_t P[2];
+		uint8_t Indices[16];
+		uint32_t Error = UINT_MAX;
+	};
+
+	bool Mode6Evaluate(const Context& ctx, const Block& block, const Line& line, Mode6& best)
+	{
+		const float* ends[2] = { line.E0, line.E1 };
+
+		// The p-bit closer to each endpoint, or all four combinations for Best
+		int32_t nearest[2];
+		for(uint32_t e = 0; e < 2; ++e)
+		{
+			float errors[2] = {};
+			for(int32_t p = 0; p < 2; ++p)
+				for(uint32_t c = 0; c < 4; ++c)
+					errors[p] += std::fabs(float(ExpandEndpoint((QuantizeEndpoint(ends[e][c], 7, p) << 1) | uint32_t(p), 8)) - ends[e][c]);
+			nearest[e] = errors[1] < errors[0] ? 1 : 0;
+		}
+
+		bool improved = false;
+		for(uint32_t combination = 0; combination < 4; ++combination)
+		{
+			const int32_t p0 = int32_t(combination & 1);
+			const int32_t p1 = int32_t(combination >> 1);
+			if(ctx.Preset != Quality::Best && (p0 != nearest[0] || p1 != nearest[1]))
+				continue;
+
+			Mode6 candidate;
+			candidate.P[0] = uint8_t(p0);
+			candidate.P[1] = uint8_t(p1);
+
+			int32_t e0[4];
+			int32_t e1[4];
+			for(uint32_t c = 0; c < 4; ++c)
+			{
+				candidate.Q[0][c] = uint8_t(QuantizeEndpoint(line.E0[c], 7, p0));
+				candidate.Q[1][c] = uint8_t(QuantizeEndpoint(line.E1[c], 7, p1));
+				e0[c] = (candidate.Q[0][c] << 1) | p0;
+				e1[c] = (candidate.Q[1][c] << 1) | p1;
+			}
+
+			Palette palette;
+			palette.Count = 16;
+			for(uint32_t i = 0; i < 16; ++i)
+				for(uint32_t c = 0; c < 4; ++c)
+					palette.Entry[i][c] = Interpolate(e0[c], e1[c], Weights4[i]);
+
+			candidate.Error = Fit(ctx, block, 0, 4, palette, AllTexels, candidate.Indices);
+			if(candidate.Error < best.Error)
+			{
+				best = candidate;
+				improved = true;
+			}
+		}
+		return improved;
+	}
+
+	void Mode6Encode(const Context& ctx, const Block& block, Mode6& best)
+	{
+		float weights[16];
+		for(uint32_t i = 0; i < 16; ++i)
+			weights[i] = Weights4[i] / 64.0f;
+
+		Line line;
+		PrincipalLine(block, 0, 4, AllTexels, line);
+		Mode6Evaluate(ctx, block, line, best);
+
+		for(uint32_t i = Iterations(ctx, 1, 2); i > 0; --i)
+		{
+			if(!LeastSquares(block, 0, 4, AllTexels, best.Indices, weights, line) || !Mode6Evaluate(ctx, block, line, best))
+				break;
+		}
+	}
+
+	// Mode 1: two RGB lines over a partition, 6-bit endpoints with a p-bit per subset,
+	// 3-bit indices.  Alpha decodes as 255.
+	struct Mode1
+	{
+		uint32_t Partition;
+		uint8_t Q[2][2][3]; // subset, endpoint, channel
+		uint8_t P[2];
+		uint8_t Indices[16];
+		uint32_t Error = UINT_MAX;
+	};
+
+	struct Subset
+	{
+		uint8_t Q[2][3];
+		uint8_t P;
+		uint8_t Indices[16];
+		uint32_t Error = UINT_MAX;
+	};
+
+	bool SubsetEvaluate(const Context& ctx, const Block& block, uint16_t mask, const Line& line, Subset& best)
+	{
+		bool improved = false;
+		for(int32_t p = 0; p < 2; ++p)
+		{
+			Subset candidate;
+			candidate.P = uint8_t(p);
+
+			int32_t e0[3];
+			int32_t e1[3];
+			for(uint32_t c = 0; c < 3; ++c)
+			{
+				candidate.Q[0][c] = uint8_t(QuantizeEndpoint(line.E0[c], 6, p));
+				candidate.Q[1][c] = uint8_t(QuantizeEndpoint(line.E1[c], 6, p));
+				e0[c] = ExpandEndpoint((uint32_t(candidate.Q[0][c]) << 1) | uint32_t(p), 7);
+				e1[c] = ExpandEndpoint((uint32_t(candidate.Q[1][c]) << 1) | uint32_t(p), 7);
+			}
+
+			Palette palette;
+			palette.Count = 8;
+			for(uint32_t i = 0; i < 8; ++i)
+				for(uint32_t c = 0; c < 3; ++c)
+					palette.Entry[i][c] = Interpolate(e0[c], e1[c], Weights3[i]);
+
+			candidate.Error = Fit(ctx, block, 0, 3, palette, mask, candidate.Indices);
+			if(candidate.Error < best.Error)
+			{
+				best = candidate;
+				improved = true;
+			}
+		}
+		return improved;
+	}
+
+	// Squared distance of texels to their best-fitting RGB line, from the sums of r, g, b
+	// and of their pairwise products (rr, rg, rb, gg, gb, bb) over count texels
+	float LineResidual(const int32_t sums[9], uint32_t count)
+	{
+		if(count < 2)
+			return 0.0f;
+
+		static const uint32_t products[3][3] = { { 3, 4, 5 }, { 4, 6, 7 }, { 5, 7, 8 } };
+		float scatter[3][3];
+		for(uint32_t a = 0; a < 3; ++a)
+			for(uint32_t b = 0; b < 3; ++b)
+				scatter[a][b] = float(sums[products[a][b]]) - float(sums[a]) * float(sums[b]) / float(count);
+
+		// Largest eigenvalue as the Rayleigh quotient after two unnormalized power steps,
+		// close enough to rank partitions
+		uint32_t widest = 0;
+		for(uint32_t c = 1; c < 3; ++c)
+			if(scatter[c][c] > scatter[widest][widest])
+				widest = c;
+
+		float v[3] = { scatter[widest][0], scatter[widest][1], scatter[widest][2] };
+		float w[3];
+		for(int step = 0; step < 2; ++step)
+		{
+			for(uint32_t a = 0; a < 3; ++a)
+				w[a] = scatter[a][0] * v[0] + scatter[a][1] * v[1] + scatter[a][2] * v[2];
+			if(step == 0)
+				std::memcpy(v, w, sizeof(v));
+		}
+
+		const float length = v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+		const float lambda = length > 1e-12f ? (v[0] * w[0] + v[1] * w[1] + v[2] * w[2]) / length : 0.0f;
+		return scatter[0][0] + scatter[1][1] + scatter[2][2] - lambda;
+	}
+
+	void Mode1Encode(const Context& ctx, const Block& block, Mode1& best)
+	{
+		float weights[8];
+		for(uint32_t i = 0; i < 8; ++i)
+			weights[i] = Weights3[i] / 64.0f;
+
+		// Rank the partitions by how well two lines fit them, then encode the best few.
+		// Subset 1 sums are gathered per partition, subset 0 is what remains.
+		int32_t texels[16][9];
+		int32_t total[9] = {};
+		for(uint32_t i = 0; i < 16; ++i)
+		{
+			const int32_t r = block.Px[0][i];
+			const int32_t g = block.Px[1][i];
+			const int32_t b = block.Px[2][i];
+			const int32_t values[9] = { r, g, b, r * r, r * g, r * b, g * g, g * b, b * b };
+			for(uint32_t k = 0; k < 9; ++k)
+			{
+				texels[i][k] = values[k];
+				total[k] += values[k];
+			}
+		}
+
+		std::pair<float, uint32_t> ranked[64];
+		for(uint32_t p = 0; p < 64; ++p)
+		{
+			int32_t inside[9] = {};
+			int32_t outside[9];
+			for(uint32_t i = 0; i < 16; ++i)
+			{
+				const int32_t member = (Partitions2[p] >> i) & 1;
+				for(uint32_t k = 0; k < 9; ++k)
+					inside[k] += member * texels[i][k];
+			}
+			for(uint32_t k = 0; k < 9; ++k)
+				outside[k] = total[k] - inside[k];
+
+			const uint32_t count = TexelCount(Partitions2[p]);
+			ranked[p] = { LineResidual(outside, 16 - count) + LineResidual(inside, count), p };
+		}
+
+		const uint32_t tries = ctx.Preset == Quality::Best ? 8 : 2;
+		std::partial_sort(ranked, ranked + tries, ranked + 64);
+
+		for(uint32_t t = 0; t < tries; ++t)
+		{
+			const uint32_t partition = ranked[t].second;
+			Subset subsets[2];
+			uint32_t error = 0;
+
+			for(uint32_t s = 0; s < 2; ++s)
+			{
+				const uint16_t mask = s ? Partitions2[partition] : uint16_t(~Partitions2[partition]);
+
+				Line line;
+				PrincipalLine(block, 0, 3, mask, line);
+				SubsetEvaluate(ctx, block, mask, line, subsets[s]);
+
+				for(uint32_t i = Iterations(ctx, 1, 2); i > 0; --i)
+				{
+					if(!LeastSquares(block, 0, 3, mask, subsets[s].Indices, weights, line) ||
+						!SubsetEvaluate(ctx, block, mask, line, subsets[s]))
+						break;
+				}
+				error += subsets[s].Error;
+			}
+
+			if(error >= best.Error)
+				continue;
+
+			best.Partition = partition;
+			best.Error = error;
+			for(uint32_t s = 0; s < 2; ++s)
+			{
+				std::memcpy(best.Q[s], subsets[s].Q, sizeof(best.Q[s]));
+				best.P[s] = subsets[s].P;
+			}
+			for(uint32_t i = 0; i < 16; ++i)
+				best.Indices[i] = subsets[(Partitions2[partition] >> i) & 1].Indices[i];
+		}
+	}
+
+	// Mode 5: RGB and alpha fitted separately with 2-bit indices each, 7-bit color and
+	// 8-bit alpha endpoints.  A rotation swaps alpha with one color channel first.
+	struct Mode5
+	{
+		uint32_t Rotation;
+		uint8_t Color[2][3];
+		uint8_t Alpha[2];
+		uint8_t ColorIndices[16];
+		uint8_t AlphaIndices[16];
+		uint32_t Error = UINT_MAX;
+	};
+
+	void Mode5Encode(const Context& ctx, const Block& block, Mode5& best)
+	{
+		float weights[4];
+		for(uint32_t i = 0; i < 4; ++i)
+			weights[i] = Weights2[i] / 64.0f;
+
+		const uint32_t rotations = ctx.Preset == Quality::Best ? 4 : 1;
+		for(uint32_t rotation = 0; rotation < rotations; ++rotation)
+		{
+			Block rotated = block;
+			if(rotation)
+				std::swap(rotated.Px[rotation - 1], rotated.Px[3]);
+
+			Mode5 candidate;
+			candidate.Rotation = rotation;
+
+			// Color
+			Line line;
+			PrincipalLine(rotated, 0, 3, AllTexels, line);
+			uint32_t colorError = UINT_MAX;
+			for(uint32_t i = 0; ; ++i)
+			{
+				uint8_t q[2][3];
+				Palette palette;
+				palette.Count = 4;
+				for(uint32_t c = 0; c < 3; ++c)
+				{
+					q[0][c] = uint8_t(QuantizeEndpoint(line.E0[c], 7, -1));
+					q[1][c] = uint8_t(QuantizeEndpoint(line.E1[c], 7, -1));
+					for(uint32_t e = 0; e < 4; ++e)
+						palette.Entry[e][c] = Interpolate(ExpandEndpoint(q[0][c], 7), ExpandEndpoint(q[1][c], 7), Weights2[e]);
+				}
+
+				uint8_t indices[16];
+				const uint32_t error = Fit(ctx, rotated, 0, 3, palette, AllTexels, indices);
+				if(error >= colorError)
+					break;
+
+				colorError = error;
+				std::memcpy(candidate.Color, q, sizeof(q));
+				std::memcpy(candidate.ColorIndices, indices, sizeof(indices));
+				if(i == Iterations(ctx, 1, 2) || !LeastSquares(rotated, 0, 3, AllTexels, indices, weights, line))
+					break;
+			}
+
+			// Alpha
+			int32_t lo = 255;
+			int32_t hi = 0;
+			for(uint32_t i = 0; i < 16; ++i)
+			{
+				lo = (std::min)(lo, rotated.Px[3][i]);
+				hi = (std::max)(hi, rotated.Px[3][i]);
+			}
+
+			uint32_t alphaError = UINT_MAX;
+			int32_t a0 = lo;
+			int32_t a1 = hi;
+			for(uint32_t i = 0; ; ++i)
+			{
+				Palette palette;
+				palette.Count = 4;
+				for(uint32_t e = 0; e < 4; ++e)
+					palette.Entry[e][3] = Interpolate(a0, a1, Weights2[e]);
+
+				uint8_t indices[16];
+				const uint32_t error = Fit(ctx, rotated, 3, 1, palette, AllTexels, indices);
+				if(error >= alphaError)
+					break;
+
+				alphaError = error;
+				candidate.Alpha[0] = uint8_t(a0);
+				candidate.Alpha[1] = uint8_t(a1);
+				std::memcpy(candidate.AlphaIndices, indices, sizeof(indices));
+
+				Line alpha;
+				if(i == Iterations(ctx, 1, 2) || !LeastSquares(rotated, 3, 1, AllTexels, indices, weights, alpha))
+					break;
+				a0 = int32_t(alpha.E0[0] + 0.5f);
+				a1 = int32_t(alpha.E1[0] + 0.5f);
+			}
+
+			candidate.Error = colorError + alphaError;
+			if(candidate.Error < best.Error)
+				best = candidate;
+		}
+	}
+
+	void PackMode6(Mode6 mode, uint8_t* out)
+	{
+		// The anchor index drops its top bit, so it must be below 8.
+		if(mode.Indices[0] >= 8)
+		{
+			std::swap(mode.Q[0], mode.Q[1]);
+			std::swap(mode.P[0], mode.P[1]);
+			for(uint8_t& index : mode.Indices)
+				index = uint8_t(15 - index);
+		}
+
+		BitWriter writer = { out, 0 };
+		writer.Put(1u << 6, 7);
+		for(uint32_t c = 0; c < 4; ++c)
+		{
+			writer.Put(mode.Q[0][c], 7);
+			writer.Put(mode.Q[1][c], 7);
+		}
+		writer.Put(mode.P[0], 1);
+		writer.Put(mode.P[1], 1);
+		for(uint32_t i = 0; i < 16; ++i)
+			writer.Put(mode.Indices[i], i == 0 ? 3 : 4);
+	}
+
+	void PackMode1(Mode1 mode, uint8_t* out)
+	{
+		const uint16_t partition = Partitions2[mode.Partition];
+		const uint32_t anchors[2] = { 0, Anchors2[mode.Partition] };
+
+		for(uint32_t s = 0; s < 2; ++s)
+		{
+			if(mode.Indices[anchors[s]] < 4)
+				continue;
+
+			std::swap(mode.Q[s][0], mode.Q[s][1]);
+			for(uint32_t i = 0; i < 16; ++i)
+				if(((partition >> i) & 1) == s)
+					mode.Indices[i] = uint8_t(7 - mode.Indices[i]);
+		}
+
+		BitWriter writer = { out, 0 };
+		writer.Put(1u << 1, 2);
+		writer.Put(mode.Partition, 6);
+		for(uint32_t c = 0; c < 3; ++c)
+			for(uint32_t s = 0; s < 2; ++s)
+				for(uint32_t e = 0; e < 2; ++e)
+					writer.Put(mode.Q[s][e][c], 6);
+		writer.Put(mode.P[0], 1);
+		writer.Put(mode.P[1], 1);
+		for(uint32_t i = 0; i < 16; ++i)
+			writer.Put(mode.Indices[i], i == anchors[0] || i == anchors[1] ? 2 : 3);
+	}
+
+	void PackMode5(Mode5 mode, uint8_t* out)
+	{
+		if(mode.ColorIndices[0] >= 2)
+		{
+			std::swap(mode.Color[0], mode.Color[1]);
+			for(uint8_t& index : mode.ColorIndices)
+				index = uint8_t(3 - index);
+		}
+		if(mode.AlphaIndices[0] >= 2)
+		{
+			std::swap(mode.Alpha[0], mode.Alpha[1]);
+			for(uint8_t& index : mode.AlphaIndices)
+				index = uint8_t(3 - index);
+		}
+
+		BitWriter writer = { out, 0 };
+		writer.Put(1u << 5, 6);
+		writer.Put(mode.Rotation, 2);
+		for(uint32_t c = 0; c < 3; ++c)
+		{
+			writer.Put(mode.Color[0][c], 7);
+			writer.Put(mode.Color[1][c], 7);
+		}
+		writer.Put(mode.Alpha[0], 8);
+		writer.Put(mode.Alpha[1], 8);
+		for(uint32_t i = 0; i < 16; ++i)
+			writer.Put(mode.ColorIndices[i], i == 0 ? 1 : 2);
+		for(uint32_t i = 0; i < 16; ++i)
+			writer.Put(mode.AlphaIndices[i], i == 0 ? 1 : 2);
+	}
+
+	void EncodeBc7(const Context& ctx, const Block& block, uint8_t* out)
+	{
+		bool opaque = true;
+		for(uint32_t i = 0; i < 16; ++i)
+			opaque = opaque && block.Px[3][i] == 255;
+
+		Mode6 mode6;
+		Mode6Encode(ctx, block, mode6);
+
+		Mode1 mode1;
+		Mode5 mode5;
+		if(ctx.Preset != Quality::Fast)
+		{
+			if(opaque)
+				Mode1Encode(ctx, block, mode1);
+			else
+				Mode5Encode(ctx, block, mode5);
+		}
+
+		if(mode1.Error < mode6.Error)
+			PackMode1(mode1, out);
+		else if(mode5.Error < mode6.Error)
+			PackMode5(mode5, out);
+		else
+			PackMode6(mode6, out);
+	}
+
+	void DecodeBc7(const uint8_t* in, uint8_t texels[16][4])
+	{
+		BitReader reader = { in, 0 };
+		uint32_t mode = 0;
+		while(mode < 8 && !reader.Get(1))
+			++mode;
+
+		std::memset(texels, 0, 16 * 4);
+
+		if(mode == 6)
+		{
+			uint32_t q[2][4];
+			for(uint32_t c = 0; c < 4; ++c)
+			{
+				q[0][c] = reader.Get(7);
+				q[1][c] = reader.Get(7);
+			}
+			const uint32_t p0 = reader.Get(1);
+			const uint32_t p1 = reader.Get(1);
+			for(uint32_t i = 0; i < 16; ++i)
+			{
+				const uint32_t index = reader.Get(i == 0 ? 3 : 4);
+				for(uint32_t c = 0; c < 4; ++c)
+					texels[i][c] = uint8_t(Interpolate(int32_t((q[0][c] << 1) | p0), int32_t((q[1][c] << 1) | p1), Weights4[index]));
+			}
+		}
+		else if(mode == 5)
+		{
+			const uint32_t rotation = reader.Get(2);
+			int32_t color[2][3];
+			for(uint32_t c = 0; c < 3; ++c)
+			{
+				color[0][c] = ExpandEndpoint(reader.Get(7), 7);
+				color[1][c] = ExpandEndpoint(reader.Get(7), 7);
+			}
+			const int32_t a0 = int32_t(reader.Get(8));
+			const int32_t a1 = int32_t(reader.Get(8));
+			for(uint32_t i = 0; i < 16; ++i)
+			{
+				const uint32_t index = reader.Get(i == 0 ? 1 : 2);
+				for(uint32_t c = 0; c < 3; ++c)
+					texels[i][c] = uint8_t(Interpolate(color[0][c], color[1][c], Weights2[index]));
+			}
+			for(uint32_t i = 0; i < 16; ++i)
+			{
+				texels[i][3] = uint8_t(Interpolate(a0, a1, Weights2[reader.Get(i == 0 ? 1 : 2)]));
+				if(rotation)
+					std::swap(texels[i][rotation - 1], texels[i][3]);
+			}
+		}
+		else if(mode == 1)
+		{
+			const uint32_t partition = reader.Get(6);
+			uint32_t q[2][2][3];
+			for(uint32_t c = 0; c < 3; ++c)
+				for(uint32_t s = 0; s < 2; ++s)
+					for(uint32_t e = 0; e < 2; ++e)
+						q[s][e][c] = reader.Get(6);
+			const uint32_t p[2] = { reader.Get(1), reader.Get(1) };
+
+			for(uint32_t i = 0; i < 16; ++i)
+			{
+				const uint32_t s = (Partitions2[partition] >> i) & 1;
+				const uint32_t index = reader.Get(i == 0 || i == Anchors2[partition] ? 2 : 3);
+				for(uint32_t c = 0; c < 3; ++c)
+					texels[i][c] = uint8_t(Interpolate(ExpandEndpoint((q[s][0][c] << 1) | p[s], 7),
+						ExpandEndpoint((q[s][1][c] << 1) | p[s], 7), Weights3[index]));
+				texels[i][3] = 255;
+			}
+		}
+	}
+
+	//-----------------------------------------------------------------------------------
+	// Surfaces
+	//-----------------------------------------------------------------------------------
+
+	void LoadBlock(const uint8_t* rgba, uint64_t rowPitch, uint32_t width, uint32_t height, uint32_t bx, uint32_t by, Block& block)
+	{
+		for(uint32_t y = 0; y < 4; ++y)
+		{
+			const uint8_t* row = rgba + (std::min)(by * 4 + y, height - 1) * rowPitch;
+			for(uint32_t x = 0; x < 4; ++x)
+			{
+				const uint8_t* texel = row + (std::min)(bx * 4 + x, width - 1) * 4;
+				for(uint32_t c = 0; c < 4; ++c)
+					block.Px[c][y * 4 + x] = texel[c];
+			}
+		}
+	}
+
+	void EncodeBlock(Format format, const Context& ctx, const Block& block, uint8_t* out)
+	{
+		std::memset(out, 0, BlockBytes(format));
+		switch(format)
+		{
+		case Format::BC1:
+			EncodeBc1(ctx, block, true, out);
+			break;
+		case Format::BC3:
+			EncodeBc4(ctx, block, 3, out);
+			EncodeBc1(ctx, block, false, out + 8);
+			break;
+		case Format::BC5:
+			EncodeBc4(ctx, block, 0, out);
+			EncodeBc4(ctx, block, 1, out + 8);
+			break;
+		default:
+			EncodeBc7(ctx, block, out);
+			break;
+		}
+	}
+
+	void DecodeBlock(Format format, const uint8_t* in, uint8_t texels[16][4])
+	{
+		switch(format)
+		{
+		case Format::BC1:
+			DecodeBc1(in, false, texels);
+			break;
+		case Format::BC3:
+			DecodeBc1(in + 8, true, texels);
+			DecodeBc4(in, 3, texels);
+			break;
+		case Format::BC5:
+			for(uint32_t i = 0; i < 16; ++i)
+			{
+				texels[i][2] = 0;
+				texels[i][3] = 255;
+			}
+			DecodeBc4(in, 0, texels);
+			DecodeBc4(in + 8, 1, texels);
+			break;
+		default:
+			DecodeBc7(in, texels);
+			break;
+		}
+	}
+}
+
+uint32_t BcEncoder::DxgiFormat(Format format, bool srgb)
+{
+	switch(format)
+	{
+	case Format::BC1:
+		return srgb ? FormatBC1Srgb : FormatBC1;
+	case Format::BC3:
+		return srgb ? FormatBC3Srgb : FormatBC3;
+	case Format::BC5:
+		return FormatBC5;
+	default:
+		return srgb ? FormatBC7Srgb : FormatBC7;
+	}
+}
+
+uint32_t BcEncoder::BlockBytes(Format format)
+{
+	return format == Format::BC1 ? 8 : 16;
+}
+
+uint64_t BcEncoder::SurfaceBytes(Format format, uint32_t width, uint32_t height)
+{
+	return uint64_t((width + 3) / 4) * ((height + 3) / 4) * BlockBytes(format);
+}
+
+void BcEncoder::Compress(Format format, const uint8_t* rgba, uint64_t rowPitch, uint32_t width, uint32_t height,
+	uint8_t* blocks, const Options& options)
+{
+	PROFILE_ZONE("BcEncoder::Compress");
+
+	if(width == 0 || height == 0)
+		return;
+
+	const uint32_t blocksWide = (width + 3) / 4;
+	const uint32_t blocksHigh = (height + 3) / 4;
+	const uint32_t blockBytes = BlockBytes(format);
+	const Context ctx = { options.Preset, UsesAvx2() };
+
+	auto compressRows = [&](uint32_t begin, uint32_t end)
+	{
+		Block block;
+		for(uint32_t by = begin; by < end; ++by)
+		{
+			uint8_t* out = blocks + uint64_t(by) * blocksWide * blockBytes;
+			for(uint32_t bx = 0; bx < blocksWide; ++bx, out += blockBytes)
+			{
+				LoadBlock(rgba, rowPitch, width, height, bx, by, block);
+				EncodeBlock(format, ctx, block, out);
+			}
+		}
+	};
+
+	if(options.Parallel)
+		JobSystem::ParallelFor(blocksHigh, (std::max)(1u, 64u / blocksWide), compressRows);
+	else
+		compressRows(0, blocksHigh);
+}
+
+void BcEncoder::Decompress(Format format, const uint8_t* blocks, uint32_t width, uint32_t height,
+	uint8_t* rgba, uint64_t rowPitch)
+{
+	const uint32_t blocksWide = (width + 3) / 4;
+	const uint32_t blocksHigh = (height + 3) / 4;
+	const uint32_t blockBytes = BlockBytes(format);
+
+	uint8_t texels[16][4];
+	for(uint32_t by = 0; by < blocksHigh; ++by)
+	{
+		for(uint32_t bx = 0; bx < blocksWide; ++bx)
+		{
+			DecodeBlock(format, blocks + (uint64_t(by) * blocksWide + bx) * blockBytes, texels);
+
+			for(uint32_t y = 0; y < 4 && by * 4 + y < height; ++y)
+				for(uint32_t x = 0; x < 4 && bx * 4 + x < width; ++x)
+					std::memcpy(rgba + (by * 4 + y) * rowPitch + (bx * 4 + x) * 4, texels[y * 4 + x], 4);
+		}
+	}
+}
+
+bool BcEncoder::UsesAvx2()
+{
+	return CpuHasAvx2() && gAvx2Enabled.load(std::memory_order_relaxed);
+}
+
+void BcEncoder::SetAvx2Enabled(bool enabled)
+{
+	gAvx2Enabled.store(enabled, std::memory_order_relaxed);
+}
+
+std::string BcEncoder::ImportPng(const std::string& pngPath, const std::string& cacheDirectory, Format format,
+	const Options& options)
+{
+	PROFILE_ZONE("BcEncoder::ImportPng");
+
+	namespace fs = std::filesystem;
+
+	static const char* formatNames[] = { "bc1", "bc3", "bc5", "bc7" };
+	static const char* presetNames[] = { "fast", "normal", "best" };
+
+	const fs::path source(pngPath);
+	const fs::path target = fs::path(cacheDirectory) / (source.stem().string() + "." +
+		formatNames[int(format)] + "." + presetNames[int(options.Preset)] + ".dds");
+
+	std::error_code error;
+	const fs::file_time_type sourceTime = fs::last_write_time(source, error);
+	if(error)
+		throw std::runtime_error("BcEncoder: cannot read " + pngPath);
+
+	const fs::file_time_type targetTime = fs::last_write_time(target, error);
+	if(!error && targetTime >= sourceTime)
+		return target.string();
+
+	// Decode straight into the top level of a packed mip chain
+	MappedFile file;
+	file.Open(pngPath.c_str());
+	const PngFile::Info info = PngFile::ReadInfo(file.Data(), static_cast<size_t>(file.Size()));
+
+	const bool srgb = info.SRGB && format != Format::BC5;
+	const MipGenerator::Format mipFormat = srgb ? MipGenerator::Format::RGBA8Srgb : MipGenerator::Format::RGBA8;
+	const uint32_t mipCount = MipGenerator::MipCount(info.Width, info.Height);
+
+	std::vector<uint8_t> pixels(static_cast<size_t>(MipGenerator::ChainBytes(mipFormat, info.Width, info.Height, mipCount)));
+	std::vector<MipGenerator::Level> levels;
+	MipGenerator::PackedChain(mipFormat, info.Width, info.Height, mipCount, pixels.data(), levels);
+	PngFile::Decode(file.Data(), static_cast<size_t>(file.Size()), pixels.data(), static_cast<size_t>(levels[0].RowPitch));
+	MipGenerator::Generate(mipFormat, levels.data(), mipCount);
+
+	DdsFile::Desc desc;
+	desc.Format = DxgiFormat(format, srgb);
+	desc.Width = info.Width;
+	desc.Height = info.Height;
+	desc.Depth = 1;
+	desc.ArraySize = 1;
+	desc.MipCount = mipCount;
+
+	std::vector<uint8_t> dds;
+	DdsFile::WriteHeader(desc, dds);
+	for(const MipGenerator::Level& level : levels)
+	{
+		const size_t offset = dds.size();
+		dds.resize(offset + static_cast<size_t>(SurfaceBytes(format, level.Width, level.Height)));
+		Compress(format, level.Data, level.RowPitch, level.Width, level.Height, &dds[offset], options);
+	}
+
+	// Written aside and renamed, so a reader never sees half a file
+	fs::create_directories(cacheDirectory, error);
+	fs::path temporary = target;
+	temporary += ".tmp";
+	{
+		std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+		out.write(reinterpret_cast<const char*>(dds.data()), std::streamsize(dds.size()));
+		if(!out)
+			throw std::runtime_error("BcEncoder: cannot write " + temporary.string());
+	}
+
+	fs::rename(temporary, target, error);
+	if(error)
+		throw std::runtime_error("BcEncoder: cannot write " + target.string());
+
+	return target.string();
+}
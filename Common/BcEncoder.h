@@ -0,0 +1,88 @@
+//***************************************************************************************
+// BcEncoder.h
+//
+// Block compression of RGBA8 images at import time.  Textures that go through WIC stay
+// RGBA8 and take 4-8 times the memory and bandwidth of BCn; this compresses them once
+// into .dds files that DDSTextureLoader and DdsFile load directly.
+//   -BC1: RGB in 4 bpp, texels with alpha below 128 become transparent (3-color mode).
+//   -BC3: BC1 color plus a BC4 alpha block, 8 bpp.
+//   -BC5: two BC4 blocks for red and green, for normal maps, 8 bpp.
+//   -BC7: modes 6 (one RGBA line), 1 (two RGB lines over 64 partitions) and 5 (RGB and
+//    alpha fitted separately, with channel rotation), 8 bpp.
+//
+// Endpoints start on the principal axis of the block's colors and are refined by least
+// squares from the chosen indices.  The presets trade quality for speed:
+//   -Fast: no refinement; BC7 uses mode 6 only.
+//   -Normal: one refinement pass; BC7 also tries the 2 best-looking mode 1 partitions,
+//    and mode 5 for blocks with alpha.
+//   -Best: up to three passes, every p-bit combination, 8 mode 1 partitions, all mode 5
+//    rotations, and the BC1 3-color and BC4 6-value modes where they help.
+//
+// Finding the nearest palette entry for every texel is the hot loop; it runs on AVX2 when
+// the CPU has it, with an integer scalar path that picks the same entries.  Block rows
+// are spread over the job system.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace BcEncoder
+{
+	enum class Format
+	{
+		BC1,
+		BC3,
+		BC5,
+		BC7
+	};
+
+	enum class Quality
+	{
+		Fast,
+		Normal,
+		Best
+	};
+
+	struct Options
+	{
+		Quality Preset = Quality::Normal;
+		bool Parallel = true; // split block rows across the job system
+	};
+
+	// DXGI_FORMAT of the compressed texture; BC5 has no sRGB variant.
+	uint32_t DxgiFormat(Format format, bool srgb);
+
+	// 8 for BC1, 16 for the rest.
+	uint32_t BlockBytes(Format format);
+
+	// Bytes of a surface: rows of 4 x 4 blocks, tightly packed as in a DDS file.
+	uint64_t SurfaceBytes(Format format, uint32_t width, uint32_t height);
+
+	// Compresses a width x height RGBA8 surface into SurfaceBytes() of blocks.  Blocks
+	// that stick out of the surface repeat its last row and column.  sRGB data is
+	// compressed as stored, like the GPU decodes it.
+	void Compress(Format format, const uint8_t* rgba, uint64_t rowPitch, uint32_t width, uint32_t height,
+		uint8_t* blocks, const Options& options = Options());
+
+	// Expands blocks back to RGBA8, to measure the error.  Handles BC1, BC3 and BC5 fully,
+	// and the BC7 modes Compress() writes; other BC7 modes decode as zero.  BC5 gives
+	// blue 0 and alpha 255.
+	void Decompress(Format format, const uint8_t* blocks, uint32_t width, uint32_t height,
+		uint8_t* rgba, uint64_t rowPitch);
+
+	// True if the CPU and OS support AVX2 and the AVX2 path is not disabled.
+	bool UsesAvx2();
+
+	// Forces the scalar path, e.g. to compare both in a benchmark.
+	void SetAvx2Enabled(bool enabled);
+
+	// Compresses a PNG with its full mip chain into cacheDirectory unless an up-to-date
+	// .dds is already there, and returns the .dds path.  The name tells format and preset
+	// apart ("bricks.bc7.normal.dds"); a file older than the PNG is rebuilt.  sRGB PNGs
+	// become _SRGB formats and get mips filtered in linear light.  Throws
+	// std::runtime_error if the PNG cannot be read or the .dds cannot be written.
+	std::string ImportPng(const std::string& pngPath, const std::string& cacheDirectory, Format format,
+		const Options& options = Options());
+}
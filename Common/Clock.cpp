@@ -0,0 +1,77 @@
+//***************************************************************************************
+// Clock.cpp
+//***************************************************************************************
+
+#include "Clock.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+namespace
+{
+	int64_t QueryFrequency()
+	{
+#if defined(_WIN32)
+		LARGE_INTEGER freq;
+		QueryPerformanceFrequency(&freq);
+		return freq.QuadPart;
+#else
+		return 1000000000;
+#endif
+	}
+
+	struct Calibration
+	{
+		int64_t Frequency = QueryFrequency();
+		double SecondsPerTick = 1.0 / static_cast<double>(Frequency);
+
+		// Matching pair of samples used to derive the TSC rate later on.
+		int64_t BaseTime = Clock::Now();
+		uint64_t BaseTsc = Clock::ReadTsc();
+	};
+
+	const Calibration& GetCalibration()
+	{
+		static const Calibration calibration;
+		return calibration;
+	}
+}
+
+int64_t Clock::Now()
+{
+#if defined(_WIN32)
+	LARGE_INTEGER t;
+	QueryPerformanceCounter(&t);
+	return t.QuadPart;
+#else
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+int64_t Clock::Frequency()
+{
+	return GetCalibration().Frequency;
+}
+
+double Clock::SecondsPerTick()
+{
+	return GetCalibration().SecondsPerTick;
+}
+
+double Clock::TscTicksPerSecond()
+{
+	const Calibration& c = GetCalibration();
+
+	const double seconds = ToSeconds(Now() - c.BaseTime);
+	const uint64_t ticks = ReadTsc() - c.BaseTsc;
+
+	if(seconds <= 0.0 || ticks == 0)
+		return static_cast<double>(c.Frequency);
+
+	return static_cast<double>(ticks) / seconds;
+}
@@ -0,0 +1,48 @@
+//***************************************************************************************
+// Clock.h
+//
+// Portable monotonic high-resolution clock shared by the timers and the profiler.
+//   -Now() reads the OS clock: QueryPerformanceCounter on Windows and
+//    clock_gettime(CLOCK_MONOTONIC) elsewhere.
+//   -ReadTsc() reads the CPU time-stamp counter where available.  It is cheaper than
+//    Now() but its rate must be calibrated against the OS clock (TscTicksPerSecond).
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace Clock
+{
+	// Current value of the OS monotonic clock, in ticks.
+	int64_t Now();
+
+	// Ticks of Now() per second.
+	int64_t Frequency();
+
+	double SecondsPerTick();
+
+	inline double ToSeconds(int64_t ticks)
+	{
+		return static_cast<double>(ticks) * SecondsPerTick();
+	}
+
+	inline uint64_t ReadTsc()
+	{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+#else
+		return static_cast<uint64_t>(Now());
+#endif
+	}
+
+	// Rate of ReadTsc(), measured against Now() since the first call into Clock.
+	// The estimate sharpens the longer the process has been running.
+	double TscTicksPerSecond();
+}
@@ -83,6 +83,9 @@ namespace DirectX
                                       _Out_opt_ DDS_ALPHA_MODE* alphaMode = nullptr
                                     );
 
+	// Maps the file instead of reading it: the header is parsed in place and each
+	// subresource is copied from the mapping straight into textureUploadHeap.  Supports
+	// 1D, 2D, 3D and cube textures, and files over 4 GB in 64-bit builds.
 	HRESULT CreateDDSTextureFromFile12(_In_ ID3D12Device* device,
 		                               _In_ ID3D12GraphicsCommandList* cmdList,
 		                               _In_z_ const wchar_t* szFileName,
@@ -0,0 +1,802 @@
+//***************************************************************************************
+// DdsFile.cpp
+//***************************************************************************************
+
+#include "DdsFile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+	// DXGI_FORMAT values used by the layout rules.
+	enum Format : uint32_t
+	{
+		R32G32B32A32_TYPELESS = 1, R32G32B32A32_FLOAT, R32G32B32A32_UINT, R32G32B32A32_SINT,
+		R32G32B32_TYPELESS, R32G32B32_FLOAT, R32G32B32_UINT, R32G32B32_SINT,
+		R16G16B16A16_TYPELESS, R16G16B16A16_FLOAT, R16G16B16A16_UNORM, R16G16B16A16_UINT,
+		R16G16B16A16_SNORM, R16G16B16A16_SINT,
+		R32G32_TYPELESS, R32G32_FLOAT, R32G32_UINT, R32G32_SINT,
+		R32G8X24_TYPELESS, D32_FLOAT_S8X24_UINT, R32_FLOAT_X8X24_TYPELESS, X32_TYPELESS_G8X24_UINT,
+		R10G10B10A2_TYPELESS, R10G10B10A2_UNORM, R10G10B10A2_UINT, R11G11B10_FLOAT,
+		R8G8B8A8_TYPELESS, R8G8B8A8_UNORM, R8G8B8A8_UNORM_SRGB, R8G8B8A8_UINT, R8G8B8A8_SNORM, R8G8B8A8_SINT,
+		R16G16_TYPELESS, R16G16_FLOAT, R16G16_UNORM, R16G16_UINT, R16G16_SNORM, R16G16_SINT,
+		R32_TYPELESS, D32_FLOAT, R32_FLOAT, R32_UINT, R32_SINT,
+		R24G8_TYPELESS, D24_UNORM_S8_UINT, R24_UNORM_X8_TYPELESS, X24_TYPELESS_G8_UINT,
+		R8G8_TYPELESS, R8G8_UNORM, R8G8_UINT, R8G8_SNORM, R8G8_SINT,
+		R16_TYPELESS, R16_FLOAT, D16_UNORM, R16_UNORM, R16_UINT, R16_SNORM, R16_SINT,
+		R8_TYPELESS, R8_UNORM, R8_UINT, R8_SNORM, R8_SINT, A8_UNORM,
+		R1_UNORM, R9G9B9E5_SHAREDEXP, R8G8_B8G8_UNORM, G8R8_G8B8_UNORM,
+		BC1_TYPELESS, BC1_UNORM, BC1_UNORM_SRGB, BC2_TYPELESS, BC2_UNORM, BC2_UNORM_SRGB,
+		BC3_TYPELESS, BC3_UNORM, BC3_UNORM_SRGB, BC4_TYPELESS, BC4_UNORM, BC4_SNORM,
+		BC5_TYPELESS, BC5_UNORM, BC5_SNORM,
+		B5G6R5_UNORM, B5G5R5A1_UNORM, B8G8R8A8_UNORM, B8G8R8X8_UNORM, R10G10B10_XR_BIAS_A2_UNORM,
+		B8G8R8A8_TYPELESS, B8G8R8A8_UNORM_SRGB, B8G8R8X8_TYPELESS, B8G8R8X8_UNORM_SRGB,
+		BC6H_TYPELESS, BC6H_UF16, BC6H_SF16, BC7_TYPELESS, BC7_UNORM, BC7_UNORM_SRGB,
+		AYUV, Y410, Y416, NV12, P010, P016, OPAQUE_420, YUY2, Y210, Y216, NV11, AI44, IA44, P8, A8P8,
+		B4G4R4A4_UNORM,
+		P208 = 130, V208, V408
+	};
+
+	static_assert(R8G8B8A8_UNORM == 28 && BC1_UNORM == 71 && BC7_UNORM_SRGB == 99 && B4G4R4A4_UNORM == 115,
+		"Format must follow DXGI_FORMAT");
+
+	constexpr uint32_t FourCC(char a, char b, char c, char d)
+	{
+		return uint32_t(uint8_t(a)) | (uint32_t(uint8_t(b)) << 8) |
+			(uint32_t(uint8_t(c)) << 16) | (uint32_t(uint8_t(d)) << 24);
+	}
+
+	const uint32_t DdsMagic = FourCC('D', 'D', 'S', ' ');
+
+	const uint32_t PixelFourCC = 0x00000004;
+	const uint32_t PixelRgb = 0x00000040;
+	const uint32_t PixelLuminance = 0x00020000;
+	const uint32_t PixelAlpha = 0x00000002;
+
+	const uint32_t HeaderCaps = 0x00000001;
+	const uint32_t HeaderHeight = 0x00000002;
+	const uint32_t HeaderWidth = 0x00000004;
+	const uint32_t HeaderPixelFormat = 0x00001000;
+	const uint32_t HeaderMipCount = 0x00020000;
+	const uint32_t HeaderVolume = 0x00800000;
+
+	const uint32_t CapsComplex = 0x00000008;
+	const uint32_t CapsTexture = 0x00001000;
+	const uint32_t CapsMipmap = 0x00400000;
+
+	const uint32_t Caps2Cubemap = 0x00000200;
+	const uint32_t Caps2AllFaces = 0x0000FC00;
+	const uint32_t Caps2Volume = 0x00200000;
+
+	const uint32_t MiscTextureCube = 0x4; // D3D11_RESOURCE_MISC_TEXTURECUBE
+	const uint32_t MiscFlags2AlphaModeMask = 0x7;
+
+	// Direct3D 12 limits (D3D12_REQ_*).
+	const uint32_t MaxMipLevels = 15;
+	const uint32_t MaxTexture1D = 16384;
+	const uint32_t MaxTexture2D = 16384;
+	const uint32_t MaxTexture3D = 2048;
+	const uint32_t MaxArraySize = 2048;
+
+#pragma pack(push, 1)
+	struct PixelFormat
+	{
+		uint32_t Size;
+		uint32_t Flags;
+		uint32_t FourCC;
+		uint32_t RgbBitCount;
+		uint32_t RBitMask;
+		uint32_t GBitMask;
+		uint32_t BBitMask;
+		uint32_t ABitMask;
+	};
+
+	struct Header
+	{
+		uint32_t Size;
+		uint32_t Flags;
+		uint32_t Height;
+		uint32_t Width;
+		uint32_t PitchOrLinearSize;
+		uint32_t Depth;
+		uint32_t MipMapCount;
+		uint32_t Reserved1[11];
+		PixelFormat Pixels;
+		uint32_t Caps;
+		uint32_t Caps2;
+		uint32_t Caps3;
+		uint32_t Caps4;
+		uint32_t Reserved2;
+	};
+
+	struct HeaderDx10
+	{
+		uint32_t Format;
+		uint32_t ResourceDimension;
+		uint32_t MiscFlag;
+		uint32_t ArraySize;
+		uint32_t MiscFlags2;
+	};
+#pragma pack(pop)
+
+	static_assert(sizeof(PixelFormat) == 32, "DDS pixel format must be 32 bytes");
+	static_assert(sizeof(Header) == 124, "DDS header must be 124 bytes");
+	static_assert(sizeof(HeaderDx10) == 20, "DDS DX10 header must be 20 bytes");
+
+	[[noreturn]] void Fail(const std::string& what)
+	{
+		throw std::runtime_error("DdsFile: " + what);
+	}
+
+	uint32_t FormatFromPixelFormat(const PixelFormat& pf)
+	{
+		auto mask = [&pf](uint32_t r, uint32_t g, uint32_t b, uint32_t a)
+		{
+			return pf.RBitMask == r && pf.GBitMask == g && pf.BBitMask == b && pf.ABitMask == a;
+		};
+
+		if(pf.Flags & PixelRgb)
+		{
+			switch(pf.RgbBitCount)
+			{
+			case 32:
+				if(mask(0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000)) return R8G8B8A8_UNORM;
+				if(mask(0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000)) return B8G8R8A8_UNORM;
+				if(mask(0x00ff0000, 0x0000ff00, 0x000000ff, 0x00000000)) return B8G8R8X8_UNORM;
+				// D3DX writes 10:10:10:2 with red and blue swapped.
+				if(mask(0x3ff00000, 0x000ffc00, 0x000003ff, 0xc0000000)) return R10G10B10A2_UNORM;
+				if(mask(0x0000ffff, 0xffff0000, 0x00000000, 0x00000000)) return R16G16_UNORM;
+				if(mask(0xffffffff, 0x00000000, 0x00000000, 0x00000000)) return R32_FLOAT;
+				break;
+
+			case 16:
+				if(mask(0x7c00, 0x03e0, 0x001f, 0x8000)) return B5G5R5A1_UNORM;
+				if(mask(0xf800, 0x07e0, 0x001f, 0x0000)) return B5G6R5_UNORM;
+				if(mask(0x0f00, 0x00f0, 0x000f, 0xf000)) return B4G4R4A4_UNORM;
+				break;
+			}
+		}
+		else if(pf.Flags & PixelLuminance)
+		{
+			if(pf.RgbBitCount == 8 && mask(0xff, 0, 0, 0)) return R8_UNORM;
+			if(pf.RgbBitCount == 16 && mask(0xffff, 0, 0, 0)) return R16_UNORM;
+			if(pf.RgbBitCount == 16 && mask(0xff, 0, 0, 0xff00)) return R8G8_UNORM;
+		}
+		else if(pf.Flags & PixelAlpha)
+		{
+			if(pf.RgbBitCount == 8) return A8_UNORM;
+		}
+		else if(pf.Flags & PixelFourCC)
+		{
+			switch(pf.FourCC)
+			{
+			case FourCC('D', 'X', 'T', '1'): return BC1_UNORM;
+			case FourCC('D', 'X', 'T', '2'):
+			case FourCC('D', 'X', 'T', '3'): return BC2_UNORM;
+			case FourCC('D', 'X', 'T', '4'):
+			case FourCC('D', 'X', 'T', '5'): return BC3_UNORM;
+			case FourCC('A', 'T', 'I', '1'):
+			case FourCC('B', 'C', '4', 'U'): return BC4_UNORM;
+			case FourCC('B', 'C', '4', 'S'): return BC4_SNORM;
+			case FourCC('A', 'T', 'I', '2'):
+			case FourCC('B', 'C', '5', 'U'): return BC5_UNORM;
+			case FourCC('B', 'C', '5', 'S'): return BC5_SNORM;
+			case FourCC('R', 'G', 'B', 'G'): return R8G8_B8G8_UNORM;
+			case FourCC('G', 'R', 'G', 'B'): return G8R8_G8B8_UNORM;
+			case FourCC('Y', 'U', 'Y', '2'): return YUY2;
+
+			// D3DFORMAT values stored as a FourCC
+			case 36: return R16G16B16A16_UNORM;  // D3DFMT_A16B16G16R16
+			case 110: return R16G16B16A16_SNORM; // D3DFMT_Q16W16V16U16
+			case 111: return R16_FLOAT;          // D3DFMT_R16F
+			case 112: return R16G16_FLOAT;       // D3DFMT_G16R16F
+			case 113: return R16G16B16A16_FLOAT; // D3DFMT_A16B16G16R16F
+			case 114: return R32_FLOAT;          // D3DFMT_R32F
+			case 115: return R32G32_FLOAT;       // D3DFMT_G32R32F
+			case 116: return R32G32B32A32_FLOAT; // D3DFMT_A32B32G32R32F
+			}
+		}
+
+		return 0;
+	}
+}
+
+void DdsFile::Open(const char* path)
+{
+	mFile.Open(path);
+	mData = mFile.Data();
+	mSize = mFile.Size();
+	Parse();
+}
+
+#if defined(_WIN32)
+void DdsFile::Open(const wchar_t* path)
+{
+	mFile.Open(path);
+	mData = mFile.Data();
+	mSize = mFile.Size();
+	Parse();
+}
+#endif
+
+void DdsFile::Open(const uint8_t* data, uint64_t size)
+{
+	mFile.Close();
+	mData = data;
+	mSize = size;
+	Parse();
+}
+
+void DdsFile::Parse()
+{
+	mDesc = Desc();
+	mDataOffset = 0;
+
+	if(mData == nullptr || mSize < sizeof(uint32_t) + sizeof(Header))
+		Fail("file too small for a DDS header");
+
+	uint32_t magic;
+	std::memcpy(&magic, mData, sizeof(magic));
+	if(magic != DdsMagic)
+		Fail("not a DDS file");
+
+	// The header is small and may be unaligned in caller-owned bytes, so it is copied
+	// out; the texture data itself is only ever read in place.
+	Header header;
+	std::memcpy(&header, mData + sizeof(uint32_t), sizeof(header));
+	if(header.Size != sizeof(Header) || header.Pixels.Size != sizeof(PixelFormat))
+		Fail("bad header size");
+
+	mDataOffset = sizeof(uint32_t) + sizeof(Header);
+
+	mDesc.Width = header.Width;
+	mDesc.Height = header.Height;
+	mDesc.Depth = header.Depth;
+	mDesc.ArraySize = 1;
+	mDesc.MipCount = (std::max)(header.MipMapCount, 1u);
+
+	const bool dx10 = (header.Pixels.Flags & PixelFourCC) && header.Pixels.FourCC == FourCC('D', 'X', '1', '0');
+	if(dx10)
+	{
+		if(mSize < mDataOffset + sizeof(HeaderDx10))
+			Fail("file too small for the DX10 header");
+
+		HeaderDx10 ext;
+		std::memcpy(&ext, mData + mDataOffset, sizeof(ext));
+		mDataOffset += sizeof(HeaderDx10);
+
+		mDesc.ArraySize = ext.ArraySize;
+		if(mDesc.ArraySize == 0)
+			Fail("array size is zero");
+
+		switch(ext.Format)
+		{
+		case AI44:
+		case IA44:
+		case P8:
+		case A8P8:
+			Fail("palettized formats are not supported");
+		}
+		if(BitsPerPixel(ext.Format) == 0)
+			Fail("unsupported format " + std::to_string(ext.Format));
+		mDesc.Format = ext.Format;
+
+		switch(ext.ResourceDimension)
+		{
+		case Texture1D:
+			if((header.Flags & HeaderHeight) && mDesc.Height != 1)
+				Fail("1D texture with a height");
+			mDesc.Height = mDesc.Depth = 1;
+			break;
+
+		case Texture2D:
+			if(ext.MiscFlag & MiscTextureCube)
+			{
+				if(mDesc.ArraySize > MaxArraySize / 6)
+					Fail("too many cubes");
+				mDesc.ArraySize *= 6;
+				mDesc.CubeMap = true;
+			}
+			mDesc.Depth = 1;
+			break;
+
+		case Texture3D:
+			if(!(header.Flags & HeaderVolume))
+				Fail("3D texture without the volume flag");
+			if(mDesc.ArraySize > 1)
+				Fail("3D texture arrays are not supported");
+			break;
+
+		default:
+			Fail("unknown resource dimension");
+		}
+		mDesc.Type = static_cast<Dimension>(ext.ResourceDimension);
+
+		const uint32_t alpha = ext.MiscFlags2 & MiscFlags2AlphaModeMask;
+		if(alpha <= AlphaCustom)
+			mDesc.Alpha = static_cast<AlphaMode>(alpha);
+	}
+	else
+	{
+		mDesc.Format = FormatFromPixelFormat(header.Pixels);
+		if(mDesc.Format == 0)
+			Fail("unsupported pixel format");
+
+		if(header.Flags & HeaderVolume)
+		{
+			mDesc.Type = Texture3D;
+		}
+		else
+		{
+			if(header.Caps2 & Caps2Cubemap)
+			{
+				if((header.Caps2 & Caps2AllFaces) != Caps2AllFaces)
+					Fail("cube maps must have all six faces");
+				mDesc.ArraySize = 6;
+				mDesc.CubeMap = true;
+			}
+
+			mDesc.Depth = 1;
+			mDesc.Type = Texture2D;
+		}
+
+		if((header.Pixels.Flags & PixelFourCC) &&
+			(header.Pixels.FourCC == FourCC('D', 'X', 'T', '2') || header.Pixels.FourCC == FourCC('D', 'X', 'T', '4')))
+			mDesc.Alpha = AlphaPremultiplied;
+	}
+
+	// Metadata beyond the hardware limits is not trusted.
+	if(mDesc.Width == 0 || mDesc.Height == 0 || mDesc.Depth == 0)
+		Fail("empty texture");
+	if(mDesc.MipCount > MaxMipLevels)
+		Fail("too many mips");
+
+	switch(mDesc.Type)
+	{
+	case Texture1D:
+		if(mDesc.ArraySize > MaxArraySize || mDesc.Width > MaxTexture1D)
+			Fail("1D texture too large");
+		break;
+
+	case Texture2D:
+		if(mDesc.ArraySize > MaxArraySize || mDesc.Width > MaxTexture2D || mDesc.Height > MaxTexture2D)
+			Fail("2D texture too large");
+		break;
+
+	case Texture3D:
+		if(mDesc.Width > MaxTexture3D || mDesc.Height > MaxTexture3D || mDesc.Depth > MaxTexture3D)
+			Fail("3D texture too large");
+		break;
+	}
+
+	// Planes are split exactly only for single-mip 2D textures of even size (a multiple
+	// of four wide for NV11), which is also what video hardware expects.
+	if(PlaneCount(mDesc.Format) > 1)
+	{
+		const uint32_t widthAlign = mDesc.Format == NV11 ? 4 : 2;
+		if(mDesc.Type != Texture2D || mDesc.MipCount != 1 ||
+			mDesc.Width % widthAlign != 0 || mDesc.Height % 2 != 0)
+			Fail("planar formats need a single mip of even size");
+	}
+}
+
+void DdsFile::ComputeLayout(size_t maxSize, Layout& layout) const
+{
+	layout.Subresources.clear();
+
+	auto mipSize = [](uint32_t size, uint32_t mip) { return (std::max)(size >> mip, 1u); };
+
+	// Which mips are kept depends only on their size, so it is the same for every slice.
+	uint32_t skip = 0;
+	if(maxSize != 0 && mDesc.MipCount > 1)
+	{
+		while(skip < mDesc.MipCount &&
+			(mipSize(mDesc.Width, skip) > maxSize || mipSize(mDesc.Height, skip) > maxSize || mipSize(mDesc.Depth, skip) > maxSize))
+			++skip;
+
+		if(skip == mDesc.MipCount)
+			Fail("no mip fits in " + std::to_string(maxSize));
+	}
+
+	layout.SkipMips = skip;
+	layout.Width = mipSize(mDesc.Width, skip);
+	layout.Height = mipSize(mDesc.Height, skip);
+	layout.Depth = mipSize(mDesc.Depth, skip);
+	layout.MipCount = mDesc.MipCount - skip;
+	layout.ArraySize = mDesc.ArraySize;
+	layout.PlaneCount = PlaneCount(mDesc.Format);
+	layout.Subresources.resize(size_t(layout.MipCount) * layout.ArraySize * layout.PlaneCount);
+
+	// The file stores slice by slice, mip by mip, with the planes of a surface back to
+	// back; D3D12 numbers planes outermost.
+	uint64_t offset = mDataOffset;
+	for(uint32_t slice = 0; slice < mDesc.ArraySize; ++slice)
+	{
+		for(uint32_t mip = 0; mip < mDesc.MipCount; ++mip)
+		{
+			const uint32_t width = mipSize(mDesc.Width, mip);
+			const uint32_t height = mipSize(mDesc.Height, mip);
+			const uint32_t depth = mipSize(mDesc.Depth, mip);
+
+			uint64_t surfaceBytes = 0;
+			SurfaceInfo(width, height, mDesc.Format, &surfaceBytes, nullptr, nullptr);
+
+			// Sizes are bounded by the limits checked in Parse, so this cannot overflow.
+			const uint64_t bytes = surfaceBytes * depth;
+			if(bytes > mSize - offset)
+				Fail("file truncated at array slice " + std::to_string(slice) + ", mip " + std::to_string(mip));
+
+			if(mip >= skip)
+			{
+				uint64_t planeOffset = offset;
+				for(uint32_t plane = 0; plane < layout.PlaneCount; ++plane)
+				{
+					const size_t index = (mip - skip) + (slice + size_t(plane) * layout.ArraySize) * layout.MipCount;
+					Subresource& sub = layout.Subresources[index];
+
+					uint64_t numRows = 0;
+					PlaneInfo(width, height, mDesc.Format, plane, &sub.RowBytes, &sub.RowPitch, &numRows);
+					sub.NumRows = static_cast<uint32_t>(numRows);
+					sub.SliceBytes = sub.RowPitch * numRows;
+					sub.Offset = planeOffset;
+					sub.Width = width;
+					sub.Height = height;
+					sub.Depth = depth;
+					sub.Plane = plane;
+
+					planeOffset += sub.SliceBytes;
+				}
+			}
+
+			offset += bytes;
+		}
+	}
+}
+
+void DdsFile::CopySubresource(const Subresource& subresource, uint8_t* dst, uint64_t dstRowPitch, uint64_t dstSlicePitch) const
+{
+	const uint8_t* src = mData + subresource.Offset;
+
+	if(subresource.RowPitch == subresource.RowBytes && dstRowPitch == subresource.RowBytes &&
+		dstSlicePitch == subresource.SliceBytes)
+	{
+		std::memcpy(dst, src, static_cast<size_t>(subresource.SliceBytes * subresource.Depth));
+		return;
+	}
+
+	for(uint32_t z = 0; z < subresource.Depth; ++z)
+	{
+		const uint8_t* srcSlice = src + z * subresource.SliceBytes;
+		uint8_t* dstSlice = dst + z * dstSlicePitch;
+
+		for(uint32_t row = 0; row < subresource.NumRows; ++row)
+			std::memcpy(dstSlice + row * dstRowPitch, srcSlice + row * subresource.RowPitch, static_cast<size_t>(subresource.RowBytes));
+	}
+}
+
+uint64_t DdsFile::PlanUpload(const Layout& layout, std::vector<Footprint>& footprints)
+{
+	const uint64_t rowAlignment = 256;       // D3D12_TEXTURE_DATA_PITCH_ALIGNMENT
+	const uint64_t placementAlignment = 512; // D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT
+
+	footprints.resize(layout.Subresources.size());
+
+	uint64_t size = 0;
+	for(size_t i = 0; i < layout.Subresources.size(); ++i)
+	{
+		const Subresource& sub = layout.Subresources[i];
+		Footprint& footprint = footprints[i];
+
+		footprint.Offset = (size + placementAlignment - 1) & ~(placementAlignment - 1);
+		footprint.RowPitch = (sub.RowBytes + rowAlignment - 1) & ~(rowAlignment - 1);
+		footprint.SlicePitch = footprint.RowPitch * sub.NumRows;
+
+		// The last row of the last slice is not padded.
+		size = footprint.Offset + footprint.SlicePitch * (sub.Depth - 1) +
+			footprint.RowPitch * (sub.NumRows - 1) + sub.RowBytes;
+	}
+
+	return size;
+}
+
+uint32_t DdsFile::BitsPerPixel(uint32_t format)
+{
+	switch(format)
+	{
+	case R32G32B32A32_TYPELESS: case R32G32B32A32_FLOAT: case R32G32B32A32_UINT: case R32G32B32A32_SINT:
+		return 128;
+
+	case R32G32B32_TYPELESS: case R32G32B32_FLOAT: case R32G32B32_UINT: case R32G32B32_SINT:
+		return 96;
+
+	case R16G16B16A16_TYPELESS: case R16G16B16A16_FLOAT: case R16G16B16A16_UNORM: case R16G16B16A16_UINT:
+	case R16G16B16A16_SNORM: case R16G16B16A16_SINT:
+	case R32G32_TYPELESS: case R32G32_FLOAT: case R32G32_UINT: case R32G32_SINT:
+	case R32G8X24_TYPELESS: case D32_FLOAT_S8X24_UINT: case R32_FLOAT_X8X24_TYPELESS: case X32_TYPELESS_G8X24_UINT:
+	case Y416: case Y210: case Y216:
+		return 64;
+
+	case R10G10B10A2_TYPELESS: case R10G10B10A2_UNORM: case R10G10B10A2_UINT: case R11G11B10_FLOAT:
+	case R8G8B8A8_TYPELESS: case R8G8B8A8_UNORM: case R8G8B8A8_UNORM_SRGB: case R8G8B8A8_UINT:
+	case R8G8B8A8_SNORM: case R8G8B8A8_SINT:
+	case R16G16_TYPELESS: case R16G16_FLOAT: case R16G16_UNORM: case R16G16_UINT: case R16G16_SNORM: case R16G16_SINT:
+	case R32_TYPELESS: case D32_FLOAT: case R32_FLOAT: case R32_UINT: case R32_SINT:
+	case R24G8_TYPELESS: case D24_UNORM_S8_UINT: case R24_UNORM_X8_TYPELESS: case X24_TYPELESS_G8_UINT:
+	case R9G9B9E5_SHAREDEXP: case R8G8_B8G8_UNORM: case G8R8_G8B8_UNORM:
+	case B8G8R8A8_UNORM: case B8G8R8X8_UNORM: case R10G10B10_XR_BIAS_A2_UNORM:
+	case B8G8R8A8_TYPELESS: case B8G8R8A8_UNORM_SRGB: case B8G8R8X8_TYPELESS: case B8G8R8X8_UNORM_SRGB:
+	case AYUV: case Y410: case YUY2:
+		return 32;
+
+	case P010: case P016:
+		return 24;
+
+	case V408:
+		return 24;
+
+	case R8G8_TYPELESS: case R8G8_UNORM: case R8G8_UINT: case R8G8_SNORM: case R8G8_SINT:
+	case R16_TYPELESS: case R16_FLOAT: case D16_UNORM: case R16_UNORM: case R16_UINT: case R16_SNORM: case R16_SINT:
+	case B5G6R5_UNORM: case B5G5R5A1_UNORM: case A8P8: case B4G4R4A4_UNORM:
+	case P208: case V208:
+		return 16;
+
+	case NV12: case OPAQUE_420: case NV11:
+		return 12;
+
+	case R8_TYPELESS: case R8_UNORM: case R8_UINT: case R8_SNORM: case R8_SINT: case A8_UNORM:
+	case AI44: case IA44: case P8:
+		return 8;
+
+	case R1_UNORM:
+		return 1;
+
+	case BC1_TYPELESS: case BC1_UNORM: case BC1_UNORM_SRGB: case BC4_TYPELESS: case BC4_UNORM: case BC4_SNORM:
+		return 4;
+
+	case BC2_TYPELESS: case BC2_UNORM: case BC2_UNORM_SRGB: case BC3_TYPELESS: case BC3_UNORM: case BC3_UNORM_SRGB:
+	case BC5_TYPELESS: case BC5_UNORM: case BC5_SNORM: case BC6H_TYPELESS: case BC6H_UF16: case BC6H_SF16:
+	case BC7_TYPELESS: case BC7_UNORM: case BC7_UNORM_SRGB:
+		return 8;
+
+	default:
+		return 0;
+	}
+}
+
+bool DdsFile::IsCompressed(uint32_t format)
+{
+	return (format >= BC1_TYPELESS && format <= BC5_SNORM) || (format >= BC6H_TYPELESS && format <= BC7_UNORM_SRGB);
+}
+
+uint32_t DdsFile::PlaneCount(uint32_t format)
+{
+	switch(format)
+	{
+	case NV12: case P010: case P016: case OPAQUE_420: case NV11: case P208:
+		return 2;
+
+	case V208: case V408:
+		return 3;
+
+	default:
+		return 1;
+	}
+}
+
+void DdsFile::SurfaceInfo(uint64_t width, uint64_t height, uint32_t format,
+	uint64_t* numBytes, uint64_t* rowBytes, uint64_t* numRows)
+{
+	uint64_t bytes = 0;
+	uint64_t row = 0;
+	uint64_t rows = 0;
+
+	bool bc = false;
+	bool packed = false;
+	bool planar = false;
+	uint64_t bytesPerElement = 0;
+
+	switch(format)
+	{
+	case BC1_TYPELESS: case BC1_UNORM: case BC1_UNORM_SRGB: case BC4_TYPELESS: case BC4_UNORM: case BC4_SNORM:
+		bc = true;
+		bytesPerElement = 8;
+		break;
+
+	case BC2_TYPELESS: case BC2_UNORM: case BC2_UNORM_SRGB: case BC3_TYPELESS: case BC3_UNORM: case BC3_UNORM_SRGB:
+	case BC5_TYPELESS: case BC5_UNORM: case BC5_SNORM: case BC6H_TYPELESS: case BC6H_UF16: case BC6H_SF16:
+	case BC7_TYPELESS: case BC7_UNORM: case BC7_UNORM_SRGB:
+		bc = true;
+		bytesPerElement = 16;
+		break;
+
+	case R8G8_B8G8_UNORM: case G8R8_G8B8_UNORM: case YUY2:
+		packed = true;
+		bytesPerElement = 4;
+		break;
+
+	case Y210: case Y216:
+		packed = true;
+		bytesPerElement = 8;
+		break;
+
+	case NV12: case OPAQUE_420:
+		planar = true;
+		bytesPerElement = 2;
+		break;
+
+	case P010: case P016:
+		planar = true;
+		bytesPerElement = 4;
+		break;
+	}
+
+	if(bc)
+	{
+		const uint64_t blocksWide = width > 0 ? (std::max)(uint64_t(1), (width + 3) / 4) : 0;
+		const uint64_t blocksHigh = height > 0 ? (std::max)(uint64_t(1), (height + 3) / 4) : 0;
+		row = blocksWide * bytesPerElement;
+		rows = blocksHigh;
+		bytes = row * blocksHigh;
+	}
+	else if(packed)
+	{
+		row = ((width + 1) >> 1) * bytesPerElement;
+		rows = height;
+		bytes = row * height;
+	}
+	else if(format == NV11)
+	{
+		// Direct3D treats NV11 as twice the rows of the luma plane, which over-estimates 4:1:1.
+		row = ((width + 3) >> 2) * 4;
+		rows = height * 2;
+		bytes = row * rows;
+	}
+	else if(planar)
+	{
+		row = ((width + 1) >> 1) * bytesPerElement;
+		bytes = row * height + ((row * height + 1) >> 1);
+		rows = height + ((height + 1) >> 1);
+	}
+	else if(format == P208)
+	{
+		row = ((width + 1) >> 1) * 2;
+		rows = height * 2;
+		bytes = row * rows;
+	}
+	else if(format == V208)
+	{
+		row = width;
+		rows = height + ((height + 1) >> 1) * 2;
+		bytes = row * rows;
+	}
+	else if(format == V408)
+	{
+		row = width;
+		rows = height + (height >> 1) * 4;
+		bytes = row * rows;
+	}
+	else
+	{
+		row = (width * BitsPerPixel(format) + 7) / 8;
+		rows = height;
+		bytes = row * height;
+	}
+
+	if(numBytes)
+		*numBytes = bytes;
+	if(rowBytes)
+		*rowBytes = row;
+	if(numRows)
+		*numRows = rows;
+}
+
+void DdsFile::PlaneInfo(uint64_t width, uint64_t height, uint32_t format, uint32_t plane,
+	uint64_t* rowBytes, uint64_t* rowPitch, uint64_t* numRows)
+{
+	uint64_t bytes = 0;
+	uint64_t pitch = 0;
+	uint64_t rows = 0;
+
+	switch(format)
+	{
+	case NV12: case OPAQUE_420: case P010: case P016:
+		// Luma, then interleaved chroma at half resolution: the same row size, half the rows.
+		pitch = ((width + 1) >> 1) * (format == P010 || format == P016 ? 4 : 2);
+		rows = plane == 0 ? height : (height + 1) >> 1;
+		bytes = pitch;
+		break;
+
+	case P208:
+		// 4:2:2: interleaved chroma has every row.
+		pitch = ((width + 1) >> 1) * 2;
+		rows = height;
+		bytes = pitch;
+		break;
+
+	case V208:
+		pitch = width;
+		rows = plane == 0 ? height : (height + 1) >> 1;
+		bytes = pitch;
+		break;
+
+	case V408:
+		pitch = width;
+		rows = height;
+		bytes = pitch;
+		break;
+
+	case NV11:
+		// SurfaceInfo pads the quarter-width chroma rows to the luma row size.
+		pitch = ((width + 3) >> 2) * 4;
+		rows = height;
+		bytes = plane == 0 ? width : ((width + 3) >> 2) * 2;
+		break;
+
+	default:
+		SurfaceInfo(width, height, format, nullptr, &bytes, &rows);
+		pitch = bytes;
+		break;
+	}
+
+	if(rowBytes)
+		*rowBytes = bytes;
+	if(rowPitch)
+		*rowPitch = pitch;
+	if(numRows)
+		*numRows = rows;
+}
+
+uint32_t DdsFile::LegacyFormat(const void* pixelFormat)
+{
+	PixelFormat pf;
+	std::memcpy(&pf, pixelFormat, sizeof(pf));
+	return FormatFromPixelFormat(pf);
+}
+
+void DdsFile::WriteHeader(const Desc& desc, std::vector<uint8_t>& out)
+{
+	Header header = {};
+	header.Size = sizeof(Header);
+	header.Flags = HeaderCaps | HeaderHeight | HeaderWidth | HeaderPixelFormat;
+	header.Width = desc.Width;
+	header.Height = desc.Height;
+	header.Depth = desc.Type == Texture3D ? desc.Depth : 0;
+	header.MipMapCount = desc.MipCount;
+	header.Pixels.Size = sizeof(PixelFormat);
+	header.Pixels.Flags = PixelFourCC;
+	header.Pixels.FourCC = FourCC('D', 'X', '1', '0');
+	header.Caps = CapsTexture;
+
+	if(desc.MipCount > 1)
+	{
+		header.Flags |= HeaderMipCount;
+		header.Caps |= CapsComplex | CapsMipmap;
+	}
+	if(desc.Type == Texture3D)
+	{
+		header.Flags |= HeaderVolume;
+		header.Caps |= CapsComplex;
+		header.Caps2 |= Caps2Volume;
+	}
+	if(desc.CubeMap)
+	{
+		header.Caps |= CapsComplex;
+		header.Caps2 |= Caps2Cubemap | Caps2AllFaces;
+	}
+
+	HeaderDx10 ext = {};
+	ext.Format = desc.Format;
+	ext.ResourceDimension = desc.Type;
+	ext.MiscFlag = desc.CubeMap ? MiscTextureCube : 0;
+	ext.ArraySize = desc.CubeMap ? desc.ArraySize / 6 : desc.ArraySize;
+	ext.MiscFlags2 = desc.Alpha;
+
+	const size_t start = out.size();
+	out.resize(start + sizeof(uint32_t) + sizeof(Header) + sizeof(HeaderDx10));
+	std::memcpy(&out[start], &DdsMagic, sizeof(uint32_t));
+	std::memcpy(&out[start + sizeof(uint32_t)], &header, sizeof(Header));
+	std::memcpy(&out[start + sizeof(uint32_t) + sizeof(Header)], &ext, sizeof(HeaderDx10));
+}
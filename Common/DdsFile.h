@@ -0,0 +1,159 @@
+//***************************************************************************************
+// DdsFile.h
+//
+// DDS header parsing and subresource layout without Direct3D.  The file is memory
+// mapped and the header is read in place; ComputeLayout() then gives the file offset,
+// row size and row count of every subresource, so each one can be copied from the
+// mapping straight into its footprint in an upload buffer.  Nothing is read into an
+// intermediate copy, and offsets are 64-bit so files larger than 4 GB load in 64-bit
+// builds.
+//
+// This is also the only place that knows DDS format and surface math: block-compressed,
+// packed (two pixels per element) and planar video formats, whose planes are separate
+// D3D12 subresources.  PlanUpload() places the subresources in an upload buffer the way
+// GetCopyableFootprints does, so uploads can be validated and sized without a device.
+//
+// Formats are DXGI_FORMAT values kept as plain integers, so this builds and runs
+// without the Windows headers.
+//***************************************************************************************
+
+#pragma once
+
+#include "MappedFile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class DdsFile
+{
+public:
+	// Same values as D3D12_RESOURCE_DIMENSION.
+	enum Dimension : uint32_t
+	{
+		Texture1D = 2,
+		Texture2D = 3,
+		Texture3D = 4
+	};
+
+	// Same values as DirectX::DDS_ALPHA_MODE.
+	enum AlphaMode : uint32_t
+	{
+		AlphaUnknown = 0,
+		AlphaStraight = 1,
+		AlphaPremultiplied = 2,
+		AlphaOpaque = 3,
+		AlphaCustom = 4
+	};
+
+	struct Desc
+	{
+		Dimension Type = Texture2D;
+		uint32_t Format = 0; // DXGI_FORMAT
+		uint32_t Width = 0;
+		uint32_t Height = 0;    // 1 for 1D textures
+		uint32_t Depth = 0;     // 1 unless Type is Texture3D
+		uint32_t ArraySize = 0; // six per cube for cube maps
+		uint32_t MipCount = 0;
+		bool CubeMap = false;
+		AlphaMode Alpha = AlphaUnknown;
+	};
+
+	struct Subresource
+	{
+		uint64_t Offset;     // from the start of the file
+		uint64_t RowBytes;   // bytes to copy per row
+		uint64_t RowPitch;   // distance between rows in the file; RowBytes except for NV11 chroma
+		uint32_t NumRows;    // per depth slice; rows of blocks for BC formats
+		uint64_t SliceBytes; // RowPitch * NumRows
+		uint32_t Width;
+		uint32_t Height;
+		uint32_t Depth;
+		uint32_t Plane;
+	};
+
+	// Where a subresource goes in an upload buffer.
+	struct Footprint
+	{
+		uint64_t Offset;
+		uint64_t RowPitch;
+		uint64_t SlicePitch;
+	};
+
+	struct Layout
+	{
+		uint32_t SkipMips = 0; // leading mips dropped by maxSize
+
+		// Size of the texture to create: the largest mip that was kept.
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		uint32_t Depth = 0;
+		uint32_t MipCount = 0;
+		uint32_t ArraySize = 0;
+		uint32_t PlaneCount = 0;
+
+		// In D3D12 subresource order: mip + (arraySlice + plane * ArraySize) * MipCount.
+		std::vector<Subresource> Subresources;
+	};
+
+	// Maps the file and parses its header.  Throws std::runtime_error if the file cannot
+	// be mapped, is not a DDS file, or describes a texture Direct3D 12 cannot create.
+	void Open(const char* path);
+#if defined(_WIN32)
+	void Open(const wchar_t* path);
+#endif
+
+	// Same, over bytes owned by the caller, which must outlive the DdsFile.
+	void Open(const uint8_t* data, uint64_t size);
+
+	const Desc& GetDesc() const { return mDesc; }
+	const uint8_t* Data() const { return mData; }
+	uint64_t Size() const { return mSize; }
+
+	// Mips larger than maxSize in any dimension are dropped from the top of the chain
+	// (0 keeps them all), as the other loaders do.  Throws if the file is too short for
+	// the texture its header describes.
+	void ComputeLayout(size_t maxSize, Layout& layout) const;
+
+	// Copies a subresource from the file into memory laid out with the given row and
+	// depth slice pitches, e.g. a D3D12_PLACED_SUBRESOURCE_FOOTPRINT in a mapped upload
+	// buffer.
+	void CopySubresource(const Subresource& subresource, uint8_t* dst, uint64_t dstRowPitch, uint64_t dstSlicePitch) const;
+
+	// Footprints as GetCopyableFootprints lays them out for the same texture: rows
+	// aligned to 256 bytes and subresources to 512.  Returns the upload buffer size.
+	static uint64_t PlanUpload(const Layout& layout, std::vector<Footprint>& footprints);
+
+	// 0 for unknown formats.
+	static uint32_t BitsPerPixel(uint32_t format);
+
+	static bool IsCompressed(uint32_t format);
+
+	// 2 or 3 for planar video formats, 1 otherwise.
+	static uint32_t PlaneCount(uint32_t format);
+
+	// Bytes, row bytes and rows of one surface with all of its planes, as stored in a
+	// DDS file.
+	static void SurfaceInfo(uint64_t width, uint64_t height, uint32_t format,
+		uint64_t* numBytes, uint64_t* rowBytes, uint64_t* numRows);
+
+	// Row bytes, file row pitch and rows of one plane of a surface.
+	static void PlaneInfo(uint64_t width, uint64_t height, uint32_t format, uint32_t plane,
+		uint64_t* rowBytes, uint64_t* rowPitch, uint64_t* numRows);
+
+	// DXGI format of a DDS_PIXELFORMAT from a header without the DX10 extension, 0 if
+	// none matches.
+	static uint32_t LegacyFormat(const void* pixelFormat);
+
+	// Appends a header with the DX10 extension that describes desc.
+	static void WriteHeader(const Desc& desc, std::vector<uint8_t>& out);
+
+private:
+	void Parse();
+
+	MappedFile mFile;
+	const uint8_t* mData = nullptr;
+	uint64_t mSize = 0;
+	uint64_t mDataOffset = 0; // first byte after the headers
+	Desc mDesc;
+};
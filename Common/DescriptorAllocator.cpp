@@ -0,0 +1,176 @@
+//***************************************************************************************
+// DescriptorAllocator.cpp
+//***************************************************************************************
+
+#include "DescriptorAllocator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+DescriptorAllocator::DescriptorAllocator(uint32_t capacity)
+{
+	Reset(capacity);
+}
+
+void DescriptorAllocator::Reset(uint32_t capacity)
+{
+	mCapacity = capacity;
+	mFreeCount = capacity;
+	mPendingCount = 0;
+
+	mFree.clear();
+	if(capacity > 0)
+		mFree.push_back({ 0, capacity });
+
+	mPending.clear();
+	mPendingHead = 0;
+}
+
+uint32_t DescriptorAllocator::Allocate(uint32_t count)
+{
+	if(count == 0)
+		return InvalidIndex;
+
+	for(size_t i = 0; i < mFree.size(); ++i)
+	{
+		Range& range = mFree[i];
+		if(range.Count < count)
+			continue;
+
+		const uint32_t first = range.First;
+		range.First += count;
+		range.Count -= count;
+		if(range.Count == 0)
+			mFree.erase(mFree.begin() + i);
+
+		mFreeCount -= count;
+		return first;
+	}
+
+	return InvalidIndex;
+}
+
+void DescriptorAllocator::Free(uint32_t first, uint32_t count)
+{
+	if(count == 0)
+		return;
+
+	if(first >= mCapacity || count > mCapacity - first)
+		throw std::invalid_argument("DescriptorAllocator: range is outside the heap");
+
+	const uint32_t end = first + count;
+
+	// First free range that starts after this one
+	auto next = std::upper_bound(mFree.begin(), mFree.end(), first,
+		[](uint32_t index, const Range& range) { return index < range.First; });
+
+	const bool hasPrev = next != mFree.begin();
+	const bool hasNext = next != mFree.end();
+
+	if(hasPrev)
+	{
+		const Range& prev = *(next - 1);
+		if(prev.First + prev.Count > first)
+			throw std::invalid_argument("DescriptorAllocator: range is already free");
+	}
+	if(hasNext && end > next->First)
+		throw std::invalid_argument("DescriptorAllocator: range is already free");
+
+	const bool mergePrev = hasPrev && (next - 1)->First + (next - 1)->Count == first;
+	const bool mergeNext = hasNext && next->First == end;
+
+	if(mergePrev && mergeNext)
+	{
+		(next - 1)->Count += count + next->Count;
+		mFree.erase(next);
+	}
+	else if(mergePrev)
+		(next - 1)->Count += count;
+	else if(mergeNext)
+	{
+		next->First = first;
+		next->Count += count;
+	}
+	else
+		mFree.insert(next, { first, count });
+
+	mFreeCount += count;
+}
+
+void DescriptorAllocator::FreeDeferred(uint32_t first, uint32_t count, uint64_t fenceValue)
+{
+	if(count == 0)
+		return;
+
+	if(first >= mCapacity || count > mCapacity - first)
+		throw std::invalid_argument("DescriptorAllocator: range is outside the heap");
+
+	if(mPending.size() > mPendingHead && fenceValue < mPending.back().Fence)
+		throw std::invalid_argument("DescriptorAllocator: fence values must not decrease");
+
+	mPending.push_back({ fenceValue, { first, count } });
+	mPendingCount += count;
+}
+
+uint32_t DescriptorAllocator::Reclaim(uint64_t completedFenceValue)
+{
+	uint32_t freed = 0;
+
+	while(mPendingHead < mPending.size() && mPending[mPendingHead].Fence <= completedFenceValue)
+	{
+		const Range range = mPending[mPendingHead++].Descriptors;
+		mPendingCount -= range.Count;
+		Free(range.First, range.Count);
+		freed += range.Count;
+	}
+
+	// Drop the reclaimed prefix once it outweighs what is still pending
+	if(mPendingHead == mPending.size())
+	{
+		mPending.clear();
+		mPendingHead = 0;
+	}
+	else if(mPendingHead > mPending.size() / 2)
+	{
+		mPending.erase(mPending.begin(), mPending.begin() + mPendingHead);
+		mPendingHead = 0;
+	}
+
+	return freed;
+}
+
+uint32_t DescriptorAllocator::LargestFreeRange() const
+{
+	uint32_t largest = 0;
+	for(const Range& range : mFree)
+		largest = (std::max)(largest, range.Count);
+	return largest;
+}
+
+bool DescriptorAllocator::Validate() const
+{
+	uint64_t freeCount = 0;
+	for(size_t i = 0; i < mFree.size(); ++i)
+	{
+		const Range& range = mFree[i];
+		if(range.Count == 0 || static_cast<uint64_t>(range.First) + range.Count > mCapacity)
+			return false;
+
+		// Sorted, disjoint and not touching: touching ranges should have been merged
+		if(i > 0 && mFree[i - 1].First + mFree[i - 1].Count >= range.First)
+			return false;
+
+		freeCount += range.Count;
+	}
+
+	uint64_t pendingCount = 0;
+	for(size_t i = mPendingHead; i < mPending.size(); ++i)
+	{
+		if(i > mPendingHead && mPending[i].Fence < mPending[i - 1].Fence)
+			return false;
+		pendingCount += mPending[i].Descriptors.Count;
+	}
+
+	return freeCount == mFreeCount && pendingCount == mPendingCount &&
+		freeCount + pendingCount <= mCapacity;
+}
@@ -0,0 +1,83 @@
+//***************************************************************************************
+// DescriptorAllocator.h
+//
+// Free-list allocator of index ranges in a descriptor heap.  One large shader-visible
+// heap holds every CBV/SRV of the frame; ranges are handed out from it here, and the
+// shader addresses a texture by its index in the bindless table instead of through a
+// descriptor table bound per draw.
+//
+// Free ranges are kept sorted by first index and merged with their neighbours on every
+// free, so the heap does not fragment into single slots.  Allocation is first fit, which
+// packs live descriptors towards the start of the heap.
+//
+// A descriptor the GPU may still read cannot be reused at once: FreeDeferred() parks a
+// range until the fence value of the frame that last used it, and Reclaim() returns
+// every range whose fence has completed.  Nothing here touches Direct3D; the owner maps
+// indices to handles, so the allocator runs as-is in tests.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class DescriptorAllocator
+{
+public:
+	static constexpr uint32_t InvalidIndex = 0xFFFFFFFFu;
+
+	struct Range
+	{
+		uint32_t First;
+		uint32_t Count;
+	};
+
+	explicit DescriptorAllocator(uint32_t capacity = 0);
+
+	// Forgets every allocation, including deferred frees, and manages [0, capacity).
+	void Reset(uint32_t capacity);
+
+	// First index of count consecutive free descriptors, or InvalidIndex if no free
+	// range is large enough.
+	uint32_t Allocate(uint32_t count = 1);
+
+	// Returns [first, first + count) to the free list.  Throws std::invalid_argument if
+	// the range is outside the heap or overlaps a free one (double free).
+	void Free(uint32_t first, uint32_t count = 1);
+
+	// Frees the range once Reclaim() sees fenceValue completed.  Fence values must not
+	// decrease between calls.
+	void FreeDeferred(uint32_t first, uint32_t count, uint64_t fenceValue);
+
+	// Frees every deferred range whose fence value is at most completedFenceValue.
+	// Returns the number of descriptors freed.
+	uint32_t Reclaim(uint64_t completedFenceValue);
+
+	uint32_t Capacity() const { return mCapacity; }
+	uint32_t FreeCount() const { return mFreeCount; }
+	uint32_t AllocatedCount() const { return mCapacity - mFreeCount - mPendingCount; }
+	uint32_t PendingCount() const { return mPendingCount; }
+	uint32_t LargestFreeRange() const;
+
+	// Free ranges, sorted and never adjacent.
+	const std::vector<Range>& FreeRanges() const { return mFree; }
+
+	// Checks the invariants above and the free and pending counts; for tests.
+	bool Validate() const;
+
+private:
+	struct Pending
+	{
+		uint64_t Fence;
+		Range Descriptors;
+	};
+
+	uint32_t mCapacity = 0;
+	uint32_t mFreeCount = 0;
+	uint32_t mPendingCount = 0;
+
+	std::vector<Range> mFree;
+	std::vector<Pending> mPending; // in fence order
+	size_t mPendingHead = 0;       // mPending[0, head) already reclaimed
+};
@@ -0,0 +1,150 @@
+//***************************************************************************************
+// FrameStats.cpp
+//***************************************************************************************
+
+#include "FrameStats.h"
+
+#include <cmath>
+
+void FrameStats::Reset()
+{
+	mSamplesMs.fill(0.0f);
+	mStutters.fill(false);
+	mHistogram.fill(0);
+
+	mNext = 0;
+	mCount = 0;
+	mStutterCount = 0;
+	mSumMs = 0.0;
+
+	mLastDelta = 0.0;
+	mSmoothedDelta = 0.0;
+}
+
+uint32_t FrameStats::BucketOf(double ms)
+{
+	if(ms <= 0.0)
+		return 0;
+
+	const double bucket = ms / BucketWidthMs;
+	return bucket >= BucketCount - 1 ? BucketCount - 1 : static_cast<uint32_t>(bucket);
+}
+
+void FrameStats::AddSample(double seconds)
+{
+	if(seconds < 0.0)
+		seconds = 0.0;
+
+	// The window keeps floats; bucket and sum use the stored value, so eviction takes
+	// back exactly what was added
+	const float ms = static_cast<float>(seconds * 1000.0);
+
+	// A frame is a stutter if it is much longer than what we have been seeing lately.
+	const bool stutter = mCount > 0 && mSmoothedDelta > 0.0 && seconds > StutterFactor * mSmoothedDelta;
+
+	// Evict the oldest sample once the window is full.
+	if(mCount == WindowSize)
+	{
+		const float oldMs = mSamplesMs[mNext];
+		--mHistogram[BucketOf(oldMs)];
+		mSumMs -= oldMs;
+
+		if(mStutters[mNext])
+			--mStutterCount;
+	}
+	else
+	{
+		++mCount;
+	}
+
+	mSamplesMs[mNext] = ms;
+	mStutters[mNext] = stutter;
+	++mHistogram[BucketOf(ms)];
+	mSumMs += ms;
+
+	if(stutter)
+		++mStutterCount;
+
+	mNext = (mNext + 1) % WindowSize;
+
+	mLastDelta = seconds;
+
+	const double clamped = seconds > MaxSmoothedDelta ? MaxSmoothedDelta : seconds;
+	if(mSmoothedDelta <= 0.0)
+		mSmoothedDelta = clamped;
+	else
+		mSmoothedDelta += SmoothingFactor * (clamped - mSmoothedDelta);
+}
+
+double FrameStats::Percentile(double fraction)const
+{
+	if(mCount == 0)
+		return 0.0;
+
+	if(fraction < 0.0) fraction = 0.0;
+	if(fraction > 1.0) fraction = 1.0;
+
+	// Rank of the requested sample (1-based), then walk the cumulative histogram.
+	uint32_t rank = static_cast<uint32_t>(fraction * mCount + 0.5);
+	if(rank < 1) rank = 1;
+	if(rank > mCount) rank = mCount;
+
+	uint32_t seen = 0;
+	for(uint32_t b = 0; b < BucketCount; ++b)
+	{
+		seen += mHistogram[b];
+		if(seen >= rank)
+			return (b + 1) * BucketWidthMs;
+	}
+
+	return BucketCount * BucketWidthMs;
+}
+
+FrameStats::Summary FrameStats::Summarize()const
+{
+	Summary s;
+	s.SampleCount = mCount;
+
+	if(mCount == 0)
+		return s;
+
+	s.MinMs = mSamplesMs[0];
+	s.MaxMs = mSamplesMs[0];
+	for(uint32_t i = 1; i < mCount; ++i)
+	{
+		if(mSamplesMs[i] < s.MinMs) s.MinMs = mSamplesMs[i];
+		if(mSamplesMs[i] > s.MaxMs) s.MaxMs = mSamplesMs[i];
+	}
+
+	s.AverageMs = mSumMs / mCount;
+	s.Fps = s.AverageMs > 0.0 ? 1000.0 / s.AverageMs : 0.0;
+	s.P50Ms = Percentile(0.50);
+	s.P95Ms = Percentile(0.95);
+	s.P99Ms = Percentile(0.99);
+	s.StutterCount = mStutterCount;
+
+	return s;
+}
+
+bool FrameStats::Validate()const
+{
+	// 64-bit total: a bucket decremented below zero wraps, and a 32-bit total would
+	// wrap back with it
+	uint64_t histogram = 0;
+	for(uint32_t count : mHistogram)
+	{
+		if(count > mCount)
+			return false;
+		histogram += count;
+	}
+
+	uint32_t stutters = 0;
+	double sum = 0.0;
+	for(uint32_t i = 0; i < mCount; ++i)
+	{
+		stutters += mStutters[i] ? 1 : 0;
+		sum += mSamplesMs[i];
+	}
+
+	return histogram == mCount && stutters == mStutterCount && std::fabs(sum - mSumMs) <= 1e-6 * (1.0 + sum);
+}
@@ -0,0 +1,78 @@
+//***************************************************************************************
+// FrameStats.h
+//
+// Rolling frame-time statistics.  Keeps the last WindowSize frame times in a ring
+// and an incrementally maintained histogram over the same window, so percentile
+// queries never sort.  Also tracks an exponentially smoothed delta that is steadier
+// than the raw delta for driving simulation.
+//***************************************************************************************
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+class FrameStats
+{
+public:
+	static constexpr uint32_t WindowSize = 512;
+
+	// Histogram resolution: 0.1 ms buckets up to 100 ms, the last bucket catches the rest.
+	static constexpr double BucketWidthMs = 0.1;
+	static constexpr uint32_t BucketCount = 1000;
+
+	struct Summary
+	{
+		uint32_t SampleCount = 0;
+		double AverageMs = 0.0;
+		double MinMs = 0.0;
+		double MaxMs = 0.0;
+		double P50Ms = 0.0;
+		double P95Ms = 0.0;
+		double P99Ms = 0.0;
+		double Fps = 0.0;
+
+		// Frames in the window that took longer than StutterFactor * smoothed delta.
+		uint32_t StutterCount = 0;
+	};
+
+	void Reset();
+
+	// Adds one frame time in seconds.
+	void AddSample(double seconds);
+
+	double SmoothedDelta()const { return mSmoothedDelta; }
+	double LastDelta()const { return mLastDelta; }
+
+	// Returns the frame time (ms) below which the given fraction [0,1] of the window lies.
+	double Percentile(double fraction)const;
+
+	Summary Summarize()const;
+
+	// Checks the histogram, sum and stutter count against the window; for tests.
+	bool Validate()const;
+
+	// Weight of the newest sample in the exponential average.
+	float SmoothingFactor = 0.1f;
+
+	// Deltas above this are clamped before smoothing, so a breakpoint or a window
+	// drag does not teleport the simulation.
+	double MaxSmoothedDelta = 0.1;
+
+	float StutterFactor = 2.0f;
+
+private:
+	static uint32_t BucketOf(double ms);
+
+	std::array<float, WindowSize> mSamplesMs{};
+	std::array<bool, WindowSize> mStutters{};
+	std::array<uint32_t, BucketCount> mHistogram{};
+
+	uint32_t mNext = 0;
+	uint32_t mCount = 0;
+	uint32_t mStutterCount = 0;
+	double mSumMs = 0.0;
+
+	double mLastDelta = 0.0;
+	double mSmoothedDelta = 0.0;
+};
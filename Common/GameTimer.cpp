@@ -2,16 +2,14 @@
 // GameTimer.cpp by Frank Luna (C) 2011 All Rights Reserved.
 //***************************************************************************************
 
-#include <windows.h>
 #include "GameTimer.h"
+#include "Clock.h"
 
 GameTimer::GameTimer()
 : mSecondsPerCount(0.0), mDeltaTime(-1.0), mBaseTime(0), 
-  mPausedTime(0), mPrevTime(0), mCurrTime(0), mStopped(false)
+  mPausedTime(0), mStopTime(0), mPrevTime(0), mCurrTime(0), mStopped(false)
 {
-	__int64 countsPerSec;
-	QueryPerformanceFrequency((LARGE_INTEGER*)&countsPerSec);
-	mSecondsPerCount = 1.0 / (double)countsPerSec;
+	mSecondsPerCount = Clock::SecondsPerTick();
 }
 
 // Returns the total time elapsed since Reset() was called, NOT counting any
@@ -53,21 +51,26 @@ float GameTimer::DeltaTime()const
 	return (float)mDeltaTime;
 }
 
+float GameTimer::SmoothedDeltaTime()const
+{
+	return mStopped ? 0.0f : (float)mStats.SmoothedDelta();
+}
+
 void GameTimer::Reset()
 {
-	__int64 currTime;
-	QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
+	int64_t currTime = Clock::Now();
 
 	mBaseTime = currTime;
 	mPrevTime = currTime;
 	mStopTime = 0;
 	mStopped  = false;
+
+	mStats.Reset();
 }
 
 void GameTimer::Start()
 {
-	__int64 startTime;
-	QueryPerformanceCounter((LARGE_INTEGER*)&startTime);
+	int64_t startTime = Clock::Now();
 
 
 	// Accumulate the time elapsed between stop and start pairs.
@@ -90,10 +93,7 @@ void GameTimer::Stop()
 {
 	if( !mStopped )
 	{
-		__int64 currTime;
-		QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
-
-		mStopTime = currTime;
+		mStopTime = Clock::Now();
 		mStopped  = true;
 	}
 }
@@ -106,9 +106,7 @@ void GameTimer::Tick()
 		return;
 	}
 
-	__int64 currTime;
-	QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
-	mCurrTime = currTime;
+	mCurrTime = Clock::Now();
 
 	// Time difference between this frame and the previous.
 	mDeltaTime = (mCurrTime - mPrevTime)*mSecondsPerCount;
@@ -123,5 +121,7 @@ void GameTimer::Tick()
 	{
 		mDeltaTime = 0.0;
 	}
+
+	mStats.AddSample(mDeltaTime);
 }
 
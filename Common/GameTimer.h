@@ -5,6 +5,9 @@
 #ifndef GAMETIMER_H
 #define GAMETIMER_H
 
+#include <cstdint>
+#include "FrameStats.h"
+
 class GameTimer
 {
 public:
@@ -12,6 +15,9 @@ public:
 
 	float TotalTime()const; // in seconds
 	float DeltaTime()const; // in seconds
+	float SmoothedDeltaTime()const; // in seconds, exponentially averaged
+
+	const FrameStats& Stats()const { return mStats; } // rolling window of recent frames
 
 	void Reset(); // Call before message loop.
 	void Start(); // Call when unpaused.
@@ -22,13 +28,15 @@ private:
 	double mSecondsPerCount;
 	double mDeltaTime;
 
-	__int64 mBaseTime;
-	__int64 mPausedTime;
-	__int64 mStopTime;
-	__int64 mPrevTime;
-	__int64 mCurrTime;
+	int64_t mBaseTime;
+	int64_t mPausedTime;
+	int64_t mStopTime;
+	int64_t mPrevTime;
+	int64_t mCurrTime;
 
 	bool mStopped;
+
+	FrameStats mStats;
 };
 
 #endif // GAMETIMER_H
\ No newline at end of file
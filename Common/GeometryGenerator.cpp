@@ -3,10 +3,43 @@
 //***************************************************************************************
 
 #include "GeometryGenerator.h"
+#include "JobSystem.h"
 #include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
 
 using namespace DirectX;
 
+namespace
+{
+	const float IcosahedronX = 0.525731f;
+	const float IcosahedronZ = 0.850651f;
+
+	const XMFLOAT3 IcosahedronPositions[12] =
+	{
+		XMFLOAT3(-IcosahedronX, 0.0f, IcosahedronZ),  XMFLOAT3(IcosahedronX, 0.0f, IcosahedronZ),
+		XMFLOAT3(-IcosahedronX, 0.0f, -IcosahedronZ), XMFLOAT3(IcosahedronX, 0.0f, -IcosahedronZ),
+		XMFLOAT3(0.0f, IcosahedronZ, IcosahedronX),   XMFLOAT3(0.0f, IcosahedronZ, -IcosahedronX),
+		XMFLOAT3(0.0f, -IcosahedronZ, IcosahedronX),  XMFLOAT3(0.0f, -IcosahedronZ, -IcosahedronX),
+		XMFLOAT3(IcosahedronZ, IcosahedronX, 0.0f),   XMFLOAT3(-IcosahedronZ, IcosahedronX, 0.0f),
+		XMFLOAT3(IcosahedronZ, -IcosahedronX, 0.0f),  XMFLOAT3(-IcosahedronZ, -IcosahedronX, 0.0f)
+	};
+
+	const std::uint32_t IcosahedronIndices[60] =
+	{
+		1,4,0,  4,9,0,  4,5,9,  8,5,4,  1,8,4,
+		1,10,8, 10,3,8, 8,3,5,  3,2,5,  3,7,2,
+		3,10,7, 10,6,7, 6,11,7, 6,0,11, 6,1,0,
+		10,1,6, 11,0,9, 2,11,9, 5,2,9,  11,2,7
+	};
+
+	// Vertices per ParallelFor chunk of the span-based generators
+	const std::uint32_t GenerateGrain = 16384;
+}
+
 GeometryGenerator::MeshData GeometryGenerator::CreateBox(float width, float height, float depth, uint32 numSubdivisions)
 {
     MeshData meshData;
@@ -213,12 +246,9 @@ GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32
  
 void GeometryGenerator::Subdivide(MeshData& meshData)
 {
-	// Save a copy of the input geometry.
-	MeshData inputCopy = meshData;
-
-
-	meshData.Vertices.resize(0);
-	meshData.Indices32.resize(0);
+	// Save a copy of the input indices; the input vertices are kept in place.
+	std::vector<uint32> inputIndices;
+	inputIndices.swap(meshData.Indices32);
 
 	//       v1
 	//       *
@@ -230,47 +260,65 @@ void GeometryGenerator::Subdivide(MeshData& meshData)
 	// *-----*-----*
 	// v0    m2     v2
 
-	uint32 numTris = (uint32)inputCopy.Indices32.size()/3;
+	// Each edge is split once and its midpoint shared by both triangles on it, so a
+	// closed mesh goes from V vertices and E edges to V + E (10 * 4^n + 2 for the
+	// geosphere) instead of six vertices per triangle.
+	uint32 numTris = (uint32)inputIndices.size()/3;
+
+	std::unordered_map<std::uint64_t, uint32> midpoints;
+	midpoints.reserve(numTris*3/2 + 1);
+
+	meshData.Vertices.reserve(meshData.Vertices.size() + numTris*3/2 + 1);
+	meshData.Indices32.reserve(inputIndices.size()*4);
+
+	auto midpoint = [&](uint32 a, uint32 b)
+	{
+		const std::uint64_t key = (std::uint64_t(std::min(a, b)) << 32) | std::max(a, b);
+
+		auto inserted = midpoints.emplace(key, (uint32)meshData.Vertices.size());
+		if(inserted.second)
+		{
+			// MidPoint is symmetric, so the winding of the first triangle doesn't matter
+			const Vertex m = MidPoint(meshData.Vertices[a], meshData.Vertices[b]);
+			meshData.Vertices.push_back(m);
+		}
+
+		return inserted.first->second;
+	};
+
 	for(uint32 i = 0; i < numTris; ++i)
 	{
-		Vertex v0 = inputCopy.Vertices[ inputCopy.Indices32[i*3+0] ];
-		Vertex v1 = inputCopy.Vertices[ inputCopy.Indices32[i*3+1] ];
-		Vertex v2 = inputCopy.Vertices[ inputCopy.Indices32[i*3+2] ];
+		uint32 v0 = inputIndices[i*3+0];
+		uint32 v1 = inputIndices[i*3+1];
+		uint32 v2 = inputIndices[i*3+2];
 
 		//
 		// Generate the midpoints.
 		//
 
-        Vertex m0 = MidPoint(v0, v1);
-        Vertex m1 = MidPoint(v1, v2);
-        Vertex m2 = MidPoint(v0, v2);
+		uint32 m0 = midpoint(v0, v1);
+		uint32 m1 = midpoint(v1, v2);
+		uint32 m2 = midpoint(v0, v2);
 
 		//
 		// Add new geometry.
 		//
 
-		meshData.Vertices.push_back(v0); // 0
-		meshData.Vertices.push_back(v1); // 1
-		meshData.Vertices.push_back(v2); // 2
-		meshData.Vertices.push_back(m0); // 3
-		meshData.Vertices.push_back(m1); // 4
-		meshData.Vertices.push_back(m2); // 5
- 
-		meshData.Indices32.push_back(i*6+0);
-		meshData.Indices32.push_back(i*6+3);
-		meshData.Indices32.push_back(i*6+5);
+		meshData.Indices32.push_back(v0);
+		meshData.Indices32.push_back(m0);
+		meshData.Indices32.push_back(m2);
 
-		meshData.Indices32.push_back(i*6+3);
-		meshData.Indices32.push_back(i*6+4);
-		meshData.Indices32.push_back(i*6+5);
+		meshData.Indices32.push_back(m0);
+		meshData.Indices32.push_back(m1);
+		meshData.Indices32.push_back(m2);
 
-		meshData.Indices32.push_back(i*6+5);
-		meshData.Indices32.push_back(i*6+4);
-		meshData.Indices32.push_back(i*6+2);
+		meshData.Indices32.push_back(m2);
+		meshData.Indices32.push_back(m1);
+		meshData.Indices32.push_back(v2);
 
-		meshData.Indices32.push_back(i*6+3);
-		meshData.Indices32.push_back(i*6+1);
-		meshData.Indices32.push_back(i*6+4);
+		meshData.Indices32.push_back(m0);
+		meshData.Indices32.push_back(v1);
+		meshData.Indices32.push_back(m1);
 	}
 }
 
@@ -313,32 +361,11 @@ GeometryGenerator::MeshData GeometryGenerator::CreateGeosphere(float radius, uin
 
 	// Approximate a sphere by tessellating an icosahedron.
 
-	const float X = 0.525731f; 
-	const float Z = 0.850651f;
-
-	XMFLOAT3 pos[12] = 
-	{
-		XMFLOAT3(-X, 0.0f, Z),  XMFLOAT3(X, 0.0f, Z),  
-		XMFLOAT3(-X, 0.0f, -Z), XMFLOAT3(X, 0.0f, -Z),    
-		XMFLOAT3(0.0f, Z, X),   XMFLOAT3(0.0f, Z, -X), 
-		XMFLOAT3(0.0f, -Z, X),  XMFLOAT3(0.0f, -Z, -X),    
-		XMFLOAT3(Z, X, 0.0f),   XMFLOAT3(-Z, X, 0.0f), 
-		XMFLOAT3(Z, -X, 0.0f),  XMFLOAT3(-Z, -X, 0.0f)
-	};
-
-    uint32 k[60] =
-	{
-		1,4,0,  4,9,0,  4,5,9,  8,5,4,  1,8,4,    
-		1,10,8, 10,3,8, 8,3,5,  3,2,5,  3,7,2,    
-		3,10,7, 10,6,7, 6,11,7, 6,0,11, 6,1,0, 
-		10,1,6, 11,0,9, 2,11,9, 5,2,9,  11,2,7 
-	};
-
     meshData.Vertices.resize(12);
-    meshData.Indices32.assign(&k[0], &k[60]);
+    meshData.Indices32.assign(&IcosahedronIndices[0], &IcosahedronIndices[60]);
 
 	for(uint32 i = 0; i < 12; ++i)
-		meshData.Vertices[i].Position = pos[i];
+		meshData.Vertices[i].Position = IcosahedronPositions[i];
 
 	for(uint32 i = 0; i < numSubdivisions; ++i)
 		Subdivide(meshData);
@@ -655,3 +682,497 @@ GeometryGenerator::MeshData GeometryGenerator::CreateQuad(float x, float y, floa
 
     return meshData;
 }
+
+//
+// Span-based generators.
+//
+
+namespace
+{
+	void CheckSpan(const GeometryGenerator::MeshSpan& mesh, const GeometryGenerator::MeshSize& size, const char* what)
+	{
+		const bool hasIndices = (mesh.Indices16 != nullptr) != (mesh.Indices32 != nullptr);
+		if(mesh.VertexCount != size.VertexCount || mesh.IndexCount != size.IndexCount ||
+			(size.VertexCount > 0 && mesh.Vertices == nullptr) || (size.IndexCount > 0 && !hasIndices) ||
+			(mesh.Indices16 != nullptr && !size.Fits16()))
+		{
+			throw std::invalid_argument(std::string("GeometryGenerator: span does not match ") + what);
+		}
+	}
+
+	// Calls fill with the span's index pointer in its own type.
+	template<typename Fill>
+	void WithIndices(const GeometryGenerator::MeshSpan& mesh, Fill&& fill)
+	{
+		if(mesh.Indices16 != nullptr)
+			fill(mesh.Indices16);
+		else
+			fill(mesh.Indices32);
+	}
+
+	// Rows per ParallelFor chunk for rows of rowVertexCount vertices.
+	std::uint32_t RowGrain(std::uint32_t rowVertexCount)
+	{
+		return std::max<std::uint32_t>(1u, GenerateGrain / std::max<std::uint32_t>(rowVertexCount, 1u));
+	}
+
+	GeometryGenerator::MeshSize CheckedSize(std::uint64_t vertexCount, std::uint64_t indexCount)
+	{
+		if(vertexCount > UINT32_MAX || indexCount > UINT32_MAX)
+			throw std::length_error("GeometryGenerator: mesh too large for 32-bit indices");
+
+		GeometryGenerator::MeshSize size;
+		size.VertexCount = static_cast<std::uint32_t>(vertexCount);
+		size.IndexCount = static_cast<std::uint32_t>(indexCount);
+		return size;
+	}
+
+	// Geosphere vertex from a point on the unit sphere; same attributes as CreateGeosphere.
+	void SphereVertex(float nx, float ny, float nz, float radius, GeometryGenerator::Vertex& v)
+	{
+		v.Position = XMFLOAT3(radius*nx, radius*ny, radius*nz);
+		v.Normal = XMFLOAT3(nx, ny, nz);
+
+		float theta = atan2f(nz, nx);
+		if(theta < 0.0f)
+			theta += XM_2PI;
+
+		const float phi = acosf(std::min(std::max(ny, -1.0f), 1.0f));
+
+		v.TexC.x = theta/XM_2PI;
+		v.TexC.y = phi/XM_PI;
+
+		// Normalized dP/dtheta; zero at the poles, like XMVector3Normalize of a zero vector
+		v.TangentU = sinf(phi) > 0.0f ? XMFLOAT3(-sinf(theta), 0.0f, cosf(theta)) : XMFLOAT3(0.0f, 0.0f, 0.0f);
+	}
+
+	// Which of the 30 icosahedron edges each corner pair is, and which face writes each
+	// shared corner and edge vertex (the first face that has it), so every vertex of the
+	// shared-vertex geosphere is generated exactly once.
+	struct IcosahedronTopology
+	{
+		std::int8_t EdgeId[12][12];
+		bool OwnsCorner[20][3];
+		bool OwnsEdge[20][3]; // edges (a, b), (a, c), (b, c)
+	};
+
+	const IcosahedronTopology& GetIcosahedronTopology()
+	{
+		static const IcosahedronTopology topology = []()
+		{
+			IcosahedronTopology t = {};
+			for(auto& row : t.EdgeId)
+				std::fill(std::begin(row), std::end(row), std::int8_t(-1));
+
+			bool cornerSeen[12] = {};
+			std::int8_t edgeCount = 0;
+
+			for(std::uint32_t face = 0; face < 20; ++face)
+			{
+				const std::uint32_t* c = &IcosahedronIndices[face*3];
+				const std::uint32_t pairs[3][2] = { { c[0], c[1] }, { c[0], c[2] }, { c[1], c[2] } };
+
+				for(int k = 0; k < 3; ++k)
+				{
+					t.OwnsCorner[face][k] = !cornerSeen[c[k]];
+					cornerSeen[c[k]] = true;
+
+					std::int8_t& id = t.EdgeId[pairs[k][0]][pairs[k][1]];
+					t.OwnsEdge[face][k] = id < 0;
+					if(id < 0)
+					{
+						id = edgeCount++;
+						t.EdgeId[pairs[k][1]][pairs[k][0]] = id;
+					}
+				}
+			}
+
+			return t;
+		}();
+
+		return topology;
+	}
+}
+
+GeometryGenerator::MeshSpan GeometryGenerator::MeshArena::Allocate(const MeshSize& size)
+{
+	MeshSpan mesh;
+	mesh.VertexCount = size.VertexCount;
+	mesh.IndexCount = size.IndexCount;
+
+	if(size.VertexCount > 0)
+		mesh.Vertices = static_cast<Vertex*>(AllocateBytes(size_t(size.VertexCount) * sizeof(Vertex)));
+
+	if(size.IndexCount > 0)
+	{
+		if(size.Fits16())
+			mesh.Indices16 = static_cast<uint16*>(AllocateBytes(size_t(size.IndexCount) * sizeof(uint16)));
+		else
+			mesh.Indices32 = static_cast<uint32*>(AllocateBytes(size_t(size.IndexCount) * sizeof(uint32)));
+	}
+
+	return mesh;
+}
+
+void GeometryGenerator::MeshArena::Reset()
+{
+	// Merge the blocks, so the same working set fits in one block next time
+	if(mBlocks.size() > 1)
+	{
+		const size_t capacity = Capacity();
+		mBlocks.clear();
+		mBlocks.push_back({ std::unique_ptr<char[]>(new char[capacity]), capacity });
+	}
+
+	mUsed = 0;
+}
+
+size_t GeometryGenerator::MeshArena::Capacity() const
+{
+	size_t capacity = 0;
+	for(const Block& block : mBlocks)
+		capacity += block.Size;
+	return capacity;
+}
+
+void* GeometryGenerator::MeshArena::AllocateBytes(size_t byteSize)
+{
+	const size_t alignment = 16;
+	byteSize = (byteSize + alignment - 1) & ~(alignment - 1);
+
+	if(mBlocks.empty() || mBlocks.back().Size - mUsed < byteSize)
+	{
+		const size_t lastSize = mBlocks.empty() ? 0 : mBlocks.back().Size;
+		const size_t blockSize = std::max({ byteSize, 2 * lastSize, size_t(1) << 16 });
+
+		mBlocks.push_back({ std::unique_ptr<char[]>(new char[blockSize]), blockSize });
+		mUsed = 0;
+	}
+
+	void* result = mBlocks.back().Data.get() + mUsed;
+	mUsed += byteSize;
+	return result;
+}
+
+GeometryGenerator::MeshSize GeometryGenerator::GridSize(uint32 m, uint32 n)
+{
+	if(m < 2 || n < 2)
+		return MeshSize();
+
+	return CheckedSize(std::uint64_t(m)*n, std::uint64_t(m-1)*(n-1)*6);
+}
+
+GeometryGenerator::MeshSize GeometryGenerator::SphereSize(uint32 sliceCount, uint32 stackCount)
+{
+	if(sliceCount < 1 || stackCount < 2)
+		return MeshSize();
+
+	const std::uint64_t ringVertexCount = std::uint64_t(sliceCount) + 1;
+	return CheckedSize(2 + (stackCount-1)*ringVertexCount, std::uint64_t(sliceCount)*6*(stackCount-1));
+}
+
+GeometryGenerator::MeshSize GeometryGenerator::GeosphereSize(uint32 numSubdivisions)
+{
+	// N = 2^numSubdivisions segments per icosahedron edge: 12 corners, N - 1 vertices
+	// inside each of the 30 edges and (N - 1)(N - 2) / 2 inside each of the 20 faces
+	if(numSubdivisions > 15)
+		throw std::length_error("GeometryGenerator: too many geosphere subdivisions");
+
+	const std::uint64_t N = std::uint64_t(1) << numSubdivisions;
+	return CheckedSize(10*N*N + 2, 20*N*N*3);
+}
+
+void GeometryGenerator::CreateGrid(float width, float depth, uint32 m, uint32 n, const MeshSpan& mesh)
+{
+	CheckSpan(mesh, GridSize(m, n), "GridSize");
+	if(mesh.VertexCount == 0)
+		return;
+
+	const float halfWidth = 0.5f*width;
+	const float halfDepth = 0.5f*depth;
+
+	const float dx = width / (n-1);
+	const float dz = depth / (m-1);
+
+	const float du = 1.0f / (n-1);
+	const float dv = 1.0f / (m-1);
+
+	// Row i: vertices of row i and the quads between rows i and i + 1
+	WithIndices(mesh, [&](auto* indices)
+	{
+		using Index = std::remove_pointer_t<decltype(indices)>;
+
+		JobSystem::ParallelFor(m, RowGrain(n), [&](uint32 begin, uint32 end)
+		{
+			for(uint32 i = begin; i < end; ++i)
+			{
+				const float z = halfDepth - i*dz;
+
+				Vertex* row = mesh.Vertices + size_t(i)*n;
+				for(uint32 j = 0; j < n; ++j)
+				{
+					row[j].Position = XMFLOAT3(-halfWidth + j*dx, 0.0f, z);
+					row[j].Normal   = XMFLOAT3(0.0f, 1.0f, 0.0f);
+					row[j].TangentU = XMFLOAT3(1.0f, 0.0f, 0.0f);
+					row[j].TexC     = XMFLOAT2(j*du, i*dv);
+				}
+
+				if(i == m-1)
+					continue;
+
+				Index* k = indices + size_t(i)*(n-1)*6;
+				for(uint32 j = 0; j < n-1; ++j, k += 6)
+				{
+					k[0] = static_cast<Index>(i*n+j);
+					k[1] = static_cast<Index>(i*n+j+1);
+					k[2] = static_cast<Index>((i+1)*n+j);
+
+					k[3] = static_cast<Index>((i+1)*n+j);
+					k[4] = static_cast<Index>(i*n+j+1);
+					k[5] = static_cast<Index>((i+1)*n+j+1);
+				}
+			}
+		});
+	});
+}
+
+GeometryGenerator::MeshSpan GeometryGenerator::CreateGrid(float width, float depth, uint32 m, uint32 n, MeshArena& arena)
+{
+	const MeshSpan mesh = arena.Allocate(GridSize(m, n));
+	CreateGrid(width, depth, m, n, mesh);
+	return mesh;
+}
+
+void GeometryGenerator::CreateSphere(float radius, uint32 sliceCount, uint32 stackCount, const MeshSpan& mesh)
+{
+	CheckSpan(mesh, SphereSize(sliceCount, stackCount), "SphereSize");
+	if(mesh.VertexCount == 0)
+		return;
+
+	// Same layout as CreateSphere: top pole, stackCount - 1 rings of sliceCount + 1
+	// vertices, bottom pole; top cap, inner stacks, bottom cap.
+	const float phiStep   = XM_PI/stackCount;
+	const float thetaStep = 2.0f*XM_PI/sliceCount;
+
+	const uint32 ringVertexCount = sliceCount + 1;
+	const uint32 southPoleIndex = mesh.VertexCount - 1;
+
+	mesh.Vertices[0] = Vertex(0.0f, +radius, 0.0f, 0.0f, +1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+	mesh.Vertices[southPoleIndex] = Vertex(0.0f, -radius, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+
+	WithIndices(mesh, [&](auto* indices)
+	{
+		using Index = std::remove_pointer_t<decltype(indices)>;
+
+		// Ring r (1-based) and the stack of quads above it; ring 1 gets the top cap
+		// instead, and the last ring also writes the bottom cap.
+		JobSystem::ParallelFor(stackCount-1, RowGrain(ringVertexCount), [&](uint32 begin, uint32 end)
+		{
+			for(uint32 r = begin; r < end; ++r)
+			{
+				const uint32 i = r + 1;
+				const float phi = i*phiStep;
+				const float sinPhi = sinf(phi);
+				const float cosPhi = cosf(phi);
+
+				Vertex* ring = mesh.Vertices + 1 + size_t(r)*ringVertexCount;
+				for(uint32 j = 0; j <= sliceCount; ++j)
+				{
+					const float theta = j*thetaStep;
+					const float sinTheta = sinf(theta);
+					const float cosTheta = cosf(theta);
+
+					Vertex& v = ring[j];
+					v.Position = XMFLOAT3(radius*sinPhi*cosTheta, radius*cosPhi, radius*sinPhi*sinTheta);
+					v.Normal   = XMFLOAT3(sinPhi*cosTheta, cosPhi, sinPhi*sinTheta);
+					v.TangentU = XMFLOAT3(-sinTheta, 0.0f, cosTheta);
+					v.TexC     = XMFLOAT2(theta / XM_2PI, phi / XM_PI);
+				}
+
+				if(r == 0)
+				{
+					Index* k = indices;
+					for(uint32 j = 1; j <= sliceCount; ++j, k += 3)
+					{
+						k[0] = 0;
+						k[1] = static_cast<Index>(j+1);
+						k[2] = static_cast<Index>(j);
+					}
+				}
+				else
+				{
+					// Stack between rings r - 1 and r (0-based), after the top cap
+					const uint32 baseIndex = 1;
+					const uint32 s = r - 1;
+
+					Index* k = indices + size_t(sliceCount)*3 + size_t(s)*sliceCount*6;
+					for(uint32 j = 0; j < sliceCount; ++j, k += 6)
+					{
+						k[0] = static_cast<Index>(baseIndex + s*ringVertexCount + j);
+						k[1] = static_cast<Index>(baseIndex + s*ringVertexCount + j+1);
+						k[2] = static_cast<Index>(baseIndex + (s+1)*ringVertexCount + j);
+
+						k[3] = static_cast<Index>(baseIndex + (s+1)*ringVertexCount + j);
+						k[4] = static_cast<Index>(baseIndex + s*ringVertexCount + j+1);
+						k[5] = static_cast<Index>(baseIndex + (s+1)*ringVertexCount + j+1);
+					}
+				}
+
+				if(r == stackCount-2)
+				{
+					const uint32 baseIndex = southPoleIndex - ringVertexCount;
+
+					Index* k = indices + mesh.IndexCount - size_t(sliceCount)*3;
+					for(uint32 j = 0; j < sliceCount; ++j, k += 3)
+					{
+						k[0] = static_cast<Index>(southPoleIndex);
+						k[1] = static_cast<Index>(baseIndex+j);
+						k[2] = static_cast<Index>(baseIndex+j+1);
+					}
+				}
+			}
+		});
+	});
+}
+
+GeometryGenerator::MeshSpan GeometryGenerator::CreateSphere(float radius, uint32 sliceCount, uint32 stackCount, MeshArena& arena)
+{
+	const MeshSpan mesh = arena.Allocate(SphereSize(sliceCount, stackCount));
+	CreateSphere(radius, sliceCount, stackCount, mesh);
+	return mesh;
+}
+
+void GeometryGenerator::CreateGeosphere(float radius, uint32 numSubdivisions, const MeshSpan& mesh)
+{
+	CheckSpan(mesh, GeosphereSize(numSubdivisions), "GeosphereSize");
+
+	// Repeated midpoint subdivision of a face followed by projection onto the sphere is
+	// the lattice a + (b - a) * i / N + (c - a) * j / N, i + j <= N, projected.  Lattice
+	// points are numbered globally, so neighbouring faces share their edge vertices:
+	//   [0, 12)                corners
+	//   12 + e * (N - 1) + s   step s + 1 along edge e, from its lower corner index
+	//   interiorBase + ...     rows i = 1 .. N - 2 inside each face, N - 1 - i long
+	const IcosahedronTopology& topology = GetIcosahedronTopology();
+
+	const uint32 N = 1u << numSubdivisions;
+	const uint32 interiorBase = 12 + 30*(N-1);
+	const uint32 faceInteriorCount = (N-1)*(N-2)/2;
+	const uint32 faceIndexCount = N*N*3;
+
+	auto edgeVertex = [&](uint32 from, uint32 to, uint32 step)
+	{
+		if(step == 0)
+			return from;
+		if(step == N)
+			return to;
+
+		const uint32 edge = static_cast<uint32>(topology.EdgeId[from][to]);
+		return 12 + edge*(N-1) + (from < to ? step : N - step) - 1;
+	};
+
+	auto latticeVertex = [&](uint32 face, uint32 i, uint32 j)
+	{
+		const std::uint32_t* c = &IcosahedronIndices[face*3];
+
+		if(j == 0)
+			return edgeVertex(c[0], c[1], i);
+		if(i == 0)
+			return edgeVertex(c[0], c[2], j);
+		if(i + j == N)
+			return edgeVertex(c[1], c[2], j);
+
+		const uint32 rowStart = (i-1)*(N-1) - (i-1)*i/2;
+		return interiorBase + face*faceInteriorCount + rowStart + j - 1;
+	};
+
+	// Whether this face generates lattice vertex (i, j), i.e. owns the corner or edge it is on
+	auto writesVertex = [&](uint32 face, uint32 i, uint32 j)
+	{
+		const bool* corner = topology.OwnsCorner[face];
+		const bool* edge = topology.OwnsEdge[face];
+
+		if(i == 0 && j == 0)
+			return corner[0];
+		if(i == N)
+			return corner[1];
+		if(j == N)
+			return corner[2];
+		if(j == 0)
+			return edge[0];
+		if(i == 0)
+			return edge[1];
+		if(i + j == N)
+			return edge[2];
+		return true;
+	};
+
+	// Triangles above row i: N - i upright, N - i - 1 upside down
+	auto rowTriangleStart = [N](uint32 i) { return 2*N*i - i*i; };
+
+	WithIndices(mesh, [&](auto* indices)
+	{
+		using Index = std::remove_pointer_t<decltype(indices)>;
+
+		JobSystem::ParallelFor(20*(N+1), RowGrain(N+1), [&](uint32 begin, uint32 end)
+		{
+			for(uint32 row = begin; row < end; ++row)
+			{
+				const uint32 face = row / (N+1);
+				const uint32 i = row % (N+1);
+
+				const XMFLOAT3& a = IcosahedronPositions[IcosahedronIndices[face*3+0]];
+				const XMFLOAT3& b = IcosahedronPositions[IcosahedronIndices[face*3+1]];
+				const XMFLOAT3& c = IcosahedronPositions[IcosahedronIndices[face*3+2]];
+
+				const float u = static_cast<float>(i) / N;
+
+				for(uint32 j = 0; j <= N - i; ++j)
+				{
+					if(!writesVertex(face, i, j))
+						continue;
+
+					const float w = static_cast<float>(j) / N;
+
+					const float px = a.x + (b.x - a.x)*u + (c.x - a.x)*w;
+					const float py = a.y + (b.y - a.y)*u + (c.y - a.y)*w;
+					const float pz = a.z + (b.z - a.z)*u + (c.z - a.z)*w;
+					const float invLength = 1.0f / sqrtf(px*px + py*py + pz*pz);
+
+					SphereVertex(px*invLength, py*invLength, pz*invLength, radius, mesh.Vertices[latticeVertex(face, i, j)]);
+				}
+
+				if(i == N)
+					continue;
+
+				// Same orientation as (a, b, c): i runs towards b, j towards c
+				Index* k = indices + size_t(face)*faceIndexCount + size_t(rowTriangleStart(i))*3;
+				for(uint32 j = 0; j < N - i; ++j)
+				{
+					const uint32 v00 = latticeVertex(face, i, j);
+					const uint32 v10 = latticeVertex(face, i+1, j);
+					const uint32 v01 = latticeVertex(face, i, j+1);
+
+					k[0] = static_cast<Index>(v00);
+					k[1] = static_cast<Index>(v10);
+					k[2] = static_cast<Index>(v01);
+					k += 3;
+
+					if(j + 1 < N - i)
+					{
+						k[0] = static_cast<Index>(v10);
+						k[1] = static_cast<Index>(latticeVertex(face, i+1, j+1));
+						k[2] = static_cast<Index>(v01);
+						k += 3;
+					}
+				}
+			}
+		});
+	});
+}
+
+GeometryGenerator::MeshSpan GeometryGenerator::CreateGeosphere(float radius, uint32 numSubdivisions, MeshArena& arena)
+{
+	const MeshSpan mesh = arena.Allocate(GeosphereSize(numSubdivisions));
+	CreateGeosphere(radius, numSubdivisions, mesh);
+	return mesh;
+}
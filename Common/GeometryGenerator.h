@@ -14,8 +14,10 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <DirectXMath.h>
+#include <memory>
 #include <vector>
 
 class GeometryGenerator
@@ -74,6 +76,79 @@ public:
 		std::vector<uint16> mIndices16;
 	};
 
+	///<summary>
+	/// Exact output size of the span-based generators, known before generating.
+	///</summary>
+	struct MeshSize
+	{
+		uint32 VertexCount = 0;
+		uint32 IndexCount = 0;
+
+		bool Fits16() const { return VertexCount <= 0x10000; }
+	};
+
+	///<summary>
+	/// Non-owning view of generated geometry.  Exactly one of Indices16 and
+	/// Indices32 is set; generators write whichever one it is.
+	///</summary>
+	struct MeshSpan
+	{
+		Vertex* Vertices = nullptr;
+		uint32 VertexCount = 0;
+
+		uint16* Indices16 = nullptr;
+		uint32* Indices32 = nullptr;
+		uint32 IndexCount = 0;
+	};
+
+	///<summary>
+	/// Bump allocator for MeshSpans.  Memory grows to the largest working set and is
+	/// kept across Reset, so regenerating meshes of the same size allocates nothing.
+	///</summary>
+	class MeshArena
+	{
+	public:
+		// Indices are 16-bit whenever the vertex count allows it.
+		MeshSpan Allocate(const MeshSize& size);
+
+		// Invalidates every span handed out so far.
+		void Reset();
+
+		size_t Capacity() const;
+
+	private:
+		void* AllocateBytes(size_t byteSize);
+
+		struct Block
+		{
+			std::unique_ptr<char[]> Data;
+			size_t Size = 0;
+		};
+		std::vector<Block> mBlocks;
+		size_t mUsed = 0; // in the last block
+	};
+
+	static MeshSize GridSize(uint32 m, uint32 n);
+	static MeshSize SphereSize(uint32 sliceCount, uint32 stackCount);
+	static MeshSize GeosphereSize(uint32 numSubdivisions);
+
+	///<summary>
+	/// Span-based versions of CreateGrid/CreateSphere/CreateGeosphere.  The span must
+	/// match the corresponding *Size exactly.  Rows (and geosphere faces) are filled with
+	/// JobSystem::ParallelFor, and indices go straight into the span's index format.
+	///
+	/// Grid and sphere output is identical to the MeshData versions.  The geosphere is
+	/// the same surface with every vertex shared (10 * 4^n + 2 of them), numbered
+	/// analytically instead of through Subdivide, and any subdivision level is allowed.
+	///</summary>
+	void CreateGrid(float width, float depth, uint32 m, uint32 n, const MeshSpan& mesh);
+	void CreateSphere(float radius, uint32 sliceCount, uint32 stackCount, const MeshSpan& mesh);
+	void CreateGeosphere(float radius, uint32 numSubdivisions, const MeshSpan& mesh);
+
+	MeshSpan CreateGrid(float width, float depth, uint32 m, uint32 n, MeshArena& arena);
+	MeshSpan CreateSphere(float radius, uint32 sliceCount, uint32 stackCount, MeshArena& arena);
+	MeshSpan CreateGeosphere(float radius, uint32 numSubdivisions, MeshArena& arena);
+
 	///<summary>
 	/// Creates a box centered at the origin with the given dimensions, where each
     /// face has m rows and n columns of vertices.
@@ -0,0 +1,192 @@
+//***************************************************************************************
+// JobSystem.cpp
+//***************************************************************************************
+
+#include "JobSystem.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	class Pool
+	{
+	public:
+		Pool()
+		{
+			const uint32_t hardware = std::max(1u, std::thread::hardware_concurrency());
+			const uint32_t workers = std::max(1u, hardware - 1);
+
+			mThreads.reserve(workers);
+			for(uint32_t i = 0; i < workers; ++i)
+				mThreads.emplace_back([this]() { WorkerLoop(); });
+		}
+
+		~Pool()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				mStopping = true;
+			}
+			mWake.notify_all();
+
+			for(auto& thread : mThreads)
+				thread.join();
+		}
+
+		uint32_t WorkerCount() const { return static_cast<uint32_t>(mThreads.size()); }
+
+		void Push(std::function<void()> job, uint32_t copies)
+		{
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				for(uint32_t i = 0; i < copies; ++i)
+					mJobs.push_back(job);
+			}
+
+			if(copies == 1)
+				mWake.notify_one();
+			else
+				mWake.notify_all();
+		}
+
+	private:
+		void WorkerLoop()
+		{
+			PROFILE_THREAD_NAME("Job Worker");
+
+			for(;;)
+			{
+				std::function<void()> job;
+				{
+					std::unique_lock<std::mutex> lock(mMutex);
+					mWake.wait(lock, [this]() { return mStopping || !mJobs.empty(); });
+
+					if(mJobs.empty())
+						return;
+
+					job = std::move(mJobs.front());
+					mJobs.pop_front();
+				}
+
+				job();
+			}
+		}
+
+		std::vector<std::thread> mThreads;
+
+		std::mutex mMutex;
+		std::condition_variable mWake;
+		std::deque<std::function<void()>> mJobs;
+		bool mStopping = false;
+	};
+
+	Pool& GetPool()
+	{
+		static Pool pool;
+		return pool;
+	}
+
+	// Shared by the caller and the helper jobs.  Helpers that start after the range is
+	// exhausted still touch it, so it lives in a shared_ptr rather than on the stack.
+	struct ParallelForState
+	{
+		const std::function<void(uint32_t, uint32_t)>* Func = nullptr;
+		uint32_t Count = 0;
+		uint32_t Grain = 1;
+		uint32_t ChunkCount = 0;
+
+		std::atomic<uint32_t> NextChunk{ 0 };
+		std::atomic<uint32_t> DoneChunks{ 0 };
+
+		std::mutex Mutex;
+		std::condition_variable Done;
+		std::exception_ptr Error;
+
+		// Returns after the range is exhausted.  Func is only dereferenced for claimed
+		// chunks, i.e. while the caller is still waiting in ParallelFor.
+		void Drain()
+		{
+			for(;;)
+			{
+				const uint32_t chunk = NextChunk.fetch_add(1, std::memory_order_relaxed);
+				if(chunk >= ChunkCount)
+					return;
+
+				const uint32_t begin = chunk * Grain;
+				const uint32_t end = std::min(Count, begin + Grain);
+
+				try
+				{
+					(*Func)(begin, end);
+				}
+				catch(...)
+				{
+					std::lock_guard<std::mutex> lock(Mutex);
+					if(!Error)
+						Error = std::current_exception();
+				}
+
+				if(DoneChunks.fetch_add(1, std::memory_order_acq_rel) + 1 == ChunkCount)
+				{
+					std::lock_guard<std::mutex> lock(Mutex);
+					Done.notify_all();
+				}
+			}
+		}
+	};
+}
+
+uint32_t JobSystem::WorkerCount()
+{
+	return GetPool().WorkerCount();
+}
+
+void JobSystem::Submit(std::function<void()> job)
+{
+	GetPool().Push(std::move(job), 1);
+}
+
+void JobSystem::ParallelFor(uint32_t count, uint32_t grainSize, const std::function<void(uint32_t, uint32_t)>& func)
+{
+	if(count == 0)
+		return;
+
+	const uint32_t grain = std::max(1u, grainSize);
+	const uint32_t chunkCount = (count + grain - 1) / grain;
+
+	// Not worth waking anyone for a single chunk.
+	if(chunkCount == 1)
+	{
+		func(0, count);
+		return;
+	}
+
+	auto state = std::make_shared<ParallelForState>();
+	state->Func = &func;
+	state->Count = count;
+	state->Grain = grain;
+	state->ChunkCount = chunkCount;
+
+	Pool& pool = GetPool();
+	const uint32_t helpers = std::min(pool.WorkerCount(), chunkCount - 1);
+	pool.Push([state]() { state->Drain(); }, helpers);
+
+	state->Drain();
+
+	{
+		std::unique_lock<std::mutex> lock(state->Mutex);
+		state->Done.wait(lock, [&]() { return state->DoneChunks.load(std::memory_order_acquire) == chunkCount; });
+	}
+
+	if(state->Error)
+		std::rethrow_exception(state->Error);
+}
@@ -0,0 +1,29 @@
+//***************************************************************************************
+// JobSystem.h
+//
+// Fixed pool of worker threads for CPU-side data-parallel work.  ParallelFor splits
+// an index range into chunks that the workers and the calling thread pull from a
+// shared atomic counter, so uneven chunks balance out on their own and a ParallelFor
+// issued from inside a job cannot deadlock: the caller always makes progress itself.
+//
+// The pool is created on first use with hardware_concurrency - 1 workers.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+namespace JobSystem
+{
+	// Number of worker threads, not counting the threads that call ParallelFor.
+	uint32_t WorkerCount();
+
+	// Runs job on a worker thread.  Fire-and-forget: completion must be signalled by the job.
+	void Submit(std::function<void()> job);
+
+	// Calls func(begin, end) for consecutive chunks of [0, count), each at most grainSize
+	// long, and returns once every chunk has finished.  The first exception thrown by
+	// func is rethrown on the calling thread.
+	void ParallelFor(uint32_t count, uint32_t grainSize, const std::function<void(uint32_t, uint32_t)>& func);
+}
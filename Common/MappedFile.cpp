@@ -0,0 +1,174 @@
+//***************************************************************************************
+// MappedFile.cpp
+//***************************************************************************************
+
+#include "MappedFile.h"
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+	*this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if(this != &other)
+	{
+		Close();
+
+		std::swap(mData, other.mData);
+		std::swap(mSize, other.mSize);
+		std::swap(mOpen, other.mOpen);
+		std::swap(mFile, other.mFile);
+#if defined(_WIN32)
+		std::swap(mMapping, other.mMapping);
+#endif
+	}
+
+	return *this;
+}
+
+void MappedFile::Open(const char* path)
+{
+	Close();
+
+#if defined(_WIN32)
+	Map(CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL, nullptr), path);
+#else
+	auto fail = [path](const char* what)
+	{
+		throw std::runtime_error(std::string("MappedFile: ") + what + " '" + path + "'");
+	};
+
+	const int file = open(path, O_RDONLY);
+	if(file < 0)
+		fail("cannot open");
+
+	struct stat st;
+	if(fstat(file, &st) != 0)
+	{
+		close(file);
+		fail("cannot query the size of");
+	}
+
+	mFile = file;
+	mSize = static_cast<uint64_t>(st.st_size);
+	mOpen = true;
+
+	if(mSize == 0)
+		return;
+
+	void* data = mmap(nullptr, static_cast<size_t>(mSize), PROT_READ, MAP_SHARED, file, 0);
+	if(data == MAP_FAILED)
+	{
+		Close();
+		fail("cannot map");
+	}
+
+	mData = static_cast<const uint8_t*>(data);
+#endif
+}
+
+#if defined(_WIN32)
+void MappedFile::Open(const wchar_t* path)
+{
+	Close();
+
+	char name[MAX_PATH];
+	if(WideCharToMultiByte(CP_ACP, 0, path, -1, name, MAX_PATH, nullptr, nullptr) == 0)
+		name[0] = '\0';
+
+	Map(CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL, nullptr), name);
+}
+
+void MappedFile::Map(void* handle, const char* path)
+{
+	auto fail = [path](const char* what)
+	{
+		throw std::runtime_error(std::string("MappedFile: ") + what + " '" + path + "'");
+	};
+
+	HANDLE file = static_cast<HANDLE>(handle);
+	if(file == INVALID_HANDLE_VALUE)
+		fail("cannot open");
+
+	LARGE_INTEGER size;
+	if(!GetFileSizeEx(file, &size))
+	{
+		CloseHandle(file);
+		fail("cannot query the size of");
+	}
+
+	mFile = file;
+	mSize = static_cast<uint64_t>(size.QuadPart);
+	mOpen = true;
+
+	if(mSize == 0)
+		return;
+
+	if(sizeof(void*) < 8 && mSize > 0xFFFFFFFFull)
+	{
+		Close();
+		fail("file too large to map in a 32-bit process:");
+	}
+
+	mMapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if(mMapping == nullptr)
+	{
+		Close();
+		fail("cannot map");
+	}
+
+	mData = static_cast<const uint8_t*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+	if(mData == nullptr)
+	{
+		Close();
+		fail("cannot map a view of");
+	}
+}
+#endif
+
+void MappedFile::Close()
+{
+#if defined(_WIN32)
+	if(mData != nullptr)
+		UnmapViewOfFile(mData);
+	if(mMapping != nullptr)
+		CloseHandle(mMapping);
+	if(mFile != nullptr)
+		CloseHandle(mFile);
+
+	mMapping = nullptr;
+	mFile = nullptr;
+#else
+	if(mData != nullptr)
+		munmap(const_cast<uint8_t*>(mData), static_cast<size_t>(mSize));
+	if(mFile >= 0)
+		close(mFile);
+
+	mFile = -1;
+#endif
+
+	mData = nullptr;
+	mSize = 0;
+	mOpen = false;
+}
@@ -0,0 +1,54 @@
+//***************************************************************************************
+// MappedFile.h
+//
+// Read-only memory mapping of a whole file.  Pages are brought in by the OS on first
+// touch, so opening even a multi-gigabyte file is cheap and only the parts that are
+// read cost I/O.  Uses CreateFileMapping on Windows and mmap elsewhere; 64-bit
+// builds can map files larger than 4 GB.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	// Throws std::runtime_error if the file cannot be opened or mapped.  An empty file
+	// opens successfully with Data() == nullptr.
+	void Open(const char* path);
+#if defined(_WIN32)
+	void Open(const wchar_t* path);
+#endif
+	void Close();
+
+	bool IsOpen() const { return mOpen; }
+
+	const uint8_t* Data() const { return mData; }
+	uint64_t Size() const { return mSize; }
+
+private:
+	const uint8_t* mData = nullptr;
+	uint64_t mSize = 0;
+	bool mOpen = false;
+
+#if defined(_WIN32)
+	// Takes ownership of a file HANDLE from CreateFile and maps it; path is for messages.
+	void Map(void* handle, const char* path);
+
+	void* mFile = nullptr;    // HANDLE
+	void* mMapping = nullptr; // HANDLE
+#else
+	int mFile = -1;
+#endif
+};
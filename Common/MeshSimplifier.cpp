@@ -0,0 +1,845 @@
+//***************************************************************************************
+// MeshSimplifier.cpp
+//***************************************************************************************
+
+#include "MeshSimplifier.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	constexpr uint32_t Empty = 0xFFFFFFFFu;
+
+	// Triangles per ParallelFor chunk when collecting collapse candidates.
+	constexpr uint32_t CollectGrain = 16384;
+
+	// Constraint planes along open borders weigh this much more than surface planes.
+	constexpr float BorderWeight = 10.0f;
+
+	// A collapse may turn a remaining triangle by at most ~75 degrees.
+	constexpr float MinNormalCos = 0.25f;
+
+	enum class Kind : uint8_t
+	{
+		Manifold, // one wedge, surrounded by triangles
+		Border,   // one wedge on an open boundary
+		Seam,     // two wedges along an attribute seam
+		Locked    // anything else; never moves
+	};
+
+	uint32_t HashBytes(const void* data, size_t size)
+	{
+		// FNV-1a
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		uint32_t h = 2166136261u;
+		for(size_t i = 0; i < size; ++i)
+			h = (h ^ bytes[i]) * 16777619u;
+		return h;
+	}
+
+	// Open-addressing table that maps each element to the first equal one.
+	template<typename Hash, typename Equal>
+	uint32_t BuildRemap(uint32_t count, Hash hash, Equal equal, std::vector<uint32_t>& remap)
+	{
+		size_t tableSize = 1;
+		while(tableSize < size_t(count) * 2)
+			tableSize *= 2;
+
+		std::vector<uint32_t> table(tableSize, Empty);
+		remap.resize(count);
+
+		uint32_t unique = 0;
+		for(uint32_t i = 0; i < count; ++i)
+		{
+			size_t slot = hash(i) & (tableSize - 1);
+			while(table[slot] != Empty && !equal(table[slot], i))
+				slot = (slot + 1) & (tableSize - 1);
+
+			if(table[slot] == Empty)
+			{
+				table[slot] = i;
+				++unique;
+			}
+			remap[i] = table[slot];
+		}
+
+		return unique;
+	}
+
+	struct Quadric
+	{
+		// Symmetric 3x3 part, linear part and constant of w * (n.p + d)^2.
+		float a00 = 0, a11 = 0, a22 = 0, a01 = 0, a02 = 0, a12 = 0;
+		float b0 = 0, b1 = 0, b2 = 0;
+		float c = 0;
+		float w = 0;
+
+		void AddPlane(const float n[3], float d, float weight)
+		{
+			a00 += weight * n[0] * n[0];
+			a11 += weight * n[1] * n[1];
+			a22 += weight * n[2] * n[2];
+			a01 += weight * n[0] * n[1];
+			a02 += weight * n[0] * n[2];
+			a12 += weight * n[1] * n[2];
+			b0 += weight * n[0] * d;
+			b1 += weight * n[1] * d;
+			b2 += weight * n[2] * d;
+			c += weight * d * d;
+			w += weight;
+		}
+
+		void Add(const Quadric& q)
+		{
+			a00 += q.a00; a11 += q.a11; a22 += q.a22;
+			a01 += q.a01; a02 += q.a02; a12 += q.a12;
+			b0 += q.b0; b1 += q.b1; b2 += q.b2;
+			c += q.c;
+			w += q.w;
+		}
+
+		// Weighted mean squared distance of p to the accumulated planes.
+		float Error(const float p[3]) const
+		{
+			const float x = p[0], y = p[1], z = p[2];
+			const float e =
+				a00 * x * x + a11 * y * y + a22 * z * z +
+				2.0f * (a01 * x * y + a02 * x * z + a12 * y * z) +
+				2.0f * (b0 * x + b1 * y + b2 * z) + c;
+			return w > 0.0f ? std::fabs(e) / w : 0.0f;
+		}
+	};
+
+	struct Collapse
+	{
+		uint32_t From; // wedge that disappears
+		uint32_t To;   // wedge of the target vertex on the same edge
+		float Cost;    // squared, normalized
+	};
+
+	// Costs are non-negative floats, so their bit patterns sort like the values.
+	// Three 11-bit LSD radix passes beat std::sort on the millions of candidates of
+	// the first passes over a large mesh.
+	void SortByCost(std::vector<Collapse>& collapses, std::vector<Collapse>& scratch)
+	{
+		scratch.resize(collapses.size());
+
+		for(int shift = 0; shift < 33; shift += 11)
+		{
+			uint32_t histogram[2048] = {};
+			for(const Collapse& c : collapses)
+			{
+				uint32_t key;
+				std::memcpy(&key, &c.Cost, sizeof(key));
+				++histogram[(key >> shift) & 2047];
+			}
+
+			uint32_t sum = 0;
+			for(uint32_t& h : histogram)
+			{
+				const uint32_t count = h;
+				h = sum;
+				sum += count;
+			}
+
+			for(const Collapse& c : collapses)
+			{
+				uint32_t key;
+				std::memcpy(&key, &c.Cost, sizeof(key));
+				scratch[histogram[(key >> shift) & 2047]++] = c;
+			}
+
+			collapses.swap(scratch);
+		}
+	}
+
+	class Simplifier
+	{
+	public:
+		Simplifier(const MeshSimplifier::VertexData& vertices, const MeshSimplifier::Options& options)
+			: mVertices(vertices), mOptions(options)
+		{
+		}
+
+		float Run(const uint32_t* indices, size_t indexCount, std::vector<uint32_t>& result);
+
+	private:
+		const float* PositionOf(uint32_t v) const
+		{
+			return reinterpret_cast<const float*>(
+				static_cast<const char*>(mVertices.Vertices) + v * mVertices.Stride + mVertices.PositionOffset);
+		}
+
+		const float* AttributesOf(uint32_t v) const
+		{
+			return reinterpret_cast<const float*>(
+				static_cast<const char*>(mVertices.Vertices) + v * mVertices.Stride + mVertices.AttributeOffset);
+		}
+
+		const float* Pos(uint32_t v) const { return &mPositions[size_t(v) * 3]; }
+
+		void BuildPositions();
+		void BuildAdjacency();
+		bool HasPositionOpposite(uint32_t a, uint32_t b) const;
+		bool HasIndexOpposite(uint32_t a, uint32_t b) const;
+		void Classify();
+		void BuildQuadrics();
+		float AttributeCost(uint32_t a, uint32_t b) const;
+		void CollectCollapses();
+		uint32_t OtherWedge(uint32_t wedge) const;
+		bool FindWedgeTarget(uint32_t wedge, uint32_t target, uint32_t& to) const;
+		bool IsValidCollapse(uint32_t from, uint32_t to, uint32_t& removed);
+
+		const MeshSimplifier::VertexData& mVertices;
+		const MeshSimplifier::Options& mOptions;
+
+		std::vector<uint32_t> mIndices;
+
+		// Positions normalized to the unit cube, so errors compare across meshes
+		std::vector<float> mPositions;
+		float mScale = 1.0f;
+
+		std::vector<uint32_t> mCanonical; // vertex -> first vertex with the same position
+		std::vector<uint32_t> mWedgeNext; // ring of vertices sharing a position
+
+		// vertex -> triangles that use it (CSR over mIndices / 3)
+		std::vector<uint32_t> mTriOffsets;
+		std::vector<uint32_t> mTriangles;
+
+		std::vector<Kind> mKind;          // per canonical vertex
+		std::vector<Quadric> mQuadrics;   // per canonical vertex
+
+		std::vector<Collapse> mCollapses;
+		std::vector<std::vector<Collapse>> mChunkCollapses;
+		std::vector<Collapse> mSortScratch;
+		std::vector<uint32_t> mRemap;
+		std::vector<uint8_t> mLocked;
+
+		// Link condition scratch: per canonical vertex, last stamp that marked it
+		std::vector<uint32_t> mMark;
+		uint32_t mStamp = 0;
+	};
+
+	void Simplifier::BuildPositions()
+	{
+		const uint32_t n = mVertices.VertexCount;
+
+		float minP[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+		float maxP[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		for(uint32_t v = 0; v < n; ++v)
+		{
+			const float* p = PositionOf(v);
+			for(int c = 0; c < 3; ++c)
+			{
+				minP[c] = std::min(minP[c], p[c]);
+				maxP[c] = std::max(maxP[c], p[c]);
+			}
+		}
+
+		mScale = std::max(std::max(maxP[0] - minP[0], maxP[1] - minP[1]), maxP[2] - minP[2]);
+		if(mScale <= 0.0f)
+			mScale = 1.0f;
+
+		const float inv = 1.0f / mScale;
+		mPositions.resize(size_t(n) * 3);
+		for(uint32_t v = 0; v < n; ++v)
+		{
+			const float* p = PositionOf(v);
+			for(int c = 0; c < 3; ++c)
+				mPositions[size_t(v) * 3 + c] = (p[c] - minP[c]) * inv;
+		}
+
+		// Wedges: exact position matches on the source data
+		BuildRemap(n,
+			[this](uint32_t v) { return HashBytes(PositionOf(v), 3 * sizeof(float)); },
+			[this](uint32_t a, uint32_t b) { return std::memcmp(PositionOf(a), PositionOf(b), 3 * sizeof(float)) == 0; },
+			mCanonical);
+
+		mWedgeNext.resize(n);
+		for(uint32_t v = 0; v < n; ++v)
+			mWedgeNext[v] = v;
+
+		for(uint32_t v = 0; v < n; ++v)
+		{
+			const uint32_t c = mCanonical[v];
+			if(c != v)
+			{
+				// Insert v into the ring after its canonical vertex
+				mWedgeNext[v] = mWedgeNext[c];
+				mWedgeNext[c] = v;
+			}
+		}
+	}
+
+	void Simplifier::BuildAdjacency()
+	{
+		const uint32_t n = mVertices.VertexCount;
+
+		mTriOffsets.assign(size_t(n) + 1, 0);
+		for(uint32_t index : mIndices)
+			++mTriOffsets[index + 1];
+		for(uint32_t v = 0; v < n; ++v)
+			mTriOffsets[v + 1] += mTriOffsets[v];
+
+		mTriangles.resize(mIndices.size());
+		std::vector<uint32_t> fill(mTriOffsets.begin(), mTriOffsets.end() - 1);
+		for(size_t i = 0; i < mIndices.size(); ++i)
+			mTriangles[fill[mIndices[i]]++] = static_cast<uint32_t>(i / 3);
+	}
+
+	// Is there a half-edge b' -> a' with the same positions as b -> a?
+	bool Simplifier::HasPositionOpposite(uint32_t a, uint32_t b) const
+	{
+		const uint32_t ca = mCanonical[a];
+		uint32_t w = b;
+		do
+		{
+			for(uint32_t t = mTriOffsets[w]; t < mTriOffsets[w + 1]; ++t)
+			{
+				const uint32_t* tri = &mIndices[size_t(mTriangles[t]) * 3];
+				const int k = tri[0] == w ? 0 : (tri[1] == w ? 1 : 2);
+				if(mCanonical[tri[(k + 1) % 3]] == ca)
+					return true;
+			}
+			w = mWedgeNext[w];
+		} while(w != b);
+
+		return false;
+	}
+
+	bool Simplifier::HasIndexOpposite(uint32_t a, uint32_t b) const
+	{
+		for(uint32_t t = mTriOffsets[b]; t < mTriOffsets[b + 1]; ++t)
+		{
+			const uint32_t* tri = &mIndices[size_t(mTriangles[t]) * 3];
+			const int k = tri[0] == b ? 0 : (tri[1] == b ? 1 : 2);
+			if(tri[(k + 1) % 3] == a)
+				return true;
+		}
+		return false;
+	}
+
+	void Simplifier::Classify()
+	{
+		const uint32_t n = mVertices.VertexCount;
+		mKind.assign(n, Kind::Locked);
+
+		for(uint32_t v = 0; v < n; ++v)
+		{
+			if(mCanonical[v] != v)
+				continue;
+
+			uint32_t wedges = 0, openOut = 0, openIn = 0, seamOut = 0;
+
+			uint32_t w = v;
+			do
+			{
+				if(mTriOffsets[w + 1] > mTriOffsets[w])
+					++wedges;
+
+				for(uint32_t t = mTriOffsets[w]; t < mTriOffsets[w + 1]; ++t)
+				{
+					const uint32_t* tri = &mIndices[size_t(mTriangles[t]) * 3];
+					const int k = tri[0] == w ? 0 : (tri[1] == w ? 1 : 2);
+					const uint32_t next = tri[(k + 1) % 3];
+					const uint32_t prev = tri[(k + 2) % 3];
+
+					if(!HasPositionOpposite(w, next))
+						++openOut;
+					else if(!HasIndexOpposite(w, next))
+						++seamOut;
+
+					if(!HasPositionOpposite(prev, w))
+						++openIn;
+				}
+
+				w = mWedgeNext[w];
+			} while(w != v);
+
+			Kind kind = Kind::Locked;
+			if(wedges == 1 && openOut == 0 && openIn == 0)
+				kind = Kind::Manifold;
+			else if(wedges == 1 && openOut == 1 && openIn == 1 && !mOptions.LockBorder)
+				kind = Kind::Border;
+			else if(wedges == 2 && openOut == 0 && openIn == 0 && seamOut == 2)
+				kind = Kind::Seam;
+
+			mKind[v] = kind;
+		}
+	}
+
+	void Simplifier::BuildQuadrics()
+	{
+		mQuadrics.assign(mVertices.VertexCount, Quadric());
+
+		for(size_t i = 0; i < mIndices.size(); i += 3)
+		{
+			const uint32_t v[3] = { mIndices[i], mIndices[i + 1], mIndices[i + 2] };
+			const float* p0 = Pos(v[0]);
+			const float* p1 = Pos(v[1]);
+			const float* p2 = Pos(v[2]);
+
+			const float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			const float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			float normal[3] = {
+				e1[1] * e2[2] - e1[2] * e2[1],
+				e1[2] * e2[0] - e1[0] * e2[2],
+				e1[0] * e2[1] - e1[1] * e2[0] };
+
+			const float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+			if(length == 0.0f)
+				continue;
+
+			for(float& c : normal)
+				c /= length;
+
+			const float d = -(normal[0] * p0[0] + normal[1] * p0[1] + normal[2] * p0[2]);
+			for(uint32_t k = 0; k < 3; ++k)
+				mQuadrics[mCanonical[v[k]]].AddPlane(normal, d, 0.5f * length);
+
+			// Open edges get a plane through the edge, perpendicular to the triangle, so
+			// border vertices resist moving off the border line
+			for(uint32_t k = 0; k < 3; ++k)
+			{
+				const uint32_t a = v[k];
+				const uint32_t b = v[(k + 1) % 3];
+				if(HasPositionOpposite(a, b))
+					continue;
+
+				const float* pa = Pos(a);
+				const float* pb = Pos(b);
+				const float e[3] = { pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2] };
+				float side[3] = {
+					e[1] * normal[2] - e[2] * normal[1],
+					e[2] * normal[0] - e[0] * normal[2],
+					e[0] * normal[1] - e[1] * normal[0] };
+
+				const float sideLength = std::sqrt(side[0] * side[0] + side[1] * side[1] + side[2] * side[2]);
+				if(sideLength == 0.0f)
+					continue;
+
+				for(float& c : side)
+					c /= sideLength;
+
+				const float sd = -(side[0] * pa[0] + side[1] * pa[1] + side[2] * pa[2]);
+				const float weight = BorderWeight * (e[0] * e[0] + e[1] * e[1] + e[2] * e[2]);
+				mQuadrics[mCanonical[a]].AddPlane(side, sd, weight);
+				mQuadrics[mCanonical[b]].AddPlane(side, sd, weight);
+			}
+		}
+	}
+
+	float Simplifier::AttributeCost(uint32_t a, uint32_t b) const
+	{
+		if(mVertices.AttributeCount == 0)
+			return 0.0f;
+
+		const float* fa = AttributesOf(a);
+		const float* fb = AttributesOf(b);
+
+		float cost = 0.0f;
+		for(uint32_t k = 0; k < mVertices.AttributeCount; ++k)
+		{
+			const float weight = mVertices.AttributeWeights ? mVertices.AttributeWeights[k] : 1.0f;
+			const float d = weight * (fa[k] - fb[k]);
+			cost += d * d;
+		}
+		return cost;
+	}
+
+	void Simplifier::CollectCollapses()
+	{
+		// Candidates only read the mesh, so chunks of triangles are scanned in parallel.
+		// Each chunk has its own list and they are joined in order, which keeps the
+		// result independent of scheduling.
+		const uint32_t triangleCount = static_cast<uint32_t>(mIndices.size() / 3);
+		mChunkCollapses.resize((triangleCount + CollectGrain - 1) / CollectGrain);
+
+		auto consider = [this](std::vector<Collapse>& out, uint32_t from, uint32_t to, bool border, bool seam)
+		{
+			const uint32_t u = mCanonical[from];
+			const uint32_t v = mCanonical[to];
+			if(u == v)
+				return;
+
+			// Border vertices slide only along the border and seam vertices only along the
+			// seam; the target must stay on that line too
+			const Kind ku = mKind[u];
+			const Kind kv = mKind[v];
+			switch(ku)
+			{
+			case Kind::Manifold:
+				break;
+			case Kind::Border:
+				if(!border || (kv != Kind::Border && kv != Kind::Locked))
+					return;
+				break;
+			case Kind::Seam:
+				if(!seam || (kv != Kind::Seam && kv != Kind::Locked))
+					return;
+				break;
+			case Kind::Locked:
+				return;
+			}
+
+			float cost = mQuadrics[u].Error(Pos(to)) + AttributeCost(from, to);
+			if(ku == Kind::Seam)
+			{
+				// The other wedge pays its attribute change as well
+				const uint32_t other = OtherWedge(from);
+				uint32_t otherTo;
+				if(other != Empty && FindWedgeTarget(other, v, otherTo))
+					cost += AttributeCost(other, otherTo);
+			}
+
+			out.push_back({ from, to, cost });
+		};
+
+		JobSystem::ParallelFor(triangleCount, CollectGrain, [this, &consider](uint32_t begin, uint32_t end)
+		{
+			std::vector<Collapse>& out = mChunkCollapses[begin / CollectGrain];
+			out.clear();
+
+			for(size_t i = size_t(begin) * 3; i < size_t(end) * 3; i += 3)
+			{
+				for(uint32_t k = 0; k < 3; ++k)
+				{
+					const uint32_t a = mIndices[i + k];
+					const uint32_t b = mIndices[i + (k + 1) % 3];
+
+					if(!HasPositionOpposite(a, b))
+					{
+						// No triangle on the other side yields b -> a, so add both directions
+						consider(out, a, b, true, false);
+						consider(out, b, a, true, false);
+					}
+					else
+					{
+						consider(out, a, b, false, !HasIndexOpposite(a, b));
+					}
+				}
+			}
+		});
+
+		mCollapses.clear();
+		for(const std::vector<Collapse>& chunk : mChunkCollapses)
+			mCollapses.insert(mCollapses.end(), chunk.begin(), chunk.end());
+	}
+
+	// The other wedge of a seam vertex; vertices no triangle uses do not count.
+	uint32_t Simplifier::OtherWedge(uint32_t wedge) const
+	{
+		for(uint32_t w = mWedgeNext[wedge]; w != wedge; w = mWedgeNext[w])
+		{
+			if(mTriOffsets[w + 1] > mTriOffsets[w])
+				return w;
+		}
+		return Empty;
+	}
+
+	// Wedge of target vertex sharing a triangle with the given wedge.
+	bool Simplifier::FindWedgeTarget(uint32_t wedge, uint32_t target, uint32_t& to) const
+	{
+		for(uint32_t t = mTriOffsets[wedge]; t < mTriOffsets[wedge + 1]; ++t)
+		{
+			const uint32_t* tri = &mIndices[size_t(mTriangles[t]) * 3];
+			for(uint32_t k = 0; k < 3; ++k)
+			{
+				if(mCanonical[tri[k]] == target)
+				{
+					to = tri[k];
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	// Rejects the collapse if a remaining triangle around from would flip or turn
+	// sharply, or if u and v share a neighbour other than the apexes of their common
+	// triangles (the link condition) - collapsing then would fold the surface into
+	// non-manifold edges.  Counts triangles that the collapse removes.
+	bool Simplifier::IsValidCollapse(uint32_t from, uint32_t to, uint32_t& removed)
+	{
+		const uint32_t u = mCanonical[from];
+		const uint32_t v = mCanonical[to];
+		const float* target = Pos(to);
+
+		mStamp += 2;
+		const uint32_t neighbour = mStamp;
+		const uint32_t apex = mStamp + 1;
+
+		removed = 0;
+
+		uint32_t w = from;
+		do
+		{
+			for(uint32_t t = mTriOffsets[w]; t < mTriOffsets[w + 1]; ++t)
+			{
+				const uint32_t* tri = &mIndices[size_t(mTriangles[t]) * 3];
+				const uint32_t c[3] = { mCanonical[tri[0]], mCanonical[tri[1]], mCanonical[tri[2]] };
+				const int k = c[0] == u ? 0 : (c[1] == u ? 1 : 2);
+				const uint32_t c1 = c[(k + 1) % 3];
+				const uint32_t c2 = c[(k + 2) % 3];
+
+				if(c1 == v || c2 == v)
+				{
+					mMark[c1 == v ? c2 : c1] = apex;
+					++removed;
+					continue;
+				}
+
+				if(mMark[c1] != apex)
+					mMark[c1] = neighbour;
+				if(mMark[c2] != apex)
+					mMark[c2] = neighbour;
+
+				const float* p0 = Pos(tri[k]);
+				const float* p1 = Pos(tri[(k + 1) % 3]);
+				const float* p2 = Pos(tri[(k + 2) % 3]);
+
+				auto normal = [](const float* a, const float* b, const float* c, float* n)
+				{
+					const float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+					const float e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+					n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+					n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+					n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+				};
+
+				float before[3], after[3];
+				normal(p0, p1, p2, before);
+				normal(target, p1, p2, after);
+
+				const float dot = before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+				const float lengths = std::sqrt(
+					(before[0] * before[0] + before[1] * before[1] + before[2] * before[2]) *
+					(after[0] * after[0] + after[1] * after[1] + after[2] * after[2]));
+
+				if(dot <= MinNormalCos * lengths)
+					return false;
+			}
+
+			w = mWedgeNext[w];
+		} while(w != from);
+
+		w = to;
+		do
+		{
+			for(uint32_t t = mTriOffsets[w]; t < mTriOffsets[w + 1]; ++t)
+			{
+				const uint32_t* tri = &mIndices[size_t(mTriangles[t]) * 3];
+				for(uint32_t k = 0; k < 3; ++k)
+				{
+					if(mMark[mCanonical[tri[k]]] == neighbour)
+						return false;
+				}
+			}
+			w = mWedgeNext[w];
+		} while(w != to);
+
+		return true;
+	}
+
+	float Simplifier::Run(const uint32_t* indices, size_t indexCount, std::vector<uint32_t>& result)
+	{
+		mIndices.assign(indices, indices + indexCount);
+
+		BuildPositions();
+		BuildAdjacency();
+		Classify();
+		BuildQuadrics();
+
+		const uint32_t n = mVertices.VertexCount;
+		const size_t targetTriangles = mOptions.TargetIndexCount / 3;
+		const float maxCost = mOptions.TargetError * mOptions.TargetError;
+
+		mRemap.resize(n);
+		mLocked.resize(n);
+		mMark.assign(n, 0);
+		float maxError = 0.0f;
+
+		while(mIndices.size() / 3 > targetTriangles)
+		{
+			CollectCollapses();
+			if(mCollapses.empty())
+				break;
+
+			SortByCost(mCollapses, mSortScratch);
+
+			for(uint32_t v = 0; v < n; ++v)
+				mRemap[v] = v;
+			std::fill(mLocked.begin(), mLocked.end(), uint8_t(0));
+
+			const size_t triangleCount = mIndices.size() / 3;
+			size_t removed = 0;
+			uint32_t applied = 0;
+
+			for(const Collapse& collapse : mCollapses)
+			{
+				if(collapse.Cost > maxCost || triangleCount - removed <= targetTriangles)
+					break;
+
+				const uint32_t u = mCanonical[collapse.From];
+				const uint32_t v = mCanonical[collapse.To];
+				if(mLocked[u] || mLocked[v])
+					continue;
+
+				// Seam vertices move both wedges, each onto the matching wedge of v
+				uint32_t otherFrom = Empty, otherTo = Empty;
+				if(mKind[u] == Kind::Seam)
+				{
+					otherFrom = OtherWedge(collapse.From);
+					if(otherFrom == Empty || !FindWedgeTarget(otherFrom, v, otherTo) || otherTo == collapse.To)
+						continue;
+				}
+
+				uint32_t collapsed = 0;
+				if(!IsValidCollapse(collapse.From, collapse.To, collapsed))
+					continue;
+
+				mRemap[collapse.From] = collapse.To;
+				if(otherFrom != Empty)
+					mRemap[otherFrom] = otherTo;
+
+				mQuadrics[v].Add(mQuadrics[u]);
+
+				// Neighbours keep their positions for this pass, so the flip checks of
+				// later collapses see the geometry they will actually produce
+				uint32_t w = collapse.From;
+				do
+				{
+					for(uint32_t t = mTriOffsets[w]; t < mTriOffsets[w + 1]; ++t)
+					{
+						const uint32_t* tri = &mIndices[size_t(mTriangles[t]) * 3];
+						for(uint32_t k = 0; k < 3; ++k)
+							mLocked[mCanonical[tri[k]]] = 1;
+					}
+					w = mWedgeNext[w];
+				} while(w != collapse.From);
+
+				removed += collapsed;
+				maxError = std::max(maxError, collapse.Cost);
+				++applied;
+			}
+
+			if(applied == 0)
+				break;
+
+			// Rewrite indices and drop triangles that became degenerate
+			size_t write = 0;
+			for(size_t i = 0; i < mIndices.size(); i += 3)
+			{
+				const uint32_t a = mRemap[mIndices[i]];
+				const uint32_t b = mRemap[mIndices[i + 1]];
+				const uint32_t c = mRemap[mIndices[i + 2]];
+
+				const uint32_t ca = mCanonical[a], cb = mCanonical[b], cc = mCanonical[c];
+				if(ca == cb || cb == cc || ca == cc)
+					continue;
+
+				mIndices[write++] = a;
+				mIndices[write++] = b;
+				mIndices[write++] = c;
+			}
+			mIndices.resize(write);
+
+			BuildAdjacency();
+		}
+
+		result.swap(mIndices);
+		return std::sqrt(maxError) * mScale;
+	}
+}
+
+float MeshSimplifier::Simplify(const VertexData& vertices, const uint32_t* indices, size_t indexCount,
+	const Options& options, std::vector<uint32_t>& result)
+{
+	PROFILE_ZONE("MeshSimplifier::Simplify");
+
+	Simplifier simplifier(vertices, options);
+	return simplifier.Run(indices, indexCount, result);
+}
+
+uint32_t MeshSimplifier::WeldVertices(const void* vertices, uint32_t vertexCount, size_t stride,
+	std::vector<uint32_t>& remap)
+{
+	const char* bytes = static_cast<const char*>(vertices);
+
+	return BuildRemap(vertexCount,
+		[bytes, stride](uint32_t v) { return HashBytes(bytes + v * stride, stride); },
+		[bytes, stride](uint32_t a, uint32_t b) { return std::memcmp(bytes + a * stride, bytes + b * stride, stride) == 0; },
+		remap);
+}
+
+std::vector<MeshSimplifier::LodLevel> MeshSimplifier::BuildLodChain(const VertexData& vertices,
+	const uint32_t* indices, size_t indexCount, const LodOptions& options, std::vector<uint32_t>& lodIndices)
+{
+	PROFILE_ZONE("MeshSimplifier::BuildLodChain");
+
+	std::vector<LodLevel> levels;
+
+	const uint32_t first = static_cast<uint32_t>(lodIndices.size());
+	lodIndices.insert(lodIndices.end(), indices, indices + indexCount);
+	levels.push_back({ first, static_cast<uint32_t>(indexCount), 0.0f });
+
+	std::vector<uint32_t> current(indices, indices + indexCount);
+	std::vector<uint32_t> next;
+	float error = 0.0f;
+
+	while(levels.size() < options.MaxLevels)
+	{
+		const size_t targetTriangles = static_cast<size_t>(current.size() / 3 * options.Reduction);
+		if(targetTriangles < options.MinTriangles)
+			break;
+
+		Options simplify;
+		simplify.TargetIndexCount = static_cast<uint32_t>(targetTriangles * 3);
+		simplify.TargetError = options.MaxError;
+		simplify.LockBorder = options.LockBorder;
+
+		const float levelError = Simplify(vertices, current.data(), current.size(), simplify, next);
+
+		// Not worth a level of its own: the error limit or locked vertices stopped it early
+		if(next.size() > current.size() * 85 / 100)
+			break;
+
+		// Errors of consecutive levels add up at most
+		error += levelError;
+
+		levels.push_back({ static_cast<uint32_t>(lodIndices.size()), static_cast<uint32_t>(next.size()), error });
+		lodIndices.insert(lodIndices.end(), next.begin(), next.end());
+		current.swap(next);
+	}
+
+	return levels;
+}
+
+uint32_t MeshSimplifier::SelectLod(const LodLevel* levels, uint32_t levelCount, uint32_t current,
+	float pixelsPerUnit, float maxPixelError, float hysteresis)
+{
+	if(levelCount <= 1)
+		return 0;
+
+	current = std::min(current, levelCount - 1);
+
+	auto coarsestWithin = [&](float limit)
+	{
+		uint32_t level = 0;
+		while(level + 1 < levelCount && levels[level + 1].Error * pixelsPerUnit <= limit)
+			++level;
+		return level;
+	};
+
+	// Current level became too coarse: drop to what the plain limit allows
+	if(levels[current].Error * pixelsPerUnit > maxPixelError * (1.0f + hysteresis))
+		return coarsestWithin(maxPixelError);
+
+	// Otherwise coarsen only with some margin below the limit
+	return std::max(current, coarsestWithin(maxPixelError * (1.0f - hysteresis)));
+}
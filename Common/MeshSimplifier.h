@@ -0,0 +1,85 @@
+//***************************************************************************************
+// MeshSimplifier.h
+//
+// Quadric error metric simplification (Garland & Heckbert) by collapsing edges onto
+// existing vertices.  No new vertices are created, so every level of detail shares the
+// original vertex buffer and only needs its own index list.
+//
+// Vertices that share a position but differ in attributes are treated as one
+// topological vertex with several "wedges".  A vertex on such an attribute seam only
+// collapses along the seam, into another seam vertex, so normal and color
+// discontinuities survive.  Open borders get extra constraint planes and only slide
+// along the border (or stay locked with LockBorder).  Differences in attributes between
+// the collapse endpoints are added to the geometric error with per-attribute weights.
+//
+// Errors are distances in mesh units: roughly how far the simplified surface strays
+// from the original one.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace MeshSimplifier
+{
+	struct VertexData
+	{
+		const void* Vertices = nullptr;
+		size_t Stride = 0;                     // bytes per vertex
+		uint32_t VertexCount = 0;
+
+		size_t PositionOffset = 0;             // byte offset of x, y, z in a vertex
+
+		size_t AttributeOffset = 0;            // byte offset of the first attribute float
+		uint32_t AttributeCount = 0;           // consecutive floats, 0 for none
+		const float* AttributeWeights = nullptr;
+	};
+
+	struct Options
+	{
+		uint32_t TargetIndexCount = 0;
+		float TargetError = 0.01f;             // relative to the largest mesh extent
+		bool LockBorder = false;
+	};
+
+	// Writes the simplified index list to result (which may alias nothing in indices).
+	// Returns the largest error of any collapse made, in mesh units.
+	float Simplify(const VertexData& vertices, const uint32_t* indices, size_t indexCount,
+		const Options& options, std::vector<uint32_t>& result);
+
+	// Maps every vertex to the first byte-identical one.  Returns the number of unique
+	// vertices; remap[i] == i marks a vertex that is kept.
+	uint32_t WeldVertices(const void* vertices, uint32_t vertexCount, size_t stride,
+		std::vector<uint32_t>& remap);
+
+	struct LodLevel
+	{
+		uint32_t FirstIndex;
+		uint32_t IndexCount;
+		float Error; // mesh units, against level 0
+	};
+
+	struct LodOptions
+	{
+		uint32_t MaxLevels = 6;
+		float Reduction = 0.5f;     // triangles of a level relative to the previous one
+		float MaxError = 0.05f;     // per level, relative to the largest mesh extent
+		uint32_t MinTriangles = 64;
+		bool LockBorder = false;
+	};
+
+	// Level 0 is the input; each further level simplifies the previous one.  The chain
+	// stops early once a level would no longer shrink noticeably.  All levels are
+	// appended to lodIndices.
+	std::vector<LodLevel> BuildLodChain(const VertexData& vertices, const uint32_t* indices, size_t indexCount,
+		const LodOptions& options, std::vector<uint32_t>& lodIndices);
+
+	// Coarsest level whose error, projected to the screen, stays below maxPixelError.
+	// Moving to a coarser level needs the error to drop below (1 - hysteresis) of the
+	// limit and leaving the current one needs it to exceed (1 + hysteresis), so objects
+	// near a boundary do not flicker between levels.
+	uint32_t SelectLod(const LodLevel* levels, uint32_t levelCount, uint32_t current,
+		float pixelsPerUnit, float maxPixelError, float hysteresis);
+}
@@ -0,0 +1,320 @@
+//***************************************************************************************
+// Meshlets.cpp
+//***************************************************************************************
+
+#include "Meshlets.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+	constexpr uint32_t NotLocal = 0xFFFFFFFFu;
+
+	const float* PositionOf(const void* positions, size_t stride, uint32_t v)
+	{
+		return reinterpret_cast<const float*>(static_cast<const char*>(positions) + v * stride);
+	}
+
+	void Normalize(float v[3])
+	{
+		const float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+		if(length > 0.0f)
+		{
+			v[0] /= length;
+			v[1] /= length;
+			v[2] /= length;
+		}
+	}
+
+	float Dot(const float* a, const float* b)
+	{
+		return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+	}
+
+	Meshlets::Bounds ComputeBounds(const Meshlets::MeshletData& data, const Meshlets::Meshlet& meshlet,
+		const void* positions, size_t stride)
+	{
+		Meshlets::Bounds bounds = {};
+
+		// Sphere around the box of the vertices
+		float minP[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+		float maxP[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		for(uint32_t i = 0; i < meshlet.VertexCount; ++i)
+		{
+			const float* p = PositionOf(positions, stride, data.Vertices[meshlet.VertexOffset + i]);
+			for(int c = 0; c < 3; ++c)
+			{
+				minP[c] = std::min(minP[c], p[c]);
+				maxP[c] = std::max(maxP[c], p[c]);
+			}
+		}
+
+		for(int c = 0; c < 3; ++c)
+			bounds.Center[c] = 0.5f * (minP[c] + maxP[c]);
+
+		float radiusSq = 0.0f;
+		for(uint32_t i = 0; i < meshlet.VertexCount; ++i)
+		{
+			const float* p = PositionOf(positions, stride, data.Vertices[meshlet.VertexOffset + i]);
+			const float d[3] = { p[0] - bounds.Center[0], p[1] - bounds.Center[1], p[2] - bounds.Center[2] };
+			radiusSq = std::max(radiusSq, Dot(d, d));
+		}
+		bounds.Radius = std::sqrt(radiusSq);
+
+		// Normal cone: average of the unit triangle normals, opened to the widest one
+		std::vector<float> normals(size_t(meshlet.TriangleCount) * 3);
+		std::vector<const float*> firstVertex(meshlet.TriangleCount);
+		float axis[3] = { 0.0f, 0.0f, 0.0f };
+
+		for(uint32_t t = 0; t < meshlet.TriangleCount; ++t)
+		{
+			const uint8_t* local = &data.Triangles[size_t(meshlet.TriangleOffset + t) * 3];
+			const float* p0 = PositionOf(positions, stride, data.Vertices[meshlet.VertexOffset + local[0]]);
+			const float* p1 = PositionOf(positions, stride, data.Vertices[meshlet.VertexOffset + local[1]]);
+			const float* p2 = PositionOf(positions, stride, data.Vertices[meshlet.VertexOffset + local[2]]);
+
+			const float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			const float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			float* n = &normals[size_t(t) * 3];
+			n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+			n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+			n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+			Normalize(n);
+
+			firstVertex[t] = p0;
+			for(int c = 0; c < 3; ++c)
+				axis[c] += n[c];
+		}
+
+		Normalize(axis);
+
+		float minDot = 1.0f;
+		for(uint32_t t = 0; t < meshlet.TriangleCount; ++t)
+			minDot = std::min(minDot, Dot(&normals[size_t(t) * 3], axis));
+
+		std::copy(axis, axis + 3, bounds.ConeAxis);
+
+		if(minDot <= 0.1f)
+		{
+			// Triangles face more than ~85 degrees apart: some are visible from anywhere
+			std::copy(bounds.Center, bounds.Center + 3, bounds.ConeApex);
+			bounds.ConeCutoff = 1.0f;
+			return bounds;
+		}
+
+		// Apex: pull the center back along the axis until it lies behind every triangle's
+		// plane, so "apex is behind all planes" stays true for eyes inside the cone
+		float maxT = 0.0f;
+		for(uint32_t t = 0; t < meshlet.TriangleCount; ++t)
+		{
+			const float* n = &normals[size_t(t) * 3];
+			const float* p0 = firstVertex[t];
+			const float toCenter[3] = { bounds.Center[0] - p0[0], bounds.Center[1] - p0[1], bounds.Center[2] - p0[2] };
+			maxT = std::max(maxT, Dot(toCenter, n) / Dot(axis, n));
+		}
+
+		for(int c = 0; c < 3; ++c)
+			bounds.ConeApex[c] = bounds.Center[c] - axis[c] * maxT;
+
+		bounds.ConeCutoff = std::sqrt(1.0f - minDot * minDot);
+		return bounds;
+	}
+}
+
+void Meshlets::MeshletData::ExpandIndices(std::vector<uint32_t>& indices) const
+{
+	indices.resize(Triangles.size());
+
+	for(const Meshlet& m : Meshlets)
+	{
+		for(uint32_t i = 0; i < m.TriangleCount * 3; ++i)
+			indices[size_t(m.TriangleOffset) * 3 + i] = Vertices[m.VertexOffset + Triangles[size_t(m.TriangleOffset) * 3 + i]];
+	}
+}
+
+void Meshlets::Build(const void* positions, size_t stride, uint32_t vertexCount,
+	const uint32_t* indices, size_t indexCount, MeshletData& result, float coneWeight)
+{
+	PROFILE_ZONE("Meshlets::Build");
+
+	result = MeshletData();
+
+	const uint32_t triangleCount = static_cast<uint32_t>(indexCount / 3);
+	if(triangleCount == 0)
+		return;
+
+	// vertex -> triangles
+	std::vector<uint32_t> offsets(size_t(vertexCount) + 1, 0);
+	for(size_t i = 0; i < indexCount; ++i)
+		++offsets[indices[i] + 1];
+	for(uint32_t v = 0; v < vertexCount; ++v)
+		offsets[v + 1] += offsets[v];
+
+	std::vector<uint32_t> adjacency(indexCount);
+	{
+		std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+		for(size_t i = 0; i < indexCount; ++i)
+			adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+	}
+
+	std::vector<float> normals(size_t(triangleCount) * 3);
+	for(uint32_t t = 0; t < triangleCount; ++t)
+	{
+		const float* p0 = PositionOf(positions, stride, indices[t * 3]);
+		const float* p1 = PositionOf(positions, stride, indices[t * 3 + 1]);
+		const float* p2 = PositionOf(positions, stride, indices[t * 3 + 2]);
+		const float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+		const float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+		float* n = &normals[size_t(t) * 3];
+		n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+		n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+		n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+		Normalize(n);
+	}
+
+	std::vector<uint8_t> used(triangleCount, 0);
+	std::vector<uint32_t> localIndex(vertexCount, NotLocal);
+	std::vector<uint32_t> frontierStamp(triangleCount, 0);
+	std::vector<uint32_t> frontier;
+
+	result.Meshlets.reserve(triangleCount / MaxTriangles * 2 + 1);
+	result.Vertices.reserve(indexCount / 2);
+	result.Triangles.reserve(indexCount);
+
+	uint32_t cursor = 0;
+	uint32_t stamp = 0;
+
+	while(true)
+	{
+		// Seed: a leftover neighbour of the previous meshlet keeps clusters adjacent,
+		// otherwise the next unused triangle in index order
+		uint32_t seed = NotLocal;
+		for(uint32_t t : frontier)
+		{
+			if(!used[t])
+			{
+				seed = t;
+				break;
+			}
+		}
+
+		if(seed == NotLocal)
+		{
+			while(cursor < triangleCount && used[cursor])
+				++cursor;
+			if(cursor == triangleCount)
+				break;
+			seed = cursor;
+		}
+
+		++stamp;
+		frontier.clear();
+
+		Meshlet meshlet = {};
+		meshlet.VertexOffset = static_cast<uint32_t>(result.Vertices.size());
+		meshlet.TriangleOffset = static_cast<uint32_t>(result.Triangles.size() / 3);
+
+		float normalSum[3] = { 0.0f, 0.0f, 0.0f };
+
+		auto addTriangle = [&](uint32_t t)
+		{
+			used[t] = 1;
+
+			for(uint32_t k = 0; k < 3; ++k)
+			{
+				const uint32_t v = indices[t * 3 + k];
+				if(localIndex[v] == NotLocal)
+				{
+					localIndex[v] = meshlet.VertexCount++;
+					result.Vertices.push_back(v);
+
+					for(uint32_t a = offsets[v]; a < offsets[v + 1]; ++a)
+					{
+						const uint32_t neighbour = adjacency[a];
+						if(!used[neighbour] && frontierStamp[neighbour] != stamp)
+						{
+							frontierStamp[neighbour] = stamp;
+							frontier.push_back(neighbour);
+						}
+					}
+				}
+
+				result.Triangles.push_back(static_cast<uint8_t>(localIndex[v]));
+			}
+
+			for(int c = 0; c < 3; ++c)
+				normalSum[c] += normals[size_t(t) * 3 + c];
+			++meshlet.TriangleCount;
+		};
+
+		addTriangle(seed);
+
+		while(meshlet.TriangleCount < MaxTriangles)
+		{
+			float axis[3] = { normalSum[0], normalSum[1], normalSum[2] };
+			Normalize(axis);
+
+			uint32_t best = NotLocal;
+			float bestScore = FLT_MAX;
+			size_t write = 0;
+
+			for(uint32_t t : frontier)
+			{
+				if(used[t])
+					continue;
+				frontier[write++] = t;
+
+				uint32_t extra = 0;
+				for(uint32_t k = 0; k < 3; ++k)
+					extra += localIndex[indices[t * 3 + k]] == NotLocal ? 1 : 0;
+
+				if(meshlet.VertexCount + extra > MaxVertices)
+					continue;
+
+				const float score = extra + coneWeight * (1.0f - Dot(&normals[size_t(t) * 3], axis));
+				if(score < bestScore)
+				{
+					bestScore = score;
+					best = t;
+				}
+			}
+			frontier.resize(write);
+
+			if(best == NotLocal)
+				break;
+
+			addTriangle(best);
+		}
+
+		for(uint32_t i = 0; i < meshlet.VertexCount; ++i)
+			localIndex[result.Vertices[meshlet.VertexOffset + i]] = NotLocal;
+
+		result.Meshlets.push_back(meshlet);
+	}
+
+	result.Bounds.resize(result.Meshlets.size());
+	for(size_t m = 0; m < result.Meshlets.size(); ++m)
+		result.Bounds[m] = ComputeBounds(result, result.Meshlets[m], positions, stride);
+}
+
+Meshlets::CullResult Meshlets::Cull(const Bounds& bounds, const RenderWorld::Frustum& frustum, const float eye[3])
+{
+	for(const auto& p : frustum.Planes)
+	{
+		if(p[0] * bounds.Center[0] + p[1] * bounds.Center[1] + p[2] * bounds.Center[2] + p[3] < -bounds.Radius)
+			return CullResult::OutsideFrustum;
+	}
+
+	if(bounds.ConeCutoff < 1.0f)
+	{
+		const float toApex[3] = { bounds.ConeApex[0] - eye[0], bounds.ConeApex[1] - eye[1], bounds.ConeApex[2] - eye[2] };
+		const float distance = std::sqrt(Dot(toApex, toApex));
+		if(Dot(toApex, bounds.ConeAxis) >= bounds.ConeCutoff * distance)
+			return CullResult::Backfacing;
+	}
+
+	return CullResult::Visible;
+}
@@ -0,0 +1,74 @@
+//***************************************************************************************
+// Meshlets.h
+//
+// Splits indexed triangle lists into small clusters ("meshlets") of at most 64 vertices
+// and 124 triangles - the sizes mesh shader groups are built around - and gives every
+// cluster a bounding sphere and a normal cone, so a large mesh can be culled piece by
+// piece instead of as a whole.
+//
+// Build grows each cluster greedily from a seed triangle, always adding the adjacent
+// triangle that brings the fewest new vertices and best matches the cluster's average
+// normal.  Few new vertices keep clusters compact; similar normals keep the cones
+// narrow enough for backface culling.
+//***************************************************************************************
+
+#pragma once
+
+#include "RenderWorld.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Meshlets
+{
+	constexpr uint32_t MaxVertices = 64;
+	constexpr uint32_t MaxTriangles = 124;
+
+	struct Meshlet
+	{
+		uint32_t VertexOffset;   // into MeshletData::Vertices
+		uint32_t TriangleOffset; // in triangles, into MeshletData::Triangles / 3
+		uint32_t VertexCount;
+		uint32_t TriangleCount;
+	};
+
+	struct Bounds
+	{
+		float Center[3];
+		float Radius;
+
+		// Every triangle faces away from any eye inside the cone
+		// dot(normalize(ConeApex - eye), ConeAxis) >= ConeCutoff.
+		float ConeApex[3];
+		float ConeAxis[3];
+		float ConeCutoff; // 1 when the normals spread too far to ever cull
+	};
+
+	struct MeshletData
+	{
+		std::vector<Meshlet> Meshlets;
+		std::vector<Meshlets::Bounds> Bounds; // one per meshlet
+		std::vector<uint32_t> Vertices;    // mesh vertex index of each meshlet-local vertex
+		std::vector<uint8_t> Triangles;    // three meshlet-local indices per triangle
+
+		// The source triangles regrouped by meshlet, in mesh vertex indices: meshlet m
+		// covers TriangleCount * 3 indices starting at TriangleOffset * 3.
+		void ExpandIndices(std::vector<uint32_t>& indices) const;
+	};
+
+	// positions: x, y, z at the start of each stride-byte vertex.
+	void Build(const void* positions, size_t stride, uint32_t vertexCount,
+		const uint32_t* indices, size_t indexCount, MeshletData& result, float coneWeight = 0.25f);
+
+	enum class CullResult : uint8_t
+	{
+		Visible,
+		OutsideFrustum,
+		Backfacing
+	};
+
+	// Frustum and normal cone tests; the frustum and eye must be in the mesh's space
+	// (e.g. Frustum::FromViewProj(world * viewProj)).
+	CullResult Cull(const Bounds& bounds, const RenderWorld::Frustum& frustum, const float eye[3]);
+}
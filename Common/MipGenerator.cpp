@@ -0,0 +1,675 @@
+//***************************************************************************************
+// MipGenerator.cpp
+//***************************************************************************************
+
+#include "MipGenerator.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define MIP_GENERATOR_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define MIP_GENERATOR_AVX2_TARGET
+#else
+#include <cpuid.h>
+#define MIP_GENERATOR_AVX2_TARGET __attribute__((target("avx2,f16c")))
+#endif
+#else
+#define MIP_GENERATOR_X86 0
+#endif
+
+using namespace MipGenerator;
+
+namespace
+{
+	std::atomic<bool> gAvx2Enabled{ true };
+
+	bool DetectAvx2()
+	{
+#if MIP_GENERATOR_X86
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		if(info[0] < 7)
+			return false;
+
+		__cpuid(info, 1);
+		const bool osxsave = (info[2] & (1 << 27)) != 0;
+		const bool avx = (info[2] & (1 << 28)) != 0;
+		const bool f16c = (info[2] & (1 << 29)) != 0;
+		if(!osxsave || !avx || !f16c)
+			return false;
+
+		// The OS must save the YMM registers on context switch.
+		if((_xgetbv(0) & 0x6) != 0x6)
+			return false;
+
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#else
+		unsigned eax, ebx, ecx, edx;
+		if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & (1u << 29)))
+			return false;
+		return __builtin_cpu_supports("avx2");
+#endif
+#else
+		return false;
+#endif
+	}
+
+	bool CpuHasAvx2()
+	{
+		static const bool hasAvx2 = DetectAvx2();
+		return hasAvx2;
+	}
+
+	uint32_t Channels(Format format)
+	{
+		return format == Format::R32F ? 1 : 4;
+	}
+
+	//-----------------------------------------------------------------------------------
+	// Conversions
+	//-----------------------------------------------------------------------------------
+
+	struct Tables
+	{
+		// sRGB byte -> linear for channels 0-2, byte / 255 for alpha: [channel * 256 + byte]
+		float ToLinear[1024];
+
+		// Linear value quantized to 16 bits -> sRGB byte.  Padded so a 32-bit gather at
+		// the last entry stays inside.
+		uint8_t ToSrgb[65536 + 4];
+
+		Tables()
+		{
+			for(uint32_t v = 0; v < 256; ++v)
+			{
+				const double x = v / 255.0;
+				const double linear = x <= 0.04045 ? x / 12.92 : std::pow((x + 0.055) / 1.055, 2.4);
+				ToLinear[v] = ToLinear[256 + v] = ToLinear[512 + v] = float(linear);
+				ToLinear[768 + v] = float(v) * (1.0f / 255.0f);
+			}
+
+			for(uint32_t i = 0; i < 65536; ++i)
+			{
+				const double x = i / 65535.0;
+				const double srgb = x <= 0.0031308 ? x * 12.92 : 1.055 * std::pow(x, 1.0 / 2.4) - 0.055;
+				ToSrgb[i] = uint8_t(std::lround(srgb * 255.0));
+			}
+			std::memset(ToSrgb + 65536, 0, 4);
+		}
+	};
+
+	const Tables& GetTables()
+	{
+		static const Tables tables;
+		return tables;
+	}
+
+	uint32_t FloatBits(float f)
+	{
+		uint32_t u;
+		std::memcpy(&u, &f, sizeof(u));
+		return u;
+	}
+
+	float BitsFloat(uint32_t u)
+	{
+		float f;
+		std::memcpy(&f, &u, sizeof(f));
+		return f;
+	}
+
+	// Exact, like VCVTPH2PS.
+	float HalfToFloat(uint16_t h)
+	{
+		const uint32_t shiftedExp = 0x7C00u << 13;
+		uint32_t o = uint32_t(h & 0x7FFF) << 13;
+		const uint32_t exp = shiftedExp & o;
+		o += (127 - 15) << 23;
+
+		if(exp == shiftedExp)
+		{
+			o += (128 - 16) << 23; // Inf/NaN; NaNs come out quiet
+			if(o & 0x7FFFFF)
+				o |= 0x400000;
+		}
+		else if(exp == 0)
+		{
+			o += 1 << 23; // zero/denormal: renormalize
+			o = FloatBits(BitsFloat(o) - BitsFloat(113u << 23));
+		}
+
+		return BitsFloat(o | (uint32_t(h & 0x8000) << 16));
+	}
+
+	// Round to nearest even, like VCVTPS2PH with _MM_FROUND_TO_NEAREST_INT.
+	uint16_t FloatToHalf(float f)
+	{
+		uint32_t u = FloatBits(f);
+		const uint32_t sign = (u >> 16) & 0x8000;
+		u &= 0x7FFFFFFF;
+
+		uint32_t o;
+		if(u >= (143u << 23)) // 65536 and up, Inf and NaN
+			o = u > 0x7F800000 ? (0x7E00 | ((u >> 13) & 0x3FF)) : 0x7C00;
+		else if(u < (113u << 23)) // half denormal or zero: let the FPU round
+			o = FloatBits(BitsFloat(u) + BitsFloat(126u << 23)) - (126u << 23);
+		else
+		{
+			const uint32_t odd = (u >> 13) & 1;
+			u += (uint32_t(15 - 127) << 23) + 0xFFF;
+			u += odd;
+			o = u >> 13;
+		}
+
+		return uint16_t(o | sign);
+	}
+
+	//-----------------------------------------------------------------------------------
+	// Filter taps
+	//-----------------------------------------------------------------------------------
+
+	const double KaiserWidth = 3.0; // in output texels
+	const double KaiserAlpha = 4.0;
+
+	double BesselI0(double x)
+	{
+		double sum = 1.0;
+		double term = 1.0;
+		for(int k = 1; k < 50; ++k)
+		{
+			term *= (x * 0.5 / k) * (x * 0.5 / k);
+			sum += term;
+			if(term < sum * 1e-12)
+				break;
+		}
+		return sum;
+	}
+
+	double Kaiser(double t)
+	{
+		const double x = t / KaiserWidth;
+		if(std::fabs(x) >= 1.0)
+			return 0.0;
+
+		const double pi = 3.14159265358979323846;
+		const double sinc = t == 0.0 ? 1.0 : std::sin(pi * t) / (pi * t);
+		return sinc * BesselI0(KaiserAlpha * std::sqrt(1.0 - x * x)) / BesselI0(KaiserAlpha);
+	}
+
+	// Taps of one axis, structure of arrays: tap j of output x is at [j * Size + x].
+	// Every output has Taps entries; unused ones have weight 0 and never come first.
+	struct Axis
+	{
+		uint32_t Size = 0;
+		uint32_t Taps = 0;
+		bool Pairs = false; // box of an even size: texels 2x and 2x + 1, 1/2 each
+		std::vector<int32_t> Index;
+		std::vector<float> Weight;
+	};
+
+	void BuildAxis(uint32_t src, uint32_t dst, Filter filter, Address address, Axis& axis)
+	{
+		struct Tap
+		{
+			int64_t Index;
+			double Weight;
+		};
+
+		std::vector<std::vector<Tap>> taps(dst);
+		const double scale = double(src) / double(dst);
+
+		for(uint32_t x = 0; x < dst; ++x)
+		{
+			std::vector<Tap>& list = taps[x];
+
+			if(src == 1)
+				list.push_back({ 0, 1.0 });
+			else if(filter == Filter::Box)
+			{
+				// Overlap of each source texel with the output footprint
+				const double lo = x * scale;
+				const double hi = (x + 1) * scale;
+				for(int64_t i = int64_t(std::floor(lo)); double(i) < hi; ++i)
+				{
+					const double overlap = (std::min)(hi, double(i + 1)) - (std::max)(lo, double(i));
+					if(overlap > 1e-9)
+						list.push_back({ i, overlap });
+				}
+			}
+			else
+			{
+				// Texel centers: output x sits at source coordinate (x + 0.5) * scale - 0.5
+				const double center = (x + 0.5) * scale - 0.5;
+				const double radius = KaiserWidth * scale;
+				for(int64_t i = int64_t(std::ceil(center - radius)); double(i) <= center + radius; ++i)
+				{
+					const double weight = Kaiser((double(i) - center) / scale);
+					if(weight != 0.0)
+						list.push_back({ i, weight });
+				}
+			}
+
+			double sum = 0.0;
+			for(const Tap& tap : list)
+				sum += tap.Weight;
+			for(Tap& tap : list)
+			{
+				tap.Weight /= sum;
+				tap.Index = address == Address::Wrap ?
+					((tap.Index % int64_t(src)) + int64_t(src)) % int64_t(src) :
+					(std::min)((std::max)(tap.Index, int64_t(0)), int64_t(src) - 1);
+			}
+		}
+
+		axis.Size = dst;
+		axis.Taps = 0;
+		for(const std::vector<Tap>& list : taps)
+			axis.Taps = (std::max)(axis.Taps, uint32_t(list.size()));
+		axis.Pairs = filter == Filter::Box && src == dst * 2;
+
+		axis.Index.assign(size_t(axis.Taps) * dst, 0);
+		axis.Weight.assign(size_t(axis.Taps) * dst, 0.0f);
+		for(uint32_t x = 0; x < dst; ++x)
+		{
+			for(uint32_t j = 0; j < axis.Taps; ++j)
+			{
+				const Tap& tap = j < taps[x].size() ? taps[x][j] : Tap{ taps[x][0].Index, 0.0 };
+				axis.Index[size_t(j) * dst + x] = int32_t(tap.Index);
+				axis.Weight[size_t(j) * dst + x] = float(tap.Weight);
+			}
+		}
+	}
+
+	//-----------------------------------------------------------------------------------
+	// Scalar path
+	//-----------------------------------------------------------------------------------
+
+	// acc[i] (+)= weight * value of element i of a source row, for i in [begin, end)
+	void AccumulateScalar(Format format, const uint8_t* src, float* acc, uint32_t begin, uint32_t end, float weight, bool first)
+	{
+		const Tables& tables = GetTables();
+
+		for(uint32_t i = begin; i < end; ++i)
+		{
+			float v;
+			switch(format)
+			{
+			case Format::RGBA8:
+				v = float(src[i]) * (1.0f / 255.0f);
+				break;
+			case Format::RGBA8Srgb:
+				v = tables.ToLinear[(i & 3) * 256 + src[i]];
+				break;
+			case Format::RGBA16F:
+			{
+				uint16_t h;
+				std::memcpy(&h, src + size_t(i) * 2, 2);
+				v = HalfToFloat(h);
+				break;
+			}
+			default:
+				std::memcpy(&v, src + size_t(i) * 4, 4);
+				break;
+			}
+
+			acc[i] = first ? v * weight : acc[i] + v * weight;
+		}
+	}
+
+	// Outputs [begin, end) of a row
+	void HorizontalScalar(const float* acc, float* out, const Axis& axis, uint32_t channels, uint32_t begin, uint32_t end)
+	{
+		for(uint32_t x = begin; x < end; ++x)
+		{
+			for(uint32_t c = 0; c < channels; ++c)
+			{
+				float sum;
+				if(axis.Pairs)
+					sum = (acc[(2 * x) * channels + c] + acc[(2 * x + 1) * channels + c]) * 0.5f;
+				else
+				{
+					sum = axis.Weight[x] * acc[axis.Index[x] * channels + c];
+					for(uint32_t j = 1; j < axis.Taps; ++j)
+					{
+						const size_t tap = size_t(j) * axis.Size + x;
+						sum = sum + axis.Weight[tap] * acc[axis.Index[tap] * channels + c];
+					}
+				}
+				out[x * channels + c] = sum;
+			}
+		}
+	}
+
+	void EncodeScalar(Format format, const float* out, uint8_t* dst, uint32_t begin, uint32_t end)
+	{
+		const Tables& tables = GetTables();
+
+		for(uint32_t i = begin; i < end; ++i)
+		{
+			switch(format)
+			{
+			case Format::RGBA8:
+			case Format::RGBA8Srgb:
+			{
+				const float v = (std::min)((std::max)(out[i], 0.0f), 1.0f);
+				if(format == Format::RGBA8Srgb && (i & 3) != 3)
+					dst[i] = tables.ToSrgb[int32_t(v * 65535.0f + 0.5f)];
+				else
+					dst[i] = uint8_t(int32_t(v * 255.0f + 0.5f));
+				break;
+			}
+			case Format::RGBA16F:
+			{
+				const uint16_t h = FloatToHalf(out[i]);
+				std::memcpy(dst + size_t(i) * 2, &h, 2);
+				break;
+			}
+			default:
+				std::memcpy(dst + size_t(i) * 4, &out[i], 4);
+				break;
+			}
+		}
+	}
+
+	//-----------------------------------------------------------------------------------
+	// AVX2 path: same operations in the same order, eight floats at a time
+	//-----------------------------------------------------------------------------------
+
+#if MIP_GENERATOR_X86
+	MIP_GENERATOR_AVX2_TARGET void AccumulateAvx2(Format format, const uint8_t* src, float* acc, uint32_t count, float weight, bool first)
+	{
+		const Tables& tables = GetTables();
+		const __m256 w = _mm256_set1_ps(weight);
+		const __m256 unorm = _mm256_set1_ps(1.0f / 255.0f);
+		const __m256i channelBase = _mm256_setr_epi32(0, 256, 512, 768, 0, 256, 512, 768);
+
+		uint32_t i = 0;
+		for(; i + 8 <= count; i += 8)
+		{
+			__m256 v;
+			switch(format)
+			{
+			case Format::RGBA8:
+				v = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i)))), unorm);
+				break;
+			case Format::RGBA8Srgb:
+			{
+				const __m256i bytes = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i)));
+				v = _mm256_i32gather_ps(tables.ToLinear, _mm256_add_epi32(bytes, channelBase), 4);
+				break;
+			}
+			case Format::RGBA16F:
+				v = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + size_t(i) * 2)));
+				break;
+			default:
+				v = _mm256_loadu_ps(reinterpret_cast<const float*>(src + size_t(i) * 4));
+				break;
+			}
+
+			const __m256 weighted = _mm256_mul_ps(v, w);
+			_mm256_storeu_ps(acc + i, first ? weighted : _mm256_add_ps(_mm256_loadu_ps(acc + i), weighted));
+		}
+
+		AccumulateScalar(format, src, acc, i, count, weight, first);
+	}
+
+	MIP_GENERATOR_AVX2_TARGET void HorizontalAvx2(const float* acc, float* out, const Axis& axis, uint32_t channels, uint32_t count)
+	{
+		const __m256 half = _mm256_set1_ps(0.5f);
+		uint32_t x = 0;
+
+		if(axis.Pairs && channels == 4)
+		{
+			// Two output texels: (p0 + p1, p2 + p3)
+			for(; x + 2 <= count; x += 2)
+			{
+				const __m256 a = _mm256_loadu_ps(acc + x * 8);
+				const __m256 b = _mm256_loadu_ps(acc + x * 8 + 8);
+				const __m256 sum = _mm256_add_ps(_mm256_permute2f128_ps(a, b, 0x20), _mm256_permute2f128_ps(a, b, 0x31));
+				_mm256_storeu_ps(out + x * 4, _mm256_mul_ps(sum, half));
+			}
+		}
+		else if(axis.Pairs)
+		{
+			for(; x + 8 <= count; x += 8)
+			{
+				const __m256 a = _mm256_loadu_ps(acc + x * 2);
+				const __m256 b = _mm256_loadu_ps(acc + x * 2 + 8);
+				const __m256d sums = _mm256_castps_pd(_mm256_hadd_ps(a, b));
+				const __m256 ordered = _mm256_castpd_ps(_mm256_permute4x64_pd(sums, _MM_SHUFFLE(3, 1, 2, 0)));
+				_mm256_storeu_ps(out + x, _mm256_mul_ps(ordered, half));
+			}
+		}
+		else if(channels == 4)
+		{
+			for(; x < count; ++x)
+			{
+				__m128 sum = _mm_mul_ps(_mm_set1_ps(axis.Weight[x]), _mm_loadu_ps(acc + axis.Index[x] * 4));
+				for(uint32_t j = 1; j < axis.Taps; ++j)
+				{
+					const size_t tap = size_t(j) * axis.Size + x;
+					sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(axis.Weight[tap]), _mm_loadu_ps(acc + axis.Index[tap] * 4)));
+				}
+				_mm_storeu_ps(out + x * 4, sum);
+			}
+		}
+		else
+		{
+			// Eight outputs at once, gathering each tap
+			for(; x + 8 <= count; x += 8)
+			{
+				__m256 sum = _mm256_mul_ps(_mm256_loadu_ps(&axis.Weight[x]),
+					_mm256_i32gather_ps(acc, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&axis.Index[x])), 4));
+				for(uint32_t j = 1; j < axis.Taps; ++j)
+				{
+					const size_t tap = size_t(j) * axis.Size + x;
+					const __m256 v = _mm256_i32gather_ps(acc, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&axis.Index[tap])), 4);
+					sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(&axis.Weight[tap]), v));
+				}
+				_mm256_storeu_ps(out + x, sum);
+			}
+		}
+
+		HorizontalScalar(acc, out, axis, channels, x, count);
+	}
+
+	// Eight ints in [0, 255] to eight bytes
+	MIP_GENERATOR_AVX2_TARGET inline void StoreBytes(uint8_t* dst, __m256i v)
+	{
+		const __m256i words = _mm256_packus_epi32(v, v);
+		const __m256i bytes = _mm256_packus_epi16(words, words);
+		const __m256i packed = _mm256_permutevar8x32_epi32(bytes, _mm256_setr_epi32(0, 4, 0, 4, 0, 4, 0, 4));
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(dst), _mm256_castsi256_si128(packed));
+	}
+
+	MIP_GENERATOR_AVX2_TARGET void EncodeAvx2(Format format, const float* out, uint8_t* dst, uint32_t count)
+	{
+		const Tables& tables = GetTables();
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 one = _mm256_set1_ps(1.0f);
+		const __m256 half = _mm256_set1_ps(0.5f);
+		const __m256 unorm = _mm256_set1_ps(255.0f);
+		const __m256 quantize = _mm256_set1_ps(65535.0f);
+		const __m256i byteMask = _mm256_set1_epi32(0xFF);
+
+		uint32_t i = 0;
+		for(; i + 8 <= count; i += 8)
+		{
+			const __m256 v = _mm256_loadu_ps(out + i);
+
+			switch(format)
+			{
+			case Format::RGBA8:
+			case Format::RGBA8Srgb:
+			{
+				const __m256 clamped = _mm256_min_ps(_mm256_max_ps(v, zero), one);
+				__m256i bytes = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(clamped, unorm), half));
+				if(format == Format::RGBA8Srgb)
+				{
+					const __m256i index = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(clamped, quantize), half));
+					const __m256i srgb = _mm256_and_si256(_mm256_i32gather_epi32(reinterpret_cast<const int*>(tables.ToSrgb), index, 1), byteMask);
+					bytes = _mm256_blend_epi32(srgb, bytes, 0x88); // alpha stays linear
+				}
+				StoreBytes(dst + i, bytes);
+				break;
+			}
+			case Format::RGBA16F:
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + size_t(i) * 2), _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+				break;
+			default:
+				_mm256_storeu_ps(reinterpret_cast<float*>(dst + size_t(i) * 4), v);
+				break;
+			}
+		}
+
+		EncodeScalar(format, out, dst, i, count);
+	}
+#endif
+
+	void GenerateLevel(Format format, const Level& src, const Level& dst, const Options& options, bool avx2)
+	{
+		Axis columns;
+		Axis rows;
+		BuildAxis(src.Width, dst.Width, options.Kernel, options.Edges, columns);
+		BuildAxis(src.Height, dst.Height, options.Kernel, options.Edges, rows);
+
+		const uint32_t channels = Channels(format);
+		const uint32_t srcCount = src.Width * channels;
+		const uint32_t dstCount = dst.Width * channels;
+
+		auto generateRows = [&](uint32_t begin, uint32_t end)
+		{
+			std::vector<float> acc(srcCount);
+			std::vector<float> out(dstCount);
+
+			for(uint32_t y = begin; y < end; ++y)
+			{
+				for(uint32_t j = 0; j < rows.Taps; ++j)
+				{
+					const size_t tap = size_t(j) * rows.Size + y;
+					const float weight = rows.Weight[tap];
+					if(j > 0 && weight == 0.0f)
+						continue;
+
+					const uint8_t* row = src.Data + size_t(rows.Index[tap]) * src.RowPitch;
+#if MIP_GENERATOR_X86
+					if(avx2)
+					{
+						AccumulateAvx2(format, row, acc.data(), srcCount, weight, j == 0);
+						continue;
+					}
+#endif
+					AccumulateScalar(format, row, acc.data(), 0, srcCount, weight, j == 0);
+				}
+
+				uint8_t* target = dst.Data + size_t(y) * dst.RowPitch;
+#if MIP_GENERATOR_X86
+				if(avx2)
+				{
+					HorizontalAvx2(acc.data(), out.data(), columns, channels, dst.Width);
+					EncodeAvx2(format, out.data(), target, dstCount);
+					continue;
+				}
+#endif
+				HorizontalScalar(acc.data(), out.data(), columns, channels, 0, dst.Width);
+				EncodeScalar(format, out.data(), target, 0, dstCount);
+			}
+		};
+
+		if(options.Parallel)
+		{
+			// About 64K output floats per chunk
+			const uint32_t grain = (std::max)(1u, 65536u / dstCount);
+			JobSystem::ParallelFor(dst.Height, grain, generateRows);
+		}
+		else
+			generateRows(0, dst.Height);
+	}
+}
+
+uint32_t MipGenerator::BytesPerPixel(Format format)
+{
+	switch(format)
+	{
+	case Format::RGBA8:
+	case Format::RGBA8Srgb:
+	case Format::R32F:
+		return 4;
+	default:
+		return 8;
+	}
+}
+
+uint32_t MipGenerator::MipCount(uint32_t width, uint32_t height)
+{
+	uint32_t count = 1;
+	while(width > 1 || height > 1)
+	{
+		width = (std::max)(width >> 1, 1u);
+		height = (std::max)(height >> 1, 1u);
+		++count;
+	}
+	return count;
+}
+
+uint64_t MipGenerator::ChainBytes(Format format, uint32_t width, uint32_t height, uint32_t mipCount)
+{
+	uint64_t bytes = 0;
+	for(uint32_t mip = 0; mip < mipCount; ++mip)
+		bytes += uint64_t((std::max)(width >> mip, 1u)) * (std::max)(height >> mip, 1u) * BytesPerPixel(format);
+	return bytes;
+}
+
+void MipGenerator::PackedChain(Format format, uint32_t width, uint32_t height, uint32_t mipCount, uint8_t* data, std::vector<Level>& levels)
+{
+	levels.clear();
+	for(uint32_t mip = 0; mip < mipCount; ++mip)
+	{
+		Level level;
+		level.Data = data;
+		level.Width = (std::max)(width >> mip, 1u);
+		level.Height = (std::max)(height >> mip, 1u);
+		level.RowPitch = uint64_t(level.Width) * BytesPerPixel(format);
+		levels.push_back(level);
+
+		data += level.RowPitch * level.Height;
+	}
+}
+
+bool MipGenerator::UsesAvx2()
+{
+	return CpuHasAvx2() && gAvx2Enabled.load(std::memory_order_relaxed);
+}
+
+void MipGenerator::SetAvx2Enabled(bool enabled)
+{
+	gAvx2Enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void MipGenerator::Generate(Format format, const Level* levels, uint32_t count, const Options& options)
+{
+	PROFILE_ZONE("MipGenerator::Generate");
+
+	for(uint32_t mip = 1; mip < count; ++mip)
+	{
+		if(levels[mip].Width != (std::max)(levels[mip - 1].Width >> 1, 1u) ||
+			levels[mip].Height != (std::max)(levels[mip - 1].Height >> 1, 1u))
+			throw std::runtime_error("MipGenerator: level " + std::to_string(mip) + " has the wrong size");
+	}
+
+	const bool avx2 = UsesAvx2();
+	for(uint32_t mip = 1; mip < count; ++mip)
+		GenerateLevel(format, levels[mip - 1], levels[mip], options, avx2);
+}
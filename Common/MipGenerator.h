@@ -0,0 +1,82 @@
+//***************************************************************************************
+// MipGenerator.h
+//
+// Mip chain generation on the CPU, so mips can be baked at import time or while a
+// texture loads instead of on the GPU.  Each level is filtered from the one above it
+// with a separable kernel: every output row accumulates its source rows (vertical
+// taps), then the row is resampled horizontally.  Rows of a level are split across the
+// job system; levels run one after another.
+//
+// Filtering is done in linear light: sRGB texels are decoded through a table, and
+// encoded back through another, so dark-bright edges do not darken the way a plain
+// average of sRGB values does.  Alpha stays linear.
+//   -Box: area-weighted, 2x2 texels for even sizes and 3 for odd ones.
+//   -Kaiser: Kaiser-windowed sinc (width 3 output texels, alpha 4), sharper than the box
+//    without its aliasing; negative lobes are clamped for UNORM formats.
+//
+// AVX2 (with F16C) is used when the CPU has it; a scalar path with identical math and
+// rounding covers the rest, so both produce the same bytes.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace MipGenerator
+{
+	enum class Format
+	{
+		RGBA8,     // DXGI_FORMAT_R8G8B8A8_UNORM
+		RGBA8Srgb, // DXGI_FORMAT_R8G8B8A8_UNORM_SRGB
+		RGBA16F,   // DXGI_FORMAT_R16G16B16A16_FLOAT
+		R32F       // DXGI_FORMAT_R32_FLOAT
+	};
+
+	enum class Filter
+	{
+		Box,
+		Kaiser
+	};
+
+	enum class Address
+	{
+		Clamp,
+		Wrap // for tiling textures
+	};
+
+	struct Options
+	{
+		Filter Kernel = Filter::Box;
+		Address Edges = Address::Clamp;
+		bool Parallel = true; // split rows across the job system
+	};
+
+	struct Level
+	{
+		uint8_t* Data;
+		uint32_t Width;
+		uint32_t Height;
+		uint64_t RowPitch;
+	};
+
+	uint32_t BytesPerPixel(Format format);
+
+	// Levels down to 1 x 1.
+	uint32_t MipCount(uint32_t width, uint32_t height);
+
+	// Bytes of mipCount levels with tightly packed rows, and the levels of such a chain
+	// starting at data.
+	uint64_t ChainBytes(Format format, uint32_t width, uint32_t height, uint32_t mipCount);
+	void PackedChain(Format format, uint32_t width, uint32_t height, uint32_t mipCount, uint8_t* data, std::vector<Level>& levels);
+
+	// True if the CPU and OS support AVX2 and F16C and the AVX2 path is not disabled.
+	bool UsesAvx2();
+
+	// Forces the scalar path, e.g. to compare both in a benchmark.
+	void SetAvx2Enabled(bool enabled);
+
+	// Fills levels[1..count) from levels[0].  Level i must be max(1, width >> i) by
+	// max(1, height >> i).
+	void Generate(Format format, const Level* levels, uint32_t count, const Options& options = Options());
+}
@@ -0,0 +1,303 @@
+//***************************************************************************************
+// OcclusionBuffer.cpp
+//***************************************************************************************
+
+#include "OcclusionBuffer.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+	void TransformPoint(const float p[3], const BatchTransform::Float4x4& m, float out[4])
+	{
+		for(int c = 0; c < 4; ++c)
+			out[c] = p[0] * m.m[0][c] + p[1] * m.m[1][c] + p[2] * m.m[2][c] + m.m[3][c];
+	}
+}
+
+void OcclusionBuffer::Resize(uint32_t width, uint32_t height)
+{
+	mWidth = std::max(width, 1u);
+	mHeight = std::max(height, 1u);
+
+	mLevels.clear();
+
+	uint32_t w = mWidth;
+	uint32_t h = mHeight;
+	while(true)
+	{
+		mLevels.push_back({ w, h, std::vector<float>(size_t(w) * h, FLT_MAX) });
+		if(w == 1 && h == 1)
+			break;
+		w = (w + 1) / 2;
+		h = (h + 1) / 2;
+	}
+}
+
+void OcclusionBuffer::Begin(const BatchTransform::Float4x4& viewProj, float nearZ)
+{
+	if(mLevels.empty())
+		Resize(256, 128);
+
+	mViewProj = viewProj;
+	mNearZ = nearZ;
+	mTriangles = 0;
+
+	std::fill(mLevels[0].Depth.begin(), mLevels[0].Depth.end(), FLT_MAX);
+}
+
+void OcclusionBuffer::RasterizeTriangles(const void* positions, size_t stride, const uint32_t* indices, size_t indexCount,
+	const BatchTransform::Float4x4& worldViewProj)
+{
+	PROFILE_ZONE("OcclusionBuffer::RasterizeTriangles");
+
+	const char* base = static_cast<const char*>(positions);
+
+	for(size_t i = 0; i + 2 < indexCount; i += 3)
+	{
+		float clip[3][4];
+		int inside = 0;
+
+		for(int k = 0; k < 3; ++k)
+		{
+			TransformPoint(reinterpret_cast<const float*>(base + indices[i + k] * stride), worldViewProj, clip[k]);
+			inside += clip[k][3] >= mNearZ ? 1 : 0;
+		}
+
+		if(inside == 0)
+			continue;
+
+		// Entirely to one side of the screen
+		bool outside = false;
+		for(int axis = 0; axis < 2 && !outside; ++axis)
+		{
+			outside =
+				(clip[0][axis] > clip[0][3] && clip[1][axis] > clip[1][3] && clip[2][axis] > clip[2][3]) ||
+				(clip[0][axis] < -clip[0][3] && clip[1][axis] < -clip[1][3] && clip[2][axis] < -clip[2][3]);
+		}
+		if(outside)
+			continue;
+
+		if(inside == 3)
+		{
+			RasterizeClipped(clip, 3);
+			continue;
+		}
+
+		// Sutherland-Hodgman against w = near: one triangle becomes at most a quad
+		float clipped[4][4];
+		int count = 0;
+		for(int k = 0; k < 3; ++k)
+		{
+			const float* a = clip[k];
+			const float* b = clip[(k + 1) % 3];
+			const bool aInside = a[3] >= mNearZ;
+			const bool bInside = b[3] >= mNearZ;
+
+			if(aInside)
+				std::copy(a, a + 4, clipped[count++]);
+
+			if(aInside != bInside)
+			{
+				const float t = (mNearZ - a[3]) / (b[3] - a[3]);
+				for(int c = 0; c < 4; ++c)
+					clipped[count][c] = a[c] + (b[c] - a[c]) * t;
+				clipped[count][3] = mNearZ;
+				++count;
+			}
+		}
+
+		RasterizeClipped(clipped, count);
+	}
+}
+
+void OcclusionBuffer::RasterizeClipped(const float (*clip)[4], int count)
+{
+	// Screen x, y and 1 / w, which is linear in screen space
+	float screen[4][4];
+	for(int k = 0; k < count; ++k)
+	{
+		const float invW = 1.0f / clip[k][3];
+		screen[k][0] = (clip[k][0] * invW * 0.5f + 0.5f) * mWidth;
+		screen[k][1] = (0.5f - clip[k][1] * invW * 0.5f) * mHeight;
+		screen[k][2] = 0.0f;
+		screen[k][3] = invW;
+	}
+
+	for(int k = 1; k + 1 < count; ++k)
+		RasterizeTriangle(screen[0], screen[k], screen[k + 1]);
+}
+
+void OcclusionBuffer::RasterizeTriangle(const float a[4], const float b[4], const float c[4])
+{
+	float area = (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+	if(area == 0.0f || !std::isfinite(area))
+		return;
+
+	// Two-sided: bring every triangle to the same winding
+	if(area < 0.0f)
+	{
+		std::swap(b, c);
+		area = -area;
+	}
+
+	const float minX = std::min({ a[0], b[0], c[0] });
+	const float maxX = std::max({ a[0], b[0], c[0] });
+	const float minY = std::min({ a[1], b[1], c[1] });
+	const float maxY = std::max({ a[1], b[1], c[1] });
+
+	// Pixels whose centers the triangle covers
+	const int x0 = std::max(static_cast<int>(std::ceil(minX - 0.5f)), 0);
+	const int x1 = std::min(static_cast<int>(std::floor(maxX - 0.5f)), static_cast<int>(mWidth) - 1);
+	const int y0 = std::max(static_cast<int>(std::ceil(minY - 0.5f)), 0);
+	const int y1 = std::min(static_cast<int>(std::floor(maxY - 0.5f)), static_cast<int>(mHeight) - 1);
+	if(x0 > x1 || y0 > y1)
+		return;
+
+	++mTriangles;
+
+	// Edge functions e(x, y) = A * x + B * y + C, positive inside; edge k faces vertex k
+	const float* v[3] = { a, b, c };
+	float A[3], B[3], C[3];
+	for(int k = 0; k < 3; ++k)
+	{
+		const float* p = v[(k + 1) % 3];
+		const float* q = v[(k + 2) % 3];
+		A[k] = p[1] - q[1];
+		B[k] = q[0] - p[0];
+		C[k] = p[0] * q[1] - p[1] * q[0];
+	}
+
+	const float invArea = 1.0f / area;
+	float* depth = mLevels[0].Depth.data();
+
+	for(int y = y0; y <= y1; ++y)
+	{
+		const float py = y + 0.5f;
+		const float px = x0 + 0.5f;
+
+		float e[3];
+		for(int k = 0; k < 3; ++k)
+			e[k] = A[k] * px + B[k] * py + C[k];
+
+		float* row = depth + size_t(y) * mWidth;
+
+		for(int x = x0; x <= x1; ++x)
+		{
+			if(e[0] >= 0.0f && e[1] >= 0.0f && e[2] >= 0.0f)
+			{
+				const float invW = (e[0] * a[3] + e[1] * b[3] + e[2] * c[3]) * invArea;
+				const float w = 1.0f / invW;
+				if(w < row[x])
+					row[x] = w;
+			}
+
+			e[0] += A[0];
+			e[1] += A[1];
+			e[2] += A[2];
+		}
+	}
+}
+
+void OcclusionBuffer::Finish()
+{
+	PROFILE_ZONE("OcclusionBuffer::Finish");
+
+	for(size_t l = 1; l < mLevels.size(); ++l)
+	{
+		const Level& src = mLevels[l - 1];
+		Level& dst = mLevels[l];
+
+		for(uint32_t y = 0; y < dst.Height; ++y)
+		{
+			const uint32_t sy0 = y * 2;
+			const uint32_t sy1 = std::min(sy0 + 1, src.Height - 1);
+
+			for(uint32_t x = 0; x < dst.Width; ++x)
+			{
+				const uint32_t sx0 = x * 2;
+				const uint32_t sx1 = std::min(sx0 + 1, src.Width - 1);
+
+				dst.Depth[size_t(y) * dst.Width + x] = std::max(
+					std::max(src.Depth[size_t(sy0) * src.Width + sx0], src.Depth[size_t(sy0) * src.Width + sx1]),
+					std::max(src.Depth[size_t(sy1) * src.Width + sx0], src.Depth[size_t(sy1) * src.Width + sx1]));
+			}
+		}
+	}
+}
+
+bool OcclusionBuffer::IsSphereOccluded(const float center[3], float radius, float margin) const
+{
+	if(mLevels.empty())
+		return false;
+
+	// w grows by |column 3| per unit of world distance (1 for a rigid view)
+	const float wScale = std::sqrt(mViewProj.m[0][3] * mViewProj.m[0][3] +
+		mViewProj.m[1][3] * mViewProj.m[1][3] + mViewProj.m[2][3] * mViewProj.m[2][3]);
+
+	float clip[4];
+	TransformPoint(center, mViewProj, clip);
+
+	const float nearest = clip[3] - radius * wScale;
+	if(nearest <= mNearZ)
+		return false;
+
+	// Screen rectangle of the sphere's bounding box
+	float minX = FLT_MAX, maxX = -FLT_MAX;
+	float minY = FLT_MAX, maxY = -FLT_MAX;
+	for(int corner = 0; corner < 8; ++corner)
+	{
+		const float p[3] = {
+			center[0] + ((corner & 1) ? radius : -radius),
+			center[1] + ((corner & 2) ? radius : -radius),
+			center[2] + ((corner & 4) ? radius : -radius) };
+
+		TransformPoint(p, mViewProj, clip);
+		if(clip[3] <= mNearZ)
+			return false;
+
+		const float sx = (clip[0] / clip[3] * 0.5f + 0.5f) * mWidth;
+		const float sy = (0.5f - clip[1] / clip[3] * 0.5f) * mHeight;
+		minX = std::min(minX, sx);
+		maxX = std::max(maxX, sx);
+		minY = std::min(minY, sy);
+		maxY = std::max(maxY, sy);
+	}
+
+	// Off screen: leave it to frustum culling
+	if(maxX < 0.0f || maxY < 0.0f || minX >= mWidth || minY >= mHeight)
+		return false;
+
+	int x0 = std::max(static_cast<int>(minX), 0);
+	int x1 = std::min(static_cast<int>(maxX), static_cast<int>(mWidth) - 1);
+	int y0 = std::max(static_cast<int>(minY), 0);
+	int y1 = std::min(static_cast<int>(maxY), static_cast<int>(mHeight) - 1);
+
+	// Coarsest level at which the rectangle still spans at most 4 x 4 texels
+	size_t level = 0;
+	while(level + 1 < mLevels.size() && (x1 - x0 >= 4 || y1 - y0 >= 4))
+	{
+		x0 >>= 1;
+		x1 >>= 1;
+		y0 >>= 1;
+		y1 >>= 1;
+		++level;
+	}
+
+	const Level& l = mLevels[level];
+	const float limit = nearest - margin;
+
+	for(int y = y0; y <= y1; ++y)
+	{
+		for(int x = x0; x <= x1; ++x)
+		{
+			if(l.Depth[size_t(y) * l.Width + x] >= limit)
+				return false;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,66 @@
+//***************************************************************************************
+// OcclusionBuffer.h
+//
+// Small software depth buffer for CPU occlusion culling.  A few large occluders are
+// rasterized at low resolution each frame; bounding spheres are then tested against a
+// max-depth pyramid built from it, so a query costs a handful of texel reads no matter
+// how big the sphere is on screen.
+//
+// Depth is the view-space distance (clip w), which lets callers pad tests with margins
+// in world units.  Matrices use the row-vector convention of BatchTransform and
+// DirectXMath (clip = [p, 1] * M) and a D3D-style projection whose w is view z.
+//***************************************************************************************
+
+#pragma once
+
+#include "BatchTransform.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class OcclusionBuffer
+{
+public:
+	void Resize(uint32_t width, uint32_t height);
+
+	uint32_t Width() const { return mWidth; }
+	uint32_t Height() const { return mHeight; }
+
+	// Starts a new frame: clears the depth and remembers the camera used by the queries.
+	void Begin(const BatchTransform::Float4x4& viewProj, float nearZ);
+
+	// positions: x, y, z at the start of each stride-byte vertex, transformed by
+	// world * viewProj.  Triangles are two-sided and clipped against the near plane.
+	void RasterizeTriangles(const void* positions, size_t stride, const uint32_t* indices, size_t indexCount,
+		const BatchTransform::Float4x4& worldViewProj);
+
+	// Builds the max-depth pyramid; call after the last occluder, before any query.
+	void Finish();
+
+	// True when the whole sphere (world space) lies behind the occluders by more than
+	// margin.  Spheres crossing the near plane are never occluded.
+	bool IsSphereOccluded(const float center[3], float radius, float margin = 0.0f) const;
+
+	uint64_t RasterizedTriangles() const { return mTriangles; }
+
+private:
+	void RasterizeClipped(const float (*clip)[4], int count);
+	void RasterizeTriangle(const float a[4], const float b[4], const float c[4]);
+
+	uint32_t mWidth = 0;
+	uint32_t mHeight = 0;
+
+	// Level 0 is the depth buffer itself; level k holds the max of 2^k x 2^k texels.
+	struct Level
+	{
+		uint32_t Width;
+		uint32_t Height;
+		std::vector<float> Depth;
+	};
+	std::vector<Level> mLevels;
+
+	BatchTransform::Float4x4 mViewProj = {};
+	float mNearZ = 0.1f;
+	uint64_t mTriangles = 0;
+};
@@ -0,0 +1,159 @@
+//***************************************************************************************
+// PipelineCache.cpp
+//***************************************************************************************
+
+#include "PipelineCache.h"
+#include "JobSystem.h"
+#include "Clock.h"
+#include "Profiler.h"
+
+#include <cstring>
+
+void PipelineCache::Hasher::Bytes(const void* data, size_t size)
+{
+	const uint64_t prime = 1099511628211ull;
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+	// Shader bytecode makes up most of a description: a word at a time, with a shift
+	// so high bits reach the low ones; FNV-1a for the tail
+	for(; size >= 8; size -= 8, bytes += 8)
+	{
+		uint64_t word;
+		std::memcpy(&word, bytes, sizeof(word));
+		mHash = (mHash ^ word) * prime;
+		mHash ^= mHash >> 29;
+	}
+	for(; size > 0; --size, ++bytes)
+		mHash = (mHash ^ *bytes) * prime;
+}
+
+void PipelineCache::Hasher::String(const char* text)
+{
+	if(text == nullptr)
+	{
+		Value(uint8_t(0));
+		return;
+	}
+
+	Value(uint8_t(1));
+	Bytes(text, std::strlen(text) + 1);
+}
+
+PipelineCache::~PipelineCache()
+{
+	WaitAll();
+}
+
+PipelineCache::Handle PipelineCache::Request(uint64_t key, Builder build, bool async)
+{
+	++mRequests;
+
+	const auto found = mByKey.find(key);
+	if(found != mByKey.end())
+		return found->second;
+
+	const Handle handle = static_cast<Handle>(mEntries.size());
+	const std::shared_ptr<Entry> entry = std::make_shared<Entry>();
+	mEntries.push_back(entry);
+	entry->Key = key;
+	entry->Self = handle;
+	entry->Build = std::move(build);
+	mByKey.emplace(key, handle);
+
+	if(async)
+	{
+		std::shared_ptr<Signal> signal = mSignal;
+		JobSystem::Submit([entry, signal]() { Run(*entry, *signal); });
+	}
+	else
+		Run(*entry, *mSignal);
+
+	return handle;
+}
+
+PipelineCache::Handle PipelineCache::Find(uint64_t key) const
+{
+	const auto found = mByKey.find(key);
+	return found != mByKey.end() ? found->second : InvalidHandle;
+}
+
+bool PipelineCache::Run(Entry& entry, Signal& signal)
+{
+	uint8_t expected = static_cast<uint8_t>(State::Queued);
+	if(!entry.Status.compare_exchange_strong(expected, static_cast<uint8_t>(State::Building)))
+		return false;
+
+	PROFILE_ZONE("PipelineCache::Build");
+
+	const int64_t start = Clock::Now();
+	State result = State::Ready;
+	try
+	{
+		entry.Build(entry.Self);
+	}
+	catch(...)
+	{
+		entry.Error = std::current_exception();
+		result = State::Failed;
+	}
+	entry.Seconds = Clock::ToSeconds(Clock::Now() - start);
+	entry.Build = nullptr; // whatever the builder captured is not needed any more
+
+	{
+		std::lock_guard<std::mutex> lock(signal.Mutex);
+		entry.Status.store(static_cast<uint8_t>(result));
+	}
+	signal.Finished.notify_all();
+	return true;
+}
+
+void PipelineCache::Wait(Handle handle)
+{
+	Entry& entry = *mEntries[handle];
+
+	if(Run(entry, *mSignal))
+		entry.Inline = true;
+	else
+	{
+		std::unique_lock<std::mutex> lock(mSignal->Mutex);
+		mSignal->Finished.wait(lock, [&]() { return entry.Status.load() >= static_cast<uint8_t>(State::Ready); });
+	}
+
+	if(entry.Error)
+		std::rethrow_exception(entry.Error);
+}
+
+void PipelineCache::WaitAll()
+{
+	for(const auto& entry : mEntries)
+	{
+		try
+		{
+			Wait(entry->Self);
+		}
+		catch(...)
+		{
+		}
+	}
+}
+
+PipelineCache::Stats PipelineCache::GetStats() const
+{
+	Stats stats;
+	stats.Requests = mRequests;
+	stats.Deduplicated = mRequests - static_cast<uint32_t>(mEntries.size());
+
+	for(const auto& entry : mEntries)
+	{
+		const State state = static_cast<State>(entry->Status.load());
+		if(state != State::Ready && state != State::Failed)
+			continue;
+
+		stats.Built += state == State::Ready;
+		stats.Failed += state == State::Failed;
+		stats.BuiltInline += entry->Inline;
+		stats.BuildSeconds += entry->Seconds;
+	}
+
+	return stats;
+}
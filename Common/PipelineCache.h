@@ -0,0 +1,135 @@
+//***************************************************************************************
+// PipelineCache.h
+//
+// Deduplicated, asynchronous creation of pipeline state objects, keyed by a hash of
+// the description's contents.
+//
+//   -Key: Hasher streams the fields of a description into 64 bits.  It hashes what
+//    pointers point to, never the pointers, so equal descriptions built apart from
+//    each other (and in another run) get the same key.
+//   -Requests: the first request for a key gets a new handle and queues the build on
+//    the job system; every later one gets the same handle back, so permutations that
+//    collapse to one state are built once.
+//   -Waiting: Wait() on a build no worker has started yet runs it on the calling
+//    thread instead of queueing behind the others, so what the frame needs right now
+//    never waits for warm-up work.
+//
+// Nothing here touches Direct3D: the builder creates and stores the object for its
+// handle, so dedup and scheduling run as-is against a fake builder in tests.
+//***************************************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+class PipelineCache
+{
+public:
+	using Handle = uint32_t;
+	static constexpr Handle InvalidHandle = 0xFFFFFFFFu;
+
+	enum class State : uint8_t { Queued, Building, Ready, Failed };
+
+	class Hasher
+	{
+	public:
+		void Bytes(const void* data, size_t size);
+
+		// nullptr and "" hash differently
+		void String(const char* text);
+
+		// For types without padding; structs with padding go field by field.
+		template<typename T>
+		void Value(const T& value)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "Hasher::Value needs a plain type");
+			Bytes(&value, sizeof(value));
+		}
+
+		uint64_t Get() const { return mHash; }
+
+	private:
+		uint64_t mHash = 14695981039346656037ull;
+	};
+
+	// Creates the object for handle and keeps it where the owner can find it; throws on
+	// failure.  Runs on a worker thread, or inline in Wait() or a synchronous Request().
+	using Builder = std::function<void(Handle handle)>;
+
+	struct Stats
+	{
+		uint32_t Requests = 0;
+		uint32_t Deduplicated = 0; // requests answered with an existing handle
+		uint32_t Built = 0;
+		uint32_t Failed = 0;
+		uint32_t BuiltInline = 0;  // taken over by Wait() before a worker got to them
+		double BuildSeconds = 0.0; // summed over builds, not wall time
+	};
+
+	PipelineCache() = default;
+	~PipelineCache();
+
+	PipelineCache(const PipelineCache&) = delete;
+	PipelineCache& operator=(const PipelineCache&) = delete;
+
+	// Handle for key; build is called only when the key is new.  With async false the
+	// build runs before Request returns (its exception is kept for Wait(), not thrown).
+	// Request and Wait are for one thread; builds may run on any.
+	Handle Request(uint64_t key, Builder build, bool async = true);
+
+	// Handle of a key requested before, or InvalidHandle.
+	Handle Find(uint64_t key) const;
+
+	State GetState(Handle handle) const { return static_cast<State>(mEntries[handle]->Status.load()); }
+	bool IsReady(Handle handle) const { return GetState(handle) == State::Ready; }
+	uint64_t Key(Handle handle) const { return mEntries[handle]->Key; }
+
+	// Returns once the build has finished; rethrows its exception if it failed (and
+	// again on every later Wait).
+	void Wait(Handle handle);
+
+	// Waits for every build so far; failures are left for Wait() to report.
+	void WaitAll();
+
+	uint32_t Count() const { return static_cast<uint32_t>(mEntries.size()); }
+	Stats GetStats() const;
+
+private:
+	struct Entry
+	{
+		uint64_t Key = 0;
+		Handle Self = InvalidHandle;
+		Builder Build;
+		std::atomic<uint8_t> Status{ static_cast<uint8_t>(State::Queued) };
+		std::exception_ptr Error;
+		bool Inline = false;
+		double Seconds = 0.0;
+	};
+
+	struct Signal
+	{
+		std::mutex Mutex;
+		std::condition_variable Finished;
+	};
+
+	// Claims and runs the build; false if another thread claimed it first.
+	static bool Run(Entry& entry, Signal& signal);
+
+	// Shared with the queued jobs: a job that Wait() took over still runs, finds the
+	// build claimed and returns, possibly after the cache is gone
+	std::vector<std::shared_ptr<Entry>> mEntries;
+	std::shared_ptr<Signal> mSignal = std::make_shared<Signal>();
+
+	std::unordered_map<uint64_t, Handle> mByKey;
+	uint32_t mRequests = 0;
+};
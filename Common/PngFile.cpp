@@ -0,0 +1,829 @@
+//***************************************************************************************
+// PngFile.cpp
+//***************************************************************************************
+
+#include "PngFile.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+	const uint8_t Signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+
+	// Direct3D 12 cannot create anything larger (D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION).
+	const uint32_t MaxDimension = 16384;
+
+	[[noreturn]] void Fail(const std::string& what)
+	{
+		throw std::runtime_error("PngFile: " + what);
+	}
+
+	constexpr uint32_t ChunkType(char a, char b, char c, char d)
+	{
+		return (uint32_t(uint8_t(a)) << 24) | (uint32_t(uint8_t(b)) << 16) |
+			(uint32_t(uint8_t(c)) << 8) | uint32_t(uint8_t(d));
+	}
+
+	uint32_t ReadBE32(const uint8_t* p)
+	{
+		return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+	}
+
+	void WriteBE32(std::vector<uint8_t>& out, uint32_t value)
+	{
+		out.push_back(uint8_t(value >> 24));
+		out.push_back(uint8_t(value >> 16));
+		out.push_back(uint8_t(value >> 8));
+		out.push_back(uint8_t(value));
+	}
+
+	uint32_t Channels(uint32_t colorType)
+	{
+		switch(colorType)
+		{
+		case 0: return 1;
+		case 2: return 3;
+		case 3: return 1;
+		case 4: return 2;
+		case 6: return 4;
+		default: return 0;
+		}
+	}
+
+	// Walks the chunk list; the CRCs are not checked, as WIC does not by default either.
+	class ChunkReader
+	{
+	public:
+		ChunkReader(const uint8_t* data, size_t size) :
+			mData(data),
+			mSize(size)
+		{
+			if(!data || size < sizeof(Signature) || std::memcmp(data, Signature, sizeof(Signature)) != 0)
+				Fail("not a PNG file");
+
+			mPos = sizeof(Signature);
+		}
+
+		// False after IEND.
+		bool Next(uint32_t& type, const uint8_t*& chunk, uint32_t& length)
+		{
+			if(mEnded)
+				return false;
+
+			if(mSize - mPos < 12)
+				Fail("file is truncated");
+
+			length = ReadBE32(mData + mPos);
+			type = ReadBE32(mData + mPos + 4);
+			if(length > mSize - mPos - 12)
+				Fail("file is truncated");
+
+			chunk = mData + mPos + 8;
+			mPos += size_t(length) + 12;
+			mEnded = type == ChunkType('I', 'E', 'N', 'D');
+			return true;
+		}
+
+	private:
+		const uint8_t* mData;
+		size_t mSize;
+		size_t mPos = 0;
+		bool mEnded = false;
+	};
+
+	//-----------------------------------------------------------------------------------
+	// Inflate (RFC 1951)
+	//-----------------------------------------------------------------------------------
+
+	const uint16_t LengthBase[29] = {
+		3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+		35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const uint8_t LengthExtra[29] = {
+		0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+		3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	const uint16_t DistanceBase[30] = {
+		1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+		257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	const uint8_t DistanceExtra[30] = {
+		0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+		7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	// Canonical Huffman code.  Codes up to FastBits long resolve with one table lookup;
+	// longer ones walk the code lengths one bit at a time.
+	struct Huffman
+	{
+		static const uint32_t FastBits = 10;
+		static const uint32_t MaxBits = 15;
+
+		uint16_t Fast[1 << FastBits]; // symbol | length << 9, 0 if the code is longer
+		uint16_t Count[MaxBits + 1];
+		uint16_t Symbols[288];
+
+		void Build(const uint8_t* lengths, uint32_t count)
+		{
+			std::memset(Count, 0, sizeof(Count));
+			for(uint32_t i = 0; i < count; ++i)
+				++Count[lengths[i]];
+			Count[0] = 0;
+
+			// Incomplete codes are legal (a single distance code is common); only
+			// over-subscribed ones are not.
+			int32_t left = 1;
+			uint16_t offsets[MaxBits + 2] = {};
+			for(uint32_t len = 1; len <= MaxBits; ++len)
+			{
+				left = (left << 1) - Count[len];
+				if(left < 0)
+					Fail("invalid Huffman code");
+				offsets[len + 1] = uint16_t(offsets[len] + Count[len]);
+			}
+
+			for(uint32_t i = 0; i < count; ++i)
+			{
+				if(lengths[i])
+					Symbols[offsets[lengths[i]]++] = uint16_t(i);
+			}
+
+			// Codes are assigned in (length, symbol) order, which is the order of Symbols;
+			// the stream stores them most significant bit first, so the table index is the
+			// code reversed.
+			std::memset(Fast, 0, sizeof(Fast));
+			uint32_t code = 0;
+			uint32_t index = 0;
+			for(uint32_t len = 1; len <= FastBits; ++len)
+			{
+				for(uint32_t i = 0; i < Count[len]; ++i, ++index, ++code)
+				{
+					uint32_t reversed = 0;
+					for(uint32_t bit = 0; bit < len; ++bit)
+						reversed |= ((code >> bit) & 1) << (len - 1 - bit);
+
+					const uint16_t entry = uint16_t(Symbols[index] | (len << 9));
+					for(uint32_t fill = reversed; fill < (1u << FastBits); fill += 1u << len)
+						Fast[fill] = entry;
+				}
+				code <<= 1;
+			}
+		}
+	};
+
+	class Inflater
+	{
+	public:
+		Inflater(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize) :
+			mSrc(src),
+			mSrcSize(srcSize),
+			mDst(dst),
+			mDstSize(dstSize)
+		{
+		}
+
+		// zlib stream (RFC 1950).  The Adler-32 checksum is not verified.
+		void Run()
+		{
+			const uint32_t cmf = Bits(8);
+			const uint32_t flg = Bits(8);
+			if((cmf & 15) != 8 || (cmf >> 4) > 7 || ((cmf << 8) | flg) % 31 != 0 || (flg & 32))
+				Fail("unsupported zlib stream");
+
+			bool last = false;
+			while(!last)
+			{
+				last = Bits(1) != 0;
+
+				switch(Bits(2))
+				{
+				case 0: Stored(); break;
+				case 1: Fixed(); break;
+				case 2: Dynamic(); break;
+				default: Fail("invalid deflate block");
+				}
+
+				if(Overrun())
+					Fail("image data is truncated");
+			}
+
+			if(mOut != mDstSize)
+				Fail("image data is too short");
+		}
+
+	private:
+		void Refill()
+		{
+			while(mCount <= 56)
+			{
+				const uint64_t byte = mPos < mSrcSize ? mSrc[mPos] : 0;
+				++mPos;
+				mBits |= byte << mCount;
+				mCount += 8;
+			}
+		}
+
+		uint32_t Bits(uint32_t n)
+		{
+			if(mCount < n)
+				Refill();
+
+			const uint32_t value = uint32_t(mBits & ((uint64_t(1) << n) - 1));
+			mBits >>= n;
+			mCount -= n;
+			return value;
+		}
+
+		// Past the end of the input, Refill feeds zeros; this tells whether any were used.
+		bool Overrun() const
+		{
+			return mPos * 8 - mCount > uint64_t(mSrcSize) * 8;
+		}
+
+		uint32_t Decode(const Huffman& huffman)
+		{
+			if(mCount < Huffman::MaxBits)
+				Refill();
+
+			const uint16_t entry = huffman.Fast[mBits & ((1u << Huffman::FastBits) - 1)];
+			if(entry)
+			{
+				const uint32_t len = entry >> 9;
+				mBits >>= len;
+				mCount -= len;
+				return entry & 511;
+			}
+
+			int32_t code = 0;
+			int32_t first = 0;
+			int32_t index = 0;
+			for(uint32_t len = 1; len <= Huffman::MaxBits; ++len)
+			{
+				code |= int32_t((mBits >> (len - 1)) & 1);
+				const int32_t count = huffman.Count[len];
+				if(code - first < count)
+				{
+					mBits >>= len;
+					mCount -= len;
+					return huffman.Symbols[index + code - first];
+				}
+
+				index += count;
+				first = (first + count) << 1;
+				code <<= 1;
+			}
+
+			Fail("invalid Huffman code in image data");
+		}
+
+		void Stored()
+		{
+			Bits(mCount & 7);
+
+			const uint32_t length = Bits(16);
+			if((length ^ 0xFFFF) != Bits(16))
+				Fail("invalid stored block");
+			if(length > mDstSize - mOut)
+				Fail("image data is too long");
+
+			for(uint32_t i = 0; i < length; ++i)
+				mDst[mOut++] = uint8_t(Bits(8));
+		}
+
+		void Fixed()
+		{
+			uint8_t lengths[288 + 30];
+			std::fill(lengths, lengths + 144, uint8_t(8));
+			std::fill(lengths + 144, lengths + 256, uint8_t(9));
+			std::fill(lengths + 256, lengths + 280, uint8_t(7));
+			std::fill(lengths + 280, lengths + 288, uint8_t(8));
+			std::fill(lengths + 288, lengths + 318, uint8_t(5));
+
+			mLiterals.Build(lengths, 288);
+			mDistances.Build(lengths + 288, 30);
+			Codes();
+		}
+
+		void Dynamic()
+		{
+			static const uint8_t order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+			const uint32_t literalCount = Bits(5) + 257;
+			const uint32_t distanceCount = Bits(5) + 1;
+			const uint32_t codeCount = Bits(4) + 4;
+			if(literalCount > 286 || distanceCount > 30)
+				Fail("invalid deflate block");
+
+			uint8_t codeLengths[19] = {};
+			for(uint32_t i = 0; i < codeCount; ++i)
+				codeLengths[order[i]] = uint8_t(Bits(3));
+
+			Huffman& lengthCode = mLiterals;
+			lengthCode.Build(codeLengths, 19);
+
+			uint8_t lengths[286 + 30];
+			const uint32_t total = literalCount + distanceCount;
+			for(uint32_t i = 0; i < total;)
+			{
+				const uint32_t symbol = Decode(lengthCode);
+				if(symbol < 16)
+				{
+					lengths[i++] = uint8_t(symbol);
+					continue;
+				}
+
+				uint8_t value = 0;
+				uint32_t repeat;
+				if(symbol == 16)
+				{
+					if(i == 0)
+						Fail("invalid deflate block");
+					value = lengths[i - 1];
+					repeat = 3 + Bits(2);
+				}
+				else if(symbol == 17)
+					repeat = 3 + Bits(3);
+				else
+					repeat = 11 + Bits(7);
+
+				if(repeat > total - i)
+					Fail("invalid deflate block");
+				std::fill(lengths + i, lengths + i + repeat, value);
+				i += repeat;
+			}
+
+			if(lengths[256] == 0)
+				Fail("invalid deflate block");
+
+			mLiterals.Build(lengths, literalCount);
+			mDistances.Build(lengths + literalCount, distanceCount);
+			Codes();
+		}
+
+		void Codes()
+		{
+			for(;;)
+			{
+				uint32_t symbol = Decode(mLiterals);
+				if(symbol < 256)
+				{
+					if(mOut == mDstSize)
+						Fail("image data is too long");
+					mDst[mOut++] = uint8_t(symbol);
+					continue;
+				}
+
+				if(symbol == 256)
+					return;
+
+				symbol -= 257;
+				if(symbol >= 29)
+					Fail("invalid length code");
+				const size_t length = LengthBase[symbol] + Bits(LengthExtra[symbol]);
+
+				const uint32_t distanceSymbol = Decode(mDistances);
+				if(distanceSymbol >= 30)
+					Fail("invalid distance code");
+				const size_t distance = DistanceBase[distanceSymbol] + Bits(DistanceExtra[distanceSymbol]);
+
+				if(distance > mOut)
+					Fail("distance is too far back");
+				if(length > mDstSize - mOut)
+					Fail("image data is too long");
+
+				uint8_t* dst = mDst + mOut;
+				const uint8_t* src = dst - distance;
+				if(distance >= length)
+					std::memcpy(dst, src, length);
+				else
+				{
+					for(size_t i = 0; i < length; ++i)
+						dst[i] = src[i];
+				}
+				mOut += length;
+
+				// Garbage that decodes to valid codes ends here instead of at the output
+				// limit.
+				if(mPos > mSrcSize + 8 && Overrun())
+					Fail("image data is truncated");
+			}
+		}
+
+		const uint8_t* mSrc;
+		size_t mSrcSize;
+		size_t mPos = 0;
+		uint64_t mBits = 0;
+		uint32_t mCount = 0;
+
+		uint8_t* mDst;
+		size_t mDstSize;
+		size_t mOut = 0;
+
+		Huffman mLiterals;
+		Huffman mDistances;
+	};
+
+	//-----------------------------------------------------------------------------------
+	// Encoder helpers
+	//-----------------------------------------------------------------------------------
+
+	const uint32_t* CrcTable()
+	{
+		static const struct Table
+		{
+			uint32_t Values[256];
+
+			Table()
+			{
+				for(uint32_t n = 0; n < 256; ++n)
+				{
+					uint32_t c = n;
+					for(int k = 0; k < 8; ++k)
+						c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+					Values[n] = c;
+				}
+			}
+		} table;
+
+		return table.Values;
+	}
+
+	void WriteChunk(std::vector<uint8_t>& out, uint32_t type, const uint8_t* data, size_t size)
+	{
+		WriteBE32(out, static_cast<uint32_t>(size));
+		const size_t start = out.size();
+		WriteBE32(out, type);
+		out.insert(out.end(), data, data + size);
+
+		const uint32_t* table = CrcTable();
+		uint32_t crc = 0xFFFFFFFFu;
+		for(size_t i = start; i < out.size(); ++i)
+			crc = table[(crc ^ out[i]) & 0xFF] ^ (crc >> 8);
+		WriteBE32(out, crc ^ 0xFFFFFFFFu);
+	}
+
+	class BitWriter
+	{
+	public:
+		explicit BitWriter(std::vector<uint8_t>& out) :
+			mOut(out)
+		{
+		}
+
+		void Put(uint32_t value, uint32_t n)
+		{
+			mBits |= uint64_t(value) << mCount;
+			mCount += n;
+			while(mCount >= 8)
+			{
+				mOut.push_back(uint8_t(mBits));
+				mBits >>= 8;
+				mCount -= 8;
+			}
+		}
+
+		// Huffman codes go most significant bit first.
+		void PutCode(uint32_t code, uint32_t n)
+		{
+			uint32_t reversed = 0;
+			for(uint32_t bit = 0; bit < n; ++bit)
+				reversed |= ((code >> bit) & 1) << (n - 1 - bit);
+			Put(reversed, n);
+		}
+
+		void Flush()
+		{
+			if(mCount > 0)
+				Put(0, 8 - mCount);
+		}
+
+	private:
+		std::vector<uint8_t>& mOut;
+		uint64_t mBits = 0;
+		uint32_t mCount = 0;
+	};
+
+	void PutFixedLiteral(BitWriter& writer, uint32_t symbol)
+	{
+		if(symbol < 144)
+			writer.PutCode(0x30 + symbol, 8);
+		else if(symbol < 256)
+			writer.PutCode(0x190 + symbol - 144, 9);
+		else if(symbol < 280)
+			writer.PutCode(symbol - 256, 7);
+		else
+			writer.PutCode(0xC0 + symbol - 280, 8);
+	}
+
+	// One fixed-Huffman block with greedy single-probe LZ77 matching.
+	void Deflate(const uint8_t* data, size_t size, std::vector<uint8_t>& out)
+	{
+		const uint32_t HashBits = 15;
+		const size_t Window = 32768;
+
+		std::vector<int64_t> head(size_t(1) << HashBits, -1);
+		auto hash = [&](size_t i)
+		{
+			const uint32_t v = uint32_t(data[i]) | (uint32_t(data[i + 1]) << 8) | (uint32_t(data[i + 2]) << 16);
+			return (v * 2654435761u) >> (32 - HashBits);
+		};
+
+		BitWriter writer(out);
+		writer.Put(1, 1); // last block
+		writer.Put(1, 2); // fixed Huffman
+
+		size_t i = 0;
+		while(i < size)
+		{
+			size_t length = 0;
+			size_t distance = 0;
+
+			if(i + 3 <= size)
+			{
+				const uint32_t h = hash(i);
+				const int64_t candidate = head[h];
+				head[h] = int64_t(i);
+
+				if(candidate >= 0 && i - size_t(candidate) <= Window)
+				{
+					const size_t limit = (std::min)(size - i, size_t(258));
+					while(length < limit && data[size_t(candidate) + length] == data[i + length])
+						++length;
+					distance = i - size_t(candidate);
+				}
+			}
+
+			if(length < 3)
+			{
+				PutFixedLiteral(writer, data[i]);
+				++i;
+				continue;
+			}
+
+			uint32_t lengthSymbol = 28;
+			while(LengthBase[lengthSymbol] > length)
+				--lengthSymbol;
+			PutFixedLiteral(writer, 257 + lengthSymbol);
+			writer.Put(uint32_t(length - LengthBase[lengthSymbol]), LengthExtra[lengthSymbol]);
+
+			uint32_t distanceSymbol = 29;
+			while(DistanceBase[distanceSymbol] > distance)
+				--distanceSymbol;
+			writer.PutCode(distanceSymbol, 5);
+			writer.Put(uint32_t(distance - DistanceBase[distanceSymbol]), DistanceExtra[distanceSymbol]);
+
+			for(size_t j = i + 1; j < i + length && j + 3 <= size; ++j)
+				head[hash(j)] = int64_t(j);
+			i += length;
+		}
+
+		PutFixedLiteral(writer, 256);
+		writer.Flush();
+	}
+
+	uint8_t Paeth(int a, int b, int c)
+	{
+		const int p = a + b - c;
+		const int pa = std::abs(p - a);
+		const int pb = std::abs(p - b);
+		const int pc = std::abs(p - c);
+		if(pa <= pb && pa <= pc)
+			return uint8_t(a);
+		return uint8_t(pb <= pc ? b : c);
+	}
+}
+
+PngFile::Info PngFile::ReadInfo(const uint8_t* data, size_t size)
+{
+	ChunkReader reader(data, size);
+
+	Info info;
+	bool header = false;
+
+	uint32_t type;
+	const uint8_t* chunk;
+	uint32_t length;
+	while(reader.Next(type, chunk, length))
+	{
+		if(!header)
+		{
+			if(type != ChunkType('I', 'H', 'D', 'R') || length != 13)
+				Fail("missing IHDR chunk");
+
+			info.Width = ReadBE32(chunk);
+			info.Height = ReadBE32(chunk + 4);
+			info.ColorType = chunk[9];
+
+			if(info.Width == 0 || info.Height == 0 || info.Width > MaxDimension || info.Height > MaxDimension)
+				Fail("unsupported image size " + std::to_string(info.Width) + "x" + std::to_string(info.Height));
+			if(chunk[8] != 8)
+				Fail("only 8 bits per channel are supported");
+			if(Channels(info.ColorType) == 0)
+				Fail("invalid color type");
+			if(chunk[10] != 0 || chunk[11] != 0)
+				Fail("invalid compression or filter method");
+			if(chunk[12] != 0)
+				Fail("interlaced images are not supported");
+
+			header = true;
+		}
+		else if(type == ChunkType('s', 'R', 'G', 'B'))
+			info.SRGB = true;
+		else if(type == ChunkType('g', 'A', 'M', 'A') && length == 4)
+			info.SRGB = info.SRGB || ReadBE32(chunk) == 45455;
+		else if(type == ChunkType('I', 'D', 'A', 'T'))
+			return info;
+	}
+
+	Fail("no image data");
+}
+
+void PngFile::Decode(const uint8_t* data, size_t size, uint8_t* dst, size_t dstRowPitch)
+{
+	const Info info = ReadInfo(data, size);
+	const uint32_t channels = Channels(info.ColorType);
+	const size_t stride = size_t(info.Width) * channels;
+
+	// Palette and transparency
+	uint8_t palette[256][4] = {};
+	uint32_t paletteSize = 0;
+	bool colorKey = false;
+	uint8_t key[3] = {};
+
+	std::vector<uint8_t> compressed;
+
+	ChunkReader reader(data, size);
+	uint32_t type;
+	const uint8_t* chunk;
+	uint32_t length;
+	while(reader.Next(type, chunk, length))
+	{
+		if(type == ChunkType('P', 'L', 'T', 'E'))
+		{
+			if(length % 3 != 0 || length > 768)
+				Fail("invalid palette");
+
+			paletteSize = length / 3;
+			for(uint32_t i = 0; i < paletteSize; ++i)
+			{
+				palette[i][0] = chunk[i * 3];
+				palette[i][1] = chunk[i * 3 + 1];
+				palette[i][2] = chunk[i * 3 + 2];
+				palette[i][3] = 255;
+			}
+		}
+		else if(type == ChunkType('t', 'R', 'N', 'S'))
+		{
+			if(info.ColorType == 3)
+			{
+				for(uint32_t i = 0; i < (std::min)(length, paletteSize); ++i)
+					palette[i][3] = chunk[i];
+			}
+			else if(info.ColorType == 0 && length == 2)
+			{
+				colorKey = true;
+				key[0] = key[1] = key[2] = chunk[1];
+			}
+			else if(info.ColorType == 2 && length == 6)
+			{
+				colorKey = true;
+				key[0] = chunk[1];
+				key[1] = chunk[3];
+				key[2] = chunk[5];
+			}
+		}
+		else if(type == ChunkType('I', 'D', 'A', 'T'))
+			compressed.insert(compressed.end(), chunk, chunk + length);
+	}
+
+	if(info.ColorType == 3 && paletteSize == 0)
+		Fail("missing palette");
+
+	// Each row is a filter byte followed by the filtered pixels.
+	std::vector<uint8_t> raw(size_t(info.Height) * (stride + 1));
+	Inflater(compressed.data(), compressed.size(), raw.data(), raw.size()).Run();
+
+	std::vector<uint8_t> zeros(stride, 0);
+	const uint8_t* previous = zeros.data();
+
+	for(uint32_t y = 0; y < info.Height; ++y)
+	{
+		uint8_t* row = raw.data() + size_t(y) * (stride + 1);
+		const uint8_t filter = row[0];
+		uint8_t* cur = row + 1;
+
+		switch(filter)
+		{
+		case 0:
+			break;
+		case 1:
+			for(size_t i = channels; i < stride; ++i)
+				cur[i] = uint8_t(cur[i] + cur[i - channels]);
+			break;
+		case 2:
+			for(size_t i = 0; i < stride; ++i)
+				cur[i] = uint8_t(cur[i] + previous[i]);
+			break;
+		case 3:
+			for(size_t i = 0; i < channels; ++i)
+				cur[i] = uint8_t(cur[i] + (previous[i] >> 1));
+			for(size_t i = channels; i < stride; ++i)
+				cur[i] = uint8_t(cur[i] + ((cur[i - channels] + previous[i]) >> 1));
+			break;
+		case 4:
+			for(size_t i = 0; i < channels; ++i)
+				cur[i] = uint8_t(cur[i] + previous[i]);
+			for(size_t i = channels; i < stride; ++i)
+				cur[i] = uint8_t(cur[i] + Paeth(cur[i - channels], previous[i], previous[i - channels]));
+			break;
+		default:
+			Fail("invalid row filter");
+		}
+		previous = cur;
+
+		uint8_t* out = dst + size_t(y) * dstRowPitch;
+		switch(info.ColorType)
+		{
+		case 0:
+			for(uint32_t x = 0; x < info.Width; ++x, out += 4)
+			{
+				out[0] = out[1] = out[2] = cur[x];
+				out[3] = colorKey && cur[x] == key[0] ? 0 : 255;
+			}
+			break;
+		case 2:
+			for(uint32_t x = 0; x < info.Width; ++x, out += 4, cur += 3)
+			{
+				out[0] = cur[0];
+				out[1] = cur[1];
+				out[2] = cur[2];
+				out[3] = colorKey && cur[0] == key[0] && cur[1] == key[1] && cur[2] == key[2] ? 0 : 255;
+			}
+			break;
+		case 3:
+			for(uint32_t x = 0; x < info.Width; ++x, out += 4)
+			{
+				if(cur[x] >= paletteSize)
+					Fail("palette index out of range");
+				std::memcpy(out, palette[cur[x]], 4);
+			}
+			break;
+		case 4:
+			for(uint32_t x = 0; x < info.Width; ++x, out += 4, cur += 2)
+			{
+				out[0] = out[1] = out[2] = cur[0];
+				out[3] = cur[1];
+			}
+			break;
+		case 6:
+			std::memcpy(out, cur, stride);
+			break;
+		}
+	}
+}
+
+void PngFile::Encode(uint32_t width, uint32_t height, const uint8_t* rgba, size_t rowPitch, std::vector<uint8_t>& out)
+{
+	out.insert(out.end(), Signature, Signature + sizeof(Signature));
+
+	uint8_t header[13];
+	header[0] = uint8_t(width >> 24);
+	header[1] = uint8_t(width >> 16);
+	header[2] = uint8_t(width >> 8);
+	header[3] = uint8_t(width);
+	header[4] = uint8_t(height >> 24);
+	header[5] = uint8_t(height >> 16);
+	header[6] = uint8_t(height >> 8);
+	header[7] = uint8_t(height);
+	header[8] = 8; // bits per channel
+	header[9] = 6; // RGBA
+	header[10] = header[11] = header[12] = 0;
+	WriteChunk(out, ChunkType('I', 'H', 'D', 'R'), header, sizeof(header));
+
+	// Sub filter on every row
+	const size_t stride = size_t(width) * 4;
+	std::vector<uint8_t> raw(size_t(height) * (stride + 1));
+	for(uint32_t y = 0; y < height; ++y)
+	{
+		const uint8_t* src = rgba + size_t(y) * rowPitch;
+		uint8_t* row = raw.data() + size_t(y) * (stride + 1);
+		row[0] = 1;
+		for(size_t i = 0; i < stride; ++i)
+			row[1 + i] = uint8_t(src[i] - (i >= 4 ? src[i - 4] : 0));
+	}
+
+	std::vector<uint8_t> stream = { 0x78, 0x01 };
+	Deflate(raw.data(), raw.size(), stream);
+
+	uint32_t a = 1;
+	uint32_t b = 0;
+	for(uint8_t byte : raw)
+	{
+		a = (a + byte) % 65521;
+		b = (b + a) % 65521;
+	}
+	WriteBE32(stream, (b << 16) | a);
+
+	WriteChunk(out, ChunkType('I', 'D', 'A', 'T'), stream.data(), stream.size());
+	WriteChunk(out, ChunkType('I', 'E', 'N', 'D'), nullptr, 0);
+}
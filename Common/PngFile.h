@@ -0,0 +1,42 @@
+//***************************************************************************************
+// PngFile.h
+//
+// Small PNG codec without Windows dependencies, used as the portable decode backend
+// of TextureDecodeQueue.  Decodes non-interlaced PNGs with 8 bits per channel (gray,
+// gray + alpha, RGB, RGBA and palette, with tRNS transparency) straight to RGBA8 in
+// memory the caller provides, so the decoded image can go to a bounded staging area.
+// Other layouts (16-bit, interlaced, 1/2/4-bit palettes) are rejected; WIC or a DDS
+// conversion handles those.
+//
+// Encode() writes RGBA8 images with fixed-Huffman deflate.  It exists to generate
+// benchmark data and compresses far worse than a real encoder.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class PngFile
+{
+public:
+	struct Info
+	{
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		uint32_t ColorType = 0; // 0 gray, 2 RGB, 3 palette, 4 gray + alpha, 6 RGBA
+		bool SRGB = false;      // sRGB chunk, or gAMA of 1/2.2
+	};
+
+	// Reads the chunks before the image data.  Throws std::runtime_error if the data is
+	// not a PNG or uses a layout Decode() does not support.
+	static Info ReadInfo(const uint8_t* data, size_t size);
+
+	// Decodes to RGBA8 rows of Width * 4 bytes, dstRowPitch apart.  Throws
+	// std::runtime_error on malformed or truncated data.
+	static void Decode(const uint8_t* data, size_t size, uint8_t* dst, size_t dstRowPitch);
+
+	// Appends a PNG of an RGBA8 image.
+	static void Encode(uint32_t width, uint32_t height, const uint8_t* rgba, size_t rowPitch, std::vector<uint8_t>& out);
+};
@@ -0,0 +1,216 @@
+//***************************************************************************************
+// Profiler.cpp
+//***************************************************************************************
+
+#include "Profiler.h"
+#include "Clock.h"
+
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+	// One ring entry.  Sequence is 2 * index + 2 once the event for that index is
+	// written and odd while the owner rewrites it, so a reader can tell a copy taken
+	// while the ring wrapped around from a whole one.  Relaxed atomics compile to
+	// plain moves.
+	struct Slot
+	{
+		std::atomic<uint64_t> Sequence{ 0 };
+		std::atomic<const char*> Name{ nullptr };
+		std::atomic<uint64_t> Begin{ 0 };
+		std::atomic<uint64_t> End{ 0 };
+	};
+
+	struct ThreadBuffer
+	{
+		// Only the owning thread writes Head and the slots; the exporter reads them
+		// with acquire semantics, so no lock is taken on the recording path.
+		std::atomic<uint64_t> Head{ 0 };
+		uint32_t ThreadId = 0;
+		std::string Name;
+		Slot Slots[Profiler::RingCapacity];
+	};
+
+	struct Registry
+	{
+		std::mutex Mutex;
+		std::vector<std::unique_ptr<ThreadBuffer>> Buffers;
+		std::atomic<bool> Enabled{ true };
+
+		// Exported timestamps are relative to this tick.
+		uint64_t BaseTicks = Profiler::Now();
+	};
+
+	Registry& GetRegistry()
+	{
+		static Registry registry;
+		return registry;
+	}
+
+	thread_local ThreadBuffer* tlsBuffer = nullptr;
+
+	ThreadBuffer* RegisterThread()
+	{
+		Registry& registry = GetRegistry();
+		std::lock_guard<std::mutex> lock(registry.Mutex);
+
+		auto buffer = std::make_unique<ThreadBuffer>();
+		buffer->ThreadId = static_cast<uint32_t>(registry.Buffers.size()) + 1;
+		buffer->Name = buffer->ThreadId == 1 ? "Main" : "Worker " + std::to_string(buffer->ThreadId - 1);
+
+		tlsBuffer = buffer.get();
+		registry.Buffers.push_back(std::move(buffer));
+		return tlsBuffer;
+	}
+
+	double TicksPerMicrosecond()
+	{
+		return Clock::TscTicksPerSecond() * 1e-6;
+	}
+
+	void WriteJsonString(std::ofstream& out, const char* s)
+	{
+		out << '"';
+		for(; s && *s; ++s)
+		{
+			if(*s == '"' || *s == '\\')
+				out << '\\';
+			out << *s;
+		}
+		out << '"';
+	}
+}
+
+uint64_t Profiler::Now()
+{
+	return Clock::ReadTsc();
+}
+
+double Profiler::TicksToMicroseconds(uint64_t ticks)
+{
+	return static_cast<double>(ticks) / TicksPerMicrosecond();
+}
+
+void Profiler::SetEnabled(bool enabled)
+{
+	GetRegistry().Enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool Profiler::IsEnabled()
+{
+	return GetRegistry().Enabled.load(std::memory_order_relaxed);
+}
+
+void Profiler::SetThreadName(const char* name)
+{
+	ThreadBuffer* buffer = tlsBuffer ? tlsBuffer : RegisterThread();
+
+	std::lock_guard<std::mutex> lock(GetRegistry().Mutex);
+	buffer->Name = name ? name : "";
+}
+
+void Profiler::Record(const char* name, uint64_t begin, uint64_t end)
+{
+	ThreadBuffer* buffer = tlsBuffer ? tlsBuffer : RegisterThread();
+
+	const uint64_t head = buffer->Head.load(std::memory_order_relaxed);
+	Slot& slot = buffer->Slots[head & (RingCapacity - 1)];
+
+	slot.Sequence.store(2 * head + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	slot.Name.store(name, std::memory_order_relaxed);
+	slot.Begin.store(begin, std::memory_order_relaxed);
+	slot.End.store(end, std::memory_order_relaxed);
+	slot.Sequence.store(2 * head + 2, std::memory_order_release);
+
+	buffer->Head.store(head + 1, std::memory_order_release);
+}
+
+void Profiler::Snapshot(std::vector<ThreadEvents>& threads)
+{
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.Mutex);
+
+	threads.resize(registry.Buffers.size());
+	for(size_t t = 0; t < registry.Buffers.size(); ++t)
+	{
+		const ThreadBuffer& buffer = *registry.Buffers[t];
+		ThreadEvents& thread = threads[t];
+		thread.ThreadId = buffer.ThreadId;
+		thread.Name = buffer.Name;
+		thread.Events.clear();
+
+		const uint64_t head = buffer.Head.load(std::memory_order_acquire);
+		const uint64_t count = head < RingCapacity ? head : RingCapacity;
+		thread.Events.reserve(static_cast<size_t>(count));
+
+		for(uint64_t i = head - count; i < head; ++i)
+		{
+			const Slot& slot = buffer.Slots[i & (RingCapacity - 1)];
+			const uint64_t sequence = 2 * i + 2;
+
+			// Already overwritten, or overwritten while it was being copied
+			if(slot.Sequence.load(std::memory_order_acquire) != sequence)
+				continue;
+
+			const ZoneEvent e{ slot.Name.load(std::memory_order_relaxed),
+				slot.Begin.load(std::memory_order_relaxed), slot.End.load(std::memory_order_relaxed) };
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if(slot.Sequence.load(std::memory_order_relaxed) != sequence)
+				continue;
+
+			thread.Events.push_back(e);
+		}
+	}
+}
+
+bool Profiler::ExportChromeTrace(const std::wstring& filename)
+{
+	std::ofstream out(std::filesystem::path(filename), std::ios::out | std::ios::trunc);
+	if(!out)
+		return false;
+
+	// Copy first: the rings keep wrapping while the file is written
+	std::vector<ThreadEvents> threads;
+	Snapshot(threads);
+
+	const uint64_t baseTicks = GetRegistry().BaseTicks;
+	const double ticksPerUs = TicksPerMicrosecond();
+
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Lab4\"}}";
+
+	char line[128];
+	for(const ThreadEvents& thread : threads)
+	{
+		out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.ThreadId << ",\"args\":{\"name\":";
+		WriteJsonString(out, thread.Name.c_str());
+		out << "}}";
+
+		for(const ZoneEvent& e : thread.Events)
+		{
+			// Events recorded before the registry was created would land at negative times.
+			if(e.Begin < baseTicks || e.End < e.Begin)
+				continue;
+
+			const double ts = static_cast<double>(e.Begin - baseTicks) / ticksPerUs;
+			const double dur = static_cast<double>(e.End - e.Begin) / ticksPerUs;
+
+			out << ",\n{\"name\":";
+			WriteJsonString(out, e.Name);
+			std::snprintf(line, sizeof(line), ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+				thread.ThreadId, ts, dur);
+			out << line;
+		}
+	}
+
+	out << "\n]}\n";
+	return static_cast<bool>(out);
+}
@@ -0,0 +1,99 @@
+//***************************************************************************************
+// Profiler.h
+//
+// Lightweight CPU zone profiler.  PROFILE_ZONE("name") records the begin/end
+// timestamps of the enclosing scope into a per-thread lock-free ring buffer.  The
+// most recent events of every thread can be exported as Chrome trace JSON, which
+// both chrome://tracing and ui.perfetto.dev open directly.
+//
+// Zone names must be string literals (or otherwise outlive the export), since
+// only the pointer is stored.  Define PROFILER_ENABLED=0 to compile every zone out.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+namespace Profiler
+{
+	// Events kept per thread.  Older events are overwritten, so a dump always
+	// holds the last few hundred frames leading up to the moment of the export.
+	constexpr uint32_t RingCapacity = 1u << 16;
+
+	struct ZoneEvent
+	{
+		const char* Name;
+		uint64_t Begin;
+		uint64_t End;
+	};
+
+	// Raw timestamp in profiler ticks (Clock::ReadTsc).  Cheap enough to be taken twice per zone.
+	uint64_t Now();
+
+	// Converts a tick delta to microseconds.
+	double TicksToMicroseconds(uint64_t ticks);
+
+	void SetEnabled(bool enabled);
+	bool IsEnabled();
+
+	// Names the calling thread in the exported trace.
+	void SetThreadName(const char* name);
+
+	// Appends a finished zone to the calling thread's ring.
+	void Record(const char* name, uint64_t begin, uint64_t end);
+
+	struct ThreadEvents
+	{
+		uint32_t ThreadId;
+		std::string Name;
+		std::vector<ZoneEvent> Events; // oldest first
+	};
+
+	// Copies the buffered events of all threads.  Threads keep recording meanwhile;
+	// events overwritten during the copy are left out rather than returned torn.
+	void Snapshot(std::vector<ThreadEvents>& threads);
+
+	// Writes the buffered events of all threads as Chrome trace JSON.
+	bool ExportChromeTrace(const std::wstring& filename);
+
+	class ScopedZone
+	{
+	public:
+		explicit ScopedZone(const char* name)
+			: mName(IsEnabled() ? name : nullptr), mBegin(mName ? Now() : 0)
+		{
+		}
+
+		~ScopedZone()
+		{
+			if(mName)
+				Record(mName, mBegin, Now());
+		}
+
+		ScopedZone(const ScopedZone&) = delete;
+		ScopedZone& operator=(const ScopedZone&) = delete;
+
+	private:
+		const char* mName;
+		uint64_t mBegin;
+	};
+}
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#if PROFILER_ENABLED
+#define PROFILE_ZONE(name) Profiler::ScopedZone PROFILE_CONCAT(profileZone_, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_ZONE(__FUNCTION__)
+#define PROFILE_THREAD_NAME(name) Profiler::SetThreadName(name)
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_FUNCTION() ((void)0)
+#define PROFILE_THREAD_NAME(name) ((void)0)
+#endif
@@ -0,0 +1,332 @@
+//***************************************************************************************
+// RenderWorld.cpp
+//***************************************************************************************
+
+#include "RenderWorld.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <stdexcept>
+
+using BatchTransform::Float4x4;
+
+namespace
+{
+	const Float4x4 Identity =
+	{ {
+		{ 1.0f, 0.0f, 0.0f, 0.0f },
+		{ 0.0f, 1.0f, 0.0f, 0.0f },
+		{ 0.0f, 0.0f, 1.0f, 0.0f },
+		{ 0.0f, 0.0f, 0.0f, 1.0f }
+	} };
+
+	// Arvo: the world box of a transformed box, without transforming its eight corners.
+	void TransformAabb(const RenderWorld::Aabb& local, const Float4x4& m, RenderWorld::Aabb& world)
+	{
+		for(int c = 0; c < 3; ++c)
+		{
+			world.Center[c] = local.Center[0] * m.m[0][c] + local.Center[1] * m.m[1][c] +
+				local.Center[2] * m.m[2][c] + m.m[3][c];
+
+			world.Extents[c] = local.Extents[0] * std::fabs(m.m[0][c]) + local.Extents[1] * std::fabs(m.m[1][c]) +
+				local.Extents[2] * std::fabs(m.m[2][c]);
+		}
+	}
+
+	bool Intersects(const RenderWorld::Frustum& frustum, const RenderWorld::Aabb& box)
+	{
+		for(const auto& p : frustum.Planes)
+		{
+			const float distance = p[0] * box.Center[0] + p[1] * box.Center[1] + p[2] * box.Center[2] + p[3];
+			const float radius = std::fabs(p[0]) * box.Extents[0] + std::fabs(p[1]) * box.Extents[1] +
+				std::fabs(p[2]) * box.Extents[2];
+
+			if(distance + radius < 0.0f)
+				return false;
+		}
+
+		return true;
+	}
+}
+
+RenderWorld::Frustum RenderWorld::Frustum::FromViewProj(const Float4x4& m)
+{
+	// Gribb/Hartmann with row vectors: clip component j is the dot product with column j.
+	// Each plane is w + sign * component (x, y, z) >= 0; the near plane is z >= 0.
+	const int axis[6] = { 0, 0, 1, 1, 2, 2 };
+	const float sign[6] = { 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f };
+	const float w[6] = { 1.0f, 1.0f, 1.0f, 1.0f, 0.0f, 1.0f };
+
+	Frustum f;
+
+	for(int p = 0; p < 6; ++p)
+	{
+		for(int i = 0; i < 4; ++i)
+			f.Planes[p][i] = w[p] * m.m[i][3] + sign[p] * m.m[i][axis[p]];
+
+		const float length = std::sqrt(f.Planes[p][0] * f.Planes[p][0] +
+			f.Planes[p][1] * f.Planes[p][1] + f.Planes[p][2] * f.Planes[p][2]);
+
+		if(length > 0.0f)
+		{
+			for(float& v : f.Planes[p])
+				v /= length;
+		}
+	}
+
+	return f;
+}
+
+RenderWorld::Entity RenderWorld::Create(MeshHandle mesh, uint32_t material, const Aabb& localBounds)
+{
+	uint32_t slot;
+
+	if(!mFreeSlots.empty())
+	{
+		slot = mFreeSlots.back();
+		mFreeSlots.pop_back();
+	}
+	else
+	{
+		if(mSparse.size() >= SlotMask)
+			throw std::length_error("RenderWorld: out of entity slots");
+
+		slot = static_cast<uint32_t>(mSparse.size());
+		mSparse.push_back(InvalidEntity);
+		mVersion.push_back(0);
+	}
+
+	const Entity entity = slot | (static_cast<uint32_t>(mVersion[slot]) << SlotBits);
+	mSparse[slot] = Count();
+
+	mEntities.push_back(entity);
+	mMesh.push_back(mesh);
+	mMaterial.push_back(material);
+	mWorld.push_back(Identity);
+	mGeneration.push_back(mNextGeneration++);
+	mBoundsGeneration.push_back(0);
+	mLocalBounds.push_back(localBounds);
+	mWorldBounds.emplace_back();
+	mVisibility.push_back(Enabled);
+
+	return entity;
+}
+
+void RenderWorld::Destroy(Entity entity)
+{
+	if(!IsAlive(entity))
+		return;
+
+	const uint32_t slot = SlotOf(entity);
+	const uint32_t index = mSparse[slot];
+	const uint32_t last = Count() - 1;
+
+	if(index != last)
+	{
+		mEntities[index] = mEntities[last];
+		mMesh[index] = mMesh[last];
+		mMaterial[index] = mMaterial[last];
+		mWorld[index] = mWorld[last];
+		mGeneration[index] = mGeneration[last];
+		mBoundsGeneration[index] = mBoundsGeneration[last];
+		mLocalBounds[index] = mLocalBounds[last];
+		mWorldBounds[index] = mWorldBounds[last];
+		mVisibility[index] = mVisibility[last];
+
+		mSparse[SlotOf(mEntities[index])] = index;
+	}
+
+	mEntities.pop_back();
+	mMesh.pop_back();
+	mMaterial.pop_back();
+	mWorld.pop_back();
+	mGeneration.pop_back();
+	mBoundsGeneration.pop_back();
+	mLocalBounds.pop_back();
+	mWorldBounds.pop_back();
+	mVisibility.pop_back();
+
+	mSparse[slot] = InvalidEntity;
+
+	// A wrapped version would make handles from 256 lives ago valid again, so such a
+	// slot is retired instead of reused
+	if(++mVersion[slot] != 0)
+		mFreeSlots.push_back(slot);
+}
+
+void RenderWorld::Clear()
+{
+	mSparse.clear();
+	mVersion.clear();
+	mFreeSlots.clear();
+
+	mEntities.clear();
+	mMesh.clear();
+	mMaterial.clear();
+	mWorld.clear();
+	mGeneration.clear();
+	mBoundsGeneration.clear();
+	mLocalBounds.clear();
+	mWorldBounds.clear();
+	mVisibility.clear();
+}
+
+void RenderWorld::Reserve(uint32_t count)
+{
+	mSparse.reserve(count);
+	mVersion.reserve(count);
+
+	mEntities.reserve(count);
+	mMesh.reserve(count);
+	mMaterial.reserve(count);
+	mWorld.reserve(count);
+	mGeneration.reserve(count);
+	mBoundsGeneration.reserve(count);
+	mLocalBounds.reserve(count);
+	mWorldBounds.reserve(count);
+	mVisibility.reserve(count);
+}
+
+bool RenderWorld::IsAlive(Entity entity) const
+{
+	const uint32_t slot = SlotOf(entity);
+
+	return entity != InvalidEntity && slot < mSparse.size() && mSparse[slot] != InvalidEntity &&
+		mEntities[mSparse[slot]] == entity;
+}
+
+void RenderWorld::SetWorld(Entity entity, const Float4x4& world)
+{
+	const uint32_t i = IndexOf(entity);
+
+	mWorld[i] = world;
+	mGeneration[i] = mNextGeneration++;
+}
+
+void RenderWorld::SetMesh(Entity entity, MeshHandle mesh, const Aabb& localBounds)
+{
+	const uint32_t i = IndexOf(entity);
+
+	mMesh[i] = mesh;
+	mLocalBounds[i] = localBounds;
+	mGeneration[i] = mNextGeneration++;
+}
+
+void RenderWorld::SetMaterial(Entity entity, uint32_t material)
+{
+	const uint32_t i = IndexOf(entity);
+
+	mMaterial[i] = material;
+	mGeneration[i] = mNextGeneration++;
+}
+
+void RenderWorld::SetEnabled(Entity entity, bool enabled)
+{
+	uint8_t& visibility = mVisibility[IndexOf(entity)];
+	visibility = enabled ? (visibility | Enabled) : (visibility & ~Enabled);
+}
+
+void RenderWorld::UpdateWorldBounds(bool parallel)
+{
+	PROFILE_ZONE("RenderWorld::UpdateWorldBounds");
+
+	auto pass = [this](uint32_t begin, uint32_t end)
+	{
+		for(uint32_t i = begin; i < end; ++i)
+		{
+			if(mBoundsGeneration[i] == mGeneration[i])
+				continue;
+
+			TransformAabb(mLocalBounds[i], mWorld[i], mWorldBounds[i]);
+			mBoundsGeneration[i] = mGeneration[i];
+		}
+	};
+
+	if(parallel)
+		JobSystem::ParallelFor(Count(), PassGrain, pass);
+	else
+		pass(0, Count());
+}
+
+uint32_t RenderWorld::Cull(const Frustum& frustum, bool parallel)
+{
+	PROFILE_ZONE("RenderWorld::Cull");
+
+	std::atomic<uint32_t> visible{ 0 };
+
+	auto pass = [this, &frustum, &visible](uint32_t begin, uint32_t end)
+	{
+		uint32_t count = 0;
+
+		for(uint32_t i = begin; i < end; ++i)
+		{
+			const bool inside = Intersects(frustum, mWorldBounds[i]);
+			mVisibility[i] = static_cast<uint8_t>((mVisibility[i] & Enabled) | (inside ? InFrustum : 0));
+			count += IsVisible(mVisibility[i]) ? 1 : 0;
+		}
+
+		visible.fetch_add(count, std::memory_order_relaxed);
+	};
+
+	if(parallel)
+		JobSystem::ParallelFor(Count(), PassGrain, pass);
+	else
+		pass(0, Count());
+
+	return visible.load();
+}
+
+uint32_t RenderWorld::SetInFrustum(const uint32_t* slots, uint32_t slotCount)
+{
+	PROFILE_ZONE("RenderWorld::SetInFrustum");
+
+	for(uint8_t& visibility : mVisibility)
+		visibility &= Enabled;
+
+	uint32_t visible = 0;
+
+	for(uint32_t i = 0; i < slotCount; ++i)
+	{
+		const uint32_t index = slots[i] < mSparse.size() ? mSparse[slots[i]] : InvalidEntity;
+		if(index == InvalidEntity)
+			continue;
+
+		mVisibility[index] |= InFrustum;
+		visible += IsVisible(mVisibility[index]) ? 1 : 0;
+	}
+
+	return visible;
+}
+
+void RenderWorld::BuildDrawList(std::vector<DrawEntry>& drawList) const
+{
+	PROFILE_ZONE("RenderWorld::BuildDrawList");
+
+	drawList.clear();
+
+	bool sorted = true;
+	const uint32_t count = Count();
+
+	for(uint32_t i = 0; i < count; ++i)
+	{
+		if(!IsVisible(mVisibility[i]))
+			continue;
+
+		const uint64_t key = (static_cast<uint64_t>(mMesh[i]) << 32) | mMaterial[i];
+		sorted = sorted && (drawList.empty() || drawList.back().Key <= key);
+
+		drawList.push_back({ key, SlotOf(mEntities[i]), i });
+	}
+
+	// Entities are usually created mesh by mesh, so the list is often sorted already.
+	if(!sorted)
+	{
+		std::sort(drawList.begin(), drawList.end(), [](const DrawEntry& a, const DrawEntry& b)
+		{
+			return a.Key < b.Key || (a.Key == b.Key && a.Slot < b.Slot);
+		});
+	}
+}
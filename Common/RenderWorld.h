@@ -0,0 +1,137 @@
+//***************************************************************************************
+// RenderWorld.h
+//
+// Entity-component storage for renderable objects.  Every renderable has the same set
+// of components - mesh handle, material, world transform, bounds and visibility - so
+// they form a single archetype stored as parallel dense arrays.  A sparse set maps
+// stable Entity handles to dense indices; removal swaps the last entity into the hole,
+// so the arrays stay contiguous and every pass is a linear walk over them.
+//
+// An entity's slot (the low bits of its handle) never changes while it is alive and
+// is reused only after it is destroyed, so it can index per-object GPU data such as
+// constant buffer elements.  The high bits hold the slot's version; a slot whose
+// version has used up its 8 bits is retired, so a stale handle never comes back to
+// life.  Generations come from one world-wide counter, so a reused
+// slot never repeats a generation a frame resource has already seen.
+//
+// Not thread-safe for structural changes; the passes split work over the JobSystem.
+//***************************************************************************************
+
+#pragma once
+
+#include "BatchTransform.h"
+
+#include <cstdint>
+#include <vector>
+
+class RenderWorld
+{
+public:
+	using Entity = uint32_t;
+	using MeshHandle = uint32_t;
+
+	static constexpr Entity InvalidEntity = 0xFFFFFFFFu;
+	static constexpr MeshHandle InvalidMesh = 0xFFFFFFFFu;
+
+	// Same layout as DirectX::BoundingBox.
+	struct Aabb
+	{
+		float Center[3] = { 0.0f, 0.0f, 0.0f };
+		float Extents[3] = { 0.0f, 0.0f, 0.0f };
+	};
+
+	// Inward-facing planes (a, b, c, d): a point p is inside if a*x + b*y + c*z + d >= 0.
+	struct Frustum
+	{
+		float Planes[6][4];
+
+		// Planes of a row-vector view-projection matrix with D3D depth range [0, 1].
+		static Frustum FromViewProj(const BatchTransform::Float4x4& viewProj);
+	};
+
+	enum VisibilityFlags : uint8_t
+	{
+		Enabled   = 1 << 0, // drawn through the draw list; set by the owner
+		InFrustum = 1 << 1  // result of the last Cull
+	};
+
+	struct DrawEntry
+	{
+		uint64_t Key;   // mesh in the high half, material in the low half
+		uint32_t Slot;
+		uint32_t Index; // dense index at the time the list was built
+	};
+
+	static constexpr uint32_t SlotBits = 24;
+	static constexpr uint32_t SlotMask = (1u << SlotBits) - 1;
+
+	static uint32_t SlotOf(Entity entity) { return entity & SlotMask; }
+
+	Entity Create(MeshHandle mesh, uint32_t material, const Aabb& localBounds);
+	void Destroy(Entity entity);
+	void Clear();
+	void Reserve(uint32_t count);
+
+	bool IsAlive(Entity entity) const;
+
+	uint32_t Count() const { return static_cast<uint32_t>(mEntities.size()); }
+
+	// One past the highest slot handed out so far: the size per-object GPU arrays need.
+	uint32_t SlotCapacity() const { return static_cast<uint32_t>(mSparse.size()); }
+
+	uint32_t IndexOf(Entity entity) const { return mSparse[SlotOf(entity)]; }
+	uint32_t IndexOfSlot(uint32_t slot) const { return mSparse[slot]; }
+
+	void SetWorld(Entity entity, const BatchTransform::Float4x4& world);
+	void SetMesh(Entity entity, MeshHandle mesh, const Aabb& localBounds);
+	void SetMaterial(Entity entity, uint32_t material);
+	void SetEnabled(Entity entity, bool enabled);
+
+	// Dense component arrays, all Count() long and indexed alike.
+	const Entity* Entities() const { return mEntities.data(); }
+	const MeshHandle* Meshes() const { return mMesh.data(); }
+	const uint32_t* Materials() const { return mMaterial.data(); }
+	const BatchTransform::Float4x4* Worlds() const { return mWorld.data(); }
+	const uint64_t* Generations() const { return mGeneration.data(); }
+	const Aabb* WorldBounds() const { return mWorldBounds.data(); }
+	const uint8_t* Visibility() const { return mVisibility.data(); }
+
+	static bool IsVisible(uint8_t visibility) { return visibility == (Enabled | InFrustum); }
+
+	// Recomputes world-space bounds of entities whose transform or mesh changed.
+	void UpdateWorldBounds(bool parallel = true);
+
+	// Sets InFrustum for every entity; returns the number of visible entities.
+	uint32_t Cull(const Frustum& frustum, bool parallel = true);
+
+	// Same result as Cull when a spatial index already found the slots inside the
+	// frustum: sets InFrustum only for them.  Returns the number of visible entities.
+	uint32_t SetInFrustum(const uint32_t* slots, uint32_t slotCount);
+
+	// Visible entities sorted by mesh, then material.
+	void BuildDrawList(std::vector<DrawEntry>& drawList) const;
+
+	// Entities per ParallelFor chunk in the passes above.
+	static constexpr uint32_t PassGrain = 16384;
+
+private:
+	// Sparse part: slot -> dense index (InvalidEntity if free), plus a version per slot
+	// so handles of destroyed entities are recognised as stale.  Retired slots stay
+	// free and out of mFreeSlots.
+	std::vector<uint32_t> mSparse;
+	std::vector<uint8_t> mVersion;
+	std::vector<uint32_t> mFreeSlots;
+
+	// Dense part, one element per live entity.
+	std::vector<Entity> mEntities;
+	std::vector<MeshHandle> mMesh;
+	std::vector<uint32_t> mMaterial;
+	std::vector<BatchTransform::Float4x4> mWorld;
+	std::vector<uint64_t> mGeneration;       // bumped by any change that affects GPU data
+	std::vector<uint64_t> mBoundsGeneration; // generation mWorldBounds was computed for
+	std::vector<Aabb> mLocalBounds;
+	std::vector<Aabb> mWorldBounds;
+	std::vector<uint8_t> mVisibility;
+
+	uint64_t mNextGeneration = 1;
+};
@@ -0,0 +1,746 @@
+//***************************************************************************************
+// SceneBvh.cpp
+//***************************************************************************************
+
+#include "SceneBvh.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+	using Box = SceneBvh::Box;
+
+	constexpr uint32_t BinCount = 16;
+
+	// Traversal stacks are fixed arrays; past SahDepthLimit the builder stops looking
+	// for SAH splits and halves ranges, so no tree gets deeper than StackSize.
+	constexpr uint32_t StackSize = 128;
+	constexpr uint32_t SahDepthLimit = 64;
+
+	Box EmptyBox()
+	{
+		return { { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+	}
+
+	Box ToBox(const RenderWorld::Aabb& a)
+	{
+		Box b;
+		for(int c = 0; c < 3; ++c)
+		{
+			b.Min[c] = a.Center[c] - a.Extents[c];
+			b.Max[c] = a.Center[c] + a.Extents[c];
+		}
+		return b;
+	}
+
+	void Grow(Box& box, const float* min, const float* max)
+	{
+		for(int c = 0; c < 3; ++c)
+		{
+			box.Min[c] = std::min(box.Min[c], min[c]);
+			box.Max[c] = std::max(box.Max[c], max[c]);
+		}
+	}
+
+	float HalfArea(const Box& b)
+	{
+		const float dx = b.Max[0] - b.Min[0];
+		const float dy = b.Max[1] - b.Min[1];
+		const float dz = b.Max[2] - b.Min[2];
+		return (dx < 0.0f) ? 0.0f : dx * dy + dy * dz + dz * dx;
+	}
+
+	bool Overlaps(const float* minA, const float* maxA, const Box& b)
+	{
+		return minA[0] <= b.Max[0] && maxA[0] >= b.Min[0] &&
+			minA[1] <= b.Max[1] && maxA[1] >= b.Min[1] &&
+			minA[2] <= b.Max[2] && maxA[2] >= b.Min[2];
+	}
+
+	float SquaredDistance(const float* min, const float* max, const float* p)
+	{
+		float d = 0.0f;
+		for(int c = 0; c < 3; ++c)
+		{
+			const float v = p[c] < min[c] ? min[c] - p[c] : (p[c] > max[c] ? p[c] - max[c] : 0.0f);
+			d += v * v;
+		}
+		return d;
+	}
+
+	enum class Containment { Outside, Intersects, Inside };
+
+	Containment Classify(const RenderWorld::Frustum& frustum, const float* min, const float* max)
+	{
+		Containment result = Containment::Inside;
+
+		for(const auto& p : frustum.Planes)
+		{
+			float distance = p[3];
+			float radius = 0.0f;
+
+			for(int c = 0; c < 3; ++c)
+			{
+				const float center = 0.5f * (min[c] + max[c]);
+				const float extent = 0.5f * (max[c] - min[c]);
+				distance += p[c] * center;
+				radius += std::fabs(p[c]) * extent;
+			}
+
+			if(distance + radius < 0.0f)
+				return Containment::Outside;
+			if(distance - radius < 0.0f)
+				result = Containment::Intersects;
+		}
+
+		return result;
+	}
+
+	// Slab test; returns the entry distance or a negative value on a miss.
+	float RayBox(const float* origin, const float* invDir, const float* min, const float* max, float maxT)
+	{
+		float tMin = 0.0f;
+		float tMax = maxT;
+
+		for(int c = 0; c < 3; ++c)
+		{
+			float t0 = (min[c] - origin[c]) * invDir[c];
+			float t1 = (max[c] - origin[c]) * invDir[c];
+			if(t0 > t1)
+				std::swap(t0, t1);
+
+			// NaN from 0 * inf (origin on the slab plane, axis-parallel ray) must not reject
+			tMin = t0 > tMin ? t0 : tMin;
+			tMax = t1 < tMax ? t1 : tMax;
+
+			if(tMin > tMax)
+				return -1.0f;
+		}
+
+		return tMin;
+	}
+}
+
+void SceneBvh::Clear()
+{
+	mNodes.clear();
+	mParent.clear();
+	mNodePrims.clear();
+	mPrims.clear();
+	mProxyBox.clear();
+	mProxyLeaf.clear();
+	mPending.clear();
+	mDirtyLeaves.clear();
+	mLeafDirty.clear();
+
+	mProxyCount = 0;
+	mBuiltProxyCount = 0;
+	mMovedSinceBuild = 0;
+}
+
+void SceneBvh::EnsureProxy(ProxyId id)
+{
+	if(id >= mProxyLeaf.size())
+	{
+		mProxyLeaf.resize(static_cast<size_t>(id) + 1, NotPresent);
+		mProxyBox.resize(static_cast<size_t>(id) + 1, EmptyBox());
+	}
+}
+
+void SceneBvh::Insert(ProxyId id, const RenderWorld::Aabb& bounds)
+{
+	EnsureProxy(id);
+
+	if(mProxyLeaf[id] != NotPresent)
+	{
+		Move(id, bounds);
+		return;
+	}
+
+	mProxyBox[id] = ToBox(bounds);
+	mProxyLeaf[id] = PendingLeaf;
+	mPending.push_back(id);
+	++mProxyCount;
+}
+
+void SceneBvh::Remove(ProxyId id)
+{
+	if(!Contains(id))
+		return;
+
+	const uint32_t leaf = mProxyLeaf[id];
+
+	if(leaf == PendingLeaf)
+	{
+		mPending.erase(std::find(mPending.begin(), mPending.end(), id));
+	}
+	else
+	{
+		const Node& node = mNodes[leaf];
+		for(uint32_t i = node.First; i < node.First + node.Count; ++i)
+		{
+			if(mPrims[i] == id)
+				mPrims[i] = InvalidProxy;
+		}
+		MarkLeafDirty(leaf);
+	}
+
+	mProxyLeaf[id] = NotPresent;
+	--mProxyCount;
+}
+
+void SceneBvh::Move(ProxyId id, const RenderWorld::Aabb& bounds)
+{
+	if(!Contains(id))
+	{
+		Insert(id, bounds);
+		return;
+	}
+
+	mProxyBox[id] = ToBox(bounds);
+
+	if(mProxyLeaf[id] != PendingLeaf)
+	{
+		MarkLeafDirty(mProxyLeaf[id]);
+		++mMovedSinceBuild;
+	}
+}
+
+void SceneBvh::MarkLeafDirty(uint32_t leaf)
+{
+	if(!mLeafDirty[leaf])
+	{
+		mLeafDirty[leaf] = 1;
+		mDirtyLeaves.push_back(leaf);
+	}
+}
+
+void SceneBvh::Build()
+{
+	PROFILE_ZONE("SceneBvh::Build");
+
+	mNodes.clear();
+	mParent.clear();
+	mNodePrims.clear();
+	mPrims.clear();
+	mPending.clear();
+	mDirtyLeaves.clear();
+
+	mPrims.reserve(mProxyCount);
+	for(ProxyId id = 0; id < mProxyLeaf.size(); ++id)
+	{
+		if(mProxyLeaf[id] != NotPresent)
+			mPrims.push_back(id);
+	}
+
+	mBuiltProxyCount = mProxyCount;
+	mMovedSinceBuild = 0;
+
+	if(mPrims.empty())
+	{
+		mLeafDirty.clear();
+		return;
+	}
+
+	const uint32_t primCount = static_cast<uint32_t>(mPrims.size());
+
+	// Centroids once per proxy, indexed like mPrims and partitioned along with it
+	std::vector<float> centroids(static_cast<size_t>(primCount) * 3);
+	for(uint32_t i = 0; i < primCount; ++i)
+	{
+		const Box& b = mProxyBox[mPrims[i]];
+		for(int c = 0; c < 3; ++c)
+			centroids[i * 3 + c] = 0.5f * (b.Min[c] + b.Max[c]);
+	}
+
+	mNodes.reserve(2 * (primCount / std::max(1u, MaxLeafSize)) + 1);
+
+	struct Task
+	{
+		uint32_t Node;
+		uint32_t Begin;
+		uint32_t End;
+		uint32_t Depth;
+	};
+
+	std::vector<Task> stack;
+	mNodes.push_back({});
+	mParent.push_back(NotPresent);
+	mNodePrims.push_back({ 0, primCount });
+	stack.push_back({ 0, 0, primCount, 0 });
+
+	struct Bin
+	{
+		Box Bounds;
+		uint32_t Count;
+	};
+
+	while(!stack.empty())
+	{
+		const Task task = stack.back();
+		stack.pop_back();
+
+		Box bounds = EmptyBox();
+		Box centroidBounds = EmptyBox();
+		for(uint32_t i = task.Begin; i < task.End; ++i)
+		{
+			const Box& b = mProxyBox[mPrims[i]];
+			Grow(bounds, b.Min, b.Max);
+			Grow(centroidBounds, &centroids[i * 3], &centroids[i * 3]);
+		}
+
+		Node& node = mNodes[task.Node];
+		std::copy(bounds.Min, bounds.Min + 3, node.Min);
+		std::copy(bounds.Max, bounds.Max + 3, node.Max);
+
+		const uint32_t count = task.End - task.Begin;
+
+		// Binned SAH over the longest centroid axis
+		int axis = 0;
+		float extent = centroidBounds.Max[0] - centroidBounds.Min[0];
+		for(int c = 1; c < 3; ++c)
+		{
+			const float e = centroidBounds.Max[c] - centroidBounds.Min[c];
+			if(e > extent)
+			{
+				extent = e;
+				axis = c;
+			}
+		}
+
+		uint32_t mid = task.Begin;
+
+		if(count > MaxLeafSize && extent > 0.0f && task.Depth < SahDepthLimit)
+		{
+			Bin bins[BinCount];
+			for(Bin& bin : bins)
+				bin = { EmptyBox(), 0 };
+
+			const float scale = BinCount / extent;
+			auto binOf = [&](uint32_t i)
+			{
+				const uint32_t b = static_cast<uint32_t>((centroids[i * 3 + axis] - centroidBounds.Min[axis]) * scale);
+				return std::min(b, BinCount - 1);
+			};
+
+			for(uint32_t i = task.Begin; i < task.End; ++i)
+			{
+				Bin& bin = bins[binOf(i)];
+				const Box& b = mProxyBox[mPrims[i]];
+				Grow(bin.Bounds, b.Min, b.Max);
+				++bin.Count;
+			}
+
+			// Sweep from the right to get the cost of every split plane
+			float rightCost[BinCount];
+			Box right = EmptyBox();
+			uint32_t rightCount = 0;
+			for(uint32_t b = BinCount - 1; b > 0; --b)
+			{
+				Grow(right, bins[b].Bounds.Min, bins[b].Bounds.Max);
+				rightCount += bins[b].Count;
+				rightCost[b] = HalfArea(right) * rightCount;
+			}
+
+			float bestCost = FLT_MAX;
+			uint32_t bestSplit = 0;
+			Box left = EmptyBox();
+			uint32_t leftCount = 0;
+			for(uint32_t b = 0; b + 1 < BinCount; ++b)
+			{
+				Grow(left, bins[b].Bounds.Min, bins[b].Bounds.Max);
+				leftCount += bins[b].Count;
+
+				const float cost = HalfArea(left) * leftCount + rightCost[b + 1];
+				if(leftCount > 0 && leftCount < count && cost < bestCost)
+				{
+					bestCost = cost;
+					bestSplit = b + 1;
+				}
+			}
+
+			// Split only if it beats a leaf (traversal step costs about one box test)
+			const float leafCost = HalfArea(bounds) * count;
+			if(bestSplit > 0 && (bestCost + HalfArea(bounds) < leafCost || count > 4 * MaxLeafSize))
+			{
+				uint32_t i = task.Begin;
+				uint32_t j = task.End;
+				while(i < j)
+				{
+					if(binOf(i) < bestSplit)
+					{
+						++i;
+					}
+					else
+					{
+						--j;
+						std::swap(mPrims[i], mPrims[j]);
+						for(int c = 0; c < 3; ++c)
+							std::swap(centroids[i * 3 + c], centroids[j * 3 + c]);
+					}
+				}
+				mid = i;
+			}
+		}
+
+		// All centroids in one spot, or the tree is already deep: halve the range
+		if((mid == task.Begin || mid == task.End) && (count > 4 * MaxLeafSize || (task.Depth >= SahDepthLimit && count > MaxLeafSize)))
+			mid = task.Begin + count / 2;
+
+		if(mid == task.Begin || mid == task.End)
+		{
+			mNodes[task.Node].First = task.Begin;
+			mNodes[task.Node].Count = count;
+			continue;
+		}
+
+		const uint32_t left = static_cast<uint32_t>(mNodes.size());
+		mNodes[task.Node].First = left;
+		mNodes[task.Node].Count = 0;
+
+		mNodes.push_back({});
+		mNodes.push_back({});
+		mParent.push_back(task.Node);
+		mParent.push_back(task.Node);
+		mNodePrims.push_back({ task.Begin, mid });
+		mNodePrims.push_back({ mid, task.End });
+
+		stack.push_back({ left + 1, mid, task.End, task.Depth + 1 });
+		stack.push_back({ left, task.Begin, mid, task.Depth + 1 });
+	}
+
+	mLeafDirty.assign(mNodes.size(), 0);
+
+	for(uint32_t n = 0; n < mNodes.size(); ++n)
+	{
+		const Node& node = mNodes[n];
+		if(node.Count == 0)
+			continue;
+
+		for(uint32_t i = node.First; i < node.First + node.Count; ++i)
+			mProxyLeaf[mPrims[i]] = n;
+	}
+}
+
+void SceneBvh::RefitNode(uint32_t n)
+{
+	Node& node = mNodes[n];
+	Box bounds = EmptyBox();
+
+	if(node.Count > 0)
+	{
+		for(uint32_t i = node.First; i < node.First + node.Count; ++i)
+		{
+			if(mPrims[i] != InvalidProxy)
+				Grow(bounds, mProxyBox[mPrims[i]].Min, mProxyBox[mPrims[i]].Max);
+		}
+	}
+	else
+	{
+		Grow(bounds, mNodes[node.First].Min, mNodes[node.First].Max);
+		Grow(bounds, mNodes[node.First + 1].Min, mNodes[node.First + 1].Max);
+	}
+
+	std::copy(bounds.Min, bounds.Min + 3, node.Min);
+	std::copy(bounds.Max, bounds.Max + 3, node.Max);
+}
+
+void SceneBvh::Refit()
+{
+	PROFILE_ZONE("SceneBvh::Refit");
+
+	if(mDirtyLeaves.empty())
+		return;
+
+	// Children are always stored after their parent, so one backwards pass refits the
+	// whole tree.  Walking up from each dirty leaf is cheaper while few leaves changed.
+	const size_t depthEstimate = 2 + static_cast<size_t>(std::log2(static_cast<double>(mNodes.size()) + 1.0));
+
+	if(mDirtyLeaves.size() * depthEstimate > mNodes.size())
+	{
+		for(uint32_t n = static_cast<uint32_t>(mNodes.size()); n-- > 0;)
+			RefitNode(n);
+	}
+	else
+	{
+		for(uint32_t leaf : mDirtyLeaves)
+		{
+			for(uint32_t n = leaf; n != NotPresent; n = mParent[n])
+			{
+				const Node before = mNodes[n];
+				RefitNode(n);
+
+				// An ancestor whose box did not change leaves everything above it valid
+				const Node& after = mNodes[n];
+				if(n != leaf && std::equal(before.Min, before.Min + 3, after.Min) &&
+					std::equal(before.Max, before.Max + 3, after.Max))
+					break;
+			}
+		}
+	}
+
+	for(uint32_t leaf : mDirtyLeaves)
+		mLeafDirty[leaf] = 0;
+	mDirtyLeaves.clear();
+}
+
+bool SceneBvh::NeedsRebuild() const
+{
+	const uint32_t built = std::max(1u, mBuiltProxyCount);
+	return mPending.size() > std::max<size_t>(64, built / 16) || mMovedSinceBuild > built / 2;
+}
+
+template<typename Visit>
+void SceneBvh::ForEachInRange(uint32_t node, Visit&& visit) const
+{
+	const PrimRange range = mNodePrims[node];
+	for(uint32_t i = range.Begin; i < range.End; ++i)
+	{
+		if(mPrims[i] != InvalidProxy)
+			visit(mPrims[i]);
+	}
+}
+
+void SceneBvh::QueryFrustum(const RenderWorld::Frustum& frustum, std::vector<ProxyId>& result) const
+{
+	PROFILE_ZONE("SceneBvh::QueryFrustum");
+
+	for(ProxyId id : mPending)
+	{
+		if(Classify(frustum, mProxyBox[id].Min, mProxyBox[id].Max) != Containment::Outside)
+			result.push_back(id);
+	}
+
+	if(mNodes.empty())
+		return;
+
+	uint32_t stack[StackSize];
+	uint32_t top = 0;
+	stack[top++] = 0;
+
+	while(top > 0)
+	{
+		const uint32_t n = stack[--top];
+		const Node& node = mNodes[n];
+
+		const Containment containment = Classify(frustum, node.Min, node.Max);
+		if(containment == Containment::Outside)
+			continue;
+
+		if(containment == Containment::Inside)
+		{
+			ForEachInRange(n, [&result](ProxyId id) { result.push_back(id); });
+			continue;
+		}
+
+		if(node.Count > 0)
+		{
+			for(uint32_t i = node.First; i < node.First + node.Count; ++i)
+			{
+				const ProxyId id = mPrims[i];
+				if(id != InvalidProxy && Classify(frustum, mProxyBox[id].Min, mProxyBox[id].Max) != Containment::Outside)
+					result.push_back(id);
+			}
+			continue;
+		}
+
+		stack[top++] = node.First;
+		stack[top++] = node.First + 1;
+	}
+}
+
+void SceneBvh::QueryBox(const RenderWorld::Aabb& query, std::vector<ProxyId>& result) const
+{
+	const Box q = ToBox(query);
+
+	for(ProxyId id : mPending)
+	{
+		if(Overlaps(q.Min, q.Max, mProxyBox[id]))
+			result.push_back(id);
+	}
+
+	if(mNodes.empty())
+		return;
+
+	uint32_t stack[StackSize];
+	uint32_t top = 0;
+	stack[top++] = 0;
+
+	while(top > 0)
+	{
+		const Node& node = mNodes[stack[--top]];
+
+		if(!Overlaps(node.Min, node.Max, q))
+			continue;
+
+		if(node.Count > 0)
+		{
+			for(uint32_t i = node.First; i < node.First + node.Count; ++i)
+			{
+				const ProxyId id = mPrims[i];
+				if(id != InvalidProxy && Overlaps(q.Min, q.Max, mProxyBox[id]))
+					result.push_back(id);
+			}
+			continue;
+		}
+
+		stack[top++] = node.First;
+		stack[top++] = node.First + 1;
+	}
+}
+
+void SceneBvh::QuerySphere(const float center[3], float radius, std::vector<ProxyId>& result) const
+{
+	const float radiusSq = radius * radius;
+
+	for(ProxyId id : mPending)
+	{
+		if(SquaredDistance(mProxyBox[id].Min, mProxyBox[id].Max, center) <= radiusSq)
+			result.push_back(id);
+	}
+
+	if(mNodes.empty())
+		return;
+
+	uint32_t stack[StackSize];
+	uint32_t top = 0;
+	stack[top++] = 0;
+
+	while(top > 0)
+	{
+		const Node& node = mNodes[stack[--top]];
+
+		if(SquaredDistance(node.Min, node.Max, center) > radiusSq)
+			continue;
+
+		if(node.Count > 0)
+		{
+			for(uint32_t i = node.First; i < node.First + node.Count; ++i)
+			{
+				const ProxyId id = mPrims[i];
+				if(id != InvalidProxy && SquaredDistance(mProxyBox[id].Min, mProxyBox[id].Max, center) <= radiusSq)
+					result.push_back(id);
+			}
+			continue;
+		}
+
+		stack[top++] = node.First;
+		stack[top++] = node.First + 1;
+	}
+}
+
+bool SceneBvh::Raycast(const float origin[3], const float direction[3], float maxT, RayHit& hit) const
+{
+	float invDir[3];
+	for(int c = 0; c < 3; ++c)
+		invDir[c] = direction[c] != 0.0f ? 1.0f / direction[c] : (direction[c] < 0.0f ? -FLT_MAX : FLT_MAX);
+
+	hit = RayHit();
+	float best = maxT;
+
+	auto test = [&](ProxyId id)
+	{
+		const float t = RayBox(origin, invDir, mProxyBox[id].Min, mProxyBox[id].Max, best);
+		if(t >= 0.0f && (hit.Proxy == InvalidProxy || t < best))
+		{
+			best = t;
+			hit.Proxy = id;
+			hit.T = t;
+		}
+	};
+
+	for(ProxyId id : mPending)
+		test(id);
+
+	if(mNodes.empty())
+		return hit.Proxy != InvalidProxy;
+
+	uint32_t stack[StackSize];
+	uint32_t top = 0;
+	stack[top++] = 0;
+
+	while(top > 0)
+	{
+		const Node& node = mNodes[stack[--top]];
+
+		if(RayBox(origin, invDir, node.Min, node.Max, best) < 0.0f)
+			continue;
+
+		if(node.Count > 0)
+		{
+			for(uint32_t i = node.First; i < node.First + node.Count; ++i)
+			{
+				if(mPrims[i] != InvalidProxy)
+					test(mPrims[i]);
+			}
+			continue;
+		}
+
+		// Nearer child last, so it is popped first and tightens best early
+		const Node& a = mNodes[node.First];
+		const Node& b = mNodes[node.First + 1];
+		const float ta = RayBox(origin, invDir, a.Min, a.Max, best);
+		const float tb = RayBox(origin, invDir, b.Min, b.Max, best);
+
+		if(ta >= 0.0f && tb >= 0.0f)
+		{
+			const bool aFirst = ta <= tb;
+			stack[top++] = aFirst ? node.First + 1 : node.First;
+			stack[top++] = aFirst ? node.First : node.First + 1;
+		}
+		else if(ta >= 0.0f)
+		{
+			stack[top++] = node.First;
+		}
+		else if(tb >= 0.0f)
+		{
+			stack[top++] = node.First + 1;
+		}
+	}
+
+	return hit.Proxy != InvalidProxy;
+}
+
+SceneBvh::Stats SceneBvh::GetStats() const
+{
+	Stats stats;
+	stats.Proxies = mProxyCount;
+	stats.Pending = static_cast<uint32_t>(mPending.size());
+	stats.Nodes = static_cast<uint32_t>(mNodes.size());
+
+	if(mNodes.empty())
+		return stats;
+
+	std::vector<uint32_t> depth(mNodes.size(), 0);
+	double cost = 0.0;
+
+	for(uint32_t n = 0; n < mNodes.size(); ++n)
+	{
+		const Node& node = mNodes[n];
+		const Box box = { { node.Min[0], node.Min[1], node.Min[2] }, { node.Max[0], node.Max[1], node.Max[2] } };
+
+		if(n > 0)
+			depth[n] = depth[mParent[n]] + 1;
+		stats.MaxDepth = std::max(stats.MaxDepth, depth[n]);
+
+		if(node.Count > 0)
+		{
+			++stats.Leaves;
+			cost += static_cast<double>(HalfArea(box)) * node.Count;
+		}
+		else
+		{
+			cost += HalfArea(box);
+		}
+	}
+
+	const Node& root = mNodes[0];
+	const Box rootBox = { { root.Min[0], root.Min[1], root.Min[2] }, { root.Max[0], root.Max[1], root.Max[2] } };
+	const float rootArea = HalfArea(rootBox);
+	stats.SahCost = rootArea > 0.0f ? static_cast<float>(cost / rootArea) : 0.0f;
+
+	return stats;
+}
@@ -0,0 +1,124 @@
+//***************************************************************************************
+// SceneBvh.h
+//
+// Bounding volume hierarchy over the world-space boxes of renderables, used to cull
+// and query large object counts without testing every object.
+//
+// Build() makes a binned-SAH tree.  Moving a proxy only rewrites its box and marks its
+// leaf; Refit() then recomputes the boxes of the affected nodes without changing the
+// topology, which is much cheaper than a rebuild but lets quality drift as objects
+// travel.  NeedsRebuild() says when a rebuild is worth it.  Proxies inserted after the
+// last build sit in a small pending list that queries test linearly.
+//
+// Frustum queries accept or reject whole subtrees; range (box, sphere) and ray queries
+// descend only into overlapping nodes.
+//***************************************************************************************
+
+#pragma once
+
+#include "RenderWorld.h"
+
+#include <cstdint>
+#include <vector>
+
+class SceneBvh
+{
+public:
+	// Callers pick the ids; a dense range such as RenderWorld slots works best.
+	using ProxyId = uint32_t;
+	static constexpr ProxyId InvalidProxy = 0xFFFFFFFFu;
+
+	struct Box
+	{
+		float Min[3];
+		float Max[3];
+	};
+
+	struct RayHit
+	{
+		ProxyId Proxy = InvalidProxy;
+		float T = 0.0f; // distance along the ray to the proxy's box
+	};
+
+	struct Stats
+	{
+		uint32_t Proxies = 0;
+		uint32_t Pending = 0;
+		uint32_t Nodes = 0;
+		uint32_t Leaves = 0;
+		uint32_t MaxDepth = 0;
+		float SahCost = 0.0f; // relative to the root; grows as refits loosen the tree
+	};
+
+	// Proxies per leaf the builder aims for.
+	uint32_t MaxLeafSize = 4;
+
+	void Clear();
+
+	void Insert(ProxyId id, const RenderWorld::Aabb& bounds);
+	void Remove(ProxyId id);
+	void Move(ProxyId id, const RenderWorld::Aabb& bounds);
+
+	bool Contains(ProxyId id) const { return id < mProxyLeaf.size() && mProxyLeaf[id] != NotPresent; }
+
+	// Rebuilds the tree from every live proxy, including pending ones.
+	void Build();
+
+	// Recomputes boxes above leaves touched by Move/Remove since the last refit.
+	void Refit();
+
+	// True once enough proxies are pending or have moved that a rebuild pays off.
+	bool NeedsRebuild() const;
+
+	void QueryFrustum(const RenderWorld::Frustum& frustum, std::vector<ProxyId>& result) const;
+	void QueryBox(const RenderWorld::Aabb& box, std::vector<ProxyId>& result) const;
+	void QuerySphere(const float center[3], float radius, std::vector<ProxyId>& result) const;
+
+	// Closest proxy box hit by origin + t * direction for t in [0, maxT].
+	bool Raycast(const float origin[3], const float direction[3], float maxT, RayHit& hit) const;
+
+	Stats GetStats() const;
+
+private:
+	struct Node
+	{
+		float Min[3];
+		uint32_t First; // leaf: first entry in mPrims; internal: left child (right = First + 1)
+		float Max[3];
+		uint32_t Count; // leaf: entries in mPrims; internal: 0
+	};
+
+	struct PrimRange
+	{
+		uint32_t Begin;
+		uint32_t End;
+	};
+
+	static constexpr uint32_t NotPresent = 0xFFFFFFFFu;
+	static constexpr uint32_t PendingLeaf = 0xFFFFFFFEu;
+
+	void EnsureProxy(ProxyId id);
+	void MarkLeafDirty(uint32_t leaf);
+	void RefitNode(uint32_t node);
+
+	template<typename Visit>
+	void ForEachInRange(uint32_t node, Visit&& visit) const;
+
+	// Tree
+	std::vector<Node> mNodes;
+	std::vector<uint32_t> mParent;
+	std::vector<PrimRange> mNodePrims; // entries of mPrims under each node, for whole-subtree accepts
+	std::vector<ProxyId> mPrims;       // proxy ids grouped by leaf, InvalidProxy after Remove
+
+	// Per proxy id
+	std::vector<Box> mProxyBox;
+	std::vector<uint32_t> mProxyLeaf;  // leaf node, PendingLeaf or NotPresent
+
+	std::vector<ProxyId> mPending;
+	std::vector<uint32_t> mDirtyLeaves;
+	std::vector<uint8_t> mLeafDirty;
+
+	uint32_t mProxyCount = 0;
+	uint32_t mBuiltProxyCount = 0;
+	uint32_t mMovedSinceBuild = 0;
+};
@@ -0,0 +1,350 @@
+//***************************************************************************************
+// SceneGraph.cpp
+//***************************************************************************************
+
+#include "SceneGraph.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+
+#include <algorithm>
+
+using BatchTransform::Float4x4;
+
+namespace
+{
+	// out = a * b for affine matrices (row vectors, last column 0 0 0 1).  out must not alias.
+	inline void MultiplyAffine(const Float4x4& a, const Float4x4& b, Float4x4& out)
+	{
+		for(int r = 0; r < 4; ++r)
+		{
+			const float a0 = a.m[r][0], a1 = a.m[r][1], a2 = a.m[r][2];
+			const float w = r == 3 ? 1.0f : 0.0f;
+
+			for(int c = 0; c < 3; ++c)
+				out.m[r][c] = a0 * b.m[0][c] + a1 * b.m[1][c] + a2 * b.m[2][c] + w * b.m[3][c];
+
+			out.m[r][3] = w;
+		}
+	}
+
+	// Nodes composed per block; the local matrices live on the stack only.
+	constexpr uint32_t BlockSize = 256;
+}
+
+void SceneGraph::Clear()
+{
+	mParent.clear();
+	mSubtreeEnd.clear();
+
+	for(auto* v : { &mTx, &mTy, &mTz, &mQx, &mQy, &mQz, &mQw, &mSx, &mSy, &mSz })
+		v->clear();
+
+	mWorld.clear();
+	mIndexToId.clear();
+	mIdToIndex.clear();
+	mDirty.clear();
+	mChanged.clear();
+
+	mOrderDirty = false;
+	mAllDirty = false;
+}
+
+void SceneGraph::Reserve(uint32_t nodeCount)
+{
+	mParent.reserve(nodeCount);
+	mSubtreeEnd.reserve(nodeCount);
+
+	for(auto* v : { &mTx, &mTy, &mTz, &mQx, &mQy, &mQz, &mQw, &mSx, &mSy, &mSz })
+		v->reserve(nodeCount);
+
+	mWorld.reserve(nodeCount);
+	mIndexToId.reserve(nodeCount);
+	mIdToIndex.reserve(nodeCount);
+}
+
+SceneGraph::NodeId SceneGraph::CreateNode(NodeId parent, const Transform& local)
+{
+	const uint32_t index = NodeCount();
+	const NodeId id = static_cast<NodeId>(mIdToIndex.size());
+
+	const uint32_t parentIndex = parent == InvalidNode ? InvalidNode : mIdToIndex[parent];
+
+	mParent.push_back(parentIndex);
+	mSubtreeEnd.push_back(index + 1);
+
+	mTx.push_back(local.Translation[0]);
+	mTy.push_back(local.Translation[1]);
+	mTz.push_back(local.Translation[2]);
+	mQx.push_back(local.Rotation[0]);
+	mQy.push_back(local.Rotation[1]);
+	mQz.push_back(local.Rotation[2]);
+	mQw.push_back(local.Rotation[3]);
+	mSx.push_back(local.Scale[0]);
+	mSy.push_back(local.Scale[1]);
+	mSz.push_back(local.Scale[2]);
+
+	mWorld.emplace_back();
+	mIndexToId.push_back(id);
+	mIdToIndex.push_back(index);
+
+	// Appending keeps the depth-first order only if the parent's subtree currently ends
+	// at the back; then the parent and all its ancestors simply grow by one node.
+	if(parentIndex != InvalidNode && !mOrderDirty)
+	{
+		if(mSubtreeEnd[parentIndex] == index)
+		{
+			for(uint32_t a = parentIndex; a != InvalidNode; a = mParent[a])
+				mSubtreeEnd[a] = index + 1;
+		}
+		else
+		{
+			mOrderDirty = true;
+		}
+	}
+
+	if(!mAllDirty)
+		mDirty.push_back(id);
+
+	return id;
+}
+
+void SceneGraph::SetLocal(NodeId node, const Transform& local)
+{
+	const uint32_t i = mIdToIndex[node];
+
+	mTx[i] = local.Translation[0];
+	mTy[i] = local.Translation[1];
+	mTz[i] = local.Translation[2];
+	mQx[i] = local.Rotation[0];
+	mQy[i] = local.Rotation[1];
+	mQz[i] = local.Rotation[2];
+	mQw[i] = local.Rotation[3];
+	mSx[i] = local.Scale[0];
+	mSy[i] = local.Scale[1];
+	mSz[i] = local.Scale[2];
+
+	if(!mAllDirty)
+		mDirty.push_back(node);
+}
+
+SceneGraph::Transform SceneGraph::GetLocal(NodeId node) const
+{
+	const uint32_t i = mIdToIndex[node];
+
+	Transform t;
+	t.Translation[0] = mTx[i];
+	t.Translation[1] = mTy[i];
+	t.Translation[2] = mTz[i];
+	t.Rotation[0] = mQx[i];
+	t.Rotation[1] = mQy[i];
+	t.Rotation[2] = mQz[i];
+	t.Rotation[3] = mQw[i];
+	t.Scale[0] = mSx[i];
+	t.Scale[1] = mSy[i];
+	t.Scale[2] = mSz[i];
+	return t;
+}
+
+void SceneGraph::MarkAllDirty()
+{
+	mAllDirty = true;
+	mDirty.clear();
+}
+
+void SceneGraph::RebuildOrder()
+{
+	PROFILE_ZONE("SceneGraph::RebuildOrder");
+
+	const uint32_t n = NodeCount();
+
+	// Parents always precede children in the current order (a parent must exist when its
+	// child is created), so subtree sizes come from one reverse pass and the new
+	// depth-first positions from one forward pass.  Siblings keep their creation order.
+	std::vector<uint32_t> size(n, 1);
+	for(uint32_t i = n; i-- > 0;)
+	{
+		if(mParent[i] != InvalidNode)
+			size[mParent[i]] += size[i];
+	}
+
+	std::vector<uint32_t> position(n);
+	std::vector<uint32_t> nextChildSlot(n);
+	uint32_t nextRoot = 0;
+
+	for(uint32_t i = 0; i < n; ++i)
+	{
+		const uint32_t p = mParent[i];
+		position[i] = p == InvalidNode ? nextRoot : nextChildSlot[p];
+
+		if(p == InvalidNode)
+			nextRoot += size[i];
+		else
+			nextChildSlot[p] += size[i];
+
+		nextChildSlot[i] = position[i] + 1;
+	}
+
+	auto permute = [&](auto& values)
+	{
+		std::remove_reference_t<decltype(values)> sorted(values.size());
+		for(uint32_t i = 0; i < n; ++i)
+			sorted[position[i]] = values[i];
+		values.swap(sorted);
+	};
+
+	std::vector<uint32_t> parent(n), subtreeEnd(n);
+	for(uint32_t i = 0; i < n; ++i)
+	{
+		parent[position[i]] = mParent[i] == InvalidNode ? InvalidNode : position[mParent[i]];
+		subtreeEnd[position[i]] = position[i] + size[i];
+	}
+	mParent.swap(parent);
+	mSubtreeEnd.swap(subtreeEnd);
+
+	for(auto* v : { &mTx, &mTy, &mTz, &mQx, &mQy, &mQz, &mQw, &mSx, &mSy, &mSz })
+		permute(*v);
+
+	permute(mIndexToId);
+	for(uint32_t i = 0; i < n; ++i)
+		mIdToIndex[mIndexToId[i]] = i;
+
+	mOrderDirty = false;
+	MarkAllDirty();
+}
+
+void SceneGraph::UpdateBlock(uint32_t begin, uint32_t end)
+{
+	const BatchTransform::TRSArrays trs =
+	{
+		mTx.data() + begin, mTy.data() + begin, mTz.data() + begin,
+		mQx.data() + begin, mQy.data() + begin, mQz.data() + begin, mQw.data() + begin,
+		mSx.data() + begin, mSy.data() + begin, mSz.data() + begin
+	};
+
+	Float4x4 local[BlockSize];
+	BatchTransform::ComposeTRS(trs, 0, end - begin, local, nullptr);
+
+	for(uint32_t i = begin; i < end; ++i)
+	{
+		const uint32_t p = mParent[i];
+
+		if(p == InvalidNode)
+			mWorld[i] = local[i - begin];
+		else
+			MultiplyAffine(local[i - begin], mWorld[p], mWorld[i]);
+	}
+}
+
+void SceneGraph::UpdateRange(uint32_t begin, uint32_t end)
+{
+	// Any node's parent is either earlier in the range or was finished before the range started.
+	for(uint32_t b = begin; b < end; b += BlockSize)
+		UpdateBlock(b, std::min(end, b + BlockSize));
+}
+
+void SceneGraph::CollectDirtyRanges(std::vector<Range>& ranges)
+{
+	const uint32_t n = NodeCount();
+
+	if(mAllDirty)
+	{
+		for(uint32_t i = 0; i < n; i = mSubtreeEnd[i])
+			ranges.push_back({ i, mSubtreeEnd[i] });
+		return;
+	}
+
+	std::vector<uint32_t> dirty;
+	dirty.reserve(mDirty.size());
+	for(NodeId id : mDirty)
+		dirty.push_back(mIdToIndex[id]);
+
+	std::sort(dirty.begin(), dirty.end());
+
+	// A dirty node inside an already collected subtree is covered by it.
+	uint32_t coveredEnd = 0;
+	for(uint32_t i : dirty)
+	{
+		if(i < coveredEnd)
+			continue;
+
+		ranges.push_back({ i, mSubtreeEnd[i] });
+		coveredEnd = mSubtreeEnd[i];
+	}
+}
+
+uint32_t SceneGraph::Update(bool parallel)
+{
+	PROFILE_ZONE("SceneGraph::Update");
+
+	if(mOrderDirty)
+		RebuildOrder();
+
+	mChanged.clear();
+	CollectDirtyRanges(mChanged);
+
+	mDirty.clear();
+	mAllDirty = false;
+
+	uint32_t recomputed = 0;
+	for(const Range& r : mChanged)
+		recomputed += r.End - r.Begin;
+
+	if(!parallel || recomputed <= SplitThreshold)
+	{
+		for(const Range& r : mChanged)
+			UpdateRange(r.Begin, r.End);
+		return recomputed;
+	}
+
+	// Dirty subtrees are independent of each other.  A subtree too large for one job gets
+	// its root computed here; its child subtrees are then independent too.  Runs of small
+	// sibling subtrees are merged into one job, since they are contiguous.
+	std::vector<Range> pending(mChanged);
+	std::vector<Range> jobs;
+
+	for(size_t k = 0; k < pending.size(); ++k)
+	{
+		const Range r = pending[k];
+
+		if(r.End - r.Begin <= SplitThreshold)
+		{
+			jobs.push_back(r);
+			continue;
+		}
+
+		UpdateRange(r.Begin, r.Begin + 1);
+
+		uint32_t runBegin = r.Begin + 1;
+		for(uint32_t c = r.Begin + 1; c < r.End; c = mSubtreeEnd[c])
+		{
+			const uint32_t childEnd = mSubtreeEnd[c];
+
+			if(childEnd - c > SplitThreshold)
+			{
+				if(runBegin < c)
+					jobs.push_back({ runBegin, c });
+				pending.push_back({ c, childEnd });
+				runBegin = childEnd;
+			}
+			else if(childEnd - runBegin > SplitThreshold)
+			{
+				if(runBegin < c)
+					jobs.push_back({ runBegin, c });
+				runBegin = c;
+			}
+		}
+
+		if(runBegin < r.End)
+			jobs.push_back({ runBegin, r.End });
+	}
+
+	JobSystem::ParallelFor(static_cast<uint32_t>(jobs.size()), 1, [this, &jobs](uint32_t begin, uint32_t end)
+	{
+		PROFILE_ZONE("SceneGraph::UpdateRange");
+
+		for(uint32_t k = begin; k < end; ++k)
+			UpdateRange(jobs[k].Begin, jobs[k].End);
+	});
+
+	return recomputed;
+}
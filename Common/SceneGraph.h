@@ -0,0 +1,93 @@
+//***************************************************************************************
+// SceneGraph.h
+//
+// Data-oriented transform hierarchy.  Nodes live in contiguous structure-of-arrays
+// storage sorted in depth-first order, so every parent precedes its children and every
+// subtree is one contiguous index range [i, SubtreeEnd(i)).  Callers hold stable NodeIds;
+// the dense order is rebuilt lazily after structural changes.
+//
+// Update() recomputes only the subtrees under nodes whose local transform changed.
+// Disjoint dirty subtrees - and the child subtrees of a large dirty subtree - are
+// independent, so they are updated in parallel on the JobSystem.
+//***************************************************************************************
+
+#pragma once
+
+#include "BatchTransform.h"
+
+#include <cstdint>
+#include <vector>
+
+class SceneGraph
+{
+public:
+	using NodeId = uint32_t;
+	static constexpr NodeId InvalidNode = 0xFFFFFFFFu;
+
+	struct Transform
+	{
+		float Translation[3] = { 0.0f, 0.0f, 0.0f };
+		float Rotation[4] = { 0.0f, 0.0f, 0.0f, 1.0f }; // unit quaternion x, y, z, w
+		float Scale[3] = { 1.0f, 1.0f, 1.0f };
+	};
+
+	// Half-open range of dense indices.
+	struct Range
+	{
+		uint32_t Begin;
+		uint32_t End;
+	};
+
+	// Dirty subtrees larger than this are split into their child subtrees for parallel update.
+	uint32_t SplitThreshold = 4096;
+
+	void Clear();
+	void Reserve(uint32_t nodeCount);
+
+	// parent must already exist (or be InvalidNode for a root).
+	NodeId CreateNode(NodeId parent, const Transform& local);
+	NodeId CreateNode(NodeId parent) { return CreateNode(parent, Transform()); }
+
+	void SetLocal(NodeId node, const Transform& local);
+	Transform GetLocal(NodeId node) const;
+
+	// Marks every node dirty, e.g. to measure a full update.
+	void MarkAllDirty();
+
+	// Recomputes world matrices of dirty subtrees.  Returns the number of nodes recomputed.
+	uint32_t Update(bool parallel = true);
+
+	// Ranges recomputed by the last Update, in dense indices (see IdAt).
+	const std::vector<Range>& ChangedRanges() const { return mChanged; }
+
+	uint32_t NodeCount() const { return static_cast<uint32_t>(mParent.size()); }
+	NodeId IdAt(uint32_t index) const { return mIndexToId[index]; }
+
+	// World matrix (row-major, row vectors) as of the last Update.
+	const BatchTransform::Float4x4& World(NodeId node) const { return mWorld[mIdToIndex[node]]; }
+
+private:
+	void RebuildOrder();
+	void UpdateRange(uint32_t begin, uint32_t end);
+	void UpdateBlock(uint32_t begin, uint32_t end);
+	void CollectDirtyRanges(std::vector<Range>& ranges);
+
+	// Dense, depth-first order.
+	std::vector<uint32_t> mParent;      // dense index of the parent, InvalidNode for roots
+	std::vector<uint32_t> mSubtreeEnd;  // one past the last descendant
+
+	std::vector<float> mTx, mTy, mTz;
+	std::vector<float> mQx, mQy, mQz, mQw;
+	std::vector<float> mSx, mSy, mSz;
+
+	std::vector<BatchTransform::Float4x4> mWorld;
+
+	std::vector<NodeId> mIndexToId;
+	std::vector<uint32_t> mIdToIndex;
+
+	std::vector<NodeId> mDirty;         // nodes whose local transform changed since the last Update
+	std::vector<Range> mChanged;
+
+	bool mOrderDirty = false;           // nodes were appended out of depth-first order
+	bool mAllDirty = false;
+};
@@ -0,0 +1,394 @@
+//***************************************************************************************
+// ShaderCache.cpp
+//***************************************************************************************
+
+#include "ShaderCache.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <unordered_set>
+
+namespace
+{
+	const uint32_t PackMagic = 0x43444853u; // "SHDC"
+	const uint32_t PackVersion = 1;
+
+	struct PackHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint64_t Salt;
+		uint64_t Checksum; // of everything after the header
+		uint32_t Count;
+		uint32_t Reserved;
+	};
+
+	// Followed by Size bytes of bytecode, padded to 8
+	struct PackEntry
+	{
+		uint64_t Key;
+		uint64_t Source;
+		uint32_t Size;
+		uint32_t Reserved;
+	};
+
+	static_assert(sizeof(PackHeader) == 32 && sizeof(PackEntry) == 24, "pack records must not change size");
+
+	const uint64_t HashSeed = 14695981039346656037ull;
+
+	// FNV-1a
+	uint64_t HashBytes(const void* data, size_t size, uint64_t hash)
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		for(size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	// Length first, so "ab" + "c" and "a" + "bc" differ
+	uint64_t HashString(const std::string& text, uint64_t hash)
+	{
+		const uint64_t size = text.size();
+		hash = HashBytes(&size, sizeof(size), hash);
+		return HashBytes(text.data(), text.size(), hash);
+	}
+
+	uint64_t RotateLeft(uint64_t value, int bits)
+	{
+		return (value << bits) | (value >> (64 - bits));
+	}
+
+	// Checksum of the pack body.  FNV-1a is one multiply per byte in a chain; this takes
+	// 8-byte words in four independent lanes (the xxHash64 round), several times faster on
+	// large packs, and only has to catch damage, not resist it.
+	uint64_t Checksum(const uint8_t* data, size_t size)
+	{
+		const uint64_t prime1 = 11400714785074694791ull;
+		const uint64_t prime2 = 14029467366897019727ull;
+
+		uint64_t lanes[4] = { HashSeed + prime1, HashSeed, HashSeed - prime2, HashSeed ^ prime1 };
+		size_t i = 0;
+		for(; i + 32 <= size; i += 32)
+		{
+			for(int lane = 0; lane < 4; ++lane)
+			{
+				uint64_t word;
+				std::memcpy(&word, data + i + 8 * lane, sizeof(word));
+				lanes[lane] = RotateLeft(lanes[lane] + word * prime2, 31) * prime1;
+			}
+		}
+
+		uint64_t hash = size;
+		for(uint64_t lane : lanes)
+			hash = HashBytes(&lane, sizeof(lane), hash);
+		return HashBytes(data + i, size - i, hash);
+	}
+
+	size_t Padded(size_t size)
+	{
+		return (size + 7) & ~size_t(7);
+	}
+
+	void HashFile(const std::filesystem::path& path, std::unordered_set<std::string>& visited, uint64_t& hash)
+	{
+		const std::string name = path.lexically_normal().generic_string();
+		if(!visited.insert(name).second)
+			return;
+
+		hash = HashString(name, hash);
+
+		std::ifstream in(path, std::ios::binary);
+		if(!in)
+		{
+			hash = HashString("<missing>", hash);
+			return;
+		}
+
+		const std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+		hash = HashString(text, hash);
+
+		// #include "file" and #include <file>, one per line
+		const size_t size = text.size();
+		for(size_t pos = 0; pos < size;)
+		{
+			size_t end = text.find('\n', pos);
+			if(end == std::string::npos)
+				end = size;
+
+			size_t i = pos;
+			auto skipBlanks = [&]() { while(i < end && (text[i] == ' ' || text[i] == '\t')) ++i; };
+
+			skipBlanks();
+			if(i < end && text[i] == '#')
+			{
+				++i;
+				skipBlanks();
+				if(text.compare(i, 7, "include") == 0)
+				{
+					i += 7;
+					skipBlanks();
+					if(i < end && (text[i] == '"' || text[i] == '<'))
+					{
+						const char close = text[i] == '"' ? '"' : '>';
+						const size_t first = i + 1;
+						const size_t last = text.find(close, first);
+						if(last != std::string::npos && last < end)
+							HashFile(path.parent_path() / text.substr(first, last - first), visited, hash);
+					}
+				}
+			}
+
+			pos = end + 1;
+		}
+	}
+}
+
+ShaderCache::ShaderCache(std::string packPath, std::string salt) :
+	mPackPath(std::move(packPath)),
+	mSalt(HashString(salt, HashSeed))
+{
+}
+
+bool ShaderCache::Load()
+{
+	PROFILE_ZONE("ShaderCache::Load");
+
+	mEntries.clear();
+	mDirty = false;
+	mStats = Stats();
+
+	std::ifstream in(mPackPath, std::ios::binary | std::ios::ate);
+	if(!in)
+		return false;
+
+	const std::streamoff fileSize = in.tellg();
+	if(fileSize < std::streamoff(sizeof(PackHeader)))
+		return false;
+
+	std::vector<uint8_t> pack(static_cast<size_t>(fileSize));
+	in.seekg(0);
+	if(!in.read(reinterpret_cast<char*>(pack.data()), fileSize))
+		return false;
+	mStats.BytesRead = pack.size();
+
+	PackHeader header;
+	std::memcpy(&header, pack.data(), sizeof(header));
+	if(header.Magic != PackMagic || header.Version != PackVersion || header.Salt != mSalt || header.Reserved != 0 ||
+		header.Checksum != Checksum(pack.data() + sizeof(header), pack.size() - sizeof(header)))
+		return false;
+
+	size_t offset = sizeof(header);
+	for(uint32_t i = 0; i < header.Count; ++i)
+	{
+		PackEntry record;
+		if(pack.size() - offset < sizeof(record))
+			break;
+		std::memcpy(&record, pack.data() + offset, sizeof(record));
+		offset += sizeof(record);
+
+		if(pack.size() - offset < record.Size)
+			break;
+		const uint8_t* bytes = pack.data() + offset;
+		offset += (std::min)(Padded(record.Size), pack.size() - offset);
+
+		mEntries[record.Key] = { record.Source, std::vector<uint8_t>(bytes, bytes + record.Size) };
+	}
+
+	// A checksum that matches a pack that does not parse means a writer bug: start over
+	if(offset != pack.size() || mEntries.size() != header.Count)
+	{
+		mEntries.clear();
+		return false;
+	}
+
+	mStats.Loaded = true;
+	return true;
+}
+
+void ShaderCache::Save()
+{
+	PROFILE_ZONE("ShaderCache::Save");
+
+	if(!mDirty)
+		return;
+
+	size_t size = sizeof(PackHeader);
+	for(const auto& entry : mEntries)
+		size += sizeof(PackEntry) + Padded(entry.second.Bytecode.size());
+
+	std::vector<uint8_t> pack(size, 0);
+	size_t offset = sizeof(PackHeader);
+	for(const auto& entry : mEntries)
+	{
+		const std::vector<uint8_t>& bytecode = entry.second.Bytecode;
+		const PackEntry record = { entry.first, entry.second.Source, static_cast<uint32_t>(bytecode.size()), 0 };
+		std::memcpy(&pack[offset], &record, sizeof(record));
+		offset += sizeof(record);
+
+		if(!bytecode.empty())
+			std::memcpy(&pack[offset], bytecode.data(), bytecode.size());
+		offset += Padded(bytecode.size());
+	}
+
+	PackHeader header = {};
+	header.Magic = PackMagic;
+	header.Version = PackVersion;
+	header.Salt = mSalt;
+	header.Checksum = Checksum(pack.data() + sizeof(header), pack.size() - sizeof(header));
+	header.Count = static_cast<uint32_t>(mEntries.size());
+	std::memcpy(pack.data(), &header, sizeof(header));
+
+	// Written aside and renamed, so a reader never sees half a pack
+	namespace fs = std::filesystem;
+	const fs::path target(mPackPath);
+	std::error_code error;
+	if(target.has_parent_path())
+		fs::create_directories(target.parent_path(), error);
+
+	fs::path temporary = target;
+	temporary += ".tmp";
+	{
+		std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+		out.write(reinterpret_cast<const char*>(pack.data()), std::streamsize(pack.size()));
+		if(!out)
+			throw std::runtime_error("ShaderCache: cannot write " + temporary.string());
+	}
+
+	fs::rename(temporary, target, error);
+	if(error)
+		throw std::runtime_error("ShaderCache: cannot write " + target.string());
+
+	mStats.BytesWritten += pack.size();
+	mDirty = false;
+}
+
+void ShaderCache::Get(const Key* keys, size_t count, const Compiler& compile, std::vector<const std::vector<uint8_t>*>& bytecode,
+	bool parallel)
+{
+	PROFILE_ZONE("ShaderCache::Get");
+
+	std::vector<uint64_t> keyHashes(count);
+	std::vector<uint64_t> sourceHashes(count);
+	std::unordered_map<std::string, uint64_t> fileHashes; // one pass over each source per call
+
+	// Keys to compile, each once even if asked for twice
+	std::vector<size_t> misses;
+	std::unordered_set<uint64_t> queued;
+
+	for(size_t i = 0; i < count; ++i)
+	{
+		keyHashes[i] = HashKey(keys[i]);
+
+		auto file = fileHashes.find(keys[i].File);
+		if(file == fileHashes.end())
+			file = fileHashes.emplace(keys[i].File, HashSource(keys[i].File)).first;
+		sourceHashes[i] = file->second;
+
+		const auto entry = mEntries.find(keyHashes[i]);
+		if(entry != mEntries.end() && entry->second.Source == sourceHashes[i])
+		{
+			++mStats.Hits;
+			continue;
+		}
+
+		if(!queued.insert(keyHashes[i]).second)
+			continue;
+
+		if(entry == mEntries.end())
+			++mStats.Misses;
+		else
+			++mStats.Stale;
+		misses.push_back(i);
+	}
+
+	std::vector<std::vector<uint8_t>> compiled(misses.size());
+	std::vector<std::exception_ptr> errors(misses.size());
+
+	auto compileRange = [&](uint32_t begin, uint32_t end)
+	{
+		for(uint32_t m = begin; m < end; ++m)
+		{
+			try
+			{
+				compiled[m] = compile(keys[misses[m]]);
+			}
+			catch(...)
+			{
+				errors[m] = std::current_exception();
+			}
+		}
+	};
+
+	if(parallel && misses.size() > 1)
+		JobSystem::ParallelFor(static_cast<uint32_t>(misses.size()), 1, compileRange);
+	else
+		compileRange(0, static_cast<uint32_t>(misses.size()));
+
+	// Keep what did compile, so one broken shader does not cost the others next time
+	std::exception_ptr firstError;
+	for(size_t m = 0; m < misses.size(); ++m)
+	{
+		if(errors[m])
+		{
+			if(!firstError)
+				firstError = errors[m];
+			continue;
+		}
+
+		const size_t i = misses[m];
+		mEntries[keyHashes[i]] = { sourceHashes[i], std::move(compiled[m]) };
+		mDirty = true;
+	}
+
+	if(firstError)
+		std::rethrow_exception(firstError);
+
+	bytecode.resize(count);
+	for(size_t i = 0; i < count; ++i)
+		bytecode[i] = &mEntries.at(keyHashes[i]).Bytecode;
+}
+
+const std::vector<uint8_t>& ShaderCache::Get(const Key& key, const Compiler& compile)
+{
+	std::vector<const std::vector<uint8_t>*> bytecode;
+	Get(&key, 1, compile, bytecode, false);
+	return *bytecode[0];
+}
+
+uint64_t ShaderCache::HashKey(const Key& key)
+{
+	const std::string file = std::filesystem::path(key.File).lexically_normal().generic_string();
+
+	uint64_t hash = HashString(file, HashSeed);
+	hash = HashString(key.EntryPoint, hash);
+	hash = HashString(key.Target, hash);
+	hash = HashBytes(&key.Flags, sizeof(key.Flags), hash);
+
+	const uint64_t defineCount = key.Defines.size();
+	hash = HashBytes(&defineCount, sizeof(defineCount), hash);
+	for(const Define& define : key.Defines)
+	{
+		hash = HashString(define.Name, hash);
+		hash = HashString(define.Value, hash);
+	}
+
+	return hash;
+}
+
+uint64_t ShaderCache::HashSource(const std::string& file)
+{
+	std::unordered_set<std::string> visited;
+	uint64_t hash = HashSeed;
+	HashFile(std::filesystem::path(file), visited, hash);
+	return hash;
+}
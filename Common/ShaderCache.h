@@ -0,0 +1,101 @@
+//***************************************************************************************
+// ShaderCache.h
+//
+// Compiled shader bytecode kept between runs, so startup reads blobs instead of running
+// the HLSL compiler.
+//
+//   -Key: a shader is the source file, entry point, target, defines and compile flags;
+//    their hash finds its entry.  Next to the bytecode the entry keeps a hash of the
+//    source and of every file it includes, so editing any of them recompiles it.
+//   -Pack: every entry lives in one file, read with a single read and checked as a
+//    whole; a missing, foreign or damaged pack just starts empty.  The salt passed at
+//    construction (compiler version and the like) is part of the pack, so bytecode
+//    from another compiler is never used.
+//   -Misses are compiled on the job system, one shader per job.
+//
+// Nothing here touches Direct3D: the caller passes the compiler, so the cache runs
+// as-is against a fake one in tests.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class ShaderCache
+{
+public:
+	struct Define
+	{
+		std::string Name;
+		std::string Value;
+	};
+
+	struct Key
+	{
+		std::string File;
+		std::string EntryPoint;
+		std::string Target;           // "vs_5_1"
+		std::vector<Define> Defines;
+		uint32_t Flags = 0;           // D3DCOMPILE_* flags
+	};
+
+	// Compiles one shader; throws on a compile error.  Called from worker threads.
+	using Compiler = std::function<std::vector<uint8_t>(const Key& key)>;
+
+	struct Stats
+	{
+		bool Loaded = false;       // the pack was read and accepted
+		uint32_t Hits = 0;
+		uint32_t Misses = 0;       // no entry for the key
+		uint32_t Stale = 0;        // entry for an older source
+		uint64_t BytesRead = 0;
+		uint64_t BytesWritten = 0;
+	};
+
+	ShaderCache(std::string packPath, std::string salt);
+
+	// Reads the pack.  Returns false, leaving the cache empty, if there is none or it was
+	// written with another salt or is damaged.
+	bool Load();
+
+	// Writes the pack if any entry changed since Load(): to a temporary file that is then
+	// renamed over the old one.  Throws std::runtime_error if it cannot be written.
+	void Save();
+
+	// Bytecode for each key, compiling the missing and stale ones.  The pointers stay
+	// valid until the cache is loaded again or destroyed.  The first exception thrown
+	// by compile is rethrown here, after the other shaders have finished.
+	void Get(const Key* keys, size_t count, const Compiler& compile, std::vector<const std::vector<uint8_t>*>& bytecode,
+		bool parallel = true);
+	const std::vector<uint8_t>& Get(const Key& key, const Compiler& compile);
+
+	// Hash of everything but the source text.
+	static uint64_t HashKey(const Key& key);
+
+	// Hash of a source file and, recursively, of every file it #includes.  Includes are
+	// resolved against the directory of the including file, as the compiler's standard
+	// include handler does, and lines inside #if blocks are included too; a file that
+	// cannot be read hashes by name, so creating it later invalidates the entry.
+	static uint64_t HashSource(const std::string& file);
+
+	size_t EntryCount() const { return mEntries.size(); }
+	const Stats& GetStats() const { return mStats; }
+
+private:
+	struct Entry
+	{
+		uint64_t Source;
+		std::vector<uint8_t> Bytecode;
+	};
+
+	std::string mPackPath;
+	uint64_t mSalt;
+	std::unordered_map<uint64_t, Entry> mEntries; // by HashKey
+	bool mDirty = false;
+	Stats mStats;
+};
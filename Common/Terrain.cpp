@@ -0,0 +1,578 @@
+//***************************************************************************************
+// Terrain.cpp
+//***************************************************************************************
+
+#include "Terrain.h"
+#include "Clock.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+	uint32_t DivideUp(uint32_t a, uint32_t b)
+	{
+		return (a + b - 1) / b;
+	}
+
+	float SquaredDistance(const RenderWorld::Aabb& box, const float p[3])
+	{
+		float d = 0.0f;
+		for(int c = 0; c < 3; ++c)
+		{
+			const float v = std::max(std::fabs(p[c] - box.Center[c]) - box.Extents[c], 0.0f);
+			d += v * v;
+		}
+		return d;
+	}
+}
+
+void Terrain::Open(const char* path, const Desc& desc)
+{
+	mFile.Open(path);
+
+	if(mFile.Size() != uint64_t(desc.Width) * desc.Height * sizeof(uint16_t))
+	{
+		mFile.Close();
+		throw std::runtime_error(std::string("Terrain: '") + path + "' does not hold Width x Height 16-bit samples");
+	}
+
+	mSamples = reinterpret_cast<const uint16_t*>(mFile.Data());
+	Initialize(desc);
+}
+
+void Terrain::Open(const uint16_t* samples, const Desc& desc)
+{
+	mFile.Close();
+	mSamples = samples;
+	Initialize(desc);
+}
+
+void Terrain::Initialize(const Desc& desc)
+{
+	if(desc.Width < 2 || desc.Height < 2)
+		throw std::invalid_argument("Terrain: the heightfield needs at least 2 x 2 samples");
+	if(desc.PatchSize < 2 || desc.PatchSize > 128 || (desc.PatchSize & (desc.PatchSize - 1)) != 0)
+		throw std::invalid_argument("Terrain: PatchSize must be a power of two between 2 and 128");
+
+	mDesc = desc;
+	if(mDesc.LodDistance <= 0.0f)
+		mDesc.LodDistance = 2.0f * mDesc.PatchSize * mDesc.SampleSpacing;
+	mDesc.SlotBudget = std::max(mDesc.SlotBudget, 1u);
+
+	mLevels.clear();
+	uint32_t w = DivideUp(mDesc.Width - 1, mDesc.PatchSize);
+	uint32_t h = DivideUp(mDesc.Height - 1, mDesc.PatchSize);
+	while(true)
+	{
+		Level level;
+		level.Width = w;
+		level.Height = h;
+		level.MinHeight.resize(size_t(w) * h);
+		level.MaxHeight.resize(size_t(w) * h);
+		level.Refined.assign(size_t(w) * h, 0);
+		mLevels.push_back(std::move(level));
+
+		if(w == 1 && h == 1)
+			break;
+		w = DivideUp(w, 2);
+		h = DivideUp(h, 2);
+	}
+
+	BuildIndices();
+	BuildBounds();
+
+	mPool.clear();
+	mPool.reserve(size_t(mDesc.SlotBudget) * PatchVertexCount());
+	mSlotCount = 0;
+	mSlotKey.clear();
+	mSlotFrame.clear();
+	mResident.clear();
+	mFrame = 0;
+	mStats = Stats();
+}
+
+void Terrain::BuildIndices()
+{
+	const uint32_t P = mDesc.PatchSize;
+	const uint32_t row = P + 1;
+
+	mIndices.clear();
+
+	for(uint32_t stitch = 0; stitch < 16; ++stitch)
+	{
+		mStitchRanges[stitch].Start = static_cast<uint32_t>(mIndices.size());
+
+		// Odd vertices of a stitched edge fold onto the even vertex before them; the
+		// triangles that touched them either collapse or fan out from the even one.
+		auto vertex = [&](uint32_t c, uint32_t r)
+		{
+			if((stitch & EdgeMinZ) && r == 0 && (c & 1))
+				--c;
+			if((stitch & EdgeMaxZ) && r == P && (c & 1))
+				--c;
+			if((stitch & EdgeMinX) && c == 0 && (r & 1))
+				--r;
+			if((stitch & EdgeMaxX) && c == P && (r & 1))
+				--r;
+			return static_cast<uint16_t>(r * row + c);
+		};
+
+		auto triangle = [&](uint16_t a, uint16_t b, uint16_t c)
+		{
+			if(a == b || b == c || a == c)
+				return;
+			mIndices.push_back(a);
+			mIndices.push_back(b);
+			mIndices.push_back(c);
+		};
+
+		// Three distinct vertices in a line; only folding makes these, at the corner
+		// between two stitched edges
+		auto flat = [&](uint16_t a, uint16_t b, uint16_t c)
+		{
+			const int ax = a % row, az = a / row;
+			const int bx = b % row, bz = b / row;
+			const int cx = c % row, cz = c / row;
+			return a != b && b != c && a != c && (bx - ax) * (cz - az) - (bz - az) * (cx - ax) == 0;
+		};
+
+		// Clockwise seen from +y, like the rest of the scene
+		for(uint32_t r = 0; r < P; ++r)
+		{
+			for(uint32_t c = 0; c < P; ++c)
+			{
+				const uint16_t v00 = vertex(c, r);
+				const uint16_t v01 = vertex(c, r + 1);
+				const uint16_t v10 = vertex(c + 1, r);
+				const uint16_t v11 = vertex(c + 1, r + 1);
+
+				// The other diagonal there, or v00 would sit on an edge it isn't part of
+				if(flat(v00, v01, v10))
+				{
+					triangle(v00, v01, v11);
+					triangle(v00, v11, v10);
+				}
+				else
+				{
+					triangle(v00, v01, v10);
+					triangle(v01, v11, v10);
+				}
+			}
+		}
+
+		mStitchRanges[stitch].Count = static_cast<uint32_t>(mIndices.size()) - mStitchRanges[stitch].Start;
+	}
+}
+
+void Terrain::BuildBounds()
+{
+	PROFILE_ZONE("Terrain::BuildBounds");
+
+	const uint32_t P = mDesc.PatchSize;
+	Level& patches = mLevels[0];
+
+	// Patch rows in parallel; each reads its P + 1 sample rows once
+	JobSystem::ParallelFor(patches.Height, 1, [&](uint32_t begin, uint32_t end)
+	{
+		for(uint32_t pz = begin; pz < end; ++pz)
+		{
+			uint16_t* minRow = &patches.MinHeight[size_t(pz) * patches.Width];
+			uint16_t* maxRow = &patches.MaxHeight[size_t(pz) * patches.Width];
+			std::fill(minRow, minRow + patches.Width, uint16_t(0xFFFF));
+			std::fill(maxRow, maxRow + patches.Width, uint16_t(0));
+
+			const uint32_t z1 = std::min(pz * P + P, mDesc.Height - 1);
+			for(uint32_t z = pz * P; z <= z1; ++z)
+			{
+				const uint16_t* samples = mSamples + size_t(z) * mDesc.Width;
+
+				for(uint32_t px = 0; px < patches.Width; ++px)
+				{
+					const uint32_t x1 = std::min(px * P + P, mDesc.Width - 1);
+
+					uint16_t lo = minRow[px];
+					uint16_t hi = maxRow[px];
+					for(uint32_t x = px * P; x <= x1; ++x)
+					{
+						lo = std::min(lo, samples[x]);
+						hi = std::max(hi, samples[x]);
+					}
+					minRow[px] = lo;
+					maxRow[px] = hi;
+				}
+			}
+		}
+	});
+
+	for(size_t l = 1; l < mLevels.size(); ++l)
+	{
+		const Level& src = mLevels[l - 1];
+		Level& dst = mLevels[l];
+
+		for(uint32_t z = 0; z < dst.Height; ++z)
+		{
+			for(uint32_t x = 0; x < dst.Width; ++x)
+			{
+				uint16_t lo = 0xFFFF;
+				uint16_t hi = 0;
+				for(uint32_t cz = z * 2; cz < std::min(z * 2 + 2, src.Height); ++cz)
+				{
+					for(uint32_t cx = x * 2; cx < std::min(x * 2 + 2, src.Width); ++cx)
+					{
+						lo = std::min(lo, src.MinHeight[size_t(cz) * src.Width + cx]);
+						hi = std::max(hi, src.MaxHeight[size_t(cz) * src.Width + cx]);
+					}
+				}
+				dst.MinHeight[size_t(z) * dst.Width + x] = lo;
+				dst.MaxHeight[size_t(z) * dst.Width + x] = hi;
+			}
+		}
+	}
+}
+
+RenderWorld::Aabb Terrain::NodeBounds(uint32_t level, uint32_t x, uint32_t z) const
+{
+	const Level& l = mLevels[level];
+	const uint32_t span = mDesc.PatchSize << level;
+	const size_t index = size_t(z) * l.Width + x;
+
+	const float minX = float(x * span) * mDesc.SampleSpacing;
+	const float maxX = float(std::min(x * span + span, mDesc.Width - 1)) * mDesc.SampleSpacing;
+	const float minZ = float(z * span) * mDesc.SampleSpacing;
+	const float maxZ = float(std::min(z * span + span, mDesc.Height - 1)) * mDesc.SampleSpacing;
+	const float minY = l.MinHeight[index] * mDesc.HeightScale;
+	const float maxY = l.MaxHeight[index] * mDesc.HeightScale;
+
+	RenderWorld::Aabb box;
+	box.Center[0] = 0.5f * (minX + maxX);
+	box.Center[1] = 0.5f * (minY + maxY);
+	box.Center[2] = 0.5f * (minZ + maxZ);
+	box.Extents[0] = 0.5f * (maxX - minX);
+	box.Extents[1] = 0.5f * (maxY - minY);
+	box.Extents[2] = 0.5f * (maxZ - minZ);
+	return box;
+}
+
+bool Terrain::InFrustum(uint32_t level, uint32_t x, uint32_t z) const
+{
+	const RenderWorld::Aabb box = NodeBounds(level, x, z);
+
+	for(const auto& p : mFrustum->Planes)
+	{
+		const float distance = p[0] * box.Center[0] + p[1] * box.Center[1] + p[2] * box.Center[2] + p[3];
+		const float radius = std::fabs(p[0]) * box.Extents[0] + std::fabs(p[1]) * box.Extents[1] + std::fabs(p[2]) * box.Extents[2];
+		if(distance + radius < 0.0f)
+			return false;
+	}
+
+	return true;
+}
+
+void Terrain::Select(const RenderWorld::Frustum& frustum, const float eye[3], std::vector<PatchDraw>& draws)
+{
+	PROFILE_ZONE("Terrain::Select");
+
+	draws.clear();
+	mStats = Stats();
+	if(mLevels.empty())
+		return;
+
+	++mFrame;
+	mFrustum = &frustum;
+	std::copy(eye, eye + 3, mEye);
+
+	for(Level& l : mLevels)
+		std::fill(l.Refined.begin(), l.Refined.end(), uint8_t(0));
+
+	const uint32_t top = Levels() - 1;
+
+	mLeaves.clear();
+	Refine(top, 0, 0);
+	Balance();
+	Emit(top, 0, 0, draws);
+
+	mStats.Selected = static_cast<uint32_t>(draws.size());
+	Stream(draws);
+
+	mFrustum = nullptr;
+}
+
+void Terrain::Refine(uint32_t level, uint32_t x, uint32_t z)
+{
+	++mStats.Visited;
+
+	// Nodes outside the frustum stay coarse; Emit counts them as culled
+	if(!InFrustum(level, x, z))
+		return;
+
+	const float range = mDesc.LodDistance * float(1u << level) * 0.5f;
+	if(level == 0 || SquaredDistance(NodeBounds(level, x, z), mEye) >= range * range)
+	{
+		mLeaves.push_back(Key(level, x, z));
+		return;
+	}
+
+	Level& l = mLevels[level];
+	l.Refined[size_t(z) * l.Width + x] = 1;
+
+	const Level& children = mLevels[level - 1];
+	for(uint32_t cz = z * 2; cz < std::min(z * 2 + 2, children.Height); ++cz)
+	{
+		for(uint32_t cx = x * 2; cx < std::min(x * 2 + 2, children.Width); ++cx)
+			Refine(level - 1, cx, cz);
+	}
+}
+
+uint32_t Terrain::LeafLevel(uint32_t level, int64_t x, int64_t z) const
+{
+	const Level& l = mLevels[level];
+	if(x < 0 || z < 0 || x >= l.Width || z >= l.Height)
+		return Levels();
+
+	uint32_t j = Levels() - 1;
+	while(j > level)
+	{
+		const Level& ancestor = mLevels[j];
+		const int64_t ax = x >> (j - level);
+		const int64_t az = z >> (j - level);
+		if(!ancestor.Refined[size_t(az) * ancestor.Width + size_t(ax)])
+			break;
+		--j;
+	}
+
+	return j;
+}
+
+void Terrain::Balance()
+{
+	PROFILE_ZONE("Terrain::Balance");
+
+	static const int Offsets[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+
+	while(!mLeaves.empty())
+	{
+		const uint64_t key = mLeaves.back();
+		mLeaves.pop_back();
+
+		const uint32_t level = uint32_t(key >> 48);
+		const uint32_t x = uint32_t(key >> 24) & 0xFFFFFF;
+		const uint32_t z = uint32_t(key) & 0xFFFFFF;
+
+		// Split by an earlier neighbour; its children were queued instead
+		const Level& l = mLevels[level];
+		if(l.Refined[size_t(z) * l.Width + x])
+			continue;
+
+		for(const auto& offset : Offsets)
+		{
+			const int64_t nx = int64_t(x) + offset[0];
+			const int64_t nz = int64_t(z) + offset[1];
+
+			// Split the coarse neighbour until it is at most one level above this leaf
+			while(true)
+			{
+				const uint32_t j = LeafLevel(level, nx, nz);
+				if(j == Levels() || j < level + 2)
+					break;
+
+				const uint32_t ax = uint32_t(nx >> (j - level));
+				const uint32_t az = uint32_t(nz >> (j - level));
+
+				// Cracks next to an invisible node can't be seen
+				if(!InFrustum(j, ax, az))
+					break;
+
+				Level& coarse = mLevels[j];
+				coarse.Refined[size_t(az) * coarse.Width + ax] = 1;
+				++mStats.Balanced;
+
+				const Level& children = mLevels[j - 1];
+				for(uint32_t cz = az * 2; cz < std::min(az * 2 + 2, children.Height); ++cz)
+				{
+					for(uint32_t cx = ax * 2; cx < std::min(ax * 2 + 2, children.Width); ++cx)
+					{
+						if(InFrustum(j - 1, cx, cz))
+							mLeaves.push_back(Key(j - 1, cx, cz));
+					}
+				}
+			}
+		}
+	}
+}
+
+void Terrain::Emit(uint32_t level, uint32_t x, uint32_t z, std::vector<PatchDraw>& draws)
+{
+	const Level& l = mLevels[level];
+
+	if(l.Refined[size_t(z) * l.Width + x])
+	{
+		const Level& children = mLevels[level - 1];
+		for(uint32_t cz = z * 2; cz < std::min(z * 2 + 2, children.Height); ++cz)
+		{
+			for(uint32_t cx = x * 2; cx < std::min(x * 2 + 2, children.Width); ++cx)
+				Emit(level - 1, cx, cz, draws);
+		}
+		return;
+	}
+
+	if(!InFrustum(level, x, z))
+	{
+		++mStats.Culled;
+		return;
+	}
+
+	PatchDraw draw;
+	draw.Level = level;
+	draw.X = x;
+	draw.Z = z;
+	draw.Slot = 0;
+
+	static const int Offsets[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+	static const uint32_t Edges[4] = { EdgeMinX, EdgeMaxX, EdgeMinZ, EdgeMaxZ };
+
+	draw.Stitch = 0;
+	for(int e = 0; e < 4; ++e)
+	{
+		const uint32_t j = LeafLevel(level, int64_t(x) + Offsets[e][0], int64_t(z) + Offsets[e][1]);
+		if(j != Levels() && j > level)
+			draw.Stitch |= Edges[e];
+	}
+	mStats.Stitched += draw.Stitch != 0 ? 1 : 0;
+
+	const uint32_t span = mDesc.PatchSize << level;
+	draw.Origin[0] = float(x * span) * mDesc.SampleSpacing;
+	draw.Origin[1] = float(z * span) * mDesc.SampleSpacing;
+	draw.Spacing = float(1u << level) * mDesc.SampleSpacing;
+
+	draws.push_back(draw);
+}
+
+void Terrain::Stream(std::vector<PatchDraw>& draws)
+{
+	PROFILE_ZONE("Terrain::Stream");
+
+	const int64_t start = Clock::Now();
+
+	std::vector<uint32_t> missing;
+	for(uint32_t i = 0; i < draws.size(); ++i)
+	{
+		auto it = mResident.find(Key(draws[i].Level, draws[i].X, draws[i].Z));
+		if(it != mResident.end())
+		{
+			draws[i].Slot = it->second;
+			mSlotFrame[it->second] = mFrame;
+		}
+		else
+		{
+			missing.push_back(i);
+		}
+	}
+
+	mStats.ResidentSlots = mSlotCount;
+	if(missing.empty())
+		return;
+
+	// Slots: growth up to the budget, then the least recently used
+	std::vector<uint32_t> slots;
+	slots.reserve(missing.size());
+
+	// A new slot counts as used this frame, so the scan below never hands it out again
+	auto grow = [&]()
+	{
+		slots.push_back(mSlotCount++);
+		mSlotKey.push_back(~0ull);
+		mSlotFrame.push_back(mFrame);
+	};
+
+	while(slots.size() < missing.size() && mSlotCount < mDesc.SlotBudget)
+		grow();
+
+	if(slots.size() < missing.size())
+	{
+		std::vector<uint32_t> candidates;
+		for(uint32_t s = 0; s < mSlotCount; ++s)
+		{
+			if(mSlotFrame[s] < mFrame)
+				candidates.push_back(s);
+		}
+
+		const size_t evict = std::min(candidates.size(), missing.size() - slots.size());
+		std::nth_element(candidates.begin(), candidates.begin() + evict, candidates.end(),
+			[this](uint32_t a, uint32_t b) { return mSlotFrame[a] < mSlotFrame[b]; });
+
+		for(size_t i = 0; i < evict; ++i)
+		{
+			mResident.erase(mSlotKey[candidates[i]]);
+			slots.push_back(candidates[i]);
+		}
+		mStats.Evicted = static_cast<uint32_t>(evict);
+
+		// Everything else is in use this frame: go over the budget
+		while(slots.size() < missing.size())
+			grow();
+	}
+
+	mPool.resize(size_t(mSlotCount) * PatchVertexCount());
+
+	for(size_t i = 0; i < missing.size(); ++i)
+	{
+		PatchDraw& draw = draws[missing[i]];
+		draw.Slot = slots[i];
+
+		const uint64_t key = Key(draw.Level, draw.X, draw.Z);
+		mSlotKey[draw.Slot] = key;
+		mSlotFrame[draw.Slot] = mFrame;
+		mResident.emplace(key, draw.Slot);
+	}
+
+	// Copy the samples; first touches of the mapping fault the pages in from disk
+	const uint32_t P = mDesc.PatchSize;
+	JobSystem::ParallelFor(static_cast<uint32_t>(missing.size()), 4, [&](uint32_t begin, uint32_t end)
+	{
+		for(uint32_t i = begin; i < end; ++i)
+		{
+			const PatchDraw& draw = draws[missing[i]];
+			const uint32_t step = 1u << draw.Level;
+			const uint32_t x0 = draw.X * (P << draw.Level);
+			const uint32_t z0 = draw.Z * (P << draw.Level);
+
+			uint16_t* dst = &mPool[size_t(draw.Slot) * PatchVertexCount()];
+			for(uint32_t r = 0; r <= P; ++r)
+			{
+				const uint32_t z = std::min(z0 + r * step, mDesc.Height - 1);
+				const uint16_t* src = mSamples + size_t(z) * mDesc.Width;
+
+				for(uint32_t c = 0; c <= P; ++c)
+					*dst++ = src[std::min(x0 + c * step, mDesc.Width - 1)];
+			}
+		}
+	});
+
+	mStats.Loaded = static_cast<uint32_t>(missing.size());
+	mStats.ResidentSlots = mSlotCount;
+	mStats.LoadMs = Clock::ToSeconds(Clock::Now() - start) * 1000.0;
+}
+
+bool Terrain::Validate() const
+{
+	if(mSlotKey.size() != mSlotCount || mSlotFrame.size() != mSlotCount ||
+		mPool.size() != size_t(mSlotCount) * PatchVertexCount())
+		return false;
+
+	// Every slot holds exactly one resident node and every resident node one slot
+	if(mResident.size() != mSlotCount)
+		return false;
+
+	for(const auto& resident : mResident)
+	{
+		if(resident.second >= mSlotCount || mSlotKey[resident.second] != resident.first)
+			return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,181 @@
+//***************************************************************************************
+// Terrain.h
+//
+// Chunked heightfield terrain.  The heightfield is tiled into square patches of
+// PatchSize x PatchSize quads and a quadtree is built over the patches.  A node at
+// level k covers 2^k x 2^k patches and is drawn as the same (PatchSize + 1)^2 vertex
+// grid, sampling every 2^k-th height, so every node of every LOD shares one index
+// buffer.  It holds 16 variants that differ only in which edges are stitched: on a
+// stitched edge every other vertex is folded into its neighbour, so the edge matches
+// a neighbour one level coarser exactly.
+//
+// Select() picks the nodes for a frame:
+//   -refine while the eye is closer to a node's box than LodDistance * 2^(level - 1),
+//    stopping at nodes outside the frustum;
+//   -refine coarse leaves further until visible neighbours differ by at most one
+//    level, which is what keeps the stitching crack-free;
+//   -emit the visible leaves with their stitch masks.
+//
+// Heights are raw little-endian uint16 samples, normally in a memory-mapped file.
+// Each selected node has its (PatchSize + 1)^2 samples copied into a slot of a
+// height pool.  A vertex shader can rebuild the vertex from SV_VertexID, the slot and
+// the node's origin and spacing, so there is no vertex buffer.  The pool keeps
+// SlotBudget slots and evicts the least recently used ones.  Nodes selected this
+// frame are never evicted, so a frame that needs more slots grows the pool.
+//
+// Node boxes come from a min/max pyramid built by one parallel pass over the
+// samples when the terrain is opened.
+//***************************************************************************************
+
+#pragma once
+
+#include "MappedFile.h"
+#include "RenderWorld.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class Terrain
+{
+public:
+	struct Desc
+	{
+		uint32_t Width = 0;  // samples along x
+		uint32_t Height = 0; // samples along z
+
+		// Quads per patch edge: a power of two up to 128, so patch indices fit 16 bits.
+		uint32_t PatchSize = 64;
+
+		float SampleSpacing = 1.0f; // world units between samples
+		float HeightScale = 1.0f;   // world units per raw sample unit
+
+		// Level-0 nodes are used within LodDistance of the eye and level-k nodes out to
+		// about LodDistance * 2^k.  0 picks two patch widths.
+		float LodDistance = 0.0f;
+
+		uint32_t SlotBudget = 1024;
+	};
+
+	// Edges of a node that are stitched to a neighbour one level coarser.
+	enum Edge : uint32_t
+	{
+		EdgeMinX = 1 << 0,
+		EdgeMaxX = 1 << 1,
+		EdgeMinZ = 1 << 2,
+		EdgeMaxZ = 1 << 3
+	};
+
+	struct PatchDraw
+	{
+		uint32_t Level;
+		uint32_t X; // in nodes of this level
+		uint32_t Z;
+		uint32_t Stitch; // Edge mask
+		uint32_t Slot;   // in the height pool
+
+		// World x, z of vertex (0, 0) and the distance between vertices.  Vertices past
+		// the last sample clamp to the terrain edge, as their samples do.
+		float Origin[2];
+		float Spacing;
+	};
+
+	struct IndexRange
+	{
+		uint32_t Start;
+		uint32_t Count;
+	};
+
+	struct Stats
+	{
+		uint32_t Visited = 0;  // nodes tested during refinement
+		uint32_t Balanced = 0; // splits added to keep neighbours within one level
+		uint32_t Culled = 0;   // leaves of the cut outside the frustum
+		uint32_t Selected = 0;
+		uint32_t Stitched = 0; // selected nodes with at least one stitched edge
+		uint32_t Loaded = 0;   // nodes streamed into the pool this frame
+		uint32_t Evicted = 0;
+		uint32_t ResidentSlots = 0;
+		double LoadMs = 0.0;
+	};
+
+	// Maps a file of Width * Height samples; throws if it cannot be opened or has the
+	// wrong size.
+	void Open(const char* path, const Desc& desc);
+
+	// Same, over samples owned by the caller, which must outlive the terrain.
+	void Open(const uint16_t* samples, const Desc& desc);
+
+	void Select(const RenderWorld::Frustum& frustum, const float eye[3], std::vector<PatchDraw>& draws);
+
+	// Shared by every node; vertex (column, row) of a node is row * (PatchSize + 1) + column.
+	const std::vector<uint16_t>& Indices() const { return mIndices; }
+	IndexRange StitchIndices(uint32_t stitch) const { return mStitchRanges[stitch & 15]; }
+
+	uint32_t PatchVertexCount() const { return (mDesc.PatchSize + 1) * (mDesc.PatchSize + 1); }
+
+	// PatchVertexCount() raw samples, row by row.
+	const uint16_t* SlotSamples(uint32_t slot) const { return &mPool[size_t(slot) * PatchVertexCount()]; }
+	uint32_t SlotCount() const { return mSlotCount; }
+
+	uint32_t Levels() const { return static_cast<uint32_t>(mLevels.size()); }
+	const Desc& GetDesc() const { return mDesc; }
+	const Stats& LastStats() const { return mStats; }
+
+	// Box of a node from the min/max pyramid.
+	RenderWorld::Aabb NodeBounds(uint32_t level, uint32_t x, uint32_t z) const;
+
+	// Checks that slots and resident nodes match one to one; for tests.
+	bool Validate() const;
+
+private:
+	struct Level
+	{
+		uint32_t Width;  // nodes
+		uint32_t Height;
+		std::vector<uint16_t> MinHeight;
+		std::vector<uint16_t> MaxHeight;
+		std::vector<uint8_t> Refined; // this frame
+	};
+
+	void Initialize(const Desc& desc);
+	void BuildIndices();
+	void BuildBounds();
+
+	bool InFrustum(uint32_t level, uint32_t x, uint32_t z) const;
+	void Refine(uint32_t level, uint32_t x, uint32_t z);
+	void Balance();
+	// Level of the leaf of the cut that contains node (level, x, z); Levels() if outside.
+	uint32_t LeafLevel(uint32_t level, int64_t x, int64_t z) const;
+	void Emit(uint32_t level, uint32_t x, uint32_t z, std::vector<PatchDraw>& draws);
+	void Stream(std::vector<PatchDraw>& draws);
+
+	static uint64_t Key(uint32_t level, uint32_t x, uint32_t z)
+	{
+		return (uint64_t(level) << 48) | (uint64_t(x) << 24) | z;
+	}
+
+	Desc mDesc;
+	MappedFile mFile;
+	const uint16_t* mSamples = nullptr;
+
+	std::vector<uint16_t> mIndices;
+	IndexRange mStitchRanges[16] = {};
+
+	std::vector<Level> mLevels; // 0 = patches
+
+	// Per-frame selection state
+	const RenderWorld::Frustum* mFrustum = nullptr;
+	float mEye[3] = {};
+	std::vector<uint64_t> mLeaves; // visible leaves waiting for a balance check
+	Stats mStats;
+
+	// Height pool
+	std::vector<uint16_t> mPool;
+	uint32_t mSlotCount = 0;
+	std::vector<uint64_t> mSlotKey;
+	std::vector<uint64_t> mSlotFrame; // frame the slot was last selected in
+	std::unordered_map<uint64_t, uint32_t> mResident;
+	uint64_t mFrame = 0;
+};
@@ -0,0 +1,385 @@
+//***************************************************************************************
+// TextureDecodeQueue.cpp
+//***************************************************************************************
+
+#include "TextureDecodeQueue.h"
+#include "Clock.h"
+#include "JobSystem.h"
+#include "MappedFile.h"
+#include "PngFile.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <wincodec.h>
+#include <wrl/client.h>
+#endif
+
+namespace
+{
+	// DXGI_FORMAT values
+	const uint32_t FormatRGBA8 = 28;     // DXGI_FORMAT_R8G8B8A8_UNORM
+	const uint32_t FormatRGBA8Srgb = 29; // DXGI_FORMAT_R8G8B8A8_UNORM_SRGB
+
+	// Shared by Run() and the decode jobs.  Jobs that start after the last item was
+	// claimed still touch it, so it lives in a shared_ptr rather than on the stack.
+	struct Batch
+	{
+		const TextureDecodeQueue::Decoder* Decode = nullptr;
+		uint32_t Count = 0;
+		uint64_t Budget = 0;
+		bool GenerateMips = false;
+		MipGenerator::Filter MipFilter = MipGenerator::Filter::Box;
+
+		std::atomic<uint32_t> Next{ 0 };
+
+		std::mutex Mutex;
+		std::condition_variable Ready; // an image finished or failed
+		std::condition_variable Room;  // staging memory was released
+		std::deque<TextureDecodeQueue::Image> Done;
+		uint32_t Finished = 0;
+		uint32_t Failed = 0;
+		uint64_t Staged = 0;
+		uint64_t PeakStaged = 0;
+		int64_t WaitTicks = 0;
+		std::exception_ptr Error;
+
+		void Reserve(uint64_t bytes)
+		{
+			std::unique_lock<std::mutex> lock(Mutex);
+
+			auto fits = [&]() { return Staged == 0 || Staged + bytes <= Budget; };
+			if(!fits())
+			{
+				const int64_t start = Clock::Now();
+				Room.wait(lock, fits);
+				WaitTicks += Clock::Now() - start;
+			}
+
+			Staged += bytes;
+			PeakStaged = (std::max)(PeakStaged, Staged);
+		}
+
+		void Release(uint64_t bytes)
+		{
+			{
+				std::lock_guard<std::mutex> lock(Mutex);
+				Staged -= bytes;
+			}
+			Room.notify_all();
+		}
+
+		// Only RGBA8 with rows packed tight: the chain then continues right after level 0.
+		bool WantsMips(const TextureDecodeQueue::Image& image, uint64_t bytes) const
+		{
+			return GenerateMips && (image.Format == FormatRGBA8 || image.Format == FormatRGBA8Srgb) &&
+				image.RowPitch == uint64_t(image.Width) * 4 && bytes == image.RowPitch * image.Height;
+		}
+
+		static MipGenerator::Format MipFormat(const TextureDecodeQueue::Image& image)
+		{
+			return image.Format == FormatRGBA8Srgb ? MipGenerator::Format::RGBA8Srgb : MipGenerator::Format::RGBA8;
+		}
+
+		// Claims items until none are left.  Decode is only dereferenced for claimed
+		// items, i.e. while Run() is still waiting for them.
+		void Work()
+		{
+			for(;;)
+			{
+				const uint32_t index = Next.fetch_add(1, std::memory_order_relaxed);
+				if(index >= Count)
+					return;
+
+				TextureDecodeQueue::Image image;
+				image.Index = index;
+				uint64_t reserved = 0;
+				bool mips = false;
+
+				const TextureDecodeQueue::Allocate allocate = [&](uint64_t bytes)
+				{
+					if(reserved)
+						throw std::logic_error("TextureDecodeQueue: pixels allocated twice for one image");
+
+					mips = WantsMips(image, bytes);
+					if(mips)
+					{
+						image.MipCount = MipGenerator::MipCount(image.Width, image.Height);
+						bytes = MipGenerator::ChainBytes(MipFormat(image), image.Width, image.Height, image.MipCount);
+					}
+
+					Reserve(bytes);
+					reserved = bytes;
+					image.Pixels.reset(new uint8_t[bytes]);
+					image.Bytes = bytes;
+					return image.Pixels.get();
+				};
+
+				try
+				{
+					PROFILE_ZONE("TextureDecodeQueue::Decode");
+
+					(*Decode)(index, allocate, image);
+					if(!image.Pixels)
+						throw std::runtime_error("TextureDecodeQueue: decoder returned no pixels");
+
+					if(mips)
+					{
+						PROFILE_ZONE("TextureDecodeQueue::GenerateMips");
+
+						// Images already decode in parallel, so each chain stays on its job.
+						MipGenerator::Options options;
+						options.Kernel = MipFilter;
+						options.Parallel = false;
+
+						std::vector<MipGenerator::Level> levels;
+						MipGenerator::PackedChain(MipFormat(image), image.Width, image.Height, image.MipCount, image.Pixels.get(), levels);
+						MipGenerator::Generate(MipFormat(image), levels.data(), image.MipCount, options);
+					}
+
+					std::lock_guard<std::mutex> lock(Mutex);
+					Done.push_back(std::move(image));
+					++Finished;
+				}
+				catch(...)
+				{
+					image.Pixels.reset();
+					if(reserved)
+						Release(reserved);
+
+					std::lock_guard<std::mutex> lock(Mutex);
+					if(!Error)
+						Error = std::current_exception();
+					++Failed;
+					++Finished;
+				}
+
+				Ready.notify_one();
+			}
+		}
+	};
+
+#if defined(_WIN32)
+	using Microsoft::WRL::ComPtr;
+
+	void CheckWic(HRESULT hr, uint32_t index, const char* what)
+	{
+		if(FAILED(hr))
+		{
+			char message[160];
+			sprintf_s(message, "TextureDecodeQueue: %s failed for image %u (HRESULT 0x%08X)",
+				what, index, static_cast<unsigned>(hr));
+			throw std::runtime_error(message);
+		}
+	}
+
+	// Job system workers never initialize COM themselves.  RPC_E_CHANGED_MODE means the
+	// thread already has an apartment, which WIC is fine with.
+	struct ComApartment
+	{
+		HRESULT Result;
+
+		ComApartment() : Result(CoInitializeEx(nullptr, COINIT_MULTITHREADED)) {}
+		~ComApartment()
+		{
+			if(SUCCEEDED(Result))
+				CoUninitialize();
+		}
+	};
+
+	// The factory is free-threaded.  It is never released: at exit COM may already be
+	// gone.
+	IWICImagingFactory* WicFactory()
+	{
+		static IWICImagingFactory* factory = []()
+		{
+			IWICImagingFactory* created = nullptr;
+			CheckWic(CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&created)),
+				0, "CoCreateInstance(WICImagingFactory)");
+			return created;
+		}();
+		return factory;
+	}
+
+	// Same rules as WICTextureLoader: the PNG sRGB and gAMA chunks, or the EXIF color
+	// space for other containers.
+	bool WicIsSrgb(IWICBitmapFrameDecode* frame)
+	{
+		ComPtr<IWICMetadataQueryReader> reader;
+		GUID container;
+		if(FAILED(frame->GetMetadataQueryReader(reader.GetAddressOf())) || FAILED(reader->GetContainerFormat(&container)))
+			return false;
+
+		bool srgb = false;
+		PROPVARIANT value;
+		PropVariantInit(&value);
+
+		if(container == GUID_ContainerFormatPng)
+		{
+			if(SUCCEEDED(reader->GetMetadataByName(L"/sRGB/RenderingIntent", &value)) && value.vt == VT_UI1)
+				srgb = true;
+			else if(SUCCEEDED(reader->GetMetadataByName(L"/gAMA/ImageGamma", &value)) && value.vt == VT_UI4)
+				srgb = value.uintVal == 45455;
+		}
+		else if(SUCCEEDED(reader->GetMetadataByName(L"System.Image.ColorSpace", &value)) && value.vt == VT_UI2)
+			srgb = value.uiVal == 1;
+
+		PropVariantClear(&value);
+		return srgb;
+	}
+#endif
+}
+
+TextureDecodeQueue::TextureDecodeQueue(const Desc& desc) :
+	mDesc(desc)
+{
+}
+
+TextureDecodeQueue::Stats TextureDecodeQueue::Run(uint32_t count, const Decoder& decode, const Uploader& upload)
+{
+	PROFILE_ZONE("TextureDecodeQueue::Run");
+
+	Stats stats;
+	if(count == 0)
+		return stats;
+
+	const int64_t start = Clock::Now();
+
+	auto batch = std::make_shared<Batch>();
+	batch->Decode = &decode;
+	batch->Count = count;
+	batch->Budget = mDesc.StagingBytes;
+	batch->GenerateMips = mDesc.GenerateMips;
+	batch->MipFilter = mDesc.MipFilter;
+
+	const uint32_t workers = JobSystem::WorkerCount();
+	const uint32_t threads = (std::min)(mDesc.Threads ? (std::min)(mDesc.Threads, workers) : workers, count);
+	for(uint32_t i = 0; i < threads; ++i)
+		JobSystem::Submit([batch]() { batch->Work(); });
+
+	int64_t uploadTicks = 0;
+	for(;;)
+	{
+		Image image;
+		{
+			std::unique_lock<std::mutex> lock(batch->Mutex);
+			batch->Ready.wait(lock, [&]() { return !batch->Done.empty() || batch->Finished == count; });
+			if(batch->Done.empty())
+				break;
+
+			image = std::move(batch->Done.front());
+			batch->Done.pop_front();
+		}
+
+		const int64_t uploadStart = Clock::Now();
+		try
+		{
+			PROFILE_ZONE("TextureDecodeQueue::Upload");
+			upload(image);
+		}
+		catch(...)
+		{
+			std::lock_guard<std::mutex> lock(batch->Mutex);
+			if(!batch->Error)
+				batch->Error = std::current_exception();
+		}
+		uploadTicks += Clock::Now() - uploadStart;
+
+		++stats.Images;
+		stats.DecodedBytes += image.Bytes;
+		image.Pixels.reset();
+		batch->Release(image.Bytes);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(batch->Mutex);
+		stats.Failed = batch->Failed;
+		stats.PeakStagingBytes = batch->PeakStaged;
+		stats.StagingWaitMs = Clock::ToSeconds(batch->WaitTicks) * 1000.0;
+	}
+	stats.UploadMs = Clock::ToSeconds(uploadTicks) * 1000.0;
+	stats.WallMs = Clock::ToSeconds(Clock::Now() - start) * 1000.0;
+
+	if(batch->Error)
+		std::rethrow_exception(batch->Error);
+
+	return stats;
+}
+
+TextureDecodeQueue::Decoder TextureDecodeQueue::PngFiles(const std::vector<std::string>& paths)
+{
+	return [&paths](uint32_t index, const Allocate& allocate, Image& image)
+	{
+		MappedFile file;
+		file.Open(paths[index].c_str());
+
+		const PngFile::Info info = PngFile::ReadInfo(file.Data(), static_cast<size_t>(file.Size()));
+
+		image.Width = info.Width;
+		image.Height = info.Height;
+		image.Format = info.SRGB ? FormatRGBA8Srgb : FormatRGBA8;
+		image.RowPitch = uint64_t(info.Width) * 4;
+
+		uint8_t* pixels = allocate(image.RowPitch * info.Height);
+		PngFile::Decode(file.Data(), static_cast<size_t>(file.Size()), pixels, static_cast<size_t>(image.RowPitch));
+	};
+}
+
+#if defined(_WIN32)
+TextureDecodeQueue::Decoder TextureDecodeQueue::WicFiles(const std::vector<std::wstring>& paths)
+{
+	return [&paths](uint32_t index, const Allocate& allocate, Image& image)
+	{
+		thread_local ComApartment apartment;
+		IWICImagingFactory* factory = WicFactory();
+
+		ComPtr<IWICBitmapDecoder> decoder;
+		CheckWic(factory->CreateDecoderFromFilename(paths[index].c_str(), nullptr, GENERIC_READ,
+			WICDecodeMetadataCacheOnDemand, decoder.GetAddressOf()), index, "CreateDecoderFromFilename");
+
+		ComPtr<IWICBitmapFrameDecode> frame;
+		CheckWic(decoder->GetFrame(0, frame.GetAddressOf()), index, "GetFrame");
+
+		UINT width, height;
+		CheckWic(frame->GetSize(&width, &height), index, "GetSize");
+		if(width == 0 || height == 0 || width > 16384 || height > 16384)
+			throw std::runtime_error("TextureDecodeQueue: unsupported image size for image " + std::to_string(index));
+
+		// Everything converts to RGBA8, like WIC_LOADER_FORCE_RGBA32.
+		WICPixelFormatGUID pixelFormat;
+		CheckWic(frame->GetPixelFormat(&pixelFormat), index, "GetPixelFormat");
+
+		ComPtr<IWICBitmapSource> source = frame;
+		if(pixelFormat != GUID_WICPixelFormat32bppRGBA)
+		{
+			ComPtr<IWICFormatConverter> converter;
+			CheckWic(factory->CreateFormatConverter(converter.GetAddressOf()), index, "CreateFormatConverter");
+			CheckWic(converter->Initialize(frame.Get(), GUID_WICPixelFormat32bppRGBA, WICBitmapDitherTypeErrorDiffusion,
+				nullptr, 0, WICBitmapPaletteTypeMedianCut), index, "IWICFormatConverter::Initialize");
+			source = converter;
+		}
+
+		image.Width = width;
+		image.Height = height;
+		image.Format = WicIsSrgb(frame.Get()) ? FormatRGBA8Srgb : FormatRGBA8;
+		image.RowPitch = uint64_t(width) * 4;
+
+		const uint64_t bytes = image.RowPitch * height;
+		uint8_t* pixels = allocate(bytes);
+		CheckWic(source->CopyPixels(nullptr, static_cast<UINT>(image.RowPitch), static_cast<UINT>(bytes), pixels),
+			index, "CopyPixels");
+	};
+}
+#endif
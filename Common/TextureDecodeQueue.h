@@ -0,0 +1,99 @@
+//***************************************************************************************
+// TextureDecodeQueue.h
+//
+// Batched texture decoding on the job system.  Decode jobs pull images from a shared
+// counter and decode them in parallel; the thread that called Run() is the single
+// upload stage and receives each image as soon as it is ready, in completion order.
+// Decoded pixels live in staging memory bounded by Desc::StagingBytes: a decoder that
+// has read an image header waits for room before allocating its pixels, so peak
+// memory stays at the budget no matter how far decoding runs ahead of uploads.  An
+// image larger than the whole budget still goes through, alone.
+//
+// Backends turn an item into pixels.  PngFiles() uses PngFile and runs anywhere;
+// WicFiles() goes through WIC and reads everything WIC does (PNG, JPEG, BMP, TIFF...).
+// Both produce RGBA8, marked sRGB the way WICTextureLoader detects it.
+//
+// With Desc::GenerateMips the decode job also builds the full mip chain of RGBA8 images
+// with MipGenerator, right after decoding, so uploads receive every level.
+//***************************************************************************************
+
+#pragma once
+
+#include "MipGenerator.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class TextureDecodeQueue
+{
+public:
+	struct Desc
+	{
+		uint64_t StagingBytes = 256ull << 20;
+
+		// Decode jobs to run; 0 uses every job system worker.  The calling thread only
+		// uploads.
+		uint32_t Threads = 0;
+
+		// Appends mips to tightly packed RGBA8 images, reserving staging for the chain.
+		bool GenerateMips = false;
+		MipGenerator::Filter MipFilter = MipGenerator::Filter::Box;
+	};
+
+	struct Image
+	{
+		uint32_t Index = 0; // item of the batch
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		uint32_t Format = 0; // DXGI_FORMAT
+		uint64_t RowPitch = 0;
+		uint64_t Bytes = 0;
+		uint32_t MipCount = 1; // levels packed one after another, see MipGenerator::PackedChain
+		std::unique_ptr<uint8_t[]> Pixels;
+	};
+
+	// Reserves staging memory for the image and returns its pixels; call once per image,
+	// after Width, Height, Format and RowPitch are set.  May block until uploads free enough of the budget.
+	using Allocate = std::function<uint8_t*(uint64_t bytes)>;
+
+	// Decodes item index into image, calling allocate for the pixels.  Runs on worker
+	// threads, several at a time.  Throws on failure.
+	using Decoder = std::function<void(uint32_t index, const Allocate& allocate, Image& image)>;
+
+	// Consumes a decoded image on the calling thread; its staging memory is released
+	// when this returns.
+	using Uploader = std::function<void(const Image& image)>;
+
+	struct Stats
+	{
+		uint32_t Images = 0;
+		uint32_t Failed = 0;
+		uint64_t DecodedBytes = 0;
+		uint64_t PeakStagingBytes = 0;
+		double WallMs = 0.0;
+		double UploadMs = 0.0;     // in the upload stage
+		double StagingWaitMs = 0.0; // decoders blocked on the budget, summed over threads
+	};
+
+	explicit TextureDecodeQueue(const Desc& desc);
+
+	// Decodes items [0, count) and uploads each one.  Every image that decodes is
+	// uploaded even if others fail; the first exception, from a decoder or from upload,
+	// is then rethrown.
+	Stats Run(uint32_t count, const Decoder& decode, const Uploader& upload);
+
+	const Desc& GetDesc() const { return mDesc; }
+
+	// Backends: item i is paths[i].  The vector must outlive Run().
+	static Decoder PngFiles(const std::vector<std::string>& paths);
+#if defined(_WIN32)
+	static Decoder WicFiles(const std::vector<std::wstring>& paths);
+#endif
+
+private:
+	Desc mDesc;
+};
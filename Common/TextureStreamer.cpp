@@ -0,0 +1,207 @@
+//***************************************************************************************
+// TextureStreamer.cpp
+//***************************************************************************************
+
+#include "TextureStreamer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+TextureStreamer::TextureStreamer(const Desc& desc) :
+	mDesc(desc)
+{
+}
+
+uint32_t TextureStreamer::Register(uint32_t width, uint32_t height, const std::vector<uint64_t>& mipBytes)
+{
+	assert(!mipBytes.empty() && mipBytes.size() <= 32);
+
+	Texture texture;
+	texture.Width = width;
+	texture.Height = height;
+	texture.MipCount = static_cast<uint32_t>(mipBytes.size());
+	texture.FirstMipBytes = static_cast<uint32_t>(mMipBytes.size());
+
+	// The tail starts at the first mip that fits in TailSize, or at the last mip if the
+	// chain stops short of it.
+	texture.Tail = texture.MipCount - 1;
+	while(texture.Tail > 0 &&
+		(std::max)(width >> (texture.Tail - 1), 1u) <= mDesc.TailSize &&
+		(std::max)(height >> (texture.Tail - 1), 1u) <= mDesc.TailSize)
+		--texture.Tail;
+
+	texture.Resident = texture.Tail;
+	texture.Wanted = texture.Tail;
+
+	for(uint32_t mip = texture.Tail; mip < texture.MipCount; ++mip)
+		mResidentBytes += mipBytes[mip];
+
+	mMipBytes.insert(mMipBytes.end(), mipBytes.begin(), mipBytes.end());
+	mTextures.push_back(texture);
+	return static_cast<uint32_t>(mTextures.size() - 1);
+}
+
+void TextureStreamer::RequestSize(uint32_t texture, float screenTexels)
+{
+	Texture& t = mTextures[texture];
+
+	if(t.LastSeen != mFrame)
+	{
+		t.LastSeen = mFrame;
+		t.ScreenTexels = 0.0f;
+		mRequested.push_back(texture);
+	}
+
+	t.ScreenTexels = (std::max)(t.ScreenTexels, screenTexels);
+}
+
+void TextureStreamer::Update(std::vector<Load>& loads, std::vector<Eviction>& evictions)
+{
+	loads.clear();
+	evictions.clear();
+	mStats = Stats();
+	mStats.Requested = static_cast<uint32_t>(mRequested.size());
+
+	// Wanted mips: the one whose larger side still covers the screen size with at least
+	// one texel per pixel.  Textures not seen this frame only want their tail.
+	for(Texture& t : mTextures)
+		t.Wanted = t.Tail;
+
+	for(uint32_t index : mRequested)
+	{
+		Texture& t = mTextures[index];
+		if(t.ScreenTexels <= 0.0f)
+			continue;
+
+		const float size = float((std::max)(t.Width, t.Height));
+		const float mip = std::floor(std::log2(size / t.ScreenTexels) + mDesc.MipBias);
+		t.Wanted = mip <= 0.0f ? 0 : (std::min)(static_cast<uint32_t>(mip), t.Tail);
+	}
+
+	// Every missing mip is a candidate.  Priority grows with the screen size and with the
+	// distance from the wanted mip, so large blurry objects come first and each texture
+	// sharpens coarse to fine.
+	mQueue.clear();
+	for(uint32_t index : mRequested)
+	{
+		const Texture& t = mTextures[index];
+
+		for(uint32_t mip = t.Wanted; mip < t.Resident; ++mip)
+		{
+			if(((t.Loading | t.Arrived) >> mip) & 1)
+				continue;
+
+			mQueue.push_back({ index, mip, MipBytes(index, mip), float(mip - t.Wanted + 1) * t.ScreenTexels });
+		}
+	}
+	mStats.Queued = static_cast<uint32_t>(mQueue.size());
+
+	auto lowerPriority = [](const Load& a, const Load& b) { return a.Priority < b.Priority; };
+	std::make_heap(mQueue.begin(), mQueue.end(), lowerPriority);
+
+	mColdValid = false;
+
+	while(!mQueue.empty() && mLoadsInFlight < mDesc.MaxLoadsInFlight)
+	{
+		std::pop_heap(mQueue.begin(), mQueue.end(), lowerPriority);
+		const Load load = mQueue.back();
+		mQueue.pop_back();
+
+		// A mip larger than the whole in-flight allowance still goes alone.
+		if(mInFlightBytes + load.Bytes > mDesc.MaxBytesInFlight && mInFlightBytes > 0)
+			break;
+
+		if(!MakeRoom(load.Bytes, evictions))
+		{
+			++mStats.Starved;
+			continue;
+		}
+
+		mTextures[load.Texture].Loading |= 1u << load.Mip;
+		mInFlightBytes += load.Bytes;
+		++mLoadsInFlight;
+		loads.push_back(load);
+	}
+
+	mStats.Issued = static_cast<uint32_t>(loads.size());
+	mStats.Evicted = static_cast<uint32_t>(evictions.size());
+	mStats.ResidentBytes = mResidentBytes;
+	mStats.InFlightBytes = mInFlightBytes;
+
+	mRequested.clear();
+	++mFrame;
+}
+
+bool TextureStreamer::MakeRoom(uint64_t bytes, std::vector<Eviction>& evictions)
+{
+	auto fits = [&]() { return mResidentBytes + mInFlightBytes + bytes <= mDesc.BudgetBytes; };
+	if(fits())
+		return true;
+
+	// Cold textures hold finer mips than they want.  The least recently seen are trimmed
+	// first, each one down to its wanted mip before moving on.
+	if(!mColdValid)
+	{
+		mColdTextures.clear();
+		for(uint32_t index = 0; index < mTextures.size(); ++index)
+		{
+			const Texture& t = mTextures[index];
+			if(t.Resident < t.Wanted && t.Loading == 0)
+				mColdTextures.push_back(index);
+		}
+
+		std::sort(mColdTextures.begin(), mColdTextures.end(), [this](uint32_t a, uint32_t b)
+		{
+			const Texture& ta = mTextures[a];
+			const Texture& tb = mTextures[b];
+			if(ta.LastSeen != tb.LastSeen)
+				return ta.LastSeen < tb.LastSeen;
+			return ta.Wanted - ta.Resident > tb.Wanted - tb.Resident;
+		});
+
+		// Popped from the back.
+		std::reverse(mColdTextures.begin(), mColdTextures.end());
+		mColdValid = true;
+	}
+
+	while(!fits() && !mColdTextures.empty())
+	{
+		const uint32_t index = mColdTextures.back();
+		Texture& t = mTextures[index];
+
+		if(t.Resident >= t.Wanted)
+		{
+			mColdTextures.pop_back();
+			continue;
+		}
+
+		const uint64_t mipBytes = MipBytes(index, t.Resident);
+		mResidentBytes -= mipBytes;
+		mStats.EvictedBytes += mipBytes;
+		evictions.push_back({ index, t.Resident });
+		++t.Resident;
+	}
+
+	return fits();
+}
+
+void TextureStreamer::Complete(uint32_t texture, uint32_t mip)
+{
+	Texture& t = mTextures[texture];
+	assert((t.Loading >> mip) & 1);
+
+	const uint64_t bytes = MipBytes(texture, mip);
+	t.Loading &= ~(1u << mip);
+	t.Arrived |= 1u << mip;
+
+	while(t.Resident > 0 && ((t.Arrived >> (t.Resident - 1)) & 1))
+	{
+		--t.Resident;
+		t.Arrived &= ~(1u << t.Resident);
+	}
+
+	mInFlightBytes -= bytes;
+	mResidentBytes += bytes;
+	--mLoadsInFlight;
+}
@@ -0,0 +1,136 @@
+//***************************************************************************************
+// TextureStreamer.h
+//
+// Mip residency policy for streamed textures.  Each texture keeps a contiguous range of
+// resident mips, from ResidentMip() down to the smallest one, which is what an SRV
+// MinLOD clamp can express.  The tail (mips no larger than TailSize) is loaded with the
+// texture and never evicted; everything finer streams in mip by mip.  Several mips of
+// a texture may be in flight at once and may finish in any order: a mip that arrives
+// early becomes usable once every coarser one has arrived.
+//
+// Every frame the renderer reports how large each texture appears on screen via
+// RequestSize().  Update() turns that into a wanted mip per texture, then:
+//   -queues every missing mip between the resident and the wanted one, ordered by
+//    priority (screen size times how far the mip is from the wanted one, so coarse mips
+//    of large objects come first), and starts as many as the in-flight limits allow;
+//   -makes room in the budget by evicting the finest mip of textures that hold more
+//    detail than they want, least recently seen first.
+// Loads run elsewhere (a file job, an upload batch) and report back with Complete().
+// Nothing here touches Direct3D or files, so the policy runs as-is against simulated
+// I/O.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class TextureStreamer
+{
+public:
+	struct Desc
+	{
+		uint64_t BudgetBytes = 512ull << 20; // resident plus in-flight mips
+		uint32_t MaxLoadsInFlight = 16;
+		uint64_t MaxBytesInFlight = 64ull << 20;
+
+		// Mips with both sides at most TailSize are resident from Register() on.
+		uint32_t TailSize = 64;
+
+		// Added to the wanted mip: positive values trade detail for memory.
+		float MipBias = 0.0f;
+	};
+
+	struct Load
+	{
+		uint32_t Texture;
+		uint32_t Mip;
+		uint64_t Bytes;
+		float Priority;
+	};
+
+	struct Eviction
+	{
+		uint32_t Texture;
+		uint32_t Mip;
+	};
+
+	struct Stats
+	{
+		uint32_t Requested = 0; // textures seen this frame
+		uint32_t Queued = 0;    // missing mips of visible textures
+		uint32_t Issued = 0;
+		uint32_t Evicted = 0;
+		uint32_t Starved = 0;   // queued loads that did not fit in the budget
+		uint64_t ResidentBytes = 0;
+		uint64_t InFlightBytes = 0;
+		uint64_t EvictedBytes = 0;
+	};
+
+	explicit TextureStreamer(const Desc& desc);
+
+	// mipBytes[i] is the size of mip i over all array slices and planes.  The tail is
+	// counted as resident immediately; the caller loads it before first use (for a DDS
+	// file, DdsFile::ComputeLayout with maxSize = TailSize gives exactly these mips).
+	uint32_t Register(uint32_t width, uint32_t height, const std::vector<uint64_t>& mipBytes);
+
+	// screenTexels is how many screen pixels the texture spans along its larger side
+	// for one object; the largest value of the frame wins.  Call from one thread.
+	void RequestSize(uint32_t texture, float screenTexels);
+
+	// Once per frame, after all RequestSize calls.  Returns the loads to start, highest
+	// priority first, and the mips that must no longer be sampled.
+	void Update(std::vector<Load>& loads, std::vector<Eviction>& evictions);
+
+	// A load returned by Update has finished.  Its mip is resident from now on, and is
+	// usable as soon as ResidentMip() reaches it.
+	void Complete(uint32_t texture, uint32_t mip);
+
+	uint32_t ResidentMip(uint32_t texture) const { return mTextures[texture].Resident; }
+	uint32_t WantedMip(uint32_t texture) const { return mTextures[texture].Wanted; }
+	uint32_t TailMip(uint32_t texture) const { return mTextures[texture].Tail; }
+	uint32_t MipCount(uint32_t texture) const { return mTextures[texture].MipCount; }
+	uint64_t MipBytes(uint32_t texture, uint32_t mip) const { return mMipBytes[mTextures[texture].FirstMipBytes + mip]; }
+
+	uint32_t TextureCount() const { return static_cast<uint32_t>(mTextures.size()); }
+	uint64_t ResidentBytes() const { return mResidentBytes; }
+	uint64_t InFlightBytes() const { return mInFlightBytes; }
+	const Desc& GetDesc() const { return mDesc; }
+	const Stats& LastStats() const { return mStats; }
+
+private:
+	struct Texture
+	{
+		uint32_t Width;
+		uint32_t Height;
+		uint32_t MipCount;
+		uint32_t Tail;     // first tail mip
+		uint32_t Resident; // finest mip of the contiguous resident range
+		uint32_t Wanted;
+		uint32_t Loading = 0; // bit per mip in flight
+		uint32_t Arrived = 0; // bit per mip finer than Resident that finished early
+		uint32_t FirstMipBytes; // into mMipBytes
+		float ScreenTexels = 0.0f; // this frame
+		uint64_t LastSeen = 0;     // frame of the last RequestSize
+	};
+
+	// Evicts cold mips until bytes more fit in the budget; false if they cannot.
+	bool MakeRoom(uint64_t bytes, std::vector<Eviction>& evictions);
+
+	Desc mDesc;
+	std::vector<Texture> mTextures;
+	std::vector<uint64_t> mMipBytes;
+	std::vector<uint32_t> mRequested; // textures with a RequestSize this frame
+
+	uint64_t mResidentBytes = 0;
+	uint64_t mInFlightBytes = 0;
+	uint32_t mLoadsInFlight = 0;
+	uint64_t mFrame = 1;
+	Stats mStats;
+
+	// Per-frame scratch
+	std::vector<Load> mQueue;
+	std::vector<uint32_t> mColdTextures;
+	bool mColdValid = false;
+};
@@ -0,0 +1,571 @@
+//***************************************************************************************
+// VirtualTexture.cpp
+//***************************************************************************************
+
+#include "VirtualTexture.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+	// Feedback entries per ParallelFor chunk in Collect()
+	const uint32_t FeedbackGrain = 16384;
+}
+
+VirtualTexture::VirtualTexture(const Desc& desc) :
+	mDesc(desc)
+{
+	if(desc.PageSize == 0 || desc.Width == 0 || desc.Height == 0 ||
+		desc.Width % desc.PageSize != 0 || desc.Height % desc.PageSize != 0)
+		throw std::invalid_argument("VirtualTexture: size must be a nonzero multiple of the page size");
+
+	const uint32_t pagesX = desc.Width / desc.PageSize;
+	const uint32_t pagesY = desc.Height / desc.PageSize;
+	if(pagesX > 0x4000u || pagesY > 0x4000u)
+		throw std::invalid_argument("VirtualTexture: more than 16384 pages per side");
+
+	if(desc.CacheSlots == 0 || desc.CacheSlots > 0x1000000u)
+		throw std::invalid_argument("VirtualTexture: cache slots must be in [1, 2^24]");
+
+	// Levels down to a single page; a level has half the pages of the one above, rounded up
+	for(uint32_t mip = 0; ; ++mip)
+	{
+		const uint32_t x = (pagesX + (1u << mip) - 1) >> mip;
+		const uint32_t y = (pagesY + (1u << mip) - 1) >> mip;
+
+		mMipOffset.push_back(static_cast<uint32_t>(mPagesX.empty() ? 0 : mMipOffset.back() + mPagesX.back() * mPagesY.back()));
+		mPagesX.push_back(x);
+		mPagesY.push_back(y);
+
+		if(x == 1 && y == 1)
+			break;
+	}
+
+	const uint32_t mipCount = MipCount();
+	mDesc.PinnedMips = (std::min)((std::max)(desc.PinnedMips, 1u), mipCount);
+
+	uint32_t pinnedPages = 0;
+	for(uint32_t mip = mipCount - mDesc.PinnedMips; mip < mipCount; ++mip)
+		pinnedPages += mPagesX[mip] * mPagesY[mip];
+	if(pinnedPages >= desc.CacheSlots)
+		throw std::invalid_argument("VirtualTexture: pinned mips take the whole cache");
+
+	const uint32_t pageCount = mMipOffset.back() + 1;
+	mEntries.assign(pageCount, Unmapped);
+	mStamp.assign(pageCount, 0);
+	mPosition.assign(pageCount, 0);
+
+	mSlots.resize(desc.CacheSlots);
+	mFreeSlots.reserve(desc.CacheSlots);
+	for(uint32_t slot = desc.CacheSlots; slot-- > 0;)
+		mFreeSlots.push_back(slot); // slot 0 comes out first
+
+	mDirty.resize(mipCount);
+	for(uint32_t mip = 0; mip < mipCount; ++mip)
+		mDirty[mip] = { mip, 0, 0, 0, 0 };
+}
+
+bool VirtualTexture::ReadHeader(const void* data, uint64_t fileSize, Desc& desc, uint32_t& format)
+{
+	if(fileSize < sizeof(FileHeader))
+		return false;
+
+	FileHeader header;
+	std::memcpy(&header, data, sizeof(header));
+
+	if(header.Magic != FileMagic || header.Version != FileVersion || header.PageBytes == 0 ||
+		header.PageSize == 0 || header.Width == 0 || header.Height == 0 ||
+		header.Width % header.PageSize != 0 || header.Height % header.PageSize != 0 ||
+		header.Width / header.PageSize > 0x4000u || header.Height / header.PageSize > 0x4000u)
+		return false;
+
+	// Same levels as the constructor builds
+	uint64_t pages = 0;
+	uint32_t mipCount = 0;
+	const uint32_t pagesX = header.Width / header.PageSize;
+	const uint32_t pagesY = header.Height / header.PageSize;
+	for(uint32_t mip = 0; ; ++mip)
+	{
+		const uint32_t x = (pagesX + (1u << mip) - 1) >> mip;
+		const uint32_t y = (pagesY + (1u << mip) - 1) >> mip;
+		pages += uint64_t(x) * y;
+		++mipCount;
+		if(x == 1 && y == 1)
+			break;
+	}
+
+	if(header.MipCount != mipCount || sizeof(FileHeader) + pages * header.PageBytes > fileSize)
+		return false;
+
+	desc.Width = header.Width;
+	desc.Height = header.Height;
+	desc.PageSize = header.PageSize;
+	desc.Border = header.Border;
+	desc.PageBytes = header.PageBytes;
+	format = header.Format;
+	return true;
+}
+
+VirtualTexture::FileHeader VirtualTexture::MakeHeader(uint32_t format) const
+{
+	FileHeader header = {};
+	header.Magic = FileMagic;
+	header.Version = FileVersion;
+	header.Width = mDesc.Width;
+	header.Height = mDesc.Height;
+	header.PageSize = mDesc.PageSize;
+	header.Border = mDesc.Border;
+	header.Format = format;
+	header.PageBytes = mDesc.PageBytes;
+	header.MipCount = MipCount();
+	return header;
+}
+
+uint64_t VirtualTexture::FileBytes() const
+{
+	return sizeof(FileHeader) + uint64_t(PageCount()) * mDesc.PageBytes;
+}
+
+uint64_t VirtualTexture::PageOffset(uint32_t page) const
+{
+	return sizeof(FileHeader) + uint64_t(Index(page)) * mDesc.PageBytes;
+}
+
+bool VirtualTexture::IsValidPage(uint32_t page) const
+{
+	const uint32_t mip = PageMip(page);
+	return mip < MipCount() && PageX(page) < mPagesX[mip] && PageY(page) < mPagesY[mip];
+}
+
+void VirtualTexture::Update(const uint32_t* feedback, size_t count, std::vector<Load>& loads,
+	std::vector<Eviction>& evictions, bool parallel)
+{
+	loads.clear();
+	evictions.clear();
+	mStats = Stats();
+	mStats.Pixels = count;
+	++mFrame;
+
+	if(!mPinnedIssued)
+	{
+		for(uint32_t mip = MipCount() - mDesc.PinnedMips; mip < MipCount(); ++mip)
+		{
+			for(uint32_t y = 0; y < mPagesY[mip]; ++y)
+			{
+				for(uint32_t x = 0; x < mPagesX[mip]; ++x)
+				{
+					const uint32_t page = MakePage(mip, x, y);
+					const uint32_t slot = mFreeSlots.back();
+					mFreeSlots.pop_back();
+
+					mSlots[slot].Page = page;
+					mSlots[slot].State = SlotState::Loading;
+					mInFlight.emplace(page, slot);
+					loads.push_back({ page, slot, PageOffset(page), FLT_MAX });
+				}
+			}
+		}
+		mPinnedIssued = true;
+	}
+
+	Collect(feedback, count, parallel);
+	mStats.Unique = static_cast<uint32_t>(mRequests.size());
+
+	// Every sampled page stays in the cache, stand-ins included.  A miss asks for the
+	// next finer page on the way to the wanted one, weighted by how many pixels want it
+	// and how many mips they are off.
+	const uint32_t queueStamp = static_cast<uint32_t>(2 * mFrame + 1);
+	mQueue.clear();
+
+	for(const Request& request : mRequests)
+	{
+		const uint32_t entry = mEntries[Index(request.Page)];
+		const uint32_t mip = PageMip(request.Page);
+		const uint64_t pixels = static_cast<uint64_t>(request.Weight);
+
+		if(entry != Unmapped)
+			Touch(EntrySlot(entry));
+
+		if(entry != Unmapped && EntryMip(entry) == mip)
+		{
+			mStats.HitPixels += pixels;
+			continue;
+		}
+		mStats.MissPixels += pixels;
+
+		const uint32_t resident = entry != Unmapped ? EntryMip(entry) : MipCount();
+		const uint32_t target = resident - 1;
+		const uint32_t shift = target - mip;
+		const uint32_t page = MakePage(target, PageX(request.Page) >> shift, PageY(request.Page) >> shift);
+
+		if(mInFlight.count(page))
+			continue;
+
+		const uint32_t index = Index(page);
+		if(mStamp[index] != queueStamp)
+		{
+			mStamp[index] = queueStamp;
+			mPosition[index] = static_cast<uint32_t>(mQueue.size());
+			mQueue.push_back({ page, 0.0f });
+		}
+		mQueue[mPosition[index]].Weight += request.Weight * float(resident - mip);
+	}
+	mStats.Queued = static_cast<uint32_t>(mQueue.size());
+
+	auto lowerPriority = [](const Request& a, const Request& b) { return a.Weight < b.Weight; };
+	std::make_heap(mQueue.begin(), mQueue.end(), lowerPriority);
+
+	while(!mQueue.empty() && mInFlight.size() < mDesc.MaxLoadsInFlight)
+	{
+		std::pop_heap(mQueue.begin(), mQueue.end(), lowerPriority);
+		const Request request = mQueue.back();
+		mQueue.pop_back();
+
+		const uint32_t slot = AcquireSlot(evictions);
+		if(slot == NoSlot)
+		{
+			// Everything left is sampled this frame: the cache is smaller than the view
+			mStats.Starved = static_cast<uint32_t>(mQueue.size() + 1);
+			break;
+		}
+
+		mSlots[slot].Page = request.Page;
+		mSlots[slot].State = SlotState::Loading;
+		mInFlight.emplace(request.Page, slot);
+		loads.push_back({ request.Page, slot, PageOffset(request.Page), request.Weight });
+	}
+
+	mStats.Issued = static_cast<uint32_t>(loads.size());
+	mStats.Evicted = static_cast<uint32_t>(evictions.size());
+	mStats.ResidentPages = mResidentPages;
+}
+
+void VirtualTexture::Collect(const uint32_t* feedback, size_t count, bool parallel)
+{
+	mRequests.clear();
+
+	const uint32_t seenStamp = static_cast<uint32_t>(2 * mFrame);
+	auto add = [&](uint32_t page, float pixels) {
+		const uint32_t index = Index(page);
+		if(mStamp[index] != seenStamp)
+		{
+			mStamp[index] = seenStamp;
+			mPosition[index] = static_cast<uint32_t>(mRequests.size());
+			mRequests.push_back({ page, 0.0f });
+		}
+		mRequests[mPosition[index]].Weight += pixels;
+	};
+
+	// Neighbouring feedback pixels mostly want the same page, so runs collapse first;
+	// that part is independent per chunk and runs on the job system
+	auto encode = [this](const uint32_t* begin, const uint32_t* end, std::vector<Request>& runs, uint32_t& rejected) {
+		runs.clear();
+		rejected = 0;
+
+		uint32_t current = NoPage;
+		uint32_t length = 0;
+		for(const uint32_t* p = begin; p != end; ++p)
+		{
+			if(*p == current)
+			{
+				length += length > 0; // runs of NoPage stay empty
+				continue;
+			}
+
+			if(length > 0)
+				runs.push_back({ current, float(length) });
+
+			current = *p;
+			length = 0;
+			if(current == NoPage)
+				continue;
+
+			if(!IsValidPage(current))
+			{
+				++rejected;
+				current = NoPage;
+				continue;
+			}
+			length = 1;
+		}
+
+		if(length > 0)
+			runs.push_back({ current, float(length) });
+	};
+
+	const uint32_t chunks = static_cast<uint32_t>((count + FeedbackGrain - 1) / FeedbackGrain);
+	mChunkRuns.resize((std::max)(chunks, 1u));
+	mChunkRejected.assign((std::max)(chunks, 1u), 0);
+
+	auto encodeChunks = [&](uint32_t begin, uint32_t end) {
+		for(uint32_t c = begin; c < end; ++c)
+		{
+			const size_t first = size_t(c) * FeedbackGrain;
+			const size_t last = (std::min)(first + FeedbackGrain, count);
+			encode(feedback + first, feedback + last, mChunkRuns[c], mChunkRejected[c]);
+		}
+	};
+
+	if(parallel && chunks > 1)
+		JobSystem::ParallelFor(chunks, 1, encodeChunks);
+	else
+		encodeChunks(0, chunks);
+
+	for(uint32_t c = 0; c < chunks; ++c)
+	{
+		for(const Request& run : mChunkRuns[c])
+			add(run.Page, run.Weight);
+		mStats.Rejected += mChunkRejected[c];
+	}
+}
+
+void VirtualTexture::Complete(uint32_t page)
+{
+	const auto it = mInFlight.find(page);
+	if(it == mInFlight.end())
+		throw std::invalid_argument("VirtualTexture: page is not loading");
+
+	const uint32_t slot = it->second;
+	mInFlight.erase(it);
+
+	Map(page, slot);
+	++mResidentPages;
+
+	Slot& s = mSlots[slot];
+	s.LastUsed = mFrame;
+	if(PageMip(page) >= MipCount() - mDesc.PinnedMips)
+		s.State = SlotState::Pinned;
+	else
+	{
+		s.State = SlotState::Resident;
+		LinkFront(slot);
+	}
+}
+
+void VirtualTexture::Touch(uint32_t slot)
+{
+	Slot& s = mSlots[slot];
+	if(s.LastUsed == mFrame || s.State != SlotState::Resident)
+	{
+		s.LastUsed = mFrame;
+		return;
+	}
+
+	s.LastUsed = mFrame;
+	Unlink(slot);
+	LinkFront(slot);
+}
+
+void VirtualTexture::LinkFront(uint32_t slot)
+{
+	Slot& s = mSlots[slot];
+	s.Prev = NoSlot;
+	s.Next = mLruHead;
+
+	if(mLruHead != NoSlot)
+		mSlots[mLruHead].Prev = slot;
+	else
+		mLruTail = slot;
+	mLruHead = slot;
+}
+
+void VirtualTexture::Unlink(uint32_t slot)
+{
+	Slot& s = mSlots[slot];
+
+	if(s.Prev != NoSlot)
+		mSlots[s.Prev].Next = s.Next;
+	else
+		mLruHead = s.Next;
+
+	if(s.Next != NoSlot)
+		mSlots[s.Next].Prev = s.Prev;
+	else
+		mLruTail = s.Prev;
+
+	s.Prev = s.Next = NoSlot;
+}
+
+uint32_t VirtualTexture::AcquireSlot(std::vector<Eviction>& evictions)
+{
+	if(!mFreeSlots.empty())
+	{
+		const uint32_t slot = mFreeSlots.back();
+		mFreeSlots.pop_back();
+		return slot;
+	}
+
+	// Pages sampled this frame are at the front, so a used tail means all are used
+	const uint32_t slot = mLruTail;
+	if(slot == NoSlot || mSlots[slot].LastUsed == mFrame)
+		return NoSlot;
+
+	const uint32_t page = mSlots[slot].Page;
+	Unlink(slot);
+	Unmap(page);
+	--mResidentPages;
+
+	evictions.push_back({ page, slot });
+	mSlots[slot].Page = NoPage;
+	mSlots[slot].State = SlotState::Free;
+	return slot;
+}
+
+void VirtualTexture::Map(uint32_t page, uint32_t slot)
+{
+	const uint32_t mip = PageMip(page);
+	const uint32_t entry = slot | (mip << 24);
+
+	// Every entry of the footprint that falls back to this mip or a coarser one now
+	// points here; entries already on a finer page keep it
+	for(uint32_t level = mip + 1; level-- > 0;)
+	{
+		const uint32_t shift = mip - level;
+		const uint32_t x0 = PageX(page) << shift, y0 = PageY(page) << shift;
+		const uint32_t x1 = (std::min)(x0 + (1u << shift), mPagesX[level]);
+		const uint32_t y1 = (std::min)(y0 + (1u << shift), mPagesY[level]);
+
+		for(uint32_t y = y0; y < y1; ++y)
+		{
+			uint32_t* row = mEntries.data() + mMipOffset[level] + y * mPagesX[level];
+			for(uint32_t x = x0; x < x1; ++x)
+				if(row[x] == Unmapped || EntryMip(row[x]) >= mip)
+					row[x] = entry;
+		}
+
+		MarkDirty(level, x0, y0, x1, y1);
+	}
+}
+
+void VirtualTexture::Unmap(uint32_t page)
+{
+	const uint32_t mip = PageMip(page);
+
+	// The parent's entry already holds the finest resident page above this one
+	const uint32_t fallback = mip + 1 < MipCount() ? Entry(MakePage(mip + 1, PageX(page) >> 1, PageY(page) >> 1)) : Unmapped;
+
+	for(uint32_t level = mip + 1; level-- > 0;)
+	{
+		const uint32_t shift = mip - level;
+		const uint32_t x0 = PageX(page) << shift, y0 = PageY(page) << shift;
+		const uint32_t x1 = (std::min)(x0 + (1u << shift), mPagesX[level]);
+		const uint32_t y1 = (std::min)(y0 + (1u << shift), mPagesY[level]);
+
+		for(uint32_t y = y0; y < y1; ++y)
+		{
+			uint32_t* row = mEntries.data() + mMipOffset[level] + y * mPagesX[level];
+			for(uint32_t x = x0; x < x1; ++x)
+				if(row[x] != Unmapped && EntryMip(row[x]) == mip)
+					row[x] = fallback;
+		}
+
+		MarkDirty(level, x0, y0, x1, y1);
+	}
+}
+
+void VirtualTexture::MarkDirty(uint32_t mip, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1)
+{
+	Region& region = mDirty[mip];
+	if(region.X0 >= region.X1)
+	{
+		region = { mip, x0, y0, x1, y1 };
+		return;
+	}
+
+	region.X0 = (std::min)(region.X0, x0);
+	region.Y0 = (std::min)(region.Y0, y0);
+	region.X1 = (std::max)(region.X1, x1);
+	region.Y1 = (std::max)(region.Y1, y1);
+}
+
+void VirtualTexture::TakeDirtyRegions(std::vector<Region>& regions)
+{
+	regions.clear();
+	for(Region& region : mDirty)
+	{
+		if(region.X0 < region.X1)
+			regions.push_back(region);
+		region.X0 = region.X1 = 0;
+	}
+}
+
+bool VirtualTexture::Validate() const
+{
+	std::unordered_map<uint32_t, uint32_t> resident; // page -> slot
+	uint32_t free = 0, loading = 0, lru = 0;
+
+	for(uint32_t slot = 0; slot < mSlots.size(); ++slot)
+	{
+		const Slot& s = mSlots[slot];
+		switch(s.State)
+		{
+		case SlotState::Free:
+			++free;
+			break;
+		case SlotState::Loading:
+			++loading;
+			{
+				const auto it = mInFlight.find(s.Page);
+				if(it == mInFlight.end() || it->second != slot)
+					return false;
+			}
+			break;
+		case SlotState::Resident:
+			++lru;
+			// fall through
+		case SlotState::Pinned:
+			if(!IsValidPage(s.Page) || !resident.emplace(s.Page, slot).second)
+				return false;
+			break;
+		}
+	}
+
+	if(free != mFreeSlots.size() || loading != mInFlight.size() || resident.size() != mResidentPages)
+		return false;
+
+	// LRU: every resident slot once, most recent first
+	uint32_t walked = 0;
+	uint64_t lastUsed = ~0ull;
+	uint32_t prev = NoSlot;
+	for(uint32_t slot = mLruHead; slot != NoSlot; slot = mSlots[slot].Next)
+	{
+		const Slot& s = mSlots[slot];
+		if(s.State != SlotState::Resident || s.Prev != prev || s.LastUsed > lastUsed || ++walked > lru)
+			return false;
+		lastUsed = s.LastUsed;
+		prev = slot;
+	}
+	if(walked != lru || prev != mLruTail)
+		return false;
+
+	// Each entry: the finest resident page covering it at its mip or above
+	for(uint32_t mip = 0; mip < MipCount(); ++mip)
+	{
+		for(uint32_t y = 0; y < mPagesY[mip]; ++y)
+		{
+			for(uint32_t x = 0; x < mPagesX[mip]; ++x)
+			{
+				uint32_t expected = Unmapped;
+				for(uint32_t level = mip; level < MipCount(); ++level)
+				{
+					const uint32_t shift = level - mip;
+					const auto it = resident.find(MakePage(level, x >> shift, y >> shift));
+					if(it != resident.end())
+					{
+						expected = it->second | (level << 24);
+						break;
+					}
+				}
+
+				if(mEntries[mMipOffset[mip] + y * mPagesX[mip] + x] != expected)
+					return false;
+			}
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,221 @@
+//***************************************************************************************
+// VirtualTexture.h
+//
+// Sparse residency for one large virtual texture: a texture far larger than memory is
+// cut into square pages, and only the pages the camera actually samples are kept in a
+// fixed cache of physical slots (one big texture on the GPU, a grid of slots).
+//
+//   -Page table: one entry per page of every mip, pointing at the finest resident page
+//    that covers it, so a lookup never misses; sampling falls back to a coarser page
+//    until the wanted one arrives.  Entries are what the GPU page-table texture holds
+//    (R32_UINT, a mip per level); DirtyRegions() says which parts to upload.
+//   -Page cache: resident pages sit on an LRU list, refreshed by every page the frame
+//    sampled (including the coarser stand-ins).  The coarsest PinnedMips levels are
+//    loaded first and never evicted, so every texel always has some page behind it.
+//   -Feedback: a low-resolution pass writes, per pixel, the page it wanted
+//    (MakePage(mip, x, y), NoPage where nothing was sampled).  Update() collapses that
+//    buffer into unique pages with pixel counts, and queues the next finer page of
+//    every miss: the resident mip minus one, so a region sharpens coarse to fine and no
+//    page is loaded before its parent.  Pages covering more pixels, and further from
+//    what they want, load first.
+//   -File: a .vtex file is a header followed by every page of every mip as a record of
+//    PageBytes (border included), mip 0 first and rows of pages top to bottom, so a
+//    page's offset is computed rather than looked up.
+//
+// Like TextureStreamer, nothing here touches Direct3D or files: reads happen elsewhere
+// and report back with Complete(), so the policy runs as-is against synthetic feedback.
+// An evicted slot may be refilled once the page-table upload of this frame is queued
+// ahead of the copy into it, which a single queue gives for free.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class VirtualTexture
+{
+public:
+	struct Desc
+	{
+		uint32_t Width = 65536;       // texels; multiples of PageSize
+		uint32_t Height = 65536;
+		uint32_t PageSize = 128;      // texels per page side, border not included
+		uint32_t Border = 4;          // texels repeated from the neighbours on each side, for filtering
+		uint32_t PageBytes = 18496;   // one page record in the file: BC7, (128 + 2 * 4)^2 texels
+		uint32_t CacheSlots = 4096;   // pages the physical cache holds
+		uint32_t PinnedMips = 3;      // coarsest levels, never evicted
+		uint32_t MaxLoadsInFlight = 64;
+	};
+
+	// Page ids as the feedback pass writes them: 4 bits of mip, 14 bits each of page x, y.
+	static constexpr uint32_t NoPage = 0xFFFFFFFFu;
+	static uint32_t MakePage(uint32_t mip, uint32_t x, uint32_t y) { return (mip << 28) | (y << 14) | x; }
+	static uint32_t PageMip(uint32_t page) { return page >> 28; }
+	static uint32_t PageX(uint32_t page) { return page & 0x3FFFu; }
+	static uint32_t PageY(uint32_t page) { return (page >> 14) & 0x3FFFu; }
+
+	// Page-table entries: physical slot in the low 24 bits, mip of the page in the high 8.
+	static constexpr uint32_t Unmapped = 0xFFFFFFFFu;
+	static uint32_t EntrySlot(uint32_t entry) { return entry & 0xFFFFFFu; }
+	static uint32_t EntryMip(uint32_t entry) { return entry >> 24; }
+
+	struct Load
+	{
+		uint32_t Page;
+		uint32_t Slot;        // where the page goes in the cache
+		uint64_t FileOffset;  // of its record in the .vtex file
+		float Priority;
+	};
+
+	struct Eviction
+	{
+		uint32_t Page;
+		uint32_t Slot;
+	};
+
+	struct Region // page-table texels to upload, [X0, X1) x [Y0, Y1) of one mip
+	{
+		uint32_t Mip;
+		uint32_t X0, Y0, X1, Y1;
+	};
+
+	struct Stats
+	{
+		uint64_t Pixels = 0;      // feedback entries, NoPage included
+		uint64_t HitPixels = 0;   // wanted page resident
+		uint64_t MissPixels = 0;  // sampled a coarser page
+		uint32_t Rejected = 0;    // entries that are not a page of this texture
+		uint32_t Unique = 0;      // distinct pages in the feedback
+		uint32_t Queued = 0;
+		uint32_t Issued = 0;
+		uint32_t Evicted = 0;
+		uint32_t Starved = 0;     // queued loads left over because every slot was used this frame
+		uint32_t ResidentPages = 0;
+	};
+
+	// .vtex header, 64 bytes
+	struct FileHeader
+	{
+		uint32_t Magic;   // 'VTEX'
+		uint32_t Version;
+		uint32_t Width;
+		uint32_t Height;
+		uint32_t PageSize;
+		uint32_t Border;
+		uint32_t Format;  // DXGI_FORMAT of the page texels
+		uint32_t PageBytes;
+		uint32_t MipCount;
+		uint32_t Reserved[7];
+	};
+
+	static constexpr uint32_t FileMagic = 0x58455456u; // "VTEX"
+	static constexpr uint32_t FileVersion = 1;
+
+	// Throws std::invalid_argument if the sizes do not fit the page id or entry layout.
+	explicit VirtualTexture(const Desc& desc);
+
+	// Fills desc's layout fields from a .vtex header and returns its DXGI format; false if
+	// the header is not one or fileSize cannot hold every page.
+	static bool ReadHeader(const void* data, uint64_t fileSize, Desc& desc, uint32_t& format);
+	FileHeader MakeHeader(uint32_t format) const;
+	uint64_t FileBytes() const;
+	uint64_t PageOffset(uint32_t page) const;
+
+	// Analyzes one frame of feedback and returns the loads to start, highest priority
+	// first, and the pages that lost their slot.  The first call also returns the pinned
+	// pages, which ignore MaxLoadsInFlight.  Call from one thread.
+	void Update(const uint32_t* feedback, size_t count, std::vector<Load>& loads, std::vector<Eviction>& evictions,
+		bool parallel = true);
+
+	// A load returned by Update has its data in its slot: maps the page.  Throws
+	// std::invalid_argument for a page that is not loading.
+	void Complete(uint32_t page);
+
+	uint32_t MipCount() const { return static_cast<uint32_t>(mPagesX.size()); }
+	uint32_t PagesX(uint32_t mip) const { return mPagesX[mip]; }
+	uint32_t PagesY(uint32_t mip) const { return mPagesY[mip]; }
+	uint32_t PageCount() const { return static_cast<uint32_t>(mEntries.size()); }
+	bool IsValidPage(uint32_t page) const;
+
+	uint32_t Entry(uint32_t page) const { return mEntries[Index(page)]; }
+	const uint32_t* Entries(uint32_t mip) const { return mEntries.data() + mMipOffset[mip]; }
+
+	// Page-table regions changed since the last call, at most one per mip.
+	void TakeDirtyRegions(std::vector<Region>& regions);
+
+	uint32_t ResidentPages() const { return mResidentPages; }
+	uint32_t LoadsInFlight() const { return static_cast<uint32_t>(mInFlight.size()); }
+	const Desc& GetDesc() const { return mDesc; }
+	const Stats& LastStats() const { return mStats; }
+
+	// Recomputes every entry from the slots and checks the LRU list; for tests.
+	bool Validate() const;
+
+private:
+	enum class SlotState : uint8_t { Free, Loading, Resident, Pinned };
+
+	struct Slot
+	{
+		uint32_t Page = NoPage;
+		uint32_t Prev = NoSlot;  // LRU neighbours, towards the most recent
+		uint32_t Next = NoSlot;  // and towards the least recent
+		uint64_t LastUsed = 0;
+		SlotState State = SlotState::Free;
+	};
+
+	struct Request
+	{
+		uint32_t Page;
+		float Weight; // pixels in Collect(), priority in the queue
+	};
+
+	static constexpr uint32_t NoSlot = 0xFFFFFFFFu;
+
+	uint32_t Index(uint32_t page) const { return mMipOffset[PageMip(page)] + PageY(page) * mPagesX[PageMip(page)] + PageX(page); }
+
+	// Unique valid pages of the feedback with their pixel counts, into mRequests.
+	void Collect(const uint32_t* feedback, size_t count, bool parallel);
+
+	void Touch(uint32_t slot);
+	void LinkFront(uint32_t slot);
+	void Unlink(uint32_t slot);
+
+	// A free slot, or the least recently used one not sampled this frame; NoSlot if none.
+	uint32_t AcquireSlot(std::vector<Eviction>& evictions);
+
+	// Page-table updates over the footprint of a page on its own and every finer mip.
+	void Map(uint32_t page, uint32_t slot);
+	void Unmap(uint32_t page);
+	void MarkDirty(uint32_t mip, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1);
+
+	Desc mDesc;
+	std::vector<uint32_t> mPagesX;
+	std::vector<uint32_t> mPagesY;
+	std::vector<uint32_t> mMipOffset; // first entry of each mip
+	std::vector<uint32_t> mEntries;
+
+	std::vector<Slot> mSlots;
+	std::vector<uint32_t> mFreeSlots;
+	uint32_t mLruHead = NoSlot; // most recently used
+	uint32_t mLruTail = NoSlot;
+	std::unordered_map<uint32_t, uint32_t> mInFlight; // page -> slot
+	uint32_t mResidentPages = 0;
+	bool mPinnedIssued = false;
+
+	std::vector<Region> mDirty; // per mip, empty when X0 >= X1
+
+	uint64_t mFrame = 0;
+	Stats mStats;
+
+	// Per-frame scratch; mStamp/mPosition are per page and tell a page seen this frame
+	// apart without clearing them
+	std::vector<uint32_t> mStamp;
+	std::vector<uint32_t> mPosition;
+	std::vector<Request> mRequests;
+	std::vector<Request> mQueue;
+	std::vector<std::vector<Request>> mChunkRuns;
+	std::vector<uint32_t> mChunkRejected;
+};
@@ -28,6 +28,7 @@
 #include "PlatformHelpers.h"
 #include "LoaderHelpers.h"
 #include "ResourceUploadBatch.h"
+#include "Profiler.h"
 
 using namespace DirectX;
 using Microsoft::WRL::ComPtr;
@@ -246,6 +247,8 @@ namespace
         std::unique_ptr<uint8_t[]>& decodedData,
         D3D12_SUBRESOURCE_DATA& subresource) noexcept
     {
+        PROFILE_ZONE("WIC::CreateTextureFromWIC");
+
         UINT width, height;
         HRESULT hr = frame->GetSize(&width, &height);
         if (FAILED(hr))
@@ -866,6 +869,8 @@ HRESULT DirectX::LoadWICTextureFromFileEx(
     std::unique_ptr<uint8_t[]>& decodedData,
     D3D12_SUBRESOURCE_DATA& subresource) noexcept
 {
+    PROFILE_ZONE("WIC::LoadWICTextureFromFileEx");
+
     if (texture)
     {
         *texture = nullptr;
@@ -915,6 +920,8 @@ HRESULT DirectX::CreateWICTextureFromFileEx(
     WIC_LOADER_FLAGS loadFlags,
     ID3D12Resource** texture)
 {
+    PROFILE_ZONE("WIC::CreateWICTextureFromFileEx");
+
     if (texture)
     {
         *texture = nullptr;